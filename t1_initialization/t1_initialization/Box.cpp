@@ -18,7 +18,7 @@ HRESULT Box::CompileShaderFromFile(const WCHAR* szFileName, LPCSTR szEntryPoint,
   D3DInclude includeObj;
 
   ID3DBlob* pErrorBlob = nullptr;
-  hr = D3DCompileFromFile(szFileName, nullptr, &includeObj, szEntryPoint, szShaderModel,
+  hr = CompileShaderFromAsset(szFileName, nullptr, &includeObj, szEntryPoint, szShaderModel,
     dwShaderFlags, 0, ppBlobOut, &pErrorBlob);
   if (FAILED(hr))
   {
@@ -40,7 +40,8 @@ void Box::ReadQueries(ID3D11DeviceContext* context) {
   while (lastCompletedFrame < curFrame) {
     HRESULT hr = context->GetData(queries[lastCompletedFrame % MAX_QUERY], &stats, sizeof(D3D11_QUERY_DATA_PIPELINE_STATISTICS), 0);
     if (hr == S_OK) {
-      cubesDrawedOnGPU = int(stats.IAPrimitives / 12);
+      UINT queryIndices = queryIndicesCount[lastCompletedFrame % MAX_QUERY];
+      cubesDrawedOnGPU = queryIndices >= 3 ? int(stats.IAPrimitives / (queryIndices / 3)) : 0;
       lastCompletedFrame++;
     }
     else {
@@ -62,26 +63,17 @@ HRESULT Box::InitQuery(ID3D11Device* device) {
 }
 
 
-HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, const MaterialParams &params, const std::vector<XMFLOAT4>& positions) {
-  assert(positions.size() == MAX_CUBES);
+HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, const MaterialParams &params, World& world) {
+  assert((world.Count<PositionComponent, SpinComponent, MaterialComponent, TransformComponent, BoundsComponent>() <= MAX_CUBES));
+  assert(params.diffPaths.size() <= MAX_MATERIALS);
 
   InitQuery(device);
 
-  // Init frustum culling
-  frustum.Init(0.01f);
-
-  // Init cubes params
-  boxesModelVector = std::vector<BoxModel>(MAX_CUBES);
-  for (int i = 0; i < MAX_CUBES; i++) {
-    BoxModel tmp;
-    float textureIndex = (float)(rand() % params.diffPaths.size());
-    tmp.pos = positions[i];
-    tmp.params = XMFLOAT4(params.shines,
-      (float)(rand() % 10 - 5), 
-      textureIndex, 
-      textureIndex > 0.0f ? 0.0f : 1.0f);
-    boxesModelVector[i] = tmp;
-  }
+  // Main camera only until other views are set
+  SetCullViews(nullptr, 0);
+
+  // Per box params come from box entities, material ones are the same for all
+  shines = params.shines;
   
   // Compile the vertex shader
   ID3DBlob* pVSBlob = nullptr;
@@ -104,10 +96,10 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
   // Define the input layout
   D3D11_INPUT_ELEMENT_DESC layout[] =
   {
-      {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-      {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0}, 
-      {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0},
-      {"TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D11_INPUT_PER_VERTEX_DATA, 0},
+      {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+      {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+      {"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+      {"TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0},
   };
   UINT numElements = ARRAYSIZE(layout);
 
@@ -118,6 +110,30 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
   if (FAILED(hr))
     return hr;
 
+  // Depth only vertex shader for shadow maps, reads positions only
+  hr = CompileShaderFromFile(L"shadow_VS.hlsl", "main", "vs_5_0", &pVSBlob);
+  if (FAILED(hr))
+  {
+    MessageBox(nullptr,
+      L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
+    return hr;
+  }
+
+  // Instance index comes from second stream, so start instance location of draw offsets it into lists of all views
+  D3D11_INPUT_ELEMENT_DESC depthLayout[] =
+  {
+      {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+      {"INSTANCE", 0, DXGI_FORMAT_R32_UINT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+  };
+
+  hr = device->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &g_pDepthVertexShader);
+  if (SUCCEEDED(hr))
+    hr = device->CreateInputLayout(depthLayout, ARRAYSIZE(depthLayout), pVSBlob->GetBufferPointer(),
+      pVSBlob->GetBufferSize(), &g_pDepthVertexLayout);
+  pVSBlob->Release();
+  if (FAILED(hr))
+    return hr;
+
   // Set the input layout
   context->IASetInputLayout(g_pVertexLayout);
 
@@ -155,11 +171,38 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
 
   // Load texts
   boxesTextures = std::vector<Texture>(2);
-  hr = boxesTextures[0].InitArray(device, context, params.diffPaths);
+  AtlasLayout atlas;
+  hr = boxesTextures[0].InitAtlas(device, context, params.diffPaths, atlas);
+  if (FAILED(hr))
+    return hr;
   hr = boxesTextures[1].Init(device, context, params.normalPath);
   if (FAILED(hr))
     return hr;
 
+  // Materials uv rects in atlas
+  MaterialAtlasBuffer atlasBuffer = {};
+  for (size_t i = 0; i < atlas.rects.size(); i++) {
+    atlasBuffer.uvScaleOffset[i] = atlas.rects[i].uvScaleOffset;
+    atlasBuffer.page[i] = XMINT4((int)atlas.rects[i].page, 0, 0, 0);
+  }
+
+  D3D11_BUFFER_DESC descMAB = {};
+  descMAB.ByteWidth = sizeof(MaterialAtlasBuffer);
+  descMAB.Usage = D3D11_USAGE_IMMUTABLE;
+  descMAB.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+  descMAB.CPUAccessFlags = 0;
+  descMAB.MiscFlags = 0;
+  descMAB.StructureByteStride = 0;
+
+  D3D11_SUBRESOURCE_DATA atlasData;
+  atlasData.pSysMem = &atlasBuffer;
+  atlasData.SysMemPitch = sizeof(atlasBuffer);
+  atlasData.SysMemSlicePitch = 0;
+
+  hr = device->CreateBuffer(&descMAB, &atlasData, &g_pMaterialAtlasBuffer);
+  if (FAILED(hr))
+    return hr;
+
   // Create vertex buffer
   TexVertex vertices[] = {
     {{-0.5, -0.5,  0.5}, {0, 1}, {0, -1, 0}, {1, 0, 0}},
@@ -193,6 +236,9 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
     {{-0.5,  0.5, -0.5}, {1, 0}, {0, 0, -1}, {1, 0, 0}}
   };
 
+  QuantizedTexVertex quantizedVertices[ARRAYSIZE(vertices)];
+  boxQuantization = VertexQuantizer::Encode(vertices, ARRAYSIZE(vertices), quantizedVertices);
+
   USHORT indices[] = {
         0, 2, 1, 0, 3, 2,
         4, 6, 5, 4, 7, 6,
@@ -205,7 +251,7 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
   D3D11_BUFFER_DESC bd;
   ZeroMemory(&bd, sizeof(bd));
   bd.Usage = D3D11_USAGE_IMMUTABLE;
-  bd.ByteWidth = sizeof(vertices);
+  bd.ByteWidth = sizeof(quantizedVertices);
   bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
   bd.CPUAccessFlags = 0;
   bd.MiscFlags = 0;
@@ -213,8 +259,8 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
 
   D3D11_SUBRESOURCE_DATA InitData;
   ZeroMemory(&InitData, sizeof(InitData));
-  InitData.pSysMem = &vertices;
-  InitData.SysMemPitch = sizeof(vertices);
+  InitData.pSysMem = &quantizedVertices;
+  InitData.SysMemPitch = sizeof(quantizedVertices);
   InitData.SysMemSlicePitch = 0;
 
   hr = device->CreateBuffer(&bd, &InitData, &g_pVertexBuffer);
@@ -241,6 +287,29 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
   if (FAILED(hr))
     return hr;
 
+  // Real asset geometry if it was converted, cube otherwise
+  useMesh = SUCCEEDED(mesh.Init(device, BOX_MESH_PATH));
+  if (useMesh) {
+    boxQuantization = mesh.GetQuantization();
+    indicesCount = mesh.GetIndicesCount();
+    fullIndicesCount = indicesCount;
+    mesh.GetBounds(boxAABB[0], boxAABB[1]);
+  }
+
+  if (useMesh && !mesh.GetMeshlets().empty()) {
+    D3D11_BUFFER_DESC descCulled = {};
+    descCulled.ByteWidth = (UINT)mesh.GetIndices().size();
+    descCulled.Usage = D3D11_USAGE_DYNAMIC;
+    descCulled.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    descCulled.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    descCulled.MiscFlags = 0;
+    descCulled.StructureByteStride = 0;
+
+    hr = device->CreateBuffer(&descCulled, nullptr, &g_pCulledIndexBuffer);
+    if (FAILED(hr))
+      return hr;
+  }
+
   // Set constant buffers
   D3D11_BUFFER_DESC descWMB = {};
   descWMB.ByteWidth = sizeof(GeomBuffer) * MAX_CUBES;
@@ -251,27 +320,22 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
   descWMB.StructureByteStride = 0;
 
   // Find cubes in frustum
-  static const XMFLOAT4 AABB[] = {
-    {-0.5, -0.5, -0.5, 1.0},
-    {0.5,  0.5, 0.5, 1.0}
-  };
   GeomBuffer geomBufferInst[MAX_CUBES];
   CullParams cullParams;
-  for (int i = 0; i < MAX_CUBES; i++) {
-    geomBufferInst[i].worldMatrix = XMMatrixTranslation(
-      boxesModelVector[i].pos.x, 
-      boxesModelVector[i].pos.y,
-      boxesModelVector[i].pos.z);
-    geomBufferInst[i].norm = geomBufferInst[i].worldMatrix;
-    geomBufferInst[i].params = boxesModelVector[i].params;
-
-    XMFLOAT4 min, max;
-    XMStoreFloat4(&min, XMVector4Transform(XMLoadFloat4(&AABB[0]), geomBufferInst[i].worldMatrix));
-    XMStoreFloat4(&max, XMVector4Transform(XMLoadFloat4(&AABB[1]), geomBufferInst[i].worldMatrix));
-    cullParams.bbMin[i] = min;
-    cullParams.bbMax[i] = max;
-  }
-  cullParams.numShapes = XMINT4(int(boxesModelVector.size()), 0, 0, 0);
+  int boxesCount = 0;
+  world.ForEachChunk<PositionComponent, SpinComponent, MaterialComponent, TransformComponent, BoundsComponent>(
+    [&](uint32_t count, const Entity*, PositionComponent* positions, SpinComponent* spins, MaterialComponent* materials,
+      TransformComponent*, BoundsComponent*) {
+    for (uint32_t i = 0; i < count && boxesCount < MAX_CUBES; i++, boxesCount++) {
+      GeomBuffer& geom = geomBufferInst[boxesCount];
+      geom.worldMatrix = XMMatrixTranslation(positions[i].position.x, positions[i].position.y, positions[i].position.z);
+      geom.norm = geom.worldMatrix;
+      geom.params = GetBoxParams(spins[i], materials[i]);
+
+      MultiViewCuller::TransformBounds(boxAABB[0], boxAABB[1], geom.worldMatrix, cullParams.bbMin[boxesCount], cullParams.bbMax[boxesCount]);
+    }
+  });
+  cullParams.numShapes = XMINT4(boxesCount, 0, 0, 0);
 
   D3D11_SUBRESOURCE_DATA cullData;
   cullData.pSysMem = &cullParams;
@@ -323,6 +387,26 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
   if (FAILED(hr))
     return hr;
 
+  // Last plane that rejected every box, zeros start all of them from the first plane
+  D3D11_BUFFER_DESC historyDesc = {};
+  historyDesc.ByteWidth = sizeof(UINT) * MAX_CUBES;
+  historyDesc.Usage = D3D11_USAGE_DEFAULT;
+  historyDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+  historyDesc.CPUAccessFlags = 0;
+  historyDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+  historyDesc.StructureByteStride = sizeof(UINT);
+
+  UINT history[MAX_CUBES] = {};
+  D3D11_SUBRESOURCE_DATA historyData = {};
+  historyData.pSysMem = history;
+
+  hr = device->CreateBuffer(&historyDesc, &historyData, &g_pCullHistory);
+  if (FAILED(hr))
+    return hr;
+  hr = device->CreateUnorderedAccessView(g_pCullHistory, nullptr, &g_pCullHistoryUAV);
+  if (FAILED(hr))
+    return hr;
+
   D3D11_BUFFER_DESC gbDescGPU = {};
   gbDescGPU.ByteWidth = sizeof(XMINT4) * MAX_CUBES;
   gbDescGPU.Usage = D3D11_USAGE_DEFAULT;
@@ -368,6 +452,41 @@ HRESULT Box::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screen
   if (FAILED(hr))
     return hr;
 
+  // Depth pass buffers are written once per frame for all views
+  static_assert(MAX_DEPTH_VIEWS >= CULL_MAX_VIEWS, "Depth buffers must hold every culled view");
+  static_assert(MAX_CUBES * MAX_DEPTH_VIEWS <= D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT, "Instance lists don't fit constant buffer");
+  D3D11_BUFFER_DESC descDPB = {};
+  descDPB.ByteWidth = sizeof(DepthViewsCB);
+  descDPB.Usage = D3D11_USAGE_DYNAMIC;
+  descDPB.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+  descDPB.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+  descDPB.MiscFlags = 0;
+  descDPB.StructureByteStride = 0;
+
+  hr = device->CreateBuffer(&descDPB, nullptr, &g_pDepthPassBuffer);
+  if (FAILED(hr))
+    return hr;
+
+  descDPB.ByteWidth = sizeof(XMINT4) * MAX_CUBES * MAX_DEPTH_VIEWS;
+  hr = device->CreateBuffer(&descDPB, nullptr, &g_pDepthInstancesBuffer);
+  if (FAILED(hr))
+    return hr;
+
+  std::vector<UINT> instanceIndices(MAX_CUBES * MAX_DEPTH_VIEWS);
+  for (UINT i = 0; i < (UINT)instanceIndices.size(); i++)
+    instanceIndices[i] = i;
+
+  D3D11_BUFFER_DESC descIIB = {};
+  descIIB.ByteWidth = sizeof(UINT) * (UINT)instanceIndices.size();
+  descIIB.Usage = D3D11_USAGE_IMMUTABLE;
+  descIIB.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+  D3D11_SUBRESOURCE_DATA instanceIndicesData = {};
+  instanceIndicesData.pSysMem = instanceIndices.data();
+  hr = device->CreateBuffer(&descIIB, &instanceIndicesData, &g_pDepthInstanceIndexBuffer);
+  if (FAILED(hr))
+    return hr;
+
   // Set rastrizer state
   D3D11_RASTERIZER_DESC descRastr = {};
   descRastr.FillMode = D3D11_FILL_SOLID;
@@ -425,13 +544,18 @@ void Box::Realese() {
   for (auto& tex : boxesTextures)
     tex.Release();
 
-  frustum.Realese();
+  mesh.Release();
+  if (g_pCulledIndexBuffer) g_pCulledIndexBuffer->Release();
 
   if (g_pSamplerState) g_pSamplerState->Release();
   if (g_pRasterizerState) g_pRasterizerState->Release();
 
   if (g_pGeomBuffer) g_pGeomBuffer->Release();
   if (g_LightConstantBuffer) g_LightConstantBuffer->Release();
+  if (g_pMaterialAtlasBuffer) g_pMaterialAtlasBuffer->Release();
+  if (g_pDepthPassBuffer) g_pDepthPassBuffer->Release();
+  if (g_pDepthInstancesBuffer) g_pDepthInstancesBuffer->Release();
+  if (g_pDepthInstanceIndexBuffer) g_pDepthInstanceIndexBuffer->Release();
 
   if (g_pDepthState) g_pDepthState->Release();
   if (g_pSceneMatrixBuffer) g_pSceneMatrixBuffer->Release();
@@ -440,11 +564,15 @@ void Box::Realese() {
   if (g_pVertexLayout) g_pVertexLayout->Release();
   if (g_pVertexShader) g_pVertexShader->Release();
   if (g_pPixelShader) g_pPixelShader->Release();
+  if (g_pDepthVertexLayout) g_pDepthVertexLayout->Release();
+  if (g_pDepthVertexShader) g_pDepthVertexShader->Release();
 
   if (g_pInderectArgsSrc) g_pInderectArgsSrc->Release();
   if (g_pInderectArgs) g_pInderectArgs->Release();
   if (g_pGeomBufferInstVisGpu) g_pGeomBufferInstVisGpu->Release();
   if (g_pGeomBufferInstVisGpu_UAV) g_pGeomBufferInstVisGpu_UAV->Release();
+  if (g_pCullHistory) g_pCullHistory->Release();
+  if (g_pCullHistoryUAV) g_pCullHistoryUAV->Release();
   if (g_pGeomBufferInstVis) g_pGeomBufferInstVis->Release();
   if (g_pInderectArgsUAV) g_pInderectArgsUAV->Release();
   if (g_pCullShader) g_pCullShader->Release();
@@ -459,7 +587,10 @@ void Box::Render(ID3D11DeviceContext* context) {
   context->OMSetDepthStencilState(g_pDepthState, 0);
   context->RSSetState(g_pRasterizerState);
 
-  context->IASetIndexBuffer(g_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+  if (useMesh)
+    context->IASetIndexBuffer(g_pCulledIndexBuffer ? g_pCulledIndexBuffer : mesh.GetIndexBuffer(), mesh.GetIndexFormat(), 0);
+  else
+    context->IASetIndexBuffer(g_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
   ID3D11SamplerState* samplers[] = { g_pSamplerState };
   context->PSSetSamplers(0, 1, samplers);
 
@@ -469,8 +600,8 @@ void Box::Render(ID3D11DeviceContext* context) {
   };
   context->PSSetShaderResources(0, 2, resources);
   
-  ID3D11Buffer* vertexBuffers[] = { g_pVertexBuffer };
-  UINT strides[] = { sizeof(TexVertex) };
+  ID3D11Buffer* vertexBuffers[] = { useMesh ? mesh.GetVertexBuffer() : g_pVertexBuffer };
+  UINT strides[] = { sizeof(QuantizedTexVertex) };
   UINT offsets[] = { 0 };
 
   context->IASetVertexBuffers(0, 1, vertexBuffers, strides, offsets);
@@ -486,7 +617,9 @@ void Box::Render(ID3D11DeviceContext* context) {
   context->PSSetConstantBuffers(0, 1, &g_pGeomBuffer);
   context->PSSetConstantBuffers(1, 1, &g_pSceneMatrixBuffer);
   context->PSSetConstantBuffers(2, 1, &g_LightConstantBuffer);
+  context->PSSetConstantBuffers(3, 1, &g_pMaterialAtlasBuffer);
 
+  queryIndicesCount[curFrame % MAX_QUERY] = indicesCount;
   context->Begin(queries[curFrame % MAX_QUERY]);
   context->DrawIndexedInstancedIndirect(g_pInderectArgs, 0);
   context->End(queries[curFrame % MAX_QUERY]);
@@ -496,62 +629,169 @@ void Box::Render(ID3D11DeviceContext* context) {
 }
 
 
-bool Box::Frame(ID3D11DeviceContext* context, XMMATRIX& viewMatrix, XMMATRIX& projectionMatrix, XMFLOAT3& cameraPos, const Light& lights) {
-  CullParams cullParams;
-  
-  // Update world matrix angle of all cubes
-  auto duration = Timer::GetInstance().Clock();
-  GeomBuffer geomBufferInst[MAX_CUBES];
+bool Box::UploadDepthViews(ID3D11DeviceContext* context, const XMMATRIX* viewProjections, uint32_t count) {
+  depthViewsUploaded = false;
+  uint32_t viewsCount = (std::min)(count + 1, (uint32_t)viewOffsets.size() - 1);
 
-  for (int i = 0; i < MAX_CUBES; i++) {
-    geomBufferInst[i].worldMatrix = 
-      XMMatrixRotationY((float)duration * boxesModelVector[i].params.y * 0.5f) *
-      XMMatrixRotationZ((float)(sin(duration * boxesModelVector[i].params.y * 0.30) * 0.25f)) *
-      XMMatrixTranslation(0, (float)(sin(duration * boxesModelVector[i].params.y * 0.30) * 0.25f), 0) *
-      XMMatrixTranslation(boxesModelVector[i].pos.x, boxesModelVector[i].pos.y, boxesModelVector[i].pos.z);
-    geomBufferInst[i].norm = geomBufferInst[i].worldMatrix;
-    geomBufferInst[i].params = boxesModelVector[i].params;
-  }
+  // Lists go where BuildLists put them, so view offsets are start instance locations as they are
+  D3D11_MAPPED_SUBRESOURCE subresource;
+  HRESULT hr = context->Map(g_pDepthInstancesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
+  if (FAILED(hr))
+    return false;
+  XMINT4* instances = reinterpret_cast<XMINT4*>(subresource.pData);
+  for (uint32_t v = 1; v < viewsCount; v++)
+    for (uint32_t i = viewOffsets[v]; i < viewOffsets[v + 1]; i++)
+      instances[i] = XMINT4((int)viewInstances[i], (int)v, 0, 0);
+  context->Unmap(g_pDepthInstancesBuffer, 0);
+
+  hr = context->Map(g_pDepthPassBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
+  if (FAILED(hr))
+    return false;
+  DepthViewsCB& depthViews = *reinterpret_cast<DepthViewsCB*>(subresource.pData);
+  for (uint32_t v = 1; v < viewsCount; v++)
+    depthViews.viewProjection[v] = viewProjections[v - 1];
+  context->Unmap(g_pDepthPassBuffer, 0);
+
+  depthViewsUploaded = true;
+  return true;
+}
 
-  context->UpdateSubresource(g_pGeomBuffer, 0, nullptr, &geomBufferInst, 0, 0);
+void Box::RenderDepth(ID3D11DeviceContext* context, uint32_t view) {
+  uint32_t count = 0;
+  GetViewInstances(view, count);
+  if (count == 0 || !depthViewsUploaded)
+    return;
 
-  // Calculate frustum
-  frustum.ConstructFrustum(viewMatrix, projectionMatrix);
+  if (useMesh)
+    context->IASetIndexBuffer(mesh.GetIndexBuffer(), mesh.GetIndexFormat(), 0);
+  else
+    context->IASetIndexBuffer(g_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
 
-  static const XMFLOAT4 AABB[] = {
-    {-0.5, -0.5, -0.5, 1.0},
-    {0.5,  0.5, 0.5, 1.0}
-  };
+  ID3D11Buffer* vertexBuffers[] = { useMesh ? mesh.GetVertexBuffer() : g_pVertexBuffer, g_pDepthInstanceIndexBuffer };
+  UINT strides[] = { sizeof(QuantizedTexVertex), sizeof(UINT) };
+  UINT offsets[] = { 0, 0 };
 
-  boxesIndexies.clear();
-  for (int i = 0; i < MAX_CUBES; i++) {
-    XMFLOAT4 min, max;
-    
-    XMStoreFloat4(&min, XMVector4Transform(XMLoadFloat4(&AABB[0]), geomBufferInst[i].worldMatrix));
-    XMStoreFloat4(&max, XMVector4Transform(XMLoadFloat4(&AABB[1]), geomBufferInst[i].worldMatrix));
-    
-    //if (frustum.CheckRectangle(min, max))
-    boxesIndexies.push_back(i);
-
-    cullParams.bbMin[i] = min;
-    cullParams.bbMax[i] = max;
+  context->IASetVertexBuffers(0, 2, vertexBuffers, strides, offsets);
+  context->IASetInputLayout(g_pDepthVertexLayout);
+  context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+  context->VSSetShader(g_pDepthVertexShader, nullptr, 0);
+  context->VSSetConstantBuffers(0, 1, &g_pGeomBuffer);
+  context->VSSetConstantBuffers(1, 1, &g_pSceneMatrixBuffer);
+  context->VSSetConstantBuffers(4, 1, &g_pDepthPassBuffer);
+  context->VSSetConstantBuffers(5, 1, &g_pDepthInstancesBuffer);
+  context->PSSetShader(nullptr, nullptr, 0);
+
+  context->DrawIndexedInstanced(fullIndicesCount, count, 0, 0, viewOffsets[view]);
+}
+
+void Box::SetCullViews(const CullView* views, uint32_t count) {
+  assert(count < CULL_MAX_VIEWS);
+  cullViews.resize(count + 1);
+  for (uint32_t v = 0; v < count; v++)
+    cullViews[v + 1] = views[v];
+
+  // Lists are sized for every box in every view, so frames don't reallocate them
+  viewInstances.resize(MAX_CUBES * cullViews.size());
+  viewOffsets.assign(cullViews.size() + 1, 0);
+}
+
+const uint32_t* Box::GetViewInstances(uint32_t view, uint32_t& count) const {
+  count = view + 1 < viewOffsets.size() ? viewOffsets[view + 1] - viewOffsets[view] : 0;
+  return count > 0 ? viewInstances.data() + viewOffsets[view] : nullptr;
+}
+
+uint32_t Box::GetBounds(const XMFLOAT4*& bbMin, const XMFLOAT4*& bbMax) const {
+  bbMin = frameCullParams ? frameCullParams->bbMin : nullptr;
+  bbMax = frameCullParams ? frameCullParams->bbMax : nullptr;
+  return frameCullParams ? frameBoxesCount : 0;
+}
+
+XMFLOAT4 Box::GetBoxParams(const SpinComponent& spin, const MaterialComponent& material) {
+  float textureIndex = (float)material.texture;
+  return XMFLOAT4(shines, spin.speed, textureIndex, textureIndex > 0.0f ? 0.0f : 1.0f);
+}
+
+bool Box::Frame(ID3D11DeviceContext* context, World& world, const CameraState& camera, const Light& lights) {
+  const XMFLOAT3& cameraPos = camera.GetPosition();
+
+  // Per frame data goes to frame arena, stack stays small as counts grow
+  FrameArena& arena = FrameArena::GetThreadArena();
+  CullParams& cullParams = *arena.Allocate<CullParams>(1);
+
+  // World matrices come interpolated from simulation, bounds of every box entity follow them.
+  // Packed for GPU in query order
+  GeomBuffer* geomBufferInst = arena.Allocate<GeomBuffer>(MAX_CUBES);
+  int boxesCount = 0;
+
+  world.ForEachChunk<PositionComponent, SpinComponent, MaterialComponent, TransformComponent, BoundsComponent>(
+    [&](uint32_t count, const Entity*, PositionComponent*, SpinComponent* spins, MaterialComponent* materials,
+      TransformComponent* transforms, BoundsComponent* bounds) {
+    for (uint32_t i = 0; i < count && boxesCount < MAX_CUBES; i++, boxesCount++) {
+      XMMATRIX worldMatrix = XMLoadFloat4x4(&transforms[i].world);
+      MultiViewCuller::TransformBounds(boxAABB[0], boxAABB[1], worldMatrix, bounds[i].min, bounds[i].max);
+
+      GeomBuffer& geom = geomBufferInst[boxesCount];
+      geom.worldMatrix = worldMatrix;
+      geom.norm = worldMatrix;
+      geom.params = GetBoxParams(spins[i], materials[i]);
+      cullParams.bbMin[boxesCount] = bounds[i].min;
+      cullParams.bbMax[boxesCount] = bounds[i].max;
+    }
+  });
+
+  context->UpdateSubresource(g_pGeomBuffer, 0, nullptr, geomBufferInst, 0, 0);
+  frameCullParams = &cullParams;
+  frameBoxesCount = boxesCount;
+
+  // Cull boxes against main camera and other views at once
+  cullViews[0] = CullView::FromPlanes(camera.GetFrustumPlanes());
+  viewCuller.SetViews(cullViews.data(), (uint32_t)cullViews.size());
+  uint32_t* masks = arena.Allocate<uint32_t>(boxesCount);
+  viewCuller.Cull(cullParams.bbMin, cullParams.bbMax, boxesCount, masks);
+  MultiViewCuller::BuildLists(masks, boxesCount, (uint32_t)cullViews.size(), viewInstances.data(), viewOffsets.data());
+  depthViewsUploaded = false;
+
+  // Drop meshlets outside frustum or facing away from camera for all cubes.
+  // Boxes outside frustum can't show any meshlet, only visible ones are tested
+  if (g_pCulledIndexBuffer) {
+    uint32_t visibleBoxes = 0;
+    const uint32_t* visibleIds = GetViewInstances(0, visibleBoxes);
+    XMMATRIX* worldMatrices = arena.Allocate<XMMATRIX>(visibleBoxes);
+    for (uint32_t i = 0; i < visibleBoxes; i++)
+      worldMatrices[i] = geomBufferInst[visibleIds[i]].worldMatrix;
+
+    const std::vector<Meshlet>& meshlets = mesh.GetMeshlets();
+    MeshletCuller::Cull(meshlets.data(), meshlets.size(), worldMatrices, visibleBoxes, camera.GetFrustumPlanes(), cameraPos, visibleMeshlets, &meshletStats);
+
+    D3D11_MAPPED_SUBRESOURCE indices;
+    HRESULT hr = context->Map(g_pCulledIndexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &indices);
+    if (FAILED(hr))
+      return FAILED(hr);
+    indicesCount = MeshletCuller::Compact(meshlets.data(), visibleMeshlets, mesh.GetIndices().data(), mesh.GetIndexSize(), indices.pData);
+    context->Unmap(g_pCulledIndexBuffer, 0);
   }
 
-  cullParams.numShapes = XMINT4(MAX_CUBES, 0, 0, 0);
+  cullParams.numShapes = XMINT4(boxesCount, cullCoherence ? 1 : 0, 0, 0);
   context->UpdateSubresource(g_pCullParams, 0, nullptr, &cullParams, 0, 0);
 
-  // Get the view matrix
+  // Scene buffer depends on camera only, it is kept while camera stands still
   D3D11_MAPPED_SUBRESOURCE subresource;
-  HRESULT hr = context->Map(g_pSceneMatrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
-  if (FAILED(hr))
-    return FAILED(hr);
-  BoxSceneMatrixBuffer& sceneBuffer = *reinterpret_cast<BoxSceneMatrixBuffer*>(subresource.pData);
-  sceneBuffer.viewProjectionMatrix = XMMatrixMultiply(viewMatrix, projectionMatrix);
-  XMFLOAT4* planes = frustum.GetPlanes();
-  for (int i = 0; i < 6; i++) {
-    sceneBuffer.planes[i] = planes[i];
+  HRESULT hr;
+  if (sceneVersion != camera.GetVersion()) {
+    hr = context->Map(g_pSceneMatrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
+    if (FAILED(hr))
+      return FAILED(hr);
+    BoxSceneMatrixBuffer& sceneBuffer = *reinterpret_cast<BoxSceneMatrixBuffer*>(subresource.pData);
+    sceneBuffer.viewProjectionMatrix = camera.GetViewProjection();
+    const XMFLOAT4* planes = camera.GetFrustumPlanes();
+    for (int i = 0; i < 6; i++) {
+      sceneBuffer.planes[i] = planes[i];
+    }
+    sceneBuffer.boxQuantization = boxQuantization;
+    context->Unmap(g_pSceneMatrixBuffer, 0);
+    sceneVersion = camera.GetVersion();
   }
-  context->Unmap(g_pSceneMatrixBuffer, 0);
 
   // Update Light buffer
   hr = context->Map(g_LightConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
@@ -574,7 +814,7 @@ bool Box::Frame(ID3D11DeviceContext* context, XMMATRIX& viewMatrix, XMMATRIX& pr
 
   // GPU Culling
   D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS args;
-  args.IndexCountPerInstance = 36;
+  args.IndexCountPerInstance = indicesCount;
   args.InstanceCount = 0;
   args.StartInstanceLocation = 0;
   args.BaseVertexLocation = 0;
@@ -585,6 +825,7 @@ bool Box::Frame(ID3D11DeviceContext* context, XMMATRIX& viewMatrix, XMMATRIX& pr
   context->CSSetConstantBuffers(1, 1, &g_pSceneMatrixBuffer);
   context->CSSetUnorderedAccessViews(0, 1, &g_pInderectArgsUAV, nullptr);
   context->CSSetUnorderedAccessViews(1, 1, &g_pGeomBufferInstVisGpu_UAV, nullptr);
+  context->CSSetUnorderedAccessViews(2, 1, &g_pCullHistoryUAV, nullptr);
   context->CSSetShader(g_pCullShader, nullptr, 0);
   context->Dispatch(groupNumber, 1, 1);
 
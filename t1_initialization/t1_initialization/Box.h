@@ -8,17 +8,27 @@
 #include <vector>
 
 #include "timer.h"
-#include "frustumCulling.h"
+#include "cameraState.h"
+#include "multiViewCuller.h"
 #include "Material.h"
 #include "D3DInclude.h"
+#include "vertexQuantizer.h"
+#include "meshAsset.h"
 #include "def.h"
 #include "Light.h"
+#include "ecs.h"
+#include "components.h"
+#include "frameArena.h"
 
 using namespace DirectX;
 
+// Converted mesh (see MeshConverter) drawn instead of built-in cube when present
+#define BOX_MESH_PATH L"./src/box.mesh"
+
 class Box {
 public:
-  HRESULT Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, const MaterialParams& params, const std::vector<XMFLOAT4>& positions);
+  // Boxes are World entities with Position, Spin, Material, Transform and Bounds components
+  HRESULT Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, const MaterialParams& params, World& world);
 
   void Realese();
 
@@ -26,11 +36,29 @@ public:
 
   void Render(ID3D11DeviceContext* context);
 
-  bool Frame(ID3D11DeviceContext* context, XMMATRIX& viewMatrix, XMMATRIX& projectionMatrix, XMFLOAT3& cameraPos, const Light& lights);
+  bool Frame(ID3D11DeviceContext* context, World& world, const CameraState& camera, const Light& lights);
+
+  int GetCulledCount() { return int(frameBoxesCount) - cubesDrawedOnGPU; };
+
+  const MeshletCullStats& GetMeshletStats() { return meshletStats; };
 
-  int GetCulledCount() { return MAX_CUBES - cubesDrawedOnGPU; };
+  // GPU culling tests plane that rejected box last frame first
+  void SetCullCoherence(bool enabled) { cullCoherence = enabled; };
+
+  // Views culled together with main camera (shadow cascades, reflections), they get view ids from 1
+  void SetCullViews(const CullView* views, uint32_t count);
+  // Boxes (in query order) visible in view of last frame, view 0 is main camera
+  const uint32_t* GetViewInstances(uint32_t view, uint32_t& count) const;
+  // World bounds of boxes packed by last Frame in query order, valid till frame arena reset
+  uint32_t GetBounds(const XMFLOAT4*& bbMin, const XMFLOAT4*& bbMax) const;
+
+  // Instance lists of all views and viewProjections[v] of view v + 1 in one upload per frame, before RenderDepth
+  bool UploadDepthViews(ID3D11DeviceContext* context, const XMMATRIX* viewProjections, uint32_t count);
+  // Depth of boxes visible in view into bound depth target (shadow maps)
+  void RenderDepth(ID3D11DeviceContext* context, uint32_t view);
 private:
   HRESULT InitQuery(ID3D11Device* device);
+  XMFLOAT4 GetBoxParams(const SpinComponent& spin, const MaterialComponent& material);
   void ReadQueries(ID3D11DeviceContext* context);
 
   HRESULT CompileShaderFromFile(const WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut);
@@ -40,6 +68,8 @@ private:
   ID3D11PixelShader* g_pPixelShader = nullptr;
   ID3D11InputLayout* g_pVertexLayout = nullptr;
   ID3D11ComputeShader* g_pCullShader = nullptr;
+  ID3D11VertexShader* g_pDepthVertexShader = nullptr;
+  ID3D11InputLayout* g_pDepthVertexLayout = nullptr;
 
   ID3D11Buffer* g_pVertexBuffer = nullptr;
   ID3D11Buffer* g_pIndexBuffer = nullptr;
@@ -47,6 +77,10 @@ private:
   ID3D11Buffer* g_pCullParams = nullptr;
   ID3D11Buffer* g_pSceneMatrixBuffer = nullptr;
   ID3D11Buffer* g_LightConstantBuffer = nullptr;
+  ID3D11Buffer* g_pMaterialAtlasBuffer = nullptr;
+  ID3D11Buffer* g_pDepthPassBuffer = nullptr;
+  ID3D11Buffer* g_pDepthInstancesBuffer = nullptr;
+  ID3D11Buffer* g_pDepthInstanceIndexBuffer = nullptr;
   ID3D11RasterizerState* g_pRasterizerState = nullptr;
   ID3D11SamplerState* g_pSamplerState = nullptr;
   ID3D11DepthStencilState* g_pDepthState = nullptr;
@@ -57,16 +91,50 @@ private:
   ID3D11Buffer* g_pGeomBufferInstVis = nullptr;
   ID3D11Buffer* g_pGeomBufferInstVisGpu = nullptr;
   ID3D11UnorderedAccessView* g_pGeomBufferInstVisGpu_UAV = nullptr;
+  // GPU culling state of each box kept between frames
+  ID3D11Buffer* g_pCullHistory = nullptr;
+  ID3D11UnorderedAccessView* g_pCullHistoryUAV = nullptr;
 
   std::vector<Texture> boxesTextures;
-  std::vector<BoxModel> boxesModelVector;
-  std::vector<int> boxesIndexies;
-
-  FrustumCulling frustum;
-  
-  int cubesDrawedOnGPU = MAX_CUBES;
+  float shines = 0.0f;
+
+  // Box vertices are stored quantized, decode params go to scene buffer
+  VertexQuantization boxQuantization = {};
+
+  // Loaded mesh replaces cube geometry, AABB is used for culling
+  MeshAsset mesh;
+  bool useMesh = false;
+  UINT indicesCount = 36;
+  // Depth passes draw whole mesh, meshlets are culled for main camera only
+  UINT fullIndicesCount = 36;
+
+  // Indices of meshlets visible for any cube, rebuilt every frame
+  ID3D11Buffer* g_pCulledIndexBuffer = nullptr;
+  std::vector<uint32_t> visibleMeshlets;
+  MeshletCullStats meshletStats;
+  XMFLOAT4 boxAABB[2] = { {-0.5f, -0.5f, -0.5f, 1.0f}, {0.5f, 0.5f, 0.5f, 1.0f} };
+
+  // Camera version scene buffer was written for
+  uint32_t sceneVersion = 0;
+
+  bool cullCoherence = true;
+
+  // All views are culled in one pass over box bounds, per view lists are kept till next frame
+  MultiViewCuller viewCuller;
+  std::vector<CullView> cullViews;
+  std::vector<uint32_t> viewInstances;
+  std::vector<uint32_t> viewOffsets;
+  // Cull params of this frame, in frame arena
+  const CullParams* frameCullParams = nullptr;
+  uint32_t frameBoxesCount = 0;
+  // Depth buffers hold lists of this frame
+  bool depthViewsUploaded = false;
+
+  int cubesDrawedOnGPU = 0;
 
   UINT curFrame = 0;
   UINT lastCompletedFrame = 0;
   ID3D11Query* queries[MAX_QUERY];
+  // Index count drawn per instance in frame of each query, meshlet culling changes it every frame
+  UINT queryIndicesCount[MAX_QUERY] = {};
 };
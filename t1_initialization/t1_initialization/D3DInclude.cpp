@@ -1,6 +1,23 @@
+#include <string>
+
 #include "D3DInclude.h"
+#include "assetArchive.h"
 
 HRESULT D3DInclude::Open(D3D_INCLUDE_TYPE includeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID* ppData, UINT* pBytes) {
+  AssetData asset;
+  if (SUCCEEDED(AssetArchive::GetInstance().Load(pFileName, asset))) {
+    if (asset.storage.empty()) {
+      // Pass mapped archive memory without copy
+      *ppData = asset.data;
+    } else {
+      char* buffer = new char[asset.size];
+      memcpy(buffer, asset.data, asset.size);
+      *ppData = buffer;
+    }
+    *pBytes = (UINT)asset.size;
+    return S_OK;
+  }
+
   FILE* pFile = nullptr;
   fopen_s(&pFile, pFileName, "rb");
   if (pFile == nullptr) {
@@ -22,6 +39,22 @@ HRESULT D3DInclude::Open(D3D_INCLUDE_TYPE includeType, LPCSTR pFileName, LPCVOID
 }
 
 HRESULT D3DInclude::Close(LPCVOID pData) {
-  free(const_cast<void*>(pData));
+  if (!AssetArchive::GetInstance().IsMapped(pData))
+    delete[] static_cast<const char*>(pData);
   return S_OK;
 }
+
+HRESULT CompileShaderFromAsset(LPCWSTR pFileName, const D3D_SHADER_MACRO* pDefines, ID3DInclude* pInclude,
+  LPCSTR pEntrypoint, LPCSTR pTarget, UINT Flags1, UINT Flags2, ID3DBlob** ppCode, ID3DBlob** ppErrorMsgs) {
+  AssetData asset;
+  if (FAILED(AssetArchive::GetInstance().Load(pFileName, asset)))
+    return D3DCompileFromFile(pFileName, pDefines, pInclude, pEntrypoint, pTarget, Flags1, Flags2, ppCode, ppErrorMsgs);
+
+  // Source name is used only in error messages
+  std::string sourceName;
+  for (const wchar_t* c = pFileName; *c; c++)
+    sourceName += (char)(*c < 0x80 ? *c : '?');
+
+  return D3DCompile(asset.data, asset.size, sourceName.c_str(), pDefines, pInclude, pEntrypoint, pTarget,
+    Flags1, Flags2, ppCode, ppErrorMsgs);
+}
@@ -13,3 +13,7 @@ public:
   HRESULT __stdcall Close(LPCVOID pData);
 
 };
+
+// Same as D3DCompileFromFile, but takes shader source from asset archive when it is there
+HRESULT CompileShaderFromAsset(LPCWSTR pFileName, const D3D_SHADER_MACRO* pDefines, ID3DInclude* pInclude,
+  LPCSTR pEntrypoint, LPCSTR pTarget, UINT Flags1, UINT Flags2, ID3DBlob** ppCode, ID3DBlob** ppErrorMsgs);
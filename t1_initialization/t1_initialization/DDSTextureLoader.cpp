@@ -21,8 +21,11 @@
 #include <assert.h>
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "DDSTextureLoader.h"
+#include "ddsParser.h"
+#include "mipGenerator.h"
 
 #if !defined(NO_D3D11_DEBUG_NAME) && ( defined(_DEBUG) || defined(PROFILE) )
 #pragma comment(lib,"dxguid.lib")
@@ -30,92 +33,6 @@
 
 using namespace DirectX;
 
-//--------------------------------------------------------------------------------------
-// Macros
-//--------------------------------------------------------------------------------------
-#ifndef MAKEFOURCC
-#define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
-                ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
-                ((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
-#endif /* defined(MAKEFOURCC) */
-
-//--------------------------------------------------------------------------------------
-// DDS file structure definitions
-//
-// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
-//--------------------------------------------------------------------------------------
-#pragma pack(push,1)
-
-const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
-
-struct DDS_PIXELFORMAT
-{
-  uint32_t    size;
-  uint32_t    flags;
-  uint32_t    fourCC;
-  uint32_t    RGBBitCount;
-  uint32_t    RBitMask;
-  uint32_t    GBitMask;
-  uint32_t    BBitMask;
-  uint32_t    ABitMask;
-};
-
-#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
-#define DDS_RGB         0x00000040  // DDPF_RGB
-#define DDS_LUMINANCE   0x00020000  // DDPF_LUMINANCE
-#define DDS_ALPHA       0x00000002  // DDPF_ALPHA
-
-#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
-
-#define DDS_HEIGHT 0x00000002 // DDSD_HEIGHT
-#define DDS_WIDTH  0x00000004 // DDSD_WIDTH
-
-#define DDS_CUBEMAP_POSITIVEX 0x00000600 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
-#define DDS_CUBEMAP_NEGATIVEX 0x00000a00 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
-#define DDS_CUBEMAP_POSITIVEY 0x00001200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
-#define DDS_CUBEMAP_NEGATIVEY 0x00002200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
-#define DDS_CUBEMAP_POSITIVEZ 0x00004200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
-#define DDS_CUBEMAP_NEGATIVEZ 0x00008200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
-
-#define DDS_CUBEMAP_ALLFACES ( DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX |\
-                               DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY |\
-                               DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ )
-
-#define DDS_CUBEMAP 0x00000200 // DDSCAPS2_CUBEMAP
-
-enum DDS_MISC_FLAGS2
-{
-  DDS_MISC_FLAGS2_ALPHA_MODE_MASK = 0x7L,
-};
-
-struct DDS_HEADER
-{
-  uint32_t        size;
-  uint32_t        flags;
-  uint32_t        height;
-  uint32_t        width;
-  uint32_t        pitchOrLinearSize;
-  uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
-  uint32_t        mipMapCount;
-  uint32_t        reserved1[11];
-  DDS_PIXELFORMAT ddspf;
-  uint32_t        caps;
-  uint32_t        caps2;
-  uint32_t        caps3;
-  uint32_t        caps4;
-  uint32_t        reserved2;
-};
-
-struct DDS_HEADER_DXT10
-{
-  DXGI_FORMAT     dxgiFormat;
-  uint32_t        resourceDimension;
-  uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
-  uint32_t        arraySize;
-  uint32_t        miscFlags2;
-};
-
-#pragma pack(pop)
 
 //--------------------------------------------------------------------------------------
 namespace
@@ -140,18 +57,28 @@ namespace
 
 };
 
+//--------------------------------------------------------------------------------------
+static HRESULT DDSParseResultToHRESULT(_In_ DDS_PARSE_RESULT result)
+{
+  switch (result)
+  {
+  case DDS_PARSE_OK:                    return S_OK;
+  case DDS_PARSE_BAD_HEADER:            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  case DDS_PARSE_UNSUPPORTED_FORMAT:
+  case DDS_PARSE_UNSUPPORTED_DIMENSION:
+  case DDS_PARSE_TOO_LARGE:             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+  case DDS_PARSE_TRUNCATED:             return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+  default:                              return E_FAIL;
+  }
+}
+
+
 //--------------------------------------------------------------------------------------
 static HRESULT LoadTextureDataFromFile(_In_z_ const wchar_t* fileName,
   std::unique_ptr<uint8_t[]>& ddsData,
-  DDS_HEADER** header,
-  uint8_t** bitData,
-  size_t* bitSize
+  DDSLayout& layout
 )
 {
-  if (!header || !bitData || !bitSize)
-  {
-    return E_POINTER;
-  }
 
   // open the file
 #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
@@ -225,566 +152,11 @@ static HRESULT LoadTextureDataFromFile(_In_z_ const wchar_t* fileName,
     return E_FAIL;
   }
 
-  // DDS files always start with the same magic number ("DDS ")
-  uint32_t dwMagicNumber = *(const uint32_t*)(ddsData.get());
-  if (dwMagicNumber != DDS_MAGIC)
-  {
-    return E_FAIL;
-  }
-
-  auto hdr = reinterpret_cast<DDS_HEADER*>(ddsData.get() + sizeof(uint32_t));
-
-  // Verify header to validate DDS file
-  if (hdr->size != sizeof(DDS_HEADER) ||
-    hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
-  {
-    return E_FAIL;
-  }
-
-  // Check for DX10 extension
-  bool bDXT10Header = false;
-  if ((hdr->ddspf.flags & DDS_FOURCC) &&
-    (MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC))
-  {
-    // Must be long enough for both headers and magic value
-    if (FileSize.LowPart < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
-    {
-      return E_FAIL;
-    }
-
-    bDXT10Header = true;
-  }
-
-  // setup the pointers in the process request
-  *header = hdr;
-  ptrdiff_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER)
-    + (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
-  *bitData = ddsData.get() + offset;
-  *bitSize = FileSize.LowPart - offset;
-
-  return S_OK;
+  // Header, limits and every surface size are validated by parser
+  return DDSParseResultToHRESULT(ParseDDS(ddsData.get(), FileSize.LowPart, layout));
 }
 
 
-//--------------------------------------------------------------------------------------
-// Return the BPP for a particular format
-//--------------------------------------------------------------------------------------
-static size_t BitsPerPixel(_In_ DXGI_FORMAT fmt)
-{
-  switch (fmt)
-  {
-  case DXGI_FORMAT_R32G32B32A32_TYPELESS:
-  case DXGI_FORMAT_R32G32B32A32_FLOAT:
-  case DXGI_FORMAT_R32G32B32A32_UINT:
-  case DXGI_FORMAT_R32G32B32A32_SINT:
-    return 128;
-
-  case DXGI_FORMAT_R32G32B32_TYPELESS:
-  case DXGI_FORMAT_R32G32B32_FLOAT:
-  case DXGI_FORMAT_R32G32B32_UINT:
-  case DXGI_FORMAT_R32G32B32_SINT:
-    return 96;
-
-  case DXGI_FORMAT_R16G16B16A16_TYPELESS:
-  case DXGI_FORMAT_R16G16B16A16_FLOAT:
-  case DXGI_FORMAT_R16G16B16A16_UNORM:
-  case DXGI_FORMAT_R16G16B16A16_UINT:
-  case DXGI_FORMAT_R16G16B16A16_SNORM:
-  case DXGI_FORMAT_R16G16B16A16_SINT:
-  case DXGI_FORMAT_R32G32_TYPELESS:
-  case DXGI_FORMAT_R32G32_FLOAT:
-  case DXGI_FORMAT_R32G32_UINT:
-  case DXGI_FORMAT_R32G32_SINT:
-  case DXGI_FORMAT_R32G8X24_TYPELESS:
-  case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
-  case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
-  case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
-  case DXGI_FORMAT_Y416:
-  case DXGI_FORMAT_Y210:
-  case DXGI_FORMAT_Y216:
-    return 64;
-
-  case DXGI_FORMAT_R10G10B10A2_TYPELESS:
-  case DXGI_FORMAT_R10G10B10A2_UNORM:
-  case DXGI_FORMAT_R10G10B10A2_UINT:
-  case DXGI_FORMAT_R11G11B10_FLOAT:
-  case DXGI_FORMAT_R8G8B8A8_TYPELESS:
-  case DXGI_FORMAT_R8G8B8A8_UNORM:
-  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-  case DXGI_FORMAT_R8G8B8A8_UINT:
-  case DXGI_FORMAT_R8G8B8A8_SNORM:
-  case DXGI_FORMAT_R8G8B8A8_SINT:
-  case DXGI_FORMAT_R16G16_TYPELESS:
-  case DXGI_FORMAT_R16G16_FLOAT:
-  case DXGI_FORMAT_R16G16_UNORM:
-  case DXGI_FORMAT_R16G16_UINT:
-  case DXGI_FORMAT_R16G16_SNORM:
-  case DXGI_FORMAT_R16G16_SINT:
-  case DXGI_FORMAT_R32_TYPELESS:
-  case DXGI_FORMAT_D32_FLOAT:
-  case DXGI_FORMAT_R32_FLOAT:
-  case DXGI_FORMAT_R32_UINT:
-  case DXGI_FORMAT_R32_SINT:
-  case DXGI_FORMAT_R24G8_TYPELESS:
-  case DXGI_FORMAT_D24_UNORM_S8_UINT:
-  case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
-  case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
-  case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
-  case DXGI_FORMAT_R8G8_B8G8_UNORM:
-  case DXGI_FORMAT_G8R8_G8B8_UNORM:
-  case DXGI_FORMAT_B8G8R8A8_UNORM:
-  case DXGI_FORMAT_B8G8R8X8_UNORM:
-  case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
-  case DXGI_FORMAT_B8G8R8A8_TYPELESS:
-  case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-  case DXGI_FORMAT_B8G8R8X8_TYPELESS:
-  case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-  case DXGI_FORMAT_AYUV:
-  case DXGI_FORMAT_Y410:
-  case DXGI_FORMAT_YUY2:
-    return 32;
-
-  case DXGI_FORMAT_P010:
-  case DXGI_FORMAT_P016:
-    return 24;
-
-  case DXGI_FORMAT_R8G8_TYPELESS:
-  case DXGI_FORMAT_R8G8_UNORM:
-  case DXGI_FORMAT_R8G8_UINT:
-  case DXGI_FORMAT_R8G8_SNORM:
-  case DXGI_FORMAT_R8G8_SINT:
-  case DXGI_FORMAT_R16_TYPELESS:
-  case DXGI_FORMAT_R16_FLOAT:
-  case DXGI_FORMAT_D16_UNORM:
-  case DXGI_FORMAT_R16_UNORM:
-  case DXGI_FORMAT_R16_UINT:
-  case DXGI_FORMAT_R16_SNORM:
-  case DXGI_FORMAT_R16_SINT:
-  case DXGI_FORMAT_B5G6R5_UNORM:
-  case DXGI_FORMAT_B5G5R5A1_UNORM:
-  case DXGI_FORMAT_A8P8:
-  case DXGI_FORMAT_B4G4R4A4_UNORM:
-    return 16;
-
-  case DXGI_FORMAT_NV12:
-  case DXGI_FORMAT_420_OPAQUE:
-  case DXGI_FORMAT_NV11:
-    return 12;
-
-  case DXGI_FORMAT_R8_TYPELESS:
-  case DXGI_FORMAT_R8_UNORM:
-  case DXGI_FORMAT_R8_UINT:
-  case DXGI_FORMAT_R8_SNORM:
-  case DXGI_FORMAT_R8_SINT:
-  case DXGI_FORMAT_A8_UNORM:
-  case DXGI_FORMAT_AI44:
-  case DXGI_FORMAT_IA44:
-  case DXGI_FORMAT_P8:
-    return 8;
-
-  case DXGI_FORMAT_R1_UNORM:
-    return 1;
-
-  case DXGI_FORMAT_BC1_TYPELESS:
-  case DXGI_FORMAT_BC1_UNORM:
-  case DXGI_FORMAT_BC1_UNORM_SRGB:
-  case DXGI_FORMAT_BC4_TYPELESS:
-  case DXGI_FORMAT_BC4_UNORM:
-  case DXGI_FORMAT_BC4_SNORM:
-    return 4;
-
-  case DXGI_FORMAT_BC2_TYPELESS:
-  case DXGI_FORMAT_BC2_UNORM:
-  case DXGI_FORMAT_BC2_UNORM_SRGB:
-  case DXGI_FORMAT_BC3_TYPELESS:
-  case DXGI_FORMAT_BC3_UNORM:
-  case DXGI_FORMAT_BC3_UNORM_SRGB:
-  case DXGI_FORMAT_BC5_TYPELESS:
-  case DXGI_FORMAT_BC5_UNORM:
-  case DXGI_FORMAT_BC5_SNORM:
-  case DXGI_FORMAT_BC6H_TYPELESS:
-  case DXGI_FORMAT_BC6H_UF16:
-  case DXGI_FORMAT_BC6H_SF16:
-  case DXGI_FORMAT_BC7_TYPELESS:
-  case DXGI_FORMAT_BC7_UNORM:
-  case DXGI_FORMAT_BC7_UNORM_SRGB:
-    return 8;
-
-#if defined(_XBOX_ONE) && defined(_TITLE)
-
-  case DXGI_FORMAT_R10G10B10_7E3_A2_FLOAT:
-  case DXGI_FORMAT_R10G10B10_6E4_A2_FLOAT:
-    return 32;
-
-  case DXGI_FORMAT_D16_UNORM_S8_UINT:
-  case DXGI_FORMAT_R16_UNORM_X8_TYPELESS:
-  case DXGI_FORMAT_X16_TYPELESS_G8_UINT:
-    return 24;
-
-#endif // _XBOX_ONE && _TITLE
-
-  default:
-    return 0;
-  }
-}
-
-
-//--------------------------------------------------------------------------------------
-// Get surface information for a particular format
-//--------------------------------------------------------------------------------------
-static void GetSurfaceInfo(_In_ size_t width,
-  _In_ size_t height,
-  _In_ DXGI_FORMAT fmt,
-  _Out_opt_ size_t* outNumBytes,
-  _Out_opt_ size_t* outRowBytes,
-  _Out_opt_ size_t* outNumRows)
-{
-  size_t numBytes = 0;
-  size_t rowBytes = 0;
-  size_t numRows = 0;
-
-  bool bc = false;
-  bool packed = false;
-  bool planar = false;
-  size_t bpe = 0;
-  switch (fmt)
-  {
-  case DXGI_FORMAT_BC1_TYPELESS:
-  case DXGI_FORMAT_BC1_UNORM:
-  case DXGI_FORMAT_BC1_UNORM_SRGB:
-  case DXGI_FORMAT_BC4_TYPELESS:
-  case DXGI_FORMAT_BC4_UNORM:
-  case DXGI_FORMAT_BC4_SNORM:
-    bc = true;
-    bpe = 8;
-    break;
-
-  case DXGI_FORMAT_BC2_TYPELESS:
-  case DXGI_FORMAT_BC2_UNORM:
-  case DXGI_FORMAT_BC2_UNORM_SRGB:
-  case DXGI_FORMAT_BC3_TYPELESS:
-  case DXGI_FORMAT_BC3_UNORM:
-  case DXGI_FORMAT_BC3_UNORM_SRGB:
-  case DXGI_FORMAT_BC5_TYPELESS:
-  case DXGI_FORMAT_BC5_UNORM:
-  case DXGI_FORMAT_BC5_SNORM:
-  case DXGI_FORMAT_BC6H_TYPELESS:
-  case DXGI_FORMAT_BC6H_UF16:
-  case DXGI_FORMAT_BC6H_SF16:
-  case DXGI_FORMAT_BC7_TYPELESS:
-  case DXGI_FORMAT_BC7_UNORM:
-  case DXGI_FORMAT_BC7_UNORM_SRGB:
-    bc = true;
-    bpe = 16;
-    break;
-
-  case DXGI_FORMAT_R8G8_B8G8_UNORM:
-  case DXGI_FORMAT_G8R8_G8B8_UNORM:
-  case DXGI_FORMAT_YUY2:
-    packed = true;
-    bpe = 4;
-    break;
-
-  case DXGI_FORMAT_Y210:
-  case DXGI_FORMAT_Y216:
-    packed = true;
-    bpe = 8;
-    break;
-
-  case DXGI_FORMAT_NV12:
-  case DXGI_FORMAT_420_OPAQUE:
-    planar = true;
-    bpe = 2;
-    break;
-
-  case DXGI_FORMAT_P010:
-  case DXGI_FORMAT_P016:
-    planar = true;
-    bpe = 4;
-    break;
-
-#if defined(_XBOX_ONE) && defined(_TITLE)
-
-  case DXGI_FORMAT_D16_UNORM_S8_UINT:
-  case DXGI_FORMAT_R16_UNORM_X8_TYPELESS:
-  case DXGI_FORMAT_X16_TYPELESS_G8_UINT:
-    planar = true;
-    bpe = 4;
-    break;
-
-#endif
-  }
-
-  if (bc)
-  {
-    size_t numBlocksWide = 0;
-    if (width > 0)
-    {
-      numBlocksWide = std::max<size_t>(1, (width + 3) / 4);
-    }
-    size_t numBlocksHigh = 0;
-    if (height > 0)
-    {
-      numBlocksHigh = std::max<size_t>(1, (height + 3) / 4);
-    }
-    rowBytes = numBlocksWide * bpe;
-    numRows = numBlocksHigh;
-    numBytes = rowBytes * numBlocksHigh;
-  }
-  else if (packed)
-  {
-    rowBytes = ((width + 1) >> 1) * bpe;
-    numRows = height;
-    numBytes = rowBytes * height;
-  }
-  else if (fmt == DXGI_FORMAT_NV11)
-  {
-    rowBytes = ((width + 3) >> 2) * 4;
-    numRows = height * 2; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
-    numBytes = rowBytes * numRows;
-  }
-  else if (planar)
-  {
-    rowBytes = ((width + 1) >> 1) * bpe;
-    numBytes = (rowBytes * height) + ((rowBytes * height + 1) >> 1);
-    numRows = height + ((height + 1) >> 1);
-  }
-  else
-  {
-    size_t bpp = BitsPerPixel(fmt);
-    rowBytes = (width * bpp + 7) / 8; // round up to nearest byte
-    numRows = height;
-    numBytes = rowBytes * height;
-  }
-
-  if (outNumBytes)
-  {
-    *outNumBytes = numBytes;
-  }
-  if (outRowBytes)
-  {
-    *outRowBytes = rowBytes;
-  }
-  if (outNumRows)
-  {
-    *outNumRows = numRows;
-  }
-}
-
-
-//--------------------------------------------------------------------------------------
-#define ISBITMASK( r,g,b,a ) ( ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a )
-
-static DXGI_FORMAT GetDXGIFormat(const DDS_PIXELFORMAT& ddpf)
-{
-  if (ddpf.flags & DDS_RGB)
-  {
-    // Note that sRGB formats are written using the "DX10" extended header
-
-    switch (ddpf.RGBBitCount)
-    {
-    case 32:
-      if (ISBITMASK(0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
-      {
-        return DXGI_FORMAT_R8G8B8A8_UNORM;
-      }
-
-      if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
-      {
-        return DXGI_FORMAT_B8G8R8A8_UNORM;
-      }
-
-      if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000))
-      {
-        return DXGI_FORMAT_B8G8R8X8_UNORM;
-      }
-
-      // No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0x00000000) aka D3DFMT_X8B8G8R8
-
-      // Note that many common DDS reader/writers (including D3DX) swap the
-      // the RED/BLUE masks for 10:10:10:2 formats. We assumme
-      // below that the 'backwards' header mask is being used since it is most
-      // likely written by D3DX. The more robust solution is to use the 'DX10'
-      // header extension and specify the DXGI_FORMAT_R10G10B10A2_UNORM format directly
-
-      // For 'correct' writers, this should be 0x000003ff,0x000ffc00,0x3ff00000 for RGB data
-      if (ISBITMASK(0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
-      {
-        return DXGI_FORMAT_R10G10B10A2_UNORM;
-      }
-
-      // No DXGI format maps to ISBITMASK(0x000003ff,0x000ffc00,0x3ff00000,0xc0000000) aka D3DFMT_A2R10G10B10
-
-      if (ISBITMASK(0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
-      {
-        return DXGI_FORMAT_R16G16_UNORM;
-      }
-
-      if (ISBITMASK(0xffffffff, 0x00000000, 0x00000000, 0x00000000))
-      {
-        // Only 32-bit color channel format in D3D9 was R32F
-        return DXGI_FORMAT_R32_FLOAT; // D3DX writes this out as a FourCC of 114
-      }
-      break;
-
-    case 24:
-      // No 24bpp DXGI formats aka D3DFMT_R8G8B8
-      break;
-
-    case 16:
-      if (ISBITMASK(0x7c00, 0x03e0, 0x001f, 0x8000))
-      {
-        return DXGI_FORMAT_B5G5R5A1_UNORM;
-      }
-      if (ISBITMASK(0xf800, 0x07e0, 0x001f, 0x0000))
-      {
-        return DXGI_FORMAT_B5G6R5_UNORM;
-      }
-
-      // No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0x0000) aka D3DFMT_X1R5G5B5
-
-      if (ISBITMASK(0x0f00, 0x00f0, 0x000f, 0xf000))
-      {
-        return DXGI_FORMAT_B4G4R4A4_UNORM;
-      }
-
-      // No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0x0000) aka D3DFMT_X4R4G4B4
-
-      // No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2, D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
-      break;
-    }
-  }
-  else if (ddpf.flags & DDS_LUMINANCE)
-  {
-    if (8 == ddpf.RGBBitCount)
-    {
-      if (ISBITMASK(0x000000ff, 0x00000000, 0x00000000, 0x00000000))
-      {
-        return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10 extension
-      }
-
-      // No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
-    }
-
-    if (16 == ddpf.RGBBitCount)
-    {
-      if (ISBITMASK(0x0000ffff, 0x00000000, 0x00000000, 0x00000000))
-      {
-        return DXGI_FORMAT_R16_UNORM; // D3DX10/11 writes this out as DX10 extension
-      }
-      if (ISBITMASK(0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
-      {
-        return DXGI_FORMAT_R8G8_UNORM; // D3DX10/11 writes this out as DX10 extension
-      }
-    }
-  }
-  else if (ddpf.flags & DDS_ALPHA)
-  {
-    if (8 == ddpf.RGBBitCount)
-    {
-      return DXGI_FORMAT_A8_UNORM;
-    }
-  }
-  else if (ddpf.flags & DDS_FOURCC)
-  {
-    if (MAKEFOURCC('D', 'X', 'T', '1') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC1_UNORM;
-    }
-    if (MAKEFOURCC('D', 'X', 'T', '3') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC2_UNORM;
-    }
-    if (MAKEFOURCC('D', 'X', 'T', '5') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC3_UNORM;
-    }
-
-    // While pre-mulitplied alpha isn't directly supported by the DXGI formats,
-    // they are basically the same as these BC formats so they can be mapped
-    if (MAKEFOURCC('D', 'X', 'T', '2') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC2_UNORM;
-    }
-    if (MAKEFOURCC('D', 'X', 'T', '4') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC3_UNORM;
-    }
-
-    if (MAKEFOURCC('A', 'T', 'I', '1') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC4_UNORM;
-    }
-    if (MAKEFOURCC('B', 'C', '4', 'U') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC4_UNORM;
-    }
-    if (MAKEFOURCC('B', 'C', '4', 'S') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC4_SNORM;
-    }
-
-    if (MAKEFOURCC('A', 'T', 'I', '2') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC5_UNORM;
-    }
-    if (MAKEFOURCC('B', 'C', '5', 'U') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC5_UNORM;
-    }
-    if (MAKEFOURCC('B', 'C', '5', 'S') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_BC5_SNORM;
-    }
-
-    // BC6H and BC7 are written using the "DX10" extended header
-
-    if (MAKEFOURCC('R', 'G', 'B', 'G') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_R8G8_B8G8_UNORM;
-    }
-    if (MAKEFOURCC('G', 'R', 'G', 'B') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_G8R8_G8B8_UNORM;
-    }
-
-    if (MAKEFOURCC('Y', 'U', 'Y', '2') == ddpf.fourCC)
-    {
-      return DXGI_FORMAT_YUY2;
-    }
-
-    // Check for D3DFORMAT enums being set here
-    switch (ddpf.fourCC)
-    {
-    case 36: // D3DFMT_A16B16G16R16
-      return DXGI_FORMAT_R16G16B16A16_UNORM;
-
-    case 110: // D3DFMT_Q16W16V16U16
-      return DXGI_FORMAT_R16G16B16A16_SNORM;
-
-    case 111: // D3DFMT_R16F
-      return DXGI_FORMAT_R16_FLOAT;
-
-    case 112: // D3DFMT_G16R16F
-      return DXGI_FORMAT_R16G16_FLOAT;
-
-    case 113: // D3DFMT_A16B16G16R16F
-      return DXGI_FORMAT_R16G16B16A16_FLOAT;
-
-    case 114: // D3DFMT_R32F
-      return DXGI_FORMAT_R32_FLOAT;
-
-    case 115: // D3DFMT_G32R32F
-      return DXGI_FORMAT_R32G32_FLOAT;
-
-    case 116: // D3DFMT_A32B32G32R32F
-      return DXGI_FORMAT_R32G32B32A32_FLOAT;
-    }
-  }
-
-  return DXGI_FORMAT_UNKNOWN;
-}
-
 
 //--------------------------------------------------------------------------------------
 static DXGI_FORMAT MakeSRGB(_In_ DXGI_FORMAT format)
@@ -819,15 +191,11 @@ static DXGI_FORMAT MakeSRGB(_In_ DXGI_FORMAT format)
 
 
 //--------------------------------------------------------------------------------------
-static HRESULT FillInitData(_In_ size_t width,
-  _In_ size_t height,
-  _In_ size_t depth,
-  _In_ size_t mipCount,
+static HRESULT FillInitData(_In_ size_t mipCount,
   _In_ size_t arraySize,
-  _In_ DXGI_FORMAT format,
   _In_ size_t maxsize,
-  _In_ size_t bitSize,
-  _In_reads_bytes_(bitSize) const uint8_t* bitData,
+  _In_ const uint8_t* bitData,
+  _In_ const std::vector<DDSSubresource>& subresources,
   _Out_ size_t& twidth,
   _Out_ size_t& theight,
   _Out_ size_t& tdepth,
@@ -839,46 +207,37 @@ static HRESULT FillInitData(_In_ size_t width,
     return E_POINTER;
   }
 
+  if (subresources.size() != mipCount * arraySize)
+  {
+    return E_UNEXPECTED;
+  }
+
   skipMip = 0;
   twidth = 0;
   theight = 0;
   tdepth = 0;
 
-  size_t NumBytes = 0;
-  size_t RowBytes = 0;
-  const uint8_t* pSrcBits = bitData;
-  const uint8_t* pEndBits = bitData + bitSize;
-
+  // Offsets and pitches were computed and checked against payload when the table was built
   size_t index = 0;
   for (size_t j = 0; j < arraySize; j++)
   {
-    size_t w = width;
-    size_t h = height;
-    size_t d = depth;
     for (size_t i = 0; i < mipCount; i++)
     {
-      GetSurfaceInfo(w,
-        h,
-        format,
-        &NumBytes,
-        &RowBytes,
-        nullptr
-      );
-
-      if ((mipCount <= 1) || !maxsize || (w <= maxsize && h <= maxsize && d <= maxsize))
+      const DDSSubresource& sub = subresources[j * mipCount + i];
+      if ((mipCount <= 1) || !maxsize || (sub.width <= maxsize && sub.height <= maxsize && sub.depth <= maxsize))
       {
         if (!twidth)
         {
-          twidth = w;
-          theight = h;
-          tdepth = d;
+          twidth = sub.width;
+          theight = sub.height;
+          tdepth = sub.depth;
         }
 
         assert(index < mipCount* arraySize);
         _Analysis_assume_(index < mipCount* arraySize);
-        initData[index].pSysMem = (const void*)pSrcBits;
-        initData[index].SysMemPitch = static_cast<UINT>(RowBytes);
-        initData[index].SysMemSlicePitch = static_cast<UINT>(NumBytes);
+        initData[index].pSysMem = (const void*)(bitData + sub.offset);
+        initData[index].SysMemPitch = static_cast<UINT>(sub.rowPitch);
+        initData[index].SysMemSlicePitch = static_cast<UINT>(sub.slicePitch);
         ++index;
       }
       else if (!j)
@@ -886,29 +245,6 @@ static HRESULT FillInitData(_In_ size_t width,
         // Count number of skipped mipmaps (first item only)
         ++skipMip;
       }
-
-      if (pSrcBits + (NumBytes * d) > pEndBits)
-      {
-        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-      }
-
-      pSrcBits += NumBytes * d;
-
-      w = w >> 1;
-      h = h >> 1;
-      d = d >> 1;
-      if (w == 0)
-      {
-        w = 1;
-      }
-      if (h == 0)
-      {
-        h = 1;
-      }
-      if (d == 0)
-      {
-        d = 1;
-      }
     }
   }
 
@@ -1154,183 +490,99 @@ static HRESULT CreateD3DResources(_In_ ID3D11Device* d3dDevice,
 
 
 //--------------------------------------------------------------------------------------
-static HRESULT CreateTextureFromDDS(_In_ ID3D11Device* d3dDevice,
-  _In_opt_ ID3D11DeviceContext* d3dContext,
-  _In_ const DDS_HEADER* header,
-  _In_reads_bytes_(bitSize) const uint8_t* bitData,
-  _In_ size_t bitSize,
-  _In_ size_t maxsize,
-  _In_ D3D11_USAGE usage,
-  _In_ unsigned int bindFlags,
-  _In_ unsigned int cpuAccessFlags,
-  _In_ unsigned int miscFlags,
+// Build full mip chain on CPU for 2D textures stored without mips.
+// Output keeps DDS layout (all mips of item 0, then item 1, ...) and gets its own subresource table for FillInitData.
+static HRESULT GenerateMipChain(_In_ size_t width,
+  _In_ size_t height,
+  _In_ size_t arraySize,
+  _In_ DXGI_FORMAT format,
   _In_ bool forceSRGB,
-  _Outptr_opt_ ID3D11Resource** texture,
-  _Outptr_opt_ ID3D11ShaderResourceView** textureView)
+  _In_ size_t bitSize,
+  _In_reads_bytes_(bitSize) const uint8_t* bitData,
+  _Out_ size_t& mipCount,
+  std::vector<uint8_t>& chain,
+  std::vector<DDSSubresource>& subresources)
 {
-  HRESULT hr = S_OK;
-
-  size_t width = header->width;
-  size_t height = header->height;
-  size_t depth = header->depth;
-
-  uint32_t resDim = D3D11_RESOURCE_DIMENSION_UNKNOWN;
-  size_t arraySize = 1;
-  DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-  bool isCubeMap = false;
+  mipCount = MipGenerator::CountMips(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
 
-  size_t mipCount = header->mipMapCount;
-  if (0 == mipCount)
+  size_t numBytes = 0;
+  size_t rowBytes = 0;
+  DDSGetSurfaceInfo(width, height, format, &numBytes, &rowBytes, nullptr);
+  if (numBytes * arraySize > bitSize)
   {
-    mipCount = 1;
+    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
   }
 
-  if ((header->ddspf.flags & DDS_FOURCC) &&
-    (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+  std::vector<MipLevel> mips;
+  subresources.clear();
+  subresources.reserve(mipCount * arraySize);
+  const uint8_t* pSrcBits = bitData;
+  for (size_t item = 0; item < arraySize; ++item)
   {
-    auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>((const char*)header + sizeof(DDS_HEADER));
-
-    arraySize = d3d10ext->arraySize;
-    if (arraySize == 0)
+    if (!MipGenerator::Generate(pSrcBits, static_cast<uint32_t>(width), static_cast<uint32_t>(height), rowBytes,
+      format, MIP_FILTER_KAISER, forceSRGB, static_cast<uint32_t>(mipCount), mips))
     {
-      return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-    }
-
-    switch (d3d10ext->dxgiFormat)
-    {
-    case DXGI_FORMAT_AI44:
-    case DXGI_FORMAT_IA44:
-    case DXGI_FORMAT_P8:
-    case DXGI_FORMAT_A8P8:
-      return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-
-    default:
-      if (BitsPerPixel(d3d10ext->dxgiFormat) == 0)
-      {
-        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-      }
+      return E_FAIL;
     }
 
-    format = d3d10ext->dxgiFormat;
-
-    switch (d3d10ext->resourceDimension)
+    subresources.push_back({ chain.size(), rowBytes, numBytes, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1 });
+    chain.insert(chain.end(), pSrcBits, pSrcBits + numBytes);
+    for (auto& mip : mips)
     {
-    case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
-      // D3DX writes 1D textures with a fixed Height of 1
-      if ((header->flags & DDS_HEIGHT) && height != 1)
-      {
-        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-      }
-      height = depth = 1;
-      break;
-
-    case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
-      if (d3d10ext->miscFlag & D3D11_RESOURCE_MISC_TEXTURECUBE)
-      {
-        arraySize *= 6;
-        isCubeMap = true;
-      }
-      depth = 1;
-      break;
-
-    case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
-      if (!(header->flags & DDS_HEADER_FLAGS_VOLUME))
-      {
-        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-      }
-
-      if (arraySize > 1)
-      {
-        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-      }
-      break;
-
-    default:
-      return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+      subresources.push_back({ chain.size(), mip.rowPitch, mip.slicePitch, mip.width, mip.height, 1 });
+      chain.insert(chain.end(), mip.data.begin(), mip.data.end());
     }
-
-    resDim = d3d10ext->resourceDimension;
+    pSrcBits += numBytes;
   }
-  else
-  {
-    format = GetDXGIFormat(header->ddspf);
 
-    if (format == DXGI_FORMAT_UNKNOWN)
-    {
-      return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-    }
-
-    if (header->flags & DDS_HEADER_FLAGS_VOLUME)
-    {
-      resDim = D3D11_RESOURCE_DIMENSION_TEXTURE3D;
-    }
-    else
-    {
-      if (header->caps2 & DDS_CUBEMAP)
-      {
-        // We require all six faces to be defined
-        if ((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
-        {
-          return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
-
-        arraySize = 6;
-        isCubeMap = true;
-      }
-
-      depth = 1;
-      resDim = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
-
-      // Note there's no way for a legacy Direct3D 9 DDS to express a '1D' texture
-    }
+  return S_OK;
+}
 
-    assert(BitsPerPixel(format) != 0);
-  }
 
-  // Bound sizes (for security purposes we don't trust DDS file metadata larger than the D3D 11.x hardware requirements)
-  if (mipCount > D3D11_REQ_MIP_LEVELS)
-  {
-    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-  }
+//--------------------------------------------------------------------------------------
+static HRESULT CreateTextureFromDDS(_In_ ID3D11Device* d3dDevice,
+  _In_opt_ ID3D11DeviceContext* d3dContext,
+  _In_ const DDSLayout& layout,
+  _In_ size_t maxsize,
+  _In_ D3D11_USAGE usage,
+  _In_ unsigned int bindFlags,
+  _In_ unsigned int cpuAccessFlags,
+  _In_ unsigned int miscFlags,
+  _In_ bool forceSRGB,
+  _Outptr_opt_ ID3D11Resource** texture,
+  _Outptr_opt_ ID3D11ShaderResourceView** textureView)
+{
+  HRESULT hr = S_OK;
 
-  switch (resDim)
+  // Layout is already validated by ParseDDS
+  size_t width = layout.width;
+  size_t height = layout.height;
+  size_t depth = layout.depth;
+  size_t mipCount = layout.mipCount;
+  size_t arraySize = layout.arraySize;
+  DXGI_FORMAT format = layout.format;
+  bool isCubeMap = layout.isCubeMap;
+  const uint8_t* bitData = layout.bitData;
+  size_t bitSize = layout.bitSize;
+
+  // DDS dimension values match D3D11_RESOURCE_DIMENSION ones
+  uint32_t resDim = static_cast<uint32_t>(layout.dimension);
+
+  // Uncompressed 2D textures get mips on CPU, this does not need device context and gives better filtering
+  const std::vector<DDSSubresource>* subresources = &layout.subresources;
+  std::vector<uint8_t> mipChain;
+  std::vector<DDSSubresource> mipChainSubresources;
+  if (mipCount == 1 && resDim == D3D11_RESOURCE_DIMENSION_TEXTURE2D && MipGenerator::IsFormatSupported(format))
   {
-  case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
-    if ((arraySize > D3D11_REQ_TEXTURE1D_ARRAY_AXIS_DIMENSION) ||
-      (width > D3D11_REQ_TEXTURE1D_U_DIMENSION))
+    hr = GenerateMipChain(width, height, arraySize, format, forceSRGB, bitSize, bitData, mipCount, mipChain, mipChainSubresources);
+    if (FAILED(hr))
     {
-      return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+      return hr;
     }
-    break;
 
-  case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
-    if (isCubeMap)
-    {
-      // This is the right bound because we set arraySize to (NumCubes*6) above
-      if ((arraySize > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
-        (width > D3D11_REQ_TEXTURECUBE_DIMENSION) ||
-        (height > D3D11_REQ_TEXTURECUBE_DIMENSION))
-      {
-        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-      }
-    }
-    else if ((arraySize > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
-      (width > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION) ||
-      (height > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION))
-    {
-      return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-    }
-    break;
-
-  case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
-    if ((arraySize > 1) ||
-      (width > D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
-      (height > D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
-      (depth > D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION))
-    {
-      return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-    }
-    break;
+    bitData = mipChain.data();
+    bitSize = mipChain.size();
+    subresources = &mipChainSubresources;
   }
 
   bool autogen = false;
@@ -1364,7 +616,7 @@ static HRESULT CreateTextureFromDDS(_In_ ID3D11Device* d3dDevice,
     {
       size_t numBytes = 0;
       size_t rowBytes = 0;
-      GetSurfaceInfo(width, height, format, &numBytes, &rowBytes, nullptr);
+      DDSGetSurfaceInfo(width, height, format, &numBytes, &rowBytes, nullptr);
 
       if (numBytes > bitSize)
       {
@@ -1443,7 +695,7 @@ static HRESULT CreateTextureFromDDS(_In_ ID3D11Device* d3dDevice,
     size_t twidth = 0;
     size_t theight = 0;
     size_t tdepth = 0;
-    hr = FillInitData(width, height, depth, mipCount, arraySize, format, maxsize, bitSize, bitData,
+    hr = FillInitData(mipCount, arraySize, maxsize, bitData, *subresources,
       twidth, theight, tdepth, skipMip, initData.get());
 
     if (SUCCEEDED(hr))
@@ -1484,7 +736,7 @@ static HRESULT CreateTextureFromDDS(_In_ ID3D11Device* d3dDevice,
           break;
         }
 
-        hr = FillInitData(width, height, depth, mipCount, arraySize, format, maxsize, bitSize, bitData,
+        hr = FillInitData(mipCount, arraySize, maxsize, bitData, *subresources,
           twidth, theight, tdepth, skipMip, initData.get());
         if (SUCCEEDED(hr))
         {
@@ -1612,46 +864,14 @@ HRESULT DirectX::CreateDDSTextureFromMemoryEx(ID3D11Device* d3dDevice,
   }
 
   // Validate DDS file in memory
-  if (ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
-  {
-    return E_FAIL;
-  }
-
-  uint32_t dwMagicNumber = *(const uint32_t*)(ddsData);
-  if (dwMagicNumber != DDS_MAGIC)
-  {
-    return E_FAIL;
-  }
-
-  auto header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
-
-  // Verify header to validate DDS file
-  if (header->size != sizeof(DDS_HEADER) ||
-    header->ddspf.size != sizeof(DDS_PIXELFORMAT))
-  {
-    return E_FAIL;
-  }
-
-  // Check for DX10 extension
-  bool bDXT10Header = false;
-  if ((header->ddspf.flags & DDS_FOURCC) &&
-    (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+  DDSLayout layout;
+  HRESULT hr = DDSParseResultToHRESULT(ParseDDS(ddsData, ddsDataSize, layout));
+  if (FAILED(hr))
   {
-    // Must be long enough for both headers and magic value
-    if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
-    {
-      return E_FAIL;
-    }
-
-    bDXT10Header = true;
+    return hr;
   }
 
-  ptrdiff_t offset = sizeof(uint32_t)
-    + sizeof(DDS_HEADER)
-    + (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
-
-  HRESULT hr = CreateTextureFromDDS(d3dDevice, d3dContext, header,
-    ddsData + offset, ddsDataSize - offset, maxsize,
+  hr = CreateTextureFromDDS(d3dDevice, d3dContext, layout, maxsize,
     usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
     texture, textureView);
   if (SUCCEEDED(hr))
@@ -1667,7 +887,7 @@ HRESULT DirectX::CreateDDSTextureFromMemoryEx(ID3D11Device* d3dDevice,
     }
 
     if (alphaMode)
-      *alphaMode = GetAlphaMode(header);
+      *alphaMode = GetAlphaMode(layout.header);
   }
 
   return hr;
@@ -1751,24 +971,18 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(ID3D11Device* d3dDevice,
     return E_INVALIDARG;
   }
 
-  DDS_HEADER* header = nullptr;
-  uint8_t* bitData = nullptr;
-  size_t bitSize = 0;
-
+  DDSLayout layout;
   std::unique_ptr<uint8_t[]> ddsData;
   HRESULT hr = LoadTextureDataFromFile(fileName,
     ddsData,
-    &header,
-    &bitData,
-    &bitSize
+    layout
   );
   if (FAILED(hr))
   {
     return hr;
   }
 
-  hr = CreateTextureFromDDS(d3dDevice, d3dContext, header,
-    bitData, bitSize, maxsize,
+  hr = CreateTextureFromDDS(d3dDevice, d3dContext, layout, maxsize,
     usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
     texture, textureView);
 
@@ -1819,7 +1033,7 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(ID3D11Device* d3dDevice,
 #endif
 
     if (alphaMode)
-      *alphaMode = GetAlphaMode(header);
+      *alphaMode = GetAlphaMode(layout.header);
   }
 
   return hr;
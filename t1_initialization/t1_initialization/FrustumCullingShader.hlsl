@@ -9,20 +9,28 @@ cbuffer CullParams : register(b0)
 
 RWStructuredBuffer<uint> indirectArgs : register(u0);
 RWStructuredBuffer<uint4> objectsIds : register(u1);
+// Per instance state kept between frames: plane that rejected it last time
+RWStructuredBuffer<uint> cullHistory : register(u2);
 
-bool IsBoxInside(in float4 planes[6], in float3 bbMin, in float3 bbMax) {
-  for (int i = 0; i < 6; i++) {
-    if ((planes[i].x * bbMin.x) + (planes[i].y * bbMin.y) + (planes[i].z * bbMin.z) + (planes[i].w * 1.0f) >= 0.0f ||
-        (planes[i].x * bbMax.x) + (planes[i].y * bbMin.y) + (planes[i].z * bbMin.z) + (planes[i].w * 1.0f) >= 0.0f ||
-        (planes[i].x * bbMin.x) + (planes[i].y * bbMin.y) + (planes[i].z * bbMin.z) + (planes[i].w * 1.0f) >= 0.0f ||
-        (planes[i].x * bbMax.x) + (planes[i].y * bbMax.y) + (planes[i].z * bbMin.z) + (planes[i].w * 1.0f) >= 0.0f ||
-        (planes[i].x * bbMin.x) + (planes[i].y * bbMin.y) + (planes[i].z * bbMax.z) + (planes[i].w * 1.0f) >= 0.0f ||
-        (planes[i].x * bbMax.x) + (planes[i].y * bbMin.y) + (planes[i].z * bbMax.z) + (planes[i].w * 1.0f) >= 0.0f ||
-        (planes[i].x * bbMin.x) + (planes[i].y * bbMax.y) + (planes[i].z * bbMax.z) + (planes[i].w * 1.0f) >= 0.0f ||
-        (planes[i].x * bbMax.x) + (planes[i].y * bbMax.y) + (planes[i].z * bbMax.z) + (planes[i].w * 1.0f) >= 0.0f)
-      continue;
-    else
+bool IsOutside(in float4 plane, in float3 bbMin, in float3 bbMax) {
+  return !((plane.x * bbMin.x) + (plane.y * bbMin.y) + (plane.z * bbMin.z) + (plane.w * 1.0f) >= 0.0f ||
+           (plane.x * bbMax.x) + (plane.y * bbMin.y) + (plane.z * bbMin.z) + (plane.w * 1.0f) >= 0.0f ||
+           (plane.x * bbMin.x) + (plane.y * bbMax.y) + (plane.z * bbMin.z) + (plane.w * 1.0f) >= 0.0f ||
+           (plane.x * bbMax.x) + (plane.y * bbMax.y) + (plane.z * bbMin.z) + (plane.w * 1.0f) >= 0.0f ||
+           (plane.x * bbMin.x) + (plane.y * bbMin.y) + (plane.z * bbMax.z) + (plane.w * 1.0f) >= 0.0f ||
+           (plane.x * bbMax.x) + (plane.y * bbMin.y) + (plane.z * bbMax.z) + (plane.w * 1.0f) >= 0.0f ||
+           (plane.x * bbMin.x) + (plane.y * bbMax.y) + (plane.z * bbMax.z) + (plane.w * 1.0f) >= 0.0f ||
+           (plane.x * bbMax.x) + (plane.y * bbMax.y) + (plane.z * bbMax.z) + (plane.w * 1.0f) >= 0.0f);
+}
+
+// Planes go round starting from lastPlane, it gets the rejecting one
+bool IsBoxInside(in float4 planes[6], in float3 bbMin, in float3 bbMax, inout uint lastPlane) {
+  for (uint k = 0; k < 6; k++) {
+    uint i = (lastPlane + k) % 6;
+    if (IsOutside(planes[i], bbMin, bbMax)) {
+      lastPlane = i;
       return false;
+    }
   }
 
   return true;
@@ -34,8 +42,17 @@ void main(uint3 globalThreadId : SV_DispatchThreadID)
   if (globalThreadId.x >= numShapes.x) {
     return;
   }
-  if (IsBoxInside(planes, bbMin[globalThreadId.x].xyz, 
-    bbMax[globalThreadId.x].xyz)) {
+
+  // numShapes.y - coherent mode, otherwise planes are always tested from the first one
+  uint state = numShapes.y ? cullHistory[globalThreadId.x] : 0;
+  uint lastPlane = state;
+  bool visible = IsBoxInside(planes, bbMin[globalThreadId.x].xyz, bbMax[globalThreadId.x].xyz, lastPlane);
+  // Written only when rejecting plane changes, visible and steadily rejected boxes don't touch the buffer
+  if (numShapes.y && lastPlane != state) {
+    cullHistory[globalThreadId.x] = lastPlane;
+  }
+
+  if (visible) {
     uint id = 0;
     InterlockedAdd(indirectArgs[1], 1, id);
     objectsIds[id] = uint4(globalThreadId.x, 0, 0, 0);
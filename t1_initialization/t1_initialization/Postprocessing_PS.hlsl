@@ -1,8 +1,13 @@
+#include "oitCalc.h"
+
 Texture2D sourceTexture : register(t0);
+Texture2D oitAccumTexture : register(t1);
+Texture2D oitRevealageTexture : register(t2);
 SamplerState Sampler : register(s0);
 
 cbuffer PostEffectConstantBuffer : register(b0) {
   float4 params; // x, y, z - parts of each color channel
+  float4 oit; // x - 1 if OIT accumulation and revealage are composited
 }
 
 struct PS_INPUT
@@ -13,5 +18,11 @@ struct PS_INPUT
 
 float4 main(PS_INPUT input) : SV_TARGET{
     float3 color = sourceTexture.Sample(Sampler, input.tex).xyz;
+    if (oit.x > 0.5) {
+      color = OITResolve(
+        oitAccumTexture.Sample(Sampler, input.tex),
+        oitRevealageTexture.Sample(Sampler, input.tex).x,
+        color);
+    }
     return float4(color.x * params.x, color.y * params.y, color.z * params.z, 1.0);
 }
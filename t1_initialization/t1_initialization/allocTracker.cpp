@@ -0,0 +1,251 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#endif
+
+#include "allocTracker.h"
+
+namespace {
+  // Touched from operator new, so only constant initialized data here
+  std::atomic<uint64_t> totalCount{ 0 };
+  std::atomic<uint64_t> totalBytes{ 0 };
+  std::atomic<uint64_t> totalFrees{ 0 };
+  thread_local uint64_t threadCount = 0;
+  thread_local uint64_t threadBytes = 0;
+  thread_local uint64_t threadFrees = 0;
+
+  void CountAllocation(size_t size) {
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add(size, std::memory_order_relaxed);
+    threadCount++;
+    threadBytes += size;
+  }
+
+  void CountFree() {
+    totalFrees.fetch_add(1, std::memory_order_relaxed);
+    threadFrees++;
+  }
+
+  // Platform calls, the rest of tracker is plain C++ and also builds into device-free tests
+  void* AlignedAlloc(size_t size, size_t alignment) {
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* memory = nullptr;
+    return posix_memalign(&memory, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) == 0 ? memory : nullptr;
+#endif
+  }
+
+  void AlignedFree(void* memory) {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+  }
+
+  void DebugOutput(const char* message) {
+#ifdef _WIN32
+    OutputDebugStringA(message);
+#else
+    fputs(message, stderr);
+#endif
+  }
+
+  AllocStats Difference(const AllocStats& end, const AllocStats& start) {
+    AllocStats stats;
+    stats.count = end.count - start.count;
+    stats.bytes = end.bytes - start.bytes;
+    stats.frees = end.frees - start.frees;
+    return stats;
+  }
+}
+
+#if ALLOC_TRACKING
+void* operator new(size_t size) {
+  CountAllocation(size);
+  void* memory = malloc(size ? size : 1);
+  if (!memory)
+    throw std::bad_alloc();
+  return memory;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  CountAllocation(size);
+  return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept {
+  if (!memory)
+    return;
+  CountFree();
+  free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+  operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+  operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+  operator delete(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+  operator delete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+  operator delete(memory);
+}
+
+// Over-aligned types go through these since C++17, memory from AlignedAlloc must go back to AlignedFree
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment) {
+  CountAllocation(size);
+  void* memory = AlignedAlloc(size ? size : 1, static_cast<size_t>(alignment));
+  if (!memory)
+    throw std::bad_alloc();
+  return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  CountAllocation(size);
+  return AlignedAlloc(size ? size : 1, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return operator new(size, alignment, std::nothrow);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+  if (!memory)
+    return;
+  CountFree();
+  AlignedFree(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept {
+  operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept {
+  operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept {
+  operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  operator delete(memory, alignment);
+}
+#endif
+#endif
+
+AllocTracker& AllocTracker::GetInstance() {
+  static AllocTracker trackerInstance;
+  return trackerInstance;
+}
+
+AllocStats AllocTracker::GetThreadStats() {
+  AllocStats stats;
+  stats.count = threadCount;
+  stats.bytes = threadBytes;
+  stats.frees = threadFrees;
+  return stats;
+}
+
+AllocStats AllocTracker::GetTotalStats() {
+  AllocStats stats;
+  stats.count = totalCount.load(std::memory_order_relaxed);
+  stats.bytes = totalBytes.load(std::memory_order_relaxed);
+  stats.frees = totalFrees.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void AllocTracker::AddScope(const char* name, const AllocStats& stats) {
+  std::lock_guard<std::mutex> lock(scopesMutex);
+  uint32_t i = 0;
+  while (i < scopesCount && scopes[i].name != name && strcmp(scopes[i].name, name) != 0)
+    i++;
+  if (i == scopesCount) {
+    if (scopesCount == ALLOC_MAX_SCOPES)
+      return;
+    scopes[scopesCount].name = name;
+    scopes[scopesCount].stats = AllocStats();
+    scopesCount++;
+  }
+
+  scopes[i].stats.count += stats.count;
+  scopes[i].stats.bytes += stats.bytes;
+  scopes[i].stats.frees += stats.frees;
+}
+
+void AllocTracker::SetStrict(uint32_t warmup) {
+  strict = true;
+  warmupFrames = framesCount + warmup;
+  violationsCount = 0;
+}
+
+void AllocTracker::EndFrame() {
+  AllocStats now = GetTotalStats();
+  lastFrame = Difference(now, frameStart);
+  frameStart = now;
+  framesCount++;
+
+  // First frame also has everything allocated before it (device, assets), it doesn't go to peak
+  if (framesCount > 1 && lastFrame.count > peakFrame.count)
+    peakFrame = lastFrame;
+
+  {
+    std::lock_guard<std::mutex> lock(scopesMutex);
+    memcpy(lastScopes, scopes, sizeof(AllocScopeStats) * scopesCount);
+    lastScopesCount = scopesCount;
+    scopesCount = 0;
+  }
+
+  // Report goes to stack buffer, tracker must not allocate itself
+  if (strict && framesCount > warmupFrames && lastFrame.count > 0) {
+    violationsCount++;
+    char message[256];
+    snprintf(message, sizeof(message), "Frame %u allocated %llu times (%llu bytes)\n",
+      framesCount, (unsigned long long)lastFrame.count, (unsigned long long)lastFrame.bytes);
+    DebugOutput(message);
+    for (uint32_t i = 0; i < lastScopesCount; i++) {
+      if (lastScopes[i].stats.count == 0)
+        continue;
+      snprintf(message, sizeof(message), "  %s: %llu (%llu bytes)\n", lastScopes[i].name,
+        (unsigned long long)lastScopes[i].stats.count, (unsigned long long)lastScopes[i].stats.bytes);
+      DebugOutput(message);
+    }
+  }
+}
+
+AllocScope::~AllocScope() {
+  AllocTracker::GetInstance().AddScope(name, Difference(AllocTracker::GetThreadStats(), start));
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Global operator new / delete hooks count every heap allocation (aligned ones too when compiler has them), 0 leaves default operators
+#ifndef ALLOC_TRACKING
+#define ALLOC_TRACKING 1
+#endif
+
+#define ALLOC_MAX_SCOPES 16
+
+struct AllocStats {
+  uint64_t count = 0;  // allocations
+  uint64_t bytes = 0;  // requested bytes
+  uint64_t frees = 0;
+};
+
+struct AllocScopeStats {
+  const char* name = nullptr;
+  AllocStats stats;
+};
+
+// Heap allocation counts of frames and named scopes inside them.
+// Strict mode marks every frame after warm up that allocated, frame time hitches come from such spikes.
+class AllocTracker {
+public:
+  // Make class singleton
+  static AllocTracker& GetInstance();
+  AllocTracker(const AllocTracker&) = delete;
+  AllocTracker(AllocTracker&&) = delete;
+
+  // Running totals of calling thread / all threads since start
+  static AllocStats GetThreadStats();
+  static AllocStats GetTotalStats();
+
+  // Frame is everything between two EndFrame calls on render thread
+  void EndFrame();
+
+  const AllocStats& GetLastFrameStats() const { return lastFrame; };
+  const AllocStats& GetPeakFrameStats() const { return peakFrame; };
+  uint32_t GetFramesCount() const { return framesCount; };
+
+  // Scopes of last frame, in order they were first closed
+  uint32_t GetScopesCount() const { return lastScopesCount; };
+  const AllocScopeStats& GetScope(uint32_t index) const { return lastScopes[index]; };
+
+  // Frames after warmupFrames must not allocate, violations are reported in debug output
+  void SetStrict(uint32_t warmupFrames);
+  bool IsStrict() const { return strict; };
+  uint32_t GetViolationsCount() const { return violationsCount; };
+
+  // Called by AllocScope
+  void AddScope(const char* name, const AllocStats& stats);
+private:
+  // Private constructor (for singleton)
+  AllocTracker() = default;
+
+  std::mutex scopesMutex;
+  AllocScopeStats scopes[ALLOC_MAX_SCOPES];
+  uint32_t scopesCount = 0;
+  AllocScopeStats lastScopes[ALLOC_MAX_SCOPES];
+  uint32_t lastScopesCount = 0;
+
+  AllocStats frameStart;
+  AllocStats lastFrame;
+  AllocStats peakFrame;
+  uint32_t framesCount = 0;
+
+  bool strict = false;
+  uint32_t warmupFrames = 0;
+  uint32_t violationsCount = 0;
+};
+
+// Allocations of calling thread while scope lives, added to current frame under name.
+// name must be a string literal, scopes are told apart by it
+class AllocScope {
+public:
+  explicit AllocScope(const char* name) : name(name), start(AllocTracker::GetThreadStats()) {};
+  ~AllocScope();
+
+  AllocScope(const AllocScope&) = delete;
+  AllocScope& operator=(const AllocScope&) = delete;
+private:
+  const char* name;
+  AllocStats start;
+};
@@ -0,0 +1,360 @@
+#include <algorithm>
+
+#include "assetArchive.h"
+
+#ifdef ASSET_ARCHIVE_LZ4
+#include "lz4.h"
+#endif
+
+namespace {
+  const uint64_t FNV_OFFSET = 14695981039346656037ull;
+  const uint64_t FNV_PRIME = 1099511628211ull;
+
+  // Size limit of single entry, LZ4 API works with int sizes
+  const uint64_t MAX_ENTRY_SIZE = 0x7FFFFFFF;
+
+  uint64_t HashByte(uint64_t hash, uint8_t byte) {
+    return (hash ^ byte) * FNV_PRIME;
+  }
+
+  // Normalized UTF-8 bytes of name go to emit one by one
+  template<typename CharT, typename Emit>
+  void Normalize(const CharT* name, Emit emit) {
+    // Skip leading "./"
+    while (name[0] == '.' && (name[1] == '/' || name[1] == '\\'))
+      name += 2;
+
+    for (; *name; name++) {
+      uint32_t c = (uint32_t)*name;
+      if (c == '\\')
+        c = '/';
+      else if (c >= 'A' && c <= 'Z')
+        c += 'a' - 'A';
+
+      if (c < 0x80) {
+        emit((uint8_t)c);
+      } else if (c < 0x800) {
+        emit((uint8_t)(0xC0 | (c >> 6)));
+        emit((uint8_t)(0x80 | (c & 0x3F)));
+      } else {
+        emit((uint8_t)(0xE0 | ((c >> 12) & 0x0F)));
+        emit((uint8_t)(0x80 | ((c >> 6) & 0x3F)));
+        emit((uint8_t)(0x80 | (c & 0x3F)));
+      }
+    }
+  }
+
+  // FNV-1a over normalized UTF-8 name
+  template<typename CharT>
+  uint64_t HashNormalized(const CharT* name) {
+    uint64_t hash = FNV_OFFSET;
+    Normalize(name, [&](uint8_t byte) { hash = HashByte(hash, byte); });
+    return hash;
+  }
+
+  template<typename CharT>
+  bool NameEquals(const CharT* name, const uint8_t* stored, uint32_t length) {
+    uint32_t i = 0;
+    bool equal = true;
+    Normalize(name, [&](uint8_t byte) {
+      equal = equal && i < length && stored[i] == byte;
+      i++;
+    });
+    return equal && i == length;
+  }
+
+  uint64_t AlignUp(uint64_t value) {
+    return (value + ARCHIVE_ALIGNMENT - 1) & ~uint64_t(ARCHIVE_ALIGNMENT - 1);
+  }
+
+  HRESULT ReadWholeFile(const wchar_t* path, std::vector<uint8_t>& data) {
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return HRESULT_FROM_WIN32(GetLastError());
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+      CloseHandle(file);
+      return HRESULT_FROM_WIN32(GetLastError());
+    }
+    if ((uint64_t)size.QuadPart > MAX_ENTRY_SIZE) {
+      CloseHandle(file);
+      return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+    }
+
+    data.resize((size_t)size.QuadPart);
+    DWORD bytesRead = 0;
+    BOOL ok = data.empty() || ReadFile(file, data.data(), (DWORD)data.size(), &bytesRead, nullptr);
+    CloseHandle(file);
+
+    if (!ok)
+      return HRESULT_FROM_WIN32(GetLastError());
+    if (bytesRead != data.size())
+      return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    return S_OK;
+  }
+
+  HRESULT WriteBytes(HANDLE file, const void* data, size_t size) {
+    DWORD written = 0;
+    if (!WriteFile(file, data, (DWORD)size, &written, nullptr))
+      return HRESULT_FROM_WIN32(GetLastError());
+    return written == size ? S_OK : E_FAIL;
+  }
+}
+
+AssetArchive& AssetArchive::GetInstance() {
+  static AssetArchive archiveInstance;
+  return archiveInstance;
+}
+
+AssetArchive::~AssetArchive() {
+  Close();
+}
+
+uint64_t AssetArchive::HashName(const wchar_t* name) {
+  return HashNormalized(name);
+}
+
+uint64_t AssetArchive::HashName(const char* name) {
+  return HashNormalized(name);
+}
+
+HRESULT AssetArchive::Open(const wchar_t* path) {
+  Close();
+
+  hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(hFile, &size) || (uint64_t)size.QuadPart < sizeof(ArchiveHeader)) {
+    Close();
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  }
+  fileSize = (size_t)size.QuadPart;
+
+  hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!hMapping) {
+    HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+    Close();
+    return hr;
+  }
+
+  pData = static_cast<const uint8_t*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+  if (!pData) {
+    HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+    Close();
+    return hr;
+  }
+
+  // Validate header and index, entries are checked on load
+  auto header = reinterpret_cast<const ArchiveHeader*>(pData);
+  if (header->magic != ARCHIVE_MAGIC || header->version != ARCHIVE_VERSION ||
+    header->indexOffset > fileSize ||
+    (fileSize - header->indexOffset) / sizeof(ArchiveEntry) < header->entriesCount) {
+    Close();
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  }
+
+  entries = reinterpret_cast<const ArchiveEntry*>(pData + header->indexOffset);
+  entriesCount = header->entriesCount;
+
+  for (uint32_t i = 0; i < entriesCount; i++)
+    if ((i > 0 && entries[i - 1].nameHash >= entries[i].nameHash) ||
+      entries[i].nameOffset > fileSize || entries[i].nameLength > fileSize - entries[i].nameOffset) {
+      Close();
+      return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+  return S_OK;
+}
+
+void AssetArchive::Close() {
+  if (pData) {
+    UnmapViewOfFile(pData);
+    pData = nullptr;
+  }
+  if (hMapping) {
+    CloseHandle(hMapping);
+    hMapping = nullptr;
+  }
+  if (hFile != INVALID_HANDLE_VALUE) {
+    CloseHandle(hFile);
+    hFile = INVALID_HANDLE_VALUE;
+  }
+
+  fileSize = 0;
+  entries = nullptr;
+  entriesCount = 0;
+}
+
+template<typename CharT>
+const ArchiveEntry* AssetArchive::Find(const CharT* name) const {
+  if (!IsOpen())
+    return nullptr;
+
+  uint64_t nameHash = HashNormalized(name);
+  const ArchiveEntry* end = entries + entriesCount;
+  const ArchiveEntry* entry = std::lower_bound(entries, end, nameHash,
+    [](const ArchiveEntry& e, uint64_t hash) { return e.nameHash < hash; });
+
+  if (entry == end || entry->nameHash != nameHash || !NameEquals(name, pData + entry->nameOffset, entry->nameLength))
+    return nullptr;
+  return entry;
+}
+
+bool AssetArchive::Contains(const wchar_t* name) const {
+  return Find(name) != nullptr;
+}
+
+bool AssetArchive::IsMapped(const void* ptr) const {
+  auto p = static_cast<const uint8_t*>(ptr);
+  return pData && p >= pData && p < pData + fileSize;
+}
+
+HRESULT AssetArchive::Load(const wchar_t* name, AssetData& asset) const {
+  return Load(Find(name), asset);
+}
+
+HRESULT AssetArchive::Load(const char* name, AssetData& asset) const {
+  return Load(Find(name), asset);
+}
+
+HRESULT AssetArchive::Load(const ArchiveEntry* entry, AssetData& asset) const {
+  asset.data = nullptr;
+  asset.size = 0;
+  asset.storage.clear();
+
+  if (!entry)
+    return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+  if (entry->offset > fileSize || entry->storedSize > fileSize - entry->offset || entry->size > MAX_ENTRY_SIZE)
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+  const uint8_t* stored = pData + entry->offset;
+
+  switch (entry->codec) {
+  case ARCHIVE_CODEC_NONE:
+    if (entry->storedSize != entry->size)
+      return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    asset.data = stored;
+    asset.size = (size_t)entry->size;
+    return S_OK;
+
+#ifdef ASSET_ARCHIVE_LZ4
+  case ARCHIVE_CODEC_LZ4: {
+    asset.storage.resize((size_t)entry->size);
+    int decoded = LZ4_decompress_safe(reinterpret_cast<const char*>(stored), reinterpret_cast<char*>(asset.storage.data()),
+      (int)entry->storedSize, (int)entry->size);
+    if (decoded < 0 || (uint64_t)decoded != entry->size) {
+      asset.storage.clear();
+      return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+    asset.data = asset.storage.data();
+    asset.size = asset.storage.size();
+    return S_OK;
+  }
+#endif
+
+  default:
+    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+  }
+}
+
+HRESULT AssetArchive::Pack(const wchar_t* archivePath, const std::vector<std::wstring>& files, bool compress) {
+#ifndef ASSET_ARCHIVE_LZ4
+  // No codec available, keep entries raw
+  compress = false;
+#endif
+
+  struct PackedFile {
+    ArchiveEntry entry;
+    std::vector<uint8_t> name;
+    std::vector<uint8_t> data;
+  };
+  std::vector<PackedFile> packed(files.size());
+
+  for (size_t i = 0; i < files.size(); i++) {
+    PackedFile& file = packed[i];
+
+    HRESULT hr = ReadWholeFile(files[i].c_str(), file.data);
+    if (FAILED(hr))
+      return hr;
+
+    file.entry = {};
+    file.entry.nameHash = HashName(files[i].c_str());
+    Normalize(files[i].c_str(), [&](uint8_t byte) { file.name.push_back(byte); });
+    file.entry.nameLength = (uint32_t)file.name.size();
+    file.entry.size = file.data.size();
+    file.entry.codec = ARCHIVE_CODEC_NONE;
+
+#ifdef ASSET_ARCHIVE_LZ4
+    if (compress && !file.data.empty()) {
+      std::vector<uint8_t> compressed(LZ4_compressBound((int)file.data.size()));
+      int compressedSize = LZ4_compress_default(reinterpret_cast<const char*>(file.data.data()),
+        reinterpret_cast<char*>(compressed.data()), (int)file.data.size(), (int)compressed.size());
+
+      // Keep entry raw if compression does not pay off
+      if (compressedSize > 0 && (size_t)compressedSize < file.data.size()) {
+        compressed.resize(compressedSize);
+        file.data.swap(compressed);
+        file.entry.codec = ARCHIVE_CODEC_LZ4;
+      }
+    }
+#endif
+
+    file.entry.storedSize = file.data.size();
+  }
+
+  std::sort(packed.begin(), packed.end(),
+    [](const PackedFile& a, const PackedFile& b) { return a.entry.nameHash < b.entry.nameHash; });
+
+  for (size_t i = 1; i < packed.size(); i++)
+    if (packed[i - 1].entry.nameHash == packed[i].entry.nameHash)
+      return HRESULT_FROM_WIN32(ERROR_INVALID_DATA); // duplicated name or hash collision
+
+  ArchiveHeader header = {};
+  header.magic = ARCHIVE_MAGIC;
+  header.version = ARCHIVE_VERSION;
+  header.entriesCount = (uint32_t)packed.size();
+  header.indexOffset = sizeof(ArchiveHeader);
+
+  uint64_t offset = header.indexOffset + sizeof(ArchiveEntry) * packed.size();
+  for (auto& file : packed) {
+    file.entry.nameOffset = offset;
+    offset += file.name.size();
+  }
+  header.dataOffset = AlignUp(offset);
+
+  offset = header.dataOffset;
+  for (auto& file : packed) {
+    file.entry.offset = offset;
+    offset = AlignUp(offset + file.entry.storedSize);
+  }
+
+  HANDLE archive = CreateFileW(archivePath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (archive == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+
+  HRESULT hr = WriteBytes(archive, &header, sizeof(header));
+  for (size_t i = 0; i < packed.size() && SUCCEEDED(hr); i++)
+    hr = WriteBytes(archive, &packed[i].entry, sizeof(ArchiveEntry));
+
+  for (size_t i = 0; i < packed.size() && SUCCEEDED(hr); i++)
+    if (!packed[i].name.empty())
+      hr = WriteBytes(archive, packed[i].name.data(), packed[i].name.size());
+
+  const std::vector<uint8_t> padding(ARCHIVE_ALIGNMENT, 0);
+  uint64_t written = packed.empty() ? header.indexOffset : packed.back().entry.nameOffset + packed.back().name.size();
+  for (size_t i = 0; i < packed.size() && SUCCEEDED(hr); i++) {
+    const PackedFile& file = packed[i];
+
+    hr = WriteBytes(archive, padding.data(), (size_t)(file.entry.offset - written));
+    if (SUCCEEDED(hr) && !file.data.empty())
+      hr = WriteBytes(archive, file.data.data(), file.data.size());
+    written = file.entry.offset + file.entry.storedSize;
+  }
+
+  CloseHandle(archive);
+  return hr;
+}
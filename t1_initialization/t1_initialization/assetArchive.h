@@ -0,0 +1,95 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Archive layout (all values little endian):
+//   ArchiveHeader
+//   ArchiveEntry[entriesCount]  - sorted by nameHash
+//   entries names               - normalized UTF-8, not terminated
+//   entries data                - every entry starts at ARCHIVE_ALIGNMENT boundary
+#define ARCHIVE_MAGIC 0x41504743 // 'CGPA'
+#define ARCHIVE_VERSION 2
+#define ARCHIVE_ALIGNMENT 4096
+
+// Archive looked up in working directory at startup
+#define ARCHIVE_DEFAULT_PATH L"assets.pak"
+
+enum ArchiveCodec : uint32_t {
+  ARCHIVE_CODEC_NONE = 0,
+  ARCHIVE_CODEC_LZ4 = 1   // needs lz4.h/lz4.c vendored and ASSET_ARCHIVE_LZ4 defined
+};
+
+struct ArchiveHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entriesCount;
+  uint32_t flags;
+  uint64_t indexOffset;
+  uint64_t dataOffset;
+};
+
+struct ArchiveEntry {
+  uint64_t nameHash;
+  uint64_t nameOffset;  // from file begin, name is compared on lookup so hash collisions can't alias
+  uint64_t offset;      // from file begin
+  uint64_t storedSize;  // size in archive
+  uint64_t size;        // size after decompression
+  uint32_t codec;
+  uint32_t nameLength;
+};
+
+// Loaded asset data, points directly into mapped archive for uncompressed entries
+struct AssetData {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  std::vector<uint8_t> storage; // used only for decompressed entries
+};
+
+class AssetArchive {
+public:
+  // Make class singleton
+  static AssetArchive& GetInstance();
+  AssetArchive(const AssetArchive&) = delete;
+  AssetArchive(AssetArchive&&) = delete;
+
+  ~AssetArchive();
+
+  // Map archive file, assets are looked up there before loose files
+  HRESULT Open(const wchar_t* path);
+  void Close();
+
+  bool IsOpen() const { return pData != nullptr; };
+
+  // Name is normalized: case insensitive, '\' == '/', leading "./" ignored
+  bool Contains(const wchar_t* name) const;
+  HRESULT Load(const wchar_t* name, AssetData& asset) const;
+  HRESULT Load(const char* name, AssetData& asset) const;
+
+  // Check if pointer was returned by Load without copy
+  bool IsMapped(const void* ptr) const;
+
+  // Build archive from loose files
+  static HRESULT Pack(const wchar_t* archivePath, const std::vector<std::wstring>& files, bool compress);
+
+  static uint64_t HashName(const wchar_t* name);
+  static uint64_t HashName(const char* name);
+private:
+  // Private constructor (for singleton)
+  AssetArchive() = default;
+
+  // Entry with the same normalized name
+  template<typename CharT>
+  const ArchiveEntry* Find(const CharT* name) const;
+  HRESULT Load(const ArchiveEntry* entry, AssetData& asset) const;
+
+  HANDLE hFile = INVALID_HANDLE_VALUE;
+  HANDLE hMapping = nullptr;
+  const uint8_t* pData = nullptr;
+  size_t fileSize = 0;
+
+  const ArchiveEntry* entries = nullptr;
+  uint32_t entriesCount = 0;
+};
@@ -0,0 +1,189 @@
+#include <cstdio>
+
+#include "benchmark.h"
+
+namespace {
+  // Trace and path files are small, they are read and written at once
+  HRESULT ReadWholeFile(const wchar_t* path, std::vector<uint8_t>& data) {
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return HRESULT_FROM_WIN32(GetLastError());
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart > 0x7FFFFFFF) {
+      CloseHandle(file);
+      return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+    }
+
+    data.resize((size_t)size.QuadPart);
+    DWORD bytesRead = 0;
+    BOOL read = data.empty() || ReadFile(file, data.data(), (DWORD)data.size(), &bytesRead, nullptr);
+    CloseHandle(file);
+    if (!read || bytesRead != data.size())
+      return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    return S_OK;
+  }
+
+  HRESULT WriteWholeFile(const wchar_t* path, const void* data, size_t size) {
+    HANDLE file = CreateFileW(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return HRESULT_FROM_WIN32(GetLastError());
+
+    DWORD bytesWritten = 0;
+    HRESULT hr = S_OK;
+    if (!WriteFile(file, data, (DWORD)size, &bytesWritten, nullptr) || bytesWritten != size)
+      hr = HRESULT_FROM_WIN32(GetLastError());
+    CloseHandle(file);
+    return hr;
+  }
+}
+
+void Benchmark::Reset(BENCHMARK_MODE newMode) {
+  mode = newMode;
+  finished = false;
+  frame = 0;
+  log.Init(BENCHMARK_MAX_FRAMES);
+  startTime = lastFrameTime = std::chrono::steady_clock::now();
+}
+
+void Benchmark::StartRecording(const wchar_t* path) {
+  Reset(BENCHMARK_RECORD);
+  recorder.Begin();
+  recordedPath.Clear();
+  tracePath = path;
+  logPath.clear();
+}
+
+bool Benchmark::StartPlayback(const uint8_t* data, size_t size) {
+  if (!player.Parse(data, size))
+    return false;
+  Reset(BENCHMARK_PLAY);
+  return true;
+}
+
+bool Benchmark::StartPath(const CameraPath& cameraPath) {
+  if (cameraPath.GetKeys().empty())
+    return false;
+  path = cameraPath;
+  Reset(BENCHMARK_PATH);
+  return true;
+}
+
+HRESULT Benchmark::StartPlayback(const wchar_t* path, const wchar_t* log) {
+  std::vector<uint8_t> data;
+  HRESULT hr = ReadWholeFile(path, data);
+  if (FAILED(hr))
+    return hr;
+
+  if (!StartPlayback(data.data(), data.size()))
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  tracePath.clear();
+  logPath = log;
+  return S_OK;
+}
+
+HRESULT Benchmark::StartPath(const wchar_t* pathFile, const wchar_t* log) {
+  std::vector<uint8_t> text;
+  HRESULT hr = ReadWholeFile(pathFile, text);
+  if (FAILED(hr))
+    return hr;
+
+  CameraPath cameraPath;
+  uint32_t errorLine = 0;
+  if (!cameraPath.ParseText((const char*)text.data(), text.size(), &errorLine)) {
+    char message[64];
+    snprintf(message, sizeof(message), "Camera path error at line %u\n", errorLine);
+    OutputDebugStringA(message);
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  }
+
+  if (!StartPath(cameraPath))
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  tracePath.clear();
+  logPath = log;
+  return S_OK;
+}
+
+bool Benchmark::Frame(InputState& state, CameraPathKey& pose) {
+  if (mode == BENCHMARK_NONE || finished)
+    return false;
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (frame > 0)
+    log.Add(std::chrono::duration<double, std::milli>(now - lastFrameTime).count());
+  lastFrameTime = now;
+
+  bool placeCamera = false;
+  switch (mode) {
+  case BENCHMARK_RECORD:
+    recorder.Record(state, std::chrono::duration<float>(now - startTime).count());
+    break;
+
+  case BENCHMARK_PLAY:
+    if (!player.Next(state)) {
+      state = InputState();
+      finished = true;
+    }
+    break;
+
+  case BENCHMARK_PATH: {
+    // Key time of the last frame is reached exactly, the run ends after it
+    float time = (float)frame / BENCHMARK_FRAME_RATE;
+    state = InputState();
+    placeCamera = path.Evaluate(time, pose);
+    finished = time >= path.GetDuration();
+    break;
+  }
+
+  default:
+    break;
+  }
+
+  frame++;
+  return placeCamera;
+}
+
+void Benchmark::RecordCamera(const CameraPathKey& placement) {
+  // Called after Frame, so frame is already the next one
+  if (mode != BENCHMARK_RECORD || frame == 0 || (frame - 1) % BENCHMARK_PATH_KEY_FRAMES != 0)
+    return;
+
+  CameraPathKey key = placement;
+  key.time = (float)(frame - 1) / BENCHMARK_FRAME_RATE;
+  recordedPath.AddKey(key);
+}
+
+HRESULT Benchmark::Finish() {
+  BENCHMARK_MODE finishedMode = mode;
+  mode = BENCHMARK_NONE;
+  finished = true;
+
+  HRESULT hr = S_OK;
+  if (finishedMode == BENCHMARK_RECORD) {
+    std::vector<uint8_t> data;
+    recorder.Serialize(data);
+    hr = WriteWholeFile(tracePath.c_str(), data.data(), data.size());
+    if (FAILED(hr))
+      return hr;
+
+    std::string text;
+    recordedPath.WriteText(text);
+    return WriteWholeFile((tracePath + L".path").c_str(), text.data(), text.size());
+  }
+
+  if (finishedMode == BENCHMARK_PLAY || finishedMode == BENCHMARK_PATH) {
+    FrameTimeStats stats = log.GetStats();
+    char message[160];
+    snprintf(message, sizeof(message), "Benchmark: %u frames, mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+      stats.count, stats.mean, stats.p50, stats.p95, stats.p99, stats.max);
+    OutputDebugStringA(message);
+
+    if (!logPath.empty()) {
+      std::string text;
+      log.WriteCSV(text);
+      hr = WriteWholeFile(logPath.c_str(), text.data(), text.size());
+    }
+  }
+
+  return hr;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <windows.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "inputTrace.h"
+#include "cameraPath.h"
+#include "frameTimeLog.h"
+
+// Path time advances by fixed step per frame, so every run shows the same frames
+#define BENCHMARK_FRAME_RATE 60
+// Frame time log capacity
+#define BENCHMARK_MAX_FRAMES 100000
+// Recorded session gets camera path key every this many frames
+#define BENCHMARK_PATH_KEY_FRAMES 30
+
+enum BENCHMARK_MODE {
+  BENCHMARK_NONE = 0,
+  BENCHMARK_RECORD,   // live input is stored to trace, camera placements to path
+  BENCHMARK_PLAY,     // input comes from trace
+  BENCHMARK_PATH      // camera follows path, live input is ignored
+};
+
+// Input recording and playback, scripted camera runs and their frame times.
+// Everything but file access is device and window independent
+class Benchmark {
+public:
+  // Trace goes to tracePath, camera path to tracePath + ".path" on Finish
+  void StartRecording(const wchar_t* tracePath);
+  // Frame times go to logPath on Finish
+  HRESULT StartPlayback(const wchar_t* tracePath, const wchar_t* logPath);
+  HRESULT StartPath(const wchar_t* pathFile, const wchar_t* logPath);
+
+  // Same from memory
+  bool StartPlayback(const uint8_t* data, size_t size);
+  bool StartPath(const CameraPath& path);
+
+  // Called once per frame with live input, playback replaces it and path clears it.
+  // Returns true if camera has to be placed to pose
+  bool Frame(InputState& state, CameraPathKey& pose);
+
+  // Recording: camera placement after frame input
+  void RecordCamera(const CameraPathKey& placement);
+
+  // Stops run and writes its files
+  HRESULT Finish();
+
+  BENCHMARK_MODE GetMode() const { return mode; };
+  // Playback or path is over
+  bool IsFinished() const { return finished; };
+  uint32_t GetFrame() const { return frame; };
+  const FrameTimeLog& GetLog() const { return log; };
+  const InputRecorder& GetRecorder() const { return recorder; };
+  const CameraPath& GetRecordedPath() const { return recordedPath; };
+private:
+  void Reset(BENCHMARK_MODE newMode);
+
+  BENCHMARK_MODE mode = BENCHMARK_NONE;
+  bool finished = false;
+  uint32_t frame = 0;
+
+  InputRecorder recorder;
+  CameraPath recordedPath;
+  InputPlayer player;
+  CameraPath path;
+
+  // Frame time is the gap between two Frame calls
+  FrameTimeLog log;
+  std::chrono::steady_clock::time_point startTime;
+  std::chrono::steady_clock::time_point lastFrameTime;
+
+  std::wstring tracePath;
+  std::wstring logPath;
+};
@@ -17,6 +17,8 @@ cbuffer SceneCB : register (b1)
 {
   float4x4 viewProjectionMatrix;
   float4 planes[6]; // x - index
+  float4 posScale;  // quantized position decode
+  float4 posOffset;
 };
 
 cbuffer IndexBuffer : register(b2)
@@ -24,3 +26,9 @@ cbuffer IndexBuffer : register(b2)
   uint4 objectID[MAX_CUBES];
 }
 
+cbuffer MaterialAtlasBuffer : register(b3)
+{
+  float4 uvScaleOffset[MAX_MATERIALS]; // xy - scale, zw - offset
+  int4 page[MAX_MATERIALS];            // x - atlas page (array slice)
+}
+
@@ -44,6 +44,20 @@ void Camera::Move(float dx, float dy, float wheel) {
   distanceToPoint = max(distanceToPoint, 1.0f);
 }
 
+void Camera::SetOrbit(const XMFLOAT3& target, float distance, float phi, float theta) {
+  pointOfInterest = target;
+  distanceToPoint = max(distance, 1.0f);
+  this->phi = phi;
+  this->theta = min(max(theta, -XM_PIDIV2), XM_PIDIV2);
+}
+
+void Camera::GetOrbit(XMFLOAT3& target, float& distance, float& phi, float& theta) const {
+  target = pointOfInterest;
+  distance = distanceToPoint;
+  phi = this->phi;
+  theta = this->theta;
+}
+
 // Get view matrix method
 void Camera::GetBaseViewMatrix(XMMATRIX& viewMatrix) {
   viewMatrix = this->viewMatrix;
@@ -25,6 +25,10 @@ public:
   // Move camera with mouse method
   void Move(float dx, float dy, float wheel);
 
+  // Place camera on orbit around target, angles in radians
+  void SetOrbit(const XMFLOAT3& target, float distance, float phi, float theta);
+  void GetOrbit(XMFLOAT3& target, float& distance, float& phi, float& theta) const;
+
 private:
   XMMATRIX viewMatrix;
   XMFLOAT3 pointOfInterest;
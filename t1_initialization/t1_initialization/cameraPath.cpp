@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "cameraPath.h"
+
+namespace {
+  const double PATH_DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+  XMVECTOR LoadKey(const CameraPathKey& key) {
+    return XMVectorSet(key.target.x, key.target.y, key.target.z, key.distance);
+  }
+}
+
+bool CameraPath::AddKey(const CameraPathKey& key) {
+  if (!keys.empty() && key.time <= keys.back().time)
+    return false;
+  keys.push_back(key);
+  return true;
+}
+
+bool CameraPath::ParseText(const char* text, size_t size, uint32_t* errorLine) {
+  keys.clear();
+
+  const char* end = text + size;
+  uint32_t lineNumber = 0;
+  for (const char* line = text; line < end; ) {
+    const char* lineEnd = std::find(line, end, '\n');
+    lineNumber++;
+
+    // Line is copied to have it zero terminated, comment is cut off
+    char buffer[256];
+    bool tooLong = (size_t)(lineEnd - line) >= sizeof(buffer);
+    size_t length = (std::min)((size_t)(lineEnd - line), sizeof(buffer) - 1);
+    memcpy(buffer, line, length);
+    buffer[length] = 0;
+    char* comment = strchr(buffer, '#');
+    if (comment)
+      *comment = 0;
+    line = lineEnd < end ? lineEnd + 1 : end;
+
+    char word[16] = {};
+    int consumed = 0;
+    if (sscanf(buffer, " %15s%n", word, &consumed) != 1)
+      continue;
+
+    CameraPathKey key;
+    double phi, theta;
+    int tail = 0;
+    bool valid = !tooLong && strcmp(word, "key") == 0 &&
+      sscanf(buffer + consumed, "%f %f %f %f %f %lf %lf %n", &key.time, &key.target.x, &key.target.y, &key.target.z,
+        &key.distance, &phi, &theta, &tail) == 7 && buffer[consumed + tail] == 0;
+    if (valid) {
+      key.phi = (float)(phi * PATH_DEG_TO_RAD);
+      key.theta = (float)(theta * PATH_DEG_TO_RAD);
+      valid = AddKey(key);
+    }
+    if (!valid) {
+      if (errorLine)
+        *errorLine = lineNumber;
+      keys.clear();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void CameraPath::WriteText(std::string& text) const {
+  char line[256];
+  for (const auto& key : keys) {
+    snprintf(line, sizeof(line), "key %.9g %.9g %.9g %.9g %.9g %.17g %.17g\n", key.time, key.target.x, key.target.y, key.target.z,
+      key.distance, key.phi / PATH_DEG_TO_RAD, key.theta / PATH_DEG_TO_RAD);
+    text += line;
+  }
+}
+
+bool CameraPath::Evaluate(float time, CameraPathKey& result) const {
+  if (keys.empty())
+    return false;
+
+  if (time <= keys.front().time || keys.size() == 1) {
+    result = keys.front();
+    return true;
+  }
+  if (time >= keys.back().time) {
+    result = keys.back();
+    return true;
+  }
+
+  // Segment [i, i + 1] holds time, ends are repeated for outer control points
+  size_t i = std::upper_bound(keys.begin(), keys.end(), time,
+    [](float t, const CameraPathKey& key) { return t < key.time; }) - keys.begin() - 1;
+  const CameraPathKey& k0 = keys[i > 0 ? i - 1 : i];
+  const CameraPathKey& k1 = keys[i];
+  const CameraPathKey& k2 = keys[i + 1];
+  const CameraPathKey& k3 = keys[i + 2 < keys.size() ? i + 2 : i + 1];
+  float t = (time - k1.time) / (k2.time - k1.time);
+
+  XMFLOAT4 placement;
+  XMStoreFloat4(&placement, XMVectorCatmullRom(LoadKey(k0), LoadKey(k1), LoadKey(k2), LoadKey(k3), t));
+  XMFLOAT4 angles;
+  XMStoreFloat4(&angles, XMVectorCatmullRom(XMVectorSet(k0.phi, k0.theta, 0.0f, 0.0f), XMVectorSet(k1.phi, k1.theta, 0.0f, 0.0f),
+    XMVectorSet(k2.phi, k2.theta, 0.0f, 0.0f), XMVectorSet(k3.phi, k3.theta, 0.0f, 0.0f), t));
+
+  result.time = time;
+  result.target = XMFLOAT3(placement.x, placement.y, placement.z);
+  result.distance = placement.w;
+  result.phi = angles.x;
+  result.theta = angles.y;
+  return true;
+}
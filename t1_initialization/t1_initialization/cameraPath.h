@@ -0,0 +1,41 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// Orbit camera placement, the same params Camera::SetOrbit takes
+struct CameraPathKey {
+  float time;       // seconds from path start
+  XMFLOAT3 target;
+  float distance;
+  float phi;        // radians
+  float theta;      // radians
+};
+
+// Camera path for benchmarks: Catmull-Rom spline through orbit keys.
+// Text form, one key per line, '#' starts a comment:
+//   key <time> <x> <y> <z> <distance> <phi degrees> <theta degrees>
+// Keys go with strictly growing time
+class CameraPath {
+public:
+  // errorLine gets 1-based number of the first bad line
+  bool ParseText(const char* text, size_t size, uint32_t* errorLine = nullptr);
+  void WriteText(std::string& text) const;
+
+  // False if time doesn't grow
+  bool AddKey(const CameraPathKey& key);
+  void Clear() { keys.clear(); };
+
+  // Placement at time, clamped to path ends
+  bool Evaluate(float time, CameraPathKey& result) const;
+
+  float GetDuration() const { return keys.empty() ? 0.0f : keys.back().time; };
+  const std::vector<CameraPathKey>& GetKeys() const { return keys; };
+private:
+  std::vector<CameraPathKey> keys;
+};
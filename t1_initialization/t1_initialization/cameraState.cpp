@@ -0,0 +1,49 @@
+#include <cstring>
+
+#include "cameraState.h"
+
+CameraState::CameraState() {
+  view = projection = viewProjection = XMMatrixIdentity();
+  inverseView = inverseProjection = inverseViewProjection = XMMatrixIdentity();
+  position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  perspective = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+  memset(planes, 0, sizeof(planes));
+  frustum.Init(CAMERA_FRUSTUM_DEPTH);
+}
+
+bool CameraState::SetView(const XMMATRIX& newView, const XMFLOAT3& newPosition) {
+  // Bitwise compare: camera that didn't move gives exactly the same matrix
+  if (viewVersion > 0 && memcmp(&view, &newView, sizeof(XMMATRIX)) == 0 && memcmp(&position, &newPosition, sizeof(XMFLOAT3)) == 0)
+    return false;
+
+  view = newView;
+  position = newPosition;
+  inverseView = XMMatrixInverse(nullptr, view);
+  viewVersion++;
+  Rebuild();
+  return true;
+}
+
+bool CameraState::SetPerspective(float fovY, float aspect, float nearZ, float farZ) {
+  XMFLOAT4 params(fovY, aspect, nearZ, farZ);
+  if (projectionVersion > 0 && memcmp(&perspective, &params, sizeof(XMFLOAT4)) == 0)
+    return false;
+
+  perspective = params;
+  projection = XMMatrixPerspectiveFovLH(fovY, aspect, nearZ, farZ);
+  inverseProjection = XMMatrixInverse(nullptr, projection);
+  projectionVersion++;
+  Rebuild();
+  return true;
+}
+
+void CameraState::Rebuild() {
+  viewProjection = XMMatrixMultiply(view, projection);
+  inverseViewProjection = XMMatrixMultiply(inverseProjection, inverseView);
+
+  frustum.ConstructFrustum(view, projection);
+  memcpy(planes, frustum.GetPlanes(), sizeof(planes));
+
+  version++;
+  rebuildsCount++;
+}
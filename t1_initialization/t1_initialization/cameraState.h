@@ -0,0 +1,65 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+
+#include "frustumCulling.h"
+
+using namespace DirectX;
+
+// Screen depth of frustum planes (projection has reversed depth, far plane is the near one)
+#define CAMERA_FRUSTUM_DEPTH 0.01f
+
+// View and projection of frame with matrices and frustum derived from them.
+// Derived data is rebuilt only when view or projection really change. Versions let consumers
+// keep their own camera dependent data (constant buffers, LODs) while camera stands still.
+class CameraState {
+public:
+  CameraState();
+
+  // Return true if new value differs from current one
+  bool SetView(const XMMATRIX& view, const XMFLOAT3& position);
+  bool SetPerspective(float fovY, float aspect, float nearZ, float farZ);
+
+  // Grows with every change of view or projection, 0 - nothing is set yet
+  uint32_t GetVersion() const { return version; };
+  uint32_t GetViewVersion() const { return viewVersion; };
+  uint32_t GetProjectionVersion() const { return projectionVersion; };
+
+  const XMMATRIX& GetView() const { return view; };
+  const XMMATRIX& GetProjection() const { return projection; };
+  const XMMATRIX& GetViewProjection() const { return viewProjection; };
+  const XMMATRIX& GetInverseView() const { return inverseView; };
+  const XMMATRIX& GetInverseProjection() const { return inverseProjection; };
+  const XMMATRIX& GetInverseViewProjection() const { return inverseViewProjection; };
+
+  // Normalized planes, inside is dot >= 0 (as in FrustumCulling)
+  const XMFLOAT4* GetFrustumPlanes() const { return planes; };
+  const XMFLOAT3& GetPosition() const { return position; };
+  // x - fovY, y - aspect, z - nearZ, w - farZ as passed to SetPerspective
+  const XMFLOAT4& GetPerspective() const { return perspective; };
+
+  // Times derived data was rebuilt
+  uint32_t GetRebuildsCount() const { return rebuildsCount; };
+private:
+  void Rebuild();
+
+  XMMATRIX view;
+  XMMATRIX projection;
+  XMMATRIX viewProjection;
+  XMMATRIX inverseView;
+  XMMATRIX inverseProjection;
+  XMMATRIX inverseViewProjection;
+  XMFLOAT3 position;
+
+  // Perspective params projection was built from
+  XMFLOAT4 perspective;
+
+  FrustumCulling frustum;
+  XMFLOAT4 planes[6];
+
+  uint32_t version = 0;
+  uint32_t viewVersion = 0;
+  uint32_t projectionVersion = 0;
+  uint32_t rebuildsCount = 0;
+};
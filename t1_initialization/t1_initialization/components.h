@@ -0,0 +1,51 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+
+using namespace DirectX;
+
+// Scene object components, stored by World in SoA chunks
+
+// Base position of object, w = 1
+struct PositionComponent {
+  XMFLOAT4 position;
+};
+
+// World matrix written by motion systems every frame
+struct TransformComponent {
+  XMFLOAT4X4 world;
+};
+
+// World space AABB of transformed object
+struct BoundsComponent {
+  XMFLOAT4 min;
+  XMFLOAT4 max;
+};
+
+// Rotation speed of box around its own axis
+struct SpinComponent {
+  float speed;
+};
+
+// Material index and texture in material diffuse list
+struct MaterialComponent {
+  uint32_t material;
+  uint32_t texture;
+};
+
+// Point light color
+struct LightComponent {
+  XMFLOAT4 color;
+};
+
+// Transparent surface color, w - alpha
+struct ColorComponent {
+  XMFLOAT4 color;
+};
+
+// position + amplitude * sin(time * frequency)
+struct OscillationComponent {
+  XMFLOAT4 amplitude;
+  float frequency;
+};
@@ -1,4 +1,9 @@
 #define MAX_LIGHT_SOURCES 30
 #define MAX_CUBES 15
+#define PLANES_COUNT 3
 #define SCENE_SIZE 8
 #define MAX_QUERY 10
+#define MAX_MATERIALS 256
+#define SHADOW_CASCADES_COUNT 4
+#define SHADOW_MAX_POINT_LIGHTS 4
+#define MAX_DEPTH_VIEWS 32
@@ -0,0 +1,807 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ddsParser.h"
+
+//--------------------------------------------------------------------------------------
+// Return the BPP for a particular format
+//--------------------------------------------------------------------------------------
+size_t DDSBitsPerPixel(DXGI_FORMAT fmt)
+{
+  switch (fmt)
+  {
+  case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+  case DXGI_FORMAT_R32G32B32A32_FLOAT:
+  case DXGI_FORMAT_R32G32B32A32_UINT:
+  case DXGI_FORMAT_R32G32B32A32_SINT:
+    return 128;
+
+  case DXGI_FORMAT_R32G32B32_TYPELESS:
+  case DXGI_FORMAT_R32G32B32_FLOAT:
+  case DXGI_FORMAT_R32G32B32_UINT:
+  case DXGI_FORMAT_R32G32B32_SINT:
+    return 96;
+
+  case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+  case DXGI_FORMAT_R16G16B16A16_FLOAT:
+  case DXGI_FORMAT_R16G16B16A16_UNORM:
+  case DXGI_FORMAT_R16G16B16A16_UINT:
+  case DXGI_FORMAT_R16G16B16A16_SNORM:
+  case DXGI_FORMAT_R16G16B16A16_SINT:
+  case DXGI_FORMAT_R32G32_TYPELESS:
+  case DXGI_FORMAT_R32G32_FLOAT:
+  case DXGI_FORMAT_R32G32_UINT:
+  case DXGI_FORMAT_R32G32_SINT:
+  case DXGI_FORMAT_R32G8X24_TYPELESS:
+  case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+  case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+  case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+  case DXGI_FORMAT_Y416:
+  case DXGI_FORMAT_Y210:
+  case DXGI_FORMAT_Y216:
+    return 64;
+
+  case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+  case DXGI_FORMAT_R10G10B10A2_UNORM:
+  case DXGI_FORMAT_R10G10B10A2_UINT:
+  case DXGI_FORMAT_R11G11B10_FLOAT:
+  case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+  case DXGI_FORMAT_R8G8B8A8_UNORM:
+  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+  case DXGI_FORMAT_R8G8B8A8_UINT:
+  case DXGI_FORMAT_R8G8B8A8_SNORM:
+  case DXGI_FORMAT_R8G8B8A8_SINT:
+  case DXGI_FORMAT_R16G16_TYPELESS:
+  case DXGI_FORMAT_R16G16_FLOAT:
+  case DXGI_FORMAT_R16G16_UNORM:
+  case DXGI_FORMAT_R16G16_UINT:
+  case DXGI_FORMAT_R16G16_SNORM:
+  case DXGI_FORMAT_R16G16_SINT:
+  case DXGI_FORMAT_R32_TYPELESS:
+  case DXGI_FORMAT_D32_FLOAT:
+  case DXGI_FORMAT_R32_FLOAT:
+  case DXGI_FORMAT_R32_UINT:
+  case DXGI_FORMAT_R32_SINT:
+  case DXGI_FORMAT_R24G8_TYPELESS:
+  case DXGI_FORMAT_D24_UNORM_S8_UINT:
+  case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+  case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+  case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+  case DXGI_FORMAT_R8G8_B8G8_UNORM:
+  case DXGI_FORMAT_G8R8_G8B8_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_UNORM:
+  case DXGI_FORMAT_B8G8R8X8_UNORM:
+  case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+  case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+  case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+  case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+  case DXGI_FORMAT_AYUV:
+  case DXGI_FORMAT_Y410:
+  case DXGI_FORMAT_YUY2:
+    return 32;
+
+  case DXGI_FORMAT_P010:
+  case DXGI_FORMAT_P016:
+    return 24;
+
+  case DXGI_FORMAT_R8G8_TYPELESS:
+  case DXGI_FORMAT_R8G8_UNORM:
+  case DXGI_FORMAT_R8G8_UINT:
+  case DXGI_FORMAT_R8G8_SNORM:
+  case DXGI_FORMAT_R8G8_SINT:
+  case DXGI_FORMAT_R16_TYPELESS:
+  case DXGI_FORMAT_R16_FLOAT:
+  case DXGI_FORMAT_D16_UNORM:
+  case DXGI_FORMAT_R16_UNORM:
+  case DXGI_FORMAT_R16_UINT:
+  case DXGI_FORMAT_R16_SNORM:
+  case DXGI_FORMAT_R16_SINT:
+  case DXGI_FORMAT_B5G6R5_UNORM:
+  case DXGI_FORMAT_B5G5R5A1_UNORM:
+  case DXGI_FORMAT_A8P8:
+  case DXGI_FORMAT_B4G4R4A4_UNORM:
+    return 16;
+
+  case DXGI_FORMAT_NV12:
+  case DXGI_FORMAT_420_OPAQUE:
+  case DXGI_FORMAT_NV11:
+    return 12;
+
+  case DXGI_FORMAT_R8_TYPELESS:
+  case DXGI_FORMAT_R8_UNORM:
+  case DXGI_FORMAT_R8_UINT:
+  case DXGI_FORMAT_R8_SNORM:
+  case DXGI_FORMAT_R8_SINT:
+  case DXGI_FORMAT_A8_UNORM:
+  case DXGI_FORMAT_AI44:
+  case DXGI_FORMAT_IA44:
+  case DXGI_FORMAT_P8:
+    return 8;
+
+  case DXGI_FORMAT_R1_UNORM:
+    return 1;
+
+  case DXGI_FORMAT_BC1_TYPELESS:
+  case DXGI_FORMAT_BC1_UNORM:
+  case DXGI_FORMAT_BC1_UNORM_SRGB:
+  case DXGI_FORMAT_BC4_TYPELESS:
+  case DXGI_FORMAT_BC4_UNORM:
+  case DXGI_FORMAT_BC4_SNORM:
+    return 4;
+
+  case DXGI_FORMAT_BC2_TYPELESS:
+  case DXGI_FORMAT_BC2_UNORM:
+  case DXGI_FORMAT_BC2_UNORM_SRGB:
+  case DXGI_FORMAT_BC3_TYPELESS:
+  case DXGI_FORMAT_BC3_UNORM:
+  case DXGI_FORMAT_BC3_UNORM_SRGB:
+  case DXGI_FORMAT_BC5_TYPELESS:
+  case DXGI_FORMAT_BC5_UNORM:
+  case DXGI_FORMAT_BC5_SNORM:
+  case DXGI_FORMAT_BC6H_TYPELESS:
+  case DXGI_FORMAT_BC6H_UF16:
+  case DXGI_FORMAT_BC6H_SF16:
+  case DXGI_FORMAT_BC7_TYPELESS:
+  case DXGI_FORMAT_BC7_UNORM:
+  case DXGI_FORMAT_BC7_UNORM_SRGB:
+    return 8;
+
+#if defined(_XBOX_ONE) && defined(_TITLE)
+
+  case DXGI_FORMAT_R10G10B10_7E3_A2_FLOAT:
+  case DXGI_FORMAT_R10G10B10_6E4_A2_FLOAT:
+    return 32;
+
+  case DXGI_FORMAT_D16_UNORM_S8_UINT:
+  case DXGI_FORMAT_R16_UNORM_X8_TYPELESS:
+  case DXGI_FORMAT_X16_TYPELESS_G8_UINT:
+    return 24;
+
+#endif // _XBOX_ONE && _TITLE
+
+  default:
+    return 0;
+  }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Get surface information for a particular format
+//--------------------------------------------------------------------------------------
+bool DDSGetSurfaceInfo(size_t width,
+  size_t height,
+  DXGI_FORMAT fmt,
+  size_t* outNumBytes,
+  size_t* outRowBytes,
+  size_t* outNumRows)
+{
+  // Computed in 64 bits, so 32 bit builds can detect overflow
+  uint64_t numBytes = 0;
+  uint64_t rowBytes = 0;
+  uint64_t numRows = 0;
+
+  bool bc = false;
+  bool packed = false;
+  bool planar = false;
+  uint64_t bpe = 0;
+  switch (fmt)
+  {
+  case DXGI_FORMAT_BC1_TYPELESS:
+  case DXGI_FORMAT_BC1_UNORM:
+  case DXGI_FORMAT_BC1_UNORM_SRGB:
+  case DXGI_FORMAT_BC4_TYPELESS:
+  case DXGI_FORMAT_BC4_UNORM:
+  case DXGI_FORMAT_BC4_SNORM:
+    bc = true;
+    bpe = 8;
+    break;
+
+  case DXGI_FORMAT_BC2_TYPELESS:
+  case DXGI_FORMAT_BC2_UNORM:
+  case DXGI_FORMAT_BC2_UNORM_SRGB:
+  case DXGI_FORMAT_BC3_TYPELESS:
+  case DXGI_FORMAT_BC3_UNORM:
+  case DXGI_FORMAT_BC3_UNORM_SRGB:
+  case DXGI_FORMAT_BC5_TYPELESS:
+  case DXGI_FORMAT_BC5_UNORM:
+  case DXGI_FORMAT_BC5_SNORM:
+  case DXGI_FORMAT_BC6H_TYPELESS:
+  case DXGI_FORMAT_BC6H_UF16:
+  case DXGI_FORMAT_BC6H_SF16:
+  case DXGI_FORMAT_BC7_TYPELESS:
+  case DXGI_FORMAT_BC7_UNORM:
+  case DXGI_FORMAT_BC7_UNORM_SRGB:
+    bc = true;
+    bpe = 16;
+    break;
+
+  case DXGI_FORMAT_R8G8_B8G8_UNORM:
+  case DXGI_FORMAT_G8R8_G8B8_UNORM:
+  case DXGI_FORMAT_YUY2:
+    packed = true;
+    bpe = 4;
+    break;
+
+  case DXGI_FORMAT_Y210:
+  case DXGI_FORMAT_Y216:
+    packed = true;
+    bpe = 8;
+    break;
+
+  case DXGI_FORMAT_NV12:
+  case DXGI_FORMAT_420_OPAQUE:
+    planar = true;
+    bpe = 2;
+    break;
+
+  case DXGI_FORMAT_P010:
+  case DXGI_FORMAT_P016:
+    planar = true;
+    bpe = 4;
+    break;
+
+#if defined(_XBOX_ONE) && defined(_TITLE)
+
+  case DXGI_FORMAT_D16_UNORM_S8_UINT:
+  case DXGI_FORMAT_R16_UNORM_X8_TYPELESS:
+  case DXGI_FORMAT_X16_TYPELESS_G8_UINT:
+    planar = true;
+    bpe = 4;
+    break;
+
+#endif
+  }
+
+  if (bc)
+  {
+    uint64_t numBlocksWide = 0;
+    if (width > 0)
+    {
+      numBlocksWide = std::max<uint64_t>(1, (uint64_t(width) + 3) / 4);
+    }
+    uint64_t numBlocksHigh = 0;
+    if (height > 0)
+    {
+      numBlocksHigh = std::max<uint64_t>(1, (uint64_t(height) + 3) / 4);
+    }
+    rowBytes = numBlocksWide * bpe;
+    numRows = numBlocksHigh;
+    numBytes = rowBytes * numBlocksHigh;
+  }
+  else if (packed)
+  {
+    rowBytes = ((uint64_t(width) + 1) >> 1) * bpe;
+    numRows = height;
+    numBytes = rowBytes * height;
+  }
+  else if (fmt == DXGI_FORMAT_NV11)
+  {
+    rowBytes = ((uint64_t(width) + 3) >> 2) * 4;
+    numRows = uint64_t(height) * 2; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
+    numBytes = rowBytes * numRows;
+  }
+  else if (planar)
+  {
+    rowBytes = ((uint64_t(width) + 1) >> 1) * bpe;
+    numBytes = (rowBytes * height) + ((rowBytes * height + 1) >> 1);
+    numRows = uint64_t(height) + ((uint64_t(height) + 1) >> 1);
+  }
+  else
+  {
+    uint64_t bpp = DDSBitsPerPixel(fmt);
+    rowBytes = (uint64_t(width) * bpp + 7) / 8; // round up to nearest byte
+    numRows = height;
+    numBytes = rowBytes * height;
+  }
+
+  // Dimensions are bounded by caller, so 64 bit math itself does not overflow
+  if (numBytes > SIZE_MAX)
+  {
+    return false;
+  }
+
+  if (outNumBytes)
+  {
+    *outNumBytes = static_cast<size_t>(numBytes);
+  }
+  if (outRowBytes)
+  {
+    *outRowBytes = static_cast<size_t>(rowBytes);
+  }
+  if (outNumRows)
+  {
+    *outNumRows = static_cast<size_t>(numRows);
+  }
+  return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+#define ISBITMASK( r,g,b,a ) ( ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a )
+
+DXGI_FORMAT DDSGetDXGIFormat(const DDS_PIXELFORMAT& ddpf)
+{
+  if (ddpf.flags & DDS_RGB)
+  {
+    // Note that sRGB formats are written using the "DX10" extended header
+
+    switch (ddpf.RGBBitCount)
+    {
+    case 32:
+      if (ISBITMASK(0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+      {
+        return DXGI_FORMAT_R8G8B8A8_UNORM;
+      }
+
+      if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+      {
+        return DXGI_FORMAT_B8G8R8A8_UNORM;
+      }
+
+      if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000))
+      {
+        return DXGI_FORMAT_B8G8R8X8_UNORM;
+      }
+
+      // No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0x00000000) aka D3DFMT_X8B8G8R8
+
+      // Note that many common DDS reader/writers (including D3DX) swap the
+      // the RED/BLUE masks for 10:10:10:2 formats. We assumme
+      // below that the 'backwards' header mask is being used since it is most
+      // likely written by D3DX. The more robust solution is to use the 'DX10'
+      // header extension and specify the DXGI_FORMAT_R10G10B10A2_UNORM format directly
+
+      // For 'correct' writers, this should be 0x000003ff,0x000ffc00,0x3ff00000 for RGB data
+      if (ISBITMASK(0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+      {
+        return DXGI_FORMAT_R10G10B10A2_UNORM;
+      }
+
+      // No DXGI format maps to ISBITMASK(0x000003ff,0x000ffc00,0x3ff00000,0xc0000000) aka D3DFMT_A2R10G10B10
+
+      if (ISBITMASK(0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+      {
+        return DXGI_FORMAT_R16G16_UNORM;
+      }
+
+      if (ISBITMASK(0xffffffff, 0x00000000, 0x00000000, 0x00000000))
+      {
+        // Only 32-bit color channel format in D3D9 was R32F
+        return DXGI_FORMAT_R32_FLOAT; // D3DX writes this out as a FourCC of 114
+      }
+      break;
+
+    case 24:
+      // No 24bpp DXGI formats aka D3DFMT_R8G8B8
+      break;
+
+    case 16:
+      if (ISBITMASK(0x7c00, 0x03e0, 0x001f, 0x8000))
+      {
+        return DXGI_FORMAT_B5G5R5A1_UNORM;
+      }
+      if (ISBITMASK(0xf800, 0x07e0, 0x001f, 0x0000))
+      {
+        return DXGI_FORMAT_B5G6R5_UNORM;
+      }
+
+      // No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0x0000) aka D3DFMT_X1R5G5B5
+
+      if (ISBITMASK(0x0f00, 0x00f0, 0x000f, 0xf000))
+      {
+        return DXGI_FORMAT_B4G4R4A4_UNORM;
+      }
+
+      // No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0x0000) aka D3DFMT_X4R4G4B4
+
+      // No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2, D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
+      break;
+    }
+  }
+  else if (ddpf.flags & DDS_LUMINANCE)
+  {
+    if (8 == ddpf.RGBBitCount)
+    {
+      if (ISBITMASK(0x000000ff, 0x00000000, 0x00000000, 0x00000000))
+      {
+        return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10 extension
+      }
+
+      // No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
+    }
+
+    if (16 == ddpf.RGBBitCount)
+    {
+      if (ISBITMASK(0x0000ffff, 0x00000000, 0x00000000, 0x00000000))
+      {
+        return DXGI_FORMAT_R16_UNORM; // D3DX10/11 writes this out as DX10 extension
+      }
+      if (ISBITMASK(0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
+      {
+        return DXGI_FORMAT_R8G8_UNORM; // D3DX10/11 writes this out as DX10 extension
+      }
+    }
+  }
+  else if (ddpf.flags & DDS_ALPHA)
+  {
+    if (8 == ddpf.RGBBitCount)
+    {
+      return DXGI_FORMAT_A8_UNORM;
+    }
+  }
+  else if (ddpf.flags & DDS_FOURCC)
+  {
+    if (MAKEFOURCC('D', 'X', 'T', '1') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC1_UNORM;
+    }
+    if (MAKEFOURCC('D', 'X', 'T', '3') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC2_UNORM;
+    }
+    if (MAKEFOURCC('D', 'X', 'T', '5') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC3_UNORM;
+    }
+
+    // While pre-mulitplied alpha isn't directly supported by the DXGI formats,
+    // they are basically the same as these BC formats so they can be mapped
+    if (MAKEFOURCC('D', 'X', 'T', '2') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC2_UNORM;
+    }
+    if (MAKEFOURCC('D', 'X', 'T', '4') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC3_UNORM;
+    }
+
+    if (MAKEFOURCC('A', 'T', 'I', '1') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC4_UNORM;
+    }
+    if (MAKEFOURCC('B', 'C', '4', 'U') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC4_UNORM;
+    }
+    if (MAKEFOURCC('B', 'C', '4', 'S') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC4_SNORM;
+    }
+
+    if (MAKEFOURCC('A', 'T', 'I', '2') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC5_UNORM;
+    }
+    if (MAKEFOURCC('B', 'C', '5', 'U') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC5_UNORM;
+    }
+    if (MAKEFOURCC('B', 'C', '5', 'S') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_BC5_SNORM;
+    }
+
+    // BC6H and BC7 are written using the "DX10" extended header
+
+    if (MAKEFOURCC('R', 'G', 'B', 'G') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_R8G8_B8G8_UNORM;
+    }
+    if (MAKEFOURCC('G', 'R', 'G', 'B') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_G8R8_G8B8_UNORM;
+    }
+
+    if (MAKEFOURCC('Y', 'U', 'Y', '2') == ddpf.fourCC)
+    {
+      return DXGI_FORMAT_YUY2;
+    }
+
+    // Check for D3DFORMAT enums being set here
+    switch (ddpf.fourCC)
+    {
+    case 36: // D3DFMT_A16B16G16R16
+      return DXGI_FORMAT_R16G16B16A16_UNORM;
+
+    case 110: // D3DFMT_Q16W16V16U16
+      return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+    case 111: // D3DFMT_R16F
+      return DXGI_FORMAT_R16_FLOAT;
+
+    case 112: // D3DFMT_G16R16F
+      return DXGI_FORMAT_R16G16_FLOAT;
+
+    case 113: // D3DFMT_A16B16G16R16F
+      return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+    case 114: // D3DFMT_R32F
+      return DXGI_FORMAT_R32_FLOAT;
+
+    case 115: // D3DFMT_G32R32F
+      return DXGI_FORMAT_R32G32_FLOAT;
+
+    case 116: // D3DFMT_A32B32G32R32F
+      return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    }
+  }
+
+  return DXGI_FORMAT_UNKNOWN;
+}
+
+#undef ISBITMASK
+
+
+//--------------------------------------------------------------------------------------
+// Full file validation, the loader trusts only what passed here
+//--------------------------------------------------------------------------------------
+DDS_PARSE_RESULT ParseDDS(const uint8_t* ddsData, size_t ddsDataSize, DDSLayout& layout)
+{
+  layout.header = nullptr;
+  layout.header10 = nullptr;
+  layout.bitData = nullptr;
+  layout.bitSize = 0;
+  layout.dimension = DDS_DIMENSION_UNKNOWN;
+  layout.format = DXGI_FORMAT_UNKNOWN;
+  layout.width = layout.height = layout.depth = 0;
+  layout.mipCount = layout.arraySize = 0;
+  layout.isCubeMap = false;
+  layout.subresources.clear();
+
+  if (!ddsData || ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
+  {
+    return DDS_PARSE_TOO_SMALL;
+  }
+
+  // Data may come unaligned from archive or network, so magic is copied out
+  uint32_t dwMagicNumber = 0;
+  memcpy(&dwMagicNumber, ddsData, sizeof(uint32_t));
+  if (dwMagicNumber != DDS_MAGIC)
+  {
+    return DDS_PARSE_BAD_MAGIC;
+  }
+
+  auto header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
+  if (header->size != sizeof(DDS_HEADER) ||
+    header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+  {
+    return DDS_PARSE_BAD_HEADER;
+  }
+
+  size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+  const DDS_HEADER_DXT10* d3d10ext = nullptr;
+  if ((header->ddspf.flags & DDS_FOURCC) &&
+    (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+  {
+    if (ddsDataSize < offset + sizeof(DDS_HEADER_DXT10))
+    {
+      return DDS_PARSE_TOO_SMALL;
+    }
+
+    d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>(ddsData + offset);
+    offset += sizeof(DDS_HEADER_DXT10);
+  }
+
+  uint32_t width = header->width;
+  uint32_t height = header->height;
+  uint32_t depth = header->depth;
+  uint32_t arraySize = 1;
+  uint32_t mipCount = header->mipMapCount ? header->mipMapCount : 1;
+  bool isCubeMap = false;
+  DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+  DDS_RESOURCE_DIMENSION dimension = DDS_DIMENSION_UNKNOWN;
+
+  if (d3d10ext)
+  {
+    arraySize = d3d10ext->arraySize;
+    if (arraySize == 0)
+    {
+      return DDS_PARSE_BAD_HEADER;
+    }
+
+    // Enum value comes from file, check it as plain number
+    switch (static_cast<uint32_t>(d3d10ext->dxgiFormat))
+    {
+    case DXGI_FORMAT_AI44:
+    case DXGI_FORMAT_IA44:
+    case DXGI_FORMAT_P8:
+    case DXGI_FORMAT_A8P8:
+      return DDS_PARSE_UNSUPPORTED_FORMAT;
+
+    default:
+      if (DDSBitsPerPixel(d3d10ext->dxgiFormat) == 0)
+      {
+        return DDS_PARSE_UNSUPPORTED_FORMAT;
+      }
+    }
+
+    format = d3d10ext->dxgiFormat;
+
+    switch (d3d10ext->resourceDimension)
+    {
+    case DDS_DIMENSION_TEXTURE1D:
+      // D3DX writes 1D textures with a fixed Height of 1
+      if ((header->flags & DDS_HEIGHT) && height != 1)
+      {
+        return DDS_PARSE_BAD_HEADER;
+      }
+      height = depth = 1;
+      break;
+
+    case DDS_DIMENSION_TEXTURE2D:
+      if (d3d10ext->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+      {
+        if (arraySize > DDS_MAX_ARRAY_SIZE / 6)
+        {
+          return DDS_PARSE_TOO_LARGE;
+        }
+        arraySize *= 6;
+        isCubeMap = true;
+      }
+      depth = 1;
+      break;
+
+    case DDS_DIMENSION_TEXTURE3D:
+      if (!(header->flags & DDS_HEADER_FLAGS_VOLUME))
+      {
+        return DDS_PARSE_BAD_HEADER;
+      }
+
+      if (arraySize > 1)
+      {
+        return DDS_PARSE_UNSUPPORTED_DIMENSION;
+      }
+      break;
+
+    default:
+      return DDS_PARSE_UNSUPPORTED_DIMENSION;
+    }
+
+    dimension = static_cast<DDS_RESOURCE_DIMENSION>(d3d10ext->resourceDimension);
+  }
+  else
+  {
+    format = DDSGetDXGIFormat(header->ddspf);
+    if (format == DXGI_FORMAT_UNKNOWN)
+    {
+      return DDS_PARSE_UNSUPPORTED_FORMAT;
+    }
+
+    if (header->flags & DDS_HEADER_FLAGS_VOLUME)
+    {
+      dimension = DDS_DIMENSION_TEXTURE3D;
+    }
+    else
+    {
+      if (header->caps2 & DDS_CUBEMAP)
+      {
+        // We require all six faces to be defined
+        if ((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+        {
+          return DDS_PARSE_UNSUPPORTED_DIMENSION;
+        }
+
+        arraySize = 6;
+        isCubeMap = true;
+      }
+
+      depth = 1;
+      dimension = DDS_DIMENSION_TEXTURE2D;
+    }
+  }
+
+  // Bound sizes (we don't trust DDS file metadata larger than the D3D 11.x hardware requirements)
+  if (width == 0 || height == 0 || depth == 0)
+  {
+    return DDS_PARSE_BAD_HEADER;
+  }
+
+  if (mipCount > DDS_MAX_MIP_LEVELS)
+  {
+    return DDS_PARSE_TOO_LARGE;
+  }
+
+  switch (dimension)
+  {
+  case DDS_DIMENSION_TEXTURE1D:
+    if ((arraySize > DDS_MAX_ARRAY_SIZE) ||
+      (width > DDS_MAX_TEXTURE1D_DIMENSION))
+    {
+      return DDS_PARSE_TOO_LARGE;
+    }
+    break;
+
+  case DDS_DIMENSION_TEXTURE2D:
+    if ((arraySize > DDS_MAX_ARRAY_SIZE) ||
+      (width > (isCubeMap ? DDS_MAX_TEXTURECUBE_DIMENSION : DDS_MAX_TEXTURE2D_DIMENSION)) ||
+      (height > (isCubeMap ? DDS_MAX_TEXTURECUBE_DIMENSION : DDS_MAX_TEXTURE2D_DIMENSION)))
+    {
+      return DDS_PARSE_TOO_LARGE;
+    }
+    break;
+
+  default: // DDS_DIMENSION_TEXTURE3D
+    if ((width > DDS_MAX_TEXTURE3D_DIMENSION) ||
+      (height > DDS_MAX_TEXTURE3D_DIMENSION) ||
+      (depth > DDS_MAX_TEXTURE3D_DIMENSION))
+    {
+      return DDS_PARSE_TOO_LARGE;
+    }
+    break;
+  }
+
+  // Chain cannot be longer than halving the largest side down to 1
+  uint32_t maxSide = std::max(std::max(width, height), depth);
+  uint32_t maxMips = 1;
+  while (maxSide > 1)
+  {
+    maxSide >>= 1;
+    maxMips++;
+  }
+  if (mipCount > maxMips)
+  {
+    return DDS_PARSE_BAD_HEADER;
+  }
+
+  // Walk all surfaces and check they are inside of payload
+  const uint8_t* bitData = ddsData + offset;
+  size_t bitSize = ddsDataSize - offset;
+
+  layout.subresources.resize(size_t(mipCount) * arraySize);
+  size_t used = 0;
+  size_t index = 0;
+  for (uint32_t item = 0; item < arraySize; item++)
+  {
+    uint32_t w = width;
+    uint32_t h = height;
+    uint32_t d = depth;
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+      size_t numBytes = 0;
+      size_t rowBytes = 0;
+      if (!DDSGetSurfaceInfo(w, h, format, &numBytes, &rowBytes, nullptr) ||
+        (d > 1 && numBytes > SIZE_MAX / d))
+      {
+        layout.subresources.clear();
+        return DDS_PARSE_TOO_LARGE;
+      }
+
+      size_t surfaceBytes = numBytes * d;
+      if (surfaceBytes > bitSize - used)
+      {
+        layout.subresources.clear();
+        return DDS_PARSE_TRUNCATED;
+      }
+
+      DDSSubresource& sub = layout.subresources[index++];
+      sub.offset = used;
+      sub.rowPitch = rowBytes;
+      sub.slicePitch = numBytes;
+      sub.width = w;
+      sub.height = h;
+      sub.depth = d;
+
+      used += surfaceBytes;
+
+      w = std::max<uint32_t>(w >> 1, 1);
+      h = std::max<uint32_t>(h >> 1, 1);
+      d = std::max<uint32_t>(d >> 1, 1);
+    }
+  }
+
+  layout.header = header;
+  layout.header10 = d3d10ext;
+  layout.bitData = bitData;
+  layout.bitSize = bitSize;
+  layout.dimension = dimension;
+  layout.format = format;
+  layout.width = width;
+  layout.height = height;
+  layout.depth = depth;
+  layout.mipCount = mipCount;
+  layout.arraySize = arraySize;
+  layout.isCubeMap = isCubeMap;
+
+  return DDS_PARSE_OK;
+}
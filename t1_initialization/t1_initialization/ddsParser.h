@@ -0,0 +1,175 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//--------------------------------------------------------------------------------------
+// Macros
+//--------------------------------------------------------------------------------------
+#ifndef MAKEFOURCC
+#define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+                ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
+                ((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+//--------------------------------------------------------------------------------------
+// DDS file structure definitions
+//
+// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
+//--------------------------------------------------------------------------------------
+#pragma pack(push,1)
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+struct DDS_PIXELFORMAT
+{
+  uint32_t    size;
+  uint32_t    flags;
+  uint32_t    fourCC;
+  uint32_t    RGBBitCount;
+  uint32_t    RBitMask;
+  uint32_t    GBitMask;
+  uint32_t    BBitMask;
+  uint32_t    ABitMask;
+};
+
+#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
+#define DDS_RGB         0x00000040  // DDPF_RGB
+#define DDS_LUMINANCE   0x00020000  // DDPF_LUMINANCE
+#define DDS_ALPHA       0x00000002  // DDPF_ALPHA
+
+#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
+
+#define DDS_HEIGHT 0x00000002 // DDSD_HEIGHT
+#define DDS_WIDTH  0x00000004 // DDSD_WIDTH
+
+#define DDS_CUBEMAP_POSITIVEX 0x00000600 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
+#define DDS_CUBEMAP_NEGATIVEX 0x00000a00 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
+#define DDS_CUBEMAP_POSITIVEY 0x00001200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
+#define DDS_CUBEMAP_NEGATIVEY 0x00002200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
+#define DDS_CUBEMAP_POSITIVEZ 0x00004200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
+#define DDS_CUBEMAP_NEGATIVEZ 0x00008200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
+
+#define DDS_CUBEMAP_ALLFACES ( DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX |\
+                               DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY |\
+                               DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ )
+
+#define DDS_CUBEMAP 0x00000200 // DDSCAPS2_CUBEMAP
+
+enum DDS_MISC_FLAGS2
+{
+  DDS_MISC_FLAGS2_ALPHA_MODE_MASK = 0x7L,
+};
+
+struct DDS_HEADER
+{
+  uint32_t        size;
+  uint32_t        flags;
+  uint32_t        height;
+  uint32_t        width;
+  uint32_t        pitchOrLinearSize;
+  uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+  uint32_t        mipMapCount;
+  uint32_t        reserved1[11];
+  DDS_PIXELFORMAT ddspf;
+  uint32_t        caps;
+  uint32_t        caps2;
+  uint32_t        caps3;
+  uint32_t        caps4;
+  uint32_t        reserved2;
+};
+
+struct DDS_HEADER_DXT10
+{
+  DXGI_FORMAT     dxgiFormat;
+  uint32_t        resourceDimension;
+  uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
+  uint32_t        arraySize;
+  uint32_t        miscFlags2;
+};
+
+#pragma pack(pop)
+
+//--------------------------------------------------------------------------------------
+// Device free DDS parsing: header validation and subresource layout
+//--------------------------------------------------------------------------------------
+
+// Resource limits, same as D3D11_REQ_* values (parser does not depend on d3d11.h)
+#define DDS_MAX_MIP_LEVELS 15
+#define DDS_MAX_TEXTURE1D_DIMENSION 16384
+#define DDS_MAX_TEXTURE2D_DIMENSION 16384
+#define DDS_MAX_TEXTURE3D_DIMENSION 2048
+#define DDS_MAX_TEXTURECUBE_DIMENSION 16384
+#define DDS_MAX_ARRAY_SIZE 2048
+
+// Misc flag of DX10 header, same value as D3D11_RESOURCE_MISC_TEXTURECUBE
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+
+// Same values as D3D11_RESOURCE_DIMENSION
+enum DDS_RESOURCE_DIMENSION
+{
+  DDS_DIMENSION_UNKNOWN = 0,
+  DDS_DIMENSION_TEXTURE1D = 2,
+  DDS_DIMENSION_TEXTURE2D = 3,
+  DDS_DIMENSION_TEXTURE3D = 4,
+};
+
+enum DDS_PARSE_RESULT
+{
+  DDS_PARSE_OK = 0,
+  DDS_PARSE_TOO_SMALL,            // data is shorter than magic and headers
+  DDS_PARSE_BAD_MAGIC,
+  DDS_PARSE_BAD_HEADER,           // wrong header sizes or inconsistent flags
+  DDS_PARSE_UNSUPPORTED_FORMAT,
+  DDS_PARSE_UNSUPPORTED_DIMENSION,
+  DDS_PARSE_TOO_LARGE,            // sizes over hardware limits or size_t overflow
+  DDS_PARSE_TRUNCATED,            // payload is shorter than described surfaces
+};
+
+struct DDSSubresource
+{
+  size_t offset;      // from DDSLayout::bitData
+  size_t rowPitch;
+  size_t slicePitch;
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+};
+
+struct DDSLayout
+{
+  const DDS_HEADER* header;
+  const DDS_HEADER_DXT10* header10; // nullptr for legacy files
+  const uint8_t* bitData;
+  size_t bitSize;
+
+  DDS_RESOURCE_DIMENSION dimension;
+  DXGI_FORMAT format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+  uint32_t mipCount;
+  uint32_t arraySize;   // includes cube faces
+  bool isCubeMap;
+
+  // mipCount * arraySize items in D3D11CalcSubresource order (same as order in file)
+  std::vector<DDSSubresource> subresources;
+};
+
+size_t DDSBitsPerPixel(DXGI_FORMAT fmt);
+
+// Returns false if sizes do not fit into size_t
+bool DDSGetSurfaceInfo(size_t width,
+  size_t height,
+  DXGI_FORMAT fmt,
+  size_t* outNumBytes,
+  size_t* outRowBytes,
+  size_t* outNumRows);
+
+DXGI_FORMAT DDSGetDXGIFormat(const DDS_PIXELFORMAT& ddpf);
+
+// Validate whole DDS file in memory. Layout points into ddsData, which has to outlive it.
+// Layout can be reused between calls to avoid subresources reallocation.
+DDS_PARSE_RESULT ParseDDS(const uint8_t* ddsData, size_t ddsDataSize, DDSLayout& layout);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <directxmath.h>
+#include <cstdint>
 
 #include "constants.h"
 
@@ -13,14 +14,27 @@ struct WorldMatrixBuffer {
   XMFLOAT4 color;
 };
 
+// Transparent plane instance, streamed as per instance vertex data
+struct PlaneInstance {
+  XMFLOAT4X4 worldMatrix;
+  XMFLOAT4 color;
+};
+
 struct SceneMatrixBuffer {
   XMMATRIX viewProjectionMatrix;
 };
 
+// Position decode: pos = quantized * posScale + posOffset
+struct VertexQuantization {
+  XMFLOAT4 posScale;
+  XMFLOAT4 posOffset;
+};
+
 // Boxes buffers structures
 struct BoxSceneMatrixBuffer {
   XMMATRIX viewProjectionMatrix;
   XMFLOAT4 planes[6];
+  VertexQuantization boxQuantization;
 };
 
 struct CullParams {
@@ -35,9 +49,10 @@ struct GeomBuffer {
   XMFLOAT4 params;
 };
 
-struct BoxModel {
-  XMFLOAT4 pos;
-  XMFLOAT4 params;
+// Diffuse atlas rect of each box material
+struct MaterialAtlasBuffer {
+  XMFLOAT4 uvScaleOffset[MAX_MATERIALS]; // xy - scale, zw - offset
+  XMINT4 page[MAX_MATERIALS];            // x - atlas page (array slice)
 };
 
 struct TexVertex
@@ -56,16 +71,49 @@ struct LightableCB {
   XMFLOAT4 ambientColor;
 };
 
+// Shadow maps sampling, see shadowCalc.h
+struct ShadowCB {
+  XMMATRIX cascadeViewProjection[SHADOW_CASCADES_COUNT];
+  XMFLOAT4 cascadeSplits;         // far view depth of each cascade
+  XMFLOAT4 cascadeTexel;          // world texel size of each cascade
+  XMFLOAT4 cameraForward;         // view depth = dot(pos, xyz) + w
+  XMFLOAT4 sunDirection;          // direction light goes
+  XMFLOAT4 sunColor;
+  XMFLOAT4 shadowParams;          // x - cube near plane, y - cascade bias, z - cube bias, w - normal offset in texels
+  XMINT4 lightSlot[MAX_LIGHT_SOURCES];            // x - cube map of light, -1 - no shadow
+  XMFLOAT4 slotParams[SHADOW_MAX_POINT_LIGHTS];   // xyz - light position, w - far plane
+};
+
+// Depth passes of all views, uploaded once per frame, view 0 is main camera and unused
+struct DepthViewsCB {
+  XMMATRIX viewProjection[MAX_DEPTH_VIEWS];
+};
+
 // Plane special structure
 struct SimpleVertex
 {
   float x, y, z;      // positional coords
 };
 
+// Quantized vertex formats, encoded by VertexQuantizer
+struct QuantizedTexVertex
+{
+  uint16_t pos[4];    // R16G16B16A16_UNORM relative to mesh bounds, w = 1
+  uint16_t uv[2];     // R16G16_FLOAT
+  int16_t normal[2];  // R16G16_SNORM octahedral
+  int16_t tangent[2]; // R16G16_SNORM octahedral
+};
+
+struct QuantizedSimpleVertex
+{
+  uint16_t pos[4];    // R16G16B16A16_UNORM relative to mesh bounds, w = 1
+};
+
 // Only Skybox buffers
 struct SBWorldMatrixBuffer {
   XMMATRIX worldMatrix;
   XMFLOAT4 size;
+  VertexQuantization sphereQuantization;
 };
 
 struct SBSceneMatrixBuffer {
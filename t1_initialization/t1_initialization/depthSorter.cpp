@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "depthSorter.h"
+#include "threadPool.h"
+
+namespace {
+  const uint32_t RADIX_BITS = 8;
+  const uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+  const uint32_t RADIX_PASSES = 32 / RADIX_BITS;
+
+  // Elements per parallel block, smaller blocks do not pay for histogram merge
+  const uint32_t RADIX_MIN_BLOCK = 4096;
+
+  inline uint32_t Digit(uint32_t key, uint32_t pass) {
+    return (key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1);
+  }
+}
+
+uint32_t DepthSorter::DepthToKey(float depth) {
+  uint32_t bits;
+  memcpy(&bits, &depth, sizeof(bits));
+  // Negative floats have reversed order, flip them fully, positive ones - only sign
+  uint32_t ascending = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+  return ~ascending;
+}
+
+void DepthSorter::ComputeKeys(const XMMATRIX* worldMatrices, size_t count, const XMMATRIX& viewMatrix, uint32_t* keys) {
+  // Third column of view matrix gives view space z
+  XMVECTOR viewZ = XMMatrixTranspose(viewMatrix).r[2];
+  XMVECTOR viewZX = XMVectorSplatX(viewZ);
+  XMVECTOR viewZY = XMVectorSplatY(viewZ);
+  XMVECTOR viewZZ = XMVectorSplatZ(viewZ);
+  XMVECTOR viewZW = XMVectorSplatW(viewZ);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    // Centers of 4 instances as SoA: x, y, z, w rows
+    XMMATRIX soa = XMMatrixTranspose(XMMATRIX(
+      worldMatrices[i].r[3],
+      worldMatrices[i + 1].r[3],
+      worldMatrices[i + 2].r[3],
+      worldMatrices[i + 3].r[3]));
+
+    XMVECTOR depth = XMVectorMultiply(soa.r[3], viewZW);
+    depth = XMVectorMultiplyAdd(soa.r[2], viewZZ, depth);
+    depth = XMVectorMultiplyAdd(soa.r[1], viewZY, depth);
+    depth = XMVectorMultiplyAdd(soa.r[0], viewZX, depth);
+
+    XMFLOAT4A depths;
+    XMStoreFloat4A(&depths, depth);
+    keys[i] = DepthToKey(depths.x);
+    keys[i + 1] = DepthToKey(depths.y);
+    keys[i + 2] = DepthToKey(depths.z);
+    keys[i + 3] = DepthToKey(depths.w);
+  }
+  for (; i < count; i++)
+    keys[i] = DepthToKey(XMVectorGetX(XMVector4Dot(worldMatrices[i].r[3], viewZ)));
+}
+
+void DepthSorter::Sort(const uint32_t* srcKeys, size_t count, std::vector<uint32_t>& order) {
+  keys.assign(srcKeys, srcKeys + count);
+  SortKeys(count, order);
+}
+
+void DepthSorter::SortBackToFront(const XMMATRIX* worldMatrices, size_t count, const XMMATRIX& viewMatrix, std::vector<uint32_t>& order) {
+  keys.resize(count);
+  ComputeKeys(worldMatrices, count, viewMatrix, keys.data());
+  SortKeys(count, order);
+}
+
+void DepthSorter::SortKeys(size_t count, std::vector<uint32_t>& order) {
+  if (count < DEPTH_SORT_PARALLEL_MIN || ThreadPool::GetInstance().GetWorkersCount() == 0)
+    SortSerial(count, order);
+  else
+    SortParallel(count, order);
+}
+
+void DepthSorter::SortSerial(size_t count, std::vector<uint32_t>& order) {
+  order.resize(count);
+  std::iota(order.begin(), order.end(), 0u);
+  if (count < 2)
+    return;
+
+  keysTmp.resize(count);
+  valuesTmp.resize(count);
+
+  // All digit histograms in one read
+  histograms.assign(RADIX_SIZE * RADIX_PASSES, 0);
+  for (size_t i = 0; i < count; i++)
+    for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+      histograms[pass * RADIX_SIZE + Digit(keys[i], pass)]++;
+
+  for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+    uint32_t* offsets = histograms.data() + pass * RADIX_SIZE;
+    // Nothing to reorder when all keys share this digit (usual for high bits of near depths)
+    if (offsets[Digit(keys[0], pass)] == count)
+      continue;
+
+    uint32_t sum = 0;
+    for (uint32_t d = 0; d < RADIX_SIZE; d++) {
+      uint32_t c = offsets[d];
+      offsets[d] = sum;
+      sum += c;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      uint32_t dst = offsets[Digit(keys[i], pass)]++;
+      keysTmp[dst] = keys[i];
+      valuesTmp[dst] = order[i];
+    }
+    keys.swap(keysTmp);
+    order.swap(valuesTmp);
+  }
+}
+
+void DepthSorter::SortParallel(size_t count, std::vector<uint32_t>& order) {
+  ThreadPool& pool = ThreadPool::GetInstance();
+
+  order.resize(count);
+  keysTmp.resize(count);
+  valuesTmp.resize(count);
+
+  // Fixed blocks, so histogram and scatter passes see the same split
+  uint32_t blocksCount = (uint32_t)std::min<size_t>(pool.GetWorkersCount() + 1, (count + RADIX_MIN_BLOCK - 1) / RADIX_MIN_BLOCK);
+  uint32_t blockSize = (uint32_t)((count + blocksCount - 1) / blocksCount);
+  histograms.resize(blocksCount * RADIX_SIZE);
+
+  uint32_t* values = order.data();
+  pool.ParallelFor(blocksCount, 1, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t b = begin; b < end; b++) {
+      uint32_t first = b * blockSize;
+      uint32_t last = (uint32_t)std::min<size_t>(first + blockSize, count);
+      for (uint32_t i = first; i < last; i++)
+        values[i] = i;
+    }
+  });
+
+  for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+    const uint32_t* srcKeys = keys.data();
+    const uint32_t* srcValues = order.data();
+    uint32_t* dstKeys = keysTmp.data();
+    uint32_t* dstValues = valuesTmp.data();
+    uint32_t* blockHistograms = histograms.data();
+
+    pool.ParallelFor(blocksCount, 1, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t b = begin; b < end; b++) {
+        uint32_t* hist = blockHistograms + b * RADIX_SIZE;
+        std::fill(hist, hist + RADIX_SIZE, 0u);
+        uint32_t first = b * blockSize;
+        uint32_t last = (uint32_t)std::min<size_t>(first + blockSize, count);
+        for (uint32_t i = first; i < last; i++)
+          hist[Digit(srcKeys[i], pass)]++;
+      }
+    });
+
+    // Digit major, block minor prefix sum keeps sort stable
+    uint32_t sum = 0;
+    bool single = false;
+    for (uint32_t d = 0; d < RADIX_SIZE && !single; d++) {
+      uint32_t digitStart = sum;
+      for (uint32_t b = 0; b < blocksCount; b++) {
+        uint32_t c = blockHistograms[b * RADIX_SIZE + d];
+        blockHistograms[b * RADIX_SIZE + d] = sum;
+        sum += c;
+      }
+      single = (sum - digitStart == count);
+    }
+    if (single)
+      continue;
+
+    pool.ParallelFor(blocksCount, 1, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t b = begin; b < end; b++) {
+        uint32_t* offsets = blockHistograms + b * RADIX_SIZE;
+        uint32_t first = b * blockSize;
+        uint32_t last = (uint32_t)std::min<size_t>(first + blockSize, count);
+        for (uint32_t i = first; i < last; i++) {
+          uint32_t dst = offsets[Digit(srcKeys[i], pass)]++;
+          dstKeys[dst] = srcKeys[i];
+          dstValues[dst] = srcValues[i];
+        }
+      }
+    });
+    keys.swap(keysTmp);
+    order.swap(valuesTmp);
+  }
+}
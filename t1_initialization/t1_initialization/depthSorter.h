@@ -0,0 +1,39 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+// Below this count sort runs on calling thread only
+#define DEPTH_SORT_PARALLEL_MIN 16384
+
+// Back to front ordering of transparent instances by view space depth.
+// Device free, keys are built with DirectXMath and sorted with LSD radix sort.
+class DepthSorter {
+public:
+  // Monotonic float -> uint mapping, reversed so that ascending keys go from far to near
+  static uint32_t DepthToKey(float depth);
+
+  // Key of each instance center (translation row of world matrix), 4 instances per SIMD step
+  static void ComputeKeys(const XMMATRIX* worldMatrices, size_t count, const XMMATRIX& viewMatrix, uint32_t* keys);
+
+  // Stable ascending sort of [0, count) by keys, scratch buffers are kept between calls
+  void Sort(const uint32_t* keys, size_t count, std::vector<uint32_t>& order);
+
+  // ComputeKeys + Sort
+  void SortBackToFront(const XMMATRIX* worldMatrices, size_t count, const XMMATRIX& viewMatrix, std::vector<uint32_t>& order);
+
+private:
+  // Sorts member keys, picks serial or parallel path by count
+  void SortKeys(size_t count, std::vector<uint32_t>& order);
+  void SortSerial(size_t count, std::vector<uint32_t>& order);
+  void SortParallel(size_t count, std::vector<uint32_t>& order);
+
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> keysTmp;
+  std::vector<uint32_t> valuesTmp;
+  // 256 counters per block (parallel) or per digit (serial)
+  std::vector<uint32_t> histograms;
+};
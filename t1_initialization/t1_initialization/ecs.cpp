@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+#include "ecs.h"
+
+namespace {
+  std::mutex registryMutex;
+  uint32_t componentsCount = 0;
+  uint32_t componentSizes[ECS_MAX_COMPONENTS] = {};
+  uint32_t componentAlignments[ECS_MAX_COMPONENTS] = {};
+
+  uint32_t AlignUp(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  // Entity ids go first, then one array per component in id order. Arrays are packed
+  // to component alignment only, chunk start is ECS_CHUNK_ALIGNMENT aligned so it holds
+  uint32_t ChunkBytes(ComponentMask mask, uint32_t capacity, uint32_t offsets[ECS_MAX_COMPONENTS]) {
+    uint32_t offset = capacity * (uint32_t)sizeof(Entity);
+    for (uint32_t id = 0; id < ECS_MAX_COMPONENTS; id++) {
+      if (!(mask & (1u << id)))
+        continue;
+      offset = AlignUp(offset, componentAlignments[id]);
+      if (offsets)
+        offsets[id] = offset;
+      offset += capacity * componentSizes[id];
+    }
+    return offset;
+  }
+}
+
+uint32_t ComponentRegistry::Register(uint32_t size, uint32_t alignment) {
+  assert(alignment > 0 && alignment <= ECS_CHUNK_ALIGNMENT && (alignment & (alignment - 1)) == 0);
+  std::lock_guard<std::mutex> lock(registryMutex);
+  assert(componentsCount < ECS_MAX_COMPONENTS);
+  componentSizes[componentsCount] = size;
+  componentAlignments[componentsCount] = alignment;
+  return componentsCount++;
+}
+
+uint32_t ComponentRegistry::GetSize(uint32_t id) {
+  return componentSizes[id];
+}
+
+uint32_t ComponentRegistry::GetAlignment(uint32_t id) {
+  return componentAlignments[id];
+}
+
+uint32_t World::GetArchetype(ComponentMask mask) {
+  auto found = archetypeByMask.find(mask);
+  if (found != archetypeByMask.end())
+    return found->second;
+
+  auto archetype = std::make_unique<Archetype>();
+  archetype->mask = mask;
+
+  // Per entity bytes give first guess, alignment padding is taken off after
+  uint32_t entityBytes = (uint32_t)sizeof(Entity);
+  for (uint32_t id = 0; id < ECS_MAX_COMPONENTS; id++)
+    if (mask & (1u << id))
+      entityBytes += componentSizes[id];
+  uint32_t capacity = (std::max)(ECS_CHUNK_SIZE / entityBytes, 1u);
+  while (capacity > 1 && ChunkBytes(mask, capacity, nullptr) > ECS_CHUNK_SIZE)
+    capacity--;
+  archetype->capacity = capacity;
+  ChunkBytes(mask, capacity, archetype->offsets);
+  for (uint32_t id = 0; id < ECS_MAX_COMPONENTS; id++)
+    if (mask & (1u << id))
+      archetype->componentIds[archetype->componentsCount++] = id;
+
+  uint32_t index = (uint32_t)archetypes.size();
+  archetypes.push_back(std::move(archetype));
+  archetypeByMask[mask] = index;
+  return index;
+}
+
+void World::AddRow(Archetype& archetype, uint32_t& chunk, uint32_t& row) {
+  if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity) {
+    uint32_t bytes = (std::max)(ChunkBytes(archetype.mask, archetype.capacity, nullptr), (uint32_t)ECS_CHUNK_SIZE);
+    ArchetypeChunk newChunk;
+    newChunk.memory.reset(new uint8_t[bytes + ECS_CHUNK_ALIGNMENT]);
+    uintptr_t address = reinterpret_cast<uintptr_t>(newChunk.memory.get());
+    newChunk.data = reinterpret_cast<uint8_t*>((address + ECS_CHUNK_ALIGNMENT - 1) & ~uintptr_t(ECS_CHUNK_ALIGNMENT - 1));
+    archetype.chunks.push_back(std::move(newChunk));
+  }
+
+  chunk = (uint32_t)archetype.chunks.size() - 1;
+  ArchetypeChunk& last = archetype.chunks.back();
+  row = last.count++;
+  archetype.entitiesCount++;
+
+  for (uint32_t i = 0; i < archetype.componentsCount; i++) {
+    uint32_t id = archetype.componentIds[i];
+    memset(last.data + archetype.offsets[id] + row * componentSizes[id], 0, componentSizes[id]);
+  }
+}
+
+void World::RemoveRow(uint32_t archetypeIndex, uint32_t chunk, uint32_t row) {
+  Archetype& archetype = *archetypes[archetypeIndex];
+  ArchetypeChunk& last = archetype.chunks.back();
+  uint32_t lastChunk = (uint32_t)archetype.chunks.size() - 1;
+  uint32_t lastRow = last.count - 1;
+
+  if (chunk != lastChunk || row != lastRow) {
+    ArchetypeChunk& dst = archetype.chunks[chunk];
+    Entity moved = last.GetEntities()[lastRow];
+    dst.GetEntities()[row] = moved;
+    for (uint32_t i = 0; i < archetype.componentsCount; i++) {
+      uint32_t id = archetype.componentIds[i];
+      uint32_t size = componentSizes[id];
+      memcpy(dst.data + archetype.offsets[id] + row * size, last.data + archetype.offsets[id] + lastRow * size, size);
+    }
+    records[moved.index].chunk = chunk;
+    records[moved.index].row = row;
+  }
+
+  last.count--;
+  archetype.entitiesCount--;
+  if (last.count == 0)
+    archetype.chunks.pop_back();
+}
+
+Entity World::Create(ComponentMask mask) {
+  uint32_t index;
+  if (!freeRecords.empty()) {
+    index = freeRecords.back();
+    freeRecords.pop_back();
+  }
+  else {
+    index = (uint32_t)records.size();
+    records.emplace_back();
+  }
+
+  EntityRecord& record = records[index];
+  record.archetype = GetArchetype(mask);
+  Archetype& archetype = *archetypes[record.archetype];
+  AddRow(archetype, record.chunk, record.row);
+
+  Entity entity;
+  entity.index = index;
+  entity.generation = record.generation;
+  archetype.chunks[record.chunk].GetEntities()[record.row] = entity;
+  return entity;
+}
+
+bool World::IsAlive(Entity entity) const {
+  return entity.index < records.size() && records[entity.index].generation == entity.generation &&
+    records[entity.index].archetype != UINT32_MAX;
+}
+
+void World::Destroy(Entity entity) {
+  if (!IsAlive(entity))
+    return;
+
+  EntityRecord& record = records[entity.index];
+  RemoveRow(record.archetype, record.chunk, record.row);
+  record.archetype = UINT32_MAX;
+  record.generation++;
+  freeRecords.push_back(entity.index);
+}
+
+ComponentMask World::GetMask(Entity entity) const {
+  return IsAlive(entity) ? archetypes[records[entity.index].archetype]->mask : 0;
+}
+
+void World::SetMask(Entity entity, ComponentMask mask) {
+  if (!IsAlive(entity))
+    return;
+
+  EntityRecord& record = records[entity.index];
+  uint32_t srcIndex = record.archetype;
+  uint32_t dstIndex = GetArchetype(mask);
+  if (srcIndex == dstIndex)
+    return;
+
+  // GetArchetype may grow archetypes, references are taken after it
+  Archetype& src = *archetypes[srcIndex];
+  Archetype& dst = *archetypes[dstIndex];
+  uint32_t dstChunk, dstRow;
+  AddRow(dst, dstChunk, dstRow);
+
+  const ArchetypeChunk& from = src.chunks[record.chunk];
+  ArchetypeChunk& to = dst.chunks[dstChunk];
+  to.GetEntities()[dstRow] = entity;
+  for (uint32_t i = 0; i < dst.componentsCount; i++) {
+    uint32_t id = dst.componentIds[i];
+    if (!(src.mask & (1u << id)))
+      continue;
+    uint32_t size = componentSizes[id];
+    memcpy(to.data + dst.offsets[id] + dstRow * size, from.data + src.offsets[id] + record.row * size, size);
+  }
+
+  RemoveRow(srcIndex, record.chunk, record.row);
+  record.archetype = dstIndex;
+  record.chunk = dstChunk;
+  record.row = dstRow;
+}
+
+void* World::GetComponent(Entity entity, uint32_t id) {
+  if (!IsAlive(entity))
+    return nullptr;
+
+  const EntityRecord& record = records[entity.index];
+  const Archetype& archetype = *archetypes[record.archetype];
+  if (!(archetype.mask & (1u << id)))
+    return nullptr;
+  return archetype.chunks[record.chunk].data + archetype.offsets[id] + record.row * componentSizes[id];
+}
+
+uint32_t World::Count(ComponentMask mask) const {
+  uint32_t count = 0;
+  for (auto& archetype : archetypes)
+    if ((archetype->mask & mask) == mask)
+      count += archetype->entitiesCount;
+  return count;
+}
+
+void World::Clear() {
+  // Archetypes stay, so their layouts are reused. Old handles stay invalid after clear
+  for (auto& archetype : archetypes) {
+    archetype->chunks.clear();
+    archetype->entitiesCount = 0;
+  }
+  freeRecords.clear();
+  for (uint32_t i = 0; i < records.size(); i++) {
+    if (records[i].archetype != UINT32_MAX) {
+      records[i].archetype = UINT32_MAX;
+      records[i].generation++;
+    }
+    freeRecords.push_back(i);
+  }
+}
+
+void World::CollectChunks(ComponentMask mask, std::vector<ChunkRef>& refs) const {
+  refs.clear();
+  for (uint32_t i = 0; i < archetypes.size(); i++) {
+    const Archetype& archetype = *archetypes[i];
+    if ((archetype.mask & mask) != mask)
+      continue;
+    for (uint32_t j = 0; j < archetype.chunks.size(); j++)
+      refs.push_back({ i, j });
+  }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "threadPool.h"
+
+// Bytes of one archetype chunk, each component of chunk entities lies in its own array (SoA).
+// Chunk start is aligned to ECS_CHUNK_ALIGNMENT, arrays in it - to their component alignment
+#define ECS_CHUNK_SIZE 16384
+#define ECS_CHUNK_ALIGNMENT 64
+#define ECS_MAX_COMPONENTS 32
+
+typedef uint32_t ComponentMask;
+
+struct Entity {
+  uint32_t index = UINT32_MAX;
+  uint32_t generation = 0;
+};
+
+// Component types get ids on first use, only trivially copyable structs are allowed
+class ComponentRegistry {
+public:
+  static uint32_t Register(uint32_t size, uint32_t alignment);
+  static uint32_t GetSize(uint32_t id);
+  static uint32_t GetAlignment(uint32_t id);
+};
+
+template<typename T>
+uint32_t ComponentId() {
+  static_assert(std::is_trivially_copyable<T>::value, "components are moved with memcpy");
+  static const uint32_t id = ComponentRegistry::Register((uint32_t)sizeof(T), (uint32_t)alignof(T));
+  return id;
+}
+
+template<typename... T>
+ComponentMask ComponentMaskOf() {
+  ComponentMask mask = 0;
+  int expand[] = { 0, (mask |= 1u << ComponentId<T>(), 0)... };
+  (void)expand;
+  return mask;
+}
+
+// All entities with the same set of components, kept densely in chunks:
+// every chunk but the last one is full
+struct ArchetypeChunk {
+  std::unique_ptr<uint8_t[]> memory;
+  uint8_t* data = nullptr;  // ECS_CHUNK_ALIGNMENT aligned start of memory
+  uint32_t count = 0;
+
+  Entity* GetEntities() const { return reinterpret_cast<Entity*>(data); };
+};
+
+struct Archetype {
+  ComponentMask mask = 0;
+  uint32_t capacity = 0;                          // entities per chunk
+  uint32_t offsets[ECS_MAX_COMPONENTS] = {};      // array offset in chunk by component id
+  uint32_t componentIds[ECS_MAX_COMPONENTS] = {}; // ids of mask bits, so row copies skip absent components
+  uint32_t componentsCount = 0;
+  std::vector<ArchetypeChunk> chunks;
+  uint32_t entitiesCount = 0;
+};
+
+// Archetype based entity / component storage. Device free.
+// Queries walk chunks, so inner loops get plain arrays of each requested component.
+class World {
+public:
+  Entity Create(ComponentMask mask);
+
+  template<typename... T>
+  Entity Create() { return Create(ComponentMaskOf<T...>()); };
+
+  // Last entity of archetype takes place of destroyed one
+  void Destroy(Entity entity);
+  bool IsAlive(Entity entity) const;
+
+  // Entity is moved to archetype of new mask, common components are kept, new ones are zeroed
+  void SetMask(Entity entity, ComponentMask mask);
+  ComponentMask GetMask(Entity entity) const;
+
+  template<typename T>
+  void Add(Entity entity) { SetMask(entity, GetMask(entity) | ComponentMaskOf<T>()); };
+
+  template<typename T>
+  void Remove(Entity entity) { SetMask(entity, GetMask(entity) & ~ComponentMaskOf<T>()); };
+
+  // nullptr if entity doesn't have component
+  template<typename T>
+  T* Get(Entity entity) { return static_cast<T*>(GetComponent(entity, ComponentId<T>())); };
+
+  // Number of entities having all components of mask
+  uint32_t Count(ComponentMask mask) const;
+
+  template<typename... T>
+  uint32_t Count() const { return Count(ComponentMaskOf<T...>()); };
+
+  void Clear();
+
+  // func(count, entities, T*...) for every chunk with all requested components.
+  // Chunks go in archetype creation order, entities - in chunk order
+  template<typename... T, typename Func>
+  void ForEachChunk(Func func) {
+    ComponentMask mask = ComponentMaskOf<T...>();
+    for (auto& archetype : archetypes) {
+      if ((archetype->mask & mask) != mask)
+        continue;
+      for (auto& chunk : archetype->chunks)
+        if (chunk.count > 0)
+          func(chunk.count, (const Entity*)chunk.GetEntities(), reinterpret_cast<T*>(chunk.data + archetype->offsets[ComponentId<T>()])...);
+    }
+  };
+
+  // Same as ForEachChunk but chunks are split between thread pool workers,
+  // func must only touch data of its own chunk
+  template<typename... T, typename Func>
+  void ParallelForEachChunk(Func func) {
+    CollectChunks(ComponentMaskOf<T...>(), parallelChunks);
+    ThreadPool::GetInstance().ParallelFor((uint32_t)parallelChunks.size(), 1, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; i++) {
+        const Archetype& archetype = *archetypes[parallelChunks[i].archetype];
+        const ArchetypeChunk& chunk = archetype.chunks[parallelChunks[i].chunk];
+        func(chunk.count, (const Entity*)chunk.GetEntities(), reinterpret_cast<T*>(chunk.data + archetype.offsets[ComponentId<T>()])...);
+      }
+    });
+  };
+
+private:
+  struct EntityRecord {
+    uint32_t archetype = UINT32_MAX;
+    uint32_t chunk = 0;
+    uint32_t row = 0;
+    uint32_t generation = 0;
+  };
+
+  struct ChunkRef {
+    uint32_t archetype;
+    uint32_t chunk;
+  };
+
+  uint32_t GetArchetype(ComponentMask mask);
+  // Appends zeroed row, returns its chunk and row
+  void AddRow(Archetype& archetype, uint32_t& chunk, uint32_t& row);
+  // Fills the hole with last row of archetype
+  void RemoveRow(uint32_t archetypeIndex, uint32_t chunk, uint32_t row);
+  void* GetComponent(Entity entity, uint32_t id);
+
+  void CollectChunks(ComponentMask mask, std::vector<ChunkRef>& refs) const;
+
+  std::vector<std::unique_ptr<Archetype>> archetypes;
+  std::unordered_map<ComponentMask, uint32_t> archetypeByMask;
+
+  std::vector<EntityRecord> records;
+  std::vector<uint32_t> freeRecords;
+
+  std::vector<ChunkRef> parallelChunks;
+};
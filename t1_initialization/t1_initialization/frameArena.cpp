@@ -0,0 +1,110 @@
+#include <cstring>
+#include <mutex>
+
+#include "frameArena.h"
+
+namespace {
+  std::mutex arenasMutex;
+
+  std::vector<FrameArena*>& GetArenas() {
+    static std::vector<FrameArena*> arenas;
+    return arenas;
+  }
+
+  // Registers arena of thread for ResetAll while thread lives
+  struct ThreadArena {
+    FrameArena arena;
+
+    ThreadArena() {
+      std::lock_guard<std::mutex> lock(arenasMutex);
+      GetArenas().push_back(&arena);
+    }
+
+    ~ThreadArena() {
+      std::lock_guard<std::mutex> lock(arenasMutex);
+      auto& arenas = GetArenas();
+      arenas.erase(std::find(arenas.begin(), arenas.end(), &arena));
+    }
+  };
+}
+
+FrameArena::FrameArena(size_t blockSize) : blockSize(blockSize) {}
+
+FrameArena& FrameArena::GetThreadArena() {
+  static thread_local ThreadArena threadArena;
+  return threadArena.arena;
+}
+
+void FrameArena::ResetAll() {
+  std::lock_guard<std::mutex> lock(arenasMutex);
+  for (FrameArena* arena : GetArenas())
+    arena->Reset();
+}
+
+FrameArenaStats FrameArena::GetTotalStats() {
+  std::lock_guard<std::mutex> lock(arenasMutex);
+  FrameArenaStats total;
+  for (FrameArena* arena : GetArenas()) {
+    const FrameArenaStats& stats = arena->GetStats();
+    total.used += stats.used;
+    total.highWater += stats.highWater;
+    total.capacity += stats.capacity;
+    total.blockAllocations += stats.blockAllocations;
+  }
+  return total;
+}
+
+void FrameArena::AddBlock(size_t size) {
+  Block block;
+  block.memory.reset(new uint8_t[size]);
+  block.size = size;
+#if FRAME_ARENA_POISON
+  memset(block.memory.get(), FRAME_ARENA_POISON_BYTE, size);
+#endif
+  blocks.push_back(std::move(block));
+  stats.capacity += size;
+  stats.blockAllocations++;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+  if (blocks.empty())
+    AddBlock((std::max)(blockSize, size + alignment));
+
+  for (;;) {
+    const Block& block = blocks[current];
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+    uintptr_t aligned = (base + offset + alignment - 1) & ~uintptr_t(alignment - 1);
+    size_t end = size_t(aligned - base) + size;
+    if (end <= block.size) {
+      stats.used += end - offset;
+      stats.highWater = (std::max)(stats.highWater, stats.used);
+      offset = end;
+      return reinterpret_cast<void*>(aligned);
+    }
+
+    // Rest of current block stays unused till reset
+    current++;
+    offset = 0;
+    if (current == blocks.size())
+      AddBlock((std::max)(blockSize, size + alignment));
+  }
+}
+
+void FrameArena::Reset() {
+#if FRAME_ARENA_POISON
+  for (size_t i = 0; i < blocks.size() && i <= current; i++)
+    memset(blocks[i].memory.get(), FRAME_ARENA_POISON_BYTE, i == current ? offset : blocks[i].size);
+#endif
+
+  // Frame didn't fit in one block: next frames get one block of all of them
+  if (blocks.size() > 1) {
+    size_t total = stats.capacity;
+    blocks.clear();
+    stats.capacity = 0;
+    AddBlock(total);
+  }
+
+  current = 0;
+  offset = 0;
+  stats.used = 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// First block of every thread arena, grows to frame high water mark
+#define FRAME_ARENA_BLOCK_SIZE (256 * 1024)
+#define FRAME_ARENA_ALIGNMENT 16
+
+// Debug builds fill released memory, so data kept past frame end shows up as 0xDD
+#if !defined(FRAME_ARENA_POISON) && defined(_DEBUG)
+#define FRAME_ARENA_POISON 1
+#endif
+#define FRAME_ARENA_POISON_BYTE 0xDD
+
+struct FrameArenaStats {
+  size_t used = 0;            // bytes taken since last reset
+  size_t highWater = 0;       // most bytes one frame took
+  size_t capacity = 0;        // bytes of all blocks
+  uint32_t blockAllocations = 0;  // heap allocations made by arena so far
+};
+
+// Linear (bump) allocator for data living until frame end. Nothing is freed one by one:
+// Reset releases everything at once. If frame overflowed first block, blocks are merged on reset,
+// so in steady state arena doesn't touch heap at all. Not thread safe, every thread has its own arena.
+class FrameArena {
+public:
+  explicit FrameArena(size_t blockSize = FRAME_ARENA_BLOCK_SIZE);
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  // Arena of calling thread, created on first use
+  static FrameArena& GetThreadArena();
+
+  // Resets arenas of all threads. Called at frame end, when no job uses arena memory
+  static void ResetAll();
+
+  // Stats summed over all thread arenas
+  static FrameArenaStats GetTotalStats();
+
+  void* Allocate(size_t size, size_t alignment = FRAME_ARENA_ALIGNMENT);
+
+  // Default initialized array, destructors are never called
+  template<typename T>
+  T* Allocate(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value, "frame arena never calls destructors");
+    T* data = static_cast<T*>(Allocate(sizeof(T) * count, (std::max)(alignof(T), (size_t)FRAME_ARENA_ALIGNMENT)));
+    for (size_t i = 0; i < count; i++)
+      new (data + i) T;
+    return data;
+  };
+
+  void Reset();
+
+  const FrameArenaStats& GetStats() const { return stats; };
+private:
+  struct Block {
+    std::unique_ptr<uint8_t[]> memory;
+    size_t size;
+  };
+
+  void AddBlock(size_t size);
+
+  std::vector<Block> blocks;
+  size_t blockSize;
+  size_t current = 0;  // block allocations go to
+  size_t offset = 0;   // in current block
+  FrameArenaStats stats;
+};
+
+// STL allocator on frame arena, deallocate does nothing
+template<typename T>
+class FrameAllocator {
+public:
+  typedef T value_type;
+
+  FrameAllocator() : arena(&FrameArena::GetThreadArena()) {};
+  explicit FrameAllocator(FrameArena& arena) : arena(&arena) {};
+
+  template<typename U>
+  FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {};
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(arena->Allocate(sizeof(T) * count, (std::max)(alignof(T), (size_t)FRAME_ARENA_ALIGNMENT)));
+  };
+  void deallocate(T*, size_t) {};
+
+  template<typename U>
+  bool operator==(const FrameAllocator<U>& other) const { return arena == other.arena; };
+  template<typename U>
+  bool operator!=(const FrameAllocator<U>& other) const { return arena != other.arena; };
+
+  FrameArena* arena;
+};
+
+// Temporary vector of current frame, must not outlive it
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
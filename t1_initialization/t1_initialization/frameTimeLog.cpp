@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "frameTimeLog.h"
+
+void FrameTimeLog::Init(uint32_t capacity) {
+  times.clear();
+  times.reserve(capacity);
+}
+
+void FrameTimeLog::Add(double milliseconds) {
+  if (times.size() < times.capacity())
+    times.push_back(milliseconds);
+}
+
+FrameTimeStats FrameTimeLog::GetStats() const {
+  FrameTimeStats stats;
+  if (times.empty())
+    return stats;
+
+  std::vector<double> sorted(times);
+  std::sort(sorted.begin(), sorted.end());
+
+  double sum = 0.0;
+  for (double time : sorted)
+    sum += time;
+
+  // Nearest rank percentiles
+  auto percentile = [&](double p) {
+    size_t rank = (size_t)ceil(p * sorted.size());
+    return sorted[(std::min)((std::max)(rank, (size_t)1), sorted.size()) - 1];
+  };
+
+  stats.count = (uint32_t)sorted.size();
+  stats.min = sorted.front();
+  stats.max = sorted.back();
+  stats.mean = sum / sorted.size();
+  stats.p50 = percentile(0.50);
+  stats.p95 = percentile(0.95);
+  stats.p99 = percentile(0.99);
+  return stats;
+}
+
+void FrameTimeLog::WriteCSV(std::string& text) const {
+  FrameTimeStats stats = GetStats();
+
+  char line[128];
+  snprintf(line, sizeof(line), "# frames,%u\n# min,%.4f\n# mean,%.4f\n# p50,%.4f\n", stats.count, stats.min, stats.mean, stats.p50);
+  text += line;
+  snprintf(line, sizeof(line), "# p95,%.4f\n# p99,%.4f\n# max,%.4f\nframe,ms\n", stats.p95, stats.p99, stats.max);
+  text += line;
+  for (size_t i = 0; i < times.size(); i++) {
+    snprintf(line, sizeof(line), "%u,%.4f\n", (uint32_t)i, times[i]);
+    text += line;
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Summary of logged frames, milliseconds
+struct FrameTimeStats {
+  uint32_t count = 0;
+  double min = 0.0;
+  double max = 0.0;
+  double mean = 0.0;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+};
+
+// Frame times of benchmark run. Storage is reserved up front, so logging doesn't allocate
+class FrameTimeLog {
+public:
+  void Init(uint32_t capacity);
+  // Frames over capacity are dropped
+  void Add(double milliseconds);
+
+  FrameTimeStats GetStats() const;
+
+  // CSV: summary lines, then "frame,ms" per frame
+  void WriteCSV(std::string& text) const;
+
+  uint32_t GetCount() const { return (uint32_t)times.size(); };
+private:
+  std::vector<double> times;
+};
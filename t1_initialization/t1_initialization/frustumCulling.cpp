@@ -100,20 +100,30 @@ void FrustumCulling::ConstructFrustum(XMMATRIX viewMatrix, XMMATRIX projectionMa
   planes[5].w /= length;
 }
 
-bool FrustumCulling::CheckRectangle(XMFLOAT4 bbMin, XMFLOAT4 bbMax) {
-  for (int i = 0; i < 6; i++) {
-    if (((planes[i].x * bbMin.x) + (planes[i].y * bbMin.y) + (planes[i].z * bbMin.z) + (planes[i].w * 1.0f)) >= 0.0f ||
-      ((planes[i].x * bbMax.x) + (planes[i].y * bbMin.y) + (planes[i].z * bbMin.z) + (planes[i].w * 1.0f)) >= 0.0f ||
-      ((planes[i].x * bbMin.x) + (planes[i].y * bbMax.y) + (planes[i].z * bbMin.z) + (planes[i].w * 1.0f)) >= 0.0f ||
-      ((planes[i].x * bbMax.x) + (planes[i].y * bbMax.y) + (planes[i].z * bbMin.z) + (planes[i].w * 1.0f)) >= 0.0f ||
-      ((planes[i].x * bbMin.x) + (planes[i].y * bbMin.y) + (planes[i].z * bbMax.z) + (planes[i].w * 1.0f)) >= 0.0f ||
-      ((planes[i].x * bbMax.x) + (planes[i].y * bbMin.y) + (planes[i].z * bbMax.z) + (planes[i].w * 1.0f)) >= 0.0f ||
-      ((planes[i].x * bbMin.x) + (planes[i].y * bbMax.y) + (planes[i].z * bbMax.z) + (planes[i].w * 1.0f)) >= 0.0f ||
-      ((planes[i].x * bbMax.x) + (planes[i].y * bbMax.y) + (planes[i].z * bbMax.z) + (planes[i].w * 1.0f)) >= 0.0f)
-      continue;
-    else
+bool FrustumCulling::IsOutside(const XMFLOAT4& plane, const XMFLOAT4& bbMin, const XMFLOAT4& bbMax) {
+  return !(((plane.x * bbMin.x) + (plane.y * bbMin.y) + (plane.z * bbMin.z) + (plane.w * 1.0f)) >= 0.0f ||
+    ((plane.x * bbMax.x) + (plane.y * bbMin.y) + (plane.z * bbMin.z) + (plane.w * 1.0f)) >= 0.0f ||
+    ((plane.x * bbMin.x) + (plane.y * bbMax.y) + (plane.z * bbMin.z) + (plane.w * 1.0f)) >= 0.0f ||
+    ((plane.x * bbMax.x) + (plane.y * bbMax.y) + (plane.z * bbMin.z) + (plane.w * 1.0f)) >= 0.0f ||
+    ((plane.x * bbMin.x) + (plane.y * bbMin.y) + (plane.z * bbMax.z) + (plane.w * 1.0f)) >= 0.0f ||
+    ((plane.x * bbMax.x) + (plane.y * bbMin.y) + (plane.z * bbMax.z) + (plane.w * 1.0f)) >= 0.0f ||
+    ((plane.x * bbMin.x) + (plane.y * bbMax.y) + (plane.z * bbMax.z) + (plane.w * 1.0f)) >= 0.0f ||
+    ((plane.x * bbMax.x) + (plane.y * bbMax.y) + (plane.z * bbMax.z) + (plane.w * 1.0f)) >= 0.0f);
+}
+
+bool FrustumCulling::IsBoxInside(const XMFLOAT4* planes, const XMFLOAT4& bbMin, const XMFLOAT4& bbMax, uint32_t& lastPlane) {
+  for (uint32_t k = 0; k < 6; k++) {
+    uint32_t i = (lastPlane + k) % 6;
+    if (IsOutside(planes[i], bbMin, bbMax)) {
+      lastPlane = i;
       return false;
+    }
   }
 
   return true;
 }
+
+bool FrustumCulling::CheckRectangle(XMFLOAT4 bbMin, XMFLOAT4 bbMax) {
+  uint32_t firstPlane = 0;
+  return IsBoxInside(planes, bbMin, bbMax, firstPlane);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <directxmath.h>
+#include <cstdint>
 
 using namespace DirectX;
 
@@ -15,6 +16,13 @@ public:
   bool CheckRectangle(XMFLOAT4 bbMin, XMFLOAT4 bbMax);
 
   XMFLOAT4* GetPlanes() { return planes; };
+
+  // True if all box corners are behind plane
+  static bool IsOutside(const XMFLOAT4& plane, const XMFLOAT4& bbMin, const XMFLOAT4& bbMax);
+
+  // Same order as IsBoxInside of FrustumCullingShader.hlsl: planes go round starting from lastPlane,
+  // it gets the one that rejected box
+  static bool IsBoxInside(const XMFLOAT4* planes, const XMFLOAT4& bbMin, const XMFLOAT4& bbMax, uint32_t& lastPlane);
 private:
   float screenDepth;
   XMFLOAT4 planes[6];
@@ -1,3 +1,5 @@
+#include <cstring>
+
 #include "input.h"
 
 HRESULT Input::InitInputs(const HINSTANCE& g_hInstance, const HWND& hwnd, UINT screenWidth, UINT screenHeight) {
@@ -49,6 +51,7 @@ HRESULT Input::InitInputs(const HINSTANCE& g_hInstance, const HWND& hwnd, UINT s
 bool Input::Frame() {
   bool result;
 
+  memcpy(prevKeyboardState, keyboardState, sizeof(keyboardState));
   result = ReadKeyboard();
   if (!result)
     return false;
@@ -99,6 +102,16 @@ float Input::IsPlusMinusPressed() {
     return 0.f;
 };
 
+bool Input::IsKeyPressedOnce(unsigned char key) {
+  return (keyboardState[key] & 0x80) && !(prevKeyboardState[key] & 0x80);
+}
+
+void Input::GetState(InputState& state) {
+  state.mouseMove = IsMouseUsed();
+  for (int key = 0; key < 256; key++)
+    state.SetKey((uint8_t)key, (keyboardState[key] & 0x80) != 0);
+}
+
 void Input::Resize(UINT screenWidth, UINT screenHeight) {
   wWidth = screenWidth;
   wHeight = screenHeight;
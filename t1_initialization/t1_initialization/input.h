@@ -9,6 +9,8 @@
 #include <dinput.h>
 #include <directxmath.h>
 
+#include "inputTrace.h"
+
 using namespace DirectX;
 
 class Input {
@@ -25,6 +27,11 @@ public:
   // Useful methods
   XMFLOAT3 IsMouseUsed();
   float IsPlusMinusPressed();
+  // True only on the frame key went down (DIK_* code)
+  bool IsKeyPressedOnce(unsigned char key);
+
+  // Device independent state of this frame, for recording and replacing by playback
+  void GetState(InputState& state);
 
   void Resize(UINT screenWidth, UINT screenHeight);
   UINT GetWidth() { return wWidth; }
@@ -39,7 +46,8 @@ private:
   IDirectInputDevice8* keyboard = nullptr;
   IDirectInputDevice8* mouse = nullptr;
 
-  unsigned char keyboardState[256];
+  unsigned char keyboardState[256] = {};
+  unsigned char prevKeyboardState[256] = {};
   DIMOUSESTATE mouseState = {};
 
   UINT wWidth = 0, wHeight = 0;
@@ -0,0 +1,113 @@
+#include <cstring>
+
+#include "inputTrace.h"
+
+void InputState::SetKey(uint8_t key, bool down) {
+  if (down)
+    keys[key >> 3] |= (uint8_t)(1 << (key & 7));
+  else
+    keys[key >> 3] &= (uint8_t)~(1 << (key & 7));
+}
+
+void InputRecorder::Begin() {
+  events.clear();
+  prevState = InputState();
+  framesCount = 0;
+}
+
+void InputRecorder::Record(const InputState& state, float time) {
+  InputEvent event = {};
+  event.frame = framesCount;
+  event.time = time;
+
+  // Mouse move is relative, it is stored for every frame it is not zero
+  if (state.mouseMove.x != 0.0f || state.mouseMove.y != 0.0f || state.mouseMove.z != 0.0f) {
+    event.type = INPUT_EVENT_MOUSE_MOVE;
+    event.value = state.mouseMove;
+    events.push_back(event);
+  }
+
+  // Keys are stored on change only
+  event.value = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  for (uint32_t i = 0; i < sizeof(state.keys); i++) {
+    uint8_t changed = state.keys[i] ^ prevState.keys[i];
+    for (uint32_t bit = 0; changed; bit++, changed >>= 1) {
+      if (!(changed & 1))
+        continue;
+      event.key = (uint8_t)(i * 8 + bit);
+      event.type = state.IsKeyDown(event.key) ? INPUT_EVENT_KEY_DOWN : INPUT_EVENT_KEY_UP;
+      events.push_back(event);
+    }
+  }
+
+  prevState = state;
+  framesCount++;
+}
+
+void InputRecorder::Serialize(std::vector<uint8_t>& data) const {
+  InputTraceHeader header = {};
+  header.magic = INPUT_TRACE_MAGIC;
+  header.version = INPUT_TRACE_VERSION;
+  header.eventsCount = (uint32_t)events.size();
+  header.framesCount = framesCount;
+
+  data.resize(sizeof(header) + sizeof(InputEvent) * events.size());
+  memcpy(data.data(), &header, sizeof(header));
+  if (!events.empty())
+    memcpy(data.data() + sizeof(header), events.data(), sizeof(InputEvent) * events.size());
+}
+
+bool InputPlayer::Parse(const uint8_t* data, size_t size) {
+  events.clear();
+  framesCount = 0;
+  Rewind();
+
+  InputTraceHeader header;
+  if (size < sizeof(header))
+    return false;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != INPUT_TRACE_MAGIC || header.version != INPUT_TRACE_VERSION)
+    return false;
+  if ((size - sizeof(header)) / sizeof(InputEvent) != header.eventsCount || (size - sizeof(header)) % sizeof(InputEvent) != 0)
+    return false;
+
+  events.resize(header.eventsCount);
+  if (!events.empty())
+    memcpy(events.data(), data + sizeof(header), sizeof(InputEvent) * events.size());
+
+  // Events must go in frame order and stay inside the trace
+  for (size_t i = 0; i < events.size(); i++) {
+    const InputEvent& event = events[i];
+    if (event.type > INPUT_EVENT_KEY_UP || event.frame >= header.framesCount || (i > 0 && event.frame < events[i - 1].frame)) {
+      events.clear();
+      return false;
+    }
+  }
+
+  framesCount = header.framesCount;
+  return true;
+}
+
+bool InputPlayer::Next(InputState& result) {
+  if (frame >= framesCount)
+    return false;
+
+  state.mouseMove = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  for (; nextEvent < events.size() && events[nextEvent].frame == frame; nextEvent++) {
+    const InputEvent& event = events[nextEvent];
+    if (event.type == INPUT_EVENT_MOUSE_MOVE)
+      state.mouseMove = event.value;
+    else
+      state.SetKey(event.key, event.type == INPUT_EVENT_KEY_DOWN);
+  }
+
+  frame++;
+  result = state;
+  return true;
+}
+
+void InputPlayer::Rewind() {
+  state = InputState();
+  nextEvent = 0;
+  frame = 0;
+}
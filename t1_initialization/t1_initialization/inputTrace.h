@@ -0,0 +1,83 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+// Input trace file layout (little endian):
+//   InputTraceHeader
+//   InputEvent[eventsCount] - sorted by frame
+// Events are applied by frame number, time is kept for reference only,
+// so playback gives the same frames on any machine
+#define INPUT_TRACE_MAGIC 0x54504E49 // 'INPT'
+#define INPUT_TRACE_VERSION 1
+
+// Input of one frame as application sees it, device independent
+struct InputState {
+  XMFLOAT3 mouseMove = XMFLOAT3(0.0f, 0.0f, 0.0f);  // x, y, wheel while any button is held
+  uint8_t keys[32] = {};                            // bit per DIK_* code
+
+  bool IsKeyDown(uint8_t key) const { return (keys[key >> 3] >> (key & 7)) & 1; };
+  void SetKey(uint8_t key, bool down);
+};
+
+enum INPUT_EVENT_TYPE {
+  INPUT_EVENT_MOUSE_MOVE = 0,
+  INPUT_EVENT_KEY_DOWN,
+  INPUT_EVENT_KEY_UP
+};
+
+struct InputEvent {
+  uint32_t frame;
+  float time;       // seconds since recording start
+  uint8_t type;     // INPUT_EVENT_TYPE
+  uint8_t key;      // DIK_* code for key events
+  uint16_t reserved;
+  XMFLOAT3 value;   // mouse move
+};
+
+struct InputTraceHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t eventsCount;
+  uint32_t framesCount;
+};
+
+// Stores changes of input state as events
+class InputRecorder {
+public:
+  void Begin();
+  void Record(const InputState& state, float time);
+
+  uint32_t GetFramesCount() const { return framesCount; };
+  const std::vector<InputEvent>& GetEvents() const { return events; };
+
+  void Serialize(std::vector<uint8_t>& data) const;
+private:
+  std::vector<InputEvent> events;
+  InputState prevState;
+  uint32_t framesCount = 0;
+};
+
+// Rebuilds input state of every frame from events
+class InputPlayer {
+public:
+  // Validates whole trace, false if data is broken
+  bool Parse(const uint8_t* data, size_t size);
+
+  // State of next frame, false when trace is over
+  bool Next(InputState& state);
+
+  void Rewind();
+  uint32_t GetFrame() const { return frame; };
+  uint32_t GetFramesCount() const { return framesCount; };
+private:
+  std::vector<InputEvent> events;
+  InputState state;
+  size_t nextEvent = 0;
+  uint32_t frame = 0;
+  uint32_t framesCount = 0;
+};
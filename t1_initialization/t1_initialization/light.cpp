@@ -1,112 +1,59 @@
 #include "light.h"
 
-void Light::GenerateSphere(UINT LatLines, UINT LongLines, std::vector<SimpleVertex>& vertices, std::vector<UINT>& indices) {
-  // generate verticies  
-  numSphereVertices = ((LatLines - 2) * LongLines) + 2;
-  numSphereFaces = ((LatLines - 3) * (LongLines) * 2) + (LongLines * 2);
-
-  float sphereYaw = 0.0f;
-  float spherePitch = 0.0f;
-
-  vertices.resize(numSphereVertices);
-
-  XMVECTOR currVertPos = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
-
-  vertices[0].x = 0.0f;
-  vertices[0].y = 0.0f;
-  vertices[0].z = 1.0f;
-
-  for (UINT i = 0; i < LatLines - 2; i++) {
-    spherePitch = (i + 1) * (XM_PI / (LatLines - 1));
-    XMMATRIX Rotationx = XMMatrixRotationX(spherePitch);
-    for (UINT j = 0; j < LongLines; j++) {
-      sphereYaw = j * (XM_2PI / (LongLines));
-      XMMATRIX Rotationy = XMMatrixRotationZ(sphereYaw);
-      currVertPos = XMVector3TransformNormal(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), (Rotationx * Rotationy));
-      currVertPos = XMVector3Normalize(currVertPos);
-      vertices[i * LongLines + j + 1].x = XMVectorGetX(currVertPos);
-      vertices[i * LongLines + j + 1].y = XMVectorGetY(currVertPos);
-      vertices[i * LongLines + j + 1].z = XMVectorGetZ(currVertPos);
-    }
-  }
-
-  vertices[numSphereVertices - 1].x = 0.0f;
-  vertices[numSphereVertices - 1].y = 0.0f;
-  vertices[numSphereVertices - 1].z = -1.0f;
+namespace {
+  // Sphere tessellation (latitude, longitude lines) of each LOD, from nearest to farthest
+  const UINT LIGHT_LOD_TESSELLATION[][2] = { {16, 16}, {10, 10}, {6, 8}, {4, 6} };
 
-  // generate indicies
-  indices.resize(numSphereFaces * 3);
-
-  UINT k = 0;
-  for (UINT i = 0; i < LongLines - 1; i++) {
-    indices[k] = 0;
-    indices[k + 1] = i + 1;
-    indices[k + 2] = i + 2;
-    k += 3;
-  }
-
-  indices[k] = 0;
-  indices[k + 1] = LongLines;
-  indices[k + 2] = 1;
-  k += 3;
-
-  for (UINT i = 0; i < LatLines - 3; i++) {
-    for (UINT j = 0; j < LongLines - 1; j++) {
-      indices[k] = i * LongLines + j + 1;
-      indices[k + 1] = i * LongLines + j + 2;
-      indices[k + 2] = (i + 1) * LongLines + j + 1;
-
-      indices[k + 3] = (i + 1) * LongLines + j + 1;
-      indices[k + 4] = i * LongLines + j + 2;
-      indices[k + 5] = (i + 1) * LongLines + j + 2;
+  // Projected radius (pixels) below which next LOD is used
+  const float LIGHT_LOD_THRESHOLDS[] = { 48.0f, 16.0f, 6.0f };
+}
 
-      k += 6;
+void Light::Gather(World& world) {
+  colors.clear();
+  positions.clear();
+  world.ForEachChunk<PositionComponent, LightComponent>([&](uint32_t count, const Entity*, PositionComponent* lightPositions, LightComponent* lights) {
+    for (uint32_t i = 0; i < count; i++) {
+      positions.push_back(lightPositions[i].position);
+      colors.push_back(lights[i].color);
     }
+  });
+}
 
-    indices[k] = (i * LongLines) + LongLines;
-    indices[k + 1] = (i * LongLines) + 1;
-    indices[k + 2] = ((i + 1) * LongLines) + LongLines;
-
-    indices[k + 3] = ((i + 1) * LongLines) + LongLines;
-    indices[k + 4] = (i * LongLines) + 1;
-    indices[k + 5] = ((i + 1) * LongLines) + 1;
+HRESULT Light::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, World& world) {
+  // Create sphere LOD chain, all levels share one vertex and one index buffer
+  std::vector<SimpleVertex> vertices;
+  std::vector<UINT> indices;
+  sphereLODs.resize(ARRAYSIZE(LIGHT_LOD_TESSELLATION));
+  for (size_t lod = 0; lod < sphereLODs.size(); lod++) {
+    const Mesh& sphere = MeshGenerator::GetInstance().GetUVSphere(LIGHT_LOD_TESSELLATION[lod][0], LIGHT_LOD_TESSELLATION[lod][1]);
 
-    k += 6;
-  }
+    sphereLODs[lod].indexStart = (UINT)indices.size();
+    sphereLODs[lod].indexCount = (UINT)sphere.indices.size();
+    sphereLODs[lod].baseVertex = (INT)vertices.size();
 
-  for (UINT i = 0; i < LongLines - 1; i++) {
-    indices[k] = numSphereVertices - 1;
-    indices[k + 1] = (numSphereVertices - 1) - (i + 1);
-    indices[k + 2] = (numSphereVertices - 1) - (i + 2);
-    k += 3;
+    for (auto& vertex : sphere.vertices)
+      vertices.push_back({ vertex.pos.x, vertex.pos.y, vertex.pos.z });
+    indices.insert(indices.end(), sphere.indices.begin(), sphere.indices.end());
   }
 
-  indices[k] = numSphereVertices - 1;
-  indices[k + 1] = (numSphereVertices - 1) - LongLines;
-  indices[k + 2] = numSphereVertices - 2;
+  lodSelector.Init(std::vector<float>(std::begin(LIGHT_LOD_THRESHOLDS), std::end(LIGHT_LOD_THRESHOLDS)));
 
-  return;
-}
+  std::vector<QuantizedSimpleVertex> quantizedVertices(vertices.size());
+  sphereQuantization = VertexQuantizer::Encode(vertices.data(), vertices.size(), quantizedVertices.data());
 
-HRESULT Light::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, const std::vector<XMFLOAT4> &colors, const std::vector<XMFLOAT4> &positions) {
-  // Create sphere
-  std::vector<SimpleVertex> vertices;
-  std::vector<UINT> indices;
-  GenerateSphere(10, 10, vertices, indices);
+  Gather(world);
+  assert(positions.size() <= MAX_LIGHT_SOURCES);
 
-  this->colors = colors;
-  this->positions = positions;
-
-  assert(this->colors.size() == MAX_LIGHT_SOURCES);
-  assert(this->positions.size() == MAX_LIGHT_SOURCES);
+  lightLODs.assign(positions.size(), 0);
 
   // Create index array
   static const D3D11_INPUT_ELEMENT_DESC InputDesc[] = {
-      {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+      {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+      {"LIGHT_INDEX", 0, DXGI_FORMAT_R32_UINT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
   };
 
   D3D11_BUFFER_DESC descVert = {};
-  descVert.ByteWidth = sizeof(SimpleVertex) * numSphereVertices;
+  descVert.ByteWidth = (UINT)(sizeof(QuantizedSimpleVertex) * quantizedVertices.size());
   descVert.Usage = D3D11_USAGE_IMMUTABLE;
   descVert.BindFlags = D3D11_BIND_VERTEX_BUFFER;
   descVert.CPUAccessFlags = 0;
@@ -115,7 +62,7 @@ HRESULT Light::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
 
   D3D11_SUBRESOURCE_DATA dataVert;
   ZeroMemory(&dataVert, sizeof(dataVert));
-  dataVert.pSysMem = &vertices[0];
+  dataVert.pSysMem = &quantizedVertices[0];
   HRESULT hr = device->CreateBuffer(&descVert, &dataVert, &g_pVertexBuffer);
   if (FAILED(hr))
     return hr;
@@ -123,7 +70,7 @@ HRESULT Light::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
   D3D11_BUFFER_DESC descInd = {};
   ZeroMemory(&descInd, sizeof(descInd));
 
-  descInd.ByteWidth = sizeof(UINT) * numSphereFaces * 3;
+  descInd.ByteWidth = (UINT)(sizeof(UINT) * indices.size());
   descInd.Usage = D3D11_USAGE_IMMUTABLE;
   descInd.BindFlags = D3D11_BIND_INDEX_BUFFER;
   descInd.CPUAccessFlags = 0;
@@ -137,6 +84,19 @@ HRESULT Light::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
   if (FAILED(hr))
     return hr;
 
+  // Light indices sorted by LOD, rewritten every frame
+  D3D11_BUFFER_DESC descInst = {};
+  descInst.ByteWidth = sizeof(UINT) * MAX_LIGHT_SOURCES;
+  descInst.Usage = D3D11_USAGE_DYNAMIC;
+  descInst.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+  descInst.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+  descInst.MiscFlags = 0;
+  descInst.StructureByteStride = 0;
+
+  hr = device->CreateBuffer(&descInst, nullptr, &g_pInstanceBuffer);
+  if (FAILED(hr))
+    return hr;
+
   // Compile shaders
   ID3D10Blob* vertexShaderBuffer = nullptr;
   ID3D10Blob* pixelShaderBuffer = nullptr;
@@ -146,7 +106,7 @@ HRESULT Light::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
 #endif
   D3DInclude includeObj;
 
-  hr = D3DCompileFromFile(L"light_VS.hlsl", NULL, &includeObj, "main", "vs_5_0", flags, 0, &vertexShaderBuffer, NULL);
+  hr = CompileShaderFromAsset(L"light_VS.hlsl", NULL, &includeObj, "main", "vs_5_0", flags, 0, &vertexShaderBuffer, NULL);
   if (FAILED(hr))
     return hr;
 
@@ -154,7 +114,7 @@ HRESULT Light::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
   if (FAILED(hr))
     return hr;
 
-  hr = D3DCompileFromFile(L"light_PS.hlsl", NULL, &includeObj, "main", "ps_5_0", flags, 0, &pixelShaderBuffer, NULL);
+  hr = CompileShaderFromAsset(L"light_PS.hlsl", NULL, &includeObj, "main", "ps_5_0", flags, 0, &pixelShaderBuffer, NULL);
   if (FAILED(hr))
     return hr;
 
@@ -169,15 +129,15 @@ HRESULT Light::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
 
   // Set constant buffers
   D3D11_BUFFER_DESC descWM = {};
-  descWM.ByteWidth = (UINT)(sizeof(WorldMatrixBuffer) * colors.size());
+  descWM.ByteWidth = sizeof(WorldMatrixBuffer) * MAX_LIGHT_SOURCES;
   descWM.Usage = D3D11_USAGE_DEFAULT;
   descWM.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
   descWM.CPUAccessFlags = 0;
   descWM.MiscFlags = 0;
   descWM.StructureByteStride = 0;
 
-  WorldMatrixBuffer lightGeomBuffer[MAX_LIGHT_SOURCES];
-  for (UINT i = 0; i < MAX_LIGHT_SOURCES; i++) {
+  WorldMatrixBuffer lightGeomBuffer[MAX_LIGHT_SOURCES] = {};
+  for (UINT i = 0; i < positions.size(); i++) {
     lightGeomBuffer[i].worldMatrix =
       DirectX::XMMatrixScaling(0.1f, 0.1f, 0.1f) * 
       XMMatrixTranslation(
@@ -237,6 +197,7 @@ void Light::Realese() {
   if (g_pSceneMatrixBuffer) g_pSceneMatrixBuffer->Release();
   if (g_pIndexBuffer) g_pIndexBuffer->Release();
   if (g_pVertexBuffer) g_pVertexBuffer->Release();
+  if (g_pInstanceBuffer) g_pInstanceBuffer->Release();
   if (g_pVertexLayout) g_pVertexLayout->Release();
   if (g_pVertexShader) g_pVertexShader->Release();
   if (g_pPixelShader) g_pPixelShader->Release();
@@ -247,11 +208,11 @@ void Light::Render(ID3D11DeviceContext* context) {
 
   context->IASetIndexBuffer(g_pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
   
-  ID3D11Buffer* vertexBuffers[] = { g_pVertexBuffer };
-  UINT strides[] = { 12 };
-  UINT offsets[] = { 0 };
+  ID3D11Buffer* vertexBuffers[] = { g_pVertexBuffer, g_pInstanceBuffer };
+  UINT strides[] = { sizeof(QuantizedSimpleVertex), sizeof(UINT) };
+  UINT offsets[] = { 0, 0 };
 
-  context->IASetVertexBuffers(0, 1, vertexBuffers, strides, offsets);
+  context->IASetVertexBuffers(0, 2, vertexBuffers, strides, offsets);
   context->IASetInputLayout(g_pVertexLayout);
   context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
   context->VSSetShader(g_pVertexShader, nullptr, 0);
@@ -260,30 +221,74 @@ void Light::Render(ID3D11DeviceContext* context) {
   context->PSSetShader(g_pPixelShader, nullptr, 0);
   context->PSSetConstantBuffers(0, 1, &g_pWorldMatrixBuffer);
 
-  context->DrawIndexedInstanced(numSphereFaces * 3, (UINT)colors.size(), 0, 0, 0);
+  // One draw per LOD bucket
+  for (size_t lod = 0; lod < sphereLODs.size() && lod + 1 < lodOffsets.size(); lod++) {
+    UINT instancesCount = lodOffsets[lod + 1] - lodOffsets[lod];
+    if (instancesCount > 0)
+      context->DrawIndexedInstanced(sphereLODs[lod].indexCount, instancesCount,
+        sphereLODs[lod].indexStart, sphereLODs[lod].baseVertex, lodOffsets[lod]);
+  }
 }
 
-bool Light::Frame(ID3D11DeviceContext* context, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos) {
-  // Update world matrix
-  WorldMatrixBuffer lightGeomBuffer[MAX_LIGHT_SOURCES];
-  for (int i = 0; i < MAX_LIGHT_SOURCES; i++) {
-    lightGeomBuffer[i].worldMatrix = 
+bool Light::Frame(ID3D11DeviceContext* context, World& world, const CameraState& camera) {
+  // Light entities may move, positions and colors are read again every frame
+  Gather(world);
+  if (positions.size() > MAX_LIGHT_SOURCES)
+    return false;
+  UINT lightsCount = (UINT)positions.size();
+
+  // Update world matrix, quantized positions are decoded by it as well
+  FrameArena& arena = FrameArena::GetThreadArena();
+  XMMATRIX decodeMatrix = VertexQuantizer::DecodeMatrix(sphereQuantization);
+  WorldMatrixBuffer* lightGeomBuffer = arena.Allocate<WorldMatrixBuffer>(MAX_LIGHT_SOURCES);
+  memset(lightGeomBuffer, 0, sizeof(WorldMatrixBuffer) * MAX_LIGHT_SOURCES);
+  for (UINT i = 0; i < lightsCount; i++) {
+    lightGeomBuffer[i].worldMatrix = decodeMatrix *
       DirectX::XMMatrixScaling(0.1f, 0.1f, 0.1f) * 
       XMMatrixTranslation(positions[i].x, positions[i].y, positions[i].z);
     lightGeomBuffer[i].color = colors[i];
   }
 
-  context->UpdateSubresource(g_pWorldMatrixBuffer, 0, nullptr, &lightGeomBuffer, 0, 0);
+  context->UpdateSubresource(g_pWorldMatrixBuffer, 0, nullptr, lightGeomBuffer, 0, 0);
 
-  // Update Scene matrix
-  D3D11_MAPPED_SUBRESOURCE subresource;
-  HRESULT hr = context->Map(g_pSceneMatrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
-  if (FAILED(hr))
-    return hr;
+  // Pick LOD of each light by its size on screen and group lights by LOD.
+  // Same camera and same light positions give the same buckets, instance buffer is kept then
+  HRESULT hr;
+  bool lightsMoved = lodPositions.size() != positions.size() ||
+    memcmp(lodPositions.data(), positions.data(), sizeof(XMFLOAT4) * positions.size()) != 0;
+  if (lodVersion != camera.GetVersion() || lightsMoved) {
+    XMFLOAT4* spheres = arena.Allocate<XMFLOAT4>(lightsCount);
+    for (UINT i = 0; i < lightsCount; i++)
+      spheres[i] = XMFLOAT4(positions[i].x, positions[i].y, positions[i].z, radius);
+
+    lodSelector.Select(spheres, lightsCount, camera.GetPosition(), LODSelector::ProjectionScale(camera.GetProjection(), screenHeight), lightLODs.data());
+
+    uint32_t* order = arena.Allocate<uint32_t>(lightLODs.size());
+    lodSelector.Bucket(lightLODs.data(), lightLODs.size(), order, lodOffsets);
+
+    D3D11_MAPPED_SUBRESOURCE instances;
+    hr = context->Map(g_pInstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &instances);
+    if (FAILED(hr))
+      return hr;
+    memcpy(instances.pData, order, sizeof(UINT) * lightLODs.size());
+    context->Unmap(g_pInstanceBuffer, 0);
 
-  SceneMatrixBuffer& sceneBuffer = *reinterpret_cast<SceneMatrixBuffer*>(subresource.pData);
-  sceneBuffer.viewProjectionMatrix = XMMatrixMultiply(viewMatrix, projectionMatrix);
-  context->Unmap(g_pSceneMatrixBuffer, 0);
+    lodPositions = positions;
+    lodVersion = camera.GetVersion();
+  }
+
+  // Update Scene matrix
+  if (sceneVersion != camera.GetVersion()) {
+    D3D11_MAPPED_SUBRESOURCE subresource;
+    hr = context->Map(g_pSceneMatrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
+    if (FAILED(hr))
+      return hr;
+
+    SceneMatrixBuffer& sceneBuffer = *reinterpret_cast<SceneMatrixBuffer*>(subresource.pData);
+    sceneBuffer.viewProjectionMatrix = camera.GetViewProjection();
+    context->Unmap(g_pSceneMatrixBuffer, 0);
+    sceneVersion = camera.GetVersion();
+  }
 
   return S_OK;
 }
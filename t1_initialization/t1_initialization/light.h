@@ -7,29 +7,38 @@
 #include <vector>
 #include "D3DInclude.h"
 #include "def.h"
+#include "meshGenerator.h"
+#include "lodSelector.h"
+#include "vertexQuantizer.h"
+#include "ecs.h"
+#include "components.h"
+#include "frameArena.h"
+#include "cameraState.h"
 
 using namespace DirectX;
 
 class Light {
 public:
-  HRESULT Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, const std::vector<XMFLOAT4>& colors, const std::vector<XMFLOAT4>& positions);
+  // Lights are World entities with Position and Light components
+  HRESULT Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, World& world);
 
   void Realese();
 
-  void Resize(int screenWidth, int screenHeight) {};
+  void Resize(int screenWidth, int screenHeight) { this->screenHeight = (float)screenHeight; lodVersion = 0; };
 
   void Render(ID3D11DeviceContext* context);
   
-  bool Frame(ID3D11DeviceContext* context, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos);
+  bool Frame(ID3D11DeviceContext* context, World& world, const CameraState& camera);
 
   const std::vector<XMFLOAT4>& GetColors() const { return colors; };
   const std::vector<XMFLOAT4>& GetPositions() const { return positions; };
 private:
-  void GenerateSphere(UINT LatLines, UINT LongLines, std::vector<SimpleVertex>& vertices, std::vector<UINT>& indices);
+  void Gather(World& world);
 
   // dx11 vars
   ID3D11Buffer* g_pVertexBuffer = nullptr;
   ID3D11Buffer* g_pIndexBuffer = nullptr;
+  ID3D11Buffer* g_pInstanceBuffer = nullptr;
   ID3D11Buffer* g_pWorldMatrixBuffer = nullptr;
   ID3D11Buffer* g_pGeomBuffer = nullptr;
   ID3D11Buffer* g_pSceneMatrixBuffer = nullptr;
@@ -40,10 +49,29 @@ private:
   ID3D11PixelShader* g_pPixelShader = nullptr;
 
   // Sphere light geometry params
-  UINT numSphereVertices = 0;
-  UINT numSphereFaces = 0;
+  struct SphereLOD {
+    UINT indexStart;
+    UINT indexCount;
+    INT baseVertex;
+  };
+  std::vector<SphereLOD> sphereLODs;
+  VertexQuantization sphereQuantization = {};
   float radius = 0.1f;
 
+  // Per light LOD (kept between frames for hysteresis) and instance ranges of each LOD
+  LODSelector lodSelector;
+  std::vector<uint8_t> lightLODs;
+  std::vector<uint32_t> lodOffsets;
+  float screenHeight = 1.0f;
+
+  // Camera version and light positions LODs were selected for, selection is skipped while both hold
+  uint32_t lodVersion = 0;
+  std::vector<XMFLOAT4> lodPositions;
+
+  // Camera version scene buffer was written for
+  uint32_t sceneVersion = 0;
+
+  // Light entities data gathered for constant buffers
   std::vector<XMFLOAT4> colors;
   std::vector<XMFLOAT4> positions;
 };
@@ -1,5 +1,10 @@
 #include "lightCB.h"
 
+// Shaders with shadows define it before include
+#ifndef LIGHT_VISIBILITY
+#define LIGHT_VISIBILITY(i, pos, normal) 1.0
+#endif
+
 float3 CalculateColor(in float3 objColor, in float3 objNormal, in float3 pos, in float shine, in bool trans)
 {
   float3 finalColor = float3(0, 0, 0);
@@ -12,7 +17,7 @@ float3 CalculateColor(in float3 objColor, in float3 objNormal, in float3 pos, in
     float lightDist = length(lightDir);
     lightDir /= lightDist;
 
-    float atten = clamp(1.0 / (lightDist * lightDist), 0, 1);
+    float atten = clamp(1.0 / (lightDist * lightDist), 0, 1) * LIGHT_VISIBILITY(i, pos, objNormal);
 
     if (trans && dot(lightDir, objNormal) < 0.0) {
       norm = -norm;
@@ -3,7 +3,7 @@
 struct VS_INPUT
 {
   float4 position : POSITION;
-  uint instanceId : SV_InstanceID;
+  uint lightIndex : LIGHT_INDEX; // per instance, lights are grouped by LOD
 };
 
 struct PS_INPUT {
@@ -14,7 +14,7 @@ struct PS_INPUT {
 PS_INPUT main(VS_INPUT input) {
   PS_INPUT output;
 
-  unsigned int idx = input.instanceId;
+  unsigned int idx = input.lightIndex;
   output.instanceId = idx;
 
   output.position = mul(viewProjectionMatrix,
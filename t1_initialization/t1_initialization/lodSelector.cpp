@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cassert>
+
+#include "lodSelector.h"
+
+namespace {
+  // Keeps projected radius finite when camera is at sphere center
+  const float LOD_MIN_DISTANCE = 1e-4f;
+}
+
+void LODSelector::Init(const std::vector<float>& thresholds, float hysteresis) {
+  assert(thresholds.size() < LOD_MAX_LEVELS);
+
+  levelsCount = (uint32_t)std::min<size_t>(thresholds.size(), LOD_MAX_LEVELS - 1) + 1;
+  for (uint32_t i = 0; i + 1 < levelsCount; i++) {
+    fineThresholds[i] = thresholds[i] * (1.0f - hysteresis);
+    coarseThresholds[i] = thresholds[i] * (1.0f + hysteresis);
+  }
+}
+
+float LODSelector::ProjectionScale(const XMMATRIX& projection, float screenHeight) {
+  return 0.5f * screenHeight * XMVectorGetY(projection.r[1]);
+}
+
+uint8_t LODSelector::Select(float screenRadius, uint8_t prevLod) const {
+  uint32_t fine = 0, coarse = 0;
+  for (uint32_t i = 0; i + 1 < levelsCount; i++) {
+    fine += screenRadius < fineThresholds[i];
+    coarse += screenRadius < coarseThresholds[i];
+  }
+
+  // Inside hysteresis band previous LOD stays
+  return (uint8_t)std::min(std::max<uint32_t>(prevLod, fine), coarse);
+}
+
+void LODSelector::Select(const XMFLOAT4* spheres, size_t count, const XMFLOAT3& cameraPos, float projectionScale, uint8_t* lods) const {
+  const XMVECTOR camX = XMVectorReplicate(cameraPos.x);
+  const XMVECTOR camY = XMVectorReplicate(cameraPos.y);
+  const XMVECTOR camZ = XMVectorReplicate(cameraPos.z);
+  const XMVECTOR scale = XMVectorReplicate(projectionScale);
+  const XMVECTOR minDistance = XMVectorReplicate(LOD_MIN_DISTANCE);
+  const XMVECTOR one = XMVectorSplatOne();
+
+  XMVECTOR fine[LOD_MAX_LEVELS - 1], coarse[LOD_MAX_LEVELS - 1];
+  for (uint32_t i = 0; i + 1 < levelsCount; i++) {
+    fine[i] = XMVectorReplicate(fineThresholds[i]);
+    coarse[i] = XMVectorReplicate(coarseThresholds[i]);
+  }
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    // 4 spheres to SoA: rows become x, y, z, radius
+    XMMATRIX soa = XMMatrixTranspose(XMMATRIX(
+      XMLoadFloat4(&spheres[i]), XMLoadFloat4(&spheres[i + 1]),
+      XMLoadFloat4(&spheres[i + 2]), XMLoadFloat4(&spheres[i + 3])));
+
+    XMVECTOR dx = XMVectorSubtract(soa.r[0], camX);
+    XMVECTOR dy = XMVectorSubtract(soa.r[1], camY);
+    XMVECTOR dz = XMVectorSubtract(soa.r[2], camZ);
+    XMVECTOR distance = XMVectorSqrt(XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz))));
+    XMVECTOR screenRadius = XMVectorDivide(XMVectorMultiply(soa.r[3], scale), XMVectorMax(distance, minDistance));
+
+    XMVECTOR lodFine = XMVectorZero();
+    XMVECTOR lodCoarse = XMVectorZero();
+    for (uint32_t level = 0; level + 1 < levelsCount; level++) {
+      lodFine = XMVectorAdd(lodFine, XMVectorAndInt(XMVectorLess(screenRadius, fine[level]), one));
+      lodCoarse = XMVectorAdd(lodCoarse, XMVectorAndInt(XMVectorLess(screenRadius, coarse[level]), one));
+    }
+
+    XMVECTOR prev = XMVectorSet(lods[i], lods[i + 1], lods[i + 2], lods[i + 3]);
+    XMFLOAT4 result;
+    XMStoreFloat4(&result, XMVectorClamp(prev, lodFine, lodCoarse));
+    lods[i] = (uint8_t)result.x;
+    lods[i + 1] = (uint8_t)result.y;
+    lods[i + 2] = (uint8_t)result.z;
+    lods[i + 3] = (uint8_t)result.w;
+  }
+
+  // Tail
+  for (; i < count; i++) {
+    XMVECTOR center = XMLoadFloat4(&spheres[i]);
+    float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, XMLoadFloat3(&cameraPos))));
+    lods[i] = Select(spheres[i].w * projectionScale / std::max(distance, LOD_MIN_DISTANCE), lods[i]);
+  }
+}
+
+void LODSelector::Bucket(const uint8_t* lods, size_t count, uint32_t* order, std::vector<uint32_t>& offsets) const {
+  offsets.assign(levelsCount + 1, 0);
+  for (size_t i = 0; i < count; i++)
+    offsets[std::min<uint32_t>(lods[i], levelsCount - 1) + 1]++;
+  for (uint32_t level = 0; level < levelsCount; level++)
+    offsets[level + 1] += offsets[level];
+
+  // Level starts serve as fill positions, after filling each one holds start of next level
+  for (size_t i = 0; i < count; i++)
+    order[offsets[std::min<uint32_t>(lods[i], levelsCount - 1)]++] = (uint32_t)i;
+  for (uint32_t level = levelsCount; level > 0; level--)
+    offsets[level] = offsets[level - 1];
+  offsets[0] = 0;
+}
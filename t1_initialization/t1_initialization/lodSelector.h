@@ -0,0 +1,38 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+#define LOD_MAX_LEVELS 8
+
+// Screen size driven LOD selection for many instances, 4 instances per SIMD step.
+// Device free, only DirectXMath is used.
+class LODSelector {
+public:
+  // thresholds[i] - projected radius in pixels below which LOD i + 1 is used, must go down.
+  // hysteresis - relative band around each threshold where current LOD is kept (0.1 = +-10%)
+  void Init(const std::vector<float>& thresholds, float hysteresis = 0.1f);
+
+  uint32_t GetLevelsCount() const { return levelsCount; };
+
+  // Pixels per world unit at distance 1: 0.5 * screenHeight * projection[1][1]
+  static float ProjectionScale(const XMMATRIX& projection, float screenHeight);
+
+  // spheres: xyz - center, w - radius. lods keep previous frame values on input (used for hysteresis)
+  void Select(const XMFLOAT4* spheres, size_t count, const XMFLOAT3& cameraPos, float projectionScale, uint8_t* lods) const;
+
+  // Same for already projected radius (in pixels)
+  uint8_t Select(float screenRadius, uint8_t prevLod) const;
+
+  // Stable counting sort of instance indices by LOD into order[count], offsets has levelsCount + 1 entries
+  void Bucket(const uint8_t* lods, size_t count, uint32_t* order, std::vector<uint32_t>& offsets) const;
+
+private:
+  // Lowest possible LOD number (finest mesh) is picked with thresholds scaled down, highest - scaled up
+  float fineThresholds[LOD_MAX_LEVELS - 1] = {};
+  float coarseThresholds[LOD_MAX_LEVELS - 1] = {};
+  uint32_t levelsCount = 1;
+};
@@ -1,13 +1,21 @@
 #include <windows.h>
+#include <shellapi.h>
 #include <xstring>
 #include <mmsystem.h>
 
 #include "resource1.h"
 #include "renderer.h"
+#include "assetArchive.h"
+#include "meshConverter.h"
+#include "sceneCompiler.h"
+#include "sceneGenerator.h"
 
 #define START_W 1280
 #define START_H 720
 
+// Frames rendered before -alloccheck starts to count allocations
+#define ALLOC_CHECK_WARMUP_FRAMES 60
+
 #define MAX_LOADSTRING 300
 WCHAR szTitle[MAX_LOADSTRING];                  // The title bar text
 
@@ -59,6 +67,114 @@ HRESULT InitWindow(HINSTANCE hInstance, int nCmdShow)
   return S_OK;
 }
 
+// Pack assets instead of running: -pack <archive> [-lz4] <files...>
+// or convert mesh: -mesh <source.obj> <result.mesh>
+// or compile scene: -scene <source.scene> <result.scnb>
+// or generate benchmark scene: -generate <preset> <seed> <result.scnb>
+// Returns true if command line asked for one of these tools, exitCode is set then
+bool RunPacker(int& exitCode)
+{
+  int argsCount = 0;
+  LPWSTR* args = CommandLineToArgvW(GetCommandLineW(), &argsCount);
+  if (!args)
+    return false;
+
+  bool isMeshConverter = argsCount == 4 && wcscmp(args[1], L"-mesh") == 0;
+  if (isMeshConverter)
+  {
+    HRESULT hr = MeshConverter::ConvertFile(args[2], args[3]);
+    exitCode = SUCCEEDED(hr) ? 0 : 1;
+    LocalFree(args);
+    return true;
+  }
+
+  bool isSceneCompiler = argsCount == 4 && wcscmp(args[1], L"-scene") == 0;
+  if (isSceneCompiler)
+  {
+    HRESULT hr = SceneCompiler::CompileFile(args[2], args[3]);
+    exitCode = SUCCEEDED(hr) ? 0 : 1;
+    LocalFree(args);
+    return true;
+  }
+
+  bool isSceneGenerator = argsCount == 5 && wcscmp(args[1], L"-generate") == 0;
+  if (isSceneGenerator)
+  {
+    char preset[64] = {};
+    WideCharToMultiByte(CP_UTF8, 0, args[2], -1, preset, sizeof(preset) - 1, nullptr, nullptr);
+
+    SceneGenParams params;
+    HRESULT hr = E_INVALIDARG;
+    if (SceneGenerator::GetPreset(preset, _wcstoui64(args[3], nullptr, 10), params))
+      hr = SceneGenerator::GenerateFile(params, args[4]);
+    exitCode = SUCCEEDED(hr) ? 0 : 1;
+    LocalFree(args);
+    return true;
+  }
+
+  bool isPacker = argsCount >= 3 && wcscmp(args[1], L"-pack") == 0;
+  if (isPacker)
+  {
+    bool compress = false;
+    std::vector<std::wstring> files;
+    for (int i = 3; i < argsCount; i++)
+    {
+      if (wcscmp(args[i], L"-lz4") == 0)
+        compress = true;
+      else
+        files.push_back(args[i]);
+    }
+
+    HRESULT hr = AssetArchive::Pack(args[2], files, compress);
+    exitCode = SUCCEEDED(hr) ? 0 : 1;
+  }
+
+  LocalFree(args);
+  return isPacker;
+}
+
+// Run options: -alloccheck <frames> renders warm up and given number of frames and exits,
+// -replay steps simulation once per frame instead of by wall clock,
+// -record <trace> stores input (and camera path to <trace>.path) until window is closed,
+// -play <trace> <log.csv> replays input, -benchmark <path> <log.csv> moves camera along path,
+// both run with -replay, write frame times and exit when done
+struct RunOptions {
+  UINT allocCheckFrames = 0;
+  bool replay = false;
+  BENCHMARK_MODE benchmark = BENCHMARK_NONE;
+  std::wstring benchmarkInput;
+  std::wstring benchmarkLog;
+};
+
+void ParseRunOptions(RunOptions& options)
+{
+  int argsCount = 0;
+  LPWSTR* args = CommandLineToArgvW(GetCommandLineW(), &argsCount);
+  if (!args)
+    return;
+
+  for (int i = 1; i < argsCount; i++)
+  {
+    if (wcscmp(args[i], L"-alloccheck") == 0 && i + 1 < argsCount)
+      options.allocCheckFrames = (UINT)_wcstoui64(args[++i], nullptr, 10);
+    else if (wcscmp(args[i], L"-replay") == 0)
+      options.replay = true;
+    else if (wcscmp(args[i], L"-record") == 0 && i + 1 < argsCount)
+    {
+      options.benchmark = BENCHMARK_RECORD;
+      options.benchmarkInput = args[++i];
+    }
+    else if ((wcscmp(args[i], L"-play") == 0 || wcscmp(args[i], L"-benchmark") == 0) && i + 2 < argsCount)
+    {
+      options.benchmark = wcscmp(args[i], L"-play") == 0 ? BENCHMARK_PLAY : BENCHMARK_PATH;
+      options.benchmarkInput = args[++i];
+      options.benchmarkLog = args[++i];
+    }
+  }
+
+  LocalFree(args);
+}
+
 // Entry point to the program. Initializes everything and goes into a message processing 
 // loop. Idle time is used to render the scene.
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
@@ -66,6 +182,10 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
   UNREFERENCED_PARAMETER(hPrevInstance);
   UNREFERENCED_PARAMETER(lpCmdLine);
 
+  int exitCode = 0;
+  if (RunPacker(exitCode))
+    return exitCode;
+
   if (FAILED(InitWindow(hInstance, nCmdShow)))
     return 0;
 
@@ -92,6 +212,33 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     return 0;
   }
 
+  RunOptions options;
+  ParseRunOptions(options);
+
+  // Played runs must show the same frames every time, so simulation steps by frames
+  Benchmark& benchmark = Renderer::GetInstance().GetBenchmark();
+  HRESULT hr = S_OK;
+  if (options.benchmark == BENCHMARK_RECORD)
+    benchmark.StartRecording(options.benchmarkInput.c_str());
+  else if (options.benchmark == BENCHMARK_PLAY)
+    hr = benchmark.StartPlayback(options.benchmarkInput.c_str(), options.benchmarkLog.c_str());
+  else if (options.benchmark == BENCHMARK_PATH)
+    hr = benchmark.StartPath(options.benchmarkInput.c_str(), options.benchmarkLog.c_str());
+  if (FAILED(hr))
+  {
+    Renderer::GetInstance().CleanupDevice();
+    return 1;
+  }
+
+  if (options.replay || options.benchmark == BENCHMARK_PLAY || options.benchmark == BENCHMARK_PATH)
+    Renderer::GetInstance().SetReplay(true);
+
+  // Every frame after warm up must not allocate
+  UINT checkFrames = options.allocCheckFrames;
+  AllocTracker& allocs = AllocTracker::GetInstance();
+  if (checkFrames > 0)
+    allocs.SetStrict(ALLOC_CHECK_WARMUP_FRAMES);
+
   // Main message loop
   MSG msg = { 0 };
   while (WM_QUIT != msg.message)
@@ -103,10 +250,22 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     }
     if (Renderer::GetInstance().Frame())
       Renderer::GetInstance().Render();
+
+    if (checkFrames > 0 && allocs.GetFramesCount() >= ALLOC_CHECK_WARMUP_FRAMES + checkFrames)
+      break;
+    if (benchmark.IsFinished())
+      break;
   }
 
+  hr = benchmark.Finish();
   Renderer::GetInstance().CleanupDevice();
 
+  if (FAILED(hr))
+    return 1;
+
+  if (checkFrames > 0)
+    return allocs.GetViolationsCount() > 0 ? 1 : 0;
+
   return (int)msg.wParam;
 }
 
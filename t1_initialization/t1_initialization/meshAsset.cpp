@@ -0,0 +1,113 @@
+#include <climits>
+
+#include "meshAsset.h"
+#include "assetArchive.h"
+
+HRESULT MeshAsset::Init(ID3D11Device* device, const wchar_t* filename) {
+  AssetData asset;
+  if (SUCCEEDED(AssetArchive::GetInstance().Load(filename, asset)))
+    return Init(device, asset.data, asset.size);
+
+  HANDLE hFile = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+
+  LARGE_INTEGER size = {};
+  if (!GetFileSizeEx(hFile, &size) || (uint64_t)size.QuadPart < sizeof(MeshFileHeader)) {
+    CloseHandle(hFile);
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  }
+
+  HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!hMapping) {
+    HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+    CloseHandle(hFile);
+    return hr;
+  }
+
+  // Pages are read by the driver during CreateBuffer, view is dropped right after upload
+  HRESULT hr = S_OK;
+  auto data = static_cast<const uint8_t*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+  if (!data)
+    hr = HRESULT_FROM_WIN32(GetLastError());
+  else {
+    hr = Init(device, data, (size_t)size.QuadPart);
+    UnmapViewOfFile(data);
+  }
+
+  CloseHandle(hMapping);
+  CloseHandle(hFile);
+  return hr;
+}
+
+HRESULT MeshAsset::Init(ID3D11Device* device, const uint8_t* data, size_t size) {
+  Release();
+
+  MeshFileView view;
+  if (ParseMeshFile(data, size, view) != MESH_PARSE_OK)
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  if (view.header->verticesCount == 0 || view.header->indicesCount == 0)
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  if ((uint64_t)view.header->verticesCount * view.header->vertexStride > UINT_MAX ||
+    (uint64_t)view.header->indicesCount * view.header->indexSize > UINT_MAX)
+    return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+
+  D3D11_BUFFER_DESC descVert = {};
+  descVert.ByteWidth = view.header->verticesCount * view.header->vertexStride;
+  descVert.Usage = D3D11_USAGE_IMMUTABLE;
+  descVert.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+  descVert.CPUAccessFlags = 0;
+  descVert.MiscFlags = 0;
+  descVert.StructureByteStride = 0;
+
+  D3D11_SUBRESOURCE_DATA dataVert = {};
+  dataVert.pSysMem = view.vertices;
+  HRESULT hr = device->CreateBuffer(&descVert, &dataVert, &g_pVertexBuffer);
+  if (FAILED(hr))
+    return hr;
+
+  D3D11_BUFFER_DESC descInd = {};
+  descInd.ByteWidth = view.header->indicesCount * view.header->indexSize;
+  descInd.Usage = D3D11_USAGE_IMMUTABLE;
+  descInd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+  descInd.CPUAccessFlags = 0;
+  descInd.MiscFlags = 0;
+  descInd.StructureByteStride = 0;
+
+  D3D11_SUBRESOURCE_DATA dataInd = {};
+  dataInd.pSysMem = view.indices;
+  hr = device->CreateBuffer(&descInd, &dataInd, &g_pIndexBuffer);
+  if (FAILED(hr)) {
+    Release();
+    return hr;
+  }
+
+  indexFormat = view.header->indexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+  indicesCount = view.header->indicesCount;
+  quantization = view.header->quantization;
+  boundingSphere = view.header->boundingSphere;
+  meshlets.assign(view.meshlets, view.meshlets + view.header->meshletsCount);
+  auto indexData = static_cast<const uint8_t*>(view.indices);
+  indices.assign(indexData, indexData + descInd.ByteWidth);
+
+  return S_OK;
+}
+
+void MeshAsset::Release() {
+  if (g_pIndexBuffer) g_pIndexBuffer->Release();
+  if (g_pVertexBuffer) g_pVertexBuffer->Release();
+  g_pIndexBuffer = nullptr;
+  g_pVertexBuffer = nullptr;
+
+  indicesCount = 0;
+  meshlets.clear();
+  indices.clear();
+}
+
+void MeshAsset::GetBounds(XMFLOAT4& boundsMin, XMFLOAT4& boundsMax) const {
+  boundsMin = XMFLOAT4(quantization.posOffset.x, quantization.posOffset.y, quantization.posOffset.z, 1.0f);
+  boundsMax = XMFLOAT4(
+    quantization.posOffset.x + quantization.posScale.x,
+    quantization.posOffset.y + quantization.posScale.y,
+    quantization.posOffset.z + quantization.posScale.z, 1.0f);
+}
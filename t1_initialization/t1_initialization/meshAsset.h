@@ -0,0 +1,45 @@
+#pragma once
+
+#include <d3d11.h>
+#include <directxmath.h>
+#include <vector>
+
+#include "meshFile.h"
+
+using namespace DirectX;
+
+// Mesh file uploaded to GPU. File is memory mapped (or taken from asset archive)
+// and vertex / index blocks go to CreateBuffer straight from mapped memory
+class MeshAsset {
+public:
+  HRESULT Init(ID3D11Device* device, const wchar_t* filename);
+  HRESULT Init(ID3D11Device* device, const uint8_t* data, size_t size);
+
+  void Release();
+
+  ID3D11Buffer* GetVertexBuffer() const { return g_pVertexBuffer; };
+  ID3D11Buffer* GetIndexBuffer() const { return g_pIndexBuffer; };
+  DXGI_FORMAT GetIndexFormat() const { return indexFormat; };
+  UINT GetVertexStride() const { return sizeof(QuantizedTexVertex); };
+  UINT GetIndicesCount() const { return indicesCount; };
+
+  const VertexQuantization& GetQuantization() const { return quantization; };
+  const XMFLOAT4& GetBoundingSphere() const { return boundingSphere; };
+  // Object space AABB, same as quantization range
+  void GetBounds(XMFLOAT4& boundsMin, XMFLOAT4& boundsMax) const;
+  const std::vector<Meshlet>& GetMeshlets() const { return meshlets; };
+  // CPU copy of index buffer (GetIndexSize() bytes per index), used to compact visible meshlets
+  const std::vector<uint8_t>& GetIndices() const { return indices; };
+  UINT GetIndexSize() const { return indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4; };
+
+private:
+  ID3D11Buffer* g_pVertexBuffer = nullptr;
+  ID3D11Buffer* g_pIndexBuffer = nullptr;
+
+  DXGI_FORMAT indexFormat = DXGI_FORMAT_R16_UINT;
+  UINT indicesCount = 0;
+  VertexQuantization quantization = {};
+  XMFLOAT4 boundingSphere = {};
+  std::vector<Meshlet> meshlets;
+  std::vector<uint8_t> indices;
+};
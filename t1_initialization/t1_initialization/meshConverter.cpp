@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+#include "meshConverter.h"
+#include "vertexQuantizer.h"
+
+namespace {
+  // OBJ vertex reference: position / texcoord / normal, -1 when missing
+  struct ObjIndex {
+    int pos;
+    int uv;
+    int normal;
+
+    bool operator==(const ObjIndex& other) const {
+      return pos == other.pos && uv == other.uv && normal == other.normal;
+    }
+  };
+
+  struct ObjIndexHash {
+    size_t operator()(const ObjIndex& index) const {
+      uint64_t h = (uint64_t)(uint32_t)index.pos * 0x9E3779B97F4A7C15ull;
+      h ^= ((uint64_t)(uint32_t)index.uv + 0x7F4A7C15ull) * 0xC2B2AE3D27D4EB4Full;
+      h ^= ((uint64_t)(uint32_t)index.normal + 0x165667B1ull) * 0x165667B19E3779F9ull;
+      return (size_t)(h ^ (h >> 29));
+    }
+  };
+
+  bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && IsSpace(*p))
+      p++;
+    return p;
+  }
+
+  const char* SkipLine(const char* p, const char* end) {
+    while (p < end && *p != '\n')
+      p++;
+    return p < end ? p + 1 : end;
+  }
+
+  // Locale independent, much faster than strtof on large files
+  const char* ParseFloat(const char* p, const char* end, float& value) {
+    p = SkipSpaces(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+      negative = *p++ == '-';
+
+    const char* start = p;
+    double result = 0.0;
+    while (p < end && *p >= '0' && *p <= '9')
+      result = result * 10.0 + (*p++ - '0');
+
+    if (p < end && *p == '.') {
+      p++;
+      double scale = 0.1;
+      while (p < end && *p >= '0' && *p <= '9') {
+        result += (*p++ - '0') * scale;
+        scale *= 0.1;
+      }
+    }
+    if (p == start)
+      return nullptr;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+      p++;
+      bool negativeExp = false;
+      if (p < end && (*p == '-' || *p == '+'))
+        negativeExp = *p++ == '-';
+      int exponent = 0;
+      while (p < end && *p >= '0' && *p <= '9')
+        exponent = (std::min)(exponent * 10 + (*p++ - '0'), 1000);
+      result *= pow(10.0, negativeExp ? -exponent : exponent);
+    }
+
+    value = (float)(negative ? -result : result);
+    return p;
+  }
+
+  const char* ParseInt(const char* p, const char* end, int& value) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+      negative = *p++ == '-';
+
+    const char* start = p;
+    int64_t result = 0;
+    while (p < end && *p >= '0' && *p <= '9' && result <= INT32_MAX)
+      result = result * 10 + (*p++ - '0');
+    if (p == start || result > INT32_MAX)
+      return nullptr;
+
+    value = (int)(negative ? -result : result);
+    return p;
+  }
+
+  // 1-based or negative (relative to end) OBJ index -> 0-based, -1 if out of range
+  int ResolveIndex(int index, size_t count) {
+    if (index > 0 && (size_t)index <= count)
+      return index - 1;
+    if (index < 0 && (size_t)-index <= count)
+      return (int)count + index;
+    return -1;
+  }
+
+  XMFLOAT4 BoundingSphere(const MeshVertex* vertices, const uint32_t* indices, size_t indicesCount) {
+    XMVECTOR minPos = XMVectorReplicate(FLT_MAX);
+    XMVECTOR maxPos = XMVectorReplicate(-FLT_MAX);
+    for (size_t i = 0; i < indicesCount; i++) {
+      XMVECTOR pos = XMLoadFloat3(&vertices[indices[i]].pos);
+      minPos = XMVectorMin(minPos, pos);
+      maxPos = XMVectorMax(maxPos, pos);
+    }
+
+    XMVECTOR center = XMVectorScale(XMVectorAdd(minPos, maxPos), 0.5f);
+    float radius = 0.0f;
+    for (size_t i = 0; i < indicesCount; i++)
+      radius = std::max<float>(radius, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&vertices[indices[i]].pos), center))));
+
+    XMFLOAT4 sphere;
+    XMStoreFloat4(&sphere, center);
+    sphere.w = radius;
+    return sphere;
+  }
+
+  // Per vertex tangent along increasing u, orthogonal to normal
+  void CalculateTangents(const Mesh& mesh, std::vector<XMFLOAT3>& tangents) {
+    std::vector<XMVECTOR> accumulated(mesh.vertices.size(), XMVectorZero());
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+      const MeshVertex& v0 = mesh.vertices[mesh.indices[i]];
+      const MeshVertex& v1 = mesh.vertices[mesh.indices[i + 1]];
+      const MeshVertex& v2 = mesh.vertices[mesh.indices[i + 2]];
+
+      XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&v1.pos), XMLoadFloat3(&v0.pos));
+      XMVECTOR e2 = XMVectorSubtract(XMLoadFloat3(&v2.pos), XMLoadFloat3(&v0.pos));
+      float du1 = v1.uv.x - v0.uv.x, dv1 = v1.uv.y - v0.uv.y;
+      float du2 = v2.uv.x - v0.uv.x, dv2 = v2.uv.y - v0.uv.y;
+
+      float det = du1 * dv2 - du2 * dv1;
+      if (fabsf(det) < 1e-12f)
+        continue;
+
+      XMVECTOR tangent = XMVectorScale(XMVectorSubtract(XMVectorScale(e1, dv2), XMVectorScale(e2, dv1)), 1.0f / det);
+      for (size_t k = 0; k < 3; k++)
+        accumulated[mesh.indices[i + k]] = XMVectorAdd(accumulated[mesh.indices[i + k]], tangent);
+    }
+
+    tangents.resize(mesh.vertices.size());
+    for (size_t v = 0; v < mesh.vertices.size(); v++) {
+      XMVECTOR normal = XMLoadFloat3(&mesh.vertices[v].normal);
+      XMVECTOR tangent = XMVectorSubtract(accumulated[v], XMVectorScale(normal, XMVectorGetX(XMVector3Dot(normal, accumulated[v]))));
+
+      // No uv gradient: any direction orthogonal to normal
+      if (XMVectorGetX(XMVector3LengthSq(tangent)) < 1e-12f) {
+        XMVECTOR axis = fabsf(mesh.vertices[v].normal.x) < 0.9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+        tangent = XMVector3Cross(normal, axis);
+      }
+      XMStoreFloat3(&tangents[v], XMVector3Normalize(tangent));
+    }
+  }
+}
+
+bool MeshConverter::ParseOBJ(const char* text, size_t size, Mesh& mesh) {
+  mesh = Mesh();
+
+  std::vector<XMFLOAT3> positions;
+  std::vector<XMFLOAT2> uvs;
+  std::vector<XMFLOAT3> normals;
+
+  std::unordered_map<ObjIndex, uint32_t, ObjIndexHash> vertexMap;
+  std::vector<int> vertexPosition;  // source position of each output vertex
+  std::vector<bool> hasNormal;
+  std::vector<uint32_t> polygon;
+
+  const char* end = text + size;
+  for (const char* p = text; p < end; p = SkipLine(p, end)) {
+    p = SkipSpaces(p, end);
+    if (end - p < 2)
+      continue;
+
+    if (p[0] == 'v' && IsSpace(p[1])) {
+      XMFLOAT3 pos;
+      if (!(p = ParseFloat(p + 1, end, pos.x)) || !(p = ParseFloat(p, end, pos.y)) || !(p = ParseFloat(p, end, pos.z)))
+        return false;
+      // Right handed -> left handed
+      pos.z = -pos.z;
+      positions.push_back(pos);
+    } else if (p[0] == 'v' && p[1] == 't') {
+      XMFLOAT2 uv;
+      if (!(p = ParseFloat(p + 2, end, uv.x)) || !(p = ParseFloat(p, end, uv.y)))
+        return false;
+      uv.y = 1.0f - uv.y;
+      uvs.push_back(uv);
+    } else if (p[0] == 'v' && p[1] == 'n') {
+      XMFLOAT3 normal;
+      if (!(p = ParseFloat(p + 2, end, normal.x)) || !(p = ParseFloat(p, end, normal.y)) || !(p = ParseFloat(p, end, normal.z)))
+        return false;
+      normal.z = -normal.z;
+      XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&normal)));
+      normals.push_back(normal);
+    } else if (p[0] == 'f' && IsSpace(p[1])) {
+      polygon.clear();
+      p = SkipSpaces(p + 1, end);
+      while (p < end && *p != '\n' && *p != '#') {
+        ObjIndex index = { 0, -1, -1 };
+        int value = 0;
+        if (!(p = ParseInt(p, end, value)))
+          return false;
+        index.pos = ResolveIndex(value, positions.size());
+        if (index.pos < 0)
+          return false;
+
+        if (p < end && *p == '/') {
+          p++;
+          if (p < end && *p != '/') {
+            if (!(p = ParseInt(p, end, value)) || (index.uv = ResolveIndex(value, uvs.size())) < 0)
+              return false;
+          }
+          if (p < end && *p == '/') {
+            p++;
+            if (!(p = ParseInt(p, end, value)) || (index.normal = ResolveIndex(value, normals.size())) < 0)
+              return false;
+          }
+        }
+
+        auto it = vertexMap.find(index);
+        if (it == vertexMap.end()) {
+          MeshVertex vertex;
+          vertex.pos = positions[index.pos];
+          vertex.uv = index.uv >= 0 ? uvs[index.uv] : XMFLOAT2(0.0f, 0.0f);
+          vertex.normal = index.normal >= 0 ? normals[index.normal] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+          it = vertexMap.emplace(index, (uint32_t)mesh.vertices.size()).first;
+          mesh.vertices.push_back(vertex);
+          vertexPosition.push_back(index.pos);
+          hasNormal.push_back(index.normal >= 0);
+        }
+        polygon.push_back(it->second);
+        p = SkipSpaces(p, end);
+      }
+
+      // Fan triangulation, mirroring z flipped winding, so order is reversed to keep it clockwise
+      for (size_t i = 2; i < polygon.size(); i++) {
+        mesh.indices.push_back(polygon[0]);
+        mesh.indices.push_back(polygon[i]);
+        mesh.indices.push_back(polygon[i - 1]);
+      }
+    }
+  }
+
+  // Nothing to convert, later stages expect at least one triangle
+  if (mesh.indices.empty())
+    return false;
+
+  // Smooth normals for vertices without them, shared by all vertices at the same position
+  bool needNormals = std::find(hasNormal.begin(), hasNormal.end(), false) != hasNormal.end();
+  if (needNormals) {
+    std::vector<XMVECTOR> positionNormals(positions.size(), XMVectorZero());
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+      XMVECTOR p0 = XMLoadFloat3(&mesh.vertices[mesh.indices[i]].pos);
+      XMVECTOR p1 = XMLoadFloat3(&mesh.vertices[mesh.indices[i + 1]].pos);
+      XMVECTOR p2 = XMLoadFloat3(&mesh.vertices[mesh.indices[i + 2]].pos);
+      // Area weighted
+      XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+      for (size_t k = 0; k < 3; k++) {
+        int pos = vertexPosition[mesh.indices[i + k]];
+        positionNormals[pos] = XMVectorAdd(positionNormals[pos], normal);
+      }
+    }
+
+    for (size_t v = 0; v < mesh.vertices.size(); v++) {
+      if (hasNormal[v])
+        continue;
+      XMVECTOR normal = positionNormals[vertexPosition[v]];
+      if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)
+        XMStoreFloat3(&mesh.vertices[v].normal, XMVector3Normalize(normal));
+      else
+        mesh.vertices[v].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+    }
+  }
+
+  return true;
+}
+
+void MeshConverter::Build(Mesh& mesh, MeshFileData& result, MeshConvertStats* stats) {
+  MeshOptimizer::Optimize(mesh);
+
+  std::vector<XMFLOAT3> tangents;
+  CalculateTangents(mesh, tangents);
+
+  std::vector<TexVertex> vertices(mesh.vertices.size());
+  for (size_t v = 0; v < mesh.vertices.size(); v++) {
+    vertices[v].pos = mesh.vertices[v].pos;
+    vertices[v].uv = mesh.vertices[v].uv;
+    vertices[v].normal = mesh.vertices[v].normal;
+    vertices[v].tangent = tangents[v];
+  }
+
+  result.vertices.resize(vertices.size());
+  result.quantization = VertexQuantizer::Encode(vertices.data(), vertices.size(), result.vertices.data());
+  result.indices = mesh.indices;
+  result.boundingSphere = BoundingSphere(mesh.vertices.data(), mesh.indices.data(), mesh.indices.size());
+
+  // Consecutive triangles after cache optimization are spatially close, so they make tight meshlets
+  MeshletBuilder::Build(&mesh.vertices[0].pos, sizeof(MeshVertex), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(), result.meshlets);
+
+  if (stats) {
+    stats->verticesCount = (uint32_t)result.vertices.size();
+    stats->trianglesCount = (uint32_t)(result.indices.size() / 3);
+    stats->meshletsCount = (uint32_t)result.meshlets.size();
+    stats->acmrBefore = mesh.acmrBefore;
+    stats->acmrAfter = mesh.acmrAfter;
+  }
+}
+
+HRESULT MeshConverter::ConvertFile(const wchar_t* srcPath, const wchar_t* dstPath, MeshConvertStats* stats) {
+  HANDLE file = CreateFileW(srcPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+
+  LARGE_INTEGER size = {};
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return HRESULT_FROM_WIN32(GetLastError());
+  }
+
+  // Read in chunks, single ReadFile is limited to 4 GB
+  std::vector<char> text((size_t)size.QuadPart);
+  size_t readTotal = 0;
+  while (readTotal < text.size()) {
+    DWORD chunk = (DWORD)std::min<size_t>(text.size() - readTotal, 1u << 30);
+    DWORD bytesRead = 0;
+    if (!ReadFile(file, text.data() + readTotal, chunk, &bytesRead, nullptr) || bytesRead == 0)
+      break;
+    readTotal += bytesRead;
+  }
+  CloseHandle(file);
+  if (readTotal != text.size())
+    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+  Mesh mesh;
+  if (!ParseOBJ(text.data(), text.size(), mesh))
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  text = std::vector<char>();
+
+  MeshFileData meshData;
+  Build(mesh, meshData, stats);
+
+  std::vector<uint8_t> data;
+  SerializeMeshFile(meshData, data);
+
+  file = CreateFileW(dstPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+
+  HRESULT hr = S_OK;
+  size_t written = 0;
+  while (written < data.size() && SUCCEEDED(hr)) {
+    DWORD chunk = (DWORD)std::min<size_t>(data.size() - written, 1u << 30);
+    DWORD bytesWritten = 0;
+    if (!WriteFile(file, data.data() + written, chunk, &bytesWritten, nullptr))
+      hr = HRESULT_FROM_WIN32(GetLastError());
+    written += bytesWritten;
+  }
+  CloseHandle(file);
+  return hr;
+}
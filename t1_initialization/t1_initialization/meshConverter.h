@@ -0,0 +1,30 @@
+#pragma once
+
+#include <windows.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "meshFile.h"
+#include "meshGenerator.h"
+
+struct MeshConvertStats {
+  uint32_t verticesCount = 0;
+  uint32_t trianglesCount = 0;
+  uint32_t meshletsCount = 0;
+  float acmrBefore = 0.0f;
+  float acmrAfter = 0.0f;
+};
+
+// Offline conversion of source meshes to mesh file format
+class MeshConverter {
+public:
+  // Wavefront OBJ: v / vt / vn / f, polygons are triangulated as fans, other statements are skipped.
+  // Result is converted to left handed system with clockwise front faces, uv origin at top left.
+  // Fails on text without any triangle
+  static bool ParseOBJ(const char* text, size_t size, Mesh& mesh);
+
+  // Cache / fetch optimization, tangents, quantization and meshlets
+  static void Build(Mesh& mesh, MeshFileData& result, MeshConvertStats* stats = nullptr);
+
+  static HRESULT ConvertFile(const wchar_t* srcPath, const wchar_t* dstPath, MeshConvertStats* stats = nullptr);
+};
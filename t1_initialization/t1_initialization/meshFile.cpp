@@ -0,0 +1,105 @@
+#include <cstring>
+
+#include "meshFile.h"
+
+namespace {
+  uint64_t AlignUp(uint64_t value) {
+    return (value + MESH_FILE_ALIGNMENT - 1) & ~uint64_t(MESH_FILE_ALIGNMENT - 1);
+  }
+
+  // Block lies inside data and starts at aligned offset, computed in 64 bits so counts can't overflow
+  bool CheckBlock(uint64_t offset, uint64_t count, uint64_t elementSize, size_t dataSize) {
+    if (offset % MESH_FILE_ALIGNMENT != 0 || offset < sizeof(MeshFileHeader))
+      return false;
+    return offset <= dataSize && count * elementSize <= dataSize - offset;
+  }
+}
+
+MESH_PARSE_RESULT ParseMeshFile(const uint8_t* data, size_t size, MeshFileView& view) {
+  view = MeshFileView();
+
+  if (!data || size < sizeof(MeshFileHeader))
+    return MESH_PARSE_TOO_SMALL;
+
+  auto header = reinterpret_cast<const MeshFileHeader*>(data);
+  if (header->magic != MESH_FILE_MAGIC)
+    return MESH_PARSE_BAD_MAGIC;
+  if (header->version != MESH_FILE_VERSION)
+    return MESH_PARSE_UNSUPPORTED_VERSION;
+  if ((header->indexSize != 2 && header->indexSize != 4) || header->vertexStride != sizeof(QuantizedTexVertex))
+    return MESH_PARSE_BAD_FORMAT;
+  if (header->indicesCount % 3 != 0)
+    return MESH_PARSE_BAD_FORMAT;
+
+  if (!CheckBlock(header->vertexOffset, header->verticesCount, header->vertexStride, size) ||
+    !CheckBlock(header->indexOffset, header->indicesCount, header->indexSize, size) ||
+    !CheckBlock(header->meshletOffset, header->meshletsCount, sizeof(Meshlet), size))
+    return MESH_PARSE_BAD_BLOCK;
+
+  view.header = header;
+  view.vertices = reinterpret_cast<const QuantizedTexVertex*>(data + header->vertexOffset);
+  view.indices = data + header->indexOffset;
+  view.meshlets = reinterpret_cast<const Meshlet*>(data + header->meshletOffset);
+
+  // GPU would just read zeros, but CPU users (culling, picking) index arrays directly
+  uint32_t maxIndex = 0;
+  if (header->indexSize == 2) {
+    auto indices = static_cast<const uint16_t*>(view.indices);
+    for (uint32_t i = 0; i < header->indicesCount; i++)
+      maxIndex = indices[i] > maxIndex ? indices[i] : maxIndex;
+  } else {
+    auto indices = static_cast<const uint32_t*>(view.indices);
+    for (uint32_t i = 0; i < header->indicesCount; i++)
+      maxIndex = indices[i] > maxIndex ? indices[i] : maxIndex;
+  }
+  if (header->indicesCount > 0 && maxIndex >= header->verticesCount) {
+    view = MeshFileView();
+    return MESH_PARSE_BAD_INDEX;
+  }
+
+  for (uint32_t i = 0; i < header->meshletsCount; i++) {
+    const Meshlet& meshlet = view.meshlets[i];
+    if (meshlet.trianglesCount > MESHLET_MAX_TRIANGLES || meshlet.verticesCount > MESHLET_MAX_VERTICES || meshlet.indexStart % 3 != 0 ||
+      (uint64_t)meshlet.indexStart + meshlet.trianglesCount * 3ull > header->indicesCount) {
+      view = MeshFileView();
+      return MESH_PARSE_BAD_MESHLET;
+    }
+  }
+
+  return MESH_PARSE_OK;
+}
+
+void SerializeMeshFile(const MeshFileData& mesh, std::vector<uint8_t>& data) {
+  MeshFileHeader header = {};
+  header.magic = MESH_FILE_MAGIC;
+  header.version = MESH_FILE_VERSION;
+  header.verticesCount = (uint32_t)mesh.vertices.size();
+  header.indicesCount = (uint32_t)mesh.indices.size();
+  header.indexSize = mesh.vertices.size() <= 0x10000 ? 2 : 4;
+  header.vertexStride = sizeof(QuantizedTexVertex);
+  header.meshletsCount = (uint32_t)mesh.meshlets.size();
+  header.quantization = mesh.quantization;
+  header.boundingSphere = mesh.boundingSphere;
+
+  header.vertexOffset = AlignUp(sizeof(MeshFileHeader));
+  header.indexOffset = AlignUp(header.vertexOffset + (uint64_t)header.verticesCount * header.vertexStride);
+  header.meshletOffset = AlignUp(header.indexOffset + (uint64_t)header.indicesCount * header.indexSize);
+  uint64_t size = header.meshletOffset + (uint64_t)header.meshletsCount * sizeof(Meshlet);
+
+  // Padding stays zero
+  data.assign((size_t)size, 0);
+  memcpy(data.data(), &header, sizeof(header));
+  if (!mesh.vertices.empty())
+    memcpy(data.data() + header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(QuantizedTexVertex));
+
+  if (header.indexSize == 2) {
+    auto indices = reinterpret_cast<uint16_t*>(data.data() + header.indexOffset);
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+      indices[i] = (uint16_t)mesh.indices[i];
+  } else if (!mesh.indices.empty()) {
+    memcpy(data.data() + header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+  }
+
+  if (!mesh.meshlets.empty())
+    memcpy(data.data() + header.meshletOffset, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+}
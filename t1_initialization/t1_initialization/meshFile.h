@@ -0,0 +1,74 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "def.h"
+#include "meshlet.h"
+
+using namespace DirectX;
+
+// Mesh file layout (all values little endian):
+//   MeshFileHeader
+//   QuantizedTexVertex[verticesCount]   - at vertexOffset
+//   uint16_t / uint32_t[indicesCount]   - at indexOffset, indexSize bytes each
+//   Meshlet[meshletsCount]              - at meshletOffset
+// Every block starts at MESH_FILE_ALIGNMENT boundary, so it can be used right from mapped memory
+#define MESH_FILE_MAGIC 0x4853454D // 'MESH'
+#define MESH_FILE_VERSION 2
+#define MESH_FILE_ALIGNMENT 64
+
+struct MeshFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t verticesCount;
+  uint32_t indicesCount;
+  uint32_t indexSize;     // 2 or 4
+  uint32_t vertexStride;  // sizeof(QuantizedTexVertex)
+  uint32_t meshletsCount;
+  uint32_t reserved;
+  VertexQuantization quantization;
+  XMFLOAT4 boundingSphere; // xyz - center, w - radius
+  uint64_t vertexOffset;
+  uint64_t indexOffset;
+  uint64_t meshletOffset;
+};
+
+// Parsed file, all pointers go into source data
+struct MeshFileView {
+  const MeshFileHeader* header = nullptr;
+  const QuantizedTexVertex* vertices = nullptr;
+  const void* indices = nullptr;
+  const Meshlet* meshlets = nullptr;
+
+  uint32_t GetIndex(size_t i) const {
+    return header->indexSize == 2 ? static_cast<const uint16_t*>(indices)[i] : static_cast<const uint32_t*>(indices)[i];
+  };
+};
+
+enum MESH_PARSE_RESULT {
+  MESH_PARSE_OK = 0,
+  MESH_PARSE_TOO_SMALL,
+  MESH_PARSE_BAD_MAGIC,
+  MESH_PARSE_UNSUPPORTED_VERSION,
+  MESH_PARSE_BAD_FORMAT,        // index size, vertex stride
+  MESH_PARSE_BAD_BLOCK,         // block out of data or misaligned
+  MESH_PARSE_BAD_INDEX,         // index refers out of vertices
+  MESH_PARSE_BAD_MESHLET        // meshlet out of indices or over limits
+};
+
+// Device free validation of whole file (header, blocks, every index and meshlet)
+MESH_PARSE_RESULT ParseMeshFile(const uint8_t* data, size_t size, MeshFileView& view);
+
+// Mesh ready to be stored, vertices are already quantized
+struct MeshFileData {
+  VertexQuantization quantization = {};
+  XMFLOAT4 boundingSphere = {};
+  std::vector<QuantizedTexVertex> vertices;
+  std::vector<uint32_t> indices;    // stored as 16 bit if all of them fit
+  std::vector<Meshlet> meshlets;
+};
+
+void SerializeMeshFile(const MeshFileData& mesh, std::vector<uint8_t>& data);
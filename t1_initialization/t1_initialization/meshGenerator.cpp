@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "meshGenerator.h"
+
+namespace {
+  // Forsyth's tuning values from the original article
+  const uint32_t FORSYTH_CACHE_SIZE = 32;
+  const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+  const float FORSYTH_LAST_TRI_SCORE = 0.75f;
+  const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+  const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+  float VertexScore(int cachePos, uint32_t remainingValence) {
+    // Nothing left to draw with this vertex
+    if (remainingValence == 0)
+      return -1.0f;
+
+    float score = 0.0f;
+    if (cachePos >= 0) {
+      // Vertices of just drawn triangle get fixed score, so next one is not picked from them only
+      if (cachePos < 3)
+        score = FORSYTH_LAST_TRI_SCORE;
+      else
+        score = powf(1.0f - (cachePos - 3) / float(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+    }
+
+    // Finish vertices with few triangles left, they would be lonely later
+    score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingValence, -FORSYTH_VALENCE_BOOST_POWER);
+    return score;
+  }
+
+  MeshVertex MakeVertex(const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT2& uv) {
+    MeshVertex vertex;
+    vertex.pos = pos;
+    vertex.normal = normal;
+    vertex.uv = uv;
+    return vertex;
+  }
+
+  // Spherical projection, used for meshes without natural uv layout
+  XMFLOAT2 SphereUV(const XMFLOAT3& dir) {
+    return XMFLOAT2(0.5f + atan2f(dir.z, dir.x) / XM_2PI, acosf(std::max(-1.0f, std::min(1.0f, dir.y))) / XM_PI);
+  }
+
+  // Square of side 1 centered at normal * 0.5, edges go along axis and cross(normal, axis)
+  void AddFace(Mesh& mesh, const XMFLOAT3& normal, const XMFLOAT3& axis) {
+    XMVECTOR n = XMLoadFloat3(&normal);
+    XMVECTOR a = XMLoadFloat3(&axis);
+    XMVECTOR b = XMVector3Cross(n, a);
+
+    auto base = (uint32_t)mesh.vertices.size();
+    static const float corners[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+    for (auto& corner : corners) {
+      XMFLOAT3 pos;
+      XMStoreFloat3(&pos, XMVectorScale(XMVectorAdd(n, XMVectorAdd(XMVectorScale(a, corner[0]), XMVectorScale(b, corner[1]))), 0.5f));
+      mesh.vertices.push_back(MakeVertex(pos, normal, XMFLOAT2((corner[0] + 1) * 0.5f, (1 - corner[1]) * 0.5f)));
+    }
+
+    // cross(a, b) == n, so this winding faces outside
+    uint32_t faceIndices[] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+    mesh.indices.insert(mesh.indices.end(), std::begin(faceIndices), std::end(faceIndices));
+  }
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t verticesCount) {
+  size_t trianglesCount = indices.size() / 3;
+  if (trianglesCount == 0)
+    return;
+
+  // Vertex -> triangles adjacency, first 'valence[v]' entries of each list are not emitted yet
+  std::vector<uint32_t> valence(verticesCount, 0);
+  for (uint32_t index : indices)
+    valence[index]++;
+
+  std::vector<uint32_t> adjacencyOffset(verticesCount + 1, 0);
+  for (size_t v = 0; v < verticesCount; v++)
+    adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+  for (size_t t = 0; t < trianglesCount; t++)
+    for (size_t k = 0; k < 3; k++)
+      adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+
+  std::vector<int> cachePos(verticesCount, -1);
+  std::vector<float> vertexScore(verticesCount);
+  for (size_t v = 0; v < verticesCount; v++)
+    vertexScore[v] = VertexScore(-1, valence[v]);
+
+  std::vector<float> triangleScore(trianglesCount);
+  for (size_t t = 0; t < trianglesCount; t++)
+    triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+  std::vector<bool> emitted(trianglesCount, false);
+  std::vector<uint32_t> result;
+  result.reserve(trianglesCount * 3);
+
+  std::vector<uint32_t> cache, newCache;
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+  size_t scanCursor = 0;
+  int64_t bestTriangle = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+
+  for (size_t emittedCount = 0; emittedCount < trianglesCount; emittedCount++) {
+    if (bestTriangle < 0) {
+      // Nothing useful in cache, continue with next unused triangle
+      while (emitted[scanCursor])
+        scanCursor++;
+      bestTriangle = (int64_t)scanCursor;
+    }
+
+    const uint32_t* tri = &indices[size_t(bestTriangle) * 3];
+    result.insert(result.end(), tri, tri + 3);
+    emitted[size_t(bestTriangle)] = true;
+
+    // Drop triangle from adjacency of its vertices
+    for (size_t k = 0; k < 3; k++) {
+      uint32_t v = tri[k];
+      uint32_t* list = &adjacency[adjacencyOffset[v]];
+      uint32_t* last = list + valence[v] - 1;
+      *std::find(list, last + 1, (uint32_t)bestTriangle) = *last;
+      valence[v]--;
+    }
+
+    // Triangle vertices go to cache front, the rest shift back
+    newCache.assign(tri, tri + 3);
+    for (uint32_t v : cache)
+      if (v != tri[0] && v != tri[1] && v != tri[2])
+        newCache.push_back(v);
+
+    for (size_t i = 0; i < newCache.size(); i++) {
+      uint32_t v = newCache[i];
+      cachePos[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+
+      float score = VertexScore(cachePos[v], valence[v]);
+      float delta = score - vertexScore[v];
+      vertexScore[v] = score;
+      for (uint32_t j = 0; j < valence[v]; j++)
+        triangleScore[adjacency[adjacencyOffset[v] + j]] += delta;
+    }
+    if (newCache.size() > FORSYTH_CACHE_SIZE)
+      newCache.resize(FORSYTH_CACHE_SIZE);
+    cache.swap(newCache);
+
+    // Next triangle is searched only around cache, that keeps algorithm linear
+    bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (uint32_t v : cache) {
+      for (uint32_t j = 0; j < valence[v]; j++) {
+        uint32_t t = adjacency[adjacencyOffset[v] + j];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          bestTriangle = t;
+        }
+      }
+    }
+  }
+
+  indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices) {
+  std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+  std::vector<MeshVertex> result;
+  result.reserve(vertices.size());
+
+  // Unused vertices are dropped
+  for (auto& index : indices) {
+    if (remap[index] == UINT32_MAX) {
+      remap[index] = (uint32_t)result.size();
+      result.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+
+  vertices.swap(result);
+}
+
+float MeshOptimizer::CalculateACMR(const std::vector<uint32_t>& indices, size_t verticesCount, uint32_t cacheSize) {
+  if (indices.size() < 3)
+    return 0.0f;
+
+  // FIFO cache: vertex is still there if less than cacheSize misses happened after it was loaded
+  std::vector<uint32_t> loadedAt(verticesCount, 0);
+  uint32_t misses = 0;
+  for (uint32_t index : indices) {
+    if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+      loadedAt[index] = misses + 1;
+      misses++;
+    }
+  }
+
+  return (float)misses / (indices.size() / 3);
+}
+
+void MeshOptimizer::Optimize(Mesh& mesh) {
+  mesh.acmrBefore = CalculateACMR(mesh.indices, mesh.vertices.size());
+
+  // Tiny meshes may already fit cache better than Forsyth order does
+  std::vector<uint32_t> indices = mesh.indices;
+  OptimizeVertexCache(indices, mesh.vertices.size());
+  if (CalculateACMR(indices, mesh.vertices.size()) < mesh.acmrBefore)
+    mesh.indices.swap(indices);
+
+  OptimizeVertexFetch(mesh.vertices, mesh.indices);
+  mesh.acmrAfter = CalculateACMR(mesh.indices, mesh.vertices.size());
+}
+
+MeshGenerator& MeshGenerator::GetInstance() {
+  static MeshGenerator generatorInstance;
+  return generatorInstance;
+}
+
+const Mesh& MeshGenerator::Get(MeshShape shape, uint32_t param0, uint32_t param1) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+
+  auto& mesh = cache[MeshKey(shape, param0, param1)];
+  if (!mesh) {
+    mesh.reset(new Mesh());
+    switch (shape) {
+    case MESH_UV_SPHERE:
+      BuildUVSphere(param0, param1, *mesh);
+      break;
+    case MESH_ICOSPHERE:
+      BuildIcosphere(param0, *mesh);
+      break;
+    case MESH_CUBE:
+      BuildCube(*mesh);
+      break;
+    case MESH_QUAD:
+      BuildQuad(*mesh);
+      break;
+    }
+    MeshOptimizer::Optimize(*mesh);
+  }
+
+  return *mesh;
+}
+
+const Mesh& MeshGenerator::GetUVSphere(uint32_t latLines, uint32_t longLines) {
+  return Get(MESH_UV_SPHERE, latLines, longLines);
+}
+
+const Mesh& MeshGenerator::GetIcosphere(uint32_t subdivisions) {
+  return Get(MESH_ICOSPHERE, subdivisions, 0);
+}
+
+const Mesh& MeshGenerator::GetCube() {
+  return Get(MESH_CUBE, 0, 0);
+}
+
+const Mesh& MeshGenerator::GetQuad() {
+  return Get(MESH_QUAD, 0, 0);
+}
+
+void MeshGenerator::BuildUVSphere(uint32_t latLines, uint32_t longLines, Mesh& mesh) {
+  latLines = std::max(latLines, 3u);
+  longLines = std::max(longLines, 3u);
+
+  uint32_t verticesCount = (latLines - 2) * longLines + 2;
+  mesh.vertices.clear();
+  mesh.vertices.reserve(verticesCount);
+  mesh.indices.clear();
+  mesh.indices.reserve(((latLines - 3) * longLines * 2 + longLines * 2) * 3);
+
+  // Poles are on Z axis, rings go around it
+  mesh.vertices.push_back(MakeVertex(XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, 1), XMFLOAT2(0, 0)));
+  for (uint32_t i = 0; i < latLines - 2; i++) {
+    float pitch = (i + 1) * (XM_PI / (latLines - 1));
+    float sinPitch = sinf(pitch), cosPitch = cosf(pitch);
+    for (uint32_t j = 0; j < longLines; j++) {
+      float yaw = j * (XM_2PI / longLines);
+      XMFLOAT3 pos(sinPitch * sinf(yaw), -sinPitch * cosf(yaw), cosPitch);
+      mesh.vertices.push_back(MakeVertex(pos, pos, XMFLOAT2((float)j / longLines, pitch / XM_PI)));
+    }
+  }
+  mesh.vertices.push_back(MakeVertex(XMFLOAT3(0, 0, -1), XMFLOAT3(0, 0, -1), XMFLOAT2(0, 1)));
+
+  auto ring = [&](uint32_t i, uint32_t j) { return i * longLines + (j % longLines) + 1; };
+  uint32_t bottom = verticesCount - 1;
+  auto addTriangle = [&](uint32_t a, uint32_t b, uint32_t c) {
+    mesh.indices.push_back(a);
+    mesh.indices.push_back(b);
+    mesh.indices.push_back(c);
+  };
+
+  for (uint32_t j = 0; j < longLines; j++)
+    addTriangle(0, ring(0, j), ring(0, j + 1));
+
+  for (uint32_t i = 0; i < latLines - 3; i++) {
+    for (uint32_t j = 0; j < longLines; j++) {
+      addTriangle(ring(i, j), ring(i + 1, j), ring(i, j + 1));
+      addTriangle(ring(i + 1, j), ring(i + 1, j + 1), ring(i, j + 1));
+    }
+  }
+
+  for (uint32_t j = 0; j < longLines; j++)
+    addTriangle(bottom, ring(latLines - 3, j + 1), ring(latLines - 3, j));
+}
+
+void MeshGenerator::BuildIcosphere(uint32_t subdivisions, Mesh& mesh) {
+  const float t = (1.0f + sqrtf(5.0f)) * 0.5f;
+  std::vector<XMFLOAT3> positions = {
+    {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+    {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+    {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}
+  };
+  std::vector<uint32_t> indices = {
+    0, 5, 11,  0, 1, 5,  0, 7, 1,  0, 10, 7,  0, 11, 10,
+    1, 9, 5,  5, 4, 11,  11, 2, 10,  10, 6, 7,  7, 8, 1,
+    3, 4, 9,  3, 2, 4,  3, 6, 2,  3, 8, 6,  3, 9, 8,
+    4, 5, 9,  2, 11, 4,  6, 10, 2,  8, 7, 6,  9, 1, 8
+  };
+
+  for (auto& pos : positions)
+    XMStoreFloat3(&pos, XMVector3Normalize(XMLoadFloat3(&pos)));
+
+  // Split every triangle into 4, shared edge midpoints are created once
+  for (uint32_t level = 0; level < subdivisions; level++) {
+    std::unordered_map<uint64_t, uint32_t> midpoints;
+    auto midpoint = [&](uint32_t a, uint32_t b) {
+      uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+      auto it = midpoints.find(key);
+      if (it != midpoints.end())
+        return it->second;
+
+      XMFLOAT3 pos;
+      XMStoreFloat3(&pos, XMVector3Normalize(XMVectorAdd(XMLoadFloat3(&positions[a]), XMLoadFloat3(&positions[b]))));
+      positions.push_back(pos);
+      midpoints[key] = (uint32_t)positions.size() - 1;
+      return (uint32_t)positions.size() - 1;
+    };
+
+    std::vector<uint32_t> next;
+    next.reserve(indices.size() * 4);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+      uint32_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+      uint32_t split[] = { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca };
+      next.insert(next.end(), std::begin(split), std::end(split));
+    }
+    indices.swap(next);
+  }
+
+  // Source table is counter clockwise from outside, flip it to outward cross product
+  for (size_t i = 0; i < indices.size(); i += 3)
+    std::swap(indices[i + 1], indices[i + 2]);
+
+  mesh.vertices.clear();
+  mesh.vertices.reserve(positions.size());
+  for (auto& pos : positions)
+    mesh.vertices.push_back(MakeVertex(pos, pos, SphereUV(pos)));
+  mesh.indices.swap(indices);
+}
+
+void MeshGenerator::BuildCube(Mesh& mesh) {
+  mesh.vertices.clear();
+  mesh.indices.clear();
+
+  AddFace(mesh, XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1));
+  AddFace(mesh, XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 0, -1));
+  AddFace(mesh, XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0));
+  AddFace(mesh, XMFLOAT3(0, -1, 0), XMFLOAT3(1, 0, 0));
+  AddFace(mesh, XMFLOAT3(0, 0, 1), XMFLOAT3(-1, 0, 0));
+  AddFace(mesh, XMFLOAT3(0, 0, -1), XMFLOAT3(1, 0, 0));
+}
+
+void MeshGenerator::BuildQuad(Mesh& mesh) {
+  mesh.vertices.clear();
+  mesh.indices.clear();
+
+  AddFace(mesh, XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0));
+
+  // Face is built around normal * 0.5, move it into XZ plane
+  for (auto& vertex : mesh.vertices)
+    vertex.pos.y = 0.0f;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+using namespace DirectX;
+
+// Post-transform cache size used for ACMR reports (typical for desktop GPUs)
+#define MESH_ACMR_CACHE_SIZE 16
+
+struct MeshVertex {
+  XMFLOAT3 pos;
+  XMFLOAT3 normal;
+  XMFLOAT2 uv;
+};
+
+// Indexed triangle list, faces are wound so cross(v1 - v0, v2 - v0) points outside
+struct Mesh {
+  std::vector<MeshVertex> vertices;
+  std::vector<uint32_t> indices;
+
+  // Average cache miss ratio (transformed vertices per triangle) before and after optimization
+  float acmrBefore = 0.0f;
+  float acmrAfter = 0.0f;
+};
+
+// Index / vertex buffer post processing, pure C++ so meshes can be prepared offline as well
+class MeshOptimizer {
+public:
+  // Reorder triangles for post-transform cache reuse (Tom Forsyth's linear-speed algorithm)
+  static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t verticesCount);
+
+  // Reorder vertices in order of first use, so vertex fetch goes linearly through memory
+  static void OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices);
+
+  // Misses of FIFO cache of given size per triangle, 0.5 is the best possible, 3.0 - no reuse at all
+  static float CalculateACMR(const std::vector<uint32_t>& indices, size_t verticesCount, uint32_t cacheSize = MESH_ACMR_CACHE_SIZE);
+
+  // Full pass: vertex cache, then fetch order, fills ACMR stats
+  static void Optimize(Mesh& mesh);
+};
+
+// Procedural meshes of unit size (sphere / icosphere radius 1, cube and quad side 1), cached by parameters
+class MeshGenerator {
+public:
+  // Make class singleton
+  static MeshGenerator& GetInstance();
+  MeshGenerator(const MeshGenerator&) = delete;
+  MeshGenerator(MeshGenerator&&) = delete;
+
+  // Latitude lines include both poles
+  const Mesh& GetUVSphere(uint32_t latLines, uint32_t longLines);
+  const Mesh& GetIcosphere(uint32_t subdivisions);
+  const Mesh& GetCube();
+  // Quad lies in XZ plane and faces +Y
+  const Mesh& GetQuad();
+
+  // Uncached builders
+  static void BuildUVSphere(uint32_t latLines, uint32_t longLines, Mesh& mesh);
+  static void BuildIcosphere(uint32_t subdivisions, Mesh& mesh);
+  static void BuildCube(Mesh& mesh);
+  static void BuildQuad(Mesh& mesh);
+
+private:
+  // Private constructor (for singleton)
+  MeshGenerator() = default;
+
+  enum MeshShape {
+    MESH_UV_SPHERE,
+    MESH_ICOSPHERE,
+    MESH_CUBE,
+    MESH_QUAD
+  };
+
+  typedef std::tuple<MeshShape, uint32_t, uint32_t> MeshKey;
+
+  const Mesh& Get(MeshShape shape, uint32_t param0, uint32_t param1);
+
+  // Meshes are never removed, so returned references stay valid
+  std::map<MeshKey, std::unique_ptr<Mesh>> cache;
+  std::mutex cacheMutex;
+};
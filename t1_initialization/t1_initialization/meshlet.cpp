@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "meshlet.h"
+#include "frameArena.h"
+
+namespace {
+  // Normals spread wider than this (cos of angle from axis) make cone useless
+  const float MESHLET_CONE_MIN_DOT = 0.1f;
+
+  XMVECTOR LoadPosition(const XMFLOAT3* positions, size_t stride, uint32_t index) {
+    return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + index * stride));
+  }
+}
+
+void MeshletBuilder::Build(const XMFLOAT3* positions, size_t stride, size_t verticesCount, const uint32_t* indices, size_t indicesCount,
+  std::vector<Meshlet>& meshlets, uint32_t maxVertices, uint32_t maxTriangles) {
+  meshlets.clear();
+  if (indicesCount < 3)
+    return;
+
+  // Vertex is in current meshlet if it was stamped with current meshlet number
+  std::vector<uint32_t> stamp(verticesCount, UINT32_MAX);
+
+  Meshlet meshlet = {};
+  for (size_t i = 0; i + 2 < indicesCount; i += 3) {
+    uint32_t id = (uint32_t)meshlets.size();
+    uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+    uint32_t newVertices = (stamp[a] != id) + (stamp[b] != id && b != a) + (stamp[c] != id && c != a && c != b);
+
+    if (meshlet.trianglesCount > 0 &&
+      (meshlet.verticesCount + newVertices > maxVertices || meshlet.trianglesCount + 1 > maxTriangles)) {
+      ComputeBounds(positions, stride, indices, meshlet);
+      meshlets.push_back(meshlet);
+
+      id++;
+      meshlet = {};
+      meshlet.indexStart = (uint32_t)i;
+    }
+
+    for (size_t k = 0; k < 3; k++) {
+      if (stamp[indices[i + k]] != id) {
+        stamp[indices[i + k]] = id;
+        meshlet.verticesCount++;
+      }
+    }
+    meshlet.trianglesCount++;
+  }
+
+  ComputeBounds(positions, stride, indices, meshlet);
+  meshlets.push_back(meshlet);
+}
+
+void MeshletBuilder::ComputeBounds(const XMFLOAT3* positions, size_t stride, const uint32_t* indices, Meshlet& meshlet) {
+  const uint32_t* meshletIndices = indices + meshlet.indexStart;
+  size_t indicesCount = meshlet.trianglesCount * 3;
+
+  // Sphere around AABB center
+  XMVECTOR minPos = XMVectorReplicate(FLT_MAX);
+  XMVECTOR maxPos = XMVectorReplicate(-FLT_MAX);
+  for (size_t i = 0; i < indicesCount; i++) {
+    XMVECTOR pos = LoadPosition(positions, stride, meshletIndices[i]);
+    minPos = XMVectorMin(minPos, pos);
+    maxPos = XMVectorMax(maxPos, pos);
+  }
+  XMVECTOR center = XMVectorScale(XMVectorAdd(minPos, maxPos), 0.5f);
+
+  float radius = 0.0f;
+  for (size_t i = 0; i < indicesCount; i++)
+    radius = std::max<float>(radius, XMVectorGetX(XMVector3Length(XMVectorSubtract(LoadPosition(positions, stride, meshletIndices[i]), center))));
+
+  XMStoreFloat4(&meshlet.boundingSphere, center);
+  meshlet.boundingSphere.w = radius;
+
+  // Cone axis is average of triangle normals, cutoff comes from the normal farthest from it
+  std::vector<XMVECTOR> normals;
+  normals.reserve(meshlet.trianglesCount);
+  XMVECTOR axis = XMVectorZero();
+  for (size_t i = 0; i < indicesCount; i += 3) {
+    XMVECTOR p0 = LoadPosition(positions, stride, meshletIndices[i]);
+    XMVECTOR normal = XMVector3Cross(
+      XMVectorSubtract(LoadPosition(positions, stride, meshletIndices[i + 1]), p0),
+      XMVectorSubtract(LoadPosition(positions, stride, meshletIndices[i + 2]), p0));
+    // Degenerate triangles are never visible
+    if (XMVectorGetX(XMVector3LengthSq(normal)) < 1e-20f) {
+      normals.push_back(XMVectorZero());
+      continue;
+    }
+    normal = XMVector3Normalize(normal);
+    normals.push_back(normal);
+    axis = XMVectorAdd(axis, normal);
+  }
+
+  meshlet.coneApex = XMFLOAT4(meshlet.boundingSphere.x, meshlet.boundingSphere.y, meshlet.boundingSphere.z, 1.0f);
+  meshlet.coneAxis = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+  if (XMVectorGetX(XMVector3LengthSq(axis)) < 1e-20f)
+    return;
+  axis = XMVector3Normalize(axis);
+
+  float minDot = 1.0f;
+  for (auto& normal : normals)
+    if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)
+      minDot = (std::min)(minDot, XMVectorGetX(XMVector3Dot(axis, normal)));
+  if (minDot < MESHLET_CONE_MIN_DOT)
+    return;
+
+  // Apex is moved back along axis until it is behind every triangle plane,
+  // then any view direction inside the cone from apex sees backs of all triangles
+  float maxT = 0.0f;
+  for (size_t i = 0; i < indicesCount; i += 3) {
+    XMVECTOR normal = normals[i / 3];
+    if (XMVectorGetX(XMVector3LengthSq(normal)) == 0.0f)
+      continue;
+    XMVECTOR p0 = LoadPosition(positions, stride, meshletIndices[i]);
+    float distance = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, p0), normal));
+    float speed = XMVectorGetX(XMVector3Dot(axis, normal));
+    maxT = std::max<float>(maxT, distance / speed);
+  }
+
+  XMStoreFloat4(&meshlet.coneApex, XMVectorSubtract(center, XMVectorScale(axis, maxT)));
+  meshlet.coneApex.w = 1.0f;
+  XMStoreFloat4(&meshlet.coneAxis, axis);
+  meshlet.coneAxis.w = sqrtf(std::max<float>(1.0f - minDot * minDot, 0.0f));
+}
+
+void MeshletCuller::Cull(const Meshlet* meshlets, size_t count, const XMMATRIX* worldMatrices, size_t instancesCount,
+  const XMFLOAT4 planes[6], const XMFLOAT3& cameraPos, std::vector<uint32_t>& visible, MeshletCullStats* stats) {
+  visible.clear();
+  MeshletCullStats localStats;
+
+  // Planes and camera go to object space of each instance once, meshlets are tested there
+  struct InstanceView {
+    XMVECTOR planes[6];
+    XMVECTOR cameraPos;
+  };
+  InstanceView* views = FrameArena::GetThreadArena().Allocate<InstanceView>(instancesCount);
+  for (size_t i = 0; i < instancesCount; i++) {
+    XMMATRIX transposed = XMMatrixTranspose(worldMatrices[i]);
+    XMVECTOR determinant;
+    XMMATRIX inverse = XMMatrixInverse(&determinant, worldMatrices[i]);
+    for (int p = 0; p < 6; p++)
+      views[i].planes[p] = XMPlaneNormalize(XMVector4Transform(XMLoadFloat4(&planes[p]), transposed));
+    views[i].cameraPos = XMVector3TransformCoord(XMLoadFloat3(&cameraPos), inverse);
+  }
+
+  for (size_t m = 0; m < count; m++) {
+    const Meshlet& meshlet = meshlets[m];
+    XMVECTOR center = XMVectorSetW(XMLoadFloat4(&meshlet.boundingSphere), 1.0f);
+    float radius = meshlet.boundingSphere.w;
+    XMVECTOR apex = XMLoadFloat4(&meshlet.coneApex);
+    XMVECTOR axis = XMLoadFloat4(&meshlet.coneAxis);
+    float cutoff = meshlet.coneAxis.w;
+
+    bool inFrustum = false, isVisible = false;
+    for (size_t i = 0; i < instancesCount && !isVisible; i++) {
+      const InstanceView& view = views[i];
+
+      bool outside = false;
+      for (int p = 0; p < 6 && !outside; p++)
+        outside = XMVectorGetX(XMVector4Dot(view.planes[p], center)) < -radius;
+      if (outside)
+        continue;
+      inFrustum = true;
+
+      // Backfacing for every view direction inside the cone
+      XMVECTOR viewDir = XMVector3Normalize(XMVectorSubtract(apex, view.cameraPos));
+      if (cutoff < 1.0f && XMVectorGetX(XMVector3Dot(viewDir, axis)) >= cutoff)
+        continue;
+
+      isVisible = true;
+    }
+
+    if (isVisible) {
+      visible.push_back((uint32_t)m);
+      localStats.visible++;
+    } else if (inFrustum) {
+      localStats.coneCulled++;
+    } else {
+      localStats.frustumCulled++;
+    }
+  }
+
+  if (stats)
+    *stats = localStats;
+}
+
+void MeshletCuller::BuildDrawList(const Meshlet* meshlets, const std::vector<uint32_t>& visible, std::vector<MeshletDrawRange>& ranges) {
+  ranges.clear();
+  for (uint32_t m : visible) {
+    uint32_t start = meshlets[m].indexStart;
+    uint32_t count = meshlets[m].trianglesCount * 3;
+    if (!ranges.empty() && ranges.back().indexStart + ranges.back().indicesCount == start)
+      ranges.back().indicesCount += count;
+    else
+      ranges.push_back({ start, count });
+  }
+}
+
+uint32_t MeshletCuller::Compact(const Meshlet* meshlets, const std::vector<uint32_t>& visible, const void* indices, uint32_t indexSize, void* result) {
+  // Ranges are merged as in BuildDrawList while copying, so per frame call doesn't allocate
+  auto source = static_cast<const uint8_t*>(indices);
+  auto destination = static_cast<uint8_t*>(result);
+  uint32_t written = 0;
+  uint32_t rangeStart = 0, rangeCount = 0;
+  auto copyRange = [&]() {
+    memcpy(destination + (size_t)written * indexSize, source + (size_t)rangeStart * indexSize, (size_t)rangeCount * indexSize);
+    written += rangeCount;
+  };
+
+  for (uint32_t m : visible) {
+    uint32_t start = meshlets[m].indexStart;
+    uint32_t count = meshlets[m].trianglesCount * 3;
+    if (rangeCount > 0 && rangeStart + rangeCount == start) {
+      rangeCount += count;
+      continue;
+    }
+    if (rangeCount > 0)
+      copyRange();
+    rangeStart = start;
+    rangeCount = count;
+  }
+  if (rangeCount > 0)
+    copyRange();
+  return written;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Consecutive triangles of index buffer with limited count of unique vertices.
+// Meshlets index whole mesh index buffer directly, so visible ones can be drawn as index ranges
+struct Meshlet {
+  uint32_t indexStart;
+  uint32_t trianglesCount;
+  uint32_t verticesCount;
+  uint32_t reserved;
+  XMFLOAT4 boundingSphere; // xyz - center, w - radius
+  XMFLOAT4 coneApex;       // xyz - apex
+  XMFLOAT4 coneAxis;       // xyz - axis, w - cutoff (sine of cone half angle), 1 if normals are too spread to cull
+};
+
+// Index range of consecutive visible meshlets
+struct MeshletDrawRange {
+  uint32_t indexStart;
+  uint32_t indicesCount;
+};
+
+struct MeshletCullStats {
+  uint32_t frustumCulled = 0;
+  uint32_t coneCulled = 0;
+  uint32_t visible = 0;
+};
+
+// Device free, positions are read with given stride so any vertex layout can be used
+class MeshletBuilder {
+public:
+  // Triangles are taken in index buffer order, so it should be optimized for vertex cache first
+  static void Build(const XMFLOAT3* positions, size_t stride, size_t verticesCount, const uint32_t* indices, size_t indicesCount,
+    std::vector<Meshlet>& meshlets, uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+  // Bounding sphere and normal cone of triangles in meshlet range
+  static void ComputeBounds(const XMFLOAT3* positions, size_t stride, const uint32_t* indices, Meshlet& meshlet);
+};
+
+class MeshletCuller {
+public:
+  // Frustum (planes as in FrustumCulling, inside is dot >= 0) and backface cone test in world space.
+  // Meshlet is kept if it is visible for any of the instances, world matrices must be rigid with uniform scale
+  // Per instance views go to frame arena of calling thread
+  static void Cull(const Meshlet* meshlets, size_t count, const XMMATRIX* worldMatrices, size_t instancesCount,
+    const XMFLOAT4 planes[6], const XMFLOAT3& cameraPos, std::vector<uint32_t>& visible, MeshletCullStats* stats = nullptr);
+
+  // Consecutive visible meshlets are merged into one range
+  static void BuildDrawList(const Meshlet* meshlets, const std::vector<uint32_t>& visible, std::vector<MeshletDrawRange>& ranges);
+
+  // Copy indices (indexSize bytes each) of visible meshlets into result, returns indices count written
+  static uint32_t Compact(const Meshlet* meshlets, const std::vector<uint32_t>& visible, const void* indices, uint32_t indexSize, void* result);
+};
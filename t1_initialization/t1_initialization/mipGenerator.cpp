@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <DirectXPackedVector.h>
+
+#include "mipGenerator.h"
+#include "threadPool.h"
+
+using namespace DirectX::PackedVector;
+
+namespace {
+  // Rows per job, small images are not worth splitting
+  const uint32_t MIN_PIXELS_PER_JOB = 4096;
+
+  // Kaiser filter params (same defaults as NVTT)
+  const float KAISER_ALPHA = 4.0f;
+  const float KAISER_HALF_WIDTH = 1.5f; // in destination pixels
+  // 6 taps for 2:1 reduction, up to 9 for 3:1 (3 texels -> 1, the largest ratio odd sizes give)
+  const uint32_t KAISER_MAX_TAPS = 10;
+
+  uint32_t RowsPerJob(uint32_t width) {
+    return std::max<uint32_t>(1, MIN_PIXELS_PER_JOB / std::max<uint32_t>(width, 1));
+  }
+
+  // Modified Bessel function of the first kind, order 0
+  float BesselI0(float x) {
+    float sum = 1.0f, term = 1.0f;
+    float halfX = x * 0.5f;
+    for (int k = 1; k < 32; k++) {
+      term *= (halfX / k) * (halfX / k);
+      sum += term;
+      if (term < sum * 1e-7f)
+        break;
+    }
+    return sum;
+  }
+
+  float Sinc(float x) {
+    if (fabsf(x) < 1e-5f)
+      return 1.0f;
+    return sinf(XM_PI * x) / (XM_PI * x);
+  }
+
+  float KaiserWeight(float d) {
+    float t = d / KAISER_HALF_WIDTH;
+    if (fabsf(t) >= 1.0f)
+      return 0.0f;
+    return Sinc(d) * BesselI0(KAISER_ALPHA * sqrtf(1.0f - t * t)) / BesselI0(KAISER_ALPHA);
+  }
+
+  // Kaiser weights of one axis, destination pixel x takes tapsCount source texels from first[x] on.
+  // Odd size 2n+1 goes to n, so destination centers are srcSize / dstSize texels apart and the kernel
+  // is stretched by the same ratio: last texel is not dropped and the result stays symmetric.
+  // For even sizes it is the usual 6 tap kernel of exact 2:1 reduction.
+  struct KaiserAxis {
+    uint32_t tapsCount = 0;
+    std::vector<int> first;
+    std::vector<float> weights;
+
+    KaiserAxis(uint32_t srcSize, uint32_t dstSize) : first(dstSize) {
+      float scale = float(srcSize) / float(dstSize);
+      float radius = KAISER_HALF_WIDTH * scale; // in source texels
+      for (uint32_t x = 0; x < dstSize; x++) {
+        float center = (x + 0.5f) * scale;
+        first[x] = int(floorf(center - radius - 0.5f)) + 1;
+        int last = int(ceilf(center + radius - 0.5f)) - 1;
+        tapsCount = std::max<uint32_t>(tapsCount, uint32_t(last - first[x] + 1));
+      }
+      tapsCount = std::min(tapsCount, KAISER_MAX_TAPS);
+
+      weights.resize(size_t(dstSize) * tapsCount);
+      for (uint32_t x = 0; x < dstSize; x++) {
+        float center = (x + 0.5f) * scale;
+        float* w = &weights[size_t(x) * tapsCount];
+        float sum = 0.0f;
+        for (uint32_t i = 0; i < tapsCount; i++) {
+          // Distance from source texel center to destination texel center, in destination pixels
+          w[i] = KaiserWeight((first[x] + int(i) + 0.5f - center) / scale);
+          sum += w[i];
+        }
+        for (uint32_t i = 0; i < tapsCount; i++)
+          w[i] /= sum;
+      }
+    }
+  };
+
+  bool IsSRGB(DXGI_FORMAT format) {
+    return format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+  }
+}
+
+bool MipGenerator::IsFormatSupported(DXGI_FORMAT format) {
+  return BytesPerPixel(format) != 0;
+}
+
+size_t MipGenerator::BytesPerPixel(DXGI_FORMAT format) {
+  switch (format) {
+  case DXGI_FORMAT_R8G8B8A8_UNORM:
+  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+  case DXGI_FORMAT_B8G8R8A8_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    return 4;
+  case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    return 8;
+  case DXGI_FORMAT_R32G32B32A32_FLOAT:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+uint32_t MipGenerator::CountMips(uint32_t width, uint32_t height) {
+  uint32_t mipsCount = 1;
+  while (width > 1 || height > 1) {
+    width = std::max<uint32_t>(width >> 1, 1);
+    height = std::max<uint32_t>(height >> 1, 1);
+    mipsCount++;
+  }
+  return mipsCount;
+}
+
+void MipGenerator::LoadRow(const uint8_t* src, uint32_t width, DXGI_FORMAT format, bool linearize, XMFLOAT4* dst) {
+  switch (format) {
+  case DXGI_FORMAT_R8G8B8A8_UNORM:
+  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+  case DXGI_FORMAT_B8G8R8A8_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: {
+    // Channel order does not matter for filtering
+    auto pixels = reinterpret_cast<const XMUBYTEN4*>(src);
+    for (uint32_t x = 0; x < width; x++) {
+      XMVECTOR color = XMLoadUByteN4(&pixels[x]);
+      if (linearize)
+        color = XMColorSRGBToRGB(color);
+      XMStoreFloat4(&dst[x], color);
+    }
+    break;
+  }
+  case DXGI_FORMAT_R16G16B16A16_FLOAT: {
+    auto pixels = reinterpret_cast<const XMHALF4*>(src);
+    for (uint32_t x = 0; x < width; x++)
+      XMStoreFloat4(&dst[x], XMLoadHalf4(&pixels[x]));
+    break;
+  }
+  case DXGI_FORMAT_R32G32B32A32_FLOAT:
+    memcpy(dst, src, sizeof(XMFLOAT4) * width);
+    break;
+  default:
+    break;
+  }
+}
+
+void MipGenerator::StoreRow(const XMFLOAT4* src, uint32_t width, DXGI_FORMAT format, bool delinearize, uint8_t* dst) {
+  switch (format) {
+  case DXGI_FORMAT_R8G8B8A8_UNORM:
+  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+  case DXGI_FORMAT_B8G8R8A8_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: {
+    auto pixels = reinterpret_cast<XMUBYTEN4*>(dst);
+    for (uint32_t x = 0; x < width; x++) {
+      XMVECTOR color = XMVectorSaturate(XMLoadFloat4(&src[x]));
+      if (delinearize)
+        color = XMColorRGBToSRGB(color);
+      XMStoreUByteN4(&pixels[x], color);
+    }
+    break;
+  }
+  case DXGI_FORMAT_R16G16B16A16_FLOAT: {
+    auto pixels = reinterpret_cast<XMHALF4*>(dst);
+    for (uint32_t x = 0; x < width; x++)
+      XMStoreHalf4(&pixels[x], XMLoadFloat4(&src[x]));
+    break;
+  }
+  case DXGI_FORMAT_R32G32B32A32_FLOAT:
+    memcpy(dst, src, sizeof(XMFLOAT4) * width);
+    break;
+  default:
+    break;
+  }
+}
+
+void MipGenerator::DownsampleBox(const Image& src, Image& dst) {
+  ThreadPool::GetInstance().ParallelFor(dst.height, RowsPerJob(dst.width), [&](uint32_t begin, uint32_t end) {
+    for (uint32_t y = begin; y < end; y++) {
+      // Last texel of odd size takes 3 source texels, so the last source row / column is not dropped
+      uint32_t y0 = 2 * y;
+      uint32_t rowsCount = (y + 1 == dst.height) ? src.height - y0 : 2;
+      XMFLOAT4* out = &dst.pixels[size_t(y) * dst.width];
+
+      for (uint32_t x = 0; x < dst.width; x++) {
+        uint32_t x0 = 2 * x;
+        uint32_t columnsCount = (x + 1 == dst.width) ? src.width - x0 : 2;
+
+        XMVECTOR sum = XMVectorZero();
+        for (uint32_t r = 0; r < rowsCount; r++) {
+          const XMFLOAT4* row = &src.pixels[size_t(y0 + r) * src.width + x0];
+          for (uint32_t c = 0; c < columnsCount; c++)
+            sum = XMVectorAdd(sum, XMLoadFloat4(&row[c]));
+        }
+        XMStoreFloat4(&out[x], XMVectorScale(sum, 1.0f / float(rowsCount * columnsCount)));
+      }
+    }
+  });
+}
+
+void MipGenerator::DownsampleKaiser(const Image& src, Image& dst) {
+  // Edge taps are clamped, their weight goes to border texel
+  const KaiserAxis columns(src.width, dst.width);
+  const KaiserAxis rows(src.height, dst.height);
+
+  // Horizontal pass: src.width -> dst.width, keep src.height rows
+  Image tmp;
+  tmp.width = dst.width;
+  tmp.height = src.height;
+  tmp.pixels.resize(size_t(tmp.width) * tmp.height);
+
+  ThreadPool::GetInstance().ParallelFor(tmp.height, RowsPerJob(tmp.width), [&](uint32_t begin, uint32_t end) {
+    for (uint32_t y = begin; y < end; y++) {
+      const XMFLOAT4* in = &src.pixels[size_t(y) * src.width];
+      XMFLOAT4* out = &tmp.pixels[size_t(y) * tmp.width];
+
+      for (uint32_t x = 0; x < tmp.width; x++) {
+        const float* w = &columns.weights[size_t(x) * columns.tapsCount];
+        XMVECTOR sum = XMVectorZero();
+        for (uint32_t i = 0; i < columns.tapsCount; i++) {
+          int sx = std::min<int>(std::max<int>(columns.first[x] + int(i), 0), int(src.width) - 1);
+          sum = XMVectorMultiplyAdd(XMLoadFloat4(&in[sx]), XMVectorReplicate(w[i]), sum);
+        }
+        XMStoreFloat4(&out[x], sum);
+      }
+    }
+  });
+
+  // Vertical pass: tmp.height -> dst.height
+  ThreadPool::GetInstance().ParallelFor(dst.height, RowsPerJob(dst.width), [&](uint32_t begin, uint32_t end) {
+    for (uint32_t y = begin; y < end; y++) {
+      const float* w = &rows.weights[size_t(y) * rows.tapsCount];
+      const XMFLOAT4* in[KAISER_MAX_TAPS];
+      XMVECTOR weights[KAISER_MAX_TAPS];
+      for (uint32_t i = 0; i < rows.tapsCount; i++) {
+        int sy = std::min<int>(std::max<int>(rows.first[y] + int(i), 0), int(tmp.height) - 1);
+        in[i] = &tmp.pixels[size_t(sy) * tmp.width];
+        weights[i] = XMVectorReplicate(w[i]);
+      }
+      XMFLOAT4* out = &dst.pixels[size_t(y) * dst.width];
+
+      for (uint32_t x = 0; x < dst.width; x++) {
+        XMVECTOR sum = XMVectorZero();
+        for (uint32_t i = 0; i < rows.tapsCount; i++)
+          sum = XMVectorMultiplyAdd(XMLoadFloat4(&in[i][x]), weights[i], sum);
+        XMStoreFloat4(&out[x], sum);
+      }
+    }
+  });
+}
+
+bool MipGenerator::Generate(const uint8_t* srcData, uint32_t width, uint32_t height, size_t rowPitch,
+  DXGI_FORMAT format, MipFilter filter, bool gammaCorrect, uint32_t mipsCount, std::vector<MipLevel>& mips) {
+  mips.clear();
+
+  size_t bpp = BytesPerPixel(format);
+  if (!srcData || bpp == 0 || width == 0 || height == 0 || rowPitch < bpp * width)
+    return false;
+
+  uint32_t maxMips = CountMips(width, height);
+  if (mipsCount == 0 || mipsCount > maxMips)
+    mipsCount = maxMips;
+  if (mipsCount == 1)
+    return true;
+
+  // sRGB encoded data is only meaningful for 8 bit formats
+  bool linear = IsSRGB(format) || (gammaCorrect && bpp == 4);
+
+  Image cur;
+  cur.width = width;
+  cur.height = height;
+  cur.pixels.resize(size_t(width) * height);
+
+  ThreadPool::GetInstance().ParallelFor(height, RowsPerJob(width), [&](uint32_t begin, uint32_t end) {
+    for (uint32_t y = begin; y < end; y++)
+      LoadRow(srcData + rowPitch * y, width, format, linear, &cur.pixels[size_t(y) * width]);
+  });
+
+  mips.resize(mipsCount - 1);
+  for (uint32_t level = 1; level < mipsCount; level++) {
+    Image next;
+    next.width = std::max<uint32_t>(cur.width >> 1, 1);
+    next.height = std::max<uint32_t>(cur.height >> 1, 1);
+    next.pixels.resize(size_t(next.width) * next.height);
+
+    if (filter == MIP_FILTER_KAISER)
+      DownsampleKaiser(cur, next);
+    else
+      DownsampleBox(cur, next);
+
+    MipLevel& mip = mips[level - 1];
+    mip.width = next.width;
+    mip.height = next.height;
+    mip.rowPitch = bpp * next.width;
+    mip.slicePitch = mip.rowPitch * next.height;
+    mip.data.resize(mip.slicePitch);
+
+    ThreadPool::GetInstance().ParallelFor(next.height, RowsPerJob(next.width), [&](uint32_t begin, uint32_t end) {
+      for (uint32_t y = begin; y < end; y++)
+        StoreRow(&next.pixels[size_t(y) * next.width], next.width, format, linear, &mip.data[mip.rowPitch * y]);
+    });
+
+    // Next level is filtered from unquantized data
+    cur = std::move(next);
+  }
+
+  return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <directxmath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+enum MipFilter {
+  MIP_FILTER_BOX,    // 2x2 average, 3 texels wide at the end of odd sized rows / columns
+  MIP_FILTER_KAISER  // Kaiser windowed sinc, keeps more detail on minification, stretched to exact ratio of odd sizes
+};
+
+// One generated level of mip chain, rows are tightly packed
+struct MipLevel {
+  uint32_t width;
+  uint32_t height;
+  size_t rowPitch;
+  size_t slicePitch;
+  std::vector<uint8_t> data;
+};
+
+// CPU mip chain generator for uncompressed RGBA8 / RGBA16F / RGBA32F textures.
+// Device free, so it is used both by DDS loader and by offline asset tools.
+class MipGenerator {
+public:
+  static bool IsFormatSupported(DXGI_FORMAT format);
+  static size_t BytesPerPixel(DXGI_FORMAT format);
+  static uint32_t CountMips(uint32_t width, uint32_t height);
+
+  // Build levels 1..mipsCount-1 from top level data (mipsCount == 0 means full chain).
+  // sRGB formats are always filtered in linear space, gammaCorrect forces it for UNORM ones.
+  static bool Generate(const uint8_t* srcData, uint32_t width, uint32_t height, size_t rowPitch,
+    DXGI_FORMAT format, MipFilter filter, bool gammaCorrect, uint32_t mipsCount, std::vector<MipLevel>& mips);
+
+private:
+  // Working image in linear float RGBA
+  struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<XMFLOAT4> pixels;
+  };
+
+  static void DownsampleBox(const Image& src, Image& dst);
+  static void DownsampleKaiser(const Image& src, Image& dst);
+
+  static void LoadRow(const uint8_t* src, uint32_t width, DXGI_FORMAT format, bool linearize, XMFLOAT4* dst);
+  static void StoreRow(const XMFLOAT4* src, uint32_t width, DXGI_FORMAT format, bool delinearize, uint8_t* dst);
+};
@@ -0,0 +1,128 @@
+#include <cassert>
+
+#include "multiViewCuller.h"
+
+CullView CullView::FromPlanes(const XMFLOAT4 planes[6]) {
+  CullView view;
+  for (int p = 0; p < 6; p++)
+    view.planes[p] = planes[p];
+  return view;
+}
+
+CullView CullView::FromViewProjection(const XMMATRIX& viewProjection) {
+  XMFLOAT4X4 m;
+  XMStoreFloat4x4(&m, viewProjection);
+
+  // Row vectors are multiplied by matrix, so planes are sums of its columns.
+  // Order as in FrustumCulling: near, far, left, right, top, bottom
+  XMVECTOR columns[4];
+  for (int c = 0; c < 4; c++)
+    columns[c] = XMVectorSet(m.m[0][c], m.m[1][c], m.m[2][c], m.m[3][c]);
+
+  XMVECTOR planes[6] = {
+    columns[2],
+    XMVectorSubtract(columns[3], columns[2]),
+    XMVectorAdd(columns[3], columns[0]),
+    XMVectorSubtract(columns[3], columns[0]),
+    XMVectorSubtract(columns[3], columns[1]),
+    XMVectorAdd(columns[3], columns[1])
+  };
+
+  CullView view;
+  for (int p = 0; p < 6; p++)
+    XMStoreFloat4(&view.planes[p], XMPlaneNormalize(planes[p]));
+  return view;
+}
+
+void MultiViewCuller::SetViews(const CullView* views, uint32_t count) {
+  assert(count <= CULL_MAX_VIEWS);
+  viewsCount = count;
+  groups.resize((count + 3) / 4);
+
+  // Missing views of the last group get plane that has everything inside, their bits are dropped anyway
+  XMVECTOR zero = XMVectorZero();
+  for (uint32_t g = 0; g < groups.size(); g++) {
+    ViewGroup& group = groups[g];
+    for (int p = 0; p < 6; p++) {
+      XMFLOAT4 plane[4];
+      for (uint32_t v = 0; v < 4; v++)
+        plane[v] = g * 4 + v < count ? views[g * 4 + v].planes[p] : XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+      group.x[p] = XMVectorSet(plane[0].x, plane[1].x, plane[2].x, plane[3].x);
+      group.y[p] = XMVectorSet(plane[0].y, plane[1].y, plane[2].y, plane[3].y);
+      group.z[p] = XMVectorSet(plane[0].z, plane[1].z, plane[2].z, plane[3].z);
+      group.w[p] = XMVectorSet(plane[0].w, plane[1].w, plane[2].w, plane[3].w);
+      group.selectX[p] = XMVectorGreaterOrEqual(group.x[p], zero);
+      group.selectY[p] = XMVectorGreaterOrEqual(group.y[p], zero);
+      group.selectZ[p] = XMVectorGreaterOrEqual(group.z[p], zero);
+    }
+  }
+}
+
+void MultiViewCuller::Cull(const XMFLOAT4* bbMin, const XMFLOAT4* bbMax, uint32_t count, uint32_t* masks) const {
+  uint32_t viewsMask = viewsCount == 32 ? 0xFFFFFFFFu : (1u << viewsCount) - 1;
+  XMVECTOR zero = XMVectorZero();
+
+  for (uint32_t i = 0; i < count; i++) {
+    XMVECTOR minX = XMVectorReplicate(bbMin[i].x), maxX = XMVectorReplicate(bbMax[i].x);
+    XMVECTOR minY = XMVectorReplicate(bbMin[i].y), maxY = XMVectorReplicate(bbMax[i].y);
+    XMVECTOR minZ = XMVectorReplicate(bbMin[i].z), maxZ = XMVectorReplicate(bbMax[i].z);
+
+    uint32_t mask = 0;
+    for (uint32_t g = 0; g < groups.size(); g++) {
+      const ViewGroup& group = groups[g];
+
+      // Box is outside plane if its corner furthest along normal is behind it
+      XMVECTOR outside = zero;
+      for (int p = 0; p < 6; p++) {
+        XMVECTOR distance = XMVectorMultiplyAdd(XMVectorSelect(minX, maxX, group.selectX[p]), group.x[p], group.w[p]);
+        distance = XMVectorMultiplyAdd(XMVectorSelect(minY, maxY, group.selectY[p]), group.y[p], distance);
+        distance = XMVectorMultiplyAdd(XMVectorSelect(minZ, maxZ, group.selectZ[p]), group.z[p], distance);
+        outside = XMVectorOrInt(outside, XMVectorLess(distance, zero));
+      }
+
+      XMUINT4 result;
+      XMStoreUInt4(&result, outside);
+      uint32_t bits = (result.x ? 0u : 1u) | (result.y ? 0u : 2u) | (result.z ? 0u : 4u) | (result.w ? 0u : 8u);
+      mask |= bits << (g * 4);
+    }
+
+    masks[i] = mask & viewsMask;
+  }
+}
+
+void MultiViewCuller::TransformBounds(const XMFLOAT4& localMin, const XMFLOAT4& localMax, const XMMATRIX& world, XMFLOAT4& bbMin, XMFLOAT4& bbMax) {
+  XMVECTOR boxMin = XMLoadFloat4(&localMin), boxMax = XMLoadFloat4(&localMax);
+  XMVECTOR center = XMVector3TransformCoord(XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f), world);
+  XMVECTOR extents = XMVectorScale(XMVectorSubtract(boxMax, boxMin), 0.5f);
+
+  XMMATRIX absWorld;
+  absWorld.r[0] = XMVectorAbs(world.r[0]);
+  absWorld.r[1] = XMVectorAbs(world.r[1]);
+  absWorld.r[2] = XMVectorAbs(world.r[2]);
+  absWorld.r[3] = XMVectorZero();
+  extents = XMVector3TransformNormal(extents, absWorld);
+
+  XMStoreFloat4(&bbMin, XMVectorSetW(XMVectorSubtract(center, extents), 1.0f));
+  XMStoreFloat4(&bbMax, XMVectorSetW(XMVectorAdd(center, extents), 1.0f));
+}
+
+void MultiViewCuller::BuildLists(const uint32_t* masks, uint32_t count, uint32_t viewsCount, uint32_t* ids, uint32_t* offsets) {
+  // Count instances of each view, then turn counts into offsets and fill
+  for (uint32_t v = 0; v <= viewsCount; v++)
+    offsets[v] = 0;
+  for (uint32_t i = 0; i < count; i++)
+    for (uint32_t mask = masks[i], v = 0; mask; mask >>= 1, v++)
+      offsets[v + 1] += mask & 1;
+  for (uint32_t v = 0; v < viewsCount; v++)
+    offsets[v + 1] += offsets[v];
+
+  // offsets[v] walks through view v while filling and ends up at start of view v + 1
+  for (uint32_t i = 0; i < count; i++)
+    for (uint32_t mask = masks[i], v = 0; mask; mask >>= 1, v++)
+      if (mask & 1)
+        ids[offsets[v]++] = i;
+  for (uint32_t v = viewsCount; v > 0; v--)
+    offsets[v] = offsets[v - 1];
+  offsets[0] = 0;
+}
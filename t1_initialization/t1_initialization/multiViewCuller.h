@@ -0,0 +1,55 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+// Views culled in one pass, bit per view in visibility mask
+#define CULL_MAX_VIEWS 32
+
+// Six normalized planes bounding view volume, inside is dot >= 0 (as in FrustumCulling).
+// Perspective frusta and orthographic boxes (shadow cascades) look the same here
+struct CullView {
+  XMFLOAT4 planes[6];
+
+  static CullView FromPlanes(const XMFLOAT4 planes[6]);
+  // Planes of clip volume (-w <= x, y <= w, 0 <= z <= w) of any projection
+  static CullView FromViewProjection(const XMMATRIX& viewProjection);
+};
+
+// Device free culling of instance bounds against N views.
+// Planes are stored transposed, four views go in one vector, so every box is loaded once
+// and tested against all views with branchless p-vertex tests
+class MultiViewCuller {
+public:
+  void SetViews(const CullView* views, uint32_t count);
+  uint32_t GetViewsCount() const { return viewsCount; };
+
+  // masks[i] gets bit v set if box i is at least partially inside view v
+  void Cull(const XMFLOAT4* bbMin, const XMFLOAT4* bbMax, uint32_t count, uint32_t* masks) const;
+
+  // World AABB of local box under matrix: center goes through matrix, extents through its absolute
+  // value. Encloses all 8 transformed corners for any rotation, bbMin <= bbMax as Cull expects
+  static void TransformBounds(const XMFLOAT4& localMin, const XMFLOAT4& localMax, const XMMATRIX& world, XMFLOAT4& bbMin, XMFLOAT4& bbMax);
+
+  // Instances of each view one after another: view v has ids[offsets[v]] .. ids[offsets[v + 1] - 1],
+  // offsets (viewsCount + 1 entries) are ready to be start instance locations of indirect draws.
+  // ids must have room for popcount of all masks
+  static void BuildLists(const uint32_t* masks, uint32_t count, uint32_t viewsCount, uint32_t* ids, uint32_t* offsets);
+private:
+  // Plane p of four views: normal components, distance and p-vertex selectors (normal >= 0)
+  struct ViewGroup {
+    XMVECTOR x[6];
+    XMVECTOR y[6];
+    XMVECTOR z[6];
+    XMVECTOR w[6];
+    XMVECTOR selectX[6];
+    XMVECTOR selectY[6];
+    XMVECTOR selectZ[6];
+  };
+
+  std::vector<ViewGroup> groups;
+  uint32_t viewsCount = 0;
+};
@@ -0,0 +1,16 @@
+// Weighted blended OIT (McGuire, Bavoil 2013), CPU reference is OITCompositor
+
+// Depth weight, viewDepth - view space z (clip space w)
+float OITWeight(in float alpha, in float viewDepth)
+{
+  float z = abs(viewDepth);
+  float w = 10.0 / (1e-5 + pow(z / 5.0, 2.0) + pow(z / 200.0, 6.0));
+  return alpha * clamp(w, 1e-2, 3e3);
+}
+
+// Composite accumulated transparency over opaque color
+float3 OITResolve(in float4 accum, in float revealage, in float3 background)
+{
+  float3 average = accum.xyz / max(accum.w, 1e-5);
+  return average * (1.0 - revealage) + background * revealage;
+}
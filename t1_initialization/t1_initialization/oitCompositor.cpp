@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <cmath>
+
+#include "oitCompositor.h"
+
+namespace {
+  // Keeps division finite when nothing was accumulated
+  const float OIT_MIN_ACCUM_ALPHA = 1e-5f;
+}
+
+float OITCompositor::Weight(float alpha, float viewDepth) {
+  float z = std::fabs(viewDepth);
+  float w = 10.0f / (1e-5f + std::pow(z / 5.0f, 2.0f) + std::pow(z / 200.0f, 6.0f));
+  return alpha * (std::max)(1e-2f, (std::min)(3e3f, w));
+}
+
+void OITCompositor::Accumulate(OITPixel& pixel, const XMFLOAT4& color, float viewDepth) {
+  float w = Weight(color.w, viewDepth);
+  pixel.accum.x += color.x * color.w * w;
+  pixel.accum.y += color.y * color.w * w;
+  pixel.accum.z += color.z * color.w * w;
+  pixel.accum.w += color.w * w;
+  pixel.revealage *= 1.0f - color.w;
+}
+
+XMFLOAT3 OITCompositor::Resolve(const OITPixel& pixel, const XMFLOAT3& background) {
+  float norm = 1.0f / (std::max)(pixel.accum.w, OIT_MIN_ACCUM_ALPHA);
+  float coverage = 1.0f - pixel.revealage;
+  return XMFLOAT3(
+    pixel.accum.x * norm * coverage + background.x * pixel.revealage,
+    pixel.accum.y * norm * coverage + background.y * pixel.revealage,
+    pixel.accum.z * norm * coverage + background.z * pixel.revealage);
+}
+
+XMFLOAT3 OITCompositor::BlendSorted(std::vector<OITFragment> fragments, const XMFLOAT3& background) {
+  std::stable_sort(fragments.begin(), fragments.end(), [](const OITFragment& a, const OITFragment& b) {
+    return a.viewDepth > b.viewDepth;
+  });
+
+  XMFLOAT3 result = background;
+  for (auto& f : fragments) {
+    float a = f.color.w;
+    result.x = f.color.x * a + result.x * (1.0f - a);
+    result.y = f.color.y * a + result.y * (1.0f - a);
+    result.z = f.color.z * a + result.z * (1.0f - a);
+  }
+  return result;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+// Transparent fragment: straight (not premultiplied) color, w - alpha
+struct OITFragment {
+  XMFLOAT4 color;
+  float viewDepth;
+};
+
+// Contents of accumulation and revealage targets for one pixel after clear
+struct OITPixel {
+  XMFLOAT4 accum = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+  float revealage = 1.0f;
+};
+
+// CPU reference of weighted blended OIT (McGuire, Bavoil 2013).
+// Mirrors oitCalc.h, transparent_OIT_PS.hlsl blend states and composite in Postprocessing_PS.hlsl.
+class OITCompositor {
+public:
+  // Depth weight, same as OITWeight in oitCalc.h
+  static float Weight(float alpha, float viewDepth);
+
+  // One fragment through accumulation (ONE, ONE) and revealage (ZERO, INV_SRC_COLOR) blending
+  static void Accumulate(OITPixel& pixel, const XMFLOAT4& color, float viewDepth);
+
+  // Composite over opaque color
+  static XMFLOAT3 Resolve(const OITPixel& pixel, const XMFLOAT3& background);
+
+  // Exact back to front "over" blending of the same fragments, reference for the approximation
+  static XMFLOAT3 BlendSorted(std::vector<OITFragment> fragments, const XMFLOAT3& background);
+};
@@ -20,7 +20,7 @@ HRESULT Plane::CompileShaderFromFile(const WCHAR* szFileName, LPCSTR szEntryPoin
   D3DInclude includeObj;
 
   ID3DBlob* pErrorBlob = nullptr;
-  hr = D3DCompileFromFile(szFileName, nullptr, &includeObj, szEntryPoint, szShaderModel,
+  hr = CompileShaderFromAsset(szFileName, nullptr, &includeObj, szEntryPoint, szShaderModel,
     dwShaderFlags, 0, ppBlobOut, &pErrorBlob);
   if (FAILED(hr))
   {
@@ -36,8 +36,7 @@ HRESULT Plane::CompileShaderFromFile(const WCHAR* szFileName, LPCSTR szEntryPoin
   return S_OK;
 }
 
-HRESULT Plane::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, UINT cnt, const std::vector<XMFLOAT4> colors) {
-  this->colors = colors;
+HRESULT Plane::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, UINT cnt) {
 
   // Compile the vertex shader
   ID3DBlob* pVSBlob = nullptr;
@@ -60,7 +59,12 @@ HRESULT Plane::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
   // Define the input layout
   D3D11_INPUT_ELEMENT_DESC layout[] =
   {
-      {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0}
+      {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+      {"WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+      {"WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+      {"WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+      {"WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+      {"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1}
   };
   UINT numElements = ARRAYSIZE(layout);
 
@@ -134,31 +138,22 @@ HRESULT Plane::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
   if (FAILED(hr))
     return hr;
 
-  // Set constant buffers
-  D3D11_BUFFER_DESC descWMB = {};
-  descWMB.ByteWidth = sizeof(WorldMatrixBuffer);
-  descWMB.Usage = D3D11_USAGE_DEFAULT;
-  descWMB.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-  descWMB.CPUAccessFlags = 0;
-  descWMB.MiscFlags = 0;
-  descWMB.StructureByteStride = 0;
-
-  WorldMatrixBuffer worldMatrixBuffer;
-  worldMatrixBuffer.worldMatrix = DirectX::XMMatrixIdentity();
-
-  D3D11_SUBRESOURCE_DATA data;
-  data.pSysMem = &worldMatrixBuffer;
-  data.SysMemPitch = sizeof(worldMatrixBuffer);
-  data.SysMemSlicePitch = 0;
-
-  g_pWorldMatrixBuffers = std::vector<ID3D11Buffer*>(cnt, nullptr);
-  renderOrder = std::vector<UINT>(cnt, 0);
-  for (UINT i = 0; i < cnt; i++) {
-    hr = device->CreateBuffer(&descWMB, &data, &g_pWorldMatrixBuffers[i]);
-    if (FAILED(hr))
-      return hr;
-  }
-  
+  // Create instance buffer, rewritten every frame in render order
+  instancesCapacity = (std::max)(cnt, 1u);
+  instancesCount = 0;
+
+  D3D11_BUFFER_DESC descIB = {};
+  descIB.ByteWidth = sizeof(PlaneInstance) * instancesCapacity;
+  descIB.Usage = D3D11_USAGE_DYNAMIC;
+  descIB.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+  descIB.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+  descIB.MiscFlags = 0;
+  descIB.StructureByteStride = 0;
+
+  hr = device->CreateBuffer(&descIB, nullptr, &g_pInstanceBuffer);
+  if (FAILED(hr))
+    return hr;
+
   D3D11_BUFFER_DESC descSMB = {};
   descSMB.ByteWidth = sizeof(SceneMatrixBuffer);
   descSMB.Usage = D3D11_USAGE_DYNAMIC;
@@ -228,18 +223,66 @@ HRESULT Plane::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
   descBS.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ZERO;
 
   hr = device->CreateBlendState(&descBS, &g_pTransBlendState);
+  if (FAILED(hr))
+    return hr;
+
+  // Compile OIT pixel shader
+  hr = CompileShaderFromFile(L"transparent_OIT_PS.hlsl", "main", "ps_5_0", &pPSBlob);
+  if (FAILED(hr))
+  {
+    MessageBox(nullptr,
+      L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
+    return hr;
+  }
+
+  hr = device->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, &g_pOITPixelShader);
+  pPSBlob->Release();
+  if (FAILED(hr))
+    return hr;
+
+  // OIT depth state: test against opaque depth, keep it unchanged
+  dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+
+  hr = device->CreateDepthStencilState(&dsDesc, &g_pOITDepthState);
+  if (FAILED(hr))
+    return hr;
+
+  // OIT blend state: accumulation sums weighted colors, revealage multiplies by (1 - alpha)
+  D3D11_BLEND_DESC descOIT = { 0 };
+  descOIT.AlphaToCoverageEnable = false;
+  descOIT.IndependentBlendEnable = true;
+  descOIT.RenderTarget[0].BlendEnable = true;
+  descOIT.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+  descOIT.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+  descOIT.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+  descOIT.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+  descOIT.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+  descOIT.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
+  descOIT.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+  descOIT.RenderTarget[1].BlendEnable = true;
+  descOIT.RenderTarget[1].BlendOp = D3D11_BLEND_OP_ADD;
+  descOIT.RenderTarget[1].SrcBlend = D3D11_BLEND_ZERO;
+  descOIT.RenderTarget[1].DestBlend = D3D11_BLEND_INV_SRC_COLOR;
+  descOIT.RenderTarget[1].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+  descOIT.RenderTarget[1].SrcBlendAlpha = D3D11_BLEND_ZERO;
+  descOIT.RenderTarget[1].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+  descOIT.RenderTarget[1].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_RED;
+
+  hr = device->CreateBlendState(&descOIT, &g_pOITBlendState);
+  if (FAILED(hr))
+    return hr;
 
   return S_OK;
 }
 
 void Plane::Realese() {
+  if (g_pOITBlendState) g_pOITBlendState->Release();
+  if (g_pOITDepthState) g_pOITDepthState->Release();
+  if (g_pOITPixelShader) g_pOITPixelShader->Release();
   if (g_pTransBlendState) g_pTransBlendState->Release();
   if (g_pRasterizerState) g_pRasterizerState->Release();
 
-  for (auto& buffer : g_pWorldMatrixBuffers)
-    if (buffer)
-      buffer->Release();
-
+  if (g_pInstanceBuffer) g_pInstanceBuffer->Release();
   if (g_LightConstantBuffer) g_LightConstantBuffer->Release();
   if (g_pDepthState) g_pDepthState->Release();
   if (g_pSceneMatrixBuffer) g_pSceneMatrixBuffer->Release();
@@ -251,71 +294,50 @@ void Plane::Realese() {
 }
 
 void Plane::Render(ID3D11DeviceContext* context) {
-  context->OMSetDepthStencilState(g_pDepthState, 0);
+  if (instancesCount == 0)
+    return;
+
+  context->OMSetDepthStencilState(oit ? g_pOITDepthState : g_pDepthState, 0);
   context->RSSetState(g_pRasterizerState);
 
   context->IASetIndexBuffer(g_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-  ID3D11Buffer* vertexBuffers[] = { g_pVertexBuffer };
-  UINT stride = sizeof(XMFLOAT4);
-  UINT offset = 0;
-  context->IASetVertexBuffers(0, 1, vertexBuffers, &stride, &offset);
+  ID3D11Buffer* vertexBuffers[] = { g_pVertexBuffer, g_pInstanceBuffer };
+  UINT strides[] = { sizeof(XMFLOAT4), sizeof(PlaneInstance) };
+  UINT offsets[] = { 0, 0 };
+  context->IASetVertexBuffers(0, 2, vertexBuffers, strides, offsets);
 
   context->IASetInputLayout(g_pVertexLayout);
   context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
   context->VSSetShader(g_pVertexShader, nullptr, 0);
   context->VSSetConstantBuffers(1, 1, &g_pSceneMatrixBuffer);
-  context->PSSetShader(g_pPixelShader, nullptr, 0);
-  context->OMSetBlendState(g_pTransBlendState, nullptr, 0xFFFFFFFF);
-
-  for (auto& i : renderOrder) {
-    context->VSSetConstantBuffers(0, 1, &g_pWorldMatrixBuffers[i]);
-    context->PSSetConstantBuffers(0, 1, &g_pWorldMatrixBuffers[i]);
+  context->PSSetShader(oit ? g_pOITPixelShader : g_pPixelShader, nullptr, 0);
+  context->OMSetBlendState(oit ? g_pOITBlendState : g_pTransBlendState, nullptr, 0xFFFFFFFF);
 
-    context->DrawIndexed(6, 0, 0);
-  }
+  // Instances are already sorted back to front (or blended order independently), so one draw is enough
+  context->DrawIndexedInstanced(6, instancesCount, 0, 0, 0);
 }
 
 
-float Plane::DistToPlane(XMMATRIX worldMatrix, XMFLOAT3 cameraPos) {
-  XMFLOAT4 rectVert[4];
-  float maxDist = -D3D11_FLOAT32_MAX;
-
-  std::copy(Vertices, Vertices + 4, rectVert);
-  for (int i = 0; i < 4; i++) {
-    XMStoreFloat4(&rectVert[i], XMVector4Transform(XMLoadFloat4(&rectVert[i]), worldMatrix));
-    float dist = (rectVert[i].x * cameraPos.x) + (rectVert[i].y * cameraPos.y) + (rectVert[i].z * cameraPos.z);
-    maxDist = max(maxDist, dist);
-  }
+bool Plane::Frame(ID3D11DeviceContext* context, World& world, const CameraState& camera, const Light& lights) {
+  const XMFLOAT3& cameraPos = camera.GetPosition();
 
-  return maxDist;
-}
+  D3D11_MAPPED_SUBRESOURCE subresource;
+  HRESULT hr;
 
-bool Plane::Frame(ID3D11DeviceContext* context, const std::vector<XMMATRIX>& worldMatricies, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos, const Light& lights) {
-  // Update world matricies
-  WorldMatrixBuffer worldMatrixBuffer;
+  // Instances go in render order, the whole set in one upload
+  UINT count = PlaneBatch::Count(world, instancesCapacity);
+  instancesCount = 0;
+  if (count > 0) {
+    hr = context->Map(g_pInstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
+    if (FAILED(hr))
+      return FAILED(hr);
 
-  for (int i = 0; i < worldMatricies.size() && i < g_pWorldMatrixBuffers.size(); i++) {
-    worldMatrixBuffer.worldMatrix = worldMatricies[i];
-    worldMatrixBuffer.color = colors[i];
-    context->UpdateSubresource(g_pWorldMatrixBuffers[i], 0, nullptr, &worldMatrixBuffer, 0, 0);
+    instancesCount = batch.Write(world, camera.GetView(), !oit, instancesCapacity, reinterpret_cast<PlaneInstance*>(subresource.pData));
+    context->Unmap(g_pInstanceBuffer, 0);
   }
-  // Count distances from cam to each plane and sort from furthest to nearest
-  std::vector<std::pair<float, UINT>> dists_indxs = std::vector<std::pair<float, UINT>>(worldMatricies.size());
-  for (UINT i = 0; i < worldMatricies.size(); i++)
-    dists_indxs[i] = std::pair<float, UINT>(DistToPlane(worldMatricies[i], cameraPos), i);
-  std::sort(dists_indxs.begin(), dists_indxs.end(), [](std::pair<float, UINT> a, std::pair<float, UINT> b)
-    {
-      return a.first < b.first;
-    }
-  );
-  for (UINT i = 0; i < worldMatricies.size(); i++)
-    renderOrder[i] = dists_indxs[i].second;
-
 
-  // Get the view matrix
-  D3D11_MAPPED_SUBRESOURCE subresource;
   // Update Light buffer
-  HRESULT hr = context->Map(g_LightConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
+  hr = context->Map(g_LightConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
   if (FAILED(hr))
     return FAILED(hr);
 
@@ -332,13 +354,16 @@ bool Plane::Frame(ID3D11DeviceContext* context, const std::vector<XMMATRIX>& wor
   }
   context->Unmap(g_LightConstantBuffer, 0);
 
-  // Get the view matrix
-  hr = context->Map(g_pSceneMatrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
-  if (FAILED(hr))
-    return FAILED(hr);
-  SceneMatrixBuffer& sceneBuffer = *reinterpret_cast<SceneMatrixBuffer*>(subresource.pData);
-  sceneBuffer.viewProjectionMatrix = XMMatrixMultiply(viewMatrix, projectionMatrix);
-  context->Unmap(g_pSceneMatrixBuffer, 0);
+  // Scene buffer is kept while camera stands still, planes move but sort above handles it
+  if (sceneVersion != camera.GetVersion()) {
+    hr = context->Map(g_pSceneMatrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
+    if (FAILED(hr))
+      return FAILED(hr);
+    SceneMatrixBuffer& sceneBuffer = *reinterpret_cast<SceneMatrixBuffer*>(subresource.pData);
+    sceneBuffer.viewProjectionMatrix = camera.GetViewProjection();
+    context->Unmap(g_pSceneMatrixBuffer, 0);
+    sceneVersion = camera.GetVersion();
+  }
 
   return S_OK;
 }
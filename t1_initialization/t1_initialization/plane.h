@@ -10,6 +10,8 @@
 #include "def.h"
 #include "Light.h"
 #include "D3DInclude.h"
+#include "planeBatch.h"
+#include "cameraState.h"
 
 using namespace DirectX;
 
@@ -22,20 +24,24 @@ static const XMFLOAT4 Vertices[] = {
 
 class Plane {
 public:
-  HRESULT Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, UINT cnt, const std::vector<XMFLOAT4> colors);
+  // cnt - max number of planes drawn per frame, all of them go in one instanced draw.
+  // Planes are World entities with Transform and Color components
+  HRESULT Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight, UINT cnt);
 
   void Realese();
 
   void Resize(int screenWidth, int screenHeight) {};
 
+  // Sorted mode blends into bound target, OIT mode expects accumulation and revealage targets bound
   void Render(ID3D11DeviceContext* context);
 
-  bool Frame(ID3D11DeviceContext* context, const std::vector<XMMATRIX>& worldMatricies, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos, const Light& lights);
+  // Weighted blended OIT: no CPU sort, depth is tested but not written
+  void SetOIT(bool enabled) { oit = enabled; };
+
+  bool Frame(ID3D11DeviceContext* context, World& world, const CameraState& camera, const Light& lights);
 private:
   HRESULT CompileShaderFromFile(const WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut);
 
-  float DistToPlane(XMMATRIX worldMatrix, XMFLOAT3 cameraPos);
-
   // dx11 vars
   ID3D11VertexShader* g_pVertexShader = nullptr;
   ID3D11PixelShader* g_pPixelShader = nullptr;
@@ -49,8 +55,19 @@ private:
   ID3D11DepthStencilState* g_pDepthState = nullptr;
   ID3D11BlendState* g_pTransBlendState = nullptr;
 
-  std::vector<ID3D11Buffer*> g_pWorldMatrixBuffers = std::vector<ID3D11Buffer*>(1, nullptr);
-  std::vector<UINT> renderOrder;
+  // OIT pass
+  ID3D11PixelShader* g_pOITPixelShader = nullptr;
+  ID3D11DepthStencilState* g_pOITDepthState = nullptr;
+  ID3D11BlendState* g_pOITBlendState = nullptr;
+  bool oit = false;
+
+  // Per instance world matrix and color, written back to front every frame
+  ID3D11Buffer* g_pInstanceBuffer = nullptr;
+  UINT instancesCapacity = 0;
+  UINT instancesCount = 0;
+
+  PlaneBatch batch;
 
-  std::vector<XMFLOAT4> colors;
+  // Camera version scene buffer was written for
+  uint32_t sceneVersion = 0;
 };
@@ -0,0 +1,41 @@
+#include <algorithm>
+
+#include "planeBatch.h"
+#include "frameArena.h"
+
+uint32_t PlaneBatch::Count(const World& world, uint32_t capacity) {
+  return (std::min)(world.Count<TransformComponent, ColorComponent>(), capacity);
+}
+
+uint32_t PlaneBatch::Write(World& world, const XMMATRIX& viewMatrix, bool sorted, uint32_t capacity, PlaneInstance* instances) {
+  // Transparent entities: transform and color, kept till frame end
+  FrameVector<XMMATRIX> worldMatricies;
+  FrameVector<XMFLOAT4> colors;
+  uint32_t entitiesCount = world.Count<TransformComponent, ColorComponent>();
+  worldMatricies.reserve(entitiesCount);
+  colors.reserve(entitiesCount);
+  world.ForEachChunk<TransformComponent, ColorComponent>([&](uint32_t count, const Entity*, TransformComponent* transforms, ColorComponent* planeColors) {
+    for (uint32_t i = 0; i < count; i++) {
+      worldMatricies.push_back(XMLoadFloat4x4(&transforms[i].world));
+      colors.push_back(planeColors[i].color);
+    }
+  });
+
+  uint32_t count = (std::min)((uint32_t)worldMatricies.size(), capacity);
+
+  // Sort by view space depth of plane centers from furthest to nearest, OIT does not need any order
+  if (sorted)
+    sorter.SortBackToFront(worldMatricies.data(), count, viewMatrix, renderOrder);
+  else {
+    renderOrder.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+      renderOrder[i] = i;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t idx = renderOrder[i];
+    XMStoreFloat4x4(&instances[i].worldMatrix, worldMatricies[idx]);
+    instances[i].color = colors[idx];
+  }
+  return count;
+}
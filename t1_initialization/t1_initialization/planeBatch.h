@@ -0,0 +1,30 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <vector>
+
+#include "def.h"
+#include "depthSorter.h"
+#include "ecs.h"
+#include "components.h"
+
+using namespace DirectX;
+
+// Device free part of transparent planes frame: World planes (Transform and Color components)
+// are ordered and written as instance data, so submission is one upload and one instanced draw
+class PlaneBatch {
+public:
+  // Number of instances Write produces
+  static uint32_t Count(const World& world, uint32_t capacity);
+
+  // Writes Count(world, capacity) instances, back to front by view space depth of plane centers,
+  // or in entity order if not sorted (OIT). Destination is usually mapped instance buffer
+  uint32_t Write(World& world, const XMMATRIX& viewMatrix, bool sorted, uint32_t capacity, PlaneInstance* instances);
+
+  // Entity (query order) index of every written instance
+  const std::vector<uint32_t>& GetRenderOrder() const { return renderOrder; };
+private:
+  DepthSorter sorter;
+  std::vector<uint32_t> renderOrder;
+};
@@ -11,13 +11,14 @@ HRESULT Postprocessing::Init(ID3D11Device* device, HWND hwnd) {
   flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
   // Compile the vertex shader code.
-  hr = D3DCompileFromFile(L"Postprocessing_VS.hlsl", NULL, NULL, "main", "vs_5_0", flags, 0, &vertexShaderBuffer, NULL);
+  hr = CompileShaderFromAsset(L"Postprocessing_VS.hlsl", NULL, NULL, "main", "vs_5_0", flags, 0, &vertexShaderBuffer, NULL);
   hr = device->CreateVertexShader(vertexShaderBuffer->GetBufferPointer(), vertexShaderBuffer->GetBufferSize(), NULL, &g_pVertexShader);
   if (FAILED(hr))
     return hr;
 
-  // Compile the pixel shader code.
-  hr = D3DCompileFromFile(L"Postprocessing_PS.hlsl", NULL, NULL, "main", "ps_5_0", flags, 0, &pixelShaderBuffer, NULL);
+  // Compile the pixel shader code (it includes OIT composite).
+  D3DInclude includeObj;
+  hr = CompileShaderFromAsset(L"Postprocessing_PS.hlsl", NULL, &includeObj, "main", "ps_5_0", flags, 0, &pixelShaderBuffer, NULL);
   hr = device->CreatePixelShader(pixelShaderBuffer->GetBufferPointer(), pixelShaderBuffer->GetBufferSize(), NULL, &g_pPixelShader);
   if (FAILED(hr))
     return hr;
@@ -54,6 +55,7 @@ HRESULT Postprocessing::Init(ID3D11Device* device, HWND hwnd) {
 
   PostprocessingCB postCB;
   postCB.params = XMFLOAT4(0, 0, 0, 0);
+  postCB.oit = XMFLOAT4(0, 0, 0, 0);
 
   D3D11_SUBRESOURCE_DATA data;
   data.pSysMem = &postCB;
@@ -73,7 +75,8 @@ void Postprocessing::Release() {
 }
 
 
-void Postprocessing::Render(ID3D11DeviceContext* context, ID3D11ShaderResourceView* sourceTexture, ID3D11RenderTargetView* renderTarget, D3D11_VIEWPORT viewport) {
+void Postprocessing::Render(ID3D11DeviceContext* context, ID3D11ShaderResourceView* sourceTexture, ID3D11RenderTargetView* renderTarget, D3D11_VIEWPORT viewport,
+  ID3D11ShaderResourceView* oitAccum, ID3D11ShaderResourceView* oitRevealage) {
   context->OMSetRenderTargets(1, &renderTarget, nullptr);
   context->RSSetViewports(1, &viewport);
 
@@ -83,13 +86,14 @@ void Postprocessing::Render(ID3D11DeviceContext* context, ID3D11ShaderResourceVi
   context->VSSetShader(g_pVertexShader, nullptr, 0);
   context->PSSetShader(g_pPixelShader, nullptr, 0);
   context->PSSetConstantBuffers(0, 1, &g_pPostprocessingCB);
-  context->PSSetShaderResources(0, 1, &sourceTexture);
+  ID3D11ShaderResourceView* sources[] = { sourceTexture, oitAccum, oitRevealage };
+  context->PSSetShaderResources(0, 3, sources);
   context->PSSetSamplers(0, 1, &g_pSamplerState);
 
   context->Draw(3, 0);
 
-  ID3D11ShaderResourceView* nullsrv[] = { nullptr };
-  context->PSSetShaderResources(0, 1, nullsrv);
+  ID3D11ShaderResourceView* nullsrv[] = { nullptr, nullptr, nullptr };
+  context->PSSetShaderResources(0, 3, nullsrv);
 }
 
 bool Postprocessing::Frame(ID3D11DeviceContext* context) {
@@ -104,6 +108,7 @@ bool Postprocessing::Frame(ID3D11DeviceContext* context) {
     alpha,
     beta,
     gamma, 1.f);
+  postCB.oit = XMFLOAT4(oit ? 1.f : 0.f, 0, 0, 0);
 
   context->UpdateSubresource(g_pPostprocessingCB, 0, nullptr, &postCB, 0, 0);
   return true;
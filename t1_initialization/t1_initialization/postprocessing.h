@@ -5,11 +5,13 @@
 #include <directxmath.h>
 
 #include "timer.h"
+#include "D3DInclude.h"
 
 using namespace DirectX;
 
 struct PostprocessingCB {
   XMFLOAT4 params; // x, y, z - parts of each color channel
+  XMFLOAT4 oit; // x - 1 if OIT accumulation and revealage are composited
 };
 
 class Postprocessing {
@@ -21,7 +23,11 @@ public:
   void Release();
   
   // Render function
-  void Render(ID3D11DeviceContext* context, ID3D11ShaderResourceView* sourceTexture, ID3D11RenderTargetView* renderTarget, D3D11_VIEWPORT viewport);
+  // OIT textures are used only when SetOIT(true) was called
+  void Render(ID3D11DeviceContext* context, ID3D11ShaderResourceView* sourceTexture, ID3D11RenderTargetView* renderTarget, D3D11_VIEWPORT viewport,
+    ID3D11ShaderResourceView* oitAccum = nullptr, ID3D11ShaderResourceView* oitRevealage = nullptr);
+
+  void SetOIT(bool enabled) { oit = enabled; };
 
   // Params updating
   bool Frame(ID3D11DeviceContext* context);
@@ -32,4 +38,6 @@ private:
   ID3D11PixelShader* g_pPixelShader = nullptr;
   ID3D11SamplerState* g_pSamplerState = nullptr;
   ID3D11Buffer* g_pPostprocessingCB = nullptr;
+
+  bool oit = false;
 };
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "renderTexture.h"
 
 // Function to initialize render texture class
-HRESULT RenderTexture::Init(ID3D11Device* device, int screenWidth, int screenHeight) {
+HRESULT RenderTexture::Init(ID3D11Device* device, int screenWidth, int screenHeight, DXGI_FORMAT format) {
+  this->format = format;
+
   // Initialize the render target texture description.
   D3D11_TEXTURE2D_DESC textureDesc;
   ZeroMemory(&textureDesc, sizeof(textureDesc));
@@ -11,7 +13,7 @@ HRESULT RenderTexture::Init(ID3D11Device* device, int screenWidth, int screenHei
   textureDesc.Height = screenHeight;
   textureDesc.MipLevels = 1;
   textureDesc.ArraySize = 1;
-  textureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+  textureDesc.Format = format;
   textureDesc.SampleDesc.Count = 1;
   textureDesc.Usage = D3D11_USAGE_DEFAULT;
   textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
@@ -67,7 +69,7 @@ void RenderTexture::Release() {
 
 void RenderTexture::Resize(ID3D11Device* device, int width, int height) {
   Release();
-  Init(device, width, height);
+  Init(device, width, height, format);
 }
 
 // Function to clear render target
@@ -4,7 +4,7 @@
 
 class RenderTexture {
 public:
-  HRESULT Init(ID3D11Device* device, int screenWidth, int screenHeight);
+  HRESULT Init(ID3D11Device* device, int screenWidth, int screenHeight, DXGI_FORMAT format = DXGI_FORMAT_R32G32B32A32_FLOAT);
   
   void Release();
   
@@ -25,4 +25,5 @@ private:
   ID3D11RenderTargetView* g_pRenderTargetView = nullptr;
   ID3D11ShaderResourceView* g_pShaderResourceView = nullptr;
   D3D11_VIEWPORT g_viewport;
+  DXGI_FORMAT format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 };
\ No newline at end of file
@@ -152,7 +152,14 @@ HRESULT Renderer::InitDevice(const HWND& g_hWnd) {
     return hr;
 
   // init skybox and scene
-  sc.Init(g_pd3dDevice, g_pImmediateContext, width, height);
+  hr = sc.Init(g_pd3dDevice, g_pImmediateContext, width, height);
+  if (FAILED(hr))
+    return hr;
+
+  // Start from first camera of scene description
+  XMFLOAT4 target, angles;
+  if (sc.GetCamera(0, target, angles))
+    camera.SetOrbit(XMFLOAT3(target.x, target.y, target.z), target.w, angles.x, angles.y);
 
   return S_OK;
 }
@@ -198,6 +205,9 @@ HRESULT Renderer::InitBackBuffer() {
 HRESULT Renderer::Init(const HWND& g_hWnd, const HINSTANCE& g_hInstance, UINT screenWidth, UINT screenHeight) {
   hWnd = &g_hWnd;
 
+  // Packed assets are optional, loose files are used without archive
+  AssetArchive::GetInstance().Open(ARCHIVE_DEFAULT_PATH);
+
   HRESULT hr = input.InitInputs(g_hInstance, g_hWnd, screenWidth, screenHeight);
   if (FAILED(hr))
     return hr;
@@ -214,6 +224,14 @@ HRESULT Renderer::Init(const HWND& g_hWnd, const HINSTANCE& g_hInstance, UINT sc
   if (FAILED(hr))
     return hr;
 
+  hr = oitAccum.Init(g_pd3dDevice, screenWidth, screenHeight, DXGI_FORMAT_R16G16B16A16_FLOAT);
+  if (FAILED(hr))
+    return hr;
+
+  hr = oitRevealage.Init(g_pd3dDevice, screenWidth, screenHeight, DXGI_FORMAT_R16_FLOAT);
+  if (FAILED(hr))
+    return hr;
+
   hr = postprocessing.Init(g_pd3dDevice, g_hWnd);
   if (FAILED(hr))
     return hr;
@@ -221,49 +239,78 @@ HRESULT Renderer::Init(const HWND& g_hWnd, const HINSTANCE& g_hInstance, UINT sc
   return S_OK;
 }
 
-void Renderer::HandleInput() {
+void Renderer::HandleInput(const InputState& state) {
   // handle camera rotations
-  XMFLOAT3 mouseMove = input.IsMouseUsed();
-  camera.Move(mouseMove.x, mouseMove.y, mouseMove.z);
+  camera.Move(state.mouseMove.x, state.mouseMove.y, state.mouseMove.z);
 
-  // handle world matrix rotation
-  //float sign = input.IsPlusMinusPressed();
-  //angle_velocity += sign * 0.0001f;
-  //angle_velocity = min(max(angle_velocity, 0.f), 30.f);
+  // switch transparency between CPU sorted blending and OIT
+  if (state.IsKeyDown(DIK_O) && !prevInputState.IsKeyDown(DIK_O)) {
+    oitEnabled = !oitEnabled;
+    sc.SetOIT(oitEnabled);
+    postprocessing.SetOIT(oitEnabled);
+  }
+
+  // switch culling between fixed plane order and last rejecting plane first
+  if (state.IsKeyDown(DIK_C) && !prevInputState.IsKeyDown(DIK_C)) {
+    cullCoherence = !cullCoherence;
+    sc.SetCullCoherence(cullCoherence);
+  }
 }
 
 // Update frame method
 bool Renderer::Frame() {
-  std::string name = "Culled (GPU): " + std::to_string(sc.GetName());
-  auto winName = LPCSTR(name.c_str());
-  SetWindowTextA(*hWnd, winName);
+  // Title is formatted on stack, frame doesn't touch heap in steady state
+  const AllocTracker& allocs = AllocTracker::GetInstance();
+  char name[160];
+  snprintf(name, sizeof(name), "Culled (GPU): %d%s%s | Pick: %d | Allocs: %llu (%llu B), peak %llu",
+    sc.GetName(), oitEnabled ? " | OIT" : " | Sorted", cullCoherence ? " | Coherent" : "", pickedBox, (unsigned long long)allocs.GetLastFrameStats().count,
+    (unsigned long long)allocs.GetLastFrameStats().bytes, (unsigned long long)allocs.GetPeakFrameStats().count);
+  SetWindowTextA(*hWnd, name);
 
   postprocessing.Frame(g_pImmediateContext);
 
-  // update inputs
+  // update inputs, benchmark may replace them with recorded ones or place camera on its path
   input.Frame();
-  
+  InputState inputState;
+  input.GetState(inputState);
+  CameraPathKey pose;
+  if (benchmark.Frame(inputState, pose))
+    camera.SetOrbit(pose.target, pose.distance, pose.phi, pose.theta);
+
   // update camera
-  HandleInput();
+  HandleInput(inputState);
+  prevInputState = inputState;
+  if (benchmark.GetMode() == BENCHMARK_RECORD) {
+    camera.GetOrbit(pose.target, pose.distance, pose.phi, pose.theta);
+    benchmark.RecordCamera(pose);
+  }
   camera.Frame();
 
   // Get the view matrix
   XMMATRIX mView;
   camera.GetBaseViewMatrix(mView);
-  // Get the projection matrix
-  XMMATRIX mProjection = XMMatrixPerspectiveFovLH(XM_PIDIV2, (FLOAT)input.GetWidth() / (FLOAT)input.GetHeight(), 100.0f, 0.01f);
-  
-  // Get the view matrix
-  HRESULT hr = sc.Frame(g_pImmediateContext, mView, mProjection, camera.GetPos());
+  // Derived matrices and frustum are rebuilt only if view or projection changed
+  cameraState.SetView(mView, camera.GetPos());
+  cameraState.SetPerspective(XM_PIDIV2, (FLOAT)input.GetWidth() / (FLOAT)input.GetHeight(), 100.0f, 0.01f);
+
+  HRESULT hr = sc.Frame(g_pImmediateContext, cameraState);
   if (FAILED(hr))
     return SUCCEEDED(hr);
 
+  // Box camera looks at
+  QueryHit hit;
+  sc.Pick(Scene::GetScreenRay(cameraState, 0.0f, 0.0f), hit);
+  pickedBox = hit.instance;
+
   return SUCCEEDED(hr);
 }
 
 void Renderer::Render() {
   g_pImmediateContext->ClearState();
 
+  // Shadow maps set their own targets and viewports
+  sc.RenderShadows(g_pImmediateContext);
+
   D3D11_VIEWPORT viewport;
   viewport.TopLeftX = 0;
   viewport.TopLeftY = 0;
@@ -286,6 +333,19 @@ void Renderer::Render() {
 
   sc.Render(g_pImmediateContext);
 
+  // Transparent planes into accumulation and revealage, depth from opaque pass is only tested
+  if (oitEnabled) {
+    static const FLOAT AccumClear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    static const FLOAT RevealageClear[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    g_pImmediateContext->ClearRenderTargetView(oitAccum.GetRenderTargetView(), AccumClear);
+    g_pImmediateContext->ClearRenderTargetView(oitRevealage.GetRenderTargetView(), RevealageClear);
+
+    ID3D11RenderTargetView* oitViews[] = { oitAccum.GetRenderTargetView(), oitRevealage.GetRenderTargetView() };
+    g_pImmediateContext->OMSetRenderTargets(2, oitViews, g_pDepthBufferDSV);
+
+    sc.RenderTransparent(g_pImmediateContext);
+  }
+
   ID3D11RenderTargetView* views[] = { g_pRenderTargetView };
   g_pImmediateContext->OMSetRenderTargets(1, views, g_pDepthBufferDSV);
 
@@ -296,9 +356,15 @@ void Renderer::Render() {
   // Render texture to screen
   postprocessing.Render(g_pImmediateContext, 
     renderTexture.GetShaderResourceView(),
-    g_pRenderTargetView, viewport);
+    g_pRenderTargetView, viewport,
+    oitAccum.GetShaderResourceView(), oitRevealage.GetShaderResourceView());
 
   g_pSwapChain->Present(0, 0);
+
+  // Frame data of all threads is released at once
+  FrameArena::ResetAll();
+
+  AllocTracker::GetInstance().EndFrame();
 }
 
 void Renderer::CleanupDevice() {
@@ -306,7 +372,10 @@ void Renderer::CleanupDevice() {
   input.Realese();
   sc.Realese();
   renderTexture.Release();
+  oitAccum.Release();
+  oitRevealage.Release();
   postprocessing.Release();
+  AssetArchive::GetInstance().Close();
 
   if (g_pImmediateContext) g_pImmediateContext->ClearState();
 
@@ -341,6 +410,8 @@ void Renderer::ResizeWindow(const HWND& g_hWnd) {
       input.Resize(width, height);
       sc.Resize(width, height);
       renderTexture.Resize(g_pd3dDevice, width, height);
+      oitAccum.Resize(g_pd3dDevice, width, height);
+      oitRevealage.Resize(g_pd3dDevice, width, height);
     }
   }
 }
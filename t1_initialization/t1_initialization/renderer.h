@@ -4,13 +4,19 @@
 #include <d3dcompiler.h>
 #include <directxmath.h>
 #include <directxcolors.h>
+#include <cstdio>
 #include <directxmath.h>
 
 #include "renderTexture.h"
 #include "postprocessing.h"
 #include "camera.h"
+#include "cameraState.h"
 #include "input.h"
 #include "scene.h"
+#include "assetArchive.h"
+#include "frameArena.h"
+#include "allocTracker.h"
+#include "benchmark.h"
 
 
 // Make renderer class
@@ -36,12 +42,18 @@ public:
   // Window resize method
   void ResizeWindow(const HWND& g_hWnd);
 
+  // Scene simulation steps once per frame, for reproducible runs
+  void SetReplay(bool enabled) { sc.SetReplay(enabled); };
+
+  // Input recording, playback and camera path runs
+  Benchmark& GetBenchmark() { return benchmark; };
+
 private:
   // Initialization device method
   HRESULT InitDevice(const HWND& g_hWnd);
   HRESULT InitBackBuffer();
 
-  void HandleInput();
+  void HandleInput(const InputState& state);
 
 
   // Private constructor (for singleton)
@@ -67,8 +79,22 @@ private:
   RenderTexture renderTexture;
   Postprocessing postprocessing;
 
+  // weighted blended OIT targets, toggled with O key
+  RenderTexture oitAccum;
+  RenderTexture oitRevealage;
+  bool oitEnabled = false;
+  // culling tests last rejecting plane first, toggled with C key
+  bool cullCoherence = true;
+  // Box under screen center, -1 - none
+  int pickedBox = -1;
+
   // initialization other thinngs (camera, input devices, etc.)
   Camera camera;
+  // View and projection of current frame with derived data, shared by scene systems
+  CameraState cameraState;
   Input input;
+  // Input of previous frame, for key presses
+  InputState prevInputState;
+  Benchmark benchmark;
   Scene sc;
 };
\ No newline at end of file
@@ -1,26 +1,102 @@
 #include "scene.h"
+#include "sceneCompiler.h"
+
+namespace {
+  HRESULT ReadDescriptionFile(const wchar_t* path, std::vector<uint8_t>& data) {
+    AssetData asset;
+    if (SUCCEEDED(AssetArchive::GetInstance().Load(path, asset))) {
+      data.assign(asset.data, asset.data + asset.size);
+      return S_OK;
+    }
+
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return HRESULT_FROM_WIN32(GetLastError());
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart > 0x7FFFFFFF) {
+      CloseHandle(file);
+      return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+    }
+
+    data.resize((size_t)size.QuadPart);
+    DWORD bytesRead = 0;
+    BOOL ok = data.empty() || ReadFile(file, data.data(), (DWORD)data.size(), &bytesRead, nullptr);
+    CloseHandle(file);
+    if (!ok || bytesRead != data.size())
+      return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    return S_OK;
+  }
+
+  std::wstring ToWide(const char* str) {
+    int length = MultiByteToWideChar(CP_UTF8, 0, str, -1, nullptr, 0);
+    if (length <= 1)
+      return std::wstring();
+    std::wstring result(length - 1, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, str, -1, &result[0], length);
+    return result;
+  }
+}
+
+HRESULT Scene::LoadDescription(AssetData& description, SceneFileView& view) {
+  // Uncompressed archive entry is used in place
+  if (FAILED(AssetArchive::GetInstance().Load(SCENE_DEFAULT_PATH, description))) {
+    HRESULT hr = ReadDescriptionFile(SCENE_DEFAULT_PATH, description.storage);
+    if (FAILED(hr)) {
+      std::vector<uint8_t> text;
+      hr = ReadDescriptionFile(SCENE_DEFAULT_TEXT_PATH, text);
+      if (FAILED(hr))
+        return hr;
+
+      SceneFileData scene;
+      if (!SceneCompiler::ParseText(reinterpret_cast<const char*>(text.data()), text.size(), scene))
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+      SerializeSceneFile(scene, description.storage);
+    }
+    description.data = description.storage.data();
+    description.size = description.storage.size();
+  }
+
+  if (ParseSceneFile(description.data, description.size, view) != SCENE_PARSE_OK)
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  return S_OK;
+}
 
 HRESULT Scene::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight) {
+  AssetData description;
+  SceneFileView view;
+  HRESULT hr = LoadDescription(description, view);
+  if (FAILED(hr))
+    return hr;
+
+  // Buffers are sized for object count limits, all boxes share one material
+  const SceneFileHeader& header = *view.header;
+  if (header.boxesCount == 0 || header.boxesCount > MAX_CUBES || header.lightsCount > MAX_LIGHT_SOURCES || header.planesCount > PLANES_COUNT)
+    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+  for (uint32_t i = 1; i < header.boxesCount; i++)
+    if (view.boxMaterials[i] != view.boxMaterials[0])
+      return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
   // Init boxes
-  std::vector<XMFLOAT4> boxPositions = std::vector<XMFLOAT4>(MAX_CUBES);
-  for (int i = 0; i < MAX_CUBES; i++) {
-    boxPositions[i] = XMFLOAT4(
-      (rand() / (float)(RAND_MAX + 1) * SCENE_SIZE - SCENE_SIZE / 2.f),
-      (rand() / (float)(RAND_MAX + 1) * SCENE_SIZE - SCENE_SIZE / 2.f),
-      (rand() / (float)(RAND_MAX + 1) * SCENE_SIZE - SCENE_SIZE / 2.f), 1.f);
+  const SceneMaterial& material = view.materials[view.boxMaterials[0]];
+  std::vector<std::wstring> diffusePaths(material.diffuseCount);
+  MaterialParams params = { std::vector<const wchar_t*>(material.diffuseCount), nullptr, material.shines };
+  for (uint32_t i = 0; i < material.diffuseCount; i++) {
+    diffusePaths[i] = ToWide(view.GetString(view.diffusePaths[material.diffuseFirst + i]));
+    params.diffPaths[i] = diffusePaths[i].c_str();
   }
-  HRESULT hr = box.Init(device, context, screenWidth, screenHeight, {{ L"./src/245.dds", L"./src/hah.dds"}, L"./src/245_norm.dds", 256.f }, boxPositions);
+  std::wstring normalPath = ToWide(view.GetString(material.normalPath));
+  params.normalPath = normalPath.c_str();
+
+  simulation.Stop();
+  CreateEntities(view);
+
+  hr = box.Init(device, context, screenWidth, screenHeight, params, world);
   if (FAILED(hr))
     return hr;
 
   // Init planes
-  std::vector<XMFLOAT4> planeColors = {
-    XMFLOAT4(1.f, 1.f, 1.f, 0.45f),
-    XMFLOAT4(1.f, 1.f, 1.f, 0.67f),
-    XMFLOAT4(0.f, 0.f, 1.f, 0.75f),
-  };
-
-  hr = planes.Init(device, context, screenWidth, screenHeight, 3, planeColors);
+  hr = planes.Init(device, context, screenWidth, screenHeight, header.planesCount);
   if (FAILED(hr))
     return hr;
 
@@ -30,26 +106,63 @@ HRESULT Scene::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scre
     return hr;
 
   // Init lights
-  
-  std::vector<XMFLOAT4> colors = std::vector<XMFLOAT4>(MAX_LIGHT_SOURCES);
-  std::vector<XMFLOAT4> positions = std::vector<XMFLOAT4>(MAX_LIGHT_SOURCES);
-
-  for (int i = 0; i < MAX_LIGHT_SOURCES; i++) {
-    colors[i] = XMFLOAT4(
-      (float)(0.5f + rand() / (float)(RAND_MAX + 1) * 0.5f),
-      (float)(0.5f + rand() / (float)(RAND_MAX + 1) * 0.5f),
-      (float)(0.5f + rand() / (float)(RAND_MAX + 1) * 0.5f), 1.f);
-    positions[i] = XMFLOAT4(
-      (rand() / (float)(RAND_MAX + 1) * SCENE_SIZE - SCENE_SIZE / 2.f),
-      (rand() / (float)(RAND_MAX + 1) * SCENE_SIZE - SCENE_SIZE / 2.f),
-      (rand() / (float)(RAND_MAX + 1) * SCENE_SIZE - SCENE_SIZE / 2.f), 1.f);
+  hr = lights.Init(device, context, screenWidth, screenHeight, world);
+  if (FAILED(hr))
+    return hr;
+
+  // Init shadows
+  hr = shadows.Init(device);
+  if (FAILED(hr))
+    return hr;
+
+  cameraTargets.assign(view.cameraTargets, view.cameraTargets + header.camerasCount);
+  cameraAngles.assign(view.cameraAngles, view.cameraAngles + header.camerasCount);
+
+  // World doesn't change structure from here, simulation may walk it on its own thread
+  simulation.Init(world);
+  simulation.Start();
+
+  return S_OK;
+}
+
+void Scene::CreateEntities(const SceneFileView& view) {
+  const SceneFileHeader& header = *view.header;
+  world.Clear();
+
+  for (uint32_t i = 0; i < header.boxesCount; i++) {
+    Entity entity = world.Create<PositionComponent, SpinComponent, MaterialComponent, TransformComponent, BoundsComponent>();
+    world.Get<PositionComponent>(entity)->position = view.boxPositions[i];
+    world.Get<SpinComponent>(entity)->speed = view.boxSpins[i];
+    *world.Get<MaterialComponent>(entity) = { view.boxMaterials[i], view.boxTextures[i] };
+  }
+
+  for (uint32_t i = 0; i < header.planesCount; i++) {
+    Entity entity = world.Create<PositionComponent, OscillationComponent, TransformComponent, ColorComponent>();
+    const XMFLOAT4& motion = view.planeMotions[i];
+    world.Get<PositionComponent>(entity)->position = view.planePositions[i];
+    *world.Get<OscillationComponent>(entity) = { XMFLOAT4(motion.x, motion.y, motion.z, 0.0f), motion.w };
+    world.Get<ColorComponent>(entity)->color = view.planeColors[i];
+  }
+
+  for (uint32_t i = 0; i < header.lightsCount; i++) {
+    Entity entity = world.Create<PositionComponent, LightComponent>();
+    world.Get<PositionComponent>(entity)->position = view.lightPositions[i];
+    world.Get<LightComponent>(entity)->color = view.lightColors[i];
   }
-  hr = lights.Init(device, context, screenWidth, screenHeight, colors, positions);
-  
-  return hr;
+}
+
+bool Scene::GetCamera(UINT index, XMFLOAT4& target, XMFLOAT4& angles) {
+  if (index >= cameraTargets.size())
+    return false;
+
+  target = cameraTargets[index];
+  angles = cameraAngles[index];
+  return true;
 }
 
 void Scene::Realese() {
+  simulation.Stop();
+
   box.Realese();
 
   planes.Realese();
@@ -57,10 +170,17 @@ void Scene::Realese() {
   sb.Realese();
 
   lights.Realese();
+
+  shadows.Realese();
+}
+
+void Scene::RenderShadows(ID3D11DeviceContext* context) {
+  shadows.Render(context, shadowPlanner, box);
 }
 
 void Scene::Render(ID3D11DeviceContext* context) {
-  // render boxes
+  // render boxes, they receive shadows
+  shadows.Bind(context);
   box.Render(context);
 
   lights.Render(context);
@@ -69,34 +189,89 @@ void Scene::Render(ID3D11DeviceContext* context) {
   sb.Render(context);
 
   // render planes
-  planes.Render(context);
+  if (!oit)
+    planes.Render(context);
 }
 
-bool Scene::FramePlanes(ID3D11DeviceContext* context, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos) {
-  auto duration = Timer::GetInstance().Clock();
-  std::vector<XMMATRIX> worldMatricies = std::vector<XMMATRIX>(3);
+void Scene::RenderTransparent(ID3D11DeviceContext* context) {
+  if (oit)
+    planes.Render(context);
+}
 
-  worldMatricies[0] = XMMatrixTranslation(1.25f, 0, (float)(sin(duration * 2) * -2.0));
-  worldMatricies[1] = XMMatrixTranslation(-1.25f, 0, (float)(sin(duration * 2) * 2.0));
-  worldMatricies[2] = XMMatrixTranslation(2.5f, 0, -1.25f);
-  
-  planes.Frame(context, worldMatricies, viewMatrix, projectionMatrix, cameraPos, lights);
+bool Scene::Frame(ID3D11DeviceContext* context, const CameraState& camera) {
+  // Moving entities get transforms blended from simulation states
+  {
+    AllocScope scope("motion");
+    simulation.Frame(world);
+  }
 
-  return S_OK;
-}
+  // Lights go first, other systems read their gathered data
+  {
+    AllocScope scope("lights");
+    lights.Frame(context, world, camera);
+  }
+
+  // Shadow views are culled together with main camera, maps are scheduled by casters they got
+  {
+    AllocScope scope("shadows");
+    shadowPlanner.Plan(camera, SHADOW_SUN_DIRECTION, lights.GetPositions().data(), lights.GetColors().data(), (uint32_t)lights.GetPositions().size());
+    box.SetCullViews(shadowPlanner.GetViews(), SHADOW_VIEWS_COUNT);
+  }
+
+  {
+    AllocScope scope("boxes");
+    box.Frame(context, world, camera, lights);
+  }
+
+  // Box frame packed bounds in query order of its instances
+  {
+    AllocScope scope("queries");
+    const XMFLOAT4* bbMin;
+    const XMFLOAT4* bbMax;
+    uint32_t boxesCount = box.GetBounds(bbMin, bbMax);
+    if (bvh.GetInstancesCount() != boxesCount)
+      bvh.Build(bbMin, bbMax, boxesCount);
+    else {
+      bvh.Refit(bbMin, bbMax);
+      if (bvh.NeedsRebuild())
+        bvh.Build(bbMin, bbMax, boxesCount);
+    }
+  }
 
-bool Scene::Frame(ID3D11DeviceContext* context, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos) {
-  box.Frame(context, viewMatrix, projectionMatrix, cameraPos, lights);
-  
-  FramePlanes(context, viewMatrix, projectionMatrix, cameraPos);
-  
-  sb.Frame(context, viewMatrix, projectionMatrix, cameraPos);
+  {
+    AllocScope scope("shadows");
+    uint32_t casterCounts[SHADOW_VIEWS_COUNT];
+    for (uint32_t v = 0; v < SHADOW_VIEWS_COUNT; v++)
+      box.GetViewInstances(1 + v, casterCounts[v]);
+    shadowPlanner.Schedule(casterCounts);
+    shadows.Frame(context, shadowPlanner, camera, (uint32_t)lights.GetPositions().size());
+  }
+
+  {
+    AllocScope scope("planes");
+    planes.Frame(context, world, camera, lights);
+  }
+
+  {
+    AllocScope scope("skybox");
+    sb.Frame(context, camera);
+  }
 
-  lights.Frame(context, viewMatrix, projectionMatrix, cameraPos);
-  
   return true;
 }
 
+QueryRay Scene::GetScreenRay(const CameraState& camera, float x, float y) {
+  // Reversed depth: near plane is at 1, far one at 0
+  XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), camera.GetInverseViewProjection());
+  XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), camera.GetInverseViewProjection());
+
+  QueryRay ray;
+  XMStoreFloat3(&ray.origin, nearPoint);
+  XMStoreFloat3(&ray.direction, XMVectorSubtract(farPoint, nearPoint));
+  ray.maxT = 1.0f;
+  return ray;
+}
+
 void Scene::Resize(int screenWidth, int screenHeight) {
   box.Resize(screenWidth, screenHeight);
 
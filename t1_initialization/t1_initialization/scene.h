@@ -14,9 +14,22 @@
 #include "plane.h"
 #include "timer.h"
 #include "texture.h"
+#include "sceneFile.h"
+#include "assetArchive.h"
+#include "ecs.h"
+#include "components.h"
+#include "allocTracker.h"
+#include "simulation.h"
+#include "shadowPlanner.h"
+#include "shadowMaps.h"
+#include "sceneBVH.h"
 
 using namespace DirectX;
 
+// Compiled scene description, text form is compiled in memory when it is missing
+#define SCENE_DEFAULT_PATH L"./src/default.scnb"
+#define SCENE_DEFAULT_TEXT_PATH L"./src/default.scene"
+
 class Scene {
 public:
   HRESULT Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight);
@@ -25,23 +38,65 @@ public:
 
   void Resize(int screenWidth, int screenHeight);
 
+  // Shadow maps scheduled this frame, before main pass
+  void RenderShadows(ID3D11DeviceContext* context);
+
+  // Opaque objects, then sorted transparent planes unless OIT is on
   void Render(ID3D11DeviceContext* context);
 
-  bool Frame(ID3D11DeviceContext* context, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos);
+  // Transparent planes into bound OIT accumulation and revealage targets
+  void RenderTransparent(ID3D11DeviceContext* context);
+
+  void SetOIT(bool enabled) { oit = enabled; planes.SetOIT(enabled); };
+  bool IsOIT() { return oit; };
+
+  void SetCullCoherence(bool enabled) { box.SetCullCoherence(enabled); };
+
+  // Simulation steps once per frame instead of by wall clock, frames are reproducible
+  void SetReplay(bool enabled) { simulation.SetReplay(enabled); };
+
+  bool Frame(ID3D11DeviceContext* context, const CameraState& camera);
 
   int GetName() {
     return box.GetCulledCount();
   };
+
+  // Nearest box hit by ray, instance is box index in query order
+  bool Pick(const QueryRay& ray, QueryHit& hit) const { return bvh.Intersect(ray, hit); };
+  // True if any box is between ray origin and origin + direction * maxT
+  bool IsOccluded(const QueryRay& ray) const { return bvh.Occluded(ray); };
+
+  // Ray from camera through screen point (x, y in [-1, 1], y up), spans near to far plane with maxT 1
+  static QueryRay GetScreenRay(const CameraState& camera, float x, float y);
+
+  // Camera from scene description: target w - distance, angles x - phi, y - theta
+  bool GetCamera(UINT index, XMFLOAT4& target, XMFLOAT4& angles);
 private:
-  bool FramePlanes(ID3D11DeviceContext* context, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos);
+  HRESULT LoadDescription(AssetData& description, SceneFileView& view);
+  void CreateEntities(const SceneFileView& view);
+
+  // Scene objects, Box, Plane and Light are render systems over it
+  World world;
+
+  // Moves boxes and planes at fixed rate, declared after world to stop before it goes
+  Simulation simulation;
 
   Box box;
 
   Plane planes;
   Light lights;
+
+  // Sun cascades and point light cubes, casters are culled with boxes
+  ShadowPlanner shadowPlanner;
+  ShadowMaps shadows;
+
+  // Ray queries over box bounds, refitted as boxes move
+  SceneBVH bvh;
   
   Skybox sb;
 
-  // Velocity of world matrix rotation
-  float angle_velocity = 3.1415926f;
+  bool oit = false;
+
+  std::vector<XMFLOAT4> cameraTargets;
+  std::vector<XMFLOAT4> cameraAngles;
 };
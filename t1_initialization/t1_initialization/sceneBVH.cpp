@@ -0,0 +1,500 @@
+#include <algorithm>
+#include <cfloat>
+
+#include "sceneBVH.h"
+
+namespace {
+  // Splits below this depth are median ones, traversal stack can't overflow
+  const uint32_t BVH_MEDIAN_DEPTH = BVH_STACK_SIZE / 2;
+
+  float Component(const XMFLOAT3& v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+  }
+
+  void Grow(XMFLOAT3& boxMin, XMFLOAT3& boxMax, const XMFLOAT3& otherMin, const XMFLOAT3& otherMax) {
+    boxMin = XMFLOAT3((std::min)(boxMin.x, otherMin.x), (std::min)(boxMin.y, otherMin.y), (std::min)(boxMin.z, otherMin.z));
+    boxMax = XMFLOAT3((std::max)(boxMax.x, otherMax.x), (std::max)(boxMax.y, otherMax.y), (std::max)(boxMax.z, otherMax.z));
+  }
+
+  float Area(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax) {
+    float dx = boxMax.x - boxMin.x, dy = boxMax.y - boxMin.y, dz = boxMax.z - boxMin.z;
+    return dx < 0.0f ? 0.0f : 2.0f * (dx * dy + dy * dz + dz * dx);
+  }
+
+  // Ray with reciprocal direction, zero components give infinities and slabs still work
+  struct ScalarRay {
+    XMFLOAT3 origin;
+    XMFLOAT3 inverse;
+  };
+
+  ScalarRay MakeRay(const QueryRay& ray) {
+    return { ray.origin, XMFLOAT3(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z) };
+  }
+
+  // Entry t of ray into box if it is within [0, maxT]
+  bool Slab(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, const ScalarRay& ray, float maxT, float& entry) {
+    float t0 = (boxMin.x - ray.origin.x) * ray.inverse.x, t1 = (boxMax.x - ray.origin.x) * ray.inverse.x;
+    float tNear = (std::min)(t0, t1), tFar = (std::max)(t0, t1);
+    t0 = (boxMin.y - ray.origin.y) * ray.inverse.y;
+    t1 = (boxMax.y - ray.origin.y) * ray.inverse.y;
+    tNear = (std::max)(tNear, (std::min)(t0, t1));
+    tFar = (std::min)(tFar, (std::max)(t0, t1));
+    t0 = (boxMin.z - ray.origin.z) * ray.inverse.z;
+    t1 = (boxMax.z - ray.origin.z) * ray.inverse.z;
+    tNear = (std::max)(tNear, (std::min)(t0, t1));
+    tFar = (std::min)(tFar, (std::max)(t0, t1));
+
+    entry = (std::max)(tNear, 0.0f);
+    return entry <= (std::min)(tFar, maxT);
+  }
+
+  // Four rays as structure of arrays
+  struct RayPacket {
+    XMVECTOR originX, originY, originZ;
+    XMVECTOR inverseX, inverseY, inverseZ;
+    XMVECTOR maxT;
+  };
+
+  RayPacket MakePacket(const QueryRay rays[4]) {
+    RayPacket packet;
+    packet.originX = XMVectorSet(rays[0].origin.x, rays[1].origin.x, rays[2].origin.x, rays[3].origin.x);
+    packet.originY = XMVectorSet(rays[0].origin.y, rays[1].origin.y, rays[2].origin.y, rays[3].origin.y);
+    packet.originZ = XMVectorSet(rays[0].origin.z, rays[1].origin.z, rays[2].origin.z, rays[3].origin.z);
+    packet.inverseX = XMVectorReciprocal(XMVectorSet(rays[0].direction.x, rays[1].direction.x, rays[2].direction.x, rays[3].direction.x));
+    packet.inverseY = XMVectorReciprocal(XMVectorSet(rays[0].direction.y, rays[1].direction.y, rays[2].direction.y, rays[3].direction.y));
+    packet.inverseZ = XMVectorReciprocal(XMVectorSet(rays[0].direction.z, rays[1].direction.z, rays[2].direction.z, rays[3].direction.z));
+    packet.maxT = XMVectorSet(rays[0].maxT, rays[1].maxT, rays[2].maxT, rays[3].maxT);
+    return packet;
+  }
+
+  // Lanes hitting box within their maxT, entry gets their entry t
+  XMVECTOR SlabPacket(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, const RayPacket& packet, XMVECTOR& entry) {
+    XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMVectorReplicate(boxMin.x), packet.originX), packet.inverseX);
+    XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMVectorReplicate(boxMax.x), packet.originX), packet.inverseX);
+    XMVECTOR tNear = XMVectorMin(t0, t1), tFar = XMVectorMax(t0, t1);
+    t0 = XMVectorMultiply(XMVectorSubtract(XMVectorReplicate(boxMin.y), packet.originY), packet.inverseY);
+    t1 = XMVectorMultiply(XMVectorSubtract(XMVectorReplicate(boxMax.y), packet.originY), packet.inverseY);
+    tNear = XMVectorMax(tNear, XMVectorMin(t0, t1));
+    tFar = XMVectorMin(tFar, XMVectorMax(t0, t1));
+    t0 = XMVectorMultiply(XMVectorSubtract(XMVectorReplicate(boxMin.z), packet.originZ), packet.inverseZ);
+    t1 = XMVectorMultiply(XMVectorSubtract(XMVectorReplicate(boxMax.z), packet.originZ), packet.inverseZ);
+    tNear = XMVectorMax(tNear, XMVectorMin(t0, t1));
+    tFar = XMVectorMin(tFar, XMVectorMax(t0, t1));
+
+    entry = XMVectorMax(tNear, XMVectorZero());
+    return XMVectorLessOrEqual(entry, XMVectorMin(tFar, packet.maxT));
+  }
+
+  uint32_t LaneBits(FXMVECTOR mask) {
+    XMUINT4 lanes;
+    XMStoreUInt4(&lanes, mask);
+    return (lanes.x ? 1u : 0u) | (lanes.y ? 2u : 0u) | (lanes.z ? 4u : 0u) | (lanes.w ? 8u : 0u);
+  }
+
+  uint32_t LanesCount(uint32_t bits) {
+    return (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+  }
+
+  float DistanceSq(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, const XMFLOAT3& point) {
+    float dx = (std::max)((std::max)(boxMin.x - point.x, point.x - boxMax.x), 0.0f);
+    float dy = (std::max)((std::max)(boxMin.y - point.y, point.y - boxMax.y), 0.0f);
+    float dz = (std::max)((std::max)(boxMin.z - point.z, point.z - boxMax.z), 0.0f);
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  bool Overlaps(const XMFLOAT3& aMin, const XMFLOAT3& aMax, const XMFLOAT3& bMin, const XMFLOAT3& bMax) {
+    return aMin.x <= bMax.x && bMin.x <= aMax.x && aMin.y <= bMax.y && bMin.y <= aMax.y && aMin.z <= bMax.z && bMin.z <= aMax.z;
+  }
+}
+
+void SceneBVH::Build(const XMFLOAT4* bbMin, const XMFLOAT4* bbMax, uint32_t count) {
+  boundsMin.resize(count);
+  boundsMax.resize(count);
+  ids.resize(count);
+  centroids.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    boundsMin[i] = XMFLOAT3(bbMin[i].x, bbMin[i].y, bbMin[i].z);
+    boundsMax[i] = XMFLOAT3(bbMax[i].x, bbMax[i].y, bbMax[i].z);
+    centroids[i] = XMFLOAT3(0.5f * (bbMin[i].x + bbMax[i].x), 0.5f * (bbMin[i].y + bbMax[i].y), 0.5f * (bbMin[i].z + bbMax[i].z));
+    ids[i] = i;
+  }
+
+  // Binary tree with leaves of one or more instances has less than 2 * count nodes
+  nodes.clear();
+  nodes.reserve(2 * count);
+  if (count > 0) {
+    nodes.push_back({ XMFLOAT3(), 0, XMFLOAT3(), count });
+    UpdateBounds(nodes[0]);
+    Subdivide(0, 0);
+  }
+
+  buildCost = cost = ComputeCost();
+}
+
+void SceneBVH::Subdivide(uint32_t nodeIndex, uint32_t depth) {
+  uint32_t first = nodes[nodeIndex].first, count = nodes[nodeIndex].count;
+  if (count <= BVH_MAX_LEAF_SIZE)
+    return;
+
+  // Split along the longest axis of centroid bounds
+  XMFLOAT3 centroidMin(FLT_MAX, FLT_MAX, FLT_MAX), centroidMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+  for (uint32_t i = first; i < first + count; i++)
+    Grow(centroidMin, centroidMax, centroids[ids[i]], centroids[ids[i]]);
+  XMFLOAT3 extent(centroidMax.x - centroidMin.x, centroidMax.y - centroidMin.y, centroidMax.z - centroidMin.z);
+  int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+  float axisMin = Component(centroidMin, axis), axisExtent = Component(extent, axis);
+
+  uint32_t leftCount = 0;
+  if (axisExtent > 0.0f && depth < BVH_MEDIAN_DEPTH) {
+    // Binned SAH: instances go to bins by centroid, the cheapest border between bins wins
+    auto binOf = [&](uint32_t id) {
+      return (std::min)((int)((Component(centroids[id], axis) - axisMin) * BVH_SAH_BINS / axisExtent), BVH_SAH_BINS - 1);
+    };
+
+    XMFLOAT3 binMin[BVH_SAH_BINS], binMax[BVH_SAH_BINS];
+    uint32_t binCount[BVH_SAH_BINS] = {};
+    for (int b = 0; b < BVH_SAH_BINS; b++) {
+      binMin[b] = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+      binMax[b] = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    }
+    for (uint32_t i = first; i < first + count; i++) {
+      int b = binOf(ids[i]);
+      binCount[b]++;
+      Grow(binMin[b], binMax[b], boundsMin[ids[i]], boundsMax[ids[i]]);
+    }
+
+    // Right side costs are swept from the end, left side ones on the way back
+    float rightCost[BVH_SAH_BINS];
+    XMFLOAT3 sideMin(FLT_MAX, FLT_MAX, FLT_MAX), sideMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    uint32_t sideCount = 0;
+    for (int b = BVH_SAH_BINS - 1; b > 0; b--) {
+      Grow(sideMin, sideMax, binMin[b], binMax[b]);
+      sideCount += binCount[b];
+      rightCost[b] = Area(sideMin, sideMax) * sideCount;
+    }
+
+    float bestCost = FLT_MAX;
+    int bestBin = 0;
+    sideMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+    sideMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    sideCount = 0;
+    for (int b = 1; b < BVH_SAH_BINS; b++) {
+      Grow(sideMin, sideMax, binMin[b - 1], binMax[b - 1]);
+      sideCount += binCount[b - 1];
+      float splitCost = Area(sideMin, sideMax) * sideCount + rightCost[b];
+      if (sideCount > 0 && sideCount < count && splitCost < bestCost) {
+        bestCost = splitCost;
+        bestBin = b;
+      }
+    }
+
+    if (bestBin > 0)
+      leftCount = (uint32_t)(std::partition(ids.begin() + first, ids.begin() + first + count,
+        [&](uint32_t id) { return binOf(id) < bestBin; }) - (ids.begin() + first));
+  }
+
+  // Equal centroids or deep tree: halves by centroid order
+  if (leftCount == 0 || leftCount == count) {
+    leftCount = count / 2;
+    std::nth_element(ids.begin() + first, ids.begin() + first + leftCount, ids.begin() + first + count,
+      [&](uint32_t a, uint32_t b) { return Component(centroids[a], axis) < Component(centroids[b], axis); });
+  }
+
+  uint32_t left = (uint32_t)nodes.size();
+  nodes.push_back({ XMFLOAT3(), first, XMFLOAT3(), leftCount });
+  nodes.push_back({ XMFLOAT3(), first + leftCount, XMFLOAT3(), count - leftCount });
+  nodes[nodeIndex].first = left;
+  nodes[nodeIndex].count = 0;
+  UpdateBounds(nodes[left]);
+  UpdateBounds(nodes[left + 1]);
+
+  Subdivide(left, depth + 1);
+  Subdivide(left + 1, depth + 1);
+}
+
+void SceneBVH::UpdateBounds(Node& node) const {
+  node.min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+  node.max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+  if (node.count > 0) {
+    for (uint32_t i = node.first; i < node.first + node.count; i++)
+      Grow(node.min, node.max, boundsMin[ids[i]], boundsMax[ids[i]]);
+  }
+  else {
+    Grow(node.min, node.max, nodes[node.first].min, nodes[node.first].max);
+    Grow(node.min, node.max, nodes[node.first + 1].min, nodes[node.first + 1].max);
+  }
+}
+
+float SceneBVH::ComputeCost() const {
+  // Node visits weighted by the chance to hit node, leaves pay per instance
+  float rootArea = nodes.empty() ? 0.0f : Area(nodes[0].min, nodes[0].max);
+  if (rootArea <= 0.0f)
+    return 0.0f;
+
+  float total = 0.0f;
+  for (const Node& node : nodes)
+    total += Area(node.min, node.max) * (node.count > 0 ? (float)node.count : 1.0f);
+  return total / rootArea;
+}
+
+void SceneBVH::Refit(const XMFLOAT4* bbMin, const XMFLOAT4* bbMax) {
+  for (uint32_t i = 0; i < (uint32_t)boundsMin.size(); i++) {
+    boundsMin[i] = XMFLOAT3(bbMin[i].x, bbMin[i].y, bbMin[i].z);
+    boundsMax[i] = XMFLOAT3(bbMax[i].x, bbMax[i].y, bbMax[i].z);
+  }
+
+  // Children are always stored after parents
+  for (uint32_t n = (uint32_t)nodes.size(); n > 0; n--)
+    UpdateBounds(nodes[n - 1]);
+
+  cost = ComputeCost();
+}
+
+bool SceneBVH::Intersect(const QueryRay& ray, QueryHit& hit) const {
+  hit = QueryHit();
+  hit.t = ray.maxT;
+  ScalarRay scalarRay = MakeRay(ray);
+
+  float entry;
+  if (nodes.empty() || !Slab(nodes[0].min, nodes[0].max, scalarRay, hit.t, entry))
+    return false;
+
+  uint32_t stack[BVH_STACK_SIZE];
+  float stackEntry[BVH_STACK_SIZE];
+  uint32_t stackSize = 0;
+  stack[stackSize] = 0;
+  stackEntry[stackSize++] = entry;
+
+  while (stackSize > 0) {
+    stackSize--;
+    // Nearer hit found since node was pushed
+    if (stackEntry[stackSize] > hit.t)
+      continue;
+
+    const Node& node = nodes[stack[stackSize]];
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        if (Slab(boundsMin[ids[i]], boundsMax[ids[i]], scalarRay, hit.t, entry)) {
+          hit.instance = (int32_t)ids[i];
+          hit.t = entry;
+        }
+      }
+      continue;
+    }
+
+    // Nearer child goes on top
+    float leftEntry, rightEntry;
+    bool leftHit = Slab(nodes[node.first].min, nodes[node.first].max, scalarRay, hit.t, leftEntry);
+    bool rightHit = Slab(nodes[node.first + 1].min, nodes[node.first + 1].max, scalarRay, hit.t, rightEntry);
+    uint32_t nearChild = node.first, farChild = node.first + 1;
+    if (leftHit && rightHit && rightEntry < leftEntry) {
+      std::swap(nearChild, farChild);
+      std::swap(leftEntry, rightEntry);
+    }
+    else if (!leftHit) {
+      nearChild = farChild;
+      leftEntry = rightEntry;
+      leftHit = rightHit;
+      rightHit = false;
+    }
+
+    if (rightHit) {
+      stack[stackSize] = farChild;
+      stackEntry[stackSize++] = rightEntry;
+    }
+    if (leftHit) {
+      stack[stackSize] = nearChild;
+      stackEntry[stackSize++] = leftEntry;
+    }
+  }
+
+  return hit.instance >= 0;
+}
+
+bool SceneBVH::Occluded(const QueryRay& ray) const {
+  ScalarRay scalarRay = MakeRay(ray);
+  float entry;
+
+  uint32_t stack[BVH_STACK_SIZE];
+  uint32_t stackSize = 0;
+  if (!nodes.empty())
+    stack[stackSize++] = 0;
+
+  while (stackSize > 0) {
+    const Node& node = nodes[stack[--stackSize]];
+    if (!Slab(node.min, node.max, scalarRay, ray.maxT, entry))
+      continue;
+
+    if (node.count == 0) {
+      stack[stackSize++] = node.first + 1;
+      stack[stackSize++] = node.first;
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++)
+      if (Slab(boundsMin[ids[i]], boundsMax[ids[i]], scalarRay, ray.maxT, entry))
+        return true;
+  }
+
+  return false;
+}
+
+void SceneBVH::Intersect4(const QueryRay rays[4], QueryHit hits[4]) const {
+  RayPacket packet = MakePacket(rays);
+  for (int lane = 0; lane < 4; lane++)
+    hits[lane] = QueryHit();
+
+  uint32_t stack[BVH_STACK_SIZE];
+  uint32_t stackSize = 0;
+  if (!nodes.empty())
+    stack[stackSize++] = 0;
+
+  // maxT of each lane shrinks to its nearest hit, so node tests cull by it
+  XMVECTOR entry;
+  while (stackSize > 0) {
+    const Node& node = nodes[stack[--stackSize]];
+    if (LaneBits(SlabPacket(node.min, node.max, packet, entry)) == 0)
+      continue;
+
+    if (node.count == 0) {
+      // Child most lanes enter first goes on top
+      XMVECTOR leftEntry, rightEntry;
+      XMVECTOR leftMask = SlabPacket(nodes[node.first].min, nodes[node.first].max, packet, leftEntry);
+      XMVECTOR rightMask = SlabPacket(nodes[node.first + 1].min, nodes[node.first + 1].max, packet, rightEntry);
+      uint32_t leftBits = LaneBits(leftMask), rightBits = LaneBits(rightMask);
+      uint32_t rightFirst = LaneBits(XMVectorLess(rightEntry, leftEntry)) & leftBits & rightBits;
+      uint32_t leftFirst = LaneBits(XMVectorLess(leftEntry, rightEntry)) & leftBits & rightBits;
+
+      uint32_t nearChild = node.first, farChild = node.first + 1;
+      uint32_t nearBits = leftBits, farBits = rightBits;
+      if (LanesCount(rightFirst) > LanesCount(leftFirst) || (!leftBits && rightBits)) {
+        std::swap(nearChild, farChild);
+        std::swap(nearBits, farBits);
+      }
+      if (farBits)
+        stack[stackSize++] = farChild;
+      if (nearBits)
+        stack[stackSize++] = nearChild;
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      XMVECTOR mask = SlabPacket(boundsMin[ids[i]], boundsMax[ids[i]], packet, entry);
+      uint32_t bits = LaneBits(mask);
+      if (bits == 0)
+        continue;
+      packet.maxT = XMVectorSelect(packet.maxT, entry, mask);
+      for (int lane = 0; lane < 4; lane++)
+        if (bits & (1u << lane))
+          hits[lane].instance = (int32_t)ids[i];
+    }
+  }
+
+  XMFLOAT4 t;
+  XMStoreFloat4(&t, packet.maxT);
+  hits[0].t = t.x;
+  hits[1].t = t.y;
+  hits[2].t = t.z;
+  hits[3].t = t.w;
+  for (int lane = 0; lane < 4; lane++)
+    if (hits[lane].instance < 0)
+      hits[lane].t = rays[lane].maxT;
+}
+
+uint32_t SceneBVH::Occluded4(const QueryRay rays[4]) const {
+  RayPacket packet = MakePacket(rays);
+  uint32_t occluded = 0;
+
+  uint32_t stack[BVH_STACK_SIZE];
+  uint32_t stackSize = 0;
+  if (!nodes.empty())
+    stack[stackSize++] = 0;
+
+  // Occluded lanes get negative maxT and miss everything after
+  XMVECTOR entry;
+  XMVECTOR done = XMVectorReplicate(-1.0f);
+  while (stackSize > 0 && occluded != 0xF) {
+    const Node& node = nodes[stack[--stackSize]];
+    if (LaneBits(SlabPacket(node.min, node.max, packet, entry)) == 0)
+      continue;
+
+    if (node.count == 0) {
+      stack[stackSize++] = node.first + 1;
+      stack[stackSize++] = node.first;
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      XMVECTOR mask = SlabPacket(boundsMin[ids[i]], boundsMax[ids[i]], packet, entry);
+      if (LaneBits(mask) == 0)
+        continue;
+      occluded |= LaneBits(mask);
+      packet.maxT = XMVectorSelect(packet.maxT, done, mask);
+    }
+  }
+
+  return occluded;
+}
+
+uint32_t SceneBVH::OverlapSphere(const XMFLOAT3& center, float radius, uint32_t* result, uint32_t maxIds) const {
+  float radiusSq = radius * radius;
+  uint32_t count = 0;
+
+  uint32_t stack[BVH_STACK_SIZE];
+  uint32_t stackSize = 0;
+  if (!nodes.empty())
+    stack[stackSize++] = 0;
+
+  while (stackSize > 0) {
+    const Node& node = nodes[stack[--stackSize]];
+    if (DistanceSq(node.min, node.max, center) > radiusSq)
+      continue;
+
+    if (node.count == 0) {
+      stack[stackSize++] = node.first + 1;
+      stack[stackSize++] = node.first;
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      if (DistanceSq(boundsMin[ids[i]], boundsMax[ids[i]], center) <= radiusSq) {
+        if (count < maxIds)
+          result[count] = ids[i];
+        count++;
+      }
+    }
+  }
+
+  return (std::min)(count, maxIds);
+}
+
+uint32_t SceneBVH::OverlapBox(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, uint32_t* result, uint32_t maxIds) const {
+  uint32_t count = 0;
+
+  uint32_t stack[BVH_STACK_SIZE];
+  uint32_t stackSize = 0;
+  if (!nodes.empty())
+    stack[stackSize++] = 0;
+
+  while (stackSize > 0) {
+    const Node& node = nodes[stack[--stackSize]];
+    if (!Overlaps(node.min, node.max, boxMin, boxMax))
+      continue;
+
+    if (node.count == 0) {
+      stack[stackSize++] = node.first + 1;
+      stack[stackSize++] = node.first;
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+      if (Overlaps(boundsMin[ids[i]], boundsMax[ids[i]], boxMin, boxMax)) {
+        if (count < maxIds)
+          result[count] = ids[i];
+        count++;
+      }
+    }
+  }
+
+  return (std::min)(count, maxIds);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+// Instances in leaf at most
+#define BVH_MAX_LEAF_SIZE 2
+// Split candidates along axis in SAH build
+#define BVH_SAH_BINS 8
+// Traversal stack, enough for any tree built here
+#define BVH_STACK_SIZE 64
+// Refitted tree is worth rebuilding when its SAH cost grows this much
+#define BVH_REBUILD_RATIO 1.5f
+
+struct QueryRay {
+  XMFLOAT3 origin;
+  XMFLOAT3 direction;      // needn't be normalized, t is in its lengths
+  float maxT;
+};
+
+struct QueryHit {
+  int32_t instance = -1;   // -1 - nothing hit
+  float t = 0.0f;          // entry into instance bounds, 0 if ray starts inside
+};
+
+// Device free ray and region queries over instance bounds (picking, visibility probes).
+// Binned SAH tree over AABBs, refitted when instances move and rebuilt when refits
+// make it much worse. Packets trace 4 rays together in DirectXMath vectors
+class SceneBVH {
+public:
+  // World AABBs with bbMin <= bbMax (as Box writes them). Storage is reused, rebuilding
+  // the same number of instances doesn't allocate
+  void Build(const XMFLOAT4* bbMin, const XMFLOAT4* bbMax, uint32_t count);
+
+  // Same instances with new bounds, tree topology is kept
+  void Refit(const XMFLOAT4* bbMin, const XMFLOAT4* bbMax);
+  bool NeedsRebuild() const { return cost > buildCost * BVH_REBUILD_RATIO; };
+
+  // Nearest hit within ray maxT
+  bool Intersect(const QueryRay& ray, QueryHit& hit) const;
+  // Any hit within ray maxT, stops at first one
+  bool Occluded(const QueryRay& ray) const;
+
+  // Same for 4 rays at once, rays going the same way make it pay off
+  void Intersect4(const QueryRay rays[4], QueryHit hits[4]) const;
+  // Returns mask of occluded rays, bit per ray
+  uint32_t Occluded4(const QueryRay rays[4]) const;
+
+  // Instances overlapping region, returns their count (ids beyond maxIds are dropped)
+  uint32_t OverlapSphere(const XMFLOAT3& center, float radius, uint32_t* result, uint32_t maxIds) const;
+  uint32_t OverlapBox(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, uint32_t* result, uint32_t maxIds) const;
+
+  uint32_t GetInstancesCount() const { return (uint32_t)boundsMin.size(); };
+  uint32_t GetNodesCount() const { return (uint32_t)nodes.size(); };
+  // SAH cost relative to root area, as built and now
+  float GetBuildCost() const { return buildCost; };
+  float GetCost() const { return cost; };
+private:
+  // Leaf: first instance in ids and their count, inner: left child (right is next one) and count 0
+  struct Node {
+    XMFLOAT3 min;
+    uint32_t first;
+    XMFLOAT3 max;
+    uint32_t count;
+  };
+
+  void Subdivide(uint32_t node, uint32_t depth);
+  void UpdateBounds(Node& node) const;
+  float ComputeCost() const;
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> ids;
+  std::vector<XMFLOAT3> boundsMin;
+  std::vector<XMFLOAT3> boundsMax;
+  // Build scratch
+  std::vector<XMFLOAT3> centroids;
+
+  float buildCost = 0.0f;
+  float cost = 0.0f;
+};
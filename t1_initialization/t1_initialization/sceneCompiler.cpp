@@ -0,0 +1,250 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "sceneCompiler.h"
+
+namespace {
+  const double SCENE_DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+  // Whitespace separated tokens of one line, comment is cut off
+  struct LineTokens {
+    std::vector<std::string> tokens;
+
+    void Split(const char* begin, const char* end) {
+      tokens.clear();
+      const char* p = begin;
+      while (p < end && *p != '#') {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+          p++;
+        const char* start = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '#')
+          p++;
+        if (p > start)
+          tokens.emplace_back(start, p);
+      }
+    }
+  };
+
+  bool ParseFloat(const std::string& token, float& value) {
+    char* end = nullptr;
+    value = strtof(token.c_str(), &end);
+    return end == token.c_str() + token.size() && !token.empty();
+  }
+
+  bool ParseUInt(const std::string& token, uint32_t& value) {
+    char* end = nullptr;
+    unsigned long result = strtoul(token.c_str(), &end, 10);
+    if (token.empty() || token[0] == '-' || end != token.c_str() + token.size() || result > 0xFFFFFFFFul)
+      return false;
+    value = (uint32_t)result;
+    return true;
+  }
+
+  // Angles are converted in double precision, so radians -> degrees -> radians gives the same float
+  bool ParseAngle(const std::string& token, float& radians) {
+    char* end = nullptr;
+    double degrees = strtod(token.c_str(), &end);
+    if (token.empty() || end != token.c_str() + token.size())
+      return false;
+    radians = (float)(degrees * SCENE_DEG_TO_RAD);
+    return true;
+  }
+
+  bool ParseFloats(const std::vector<std::string>& tokens, size_t first, size_t count, float* values) {
+    for (size_t i = 0; i < count; i++)
+      if (!ParseFloat(tokens[first + i], values[i]))
+        return false;
+    return true;
+  }
+
+  // Formats right into text, names and paths have no length limit
+  void AppendLine(std::string& text, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list sizeArgs;
+    va_copy(sizeArgs, args);
+    int length = vsnprintf(nullptr, 0, format, sizeArgs);
+    va_end(sizeArgs);
+    if (length > 0) {
+      size_t start = text.size();
+      text.resize(start + length + 1);
+      vsnprintf(&text[start], length + 1, format, args);
+      text.resize(start + length);
+    }
+    va_end(args);
+  }
+}
+
+bool SceneCompiler::ParseText(const char* text, size_t size, SceneFileData& scene, uint32_t* errorLine) {
+  scene = SceneFileData();
+  std::map<std::string, uint32_t> materialIds;
+  LineTokens line;
+
+  const char* p = text;
+  const char* end = text + size;
+  uint32_t lineNumber = 0;
+  while (p < end) {
+    const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (!lineEnd)
+      lineEnd = end;
+    lineNumber++;
+    line.Split(p, lineEnd);
+    p = lineEnd + 1;
+
+    auto& tokens = line.tokens;
+    if (tokens.empty())
+      continue;
+
+    bool ok = false;
+    const std::string& statement = tokens[0];
+    if (statement == "material" && tokens.size() >= 5) {
+      SceneMaterial material = {};
+      ok = materialIds.find(tokens[1]) == materialIds.end() && ParseFloat(tokens[2], material.shines);
+      if (ok) {
+        material.name = scene.AddString(tokens[1]);
+        material.normalPath = scene.AddString(tokens[3]);
+        material.diffuseFirst = (uint32_t)scene.diffusePaths.size();
+        material.diffuseCount = (uint32_t)(tokens.size() - 4);
+        for (size_t i = 4; i < tokens.size(); i++)
+          scene.diffusePaths.push_back(scene.AddString(tokens[i]));
+        materialIds[tokens[1]] = (uint32_t)scene.materials.size();
+        scene.materials.push_back(material);
+      }
+    } else if (statement == "box" && tokens.size() == 7) {
+      auto material = materialIds.find(tokens[1]);
+      uint32_t texture = 0;
+      float spin = 0.0f;
+      XMFLOAT4 pos(0.0f, 0.0f, 0.0f, 1.0f);
+      ok = material != materialIds.end() && ParseUInt(tokens[2], texture) && ParseFloat(tokens[3], spin) &&
+        ParseFloats(tokens, 4, 3, &pos.x) && texture < scene.materials[material->second].diffuseCount;
+      if (ok) {
+        scene.boxPositions.push_back(pos);
+        scene.boxMaterials.push_back(material->second);
+        scene.boxTextures.push_back(texture);
+        scene.boxSpins.push_back(spin);
+      }
+    } else if (statement == "plane" && tokens.size() == 12) {
+      XMFLOAT4 color, pos(0.0f, 0.0f, 0.0f, 1.0f), motion;
+      ok = ParseFloats(tokens, 1, 4, &color.x) && ParseFloats(tokens, 5, 3, &pos.x) && ParseFloats(tokens, 8, 4, &motion.x);
+      if (ok) {
+        scene.planeColors.push_back(color);
+        scene.planePositions.push_back(pos);
+        scene.planeMotions.push_back(motion);
+      }
+    } else if (statement == "light" && tokens.size() == 7) {
+      XMFLOAT4 pos(0.0f, 0.0f, 0.0f, 1.0f), color(0.0f, 0.0f, 0.0f, 1.0f);
+      ok = ParseFloats(tokens, 1, 3, &pos.x) && ParseFloats(tokens, 4, 3, &color.x);
+      if (ok) {
+        scene.lightPositions.push_back(pos);
+        scene.lightColors.push_back(color);
+      }
+    } else if (statement == "camera" && tokens.size() == 7) {
+      XMFLOAT4 target, angles(0.0f, 0.0f, 0.0f, 0.0f);
+      ok = ParseFloats(tokens, 1, 4, &target.x) && ParseAngle(tokens[5], angles.x) && ParseAngle(tokens[6], angles.y);
+      if (ok) {
+        scene.cameraTargets.push_back(target);
+        scene.cameraAngles.push_back(angles);
+      }
+    }
+
+    if (!ok) {
+      if (errorLine)
+        *errorLine = lineNumber;
+      scene = SceneFileData();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void SceneCompiler::WriteText(const SceneFileView& view, std::string& text) {
+  text.clear();
+  const SceneFileHeader& header = *view.header;
+
+  text.append("# material <name> <shines> <normal path> <diffuse path>...\n");
+  for (uint32_t i = 0; i < header.materialsCount; i++) {
+    const SceneMaterial& material = view.materials[i];
+    AppendLine(text, "material %s %.9g %s", view.GetString(material.name), material.shines, view.GetString(material.normalPath));
+    for (uint32_t j = 0; j < material.diffuseCount; j++)
+      AppendLine(text, " %s", view.GetString(view.diffusePaths[material.diffuseFirst + j]));
+    text.push_back('\n');
+  }
+
+  text.append("\n# box <material> <texture> <spin> <x> <y> <z>\n");
+  for (uint32_t i = 0; i < header.boxesCount; i++) {
+    const XMFLOAT4& pos = view.boxPositions[i];
+    AppendLine(text, "box %s %u %.9g %.9g %.9g %.9g\n", view.GetString(view.materials[view.boxMaterials[i]].name),
+      view.boxTextures[i], view.boxSpins[i], pos.x, pos.y, pos.z);
+  }
+
+  text.append("\n# plane <r> <g> <b> <a> <x> <y> <z> <amplitude x> <amplitude y> <amplitude z> <frequency>\n");
+  for (uint32_t i = 0; i < header.planesCount; i++) {
+    const XMFLOAT4& color = view.planeColors[i];
+    const XMFLOAT4& pos = view.planePositions[i];
+    const XMFLOAT4& motion = view.planeMotions[i];
+    AppendLine(text, "plane %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", color.x, color.y, color.z, color.w,
+      pos.x, pos.y, pos.z, motion.x, motion.y, motion.z, motion.w);
+  }
+
+  text.append("\n# light <x> <y> <z> <r> <g> <b>\n");
+  for (uint32_t i = 0; i < header.lightsCount; i++) {
+    const XMFLOAT4& pos = view.lightPositions[i];
+    const XMFLOAT4& color = view.lightColors[i];
+    AppendLine(text, "light %.9g %.9g %.9g %.9g %.9g %.9g\n", pos.x, pos.y, pos.z, color.x, color.y, color.z);
+  }
+
+  text.append("\n# camera <x> <y> <z> <distance> <phi degrees> <theta degrees>\n");
+  for (uint32_t i = 0; i < header.camerasCount; i++) {
+    const XMFLOAT4& target = view.cameraTargets[i];
+    const XMFLOAT4& angles = view.cameraAngles[i];
+    AppendLine(text, "camera %.9g %.9g %.9g %.9g %.17g %.17g\n", target.x, target.y, target.z, target.w,
+      angles.x / SCENE_DEG_TO_RAD, angles.y / SCENE_DEG_TO_RAD);
+  }
+}
+
+HRESULT SceneCompiler::CompileFile(const wchar_t* srcPath, const wchar_t* dstPath) {
+  HANDLE file = CreateFileW(srcPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+
+  LARGE_INTEGER size = {};
+  if (!GetFileSizeEx(file, &size) || size.QuadPart > 0x7FFFFFFF) {
+    CloseHandle(file);
+    return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+  }
+
+  std::vector<char> text((size_t)size.QuadPart);
+  DWORD bytesRead = 0;
+  BOOL read = text.empty() || ReadFile(file, text.data(), (DWORD)text.size(), &bytesRead, nullptr);
+  CloseHandle(file);
+  if (!read || bytesRead != text.size())
+    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+  SceneFileData scene;
+  uint32_t errorLine = 0;
+  if (!ParseText(text.data(), text.size(), scene, &errorLine)) {
+    char message[64];
+    snprintf(message, sizeof(message), "Scene description error at line %u\n", errorLine);
+    OutputDebugStringA(message);
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  }
+
+  std::vector<uint8_t> data;
+  SerializeSceneFile(scene, data);
+
+  file = CreateFileW(dstPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+
+  DWORD bytesWritten = 0;
+  HRESULT hr = S_OK;
+  if (!WriteFile(file, data.data(), (DWORD)data.size(), &bytesWritten, nullptr) || bytesWritten != data.size())
+    hr = HRESULT_FROM_WIN32(GetLastError());
+  CloseHandle(file);
+  return hr;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <windows.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "sceneFile.h"
+
+// Text form of scene description, one statement per line, '#' starts a comment:
+//   material <name> <shines> <normal path> <diffuse path>...
+//   box <material name> <texture> <spin> <x> <y> <z>
+//   plane <r> <g> <b> <a> <x> <y> <z> <amplitude x> <amplitude y> <amplitude z> <frequency>
+//   light <x> <y> <z> <r> <g> <b>
+//   camera <x> <y> <z> <distance> <phi degrees> <theta degrees>
+// Planes oscillate around their position with given amplitude and frequency (rad/s).
+// Names and paths can't contain spaces, material has to be declared before boxes use it
+class SceneCompiler {
+public:
+  // errorLine gets 1-based number of the first bad line
+  static bool ParseText(const char* text, size_t size, SceneFileData& scene, uint32_t* errorLine = nullptr);
+
+  // Floats are written so that parsing text back gives the same binary file
+  static void WriteText(const SceneFileView& view, std::string& text);
+
+  static HRESULT CompileFile(const wchar_t* srcPath, const wchar_t* dstPath);
+};
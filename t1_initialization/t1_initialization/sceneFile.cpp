@@ -0,0 +1,153 @@
+#include <cstring>
+
+#include "sceneFile.h"
+
+namespace {
+  uint64_t AlignUp(uint64_t value) {
+    return (value + SCENE_FILE_ALIGNMENT - 1) & ~uint64_t(SCENE_FILE_ALIGNMENT - 1);
+  }
+
+  // Block lies inside data and starts at aligned offset, computed in 64 bits so counts can't overflow
+  bool CheckBlock(uint64_t offset, uint64_t count, uint64_t elementSize, size_t dataSize) {
+    if (offset % SCENE_FILE_ALIGNMENT != 0 || offset < sizeof(SceneFileHeader))
+      return false;
+    return offset <= dataSize && count * elementSize <= dataSize - offset;
+  }
+
+  // Element counts and sizes of each block, in SCENE_BLOCK order
+  void GetBlockLayout(const SceneFileHeader& header, uint64_t counts[SCENE_BLOCKS_COUNT], uint64_t sizes[SCENE_BLOCKS_COUNT]) {
+    const uint64_t layout[SCENE_BLOCKS_COUNT][2] = {
+      { header.boxesCount, sizeof(XMFLOAT4) },
+      { header.boxesCount, sizeof(uint32_t) },
+      { header.boxesCount, sizeof(uint32_t) },
+      { header.boxesCount, sizeof(float) },
+      { header.planesCount, sizeof(XMFLOAT4) },
+      { header.planesCount, sizeof(XMFLOAT4) },
+      { header.planesCount, sizeof(XMFLOAT4) },
+      { header.lightsCount, sizeof(XMFLOAT4) },
+      { header.lightsCount, sizeof(XMFLOAT4) },
+      { header.camerasCount, sizeof(XMFLOAT4) },
+      { header.camerasCount, sizeof(XMFLOAT4) },
+      { header.materialsCount, sizeof(SceneMaterial) },
+      { header.diffuseCount, sizeof(uint32_t) },
+      { header.stringsSize, sizeof(char) },
+    };
+    for (int i = 0; i < SCENE_BLOCKS_COUNT; i++) {
+      counts[i] = layout[i][0];
+      sizes[i] = layout[i][1];
+    }
+  }
+
+  template<typename T>
+  void CopyBlock(std::vector<uint8_t>& data, uint64_t offset, const std::vector<T>& src) {
+    if (!src.empty())
+      memcpy(data.data() + offset, src.data(), src.size() * sizeof(T));
+  }
+}
+
+uint32_t SceneFileData::AddString(const std::string& str) {
+  uint32_t offset = (uint32_t)strings.size();
+  strings.append(str);
+  strings.push_back('\0');
+  return offset;
+}
+
+SCENE_PARSE_RESULT ParseSceneFile(const uint8_t* data, size_t size, SceneFileView& view) {
+  view = SceneFileView();
+
+  if (!data || size < sizeof(SceneFileHeader))
+    return SCENE_PARSE_TOO_SMALL;
+
+  auto header = reinterpret_cast<const SceneFileHeader*>(data);
+  if (header->magic != SCENE_FILE_MAGIC)
+    return SCENE_PARSE_BAD_MAGIC;
+  if (header->version != SCENE_FILE_VERSION)
+    return SCENE_PARSE_UNSUPPORTED_VERSION;
+
+  uint64_t counts[SCENE_BLOCKS_COUNT], sizes[SCENE_BLOCKS_COUNT];
+  GetBlockLayout(*header, counts, sizes);
+  for (int i = 0; i < SCENE_BLOCKS_COUNT; i++)
+    if (!CheckBlock(header->offsets[i], counts[i], sizes[i], size))
+      return SCENE_PARSE_BAD_BLOCK;
+
+  SceneFileView result;
+  result.header = header;
+  result.boxPositions = reinterpret_cast<const XMFLOAT4*>(data + header->offsets[SCENE_BLOCK_BOX_POSITION]);
+  result.boxMaterials = reinterpret_cast<const uint32_t*>(data + header->offsets[SCENE_BLOCK_BOX_MATERIAL]);
+  result.boxTextures = reinterpret_cast<const uint32_t*>(data + header->offsets[SCENE_BLOCK_BOX_TEXTURE]);
+  result.boxSpins = reinterpret_cast<const float*>(data + header->offsets[SCENE_BLOCK_BOX_SPIN]);
+  result.planeColors = reinterpret_cast<const XMFLOAT4*>(data + header->offsets[SCENE_BLOCK_PLANE_COLOR]);
+  result.planePositions = reinterpret_cast<const XMFLOAT4*>(data + header->offsets[SCENE_BLOCK_PLANE_POSITION]);
+  result.planeMotions = reinterpret_cast<const XMFLOAT4*>(data + header->offsets[SCENE_BLOCK_PLANE_MOTION]);
+  result.lightPositions = reinterpret_cast<const XMFLOAT4*>(data + header->offsets[SCENE_BLOCK_LIGHT_POSITION]);
+  result.lightColors = reinterpret_cast<const XMFLOAT4*>(data + header->offsets[SCENE_BLOCK_LIGHT_COLOR]);
+  result.cameraTargets = reinterpret_cast<const XMFLOAT4*>(data + header->offsets[SCENE_BLOCK_CAMERA_TARGET]);
+  result.cameraAngles = reinterpret_cast<const XMFLOAT4*>(data + header->offsets[SCENE_BLOCK_CAMERA_ANGLES]);
+  result.materials = reinterpret_cast<const SceneMaterial*>(data + header->offsets[SCENE_BLOCK_MATERIAL]);
+  result.diffusePaths = reinterpret_cast<const uint32_t*>(data + header->offsets[SCENE_BLOCK_DIFFUSE]);
+  result.strings = reinterpret_cast<const char*>(data + header->offsets[SCENE_BLOCK_STRINGS]);
+
+  // Every string offset then points to zero terminated string inside the block
+  if (header->stringsSize > 0 && result.strings[header->stringsSize - 1] != '\0')
+    return SCENE_PARSE_BAD_STRING;
+  for (uint32_t i = 0; i < header->diffuseCount; i++)
+    if (result.diffusePaths[i] >= header->stringsSize)
+      return SCENE_PARSE_BAD_STRING;
+
+  for (uint32_t i = 0; i < header->materialsCount; i++) {
+    const SceneMaterial& material = result.materials[i];
+    if (material.name >= header->stringsSize || material.normalPath >= header->stringsSize)
+      return SCENE_PARSE_BAD_STRING;
+    if ((uint64_t)material.diffuseFirst + material.diffuseCount > header->diffuseCount || material.diffuseCount == 0)
+      return SCENE_PARSE_BAD_REFERENCE;
+  }
+
+  for (uint32_t i = 0; i < header->boxesCount; i++) {
+    uint32_t material = result.boxMaterials[i];
+    if (material >= header->materialsCount || result.boxTextures[i] >= result.materials[material].diffuseCount)
+      return SCENE_PARSE_BAD_REFERENCE;
+  }
+
+  view = result;
+  return SCENE_PARSE_OK;
+}
+
+void SerializeSceneFile(const SceneFileData& scene, std::vector<uint8_t>& data) {
+  SceneFileHeader header = {};
+  header.magic = SCENE_FILE_MAGIC;
+  header.version = SCENE_FILE_VERSION;
+  header.boxesCount = (uint32_t)scene.boxPositions.size();
+  header.planesCount = (uint32_t)scene.planeColors.size();
+  header.lightsCount = (uint32_t)scene.lightPositions.size();
+  header.camerasCount = (uint32_t)scene.cameraTargets.size();
+  header.materialsCount = (uint32_t)scene.materials.size();
+  header.diffuseCount = (uint32_t)scene.diffusePaths.size();
+  header.stringsSize = (uint32_t)scene.strings.size();
+
+  uint64_t counts[SCENE_BLOCKS_COUNT], sizes[SCENE_BLOCKS_COUNT];
+  GetBlockLayout(header, counts, sizes);
+  uint64_t offset = sizeof(SceneFileHeader);
+  for (int i = 0; i < SCENE_BLOCKS_COUNT; i++) {
+    header.offsets[i] = AlignUp(offset);
+    offset = header.offsets[i] + counts[i] * sizes[i];
+  }
+
+  // Padding stays zero
+  data.assign((size_t)offset, 0);
+  memcpy(data.data(), &header, sizeof(header));
+  CopyBlock(data, header.offsets[SCENE_BLOCK_BOX_POSITION], scene.boxPositions);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_BOX_MATERIAL], scene.boxMaterials);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_BOX_TEXTURE], scene.boxTextures);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_BOX_SPIN], scene.boxSpins);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_PLANE_COLOR], scene.planeColors);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_PLANE_POSITION], scene.planePositions);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_PLANE_MOTION], scene.planeMotions);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_LIGHT_POSITION], scene.lightPositions);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_LIGHT_COLOR], scene.lightColors);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_CAMERA_TARGET], scene.cameraTargets);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_CAMERA_ANGLES], scene.cameraAngles);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_MATERIAL], scene.materials);
+  CopyBlock(data, header.offsets[SCENE_BLOCK_DIFFUSE], scene.diffusePaths);
+  if (!scene.strings.empty())
+    memcpy(data.data() + header.offsets[SCENE_BLOCK_STRINGS], scene.strings.data(), scene.strings.size());
+}
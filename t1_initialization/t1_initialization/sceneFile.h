@@ -0,0 +1,136 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// Scene file layout (all values little endian), every array is a separate block (SoA):
+//   SceneFileHeader
+//   XMFLOAT4[boxesCount]      - box positions, w = 1
+//   uint32_t[boxesCount]      - box material
+//   uint32_t[boxesCount]      - box texture (index in material diffuse list)
+//   float[boxesCount]         - box spin speed
+//   XMFLOAT4[planesCount]     - transparent plane colors, w - alpha
+//   XMFLOAT4[planesCount]     - plane center positions, w = 1
+//   XMFLOAT4[planesCount]     - plane oscillation amplitude, w - frequency
+//   XMFLOAT4[lightsCount]     - light positions, w = 1
+//   XMFLOAT4[lightsCount]     - light colors
+//   XMFLOAT4[camerasCount]    - camera point of interest, w - distance to it
+//   XMFLOAT4[camerasCount]    - camera angles: x - phi, y - theta (radians)
+//   SceneMaterial[materialsCount]
+//   uint32_t[diffuseCount]    - diffuse texture paths (offsets in string block)
+//   char[stringsSize]         - zero terminated paths
+// Every block starts at SCENE_FILE_ALIGNMENT boundary, so it can be used right from mapped memory
+#define SCENE_FILE_MAGIC 0x454E4353 // 'SCNE'
+#define SCENE_FILE_VERSION 2
+#define SCENE_FILE_ALIGNMENT 64
+
+struct SceneMaterial {
+  uint32_t name;         // offset in string block, used by text form only
+  uint32_t normalPath;   // offset in string block
+  uint32_t diffuseFirst; // first entry in diffuse block
+  uint32_t diffuseCount;
+  float shines;
+};
+
+enum SCENE_BLOCK {
+  SCENE_BLOCK_BOX_POSITION = 0,
+  SCENE_BLOCK_BOX_MATERIAL,
+  SCENE_BLOCK_BOX_TEXTURE,
+  SCENE_BLOCK_BOX_SPIN,
+  SCENE_BLOCK_PLANE_COLOR,
+  SCENE_BLOCK_PLANE_POSITION,
+  SCENE_BLOCK_PLANE_MOTION,
+  SCENE_BLOCK_LIGHT_POSITION,
+  SCENE_BLOCK_LIGHT_COLOR,
+  SCENE_BLOCK_CAMERA_TARGET,
+  SCENE_BLOCK_CAMERA_ANGLES,
+  SCENE_BLOCK_MATERIAL,
+  SCENE_BLOCK_DIFFUSE,
+  SCENE_BLOCK_STRINGS,
+  SCENE_BLOCKS_COUNT
+};
+
+struct SceneFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t boxesCount;
+  uint32_t planesCount;
+  uint32_t lightsCount;
+  uint32_t camerasCount;
+  uint32_t materialsCount;
+  uint32_t diffuseCount;
+  uint32_t stringsSize;
+  uint32_t reserved;
+  uint64_t offsets[SCENE_BLOCKS_COUNT];
+};
+
+// Parsed file, all pointers go into source data
+struct SceneFileView {
+  const SceneFileHeader* header = nullptr;
+
+  const XMFLOAT4* boxPositions = nullptr;
+  const uint32_t* boxMaterials = nullptr;
+  const uint32_t* boxTextures = nullptr;
+  const float* boxSpins = nullptr;
+
+  const XMFLOAT4* planeColors = nullptr;
+  const XMFLOAT4* planePositions = nullptr;
+  const XMFLOAT4* planeMotions = nullptr;
+
+  const XMFLOAT4* lightPositions = nullptr;
+  const XMFLOAT4* lightColors = nullptr;
+
+  const XMFLOAT4* cameraTargets = nullptr;
+  const XMFLOAT4* cameraAngles = nullptr;
+
+  const SceneMaterial* materials = nullptr;
+  const uint32_t* diffusePaths = nullptr;
+  const char* strings = nullptr;
+
+  const char* GetString(uint32_t offset) const { return strings + offset; };
+};
+
+enum SCENE_PARSE_RESULT {
+  SCENE_PARSE_OK = 0,
+  SCENE_PARSE_TOO_SMALL,
+  SCENE_PARSE_BAD_MAGIC,
+  SCENE_PARSE_UNSUPPORTED_VERSION,
+  SCENE_PARSE_BAD_BLOCK,        // block out of data or misaligned
+  SCENE_PARSE_BAD_STRING,       // string offset out of block or block not terminated
+  SCENE_PARSE_BAD_REFERENCE     // material / texture / diffuse index out of range
+};
+
+// Device free validation of whole file, single pass over its data
+SCENE_PARSE_RESULT ParseSceneFile(const uint8_t* data, size_t size, SceneFileView& view);
+
+// Scene ready to be stored, arrays of one object kind have the same size
+struct SceneFileData {
+  std::vector<XMFLOAT4> boxPositions;
+  std::vector<uint32_t> boxMaterials;
+  std::vector<uint32_t> boxTextures;
+  std::vector<float> boxSpins;
+
+  std::vector<XMFLOAT4> planeColors;
+  std::vector<XMFLOAT4> planePositions;
+  std::vector<XMFLOAT4> planeMotions;
+
+  std::vector<XMFLOAT4> lightPositions;
+  std::vector<XMFLOAT4> lightColors;
+
+  std::vector<XMFLOAT4> cameraTargets;
+  std::vector<XMFLOAT4> cameraAngles;
+
+  std::vector<SceneMaterial> materials;
+  std::vector<uint32_t> diffusePaths;
+  std::string strings;  // zero terminated paths one after another
+
+  // Adds zero terminated string, returns its offset
+  uint32_t AddString(const std::string& str);
+};
+
+void SerializeSceneFile(const SceneFileData& scene, std::vector<uint8_t>& data);
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#include "sceneGenerator.h"
+#include "threadPool.h"
+
+namespace {
+  // Separate streams keep object kinds independent of each other's counts
+  const uint64_t STREAM_BOXES = 1;
+  const uint64_t STREAM_LIGHTS = 2;
+  const uint64_t STREAM_CLUSTERS = 3;
+
+  // Every box takes the same number of draws whatever the layout, so box i starts at i * BOX_DRAWS
+  const uint32_t BOX_LAYOUT_DRAWS = 10;
+  const uint32_t BOX_DRAWS = BOX_LAYOUT_DRAWS + 2;
+  const uint32_t LIGHT_DRAWS = 6;
+
+  // Coordinates are integers in 1/FIXED_SCALE units, float conversion is exact.
+  // No float multiply-add is left, so FMA contraction can't change the result between compilers
+  const int32_t FIXED_SCALE = 256;
+  const float FIXED_TO_FLOAT = 1.0f / FIXED_SCALE;
+
+  const uint32_t BOXES_PER_JOB = 16384;
+
+  const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+  struct Preset {
+    const char* name;
+    uint32_t boxesCount;
+    uint32_t lightsCount;
+    SCENE_LAYOUT layout;
+    uint32_t occluderLayers;
+    float size;
+    float cameraDistance;
+  };
+
+  // Size grows with cube root of count, so density stays about the same
+  const Preset PRESETS[] = {
+    { "default",        15,      30,    SCENE_LAYOUT_UNIFORM,   0,  8.0f,   1.6f },
+    { "uniform-1k",     1000,    30,    SCENE_LAYOUT_UNIFORM,   0,  24.0f,  30.0f },
+    { "uniform-100k",   100000,  1000,  SCENE_LAYOUT_UNIFORM,   0,  110.0f, 140.0f },
+    { "uniform-1m",     1000000, 10000, SCENE_LAYOUT_UNIFORM,   0,  240.0f, 300.0f },
+    { "clustered-1k",   1000,    30,    SCENE_LAYOUT_CLUSTERED, 0,  24.0f,  30.0f },
+    { "clustered-100k", 100000,  1000,  SCENE_LAYOUT_CLUSTERED, 0,  110.0f, 140.0f },
+    { "clustered-1m",   1000000, 10000, SCENE_LAYOUT_CLUSTERED, 0,  240.0f, 300.0f },
+    { "corridor-1k",    1000,    30,    SCENE_LAYOUT_CORRIDOR,  0,  24.0f,  30.0f },
+    { "corridor-100k",  100000,  1000,  SCENE_LAYOUT_CORRIDOR,  0,  110.0f, 140.0f },
+    { "corridor-1m",    1000000, 10000, SCENE_LAYOUT_CORRIDOR,  0,  240.0f, 300.0f },
+    { "occluded-100k",  100000,  1000,  SCENE_LAYOUT_UNIFORM,   4,  110.0f, 140.0f },
+    { "occluded-1m",    1000000, 10000, SCENE_LAYOUT_UNIFORM,   16, 240.0f, 300.0f },
+  };
+  const uint32_t PRESETS_COUNT = sizeof(PRESETS) / sizeof(PRESETS[0]);
+
+  // Material of generated scenes, same textures as default scene
+  const char* GEN_MATERIAL_NAME = "bricks";
+  const char* GEN_NORMAL_PATH = "./src/245_norm.dds";
+  const char* GEN_DIFFUSE_PATHS[] = { "./src/245.dds", "./src/hah.dds" };
+  const float GEN_SHINES = 256.0f;
+
+  // Transparent planes of generated scenes move along z around these positions, w of motion - frequency
+  const XMFLOAT4 GEN_PLANE_COLORS[] = {
+    XMFLOAT4(1.0f, 1.0f, 1.0f, 0.45f),
+    XMFLOAT4(1.0f, 1.0f, 1.0f, 0.67f),
+    XMFLOAT4(0.0f, 0.0f, 1.0f, 0.75f),
+  };
+  const XMFLOAT4 GEN_PLANE_POSITIONS[] = {
+    XMFLOAT4(1.25f, 0.0f, 0.0f, 1.0f),
+    XMFLOAT4(-1.25f, 0.0f, 0.0f, 1.0f),
+    XMFLOAT4(2.5f, 0.0f, -1.25f, 1.0f),
+  };
+  const XMFLOAT4 GEN_PLANE_MOTIONS[] = {
+    XMFLOAT4(0.0f, 0.0f, -2.0f, 2.0f),
+    XMFLOAT4(0.0f, 0.0f, 2.0f, 2.0f),
+    XMFLOAT4(0.0f, 0.0f, 0.0f, 2.0f),
+  };
+
+  inline int32_t ToFixed(float value) {
+    return (int32_t)(value * FIXED_SCALE);
+  }
+
+  // Same mapping as Pcg32::NextBounded for already drawn value
+  inline int32_t Bounded(uint32_t draw, int32_t bound) {
+    return (int32_t)(((uint64_t)draw * (uint32_t)(std::max)(bound, 1)) >> 32);
+  }
+
+  inline XMFLOAT4 FromFixed(int32_t x, int32_t y, int32_t z) {
+    return XMFLOAT4(x * FIXED_TO_FLOAT, y * FIXED_TO_FLOAT, z * FIXED_TO_FLOAT, 1.0f);
+  }
+
+  // Wall grid cell of occluder box, walls are spread evenly across z
+  XMFLOAT4 OccluderPosition(const SceneGenParams& params, uint32_t index, uint32_t occludersCount) {
+    uint32_t perLayer = (occludersCount + params.occluderLayers - 1) / params.occluderLayers;
+    uint32_t side = 1;
+    while (side * side < perLayer)
+      side++;
+    uint32_t layer = index / perLayer;
+    uint32_t cell = index % perLayer;
+
+    int32_t size = ToFixed(params.size);
+    int32_t spacing = size / (int32_t)side;
+    int32_t layerSpacing = size / (int32_t)params.occluderLayers;
+    return FromFixed(
+      (int32_t)(cell % side) * spacing + spacing / 2 - size / 2,
+      (int32_t)(cell / side) * spacing + spacing / 2 - size / 2,
+      (int32_t)layer * layerSpacing + layerSpacing / 2 - size / 2);
+  }
+
+  XMFLOAT4 LayoutPosition(const SceneGenParams& params, const uint32_t* r, const std::vector<XMINT3>& clusters) {
+    int32_t size = ToFixed(params.size);
+    switch (params.layout) {
+    case SCENE_LAYOUT_CLUSTERED: {
+      // Sum of three uniforms is close to normal, with no rejection or transcendental functions
+      const XMINT3& center = clusters[Bounded(r[0], (int32_t)clusters.size())];
+      int32_t radius = ToFixed(params.clusterRadius);
+      return FromFixed(
+        center.x + Bounded(r[1], radius) + Bounded(r[2], radius) + Bounded(r[3], radius) - radius * 3 / 2,
+        center.y + Bounded(r[4], radius) + Bounded(r[5], radius) + Bounded(r[6], radius) - radius * 3 / 2,
+        center.z + Bounded(r[7], radius) + Bounded(r[8], radius) + Bounded(r[9], radius) - radius * 3 / 2);
+    }
+    case SCENE_LAYOUT_CORRIDOR: {
+      // Boxes stand on both sides of corridors, walls are about one box thick
+      int32_t corridors = (int32_t)(std::max)(params.corridorsCount, 1u);
+      int32_t spacing = size / corridors;
+      int32_t center = Bounded(r[0], corridors) * spacing + spacing / 2 - size / 2;
+      int32_t width = ToFixed(params.corridorWidth);
+      int32_t side = (r[2] & 0x80000000u) ? -1 : 1;
+      return FromFixed(
+        Bounded(r[1], size) - size / 2,
+        Bounded(r[3], width * 2) - width,
+        center + side * (width / 2 + Bounded(r[4], FIXED_SCALE)));
+    }
+    default:
+      return FromFixed(Bounded(r[0], size) - size / 2, Bounded(r[1], size) - size / 2, Bounded(r[2], size) - size / 2);
+    }
+  }
+}
+
+Pcg32::Pcg32(uint64_t seed, uint64_t stream) {
+  increment = (stream << 1u) | 1u;
+  Next();
+  state += seed;
+  Next();
+}
+
+uint32_t Pcg32::Next() {
+  uint64_t old = state;
+  state = old * 6364136223846793005ull + increment;
+  uint32_t xorShifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+  uint32_t rot = (uint32_t)(old >> 59u);
+  return (xorShifted >> rot) | (xorShifted << ((32u - rot) & 31u));
+}
+
+uint32_t Pcg32::NextBounded(uint32_t bound) {
+  return (uint32_t)(((uint64_t)Next() * bound) >> 32);
+}
+
+void Pcg32::Advance(uint64_t delta) {
+  // LCG jump: compose multiplier and increment by squaring (Brown, "Random number generation with arbitrary strides")
+  uint64_t curMult = 6364136223846793005ull;
+  uint64_t curPlus = increment;
+  uint64_t accMult = 1;
+  uint64_t accPlus = 0;
+  while (delta > 0) {
+    if (delta & 1) {
+      accMult *= curMult;
+      accPlus = accPlus * curMult + curPlus;
+    }
+    curPlus = (curMult + 1) * curPlus;
+    curMult *= curMult;
+    delta >>= 1;
+  }
+  state = accMult * state + accPlus;
+}
+
+uint32_t SceneGenerator::GetPresetsCount() {
+  return PRESETS_COUNT;
+}
+
+const char* SceneGenerator::GetPresetName(uint32_t index) {
+  return index < PRESETS_COUNT ? PRESETS[index].name : nullptr;
+}
+
+bool SceneGenerator::GetPreset(const char* name, uint64_t seed, SceneGenParams& params) {
+  for (uint32_t i = 0; i < PRESETS_COUNT; i++) {
+    const Preset& preset = PRESETS[i];
+    if (strcmp(preset.name, name) != 0)
+      continue;
+
+    params = SceneGenParams();
+    params.seed = seed;
+    params.boxesCount = preset.boxesCount;
+    params.lightsCount = preset.lightsCount;
+    params.layout = preset.layout;
+    params.occluderLayers = preset.occluderLayers;
+    params.size = preset.size;
+    params.cameraDistance = preset.cameraDistance;
+    params.clustersCount = (std::max)(preset.boxesCount / 2000, 8u);
+    params.clusterRadius = preset.size / 32.0f;
+    params.corridorsCount = (std::max)((uint32_t)(preset.size / 12.0f), 1u);
+    params.corridorWidth = 4.0f;
+    params.texturesCount = sizeof(GEN_DIFFUSE_PATHS) / sizeof(GEN_DIFFUSE_PATHS[0]);
+    return true;
+  }
+  return false;
+}
+
+void SceneGenerator::GenerateBoxes(const SceneGenParams& params, uint32_t first, uint32_t count,
+  XMFLOAT4* positions, uint32_t* textures, float* spins) {
+  std::vector<XMINT3> clusters;
+  if (params.layout == SCENE_LAYOUT_CLUSTERED) {
+    // Whole cluster stays inside scene cube
+    int32_t extent = ToFixed(params.size) - ToFixed(params.clusterRadius) * 3;
+    Pcg32 clusterRng(params.seed, STREAM_CLUSTERS);
+    clusters.resize((std::max)(params.clustersCount, 1u));
+    for (auto& center : clusters) {
+      center.x = (int32_t)clusterRng.NextBounded(extent) - extent / 2;
+      center.y = (int32_t)clusterRng.NextBounded(extent) - extent / 2;
+      center.z = (int32_t)clusterRng.NextBounded(extent) - extent / 2;
+    }
+  }
+
+  uint32_t occludersCount = params.occluderLayers > 0 ? params.boxesCount / 2 : 0;
+
+  Pcg32 rng(params.seed, STREAM_BOXES);
+  rng.Advance((uint64_t)first * BOX_DRAWS);
+  for (uint32_t i = first; i < first + count; i++) {
+    uint32_t r[BOX_LAYOUT_DRAWS];
+    for (uint32_t j = 0; j < BOX_LAYOUT_DRAWS; j++)
+      r[j] = rng.Next();
+
+    positions[i] = i < occludersCount ? OccluderPosition(params, i, occludersCount) : LayoutPosition(params, r, clusters);
+    textures[i] = rng.NextBounded((std::max)(params.texturesCount, 1u));
+    spins[i] = (float)((int)rng.NextBounded(10) - 5);
+  }
+}
+
+void SceneGenerator::GenerateLights(const SceneGenParams& params, uint32_t first, uint32_t count,
+  XMFLOAT4* positions, XMFLOAT4* colors) {
+  int32_t size = ToFixed(params.size);
+  Pcg32 rng(params.seed, STREAM_LIGHTS);
+  rng.Advance((uint64_t)first * LIGHT_DRAWS);
+  for (uint32_t i = first; i < first + count; i++) {
+    int32_t x = (int32_t)rng.NextBounded(size) - size / 2;
+    int32_t y = (int32_t)rng.NextBounded(size) - size / 2;
+    int32_t z = (int32_t)rng.NextBounded(size) - size / 2;
+    positions[i] = FromFixed(x, y, z);
+
+    // Color channels in [0.5, 1) with 8 bits of precision
+    int32_t r = FIXED_SCALE / 2 + (int32_t)rng.NextBounded(FIXED_SCALE / 2);
+    int32_t g = FIXED_SCALE / 2 + (int32_t)rng.NextBounded(FIXED_SCALE / 2);
+    int32_t b = FIXED_SCALE / 2 + (int32_t)rng.NextBounded(FIXED_SCALE / 2);
+    colors[i] = FromFixed(r, g, b);
+  }
+}
+
+void SceneGenerator::Generate(const SceneGenParams& params, SceneFileData& scene) {
+  scene = SceneFileData();
+
+  uint32_t texturesCount = (std::max)(params.texturesCount, 1u);
+  SceneMaterial material = {};
+  material.name = scene.AddString(GEN_MATERIAL_NAME);
+  material.normalPath = scene.AddString(GEN_NORMAL_PATH);
+  material.diffuseFirst = 0;
+  material.diffuseCount = texturesCount;
+  material.shines = GEN_SHINES;
+  for (uint32_t i = 0; i < texturesCount; i++)
+    scene.diffusePaths.push_back(scene.AddString(GEN_DIFFUSE_PATHS[i % (sizeof(GEN_DIFFUSE_PATHS) / sizeof(GEN_DIFFUSE_PATHS[0]))]));
+  scene.materials.push_back(material);
+
+  scene.boxPositions.resize(params.boxesCount);
+  scene.boxMaterials.assign(params.boxesCount, 0);
+  scene.boxTextures.resize(params.boxesCount);
+  scene.boxSpins.resize(params.boxesCount);
+  ThreadPool::GetInstance().ParallelFor(params.boxesCount, BOXES_PER_JOB, [&](uint32_t begin, uint32_t end) {
+    GenerateBoxes(params, begin, end - begin, scene.boxPositions.data(), scene.boxTextures.data(), scene.boxSpins.data());
+  });
+
+  scene.lightPositions.resize(params.lightsCount);
+  scene.lightColors.resize(params.lightsCount);
+  GenerateLights(params, 0, params.lightsCount, scene.lightPositions.data(), scene.lightColors.data());
+
+  scene.planeColors.assign(std::begin(GEN_PLANE_COLORS), std::end(GEN_PLANE_COLORS));
+  scene.planePositions.assign(std::begin(GEN_PLANE_POSITIONS), std::end(GEN_PLANE_POSITIONS));
+  scene.planeMotions.assign(std::begin(GEN_PLANE_MOTIONS), std::end(GEN_PLANE_MOTIONS));
+
+  scene.cameraTargets.push_back(XMFLOAT4(0.0f, 0.0f, 0.0f, params.cameraDistance));
+  scene.cameraAngles.push_back(XMFLOAT4((float)(120.0 * DEG_TO_RAD), (float)(15.0 * DEG_TO_RAD), 0.0f, 0.0f));
+}
+
+HRESULT SceneGenerator::GenerateFile(const SceneGenParams& params, const wchar_t* dstPath) {
+  SceneFileData scene;
+  Generate(params, scene);
+
+  std::vector<uint8_t> data;
+  SerializeSceneFile(scene, data);
+
+  HANDLE file = CreateFileW(dstPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+
+  DWORD bytesWritten = 0;
+  HRESULT hr = S_OK;
+  if (!WriteFile(file, data.data(), (DWORD)data.size(), &bytesWritten, nullptr) || bytesWritten != data.size())
+    hr = HRESULT_FROM_WIN32(GetLastError());
+  CloseHandle(file);
+  return hr;
+}
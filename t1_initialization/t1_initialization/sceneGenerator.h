@@ -0,0 +1,73 @@
+#pragma once
+
+#include <windows.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "sceneFile.h"
+
+// PCG32 (XSH RR 64/32). Integer only, so sequence is the same on every platform.
+// Advance jumps over any number of draws in O(log n), objects are generated independently by index
+class Pcg32 {
+public:
+  Pcg32(uint64_t seed, uint64_t stream);
+
+  uint32_t Next();
+
+  // [0, bound) by multiply-shift, always one draw
+  uint32_t NextBounded(uint32_t bound);
+
+  void Advance(uint64_t delta);
+private:
+  uint64_t state = 0;
+  uint64_t increment = 0;
+};
+
+enum SCENE_LAYOUT {
+  SCENE_LAYOUT_UNIFORM = 0,  // boxes fill whole cube
+  SCENE_LAYOUT_CLUSTERED,    // boxes around random cluster centers
+  SCENE_LAYOUT_CORRIDOR      // boxes build walls of parallel corridors along x
+};
+
+struct SceneGenParams {
+  uint64_t seed = 0;
+  uint32_t boxesCount = 0;
+  uint32_t lightsCount = 0;
+  SCENE_LAYOUT layout = SCENE_LAYOUT_UNIFORM;
+
+  // First half of boxes builds this many walls across z axis, 0 - no occluders
+  uint32_t occluderLayers = 0;
+
+  float size = 8.0f;            // scene cube edge
+  float cameraDistance = 1.6f;  // camera orbit around scene center
+
+  uint32_t clustersCount = 1;
+  float clusterRadius = 1.0f;
+
+  uint32_t corridorsCount = 1;
+  float corridorWidth = 4.0f;
+
+  uint32_t texturesCount = 2;   // diffuse textures of generated material
+};
+
+// Benchmark scenes from seed and preset. Objects of each kind use their own PCG stream,
+// so changing lights count doesn't move boxes and any range of boxes can be generated alone.
+class SceneGenerator {
+public:
+  // Preset names look like "uniform-100k", "default" matches counts renderer supports
+  static uint32_t GetPresetsCount();
+  static const char* GetPresetName(uint32_t index);
+  static bool GetPreset(const char* name, uint64_t seed, SceneGenParams& params);
+
+  // Boxes [first, first + count) written to the same indices of output arrays
+  static void GenerateBoxes(const SceneGenParams& params, uint32_t first, uint32_t count,
+    XMFLOAT4* positions, uint32_t* textures, float* spins);
+
+  static void GenerateLights(const SceneGenParams& params, uint32_t first, uint32_t count,
+    XMFLOAT4* positions, XMFLOAT4* colors);
+
+  // Whole scene with one material, boxes are generated on thread pool
+  static void Generate(const SceneGenParams& params, SceneFileData& scene);
+
+  static HRESULT GenerateFile(const SceneGenParams& params, const wchar_t* dstPath);
+};
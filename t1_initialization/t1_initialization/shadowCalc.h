@@ -0,0 +1,76 @@
+#include "constants.h"
+
+cbuffer ShadowCB : register (b4)
+{
+  float4x4 cascadeViewProjection[SHADOW_CASCADES_COUNT];
+  float4 cascadeSplits;   // far view depth of each cascade
+  float4 cascadeTexel;    // world texel size of each cascade
+  float4 cameraForward;   // view depth = dot(pos, xyz) + w
+  float4 sunDirection;    // direction light goes
+  float4 sunColor;
+  float4 shadowParams;    // x - cube near plane, y - cascade bias, z - cube bias, w - normal offset in texels
+  int4 lightSlot[MAX_LIGHT_SOURCES];            // x - cube map of light, -1 - no shadow
+  float4 slotParams[SHADOW_MAX_POINT_LIGHTS];   // xyz - light position, w - far plane
+};
+
+Texture2DArray<float> cascadeMaps : register (t2);
+TextureCubeArray<float> cubeMaps : register (t3);
+SamplerComparisonState shadowSampler : register (s1);
+
+float CascadeShadow(float3 pos, float3 normal)
+{
+  float depth = dot(pos, cameraForward.xyz) + cameraForward.w;
+  if (depth > cascadeSplits[SHADOW_CASCADES_COUNT - 1])
+    return 1.0;
+
+  int cascade = 0;
+  [unroll]
+  for (int c = 0; c < SHADOW_CASCADES_COUNT - 1; c++)
+    cascade += depth > cascadeSplits[c] ? 1 : 0;
+
+  // Offset along normal by texel size keeps lit surfaces off their own depth
+  float3 offsetPos = pos + normal * cascadeTexel[cascade] * shadowParams.w;
+  float4 clip = mul(cascadeViewProjection[cascade], float4(offsetPos, 1.0f));
+  float2 uv = clip.xy * float2(0.5f, -0.5f) + 0.5f;
+  if (any(uv < 0.0f) || any(uv > 1.0f) || clip.z > 1.0f)
+    return 1.0;
+
+  // 3x3 PCF
+  float lit = 0.0;
+  [unroll]
+  for (int y = -1; y <= 1; y++) {
+    [unroll]
+    for (int x = -1; x <= 1; x++)
+      lit += cascadeMaps.SampleCmpLevelZero(shadowSampler, float3(uv, cascade), clip.z - shadowParams.y, int2(x, y));
+  }
+  return lit / 9.0;
+}
+
+float PointShadow(int light, float3 pos, float3 normal)
+{
+  int slot = lightSlot[light].x;
+  if (slot < 0)
+    return 1.0;
+
+  // Cube face depth comes from distance along major axis of direction from light
+  float3 dir = pos + normal * 0.02f - slotParams[slot].xyz;
+  float3 absDir = abs(dir);
+  float major = max(absDir.x, max(absDir.y, absDir.z));
+  float nearZ = shadowParams.x, farZ = slotParams[slot].w;
+  if (major >= farZ)
+    return 1.0;
+
+  float depth = farZ / (farZ - nearZ) - farZ * nearZ / ((farZ - nearZ) * major);
+  return cubeMaps.SampleCmpLevelZero(shadowSampler, float4(dir, slot), depth - shadowParams.z);
+}
+
+float3 CalculateSunColor(in float3 objColor, in float3 objNormal, in float3 pos)
+{
+  float diffuse = max(dot(-sunDirection.xyz, objNormal), 0.0);
+  if (diffuse <= 0.0)
+    return float3(0, 0, 0);
+  return objColor * diffuse * sunColor.xyz * CascadeShadow(pos, objNormal);
+}
+
+// Point lights in CalculateColor are shadowed too
+#define LIGHT_VISIBILITY(i, pos, normal) PointShadow(i, pos, normal)
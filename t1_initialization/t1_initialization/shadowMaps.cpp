@@ -0,0 +1,252 @@
+#include <algorithm>
+
+#include "shadowMaps.h"
+
+HRESULT ShadowMaps::Init(ID3D11Device* device) {
+  // Cascades, array slice per cascade
+  D3D11_TEXTURE2D_DESC desc = {};
+  desc.Width = SHADOW_MAP_SIZE;
+  desc.Height = SHADOW_MAP_SIZE;
+  desc.MipLevels = 1;
+  desc.ArraySize = SHADOW_CASCADES_COUNT;
+  desc.Format = DXGI_FORMAT_R32_TYPELESS;
+  desc.SampleDesc.Count = 1;
+  desc.SampleDesc.Quality = 0;
+  desc.Usage = D3D11_USAGE_DEFAULT;
+  desc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+  desc.CPUAccessFlags = 0;
+  desc.MiscFlags = 0;
+
+  HRESULT hr = device->CreateTexture2D(&desc, nullptr, &g_pCascadeTexture);
+  if (FAILED(hr))
+    return hr;
+
+  D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+  dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+  dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+  dsvDesc.Texture2DArray.MipSlice = 0;
+  dsvDesc.Texture2DArray.ArraySize = 1;
+  for (UINT c = 0; c < SHADOW_CASCADES_COUNT; c++) {
+    dsvDesc.Texture2DArray.FirstArraySlice = c;
+    hr = device->CreateDepthStencilView(g_pCascadeTexture, &dsvDesc, &g_pCascadeDSV[c]);
+    if (FAILED(hr))
+      return hr;
+  }
+
+  D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+  srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+  srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+  srvDesc.Texture2DArray.MostDetailedMip = 0;
+  srvDesc.Texture2DArray.MipLevels = 1;
+  srvDesc.Texture2DArray.FirstArraySlice = 0;
+  srvDesc.Texture2DArray.ArraySize = SHADOW_CASCADES_COUNT;
+
+  hr = device->CreateShaderResourceView(g_pCascadeTexture, &srvDesc, &g_pCascadeSRV);
+  if (FAILED(hr))
+    return hr;
+
+  // Point light cubes, six slices per cube in D3D face order
+  desc.Width = SHADOW_CUBE_SIZE;
+  desc.Height = SHADOW_CUBE_SIZE;
+  desc.ArraySize = SHADOW_MAX_POINT_LIGHTS * 6;
+  desc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+  hr = device->CreateTexture2D(&desc, nullptr, &g_pCubeTexture);
+  if (FAILED(hr))
+    return hr;
+
+  for (UINT f = 0; f < SHADOW_MAX_POINT_LIGHTS * 6; f++) {
+    dsvDesc.Texture2DArray.FirstArraySlice = f;
+    hr = device->CreateDepthStencilView(g_pCubeTexture, &dsvDesc, &g_pCubeDSV[f]);
+    if (FAILED(hr))
+      return hr;
+  }
+
+  srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+  srvDesc.TextureCubeArray.MostDetailedMip = 0;
+  srvDesc.TextureCubeArray.MipLevels = 1;
+  srvDesc.TextureCubeArray.First2DArrayFace = 0;
+  srvDesc.TextureCubeArray.NumCubes = SHADOW_MAX_POINT_LIGHTS;
+
+  hr = device->CreateShaderResourceView(g_pCubeTexture, &srvDesc, &g_pCubeSRV);
+  if (FAILED(hr))
+    return hr;
+
+  D3D11_BUFFER_DESC descSB = {};
+  descSB.ByteWidth = sizeof(ShadowCB);
+  descSB.Usage = D3D11_USAGE_DYNAMIC;
+  descSB.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+  descSB.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+  descSB.MiscFlags = 0;
+  descSB.StructureByteStride = 0;
+
+  hr = device->CreateBuffer(&descSB, nullptr, &g_pShadowBuffer);
+  if (FAILED(hr))
+    return hr;
+
+  // Outside of maps is lit
+  D3D11_SAMPLER_DESC descSmplr = {};
+  descSmplr.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+  descSmplr.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+  descSmplr.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+  descSmplr.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+  descSmplr.MinLOD = 0.0f;
+  descSmplr.MaxLOD = D3D11_FLOAT32_MAX;
+  descSmplr.MipLODBias = 0.0f;
+  descSmplr.MaxAnisotropy = 1;
+  descSmplr.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+  descSmplr.BorderColor[0] =
+    descSmplr.BorderColor[1] =
+    descSmplr.BorderColor[2] =
+    descSmplr.BorderColor[3] = 1.0f;
+
+  hr = device->CreateSamplerState(&descSmplr, &g_pSamplerState);
+  if (FAILED(hr))
+    return hr;
+
+  // Casters closer to light than cascade near plane are clamped to it instead of clipped
+  D3D11_RASTERIZER_DESC descRastr = {};
+  descRastr.FillMode = D3D11_FILL_SOLID;
+  descRastr.CullMode = D3D11_CULL_BACK;
+  descRastr.FrontCounterClockwise = false;
+  descRastr.DepthBias = SHADOW_DEPTH_BIAS;
+  descRastr.SlopeScaledDepthBias = SHADOW_SLOPE_BIAS;
+  descRastr.DepthBiasClamp = 0.0f;
+  descRastr.DepthClipEnable = false;
+  descRastr.ScissorEnable = false;
+  descRastr.MultisampleEnable = false;
+  descRastr.AntialiasedLineEnable = false;
+
+  hr = device->CreateRasterizerState(&descRastr, &g_pRasterizerState);
+  if (FAILED(hr))
+    return hr;
+
+  // Shadow maps have regular depth, 1 is far
+  D3D11_DEPTH_STENCIL_DESC dsDesc = {};
+  dsDesc.DepthEnable = TRUE;
+  dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+  dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
+  dsDesc.StencilEnable = FALSE;
+
+  return device->CreateDepthStencilState(&dsDesc, &g_pDepthState);
+}
+
+void ShadowMaps::Realese() {
+  for (auto& dsv : g_pCascadeDSV)
+    if (dsv) dsv->Release();
+  for (auto& dsv : g_pCubeDSV)
+    if (dsv) dsv->Release();
+
+  if (g_pCascadeSRV) g_pCascadeSRV->Release();
+  if (g_pCascadeTexture) g_pCascadeTexture->Release();
+  if (g_pCubeSRV) g_pCubeSRV->Release();
+  if (g_pCubeTexture) g_pCubeTexture->Release();
+
+  if (g_pShadowBuffer) g_pShadowBuffer->Release();
+  if (g_pSamplerState) g_pSamplerState->Release();
+  if (g_pRasterizerState) g_pRasterizerState->Release();
+  if (g_pDepthState) g_pDepthState->Release();
+}
+
+bool ShadowMaps::Frame(ID3D11DeviceContext* context, const ShadowPlanner& planner, const CameraState& camera, uint32_t lightsCount) {
+  D3D11_MAPPED_SUBRESOURCE subresource;
+  HRESULT hr = context->Map(g_pShadowBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource);
+  if (FAILED(hr))
+    return false;
+
+  ShadowCB& shadowBuffer = *reinterpret_cast<ShadowCB*>(subresource.pData);
+  float splits[SHADOW_CASCADES_COUNT], texels[SHADOW_CASCADES_COUNT];
+  for (uint32_t c = 0; c < SHADOW_CASCADES_COUNT; c++) {
+    const ShadowCascade& cascade = planner.GetCascade(c);
+    shadowBuffer.cascadeViewProjection[c] = cascade.viewProjection;
+    splits[c] = cascade.splitFar;
+    texels[c] = cascade.texelSize;
+  }
+  shadowBuffer.cascadeSplits = XMFLOAT4(splits);
+  shadowBuffer.cascadeTexel = XMFLOAT4(texels);
+
+  // View depth from world position: camera forward is third row of inverse view
+  XMVECTOR forward = XMVector3Normalize(camera.GetInverseView().r[2]);
+  XMStoreFloat4(&shadowBuffer.cameraForward, XMVectorSetW(forward, -XMVectorGetX(XMVector3Dot(forward, XMLoadFloat3(&camera.GetPosition())))));
+
+  XMFLOAT3 sunDirection = SHADOW_SUN_DIRECTION;
+  XMStoreFloat4(&shadowBuffer.sunDirection, XMVector3Normalize(XMLoadFloat3(&sunDirection)));
+  shadowBuffer.sunColor = SHADOW_SUN_COLOR;
+  shadowBuffer.shadowParams = XMFLOAT4(SHADOW_CUBE_NEAR, SHADOW_CASCADE_BIAS, SHADOW_CUBE_BIAS, SHADOW_NORMAL_OFFSET);
+
+  for (uint32_t i = 0; i < MAX_LIGHT_SOURCES; i++)
+    shadowBuffer.lightSlot[i] = XMINT4(-1, 0, 0, 0);
+  for (uint32_t s = 0; s < SHADOW_MAX_POINT_LIGHTS; s++) {
+    const ShadowCubeSlot& slot = planner.GetSlot(s);
+    shadowBuffer.slotParams[s] = XMFLOAT4(slot.position.x, slot.position.y, slot.position.z, slot.range);
+    if (slot.light >= 0 && (uint32_t)slot.light < (std::min)(lightsCount, (uint32_t)MAX_LIGHT_SOURCES))
+      shadowBuffer.lightSlot[slot.light] = XMINT4((int)s, 0, 0, 0);
+  }
+
+  context->Unmap(g_pShadowBuffer, 0);
+  return true;
+}
+
+void ShadowMaps::Render(ID3D11DeviceContext* context, const ShadowPlanner& planner, Box& box) {
+  // All views go to box depth buffers at once, in planner views order
+  XMMATRIX viewProjections[SHADOW_VIEWS_COUNT];
+  for (uint32_t c = 0; c < SHADOW_CASCADES_COUNT; c++)
+    viewProjections[c] = planner.GetCascade(c).viewProjection;
+  for (uint32_t s = 0; s < SHADOW_MAX_POINT_LIGHTS; s++)
+    for (uint32_t f = 0; f < 6; f++)
+      viewProjections[SHADOW_CASCADES_COUNT + s * 6 + f] = planner.GetSlot(s).faceViewProjection[f];
+  if (!box.UploadDepthViews(context, viewProjections, SHADOW_VIEWS_COUNT))
+    return;
+
+  // Maps are written below, they can't stay bound for sampling
+  ID3D11ShaderResourceView* nullResources[] = { nullptr, nullptr };
+  context->PSSetShaderResources(2, 2, nullResources);
+
+  context->OMSetDepthStencilState(g_pDepthState, 0);
+  context->RSSetState(g_pRasterizerState);
+
+  D3D11_VIEWPORT viewport;
+  viewport.TopLeftX = 0;
+  viewport.TopLeftY = 0;
+  viewport.Width = (FLOAT)SHADOW_MAP_SIZE;
+  viewport.Height = (FLOAT)SHADOW_MAP_SIZE;
+  viewport.MinDepth = 0.0f;
+  viewport.MaxDepth = 1.0f;
+  context->RSSetViewports(1, &viewport);
+
+  for (uint32_t c = 0; c < SHADOW_CASCADES_COUNT; c++) {
+    if (!planner.IsCascadeUpdated(c))
+      continue;
+    context->OMSetRenderTargets(0, nullptr, g_pCascadeDSV[c]);
+    context->ClearDepthStencilView(g_pCascadeDSV[c], D3D11_CLEAR_DEPTH, 1.0f, 0);
+    box.RenderDepth(context, 1 + c);
+  }
+
+  viewport.Width = (FLOAT)SHADOW_CUBE_SIZE;
+  viewport.Height = (FLOAT)SHADOW_CUBE_SIZE;
+  context->RSSetViewports(1, &viewport);
+
+  for (uint32_t s = 0; s < SHADOW_MAX_POINT_LIGHTS; s++) {
+    const ShadowCubeSlot& slot = planner.GetSlot(s);
+    for (uint32_t f = 0; f < 6; f++) {
+      if (!slot.faceUpdate[f])
+        continue;
+      ID3D11DepthStencilView* dsv = g_pCubeDSV[s * 6 + f];
+      context->OMSetRenderTargets(0, nullptr, dsv);
+      context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH, 1.0f, 0);
+      box.RenderDepth(context, 1 + SHADOW_CASCADES_COUNT + s * 6 + f);
+    }
+  }
+
+  // Main pass starts from default states
+  context->OMSetRenderTargets(0, nullptr, nullptr);
+  context->OMSetDepthStencilState(nullptr, 0);
+  context->RSSetState(nullptr);
+}
+
+void ShadowMaps::Bind(ID3D11DeviceContext* context) {
+  ID3D11ShaderResourceView* resources[] = { g_pCascadeSRV, g_pCubeSRV };
+  context->PSSetShaderResources(2, 2, resources);
+  context->PSSetSamplers(1, 1, &g_pSamplerState);
+  context->PSSetConstantBuffers(4, 1, &g_pShadowBuffer);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <d3d11.h>
+#include <directxmath.h>
+
+#include "def.h"
+#include "box.h"
+#include "cameraState.h"
+#include "shadowPlanner.h"
+
+using namespace DirectX;
+
+// Directional light of scene, cascades follow it
+#define SHADOW_SUN_DIRECTION XMFLOAT3(0.4f, -1.0f, 0.3f)
+#define SHADOW_SUN_COLOR XMFLOAT4(0.35f, 0.33f, 0.3f, 1.0f)
+
+// Receiver side bias: depth compare offsets and normal offset in cascade texels
+#define SHADOW_CASCADE_BIAS 0.0005f
+#define SHADOW_CUBE_BIAS 0.0002f
+#define SHADOW_NORMAL_OFFSET 1.5f
+// Caster side bias of depth passes
+#define SHADOW_DEPTH_BIAS 64
+#define SHADOW_SLOPE_BIAS 2.0f
+
+// Cascade depth array and point light cube array with their sampling buffer.
+// What is rendered and from where comes from ShadowPlanner, casters from Box culling views
+class ShadowMaps {
+public:
+  HRESULT Init(ID3D11Device* device);
+
+  void Realese();
+
+  // Sampling buffer for maps planner has
+  bool Frame(ID3D11DeviceContext* context, const ShadowPlanner& planner, const CameraState& camera, uint32_t lightsCount);
+
+  // Maps scheduled for this frame, box view v + 1 holds casters of planner view v
+  void Render(ID3D11DeviceContext* context, const ShadowPlanner& planner, Box& box);
+
+  // Maps and sampling buffer for box pixel shader
+  void Bind(ID3D11DeviceContext* context);
+private:
+  ID3D11Texture2D* g_pCascadeTexture = nullptr;
+  ID3D11DepthStencilView* g_pCascadeDSV[SHADOW_CASCADES_COUNT] = {};
+  ID3D11ShaderResourceView* g_pCascadeSRV = nullptr;
+
+  ID3D11Texture2D* g_pCubeTexture = nullptr;
+  ID3D11DepthStencilView* g_pCubeDSV[SHADOW_MAX_POINT_LIGHTS * 6] = {};
+  ID3D11ShaderResourceView* g_pCubeSRV = nullptr;
+
+  ID3D11Buffer* g_pShadowBuffer = nullptr;
+  ID3D11SamplerState* g_pSamplerState = nullptr;
+  ID3D11RasterizerState* g_pRasterizerState = nullptr;
+  ID3D11DepthStencilState* g_pDepthState = nullptr;
+};
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "shadowPlanner.h"
+
+void ShadowPlanner::ComputeSplits(float nearZ, float farZ, float lambda, uint32_t count, float* splits) {
+  // Logarithmic splits keep texel to pixel ratio even, uniform ones give far cascades more depth
+  for (uint32_t i = 0; i <= count; i++) {
+    float part = (float)i / count;
+    float logSplit = nearZ * powf(farZ / nearZ, part);
+    float uniformSplit = nearZ + (farZ - nearZ) * part;
+    splits[i] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+  }
+  splits[0] = nearZ;
+  splits[count] = farZ;
+}
+
+void ShadowPlanner::FitCascade(const XMMATRIX& inverseView, float tanHalfFovY, float aspect, float splitNear, float splitFar,
+  const XMFLOAT3& lightDir, uint32_t mapSize, float casterDistance, ShadowCascade& cascade) {
+  // Slice corners at depth z are z * k away from view axis. Sphere center on the axis is at the same
+  // distance from near and far corners, it is clamped to far plane for wide slices
+  float k2 = tanHalfFovY * tanHalfFovY * (1.0f + aspect * aspect);
+  float center = 0.5f * (splitFar + splitNear) * (1.0f + k2);
+  float radius;
+  if (center >= splitFar) {
+    center = splitFar;
+    radius = splitFar * sqrtf(k2);
+  }
+  else
+    radius = sqrtf((splitFar - center) * (splitFar - center) + splitFar * splitFar * k2);
+
+  // Rounded up so float noise never changes texel size
+  radius = ceilf(radius * 16.0f) / 16.0f;
+
+  // Light basis depends on light direction only
+  XMVECTOR dir = XMVector3Normalize(XMLoadFloat3(&lightDir));
+  XMVECTOR up = fabsf(XMVectorGetY(dir)) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+  XMMATRIX lightView = XMMatrixLookToLH(XMVectorZero(), dir, up);
+
+  XMVECTOR centerWorld = XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, center, 1.0f), inverseView);
+  XMFLOAT3 lightCenter;
+  XMStoreFloat3(&lightCenter, XMVector3TransformCoord(centerWorld, lightView));
+
+  // Center moves by whole texels, so rasterized depth of still casters doesn't change.
+  // One texel border keeps sphere inside after snapping
+  float texelSize = 2.0f * radius / (mapSize - 2);
+  float halfSize = radius + texelSize;
+  lightCenter.x = floorf(lightCenter.x / texelSize) * texelSize;
+  lightCenter.y = floorf(lightCenter.y / texelSize) * texelSize;
+
+  XMMATRIX projection = XMMatrixOrthographicOffCenterLH(
+    lightCenter.x - halfSize, lightCenter.x + halfSize,
+    lightCenter.y - halfSize, lightCenter.y + halfSize,
+    lightCenter.z - radius - casterDistance, lightCenter.z + radius);
+
+  cascade.viewProjection = XMMatrixMultiply(lightView, projection);
+  cascade.splitNear = splitNear;
+  cascade.splitFar = splitFar;
+  cascade.radius = radius;
+  cascade.texelSize = texelSize;
+}
+
+float ShadowPlanner::LightRange(const XMFLOAT4& color) {
+  // Shader attenuation is 1 / distance^2
+  float luminance = 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+  return sqrtf((std::max)(luminance, 0.0f) / SHADOW_LIGHT_THRESHOLD);
+}
+
+uint32_t ShadowPlanner::RankLights(const XMFLOAT4* positions, const XMFLOAT4* colors, uint32_t count, const XMFLOAT3& cameraPos,
+  const CullView& cameraView, const int32_t* previous, uint32_t previousCount, uint32_t maxLights, int32_t* selected, float* importance) {
+  uint32_t selectedCount = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    // Lights that can't reach view volume don't need shadows
+    float range = LightRange(colors[i]);
+    bool visible = range > 0.0f;
+    for (int p = 0; p < 6 && visible; p++) {
+      const XMFLOAT4& plane = cameraView.planes[p];
+      visible = plane.x * positions[i].x + plane.y * positions[i].y + plane.z * positions[i].z + plane.w >= -range;
+    }
+    if (!visible)
+      continue;
+
+    float dx = positions[i].x - cameraPos.x, dy = positions[i].y - cameraPos.y, dz = positions[i].z - cameraPos.z;
+    float score = range * range * SHADOW_LIGHT_THRESHOLD / (std::max)(dx * dx + dy * dy + dz * dz, 1.0f);
+    if (std::find(previous, previous + previousCount, (int32_t)i) != previous + previousCount)
+      score *= SHADOW_RANK_HYSTERESIS;
+
+    // Few lights are picked, insertion into sorted top keeps it linear in count
+    uint32_t place = selectedCount;
+    while (place > 0 && importance[place - 1] < score)
+      place--;
+    if (place >= maxLights)
+      continue;
+
+    selectedCount = (std::min)(selectedCount + 1, maxLights);
+    for (uint32_t j = selectedCount - 1; j > place; j--) {
+      selected[j] = selected[j - 1];
+      importance[j] = importance[j - 1];
+    }
+    selected[place] = (int32_t)i;
+    importance[place] = score;
+  }
+
+  return selectedCount;
+}
+
+void ShadowPlanner::CubeFaceMatrices(const XMFLOAT3& position, float nearZ, float farZ, XMMATRIX faceViewProjection[6]) {
+  static const XMFLOAT3 directions[6] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+  static const XMFLOAT3 ups[6] = { {0, 1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}, {0, 1, 0}, {0, 1, 0} };
+
+  XMVECTOR eye = XMLoadFloat3(&position);
+  XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, nearZ, farZ);
+  for (int f = 0; f < 6; f++)
+    faceViewProjection[f] = XMMatrixMultiply(XMMatrixLookToLH(eye, XMLoadFloat3(&directions[f]), XMLoadFloat3(&ups[f])), projection);
+}
+
+void ShadowPlanner::Plan(const CameraState& camera, const XMFLOAT3& lightDir, const XMFLOAT4* lightPositions, const XMFLOAT4* lightColors, uint32_t lightsCount) {
+  frame++;
+
+  // Projection may have reversed depth, near is the smaller one
+  const XMFLOAT4& perspective = camera.GetPerspective();
+  float nearZ = (std::min)(perspective.z, perspective.w);
+  float farZ = (std::min)((std::max)(perspective.z, perspective.w), SHADOW_DISTANCE);
+
+  ComputeSplits(nearZ, farZ, SHADOW_SPLIT_LAMBDA, SHADOW_CASCADES_COUNT, splits);
+  for (uint32_t c = 0; c < SHADOW_CASCADES_COUNT; c++) {
+    FitCascade(camera.GetInverseView(), tanf(0.5f * perspective.x), perspective.y, splits[c], splits[c + 1],
+      lightDir, SHADOW_MAP_SIZE, SHADOW_CASTER_DISTANCE, fitted[c]);
+    views[c] = CullView::FromViewProjection(fitted[c].viewProjection);
+  }
+
+  int32_t previous[SHADOW_MAX_POINT_LIGHTS];
+  uint32_t previousCount = 0;
+  for (uint32_t s = 0; s < SHADOW_MAX_POINT_LIGHTS; s++)
+    if (slots[s].light >= 0 && (uint32_t)slots[s].light < lightsCount)
+      previous[previousCount++] = slots[s].light;
+
+  int32_t selected[SHADOW_MAX_POINT_LIGHTS];
+  float importance[SHADOW_MAX_POINT_LIGHTS];
+  uint32_t selectedCount = RankLights(lightPositions, lightColors, lightsCount, camera.GetPosition(),
+    CullView::FromPlanes(camera.GetFrustumPlanes()), previous, previousCount, SHADOW_MAX_POINT_LIGHTS, selected, importance);
+
+  // Lights that stay keep their slots with rendered faces, new ones take freed slots
+  bool placed[SHADOW_MAX_POINT_LIGHTS] = {};
+  for (uint32_t s = 0; s < SHADOW_MAX_POINT_LIGHTS; s++) {
+    int32_t* found = std::find(selected, selected + selectedCount, slots[s].light);
+    if (found != selected + selectedCount) {
+      placed[found - selected] = true;
+      slots[s].importance = importance[found - selected];
+    }
+    else
+      slots[s].light = -1;
+  }
+
+  for (uint32_t j = 0, s = 0; j < selectedCount; j++) {
+    if (placed[j])
+      continue;
+    while (slots[s].light >= 0)
+      s++;
+    slots[s].light = selected[j];
+    slots[s].importance = importance[j];
+    for (int f = 0; f < 6; f++)
+      slots[s].faceValid[f] = false;
+  }
+
+  // Empty plane set has nothing inside, free slots cull every caster
+  CullView empty;
+  for (int p = 0; p < 6; p++)
+    empty.planes[p] = XMFLOAT4(0.0f, 0.0f, 0.0f, -1.0f);
+
+  for (uint32_t s = 0; s < SHADOW_MAX_POINT_LIGHTS; s++) {
+    ShadowCubeSlot& slot = slots[s];
+    CullView* faceViews = views + SHADOW_CASCADES_COUNT + s * 6;
+    if (slot.light < 0) {
+      for (int f = 0; f < 6; f++)
+        faceViews[f] = empty;
+      continue;
+    }
+
+    // Faces show depth from where they were rendered, moved light makes all of them wrong
+    XMFLOAT3 position(lightPositions[slot.light].x, lightPositions[slot.light].y, lightPositions[slot.light].z);
+    float range = LightRange(lightColors[slot.light]);
+    if (memcmp(&position, &slot.position, sizeof(position)) != 0 || range != slot.range) {
+      slot.position = position;
+      slot.range = range;
+      for (int f = 0; f < 6; f++)
+        slot.faceValid[f] = false;
+    }
+
+    CubeFaceMatrices(slot.position, SHADOW_CUBE_NEAR, slot.range, slot.faceViewProjection);
+    for (int f = 0; f < 6; f++)
+      faceViews[f] = CullView::FromViewProjection(slot.faceViewProjection[f]);
+  }
+}
+
+void ShadowPlanner::Schedule(const uint32_t* casterCounts) {
+  renderedCount = 0;
+
+  // Everything is rendered first time
+  for (uint32_t c = 0; c < SHADOW_CASCADES_COUNT; c++) {
+    cascadeUpdate[c] = !cascadeValid || c < SHADOW_NEAR_CASCADES || frame % SHADOW_FAR_CASCADE_INTERVAL == c % SHADOW_FAR_CASCADE_INTERVAL;
+    if (cascadeUpdate[c]) {
+      cascades[c] = fitted[c];
+      renderedCount++;
+    }
+  }
+  cascadeValid = true;
+
+  // Invalid faces go at once and take budget first. Faces that were empty and stay empty need nothing,
+  // others compete by light importance and age
+  uint32_t budget = SHADOW_FACE_BUDGET;
+  float priority[SHADOW_MAX_POINT_LIGHTS * 6];
+  for (uint32_t s = 0; s < SHADOW_MAX_POINT_LIGHTS; s++) {
+    ShadowCubeSlot& slot = slots[s];
+    for (int f = 0; f < 6; f++) {
+      uint32_t casters = casterCounts[SHADOW_CASCADES_COUNT + s * 6 + f];
+      slot.faceUpdate[f] = slot.light >= 0 && !slot.faceValid[f];
+      priority[s * 6 + f] = 0.0f;
+      if (slot.faceUpdate[f])
+        budget -= (std::min)(budget, 1u);
+      else if (slot.light >= 0 && (casters > 0 || slot.faceCasters[f] > 0))
+        priority[s * 6 + f] = slot.importance * (slot.faceAge[f] + 1);
+    }
+  }
+
+  for (; budget > 0; budget--) {
+    float* best = std::max_element(priority, priority + SHADOW_MAX_POINT_LIGHTS * 6);
+    if (*best <= 0.0f)
+      break;
+    slots[(best - priority) / 6].faceUpdate[(best - priority) % 6] = true;
+    *best = 0.0f;
+  }
+
+  for (uint32_t s = 0; s < SHADOW_MAX_POINT_LIGHTS; s++) {
+    ShadowCubeSlot& slot = slots[s];
+    for (int f = 0; f < 6; f++) {
+      if (slot.faceUpdate[f]) {
+        slot.faceAge[f] = 0;
+        slot.faceCasters[f] = casterCounts[SHADOW_CASCADES_COUNT + s * 6 + f];
+        slot.faceValid[f] = true;
+        renderedCount++;
+      }
+      else
+        slot.faceAge[f]++;
+    }
+  }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+
+#include "constants.h"
+#include "cameraState.h"
+#include "multiViewCuller.h"
+
+using namespace DirectX;
+
+// Directional light cascades, their count is in constants.h (shared with shaders)
+#define SHADOW_MAP_SIZE 1024
+// View depth covered by cascades
+#define SHADOW_DISTANCE 24.0f
+// Split scheme: 0 - uniform, 1 - logarithmic
+#define SHADOW_SPLIT_LAMBDA 0.7f
+// Casters this far towards light from cascade volume still get into it
+#define SHADOW_CASTER_DISTANCE 20.0f
+// Near cascades are rendered every frame, far ones in turns every SHADOW_FAR_CASCADE_INTERVAL frames
+#define SHADOW_NEAR_CASCADES 2
+#define SHADOW_FAR_CASCADE_INTERVAL 2
+
+// Point light cube maps, one per shadowed light (SHADOW_MAX_POINT_LIGHTS in constants.h)
+#define SHADOW_CUBE_SIZE 256
+#define SHADOW_CUBE_NEAR 0.05f
+// Light influence ends where intensity / distance^2 falls below it
+#define SHADOW_LIGHT_THRESHOLD 0.02f
+// Shadowed lights keep their maps unless another one is this much more important
+#define SHADOW_RANK_HYSTERESIS 1.25f
+// Cube faces refreshed per frame, the rest wait. Faces of new or moved lights are rendered at once
+// as they hold nothing valid, hysteresis keeps such frames rare
+#define SHADOW_FACE_BUDGET 8
+
+// Culling views: cascades, then 6 faces of each cube slot
+#define SHADOW_VIEWS_COUNT (SHADOW_CASCADES_COUNT + SHADOW_MAX_POINT_LIGHTS * 6)
+
+struct ShadowCascade {
+  XMMATRIX viewProjection;  // world -> cascade clip, depth 0..1
+  float splitNear;
+  float splitFar;
+  float radius;             // bounding sphere of view slice, rounded
+  float texelSize;          // world size of shadow map texel
+};
+
+struct ShadowCubeSlot {
+  int32_t light = -1;       // light index, -1 - free slot
+  float importance = 0.0f;
+  float range = 0.0f;       // far plane of faces
+  XMFLOAT3 position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  XMMATRIX faceViewProjection[6];
+  uint32_t faceAge[6] = {};         // frames since face was rendered
+  uint32_t faceCasters[6] = {};     // casters face had when it was rendered
+  bool faceValid[6] = {};           // face holds depth of this light from this position
+  bool faceUpdate[6] = {};          // face is rendered this frame
+};
+
+// Device free part of shadows: what to render and where from.
+// Cascades are fitted to bounding spheres of view slices and snapped to shadow map texels, so they
+// don't shimmer when camera moves or rotates. Point lights compete for cube maps by importance,
+// cube faces are refreshed within frame budget by importance and age
+class ShadowPlanner {
+public:
+  // splits[count + 1] from nearZ to farZ
+  static void ComputeSplits(float nearZ, float farZ, float lambda, uint32_t count, float* splits);
+
+  static void FitCascade(const XMMATRIX& inverseView, float tanHalfFovY, float aspect, float splitNear, float splitFar,
+    const XMFLOAT3& lightDir, uint32_t mapSize, float casterDistance, ShadowCascade& cascade);
+
+  // Influence radius of light by its color
+  static float LightRange(const XMFLOAT4& color);
+
+  // Lights that can light anything in view, by intensity over squared distance to camera.
+  // Lights in previous get hysteresis bonus, returns count written to selected (most important first)
+  static uint32_t RankLights(const XMFLOAT4* positions, const XMFLOAT4* colors, uint32_t count, const XMFLOAT3& cameraPos,
+    const CullView& cameraView, const int32_t* previous, uint32_t previousCount, uint32_t maxLights, int32_t* selected, float* importance);
+
+  // Faces in D3D cube order: +X, -X, +Y, -Y, +Z, -Z
+  static void CubeFaceMatrices(const XMFLOAT3& position, float nearZ, float farZ, XMMATRIX faceViewProjection[6]);
+
+  // Fits cascades, assigns lights to cube slots and makes culling views for both
+  void Plan(const CameraState& camera, const XMFLOAT3& lightDir, const XMFLOAT4* lightPositions, const XMFLOAT4* lightColors, uint32_t lightsCount);
+
+  // Picks maps rendered this frame, casterCounts are per view (GetViews order) after culling
+  void Schedule(const uint32_t* casterCounts);
+
+  const CullView* GetViews() const { return views; };
+
+  // Matrices shadow maps were rendered with, for sampling
+  const ShadowCascade& GetCascade(uint32_t cascade) const { return cascades[cascade]; };
+  bool IsCascadeUpdated(uint32_t cascade) const { return cascadeUpdate[cascade]; };
+  const float* GetSplits() const { return splits; };
+
+  const ShadowCubeSlot& GetSlot(uint32_t slot) const { return slots[slot]; };
+
+  // Cascades and faces rendered this frame
+  uint32_t GetRenderedCount() const { return renderedCount; };
+private:
+  uint64_t frame = 0;
+
+  float splits[SHADOW_CASCADES_COUNT + 1] = {};
+  ShadowCascade fitted[SHADOW_CASCADES_COUNT];
+  ShadowCascade cascades[SHADOW_CASCADES_COUNT];
+  bool cascadeUpdate[SHADOW_CASCADES_COUNT] = {};
+  bool cascadeValid = false;
+
+  ShadowCubeSlot slots[SHADOW_MAX_POINT_LIGHTS];
+  CullView views[SHADOW_VIEWS_COUNT];
+  uint32_t renderedCount = 0;
+};
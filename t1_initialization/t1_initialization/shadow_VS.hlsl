@@ -0,0 +1,27 @@
+#include "boxCB.h"
+#include "vertexDecode.h"
+
+cbuffer DepthViewsCB : register (b4)
+{
+  float4x4 depthViewProjection[MAX_DEPTH_VIEWS];
+};
+
+// Instance lists of all views one after another, x - box, y - view
+cbuffer DepthInstances : register (b5)
+{
+  uint4 depthInstances[MAX_CUBES * MAX_DEPTH_VIEWS];
+};
+
+struct VS_INPUT
+{
+  float3 position : POSITION; // quantized, see vertexDecode.h
+  uint instance : INSTANCE;   // instance id offset by start of view list
+};
+
+// Depth only, view and box come from list entry of the instance
+float4 main(VS_INPUT input) : SV_POSITION {
+  uint4 entry = depthInstances[input.instance];
+
+  float3 position = DecodePosition(input.position, posScale, posOffset);
+  return mul(depthViewProjection[entry.y], mul(geomBuffers[entry.x].worldMatrix, float4(position, 1.0f)));
+}
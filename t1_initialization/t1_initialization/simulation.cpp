@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "simulation.h"
+
+namespace {
+  typedef std::chrono::steady_clock SimClock;
+
+  const SimClock::duration STEP_DURATION =
+    std::chrono::duration_cast<SimClock::duration>(std::chrono::duration<double>(1.0 / SIM_STEP_RATE));
+
+  uint32_t CountMovingEntities(World& world) {
+    return world.Count<PositionComponent, SpinComponent, TransformComponent>() +
+      world.Count<PositionComponent, OscillationComponent, TransformComponent>();
+  }
+}
+
+void Simulation::Init(World& simWorld) {
+  Stop();
+  world = &simWorld;
+
+  uint32_t count = CountMovingEntities(simWorld);
+  for (auto& state : states)
+    state.poses.assign(count, SimPose());
+
+  latest = previous = readLatest = readPrevious = 0;
+  states[0].step = 0;
+  states[0].time = SimClock::now();
+  ComputeStep(simWorld, 0, states[0].poses.data());
+}
+
+void Simulation::ComputeStep(World& world, uint64_t step, SimPose* poses) {
+  // Time is taken from step number, not accumulated, so any step can be computed alone
+  double time = (double)step / SIM_STEP_RATE;
+  uint32_t index = 0;
+
+  // Boxes spin around y and swing around z with small lift.
+  // Transform is in query only to match entities render writes, it is not read here
+  world.ForEachChunk<PositionComponent, SpinComponent, TransformComponent>(
+    [&](uint32_t count, const Entity*, PositionComponent* positions, SpinComponent* spins, TransformComponent*) {
+    for (uint32_t i = 0; i < count; i++, index++) {
+      float speed = spins[i].speed;
+      float swing = (float)(sin(time * speed * 0.30) * 0.25f);
+      XMVECTOR rotation = XMQuaternionMultiply(
+        XMQuaternionRotationNormal(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), (float)time * speed * 0.5f),
+        XMQuaternionRotationNormal(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), swing));
+      XMStoreFloat4(&poses[index].rotation, rotation);
+      const XMFLOAT4& pos = positions[i].position;
+      poses[index].translation = XMFLOAT4(pos.x, pos.y + swing, pos.z, 1.0f);
+    }
+  });
+
+  // Oscillating entities (transparent planes) move along amplitude
+  world.ForEachChunk<PositionComponent, OscillationComponent, TransformComponent>(
+    [&](uint32_t count, const Entity*, PositionComponent* positions, OscillationComponent* oscillations, TransformComponent*) {
+    for (uint32_t i = 0; i < count; i++, index++) {
+      float wave = (float)sin(time * oscillations[i].frequency);
+      XMStoreFloat4(&poses[index].rotation, XMQuaternionIdentity());
+      XMVECTOR pos = XMVectorMultiplyAdd(XMLoadFloat4(&oscillations[i].amplitude), XMVectorReplicate(wave), XMLoadFloat4(&positions[i].position));
+      XMStoreFloat4(&poses[index].translation, XMVectorSetW(pos, 1.0f));
+    }
+  });
+}
+
+uint32_t Simulation::GetFreeState() const {
+  for (uint32_t i = 0; i < SIM_STATES_COUNT; i++)
+    if (i != latest && i != previous && i != readLatest && i != readPrevious)
+      return i;
+  return SIM_STATES_COUNT;
+}
+
+void Simulation::RunStep(uint64_t step, SimClock::time_point time) {
+  uint32_t slot;
+  {
+    std::lock_guard<std::mutex> lock(statesMutex);
+    slot = GetFreeState();
+  }
+
+  // Slot is not seen by render until it is published
+  SimState& state = states[slot];
+  state.step = step;
+  state.time = time;
+  ComputeStep(*world, step, state.poses.data());
+
+  std::lock_guard<std::mutex> lock(statesMutex);
+  previous = latest;
+  latest = slot;
+}
+
+void Simulation::Step(uint32_t count) {
+  uint64_t step = GetStep();
+  for (uint32_t i = 0; i < count; i++)
+    RunStep(++step, SimClock::now());
+}
+
+uint64_t Simulation::GetStep() {
+  std::lock_guard<std::mutex> lock(statesMutex);
+  return states[latest].step;
+}
+
+void Simulation::Start() {
+  if (replay || thread.joinable() || !world)
+    return;
+
+  stopping = false;
+  thread = std::thread(&Simulation::ThreadLoop, this);
+}
+
+void Simulation::Stop() {
+  if (!thread.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(threadMutex);
+    stopping = true;
+  }
+  threadCV.notify_all();
+  thread.join();
+}
+
+void Simulation::SetReplay(bool enabled) {
+  if (enabled)
+    Stop();
+  replay = enabled;
+  if (!enabled)
+    Start();
+}
+
+void Simulation::ThreadLoop() {
+  // Steps continue from latest one, its due time is the time origin
+  uint64_t step = GetStep();
+  SimClock::time_point origin = SimClock::now() - STEP_DURATION * (int64_t)step;
+
+  std::unique_lock<std::mutex> lock(threadMutex);
+  while (!stopping) {
+    uint64_t target = (uint64_t)((SimClock::now() - origin) / STEP_DURATION);
+
+    // Too far behind (debugger, window drag): skip time instead of running a burst of steps
+    if (target > step + SIM_MAX_CATCH_UP_STEPS) {
+      origin += STEP_DURATION * (int64_t)(target - step - SIM_MAX_CATCH_UP_STEPS);
+      target = step + SIM_MAX_CATCH_UP_STEPS;
+    }
+
+    lock.unlock();
+    while (step < target) {
+      step++;
+      RunStep(step, origin + STEP_DURATION * (int64_t)step);
+    }
+    lock.lock();
+
+    threadCV.wait_until(lock, origin + STEP_DURATION * (int64_t)(step + 1), [this] { return stopping; });
+  }
+}
+
+void Simulation::Frame(World& renderWorld) {
+  if (replay) {
+    Step(1);
+    Interpolate(renderWorld, TakeSnapshot(1.0f));
+    return;
+  }
+
+  Interpolate(renderWorld, TakeSnapshot());
+}
+
+SimSnapshot Simulation::TakeSnapshot() {
+  // Render shows simulation one step late: latest state is reached when next one is due.
+  // Alpha is taken with the states it belongs to, a step published in between can't pair with it
+  std::lock_guard<std::mutex> lock(statesMutex);
+  std::chrono::duration<double> sinceLatest = SimClock::now() - states[latest].time;
+  return HoldLatest((float)(sinceLatest.count() * SIM_STEP_RATE));
+}
+
+SimSnapshot Simulation::TakeSnapshot(float alpha) {
+  std::lock_guard<std::mutex> lock(statesMutex);
+  return HoldLatest(alpha);
+}
+
+SimSnapshot Simulation::HoldLatest(float alpha) {
+  readLatest = latest;
+  readPrevious = previous;
+
+  SimSnapshot snapshot;
+  snapshot.previous = previous;
+  snapshot.latest = latest;
+  snapshot.step = states[latest].step;
+  snapshot.alpha = (std::min)((std::max)(alpha, 0.0f), 1.0f);
+  return snapshot;
+}
+
+void Simulation::Interpolate(World& renderWorld, const SimSnapshot& snapshot) {
+  const float alpha = snapshot.alpha;
+  const SimPose* from = states[snapshot.previous].poses.data();
+  const SimPose* to = states[snapshot.latest].poses.data();
+  uint32_t index = 0;
+
+  auto blend = [&](uint32_t count, TransformComponent* transforms) {
+    for (uint32_t i = 0; i < count; i++, index++) {
+      XMVECTOR rotation = XMQuaternionSlerp(XMLoadFloat4(&from[index].rotation), XMLoadFloat4(&to[index].rotation), alpha);
+      XMVECTOR translation = XMVectorLerp(XMLoadFloat4(&from[index].translation), XMLoadFloat4(&to[index].translation), alpha);
+      XMStoreFloat4x4(&transforms[i].world, XMMatrixRotationQuaternion(rotation) * XMMatrixTranslationFromVector(translation));
+    }
+  };
+
+  // Same queries in the same order as ComputeStep
+  renderWorld.ForEachChunk<PositionComponent, SpinComponent, TransformComponent>(
+    [&](uint32_t count, const Entity*, PositionComponent*, SpinComponent*, TransformComponent* transforms) {
+    blend(count, transforms);
+  });
+  renderWorld.ForEachChunk<PositionComponent, OscillationComponent, TransformComponent>(
+    [&](uint32_t count, const Entity*, PositionComponent*, OscillationComponent*, TransformComponent* transforms) {
+    blend(count, transforms);
+  });
+}
+
+uint64_t Simulation::GetStateHash() {
+  std::lock_guard<std::mutex> lock(statesMutex);
+  const SimState& state = states[latest];
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(state.poses.data());
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < state.poses.size() * sizeof(SimPose); i++)
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  return hash;
+}
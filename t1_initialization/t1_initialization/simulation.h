@@ -0,0 +1,109 @@
+#pragma once
+
+#include <directxmath.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ecs.h"
+#include "components.h"
+
+using namespace DirectX;
+
+// Simulation steps per second, render interpolates between two latest steps
+#define SIM_STEP_RATE 60
+// Steps run at once to catch up after a stall, older time is dropped
+#define SIM_MAX_CATCH_UP_STEPS 8
+// Two latest states, two states render still reads and one being written
+#define SIM_STATES_COUNT 5
+
+// Rigid pose of moving entity
+struct SimPose {
+  XMFLOAT4 rotation;     // quaternion
+  XMFLOAT4 translation;  // w = 1
+};
+
+// Two states render blends and blend factor of latest one, taken together so they match
+struct SimSnapshot {
+  uint32_t previous = 0;
+  uint32_t latest = 0;
+  uint64_t step = 0;   // step of latest state
+  float alpha = 1.0f;  // in [0, 1]
+};
+
+struct SimState {
+  uint64_t step = 0;
+  std::chrono::steady_clock::time_point time;  // wall time step was due
+  std::vector<SimPose> poses;  // spinning entities, then oscillating ones, in query order
+};
+
+// Fixed step simulation of moving entities, decoupled from rendering.
+// Steps run on own thread by wall clock and are published into a ring of states,
+// render thread blends two latest of them into TransformComponent.
+// Simulation only reads Position, Spin and Oscillation components, render only writes Transform,
+// so both threads walk the same world. Entities must not be created or destroyed while it runs.
+class Simulation {
+public:
+  ~Simulation() { Stop(); };
+
+  // Sizes states for moving entities of world and writes step 0
+  void Init(World& world);
+
+  void Start();
+  void Stop();
+
+  // Replay: no thread, every Frame runs exactly one step and shows it without blending,
+  // so the same frame number always shows the same state
+  void SetReplay(bool enabled);
+  bool IsReplay() const { return replay; };
+
+  // Render thread: writes transforms of moving entities blended between two latest states
+  void Frame(World& world);
+
+  // Two latest states and blend factor by wall clock, taken in one locked section.
+  // Simulation doesn't touch taken states until next snapshot
+  SimSnapshot TakeSnapshot();
+  // Same with given blend factor of latest state
+  SimSnapshot TakeSnapshot(float alpha);
+
+  // Writes transforms blended between states of snapshot
+  void Interpolate(World& world, const SimSnapshot& snapshot);
+
+  // Runs steps on calling thread, simulation must be stopped
+  void Step(uint32_t count);
+
+  uint64_t GetStep();
+
+  // FNV-1a of latest state poses, the same step gives the same hash on every run
+  uint64_t GetStateHash();
+
+  // Poses of all moving entities at step, depends on step number and components only
+  static void ComputeStep(World& world, uint64_t step, SimPose* poses);
+private:
+  void ThreadLoop();
+  void RunStep(uint64_t step, std::chrono::steady_clock::time_point time);
+
+  // Slot not used by latest states and render
+  uint32_t GetFreeState() const;
+  // Marks two latest states as read by render, statesMutex is held
+  SimSnapshot HoldLatest(float alpha);
+
+  World* world = nullptr;
+  SimState states[SIM_STATES_COUNT];
+
+  // Guarded by statesMutex
+  std::mutex statesMutex;
+  uint32_t latest = 0;
+  uint32_t previous = 0;
+  uint32_t readLatest = 0;
+  uint32_t readPrevious = 0;
+
+  std::thread thread;
+  std::mutex threadMutex;
+  std::condition_variable threadCV;
+  bool stopping = false;
+  bool replay = false;
+};
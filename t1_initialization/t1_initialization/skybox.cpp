@@ -1,106 +1,42 @@
 #include "skybox.h"
 
-void Skybox::GenerateSphere(UINT LatLines, UINT LongLines, std::vector<SimpleVertex>& vertices, std::vector<UINT>& indices) {
-  // generate verticies  
-  numSphereVertices = ((LatLines - 2) * LongLines) + 2;
-  numSphereFaces = ((LatLines - 3) * (LongLines) * 2) + (LongLines * 2);
+namespace {
+  // Sphere tessellation of each LOD, from finest to coarsest
+  const UINT SKYBOX_LOD_TESSELLATION[] = { 30, 20, 12 };
 
-  float sphereYaw = 0.0f;
-  float spherePitch = 0.0f;
-  
-  vertices.resize(numSphereVertices);
-
-  XMVECTOR currVertPos = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
-
-  vertices[0].x = 0.0f;
-  vertices[0].y = 0.0f;
-  vertices[0].z = 1.0f;
-
-  for (UINT i = 0; i < LatLines - 2; i++) {
-    spherePitch = (i + 1) * (XM_PI / (LatLines - 1));
-    XMMATRIX Rotationx = XMMatrixRotationX(spherePitch);
-    for (UINT j = 0; j < LongLines; j++) {
-      sphereYaw = j * (XM_2PI / (LongLines));
-      XMMATRIX Rotationy = XMMatrixRotationZ(sphereYaw);
-      currVertPos = XMVector3TransformNormal(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), (Rotationx * Rotationy));
-      currVertPos = XMVector3Normalize(currVertPos);
-      vertices[i * LongLines + j + 1].x = XMVectorGetX(currVertPos);
-      vertices[i * LongLines + j + 1].y = XMVectorGetY(currVertPos);
-      vertices[i * LongLines + j + 1].z = XMVectorGetZ(currVertPos);
-    }
-  }
-
-  vertices[numSphereVertices - 1].x = 0.0f;
-  vertices[numSphereVertices - 1].y = 0.0f;
-  vertices[numSphereVertices - 1].z = -1.0f;
-
-  // generate indicies
-  indices.resize(numSphereFaces * 3);
-
-  UINT k = 0;
-  for (UINT i = 0; i < LongLines - 1; i++) {
-    indices[k] = 0;
-    indices[k + 1] = i + 1;
-    indices[k + 2] = i + 2;
-    k += 3;
-  }
-
-  indices[k] = 0;
-  indices[k + 1] = LongLines;
-  indices[k + 2] = 1;
-  k += 3;
-
-  for (UINT i = 0; i < LatLines - 3; i++) {
-    for (UINT j = 0; j < LongLines - 1; j++) {
-      indices[k] = i * LongLines + j + 1;
-      indices[k + 1] = i * LongLines + j + 2;
-      indices[k + 2] = (i + 1) * LongLines + j + 1;
-
-      indices[k + 3] = (i + 1) * LongLines + j + 1;
-      indices[k + 4] = i * LongLines + j + 2;
-      indices[k + 5] = (i + 1) * LongLines + j + 2;
-
-      k += 6;
-    }
-
-    indices[k] = (i * LongLines) + LongLines;
-    indices[k + 1] = (i * LongLines) + 1;
-    indices[k + 2] = ((i + 1) * LongLines) + LongLines;
+  // Skybox always covers the whole screen, so LOD is picked by screen height (pixels)
+  const float SKYBOX_LOD_THRESHOLDS[] = { 1000.0f, 500.0f };
+}
 
-    indices[k + 3] = ((i + 1) * LongLines) + LongLines;
-    indices[k + 4] = (i * LongLines) + 1;
-    indices[k + 5] = ((i + 1) * LongLines) + 1;
+HRESULT Skybox::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight) {
+  // Create sphere LOD chain, all levels share one vertex and one index buffer
+  std::vector<SimpleVertex> vertices;
+  std::vector<UINT> indices;
+  sphereLODs.resize(ARRAYSIZE(SKYBOX_LOD_TESSELLATION));
+  for (size_t lod = 0; lod < sphereLODs.size(); lod++) {
+    const Mesh& sphere = MeshGenerator::GetInstance().GetUVSphere(SKYBOX_LOD_TESSELLATION[lod], SKYBOX_LOD_TESSELLATION[lod]);
 
-    k += 6;
-  }
+    sphereLODs[lod].indexStart = (UINT)indices.size();
+    sphereLODs[lod].indexCount = (UINT)sphere.indices.size();
+    sphereLODs[lod].baseVertex = (INT)vertices.size();
 
-  for (UINT i = 0; i < LongLines - 1; i++) {
-    indices[k] = numSphereVertices - 1;
-    indices[k + 1] = (numSphereVertices - 1) - (i + 1);
-    indices[k + 2] = (numSphereVertices - 1) - (i + 2);
-    k += 3;
+    for (auto& vertex : sphere.vertices)
+      vertices.push_back({ vertex.pos.x, vertex.pos.y, vertex.pos.z });
+    indices.insert(indices.end(), sphere.indices.begin(), sphere.indices.end());
   }
 
-  indices[k] = numSphereVertices - 1;
-  indices[k + 1] = (numSphereVertices - 1) - LongLines;
-  indices[k + 2] = numSphereVertices - 2;
+  lodSelector.Init(std::vector<float>(std::begin(SKYBOX_LOD_THRESHOLDS), std::end(SKYBOX_LOD_THRESHOLDS)));
 
-  return;
-}
-
-HRESULT Skybox::Init(ID3D11Device* device, ID3D11DeviceContext* context, int screenWidth, int screenHeight) {
-  // Create sphere
-  std::vector<SimpleVertex> vertices;
-  std::vector<UINT> indices;
-  GenerateSphere(30, 30, vertices, indices);
+  std::vector<QuantizedSimpleVertex> quantizedVertices(vertices.size());
+  sphereQuantization = VertexQuantizer::Encode(vertices.data(), vertices.size(), quantizedVertices.data());
 
   // Create index array
   static const D3D11_INPUT_ELEMENT_DESC InputDesc[] = {
-      {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+      {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
   };
 
   D3D11_BUFFER_DESC descVert = {};
-  descVert.ByteWidth = sizeof(SimpleVertex) * numSphereVertices;
+  descVert.ByteWidth = (UINT)(sizeof(QuantizedSimpleVertex) * quantizedVertices.size());
   descVert.Usage = D3D11_USAGE_IMMUTABLE;
   descVert.BindFlags = D3D11_BIND_VERTEX_BUFFER;
   descVert.CPUAccessFlags = 0;
@@ -109,7 +45,7 @@ HRESULT Skybox::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scr
 
   D3D11_SUBRESOURCE_DATA dataVert;
   ZeroMemory(&dataVert, sizeof(dataVert));
-  dataVert.pSysMem = &vertices[0];
+  dataVert.pSysMem = &quantizedVertices[0];
   HRESULT hr = device->CreateBuffer(&descVert, &dataVert, &g_pVertexBuffer);
   if (FAILED(hr))
     return hr;
@@ -117,7 +53,7 @@ HRESULT Skybox::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scr
   D3D11_BUFFER_DESC descInd = {};
   ZeroMemory(&descInd, sizeof(descInd));
 
-  descInd.ByteWidth = sizeof(UINT) * numSphereFaces * 3;
+  descInd.ByteWidth = (UINT)(sizeof(UINT) * indices.size());
   descInd.Usage = D3D11_USAGE_IMMUTABLE;
   descInd.BindFlags = D3D11_BIND_INDEX_BUFFER;
   descInd.CPUAccessFlags = 0;
@@ -139,7 +75,7 @@ HRESULT Skybox::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scr
   flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
 
-  hr = D3DCompileFromFile(L"skybox_VS.hlsl", NULL, NULL, "main", "vs_5_0", flags, 0, &vertexShaderBuffer, NULL);
+  hr = CompileShaderFromAsset(L"skybox_VS.hlsl", NULL, NULL, "main", "vs_5_0", flags, 0, &vertexShaderBuffer, NULL);
   if (FAILED(hr))
     return hr;
 
@@ -147,7 +83,7 @@ HRESULT Skybox::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scr
   if (FAILED(hr))
     return hr;
   
-  hr = D3DCompileFromFile(L"skybox_PS.hlsl", NULL, NULL, "main", "ps_5_0", flags, 0, &pixelShaderBuffer, NULL);
+  hr = CompileShaderFromAsset(L"skybox_PS.hlsl", NULL, NULL, "main", "ps_5_0", flags, 0, &pixelShaderBuffer, NULL);
   if (FAILED(hr))
     return hr;
 
@@ -171,6 +107,7 @@ HRESULT Skybox::Init(ID3D11Device* device, ID3D11DeviceContext* context, int scr
 
   SBWorldMatrixBuffer worldMatrixBuffer;
   worldMatrixBuffer.worldMatrix = DirectX::XMMatrixIdentity();
+  worldMatrixBuffer.sphereQuantization = sphereQuantization;
 
   D3D11_SUBRESOURCE_DATA data;
   data.pSysMem = &worldMatrixBuffer;
@@ -259,6 +196,9 @@ void Skybox::Resize(int screenWidth, int screenHeight) {
   float halfW = tanf(fov / 2) * n;
   float halfH = float(screenHeight / screenWidth) * halfW;
   radius = sqrtf(n * n + halfH * halfH + halfW * halfW) * 11.1f * 2.0f;
+
+  lod = lodSelector.Select((float)screenHeight, lod);
+  sceneVersion = 0;
 }
 
 void Skybox::Render(ID3D11DeviceContext* context) {
@@ -271,7 +211,7 @@ void Skybox::Render(ID3D11DeviceContext* context) {
   ID3D11ShaderResourceView* resources[] = { txt.GetTexture() };
   context->PSSetShaderResources(0, 1, resources);
   ID3D11Buffer* vertexBuffers[] = { g_pVertexBuffer };
-  UINT strides[] = { 12 };
+  UINT strides[] = { sizeof(QuantizedSimpleVertex) };
   UINT offsets[] = { 0 };
 
   context->IASetVertexBuffers(0, 1, vertexBuffers, strides, offsets);
@@ -282,15 +222,20 @@ void Skybox::Render(ID3D11DeviceContext* context) {
   context->VSSetConstantBuffers(1, 1, &g_pSceneMatrixBuffer);
   context->PSSetShader(g_pPixelShader, nullptr, 0);
 
-  context->DrawIndexed(numSphereFaces * 3, 0, 0);
+  context->DrawIndexed(sphereLODs[lod].indexCount, sphereLODs[lod].indexStart, sphereLODs[lod].baseVertex);
 }
 
-bool Skybox::Frame(ID3D11DeviceContext* context, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos) {
+bool Skybox::Frame(ID3D11DeviceContext* context, const CameraState& camera) {
+  // Skybox depends on camera and size only, buffers are kept while neither changes
+  if (sceneVersion == camera.GetVersion())
+    return S_OK;
+
   // Update world matrix
   SBWorldMatrixBuffer worldMatrixBuffer;
 
   worldMatrixBuffer.worldMatrix = XMMatrixIdentity();
   worldMatrixBuffer.size = XMFLOAT4(radius, 0.0f, 0.0f, 0.0f);
+  worldMatrixBuffer.sphereQuantization = sphereQuantization;
 
   context->UpdateSubresource(g_pWorldMatrixBuffer, 0, nullptr, &worldMatrixBuffer, 0, 0);
 
@@ -301,9 +246,11 @@ bool Skybox::Frame(ID3D11DeviceContext* context, XMMATRIX viewMatrix, XMMATRIX p
     return hr;
   
   SBSceneMatrixBuffer& sceneBuffer = *reinterpret_cast<SBSceneMatrixBuffer*>(subresource.pData);
-  sceneBuffer.viewProjectionMatrix = XMMatrixMultiply(viewMatrix, projectionMatrix);
+  const XMFLOAT3& cameraPos = camera.GetPosition();
+  sceneBuffer.viewProjectionMatrix = camera.GetViewProjection();
   sceneBuffer.cameraPos = XMFLOAT4(cameraPos.x, cameraPos.y, cameraPos.z, 1.0f);
   context->Unmap(g_pSceneMatrixBuffer, 0);
+  sceneVersion = camera.GetVersion();
 
   return S_OK;
 }
@@ -9,6 +9,11 @@
 
 #include "texture.h"
 #include "def.h"
+#include "meshGenerator.h"
+#include "lodSelector.h"
+#include "vertexQuantizer.h"
+#include "D3DInclude.h"
+#include "cameraState.h"
 
 using namespace DirectX;
 
@@ -22,11 +27,9 @@ public:
   
   void Render(ID3D11DeviceContext* context);
 
-  bool Frame(ID3D11DeviceContext* context, XMMATRIX viewMatrix, XMMATRIX projectionMatrix, XMFLOAT3 cameraPos);
+  bool Frame(ID3D11DeviceContext* context, const CameraState& camera);
 
 private:
-  void GenerateSphere(UINT LatLines, UINT LongLines, std::vector<SimpleVertex>& vertices, std::vector<UINT>& indices);
-
   // dx11 vars
   ID3D11Buffer* g_pVertexBuffer = nullptr;
   ID3D11Buffer* g_pIndexBuffer = nullptr;
@@ -43,7 +46,19 @@ private:
   Texture txt;
 
   // Sphere (Skybox) geometry params
-  UINT numSphereVertices = 0;
-  UINT numSphereFaces = 0;
+  struct SphereLOD {
+    UINT indexStart;
+    UINT indexCount;
+    INT baseVertex;
+  };
+  std::vector<SphereLOD> sphereLODs;
+  VertexQuantization sphereQuantization = {};
   float radius = 1.0f;
+
+  // Current LOD, changes on resize only
+  LODSelector lodSelector;
+  uint8_t lod = 0;
+
+  // Camera version buffers were written for, 0 after resize
+  uint32_t sceneVersion = 0;
 };
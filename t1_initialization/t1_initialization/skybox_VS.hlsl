@@ -1,8 +1,12 @@
+#include "vertexDecode.h"
+
 // Independet constant buffers for world and view projection matrixes
 cbuffer WorldMatrixBuffer : register (b0)
 {
   float4x4 worldMatrix;
   float4 size;
+  float4 posScale; // quantized position decode
+  float4 posOffset;
 };
 
 cbuffer SceneMatrixBuffer : register (b1)
@@ -13,7 +17,7 @@ cbuffer SceneMatrixBuffer : register (b1)
 
 struct VS_INPUT
 {
-  float3 position : POSITION;
+  float3 position : POSITION; // quantized, see vertexDecode.h
 };
 
 struct PS_INPUT
@@ -25,11 +29,12 @@ struct PS_INPUT
 PS_INPUT main(VS_INPUT input) {
   PS_INPUT output;
 
-  float3 pos = cameraPos.xyz + input.position * size.x;
+  float3 position = DecodePosition(input.position, posScale, posOffset);
+  float3 pos = cameraPos.xyz + position * size.x;
   output.position = mul(
     viewProjectionMatrix,
     mul(worldMatrix, float4(pos, 1.0f)));
-  output.localPos = input.position;
+  output.localPos = position;
   output.position.z = 0.0f;
 
   return output;
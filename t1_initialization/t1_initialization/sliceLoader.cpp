@@ -0,0 +1,97 @@
+#include <cstring>
+
+#include "sliceLoader.h"
+#include "mipGenerator.h"
+#include "threadPool.h"
+
+HRESULT SliceLoader::ReadAsset(const wchar_t* filename, AssetData& asset) {
+  if (SUCCEEDED(AssetArchive::GetInstance().Load(filename, asset)))
+    return S_OK;
+
+  HANDLE hFile = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+
+  HRESULT hr = S_OK;
+  LARGE_INTEGER fileSize = {};
+  if (!GetFileSizeEx(hFile, &fileSize))
+    hr = HRESULT_FROM_WIN32(GetLastError());
+  else if (fileSize.HighPart > 0)
+    hr = E_FAIL;
+  else {
+    asset.storage.resize(fileSize.LowPart);
+    DWORD bytesRead = 0;
+    if (!ReadFile(hFile, asset.storage.data(), fileSize.LowPart, &bytesRead, nullptr))
+      hr = HRESULT_FROM_WIN32(GetLastError());
+    else if (bytesRead < fileSize.LowPart)
+      hr = E_FAIL;
+    asset.data = asset.storage.data();
+    asset.size = bytesRead;
+  }
+
+  CloseHandle(hFile);
+  return hr;
+}
+
+HRESULT SliceLoader::Load(const wchar_t* filename, TextureSlice& slice) {
+  HRESULT hr = ReadAsset(filename, slice.asset);
+  if (FAILED(hr))
+    return hr;
+
+  if (ParseDDS(slice.asset.data, slice.asset.size, slice.layout) != DDS_PARSE_OK)
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+  const DDSLayout& layout = slice.layout;
+  if (layout.dimension != DDS_DIMENSION_TEXTURE2D || layout.arraySize != 1)
+    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+  const DDSSubresource& top = layout.subresources[0];
+  slice.mips.resize(layout.mipCount);
+  for (uint32_t mip = 0; mip < layout.mipCount; mip++) {
+    const DDSSubresource& sub = layout.subresources[mip];
+    slice.mips[mip] = { layout.bitData + sub.offset, (uint32_t)sub.rowPitch, (uint32_t)sub.slicePitch };
+  }
+
+  // Same as single texture loading: uncompressed textures without mips get them on CPU
+  if (layout.mipCount == 1 && MipGenerator::IsFormatSupported(layout.format)) {
+    std::vector<MipLevel> mips;
+    if (!MipGenerator::Generate(layout.bitData, layout.width, layout.height, top.rowPitch,
+      layout.format, MIP_FILTER_KAISER, false, 0, mips))
+      return E_FAIL;
+
+    size_t chainSize = 0;
+    for (auto& mip : mips)
+      chainSize += mip.data.size();
+    slice.mipChain.resize(chainSize);
+
+    size_t offset = 0;
+    for (auto& mip : mips) {
+      memcpy(slice.mipChain.data() + offset, mip.data.data(), mip.data.size());
+      slice.mips.push_back({ slice.mipChain.data() + offset, (uint32_t)mip.rowPitch, (uint32_t)mip.slicePitch });
+      offset += mip.data.size();
+    }
+  }
+
+  return S_OK;
+}
+
+void SliceLoader::LoadAll(
+  const std::vector<const wchar_t*>& filenames,
+  std::vector<TextureSlice>& slices,
+  std::vector<HRESULT>& results,
+  bool parallel
+) {
+  auto count = (uint32_t)filenames.size();
+  slices.clear();
+  slices.resize(count);
+  results.assign(count, S_OK);
+
+  auto load = [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++)
+      results[i] = Load(filenames[i], slices[i]);
+  };
+  if (parallel)
+    ThreadPool::GetInstance().ParallelFor(count, 1, load);
+  else
+    load(0, count);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <vector>
+
+#include "assetArchive.h"
+#include "ddsParser.h"
+
+// Initial data of one mip, same fields as D3D11_SUBRESOURCE_DATA
+struct SliceMip {
+  const uint8_t* data;
+  uint32_t rowPitch;
+  uint32_t slicePitch;
+};
+
+// Parsed 2D texture, data is either mapped archive memory or own storage
+struct TextureSlice {
+  AssetData asset;
+  DDSLayout layout;
+  std::vector<uint8_t> mipChain; // CPU generated mips for slices stored without them
+  std::vector<SliceMip> mips;
+};
+
+// Device free part of texture array / atlas loading: read, parse and mip generation.
+// Safe to run on worker threads, D3D resources are created from slices by Texture.
+class SliceLoader {
+public:
+  // Asset archive first, loose file otherwise
+  static HRESULT ReadAsset(const wchar_t* filename, AssetData& asset);
+
+  static HRESULT Load(const wchar_t* filename, TextureSlice& slice);
+
+  // One slice per file, results keep status of each, parallel runs files on thread pool
+  static void LoadAll(const std::vector<const wchar_t*>& filenames, std::vector<TextureSlice>& slices,
+    std::vector<HRESULT>& results, bool parallel = true);
+};
@@ -1,3 +1,4 @@
+#include "shadowCalc.h"
 #include "boxCB.h"
 
 Texture2DArray tex : register (t0);
@@ -15,12 +16,14 @@ struct PS_INPUT
 };
 
 float4 main(PS_INPUT input) : SV_Target0 {
-  // step 1  - count ambient color
+  // step 1  - count ambient color (material diffuse lives in atlas rect)
+  uint material = (uint)geomBuffers[input.instanceId].boxParams.z;
+  float2 atlasUV = saturate(input.uv) * uvScaleOffset[material].xy + uvScaleOffset[material].zw;
   float3 ambient = ambientColor.xyz * tex.Sample(
     smplr, 
     float3(
-      input.uv, 
-      geomBuffers[input.instanceId].boxParams.z)
+      atlasUV, 
+      page[material].x)
   ).xyz;
   
   // step 2 - calculate normal  
@@ -33,6 +36,8 @@ float4 main(PS_INPUT input) : SV_Target0 {
   else
     norm = input.normal;
 
-  // step 3 - return final color with lights
-  return float4(CalculateColor(ambient, norm, input.worldPos.xyz, geomBuffers[input.instanceId].boxParams.x, false), 1.0);
+  // step 3 - return final color with lights and sun
+  float3 color = CalculateColor(ambient, norm, input.worldPos.xyz, geomBuffers[input.instanceId].boxParams.x, false);
+  color += CalculateSunColor(ambient, normalize(norm), input.worldPos.xyz);
+  return float4(color, 1.0);
 }
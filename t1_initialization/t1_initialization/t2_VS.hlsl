@@ -1,11 +1,12 @@
 #include "boxCB.h"
+#include "vertexDecode.h"
 
 struct VS_INPUT
 {
-  float3 position : POSITION;
+  float3 position : POSITION; // quantized, see vertexDecode.h
   float2 uv : TEXCOORD;
-  float3 normal : NORMAL;
-  float3 tangent : TANGENT;
+  float2 normal : NORMAL;     // octahedral
+  float2 tangent : TANGENT;   // octahedral
   uint instanceId : SV_InstanceID;
 };
 
@@ -23,10 +24,14 @@ PS_INPUT main(VS_INPUT input) {
   PS_INPUT output;
   unsigned int idx = objectID[input.instanceId].x;
 
-  output.worldPos = mul(geomBuffers[idx].worldMatrix, float4(input.position, 1.0f));
+  float3 position = DecodePosition(input.position, posScale, posOffset);
+  float3 normal = OctDecode(input.normal);
+  float3 tangent = OctDecode(input.tangent);
+
+  output.worldPos = mul(geomBuffers[idx].worldMatrix, float4(position, 1.0f));
   output.position = mul(viewProjectionMatrix, output.worldPos);
-  output.normal = mul(geomBuffers[idx].norm, float4(input.normal, 0.0f)).xyz;
-  output.tangent = mul(geomBuffers[idx].norm, float4(input.tangent, 0.0f)).xyz;
+  output.normal = mul(geomBuffers[idx].norm, float4(normal, 0.0f)).xyz;
+  output.tangent = mul(geomBuffers[idx].norm, float4(tangent, 0.0f)).xyz;
   output.uv = input.uv;
   output.instanceId = idx;
 
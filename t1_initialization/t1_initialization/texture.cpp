@@ -1,14 +1,44 @@
 #include "texture.h"
+#include "assetArchive.h"
+#include "sliceLoader.h"
 
 using namespace DirectX;
 
+namespace {
+  // Slice mips as D3D initial data, pointers stay valid while slice lives
+  void FillInitData(const TextureSlice& slice, std::vector<D3D11_SUBRESOURCE_DATA>& initData) {
+    for (auto& mip : slice.mips)
+      initData.push_back({ mip.data, mip.rowPitch, mip.slicePitch });
+  }
+
+  // Take texture from asset archive if it is packed there, otherwise read loose file
+  HRESULT CreateDDSTexture(
+    ID3D11Device* device,
+    ID3D11DeviceContext* deviceContext,
+    const wchar_t* filename,
+    unsigned int miscFlags,
+    ID3D11Resource** texture,
+    ID3D11ShaderResourceView** textureView
+  ) {
+    AssetData asset;
+    if (SUCCEEDED(AssetArchive::GetInstance().Load(filename, asset)))
+      return CreateDDSTextureFromMemoryEx(device, deviceContext, asset.data, asset.size,
+        0, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, miscFlags,
+        false, texture, textureView);
+
+    return CreateDDSTextureFromFileEx(device, deviceContext, filename,
+      0, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, miscFlags,
+      false, texture, textureView);
+  }
+}
+
 HRESULT Texture::Init(
   ID3D11Device* device, 
   ID3D11DeviceContext* deviceContext, 
   const wchar_t* filename
 ) {
   Release();
-  return CreateDDSTextureFromFile(device, filename, nullptr, &g_pTextureView);
+  return CreateDDSTexture(device, nullptr, filename, 0, nullptr, &g_pTextureView);
 }
 
 HRESULT Texture::InitEx(
@@ -17,59 +47,70 @@ HRESULT Texture::InitEx(
   const wchar_t* filename
 ) {
   Release();
-  return CreateDDSTextureFromFileEx(device, deviceContext, filename,
-    0, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, D3D11_RESOURCE_MISC_TEXTURECUBE,
-    false, nullptr, &g_pTextureView);
+  return CreateDDSTexture(device, deviceContext, filename, D3D11_RESOURCE_MISC_TEXTURECUBE, nullptr, &g_pTextureView);
 }
 
 HRESULT Texture::InitArray(
   ID3D11Device* device,
   ID3D11DeviceContext* deviceContext,
-  const std::vector<const wchar_t*> &filenames
+  const std::vector<const wchar_t*> &filenames,
+  std::vector<HRESULT>* sliceResults
 ) {
   Release();
 
-  HRESULT hr = S_OK;
   auto textureCount = (UINT)filenames.size();
-
-  std::vector<ID3D11Texture2D*> textures(textureCount);
-
-  // Load textures from DDS files.
-  for (UINT i = 0; i < textureCount; ++i) {
-    hr = DirectX::CreateDDSTextureFromFile(device, filenames[i], (ID3D11Resource**)(&textures[i]), nullptr);
+  if (textureCount == 0)
+    return E_INVALIDARG;
+
+  // Read and parse all slices in parallel, nothing here touches the device
+  std::vector<TextureSlice> slices;
+  std::vector<HRESULT> results;
+  SliceLoader::LoadAll(filenames, slices, results);
+
+  // Each element in the texture array must have the same format and dimensions as first one
+  const DDSLayout& first = slices[0].layout;
+  for (UINT i = 1; i < textureCount; ++i) {
+    const TextureSlice& slice = slices[i];
+    if (SUCCEEDED(results[i]) && SUCCEEDED(results[0]) &&
+      (slice.layout.width != first.width || slice.layout.height != first.height ||
+        slice.layout.format != first.format || slice.mips.size() != slices[0].mips.size()))
+      results[i] = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
   }
-  if (FAILED(hr)) {
+
+  HRESULT hr = S_OK;
+  for (UINT i = 0; i < textureCount && SUCCEEDED(hr); ++i)
+    hr = results[i];
+  if (sliceResults)
+    *sliceResults = results;
+  if (FAILED(hr))
     return hr;
-  }
 
-  D3D11_TEXTURE2D_DESC textureDesc;
-  textures[0]->GetDesc(&textureDesc); // each element in the texture array has the same format and dimensions
+  // Subresources go slice by slice, mips inside slice, same as D3D11CalcSubresource order
+  auto mipLevels = (UINT)slices[0].mips.size();
+  std::vector<D3D11_SUBRESOURCE_DATA> initData;
+  initData.reserve(size_t(mipLevels) * textureCount);
+  for (auto& slice : slices)
+    FillInitData(slice, initData);
 
   D3D11_TEXTURE2D_DESC arrayDesc;
-  arrayDesc.Width = textureDesc.Width;
-  arrayDesc.Height = textureDesc.Height;
-  arrayDesc.MipLevels = textureDesc.MipLevels;
+  arrayDesc.Width = first.width;
+  arrayDesc.Height = first.height;
+  arrayDesc.MipLevels = mipLevels;
   arrayDesc.ArraySize = textureCount;
-  arrayDesc.Format = textureDesc.Format;
+  arrayDesc.Format = first.format;
   arrayDesc.SampleDesc.Count = 1;
   arrayDesc.SampleDesc.Quality = 0;
-  arrayDesc.Usage = D3D11_USAGE_DEFAULT;
+  arrayDesc.Usage = D3D11_USAGE_IMMUTABLE;
   arrayDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
   arrayDesc.CPUAccessFlags = 0;
   arrayDesc.MiscFlags = 0;
 
+  // Single upload for whole array
   ID3D11Texture2D* textureArray = nullptr;
-  hr = device->CreateTexture2D(&arrayDesc, 0, &textureArray);
+  hr = device->CreateTexture2D(&arrayDesc, initData.data(), &textureArray);
   if (FAILED(hr))
     return hr;
 
-  for (UINT texElement = 0; texElement < textureCount; ++texElement)
-    for (UINT mipLevel = 0; mipLevel < textureDesc.MipLevels; ++mipLevel) {
-      const int sourceSubresource = D3D11CalcSubresource(mipLevel, 0, textureDesc.MipLevels);
-      const int destSubresource = D3D11CalcSubresource(mipLevel, texElement, textureDesc.MipLevels);
-      deviceContext->CopySubresourceRegion(textureArray, destSubresource, 0, 0, 0, textures[texElement], sourceSubresource, nullptr);
-    }
-
   D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
   viewDesc.Format = arrayDesc.Format;
   viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
@@ -79,14 +120,112 @@ HRESULT Texture::InitArray(
   viewDesc.Texture2DArray.ArraySize = textureCount;
 
   hr = device->CreateShaderResourceView(textureArray, &viewDesc, &g_pTextureView);
+  textureArray->Release();
+
+  return hr;
+}
+
+HRESULT Texture::InitAtlas(
+  ID3D11Device* device,
+  ID3D11DeviceContext* deviceContext,
+  const std::vector<const wchar_t*>& filenames,
+  AtlasLayout& layout,
+  UINT pageSize
+) {
+  Release();
+
+  HRESULT hr = S_OK;
+  auto textureCount = (UINT)filenames.size();
+
+  std::vector<ID3D11Texture2D*> textures(textureCount, nullptr);
+  auto releaseTextures = [&]() {
+    for (auto& tex : textures)
+      if (tex) tex->Release();
+  };
+
+  // Read and parse source textures in parallel, they may differ in size and mips count
+  std::vector<TextureSlice> slices;
+  std::vector<HRESULT> results;
+  SliceLoader::LoadAll(filenames, slices, results);
+
+  // Device calls stay on calling thread
+  std::vector<AtlasItem> items(textureCount);
+  for (UINT i = 0; i < textureCount && SUCCEEDED(hr); ++i) {
+    hr = results[i];
+    if (FAILED(hr))
+      break;
+
+    const DDSLayout& layout = slices[i].layout;
+    items[i] = { layout.width, layout.height, (uint32_t)slices[i].mips.size(), layout.format };
+
+    D3D11_TEXTURE2D_DESC desc;
+    desc.Width = layout.width;
+    desc.Height = layout.height;
+    desc.MipLevels = items[i].mipCount;
+    desc.ArraySize = 1;
+    desc.Format = layout.format;
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.CPUAccessFlags = 0;
+    desc.MiscFlags = 0;
+    std::vector<D3D11_SUBRESOURCE_DATA> initData;
+    FillInitData(slices[i], initData);
+    hr = device->CreateTexture2D(&desc, initData.data(), &textures[i]);
+  }
   if (FAILED(hr)) {
+    releaseTextures();
     return hr;
   }
-  
-  textureArray->Release();
+
+  if (!AtlasPacker::Build(items, pageSize, layout)) {
+    releaseTextures();
+    return E_INVALIDARG;
+  }
+
+  D3D11_TEXTURE2D_DESC atlasDesc;
+  atlasDesc.Width = layout.pageWidth;
+  atlasDesc.Height = layout.pageHeight;
+  atlasDesc.MipLevels = layout.mipCount;
+  atlasDesc.ArraySize = layout.pagesCount;
+  atlasDesc.Format = layout.format;
+  atlasDesc.SampleDesc.Count = 1;
+  atlasDesc.SampleDesc.Quality = 0;
+  atlasDesc.Usage = D3D11_USAGE_DEFAULT;
+  atlasDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+  atlasDesc.CPUAccessFlags = 0;
+  atlasDesc.MiscFlags = 0;
+
+  ID3D11Texture2D* atlas = nullptr;
+  hr = device->CreateTexture2D(&atlasDesc, 0, &atlas);
+  if (FAILED(hr)) {
+    releaseTextures();
+    return hr;
+  }
+
+  // Rect origins are aligned so every kept mip lands on block boundary
   for (UINT i = 0; i < textureCount; ++i) {
-    textures[i]->Release();
+    const AtlasRect& rect = layout.rects[i];
+    for (UINT mipLevel = 0; mipLevel < layout.mipCount; ++mipLevel) {
+      const UINT sourceSubresource = D3D11CalcSubresource(mipLevel, 0, items[i].mipCount);
+      const UINT destSubresource = D3D11CalcSubresource(mipLevel, rect.page, layout.mipCount);
+      deviceContext->CopySubresourceRegion(atlas, destSubresource, rect.x >> mipLevel, rect.y >> mipLevel, 0,
+        textures[i], sourceSubresource, nullptr);
+    }
   }
+  releaseTextures();
+
+  D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+  viewDesc.Format = atlasDesc.Format;
+  viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+  viewDesc.Texture2DArray.MostDetailedMip = 0;
+  viewDesc.Texture2DArray.MipLevels = atlasDesc.MipLevels;
+  viewDesc.Texture2DArray.FirstArraySlice = 0;
+  viewDesc.Texture2DArray.ArraySize = atlasDesc.ArraySize;
+
+  hr = device->CreateShaderResourceView(atlas, &viewDesc, &g_pTextureView);
+  atlas->Release();
 
   return hr;
 }
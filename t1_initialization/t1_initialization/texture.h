@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "DDSTextureLoader.h"
+#include "textureAtlas.h"
 
 class Texture {
 public:
@@ -12,7 +13,13 @@ public:
   // TODO: make more params in Ex initializing version
   HRESULT InitEx(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const wchar_t* filename);
   
-  HRESULT InitArray(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const std::vector<const wchar_t*>& filenames);
+  // Slices are read and parsed in parallel, sliceResults (optional) gets status of each file
+  HRESULT InitArray(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const std::vector<const wchar_t*>& filenames,
+    std::vector<HRESULT>* sliceResults = nullptr);
+
+  // Pack textures of any size (same format) into array of atlas pages, layout keeps uv rect of each texture
+  HRESULT InitAtlas(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const std::vector<const wchar_t*>& filenames,
+    AtlasLayout& layout, UINT pageSize = ATLAS_DEFAULT_PAGE_SIZE);
   
   void Release();
 
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <numeric>
+
+#include "textureAtlas.h"
+
+namespace {
+  uint32_t AlignUp(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+}
+
+uint32_t AtlasPacker::BlockSize(DXGI_FORMAT format) {
+  switch (format) {
+  case DXGI_FORMAT_BC1_TYPELESS:
+  case DXGI_FORMAT_BC1_UNORM:
+  case DXGI_FORMAT_BC1_UNORM_SRGB:
+  case DXGI_FORMAT_BC2_TYPELESS:
+  case DXGI_FORMAT_BC2_UNORM:
+  case DXGI_FORMAT_BC2_UNORM_SRGB:
+  case DXGI_FORMAT_BC3_TYPELESS:
+  case DXGI_FORMAT_BC3_UNORM:
+  case DXGI_FORMAT_BC3_UNORM_SRGB:
+  case DXGI_FORMAT_BC4_TYPELESS:
+  case DXGI_FORMAT_BC4_UNORM:
+  case DXGI_FORMAT_BC4_SNORM:
+  case DXGI_FORMAT_BC5_TYPELESS:
+  case DXGI_FORMAT_BC5_UNORM:
+  case DXGI_FORMAT_BC5_SNORM:
+  case DXGI_FORMAT_BC6H_TYPELESS:
+  case DXGI_FORMAT_BC6H_UF16:
+  case DXGI_FORMAT_BC6H_SF16:
+  case DXGI_FORMAT_BC7_TYPELESS:
+  case DXGI_FORMAT_BC7_UNORM:
+  case DXGI_FORMAT_BC7_UNORM_SRGB:
+    return 4;
+  default:
+    return 1;
+  }
+}
+
+bool AtlasPacker::FindPosition(const Page& page, uint32_t pageWidth, uint32_t pageHeight,
+  uint32_t width, uint32_t height, size_t& nodeIndex, uint32_t& x, uint32_t& y) {
+  bool found = false;
+  uint32_t bestTop = UINT32_MAX;
+  uint32_t bestWasted = UINT32_MAX;
+
+  for (size_t i = 0; i < page.skyline.size(); i++) {
+    uint32_t left = page.skyline[i].x;
+    if (left + width > pageWidth)
+      break;
+
+    // Rect lies on highest node it spans
+    uint32_t top = 0;
+    uint32_t right = left + width;
+    for (size_t j = i; j < page.skyline.size() && page.skyline[j].x < right; j++)
+      top = std::max(top, page.skyline[j].y);
+    if (top + height > pageHeight)
+      continue;
+
+    uint32_t area = 0;
+    for (size_t j = i; j < page.skyline.size() && page.skyline[j].x < right; j++) {
+      uint32_t spanEnd = std::min(right, page.skyline[j].x + page.skyline[j].width);
+      area += (top - page.skyline[j].y) * (spanEnd - page.skyline[j].x);
+    }
+
+    if (top + height < bestTop || (top + height == bestTop && area < bestWasted)) {
+      found = true;
+      bestTop = top + height;
+      bestWasted = area;
+      nodeIndex = i;
+      x = left;
+      y = top;
+    }
+  }
+
+  return found;
+}
+
+void AtlasPacker::AddRect(Page& page, size_t nodeIndex, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+  auto& skyline = page.skyline;
+  skyline.insert(skyline.begin() + nodeIndex, SkylineNode{ x, y + height, width });
+
+  // Cut nodes hidden under new one
+  uint32_t right = x + width;
+  size_t i = nodeIndex + 1;
+  while (i < skyline.size() && skyline[i].x < right) {
+    uint32_t nodeRight = skyline[i].x + skyline[i].width;
+    if (nodeRight <= right) {
+      skyline.erase(skyline.begin() + i);
+    } else {
+      skyline[i].width = nodeRight - right;
+      skyline[i].x = right;
+      break;
+    }
+  }
+
+  // Merge neighbours on same level
+  for (i = 0; i + 1 < skyline.size();) {
+    if (skyline[i].y == skyline[i + 1].y) {
+      skyline[i].width += skyline[i + 1].width;
+      skyline.erase(skyline.begin() + i + 1);
+    } else {
+      i++;
+    }
+  }
+}
+
+uint32_t AtlasPacker::Pack(uint32_t pageWidth, uint32_t pageHeight, uint32_t alignment, std::vector<AtlasRect>& rects) {
+  if (pageWidth == 0 || pageHeight == 0 || alignment == 0)
+    return 0;
+
+  // Tall rects first gives flatter skyline
+  std::vector<size_t> order(rects.size());
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (rects[a].height != rects[b].height)
+      return rects[a].height > rects[b].height;
+    return rects[a].width > rects[b].width;
+  });
+
+  std::vector<Page> pages;
+  for (size_t index : order) {
+    AtlasRect& rect = rects[index];
+    uint32_t width = AlignUp(rect.width, alignment);
+    uint32_t height = AlignUp(rect.height, alignment);
+    if (rect.width == 0 || rect.height == 0 || width > pageWidth || height > pageHeight)
+      return 0;
+
+    bool placed = false;
+    for (size_t p = 0; p < pages.size() && !placed; p++) {
+      size_t nodeIndex = 0;
+      uint32_t x = 0, y = 0;
+      if (FindPosition(pages[p], pageWidth, pageHeight, width, height, nodeIndex, x, y)) {
+        AddRect(pages[p], nodeIndex, x, y, width, height);
+        rect.x = x;
+        rect.y = y;
+        rect.page = (uint32_t)p;
+        placed = true;
+      }
+    }
+
+    if (!placed) {
+      // Fresh page always fits, size was checked above
+      Page page;
+      page.skyline.push_back(SkylineNode{ 0, 0, pageWidth });
+      AddRect(page, 0, 0, 0, width, height);
+      pages.push_back(page);
+
+      rect.x = 0;
+      rect.y = 0;
+      rect.page = (uint32_t)(pages.size() - 1);
+    }
+  }
+
+  return (uint32_t)pages.size();
+}
+
+bool AtlasPacker::Build(const std::vector<AtlasItem>& items, uint32_t pageSize, AtlasLayout& layout) {
+  layout = AtlasLayout();
+  if (items.empty() || pageSize == 0)
+    return false;
+
+  // Slices of one array must share format
+  DXGI_FORMAT format = items[0].format;
+  uint32_t mipCount = UINT32_MAX;
+  uint32_t minSide = UINT32_MAX;
+  for (auto& item : items) {
+    if (item.format != format || item.width == 0 || item.height == 0 || item.mipCount == 0)
+      return false;
+    mipCount = std::min(mipCount, item.mipCount);
+    minSide = std::min(minSide, std::min(item.width, item.height));
+  }
+
+  // Rect origin must stay on block boundary down to the last kept mip,
+  // alignment is not allowed to be bigger than smallest item to keep padding sane
+  uint32_t blockSize = BlockSize(format);
+  while (mipCount > 1 && (uint64_t(blockSize) << (mipCount - 1)) > std::min(minSide, pageSize))
+    mipCount--;
+  uint32_t alignment = blockSize << (mipCount - 1);
+
+  layout.rects.resize(items.size());
+  for (size_t i = 0; i < items.size(); i++) {
+    layout.rects[i].width = items[i].width;
+    layout.rects[i].height = items[i].height;
+  }
+
+  uint32_t pagesCount = Pack(pageSize, pageSize, alignment, layout.rects);
+  if (pagesCount == 0) {
+    layout.rects.clear();
+    return false;
+  }
+
+  // Single page is trimmed to used area
+  uint32_t pageWidth = pageSize;
+  uint32_t pageHeight = pageSize;
+  if (pagesCount == 1) {
+    pageWidth = pageHeight = 0;
+    for (auto& rect : layout.rects) {
+      pageWidth = std::max(pageWidth, AlignUp(rect.x + rect.width, alignment));
+      pageHeight = std::max(pageHeight, AlignUp(rect.y + rect.height, alignment));
+    }
+  }
+
+  // Rects touch each other, so uv range is inset by half texel of the last kept mip.
+  // Bilinear taps of every kept mip stay inside rect and don't blend neighbour materials
+  float inset = 0.5f * (float)(1u << (mipCount - 1));
+  for (auto& rect : layout.rects) {
+    rect.uvScaleOffset = XMFLOAT4(
+      (rect.width - 2.0f * inset) / pageWidth,
+      (rect.height - 2.0f * inset) / pageHeight,
+      (rect.x + inset) / pageWidth,
+      (rect.y + inset) / pageHeight);
+  }
+
+  layout.pageWidth = pageWidth;
+  layout.pageHeight = pageHeight;
+  layout.pagesCount = pagesCount;
+  layout.mipCount = mipCount;
+  layout.alignment = alignment;
+  layout.format = format;
+  return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <directxmath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+// Atlas page size used when caller does not set its own
+#define ATLAS_DEFAULT_PAGE_SIZE 2048
+
+// Source texture description (top level size and its mip chain)
+struct AtlasItem {
+  uint32_t width;
+  uint32_t height;
+  uint32_t mipCount;
+  DXGI_FORMAT format;
+};
+
+// Item placement in atlas, in top level texels of page
+struct AtlasRect {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+  uint32_t page;
+  XMFLOAT4 uvScaleOffset; // xy - scale, zw - offset, applied to item uv in [0, 1], inset by half texel of last mip
+};
+
+struct AtlasLayout {
+  uint32_t pageWidth = 0;
+  uint32_t pageHeight = 0;
+  uint32_t pagesCount = 0;
+  uint32_t mipCount = 0;
+  uint32_t alignment = 0;
+  DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+  std::vector<AtlasRect> rects; // same order as items
+};
+
+// Skyline bottom-left bin packer for texture atlas pages / array slices.
+// Device free, so it also runs in offline tools on any platform.
+class AtlasPacker {
+public:
+  // Place rects into as few pages as possible, every rect is placed on 'alignment' boundary.
+  // Only width and height of rects are read, returns pages count or 0 if some rect can't fit the page.
+  static uint32_t Pack(uint32_t pageWidth, uint32_t pageHeight, uint32_t alignment, std::vector<AtlasRect>& rects);
+
+  // Build full atlas layout for items of the same format.
+  // Mip count is reduced so each rect starts on block boundary in every kept mip.
+  static bool Build(const std::vector<AtlasItem>& items, uint32_t pageSize, AtlasLayout& layout);
+
+private:
+  struct SkylineNode {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+  };
+
+  // Page skyline, sorted by x and covers whole page width
+  struct Page {
+    std::vector<SkylineNode> skyline;
+  };
+
+  static bool FindPosition(const Page& page, uint32_t pageWidth, uint32_t pageHeight,
+    uint32_t width, uint32_t height, size_t& nodeIndex, uint32_t& x, uint32_t& y);
+  static void AddRect(Page& page, size_t nodeIndex, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+  static uint32_t BlockSize(DXGI_FORMAT format);
+};
@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "threadPool.h"
+
+ThreadPool& ThreadPool::GetInstance() {
+  static ThreadPool poolInstance;
+  return poolInstance;
+}
+
+ThreadPool::ThreadPool() {
+  // Leave one core for the calling (render) thread
+  uint32_t threadsCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+  for (uint32_t i = 0; i < threadsCount; i++)
+    workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    stopping = true;
+  }
+  jobsCV.notify_all();
+
+  for (auto& worker : workers)
+    worker.join();
+}
+
+void ThreadPool::RunChunks(DispatchState& state) {
+  for (;;) {
+    uint32_t chunk = state.nextChunk.fetch_add(1);
+    if (chunk >= state.chunksCount)
+      return;
+
+    uint32_t begin = chunk * state.chunkSize;
+    uint32_t end = std::min(begin + state.chunkSize, state.count);
+    state.func(state.context, begin, end);
+  }
+}
+
+void ThreadPool::WorkerLoop() {
+  for (;;) {
+    DispatchState* state;
+    {
+      std::unique_lock<std::mutex> lock(jobsMutex);
+      jobsCV.wait(lock, [this] { return stopping || jobsCount > 0; });
+      if (stopping && jobsCount == 0)
+        return;
+      Job job = jobs[jobsHead];
+      jobsHead = (jobsHead + 1) % THREAD_POOL_JOBS_CAPACITY;
+      jobsCount--;
+
+      // Caller already did all the chunks and may have reused the state
+      state = &states[job.state];
+      if (state->generation != job.generation)
+        continue;
+      state->helpersCount++;
+    }
+
+    RunChunks(*state);
+
+    {
+      std::lock_guard<std::mutex> lock(jobsMutex);
+      state->helpersCount--;
+    }
+    doneCV.notify_all();
+  }
+}
+
+void ThreadPool::Dispatch(uint32_t count, uint32_t minChunk, ChunkFunc func, const void* context) {
+  if (count == 0)
+    return;
+
+  uint32_t threadsCount = GetWorkersCount() + 1;
+  uint32_t chunkSize = std::max(std::max(minChunk, 1u), (count + threadsCount * 4 - 1) / (threadsCount * 4));
+  uint32_t chunksCount = (count + chunkSize - 1) / chunkSize;
+
+  // Not worth waking anybody up
+  if (chunksCount == 1 || threadsCount == 1) {
+    func(context, 0, count);
+    return;
+  }
+
+  uint32_t stateIndex = 0;
+  for (; stateIndex < THREAD_POOL_MAX_DISPATCHES; stateIndex++) {
+    bool expected = false;
+    if (states[stateIndex].inUse.compare_exchange_strong(expected, true))
+      break;
+  }
+  // Every state is busy with deeper nesting than the pool can help with
+  if (stateIndex == THREAD_POOL_MAX_DISPATCHES) {
+    func(context, 0, count);
+    return;
+  }
+
+  DispatchState& state = states[stateIndex];
+  state.func = func;
+  state.context = context;
+  state.count = count;
+  state.chunkSize = chunkSize;
+  state.chunksCount = chunksCount;
+  state.nextChunk.store(0);
+
+  uint32_t helpersCount = std::min(chunksCount - 1, GetWorkersCount());
+  {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    helpersCount = std::min(helpersCount, (uint32_t)THREAD_POOL_JOBS_CAPACITY - jobsCount);
+    for (uint32_t i = 0; i < helpersCount; i++)
+      jobs[(jobsHead + jobsCount++) % THREAD_POOL_JOBS_CAPACITY] = { stateIndex, state.generation };
+  }
+  if (helpersCount == 1)
+    jobsCV.notify_one();
+  else if (helpersCount > 1)
+    jobsCV.notify_all();
+
+  RunChunks(state);
+
+  // Chunks are all taken: helpers still queued turn stale, running ones are waited for
+  {
+    std::unique_lock<std::mutex> lock(jobsMutex);
+    state.generation++;
+    doneCV.wait(lock, [&state] { return state.helpersCount == 0; });
+  }
+  state.inUse.store(false);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Dispatches running at once (nested calls from workers included), extra ones run serially
+#define THREAD_POOL_MAX_DISPATCHES 64
+// Fixed ring of queued helper jobs, dispatch gets fewer helpers when it is full
+#define THREAD_POOL_JOBS_CAPACITY 256
+
+// Worker pool for CPU-side jobs (mip generation, asset loading, etc.)
+// Dispatch doesn't touch the heap: states and helper jobs live in fixed arrays of the pool
+class ThreadPool {
+public:
+  typedef void (*ChunkFunc)(const void* context, uint32_t begin, uint32_t end);
+
+  // Make class singleton
+  static ThreadPool& GetInstance();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+
+  ~ThreadPool();
+
+  // Run func(begin, end) over [0, count) split in chunks of at least minChunk items.
+  // Calling thread takes part in the work and returns when all chunks are done.
+  template<typename Func>
+  void ParallelFor(uint32_t count, uint32_t minChunk, const Func& func) {
+    Dispatch(count, minChunk, [](const void* context, uint32_t begin, uint32_t end) {
+      (*static_cast<const Func*>(context))(begin, end);
+    }, &func);
+  };
+
+  // Same as ParallelFor with type erased func, context must outlive the call
+  void Dispatch(uint32_t count, uint32_t minChunk, ChunkFunc func, const void* context);
+
+  uint32_t GetWorkersCount() const { return (uint32_t)workers.size(); };
+private:
+  // Reused between dispatches, generation and helpersCount are guarded by jobsMutex
+  struct DispatchState {
+    ChunkFunc func = nullptr;
+    const void* context = nullptr;
+    uint32_t count = 0;
+    uint32_t chunkSize = 1;
+    uint32_t chunksCount = 0;
+    std::atomic<uint32_t> nextChunk{ 0 };
+    std::atomic<bool> inUse{ false };
+    uint32_t generation = 0;
+    uint32_t helpersCount = 0;
+  };
+
+  // Helper job is stale once generation of its state has moved on
+  struct Job {
+    uint32_t state;
+    uint32_t generation;
+  };
+
+  // Private constructor (for singleton)
+  ThreadPool();
+
+  void WorkerLoop();
+  static void RunChunks(DispatchState& state);
+
+  std::vector<std::thread> workers;
+  DispatchState states[THREAD_POOL_MAX_DISPATCHES];
+  Job jobs[THREAD_POOL_JOBS_CAPACITY];
+  uint32_t jobsHead = 0;
+  uint32_t jobsCount = 0;
+  std::mutex jobsMutex;
+  std::condition_variable jobsCV;
+  std::condition_variable doneCV;
+  bool stopping = false;
+};
@@ -1,12 +1,6 @@
 #include "constants.h"
 #include "lightCalc.h"
 
-cbuffer TransWorldMatrixCB : register (b0)
-{
-  float4x4 worldMatrix;
-  float4 color;
-};
-
 cbuffer TransSceneCB : register (b1)
 {
   float4x4 viewProjectionMatrix;
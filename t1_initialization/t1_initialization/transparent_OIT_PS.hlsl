@@ -0,0 +1,31 @@
+#include "transparentCB.h"
+#include "oitCalc.h"
+
+struct PS_INPUT {
+  float4 position : SV_POSITION;
+  float4 worldPos : POSITION;
+  nointerpolation float4 color : COLOR;
+  float viewDepth : VIEW_DEPTH;
+};
+
+// Accumulation target is blended ONE, ONE, revealage - ZERO, INV_SRC_COLOR
+struct PS_OUTPUT {
+  float4 accum : SV_TARGET0;
+  float revealage : SV_TARGET1;
+};
+
+PS_OUTPUT main(PS_INPUT input) {
+  float3 color = CalculateColor(
+    input.color.xyz,
+    float3(1, 0, 0),
+    input.worldPos.xyz,
+    0.0,
+    true);
+  float alpha = input.color.w;
+  float w = OITWeight(alpha, input.viewDepth);
+
+  PS_OUTPUT output;
+  output.accum = float4(color * alpha, alpha) * w;
+  output.revealage = alpha;
+  return output;
+}
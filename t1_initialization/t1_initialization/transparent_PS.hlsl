@@ -3,15 +3,16 @@
 struct PS_INPUT {
   float4 position : SV_POSITION;
   float4 worldPos : POSITION;
+  nointerpolation float4 color : COLOR;
 };
 
 float4 main(PS_INPUT input) : SV_TARGET{
     return float4(
       CalculateColor(
-        color.xyz,
+        input.color.xyz,
         float3(1, 0, 0),
         input.worldPos.xyz,
         0.0,
         true),
-      color.w);
+      input.color.w);
 }
@@ -3,20 +3,33 @@
 struct VS_INPUT
 {
   float4 position : POSITION;
+  // per instance, rows of the world matrix as stored on CPU
+  float4 world0 : WORLD0;
+  float4 world1 : WORLD1;
+  float4 world2 : WORLD2;
+  float4 world3 : WORLD3;
+  float4 color : COLOR;
 };
 
 struct PS_INPUT {
   float4 position : SV_POSITION;
   float4 worldPos : POSITION;
+  nointerpolation float4 color : COLOR;
+  float viewDepth : VIEW_DEPTH; // used by OIT weight only
 };
 
 PS_INPUT main(VS_INPUT input) {
   PS_INPUT output;
 
-  output.worldPos = mul(worldMatrix, input.position);
+  float4x4 worldMatrix = float4x4(input.world0, input.world1, input.world2, input.world3);
+
+  // Rows are not transposed here (unlike cbuffer packing), so vector goes on the left
+  output.worldPos = mul(input.position, worldMatrix);
   output.position = mul(viewProjectionMatrix,
     output.worldPos
   );
+  output.color = input.color;
+  output.viewDepth = output.position.w;
 
   return output;
 }
@@ -0,0 +1,16 @@
+// Decode of quantized vertex attributes, encoded by VertexQuantizer
+
+// pos - R16G16B16A16_UNORM fetched value, relative to mesh bounds
+float3 DecodePosition(float3 pos, float4 posScale, float4 posOffset)
+{
+  return pos * posScale.xyz + posOffset.xyz;
+}
+
+// e - R16G16_SNORM fetched octahedral encoded unit vector
+float3 OctDecode(float2 e)
+{
+  float3 v = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+  float t = saturate(-v.z);
+  v.xy += (v.xy >= 0.0f) ? -t : t;
+  return normalize(v);
+}
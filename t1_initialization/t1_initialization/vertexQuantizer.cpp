@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <DirectXPackedVector.h>
+
+#include "vertexQuantizer.h"
+
+using namespace DirectX::PackedVector;
+
+namespace {
+  const float UNORM16_MAX = 65535.0f;
+  const float SNORM16_MAX = 32767.0f;
+
+  uint16_t QuantizeUnorm16(float value, float offset, float scale) {
+    float unorm = scale > 0.0f ? (value - offset) / scale : 0.0f;
+    unorm = (std::min)(std::max<float>(unorm, 0.0f), 1.0f);
+    return (uint16_t)(unorm * UNORM16_MAX + 0.5f);
+  }
+
+  int16_t QuantizeSnorm16(float value) {
+    value = (std::min)(std::max<float>(value, -1.0f), 1.0f);
+    return (int16_t)std::lround(value * SNORM16_MAX);
+  }
+
+  float SignNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+  }
+
+  void EncodePosition(const XMFLOAT3& pos, const VertexQuantization& quantization, uint16_t result[4]) {
+    result[0] = QuantizeUnorm16(pos.x, quantization.posOffset.x, quantization.posScale.x);
+    result[1] = QuantizeUnorm16(pos.y, quantization.posOffset.y, quantization.posScale.y);
+    result[2] = QuantizeUnorm16(pos.z, quantization.posOffset.z, quantization.posScale.z);
+    result[3] = (uint16_t)UNORM16_MAX; // w = 1, so position can be used as float4 point
+  }
+
+  XMFLOAT3 DecodePosition(const uint16_t pos[4], const VertexQuantization& quantization) {
+    return XMFLOAT3(
+      pos[0] / UNORM16_MAX * quantization.posScale.x + quantization.posOffset.x,
+      pos[1] / UNORM16_MAX * quantization.posScale.y + quantization.posOffset.y,
+      pos[2] / UNORM16_MAX * quantization.posScale.z + quantization.posOffset.z);
+  }
+}
+
+VertexQuantization VertexQuantizer::ComputeQuantization(const XMFLOAT3* positions, size_t count, size_t stride) {
+  XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+  XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(positions);
+  for (size_t i = 0; i < count; i++) {
+    const XMFLOAT3& pos = *reinterpret_cast<const XMFLOAT3*>(data + i * stride);
+    boundsMin = XMFLOAT3((std::min)(boundsMin.x, pos.x), (std::min)(boundsMin.y, pos.y), (std::min)(boundsMin.z, pos.z));
+    boundsMax = XMFLOAT3(std::max<float>(boundsMax.x, pos.x), std::max<float>(boundsMax.y, pos.y), std::max<float>(boundsMax.z, pos.z));
+  }
+
+  VertexQuantization quantization;
+  if (count == 0) {
+    quantization.posScale = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+    quantization.posOffset = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+    return quantization;
+  }
+
+  // Flat axis gets zero scale, all its vertices decode exactly to offset
+  quantization.posScale = XMFLOAT4(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z, 0.0f);
+  quantization.posOffset = XMFLOAT4(boundsMin.x, boundsMin.y, boundsMin.z, 1.0f);
+  return quantization;
+}
+
+VertexQuantization VertexQuantizer::Encode(const TexVertex* vertices, size_t count, QuantizedTexVertex* result) {
+  VertexQuantization quantization = ComputeQuantization(&vertices[0].pos, count, sizeof(TexVertex));
+
+  for (size_t i = 0; i < count; i++) {
+    EncodePosition(vertices[i].pos, quantization, result[i].pos);
+    result[i].uv[0] = XMConvertFloatToHalf(vertices[i].uv.x);
+    result[i].uv[1] = XMConvertFloatToHalf(vertices[i].uv.y);
+    OctEncode(vertices[i].normal, result[i].normal);
+    OctEncode(vertices[i].tangent, result[i].tangent);
+  }
+
+  return quantization;
+}
+
+VertexQuantization VertexQuantizer::Encode(const SimpleVertex* vertices, size_t count, QuantizedSimpleVertex* result) {
+  static_assert(sizeof(SimpleVertex) == sizeof(XMFLOAT3), "SimpleVertex is expected to be a plain position");
+  VertexQuantization quantization = ComputeQuantization(reinterpret_cast<const XMFLOAT3*>(vertices), count, sizeof(SimpleVertex));
+
+  for (size_t i = 0; i < count; i++)
+    EncodePosition(XMFLOAT3(vertices[i].x, vertices[i].y, vertices[i].z), quantization, result[i].pos);
+
+  return quantization;
+}
+
+void VertexQuantizer::Decode(const QuantizedTexVertex* vertices, size_t count, const VertexQuantization& quantization, TexVertex* result) {
+  for (size_t i = 0; i < count; i++) {
+    result[i].pos = DecodePosition(vertices[i].pos, quantization);
+    result[i].uv = XMFLOAT2(XMConvertHalfToFloat(vertices[i].uv[0]), XMConvertHalfToFloat(vertices[i].uv[1]));
+    result[i].normal = OctDecode(vertices[i].normal);
+    result[i].tangent = OctDecode(vertices[i].tangent);
+  }
+}
+
+void VertexQuantizer::Decode(const QuantizedSimpleVertex* vertices, size_t count, const VertexQuantization& quantization, SimpleVertex* result) {
+  for (size_t i = 0; i < count; i++) {
+    XMFLOAT3 pos = DecodePosition(vertices[i].pos, quantization);
+    result[i] = { pos.x, pos.y, pos.z };
+  }
+}
+
+XMMATRIX VertexQuantizer::DecodeMatrix(const VertexQuantization& quantization) {
+  return XMMatrixScaling(quantization.posScale.x, quantization.posScale.y, quantization.posScale.z) *
+    XMMatrixTranslation(quantization.posOffset.x, quantization.posOffset.y, quantization.posOffset.z);
+}
+
+XMFLOAT3 VertexQuantizer::PositionErrorBound(const VertexQuantization& quantization) {
+  // Half of quantization step plus float rounding of decode at bounds magnitude
+  float step = 0.5f / UNORM16_MAX;
+  float rounding = 2.0f * FLT_EPSILON;
+  return XMFLOAT3(
+    quantization.posScale.x * step + (fabsf(quantization.posOffset.x) + quantization.posScale.x) * rounding,
+    quantization.posScale.y * step + (fabsf(quantization.posOffset.y) + quantization.posScale.y) * rounding,
+    quantization.posScale.z * step + (fabsf(quantization.posOffset.z) + quantization.posScale.z) * rounding);
+}
+
+void VertexQuantizer::OctEncode(const XMFLOAT3& vector, int16_t result[2]) {
+  float l1 = fabsf(vector.x) + fabsf(vector.y) + fabsf(vector.z);
+  if (l1 == 0.0f) {
+    result[0] = 0;
+    result[1] = 0;
+    return;
+  }
+
+  // Project onto octahedron, fold lower hemisphere over the diagonals
+  float x = vector.x / l1;
+  float y = vector.y / l1;
+  if (vector.z < 0.0f) {
+    float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+    float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+    x = foldedX;
+    y = foldedY;
+  }
+
+  result[0] = QuantizeSnorm16(x);
+  result[1] = QuantizeSnorm16(y);
+}
+
+XMFLOAT3 VertexQuantizer::OctDecode(const int16_t encoded[2]) {
+  // Same as snorm fetch on GPU: -32768 maps to -1 as well
+  float x = std::max<float>(encoded[0] / SNORM16_MAX, -1.0f);
+  float y = std::max<float>(encoded[1] / SNORM16_MAX, -1.0f);
+  float z = 1.0f - fabsf(x) - fabsf(y);
+
+  float t = std::max<float>(-z, 0.0f);
+  x += x >= 0.0f ? -t : t;
+  y += y >= 0.0f ? -t : t;
+
+  XMFLOAT3 result;
+  XMStoreFloat3(&result, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+  return result;
+}
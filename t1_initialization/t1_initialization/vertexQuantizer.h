@@ -0,0 +1,35 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "def.h"
+
+using namespace DirectX;
+
+// Vertex compression: 16-bit positions relative to mesh bounds, half float uv,
+// octahedral 16-bit normals and tangents. Device free, decode on GPU is in vertexDecode.h
+class VertexQuantizer {
+public:
+  // Bounds of all positions, stride in bytes between consecutive positions
+  static VertexQuantization ComputeQuantization(const XMFLOAT3* positions, size_t count, size_t stride);
+
+  // 44 -> 20 bytes
+  static VertexQuantization Encode(const TexVertex* vertices, size_t count, QuantizedTexVertex* result);
+  // 12 -> 8 bytes
+  static VertexQuantization Encode(const SimpleVertex* vertices, size_t count, QuantizedSimpleVertex* result);
+
+  static void Decode(const QuantizedTexVertex* vertices, size_t count, const VertexQuantization& quantization, TexVertex* result);
+  static void Decode(const QuantizedSimpleVertex* vertices, size_t count, const VertexQuantization& quantization, SimpleVertex* result);
+
+  // Object space transform from quantized [0, 1] coords, can be folded into world matrix
+  static XMMATRIX DecodeMatrix(const VertexQuantization& quantization);
+
+  // Worst case position error per axis after decode
+  static XMFLOAT3 PositionErrorBound(const VertexQuantization& quantization);
+
+  // Octahedral encoding of unit vector into two snorm16 values
+  static void OctEncode(const XMFLOAT3& vector, int16_t result[2]);
+  static XMFLOAT3 OctDecode(const int16_t encoded[2]);
+};
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "allocTracker.h"
+#include "depthSorter.h"
+#include "ecs.h"
+#include "frameArena.h"
+#include "simulation.h"
+#include "threadPool.h"
+#include "testCommon.h"
+
+// Headless -alloccheck: frame loop of device-free systems in strict mode,
+// every frame after warm up must not touch the heap on any thread
+namespace {
+  const uint32_t BOXES_COUNT = 20000;
+  // Over DEPTH_SORT_PARALLEL_MIN, so sort goes through thread pool
+  const uint32_t PLANES_COUNT = 20000;
+  const uint32_t WARMUP_FRAMES = 10;
+  const uint32_t CHECK_FRAMES = 200;
+
+  void FillWorld(World& world) {
+    TestRandom random(7);
+    for (uint32_t i = 0; i < BOXES_COUNT; i++) {
+      Entity entity = world.Create<PositionComponent, SpinComponent, MaterialComponent, TransformComponent, BoundsComponent>();
+      world.Get<PositionComponent>(entity)->position = XMFLOAT4(random.Range(-50.0f, 50.0f), random.Range(-5.0f, 5.0f), random.Range(-50.0f, 50.0f), 1.0f);
+      world.Get<SpinComponent>(entity)->speed = random.Range(0.2f, 2.0f);
+    }
+    for (uint32_t i = 0; i < PLANES_COUNT; i++) {
+      Entity entity = world.Create<PositionComponent, OscillationComponent, TransformComponent, ColorComponent>();
+      world.Get<PositionComponent>(entity)->position = XMFLOAT4(random.Range(-50.0f, 50.0f), 1.0f, random.Range(-50.0f, 50.0f), 1.0f);
+      *world.Get<OscillationComponent>(entity) = { XMFLOAT4(0.0f, 0.5f, 0.25f, 0.0f), 2.0f };
+    }
+  }
+
+  // Same work render thread does with components each frame
+  void UpdateBounds(World& world) {
+    world.ParallelForEachChunk<TransformComponent, BoundsComponent>(
+      [](uint32_t count, const Entity*, TransformComponent* transforms, BoundsComponent* bounds) {
+        for (uint32_t i = 0; i < count; i++) {
+          XMMATRIX m = XMLoadFloat4x4(&transforms[i].world);
+          XMVECTOR extent = XMVectorAdd(XMVectorAdd(XMVectorAbs(m.r[0]), XMVectorAbs(m.r[1])), XMVectorAbs(m.r[2]));
+          XMStoreFloat4(&bounds[i].min, XMVectorSubtract(m.r[3], extent));
+          XMStoreFloat4(&bounds[i].max, XMVectorAdd(m.r[3], extent));
+        }
+      });
+  }
+
+  void SortPlanes(World& world, DepthSorter& sorter, std::vector<uint32_t>& order) {
+    FrameVector<XMMATRIX> matrices;
+    matrices.reserve(world.Count<OscillationComponent, TransformComponent>());
+    world.ForEachChunk<OscillationComponent, TransformComponent>(
+      [&](uint32_t count, const Entity*, OscillationComponent*, TransformComponent* transforms) {
+        for (uint32_t i = 0; i < count; i++)
+          matrices.push_back(XMLoadFloat4x4(&transforms[i].world));
+      });
+    XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 10.0f, -60.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    sorter.SortBackToFront(matrices.data(), matrices.size(), view, order);
+  }
+
+  // Workers dispatch from inside their own chunks, as mip generation of parallel slice loading does
+  uint64_t RunNestedJobs() {
+    std::atomic<uint64_t> sum{ 0 };
+    ThreadPool::GetInstance().ParallelFor(64, 1, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; i++)
+        ThreadPool::GetInstance().ParallelFor(1000, 16, [&](uint32_t innerBegin, uint32_t innerEnd) {
+          uint64_t local = 0;
+          for (uint32_t j = innerBegin; j < innerEnd; j++)
+            local += j + 1;
+          sum.fetch_add(local);
+        });
+    });
+    return sum.load();
+  }
+
+  void TestFrameLoop() {
+    World world;
+    FillWorld(world);
+    Simulation simulation;
+    simulation.SetReplay(true);
+    simulation.Init(world);
+    DepthSorter sorter;
+    std::vector<uint32_t> order;
+    bool nestedOk = true;
+
+    AllocTracker& allocs = AllocTracker::GetInstance();
+    allocs.SetStrict(WARMUP_FRAMES);
+    uint32_t framesCount = 0;
+    TestClock::time_point start = TestClock::now();
+    for (uint32_t frame = 0; frame < WARMUP_FRAMES + CHECK_FRAMES; frame++) {
+      {
+        AllocScope scope("simulation");
+        simulation.Frame(world);
+      }
+      {
+        AllocScope scope("bounds");
+        UpdateBounds(world);
+      }
+      {
+        AllocScope scope("depth sort");
+        SortPlanes(world, sorter, order);
+      }
+      {
+        AllocScope scope("nested jobs");
+        nestedOk = nestedOk && RunNestedJobs() == 64ull * 1000 * 1001 / 2;
+      }
+      FrameArena::ResetAll();
+      allocs.EndFrame();
+      framesCount++;
+    }
+    double frameMs = ElapsedMs(start) / framesCount;
+
+    printf("frame loop: %u frames (%u warm up), %.2f ms per frame, %u workers, peak frame %llu allocations, %u violations\n",
+      framesCount, WARMUP_FRAMES, frameMs, ThreadPool::GetInstance().GetWorkersCount(),
+      (unsigned long long)allocs.GetPeakFrameStats().count, allocs.GetViolationsCount());
+    CHECK(allocs.GetViolationsCount() == 0);
+    CHECK(nestedOk);
+    CHECK(order.size() == PLANES_COUNT);
+  }
+
+  // Tracker itself sees allocations of steady frames, so zero above means zero
+  void TestViolationIsCaught() {
+    static void* volatile sink;
+    AllocTracker& allocs = AllocTracker::GetInstance();
+    allocs.SetStrict(0);
+    sink = new int[16];
+    delete[] static_cast<int*>(sink);
+    allocs.EndFrame();
+    CHECK(allocs.GetViolationsCount() == 1);
+    CHECK(allocs.GetLastFrameStats().count == 1);
+  }
+}
+
+int main() {
+  TestFrameLoop();
+  TestViolationIsCaught();
+  return TestResult();
+}
@@ -0,0 +1,247 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "assetArchive.h"
+#include "testCommon.h"
+
+// Pack / open / load round trip of loose files, name normalization and damaged archives.
+// Files are written to working directory with archiveTest prefix and removed at the end
+namespace {
+  const wchar_t* ARCHIVE_PATH = L"archiveTest.pak";
+  const char* ARCHIVE_PATH_UTF8 = "archiveTest.pak";
+
+  std::string FileName(uint32_t index) {
+    char name[64];
+    snprintf(name, sizeof(name), "archiveTest_%u.bin", index);
+    return name;
+  }
+
+  std::wstring Widen(const std::string& text) {
+    return std::wstring(text.begin(), text.end());
+  }
+
+  bool WriteBytes(const char* path, const std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "wb");
+    if (!file)
+      return false;
+    bool ok = data.empty() || fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && ok;
+  }
+
+  std::vector<uint8_t> ReadBytes(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* file = fopen(path, "rb");
+    if (!file)
+      return data;
+    uint8_t buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+      data.insert(data.end(), buffer, buffer + count);
+    fclose(file);
+    return data;
+  }
+
+  // Sizes around alignment boundary, empty one included
+  std::vector<std::vector<uint8_t>> WriteFiles(uint32_t count, uint32_t maxSize, std::vector<std::wstring>& paths) {
+    const uint32_t edgeSizes[] = { 0, 1, ARCHIVE_ALIGNMENT - 1, ARCHIVE_ALIGNMENT, ARCHIVE_ALIGNMENT + 1 };
+    TestRandom random(count);
+    std::vector<std::vector<uint8_t>> contents(count);
+    paths.clear();
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t size = i < 5 ? edgeSizes[i] : random.Next() % maxSize;
+      contents[i].resize(size);
+      for (auto& byte : contents[i])
+        byte = (uint8_t)(random.Next() >> 24);
+      CHECK(WriteBytes(FileName(i).c_str(), contents[i]));
+      paths.push_back(Widen(FileName(i)));
+    }
+    return contents;
+  }
+
+  void RemoveFiles(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+      remove(FileName(i).c_str());
+    remove(ARCHIVE_PATH_UTF8);
+  }
+
+  void TestRoundTrip(bool compress) {
+    const uint32_t filesCount = 40;
+    std::vector<std::wstring> paths;
+    std::vector<std::vector<uint8_t>> contents = WriteFiles(filesCount, 20000, paths);
+    CHECK(SUCCEEDED(AssetArchive::Pack(ARCHIVE_PATH, paths, compress)));
+
+    AssetArchive& archive = AssetArchive::GetInstance();
+    CHECK(SUCCEEDED(archive.Open(ARCHIVE_PATH)));
+
+    uint32_t matched = 0;
+    for (uint32_t i = 0; i < filesCount; i++) {
+      AssetData asset;
+      HRESULT hr = archive.Load(FileName(i).c_str(), asset);
+      bool equal = SUCCEEDED(hr) && asset.size == contents[i].size() &&
+        (asset.size == 0 || memcmp(asset.data, contents[i].data(), asset.size) == 0);
+      CHECK(equal);
+      matched += equal;
+
+      // Raw entries point straight into aligned mapped data
+      if (asset.size > 0 && asset.storage.empty()) {
+        CHECK(archive.IsMapped(asset.data));
+        CHECK(reinterpret_cast<uintptr_t>(asset.data) % ARCHIVE_ALIGNMENT == 0);
+      }
+    }
+
+    AssetData missing;
+    CHECK(archive.Load("archiveTest_missing.bin", missing) == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+    CHECK(!archive.Contains(L"archiveTest_missing.bin"));
+    archive.Close();
+    CHECK(!archive.IsOpen());
+
+    printf("round trip%s: %u of %u files match\n", compress ? " (compress requested)" : "", matched, filesCount);
+    RemoveFiles(filesCount);
+  }
+
+  // Case, separators and leading "./" don't matter, wide and UTF-8 names hash the same
+  void TestNames() {
+    std::vector<std::wstring> paths;
+    std::vector<std::vector<uint8_t>> contents = WriteFiles(3, 100, paths);
+    paths[2] = L"./" + paths[2];
+    CHECK(SUCCEEDED(AssetArchive::Pack(ARCHIVE_PATH, paths, false)));
+
+    AssetArchive& archive = AssetArchive::GetInstance();
+    CHECK(SUCCEEDED(archive.Open(ARCHIVE_PATH)));
+    CHECK(archive.Contains(L"ARCHIVETEST_0.BIN"));
+    CHECK(archive.Contains(L"./archivetest_1.bin"));
+    CHECK(archive.Contains(L".\\archiveTest_1.bin"));
+    CHECK(archive.Contains(L"archiveTest_2.bin"));
+    CHECK(!archive.Contains(L"archiveTest_2.bi"));
+    CHECK(!archive.Contains(L"archiveTest_2.bin2"));
+    CHECK(!archive.Contains(L"dir/archiveTest_2.bin"));
+    archive.Close();
+
+    CHECK(AssetArchive::HashName(L"Src\\Hah.DDS") == AssetArchive::HashName("src/hah.dds"));
+    CHECK(AssetArchive::HashName(L"./src/hah.dds") == AssetArchive::HashName("src/hah.dds"));
+    CHECK(AssetArchive::HashName(L"src/hah.dds") != AssetArchive::HashName("src/hah.dd"));
+
+    // The same file under two spellings is one name
+    paths.push_back(L".\\archiveTest_0.bin");
+    CHECK(AssetArchive::Pack(ARCHIVE_PATH, paths, false) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+    CHECK(FAILED(AssetArchive::Pack(ARCHIVE_PATH, { L"archiveTest_missing.bin" }, false)));
+    printf("names: normalization and duplicates ok\n");
+    RemoveFiles(3);
+  }
+
+  HRESULT OpenBytes(const std::vector<uint8_t>& data) {
+    WriteBytes(ARCHIVE_PATH_UTF8, data);
+    HRESULT hr = AssetArchive::GetInstance().Open(ARCHIVE_PATH);
+    return hr;
+  }
+
+  // Damaged index is rejected on open, damaged entries on load, nothing reads past the file
+  void TestDamaged() {
+    std::vector<std::wstring> paths;
+    WriteFiles(8, 6000, paths);
+    CHECK(SUCCEEDED(AssetArchive::Pack(ARCHIVE_PATH, paths, false)));
+    const std::vector<uint8_t> good = ReadBytes(ARCHIVE_PATH_UTF8);
+    CHECK(good.size() > sizeof(ArchiveHeader) + 8 * sizeof(ArchiveEntry));
+    AssetArchive& archive = AssetArchive::GetInstance();
+
+    std::vector<uint8_t> data(good.begin(), good.begin() + sizeof(ArchiveHeader) - 1);
+    CHECK(OpenBytes(data) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    data = good;
+    data[0] ^= 0xFF;
+    CHECK(OpenBytes(data) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    data = good;
+    reinterpret_cast<ArchiveHeader*>(data.data())->version = ARCHIVE_VERSION + 1;
+    CHECK(OpenBytes(data) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    data = good;
+    reinterpret_cast<ArchiveHeader*>(data.data())->entriesCount = 0x10000000;
+    CHECK(OpenBytes(data) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    // Index must stay sorted, binary search relies on it
+    data = good;
+    ArchiveEntry* entries = reinterpret_cast<ArchiveEntry*>(data.data() + sizeof(ArchiveHeader));
+    std::swap(entries[0], entries[1]);
+    CHECK(OpenBytes(data) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    data = good;
+    entries = reinterpret_cast<ArchiveEntry*>(data.data() + sizeof(ArchiveHeader));
+    entries[3].nameLength = 0x7FFFFFFF;
+    CHECK(OpenBytes(data) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    // Truncated data: index is fine, entries past the end fail to load
+    data.assign(good.begin(), good.begin() + (good.size() / 2));
+    CHECK(SUCCEEDED(OpenBytes(data)));
+    uint32_t loaded = 0, rejected = 0;
+    for (uint32_t i = 0; i < 8; i++) {
+      AssetData asset;
+      HRESULT hr = archive.Load(FileName(i).c_str(), asset);
+      if (SUCCEEDED(hr))
+        loaded++;
+      else if (hr == HRESULT_FROM_WIN32(ERROR_INVALID_DATA))
+        rejected++;
+    }
+    archive.Close();
+    CHECK(loaded + rejected == 8 && rejected > 0);
+
+    // Unknown codec
+    data = good;
+    entries = reinterpret_cast<ArchiveEntry*>(data.data() + sizeof(ArchiveHeader));
+    for (uint32_t i = 0; i < 8; i++)
+      entries[i].codec = 7;
+    CHECK(SUCCEEDED(OpenBytes(data)));
+    AssetData asset;
+    CHECK(archive.Load(FileName(0).c_str(), asset) == HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+    archive.Close();
+
+    printf("damaged: %u truncated entries rejected, %u still load\n", rejected, loaded);
+    RemoveFiles(8);
+  }
+
+  // Startup cost of many small assets: open + read of loose files vs lookups in one mapped archive
+  void BenchLoad() {
+    const uint32_t filesCount = 500;
+    std::vector<std::wstring> paths;
+    WriteFiles(filesCount, 32768, paths);
+    CHECK(SUCCEEDED(AssetArchive::Pack(ARCHIVE_PATH, paths, false)));
+
+    TestClock::time_point start = TestClock::now();
+    size_t looseBytes = 0;
+    for (uint32_t i = 0; i < filesCount; i++)
+      looseBytes += ReadBytes(FileName(i).c_str()).size();
+    double looseMs = ElapsedMs(start);
+
+    start = TestClock::now();
+    AssetArchive& archive = AssetArchive::GetInstance();
+    archive.Open(ARCHIVE_PATH);
+    size_t archiveBytes = 0;
+    uint32_t checksum = 0;
+    for (uint32_t i = 0; i < filesCount; i++) {
+      AssetData asset;
+      if (SUCCEEDED(archive.Load(FileName(i).c_str(), asset))) {
+        archiveBytes += asset.size;
+        // Touch every page, mapping alone reads nothing
+        for (size_t offset = 0; offset < asset.size; offset += 4096)
+          checksum += asset.data[offset];
+      }
+    }
+    archive.Close();
+    double archiveMs = ElapsedMs(start);
+
+    printf("%u files (%zu bytes): loose %.2f ms, archive %.2f ms (checksum %u)\n", filesCount, looseBytes, looseMs, archiveMs, checksum);
+    CHECK(looseBytes == archiveBytes);
+    RemoveFiles(filesCount);
+  }
+}
+
+int main() {
+  TestRoundTrip(false);
+  TestRoundTrip(true);
+  TestNames();
+  TestDamaged();
+  BenchLoad();
+  return TestResult();
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Windows file systems ignore case, sources include DirectXMath.h by lower case name
+#include_next <DirectXMath.h>
@@ -0,0 +1,247 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "windows.h"
+
+namespace {
+  thread_local DWORD lastError = 0;
+
+  // Mapped views and their sizes, munmap needs the size back
+  std::mutex viewsMutex;
+  std::unordered_map<const void*, size_t> views;
+
+  void SetErrorFromErrno() {
+    switch (errno) {
+    case ENOENT: lastError = ERROR_FILE_NOT_FOUND; break;
+    case ENOTDIR: lastError = ERROR_PATH_NOT_FOUND; break;
+    case EACCES: case EPERM: lastError = ERROR_ACCESS_DENIED; break;
+    case ENOSPC: lastError = ERROR_DISK_FULL; break;
+    case EFBIG: lastError = ERROR_FILE_TOO_LARGE; break;
+    default: lastError = ERROR_GEN_FAILURE; break;
+    }
+  }
+
+  // Handles are file descriptors shifted by one, so 0 is never a valid handle
+  HANDLE ToHandle(int fd) {
+    return (HANDLE)(intptr_t)(fd + 1);
+  }
+
+  int ToFd(HANDLE handle) {
+    return (int)(intptr_t)handle - 1;
+  }
+
+  void AppendUtf8(std::string& dst, uint32_t c) {
+    if (c < 0x80) {
+      dst += (char)c;
+    } else if (c < 0x800) {
+      dst += (char)(0xC0 | (c >> 6));
+      dst += (char)(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+      dst += (char)(0xE0 | (c >> 12));
+      dst += (char)(0x80 | ((c >> 6) & 0x3F));
+      dst += (char)(0x80 | (c & 0x3F));
+    } else {
+      dst += (char)(0xF0 | (c >> 18));
+      dst += (char)(0x80 | ((c >> 12) & 0x3F));
+      dst += (char)(0x80 | ((c >> 6) & 0x3F));
+      dst += (char)(0x80 | (c & 0x3F));
+    }
+  }
+
+  std::string ToUtf8(const wchar_t* src, size_t length) {
+    std::string dst;
+    for (size_t i = 0; i < length; i++)
+      AppendUtf8(dst, (uint32_t)src[i]);
+    return dst;
+  }
+
+  std::string ToPath(LPCWSTR path) {
+    std::string result = ToUtf8(path, wcslen(path));
+    for (auto& c : result)
+      if (c == '\\')
+        c = '/';
+    return result;
+  }
+}
+
+HANDLE CreateFileW(LPCWSTR path, DWORD access, DWORD, SECURITY_ATTRIBUTES*, DWORD disposition, DWORD, HANDLE) {
+  int flags = (access & GENERIC_WRITE) ? ((access & GENERIC_READ) ? O_RDWR : O_WRONLY) : O_RDONLY;
+  if (disposition == CREATE_ALWAYS)
+    flags |= O_CREAT | O_TRUNC;
+  int fd = open(ToPath(path).c_str(), flags | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    SetErrorFromErrno();
+    return INVALID_HANDLE_VALUE;
+  }
+  return ToHandle(fd);
+}
+
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, DWORD* bytesRead, OVERLAPPED*) {
+  // Like Win32 for files: short count only at end of file
+  DWORD total = 0;
+  while (total < size) {
+    ssize_t count = read(ToFd(file), static_cast<uint8_t*>(buffer) + total, size - total);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0) {
+      SetErrorFromErrno();
+      return FALSE;
+    }
+    if (count == 0)
+      break;
+    total += (DWORD)count;
+  }
+  if (bytesRead)
+    *bytesRead = total;
+  return TRUE;
+}
+
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, DWORD* bytesWritten, OVERLAPPED*) {
+  DWORD total = 0;
+  while (total < size) {
+    ssize_t count = write(ToFd(file), static_cast<const uint8_t*>(buffer) + total, size - total);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0) {
+      SetErrorFromErrno();
+      if (bytesWritten)
+        *bytesWritten = total;
+      return FALSE;
+    }
+    total += (DWORD)count;
+  }
+  if (bytesWritten)
+    *bytesWritten = total;
+  return TRUE;
+}
+
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size) {
+  struct stat info;
+  if (fstat(ToFd(file), &info) != 0) {
+    SetErrorFromErrno();
+    return FALSE;
+  }
+  size->QuadPart = (LONGLONG)info.st_size;
+  return TRUE;
+}
+
+BOOL CloseHandle(HANDLE handle) {
+  if (close(ToFd(handle)) != 0) {
+    SetErrorFromErrno();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+DWORD GetLastError() {
+  return lastError;
+}
+
+HANDLE CreateFileMappingW(HANDLE file, SECURITY_ATTRIBUTES*, DWORD, DWORD, DWORD, LPCWSTR) {
+  // Mapping keeps its own descriptor, file handle may be closed before it
+  int fd = dup(ToFd(file));
+  if (fd < 0) {
+    SetErrorFromErrno();
+    return nullptr;
+  }
+  return ToHandle(fd);
+}
+
+LPVOID MapViewOfFile(HANDLE mapping, DWORD, DWORD, DWORD, SIZE_T) {
+  struct stat info;
+  if (fstat(ToFd(mapping), &info) != 0) {
+    SetErrorFromErrno();
+    return nullptr;
+  }
+  // Empty files can't be mapped on POSIX, Win32 fails for them too
+  if (info.st_size == 0) {
+    lastError = ERROR_INVALID_PARAMETER;
+    return nullptr;
+  }
+  void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, ToFd(mapping), 0);
+  if (view == MAP_FAILED) {
+    SetErrorFromErrno();
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(viewsMutex);
+  views[view] = (size_t)info.st_size;
+  return view;
+}
+
+BOOL UnmapViewOfFile(LPCVOID address) {
+  size_t size;
+  {
+    std::lock_guard<std::mutex> lock(viewsMutex);
+    auto found = views.find(address);
+    if (found == views.end()) {
+      lastError = ERROR_INVALID_PARAMETER;
+      return FALSE;
+    }
+    size = found->second;
+    views.erase(found);
+  }
+  return munmap(const_cast<void*>(address), size) == 0;
+}
+
+int MultiByteToWideChar(UINT codePage, DWORD, LPCSTR src, int srcLength, LPWSTR dst, int dstLength) {
+  if (codePage != CP_UTF8) {
+    lastError = ERROR_INVALID_PARAMETER;
+    return 0;
+  }
+  // -1 means terminated source, terminator is converted too
+  size_t length = srcLength < 0 ? strlen(src) + 1 : (size_t)srcLength;
+  int count = 0;
+  for (size_t i = 0; i < length;) {
+    uint8_t byte = (uint8_t)src[i];
+    uint32_t c = byte;
+    size_t extra = byte >= 0xF0 ? 3 : byte >= 0xE0 ? 2 : byte >= 0xC0 ? 1 : 0;
+    if (extra) {
+      c = byte & (0x3F >> extra);
+      for (size_t k = 1; k <= extra && i + k < length; k++)
+        c = (c << 6) | ((uint8_t)src[i + k] & 0x3F);
+    }
+    i += extra + 1;
+    if (dstLength > 0) {
+      if (count >= dstLength) {
+        lastError = ERROR_INVALID_PARAMETER;
+        return 0;
+      }
+      dst[count] = (wchar_t)c;
+    }
+    count++;
+  }
+  return count;
+}
+
+int WideCharToMultiByte(UINT codePage, DWORD, LPCWSTR src, int srcLength, char* dst, int dstLength, LPCSTR, BOOL* usedDefault) {
+  if (codePage != CP_UTF8) {
+    lastError = ERROR_INVALID_PARAMETER;
+    return 0;
+  }
+  if (usedDefault)
+    *usedDefault = FALSE;
+  size_t length = srcLength < 0 ? wcslen(src) + 1 : (size_t)srcLength;
+  std::string utf8 = ToUtf8(src, length);
+  if (dstLength > 0) {
+    if (utf8.size() > (size_t)dstLength) {
+      lastError = ERROR_INVALID_PARAMETER;
+      return 0;
+    }
+    memcpy(dst, utf8.data(), utf8.size());
+  }
+  return (int)utf8.size();
+}
+
+void OutputDebugStringA(LPCSTR message) {
+  fputs(message, stderr);
+}
+
+void OutputDebugStringW(LPCWSTR message) {
+  fputs(ToUtf8(message, wcslen(message)).c_str(), stderr);
+}
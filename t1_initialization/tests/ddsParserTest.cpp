@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "ddsParser.h"
+#include "testCommon.h"
+
+// ParseDDS on well formed, truncated and randomly damaged files. Every file is copied
+// into buffer of exact size, so reads past the end show up under address sanitizer
+namespace {
+  struct DDSDesc {
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t mipCount;
+    DXGI_FORMAT format;
+    bool dx10;
+    uint32_t dimension;
+    uint32_t arraySize;
+    bool cube;
+  };
+
+  // Headers with payload of exact size described by them
+  std::vector<uint8_t> BuildDDS(const DDSDesc& desc) {
+    DDS_HEADER header = {};
+    header.size = sizeof(DDS_HEADER);
+    header.flags = DDS_WIDTH | DDS_HEIGHT;
+    header.width = desc.width;
+    header.height = desc.height;
+    header.depth = desc.depth;
+    header.mipMapCount = desc.mipCount;
+    header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+    if (desc.dimension == DDS_DIMENSION_TEXTURE3D)
+      header.flags |= DDS_HEADER_FLAGS_VOLUME;
+
+    DDS_HEADER_DXT10 header10 = {};
+    if (desc.dx10) {
+      header.ddspf.flags = DDS_FOURCC;
+      header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+      header10.dxgiFormat = desc.format;
+      header10.resourceDimension = desc.dimension;
+      header10.miscFlag = desc.cube ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+      header10.arraySize = desc.arraySize;
+    } else {
+      // Legacy header, only plain RGBA8 is written here
+      header.ddspf.flags = DDS_RGB;
+      header.ddspf.RGBBitCount = 32;
+      header.ddspf.RBitMask = 0x000000ff;
+      header.ddspf.GBitMask = 0x0000ff00;
+      header.ddspf.BBitMask = 0x00ff0000;
+      header.ddspf.ABitMask = 0xff000000;
+      if (desc.cube)
+        header.caps2 = DDS_CUBEMAP_ALLFACES;
+    }
+
+    size_t payload = 0;
+    uint32_t items = desc.arraySize * (desc.cube ? 6 : 1);
+    for (uint32_t item = 0; item < items; item++) {
+      uint32_t w = desc.width, h = desc.height, d = desc.depth;
+      for (uint32_t mip = 0; mip < desc.mipCount; mip++) {
+        size_t numBytes = 0;
+        DDSGetSurfaceInfo(w, h, desc.format, &numBytes, nullptr, nullptr);
+        payload += numBytes * d;
+        w = (std::max)(w >> 1, 1u);
+        h = (std::max)(h >> 1, 1u);
+        d = (std::max)(d >> 1, 1u);
+      }
+    }
+
+    std::vector<uint8_t> data(sizeof(uint32_t) + sizeof(DDS_HEADER) + (desc.dx10 ? sizeof(DDS_HEADER_DXT10) : 0) + payload);
+    memcpy(data.data(), &DDS_MAGIC, sizeof(uint32_t));
+    memcpy(data.data() + sizeof(uint32_t), &header, sizeof(header));
+    if (desc.dx10)
+      memcpy(data.data() + sizeof(uint32_t) + sizeof(DDS_HEADER), &header10, sizeof(header10));
+    for (size_t i = data.size() - payload; i < data.size(); i++)
+      data[i] = (uint8_t)i;
+    return data;
+  }
+
+  const DDSDesc VALID_FILES[] = {
+    { 256, 256, 1, 9, DXGI_FORMAT_R8G8B8A8_UNORM, false, DDS_DIMENSION_TEXTURE2D, 1, false },
+    { 64, 64, 1, 7, DXGI_FORMAT_R8G8B8A8_UNORM, false, DDS_DIMENSION_TEXTURE2D, 1, true },
+    { 512, 256, 1, 10, DXGI_FORMAT_BC1_UNORM, true, DDS_DIMENSION_TEXTURE2D, 1, false },
+    { 100, 60, 1, 7, DXGI_FORMAT_BC7_UNORM_SRGB, true, DDS_DIMENSION_TEXTURE2D, 4, false },
+    { 32, 32, 1, 6, DXGI_FORMAT_R16G16B16A16_FLOAT, true, DDS_DIMENSION_TEXTURE2D, 2, true },
+    { 300, 1, 1, 1, DXGI_FORMAT_R32_FLOAT, true, DDS_DIMENSION_TEXTURE1D, 3, false },
+    { 32, 16, 8, 6, DXGI_FORMAT_R8G8B8A8_UNORM, true, DDS_DIMENSION_TEXTURE3D, 1, false },
+  };
+
+  DDS_PARSE_RESULT Parse(const std::vector<uint8_t>& file, size_t size, DDSLayout& layout) {
+    // Exact size copy, tail of original file must not be reachable
+    std::vector<uint8_t> copy(file.begin(), file.begin() + size);
+    return ParseDDS(copy.empty() ? nullptr : copy.data(), size, layout);
+  }
+
+  // Subresources go one after another in file order and stay inside payload
+  bool LayoutIsConsistent(const DDSLayout& layout) {
+    if (layout.subresources.size() != size_t(layout.mipCount) * layout.arraySize)
+      return false;
+    size_t next = 0;
+    for (const DDSSubresource& sub : layout.subresources) {
+      if (sub.offset != next || sub.slicePitch < sub.rowPitch || sub.width == 0 || sub.height == 0 || sub.depth == 0)
+        return false;
+      if (sub.depth > 1 && sub.slicePitch > SIZE_MAX / sub.depth)
+        return false;
+      next = sub.offset + sub.slicePitch * sub.depth;
+      if (next > layout.bitSize)
+        return false;
+    }
+    return true;
+  }
+
+  void TestValid() {
+    DDSLayout layout;
+    for (const DDSDesc& desc : VALID_FILES) {
+      std::vector<uint8_t> file = BuildDDS(desc);
+      CHECK(Parse(file, file.size(), layout) == DDS_PARSE_OK);
+      CHECK(layout.width == desc.width && layout.mipCount == desc.mipCount && layout.format == desc.format);
+      CHECK(layout.arraySize == desc.arraySize * (desc.cube ? 6 : 1));
+      CHECK(layout.isCubeMap == desc.cube);
+      CHECK(LayoutIsConsistent(layout));
+      // Whole payload is covered
+      const DDSSubresource& last = layout.subresources.back();
+      CHECK(last.offset + last.slicePitch * last.depth == layout.bitSize);
+    }
+
+    // Tail data after surfaces is allowed
+    std::vector<uint8_t> file = BuildDDS(VALID_FILES[0]);
+    file.resize(file.size() + 100);
+    CHECK(Parse(file, file.size(), layout) == DDS_PARSE_OK);
+
+    // Zero mip count means one level
+    DDSDesc desc = VALID_FILES[2];
+    desc.mipCount = 1;
+    file = BuildDDS(desc);
+    reinterpret_cast<DDS_HEADER*>(file.data() + sizeof(uint32_t))->mipMapCount = 0;
+    CHECK(Parse(file, file.size(), layout) == DDS_PARSE_OK && layout.mipCount == 1);
+  }
+
+  // Every prefix of valid file is rejected as short or truncated
+  void TestTruncated() {
+    DDSLayout layout;
+    uint32_t prefixesCount = 0;
+    for (const DDSDesc& desc : VALID_FILES) {
+      std::vector<uint8_t> file = BuildDDS(desc);
+      size_t headersSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + (desc.dx10 ? sizeof(DDS_HEADER_DXT10) : 0);
+      // All header prefixes, payload prefixes with a stride to keep test short
+      size_t stride = (std::max)(size_t(1), (file.size() - headersSize) / 257);
+      for (size_t size = 0; size < file.size(); size += size < headersSize ? 1 : stride) {
+        DDS_PARSE_RESULT result = Parse(file, size, layout);
+        CHECK(result == (size < headersSize ? DDS_PARSE_TOO_SMALL : DDS_PARSE_TRUNCATED));
+        prefixesCount++;
+      }
+      CHECK(Parse(file, file.size() - 1, layout) == DDS_PARSE_TRUNCATED);
+    }
+    printf("truncated: %u prefixes rejected\n", prefixesCount);
+  }
+
+  // Hand damaged headers map to their results
+  void TestRejected() {
+    DDSLayout layout;
+    auto check = [&](const DDSDesc& desc, void (*damage)(DDS_HEADER&, DDS_HEADER_DXT10&), DDS_PARSE_RESULT expected) {
+      std::vector<uint8_t> file = BuildDDS(desc);
+      DDS_HEADER_DXT10 unused = {};
+      DDS_HEADER* header = reinterpret_cast<DDS_HEADER*>(file.data() + sizeof(uint32_t));
+      DDS_HEADER_DXT10* header10 = desc.dx10 ? reinterpret_cast<DDS_HEADER_DXT10*>(header + 1) : &unused;
+      damage(*header, *header10);
+      DDS_PARSE_RESULT result = Parse(file, file.size(), layout);
+      if (result != expected)
+        printf("  got %d, expected %d\n", result, expected);
+      CHECK(result == expected);
+    };
+    const DDSDesc& legacy = VALID_FILES[0];
+    const DDSDesc& dx10 = VALID_FILES[2];
+    const DDSDesc& volume = VALID_FILES[6];
+
+    std::vector<uint8_t> file = BuildDDS(legacy);
+    file[0] = 'X';
+    CHECK(Parse(file, file.size(), layout) == DDS_PARSE_BAD_MAGIC);
+
+    check(legacy, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.size = 0; }, DDS_PARSE_BAD_HEADER);
+    check(legacy, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.ddspf.size = 0; }, DDS_PARSE_BAD_HEADER);
+    check(legacy, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.width = 0; }, DDS_PARSE_BAD_HEADER);
+    check(legacy, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.mipMapCount = 10; }, DDS_PARSE_BAD_HEADER);
+    check(legacy, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.mipMapCount = 16; }, DDS_PARSE_TOO_LARGE);
+    check(legacy, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.width = 16385; }, DDS_PARSE_TOO_LARGE);
+    check(legacy, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.ddspf.RGBBitCount = 24; }, DDS_PARSE_UNSUPPORTED_FORMAT);
+    check(legacy, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.caps2 = DDS_CUBEMAP | DDS_CUBEMAP_POSITIVEX; }, DDS_PARSE_UNSUPPORTED_DIMENSION);
+    check(dx10, [](DDS_HEADER&, DDS_HEADER_DXT10& h) { h.arraySize = 0; }, DDS_PARSE_BAD_HEADER);
+    check(dx10, [](DDS_HEADER&, DDS_HEADER_DXT10& h) { h.arraySize = 2049; }, DDS_PARSE_TOO_LARGE);
+    check(dx10, [](DDS_HEADER&, DDS_HEADER_DXT10& h) { h.arraySize = 400; h.miscFlag = DDS_RESOURCE_MISC_TEXTURECUBE; }, DDS_PARSE_TOO_LARGE);
+    check(dx10, [](DDS_HEADER&, DDS_HEADER_DXT10& h) { h.arraySize = 2; }, DDS_PARSE_TRUNCATED);
+    check(dx10, [](DDS_HEADER&, DDS_HEADER_DXT10& h) { h.dxgiFormat = DXGI_FORMAT_P8; }, DDS_PARSE_UNSUPPORTED_FORMAT);
+    check(dx10, [](DDS_HEADER&, DDS_HEADER_DXT10& h) { h.dxgiFormat = static_cast<DXGI_FORMAT>(0x7FFFFFFF); }, DDS_PARSE_UNSUPPORTED_FORMAT);
+    check(dx10, [](DDS_HEADER&, DDS_HEADER_DXT10& h) { h.resourceDimension = 7; }, DDS_PARSE_UNSUPPORTED_DIMENSION);
+    check(dx10, [](DDS_HEADER&, DDS_HEADER_DXT10& h) { h.resourceDimension = DDS_DIMENSION_TEXTURE1D; }, DDS_PARSE_BAD_HEADER);
+    check(volume, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.flags &= ~DDS_HEADER_FLAGS_VOLUME; }, DDS_PARSE_BAD_HEADER);
+    check(volume, [](DDS_HEADER&, DDS_HEADER_DXT10& h) { h.arraySize = 2; }, DDS_PARSE_UNSUPPORTED_DIMENSION);
+    check(volume, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.depth = 2049; }, DDS_PARSE_TOO_LARGE);
+    check(volume, [](DDS_HEADER& h, DDS_HEADER_DXT10&) { h.depth = 0; }, DDS_PARSE_BAD_HEADER);
+  }
+
+  // Random bytes over headers and random sizes: no crash, no out of bounds,
+  // any accepted file has layout inside of its payload
+  void TestFuzz() {
+    const uint32_t ITERATIONS = 200000;
+    // Small files of every kind, so iterations go to headers rather than copying
+    const DDSDesc descs[] = {
+      { 16, 16, 1, 5, DXGI_FORMAT_R8G8B8A8_UNORM, false, DDS_DIMENSION_TEXTURE2D, 1, false },
+      { 8, 8, 1, 4, DXGI_FORMAT_R8G8B8A8_UNORM, false, DDS_DIMENSION_TEXTURE2D, 1, true },
+      { 32, 16, 1, 6, DXGI_FORMAT_BC1_UNORM, true, DDS_DIMENSION_TEXTURE2D, 1, false },
+      { 10, 6, 1, 4, DXGI_FORMAT_BC7_UNORM, true, DDS_DIMENSION_TEXTURE2D, 3, false },
+      { 8, 8, 1, 4, DXGI_FORMAT_R16G16B16A16_FLOAT, true, DDS_DIMENSION_TEXTURE2D, 1, true },
+      { 30, 1, 1, 1, DXGI_FORMAT_R32_FLOAT, true, DDS_DIMENSION_TEXTURE1D, 2, false },
+      { 8, 4, 4, 4, DXGI_FORMAT_R8G8B8A8_UNORM, true, DDS_DIMENSION_TEXTURE3D, 1, false },
+    };
+    const uint32_t descsCount = sizeof(descs) / sizeof(descs[0]);
+    std::vector<uint8_t> files[descsCount];
+    for (uint32_t i = 0; i < descsCount; i++)
+      files[i] = BuildDDS(descs[i]);
+
+    TestRandom random(28);
+    DDSLayout layout;
+    uint32_t results[DDS_PARSE_TRUNCATED + 1] = {};
+    uint32_t badLayouts = 0;
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+      std::vector<uint8_t> file = files[random.Next() % descsCount];
+      size_t headersSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+      uint32_t flips = 1 + random.Next() % 4;
+      for (uint32_t f = 0; f < flips; f++) {
+        size_t at = random.Next() % (std::min)(headersSize, file.size());
+        // Whole bytes hit sizes and counts, single bits hit flags
+        if (random.Next() % 2)
+          file[at] = (uint8_t)random.Next();
+        else
+          file[at] ^= (uint8_t)(1u << (random.Next() % 8));
+      }
+      size_t size = random.Next() % 4 ? file.size() : random.Next() % (file.size() + 1);
+      DDS_PARSE_RESULT result = Parse(file, size, layout);
+      CHECK(result >= DDS_PARSE_OK && result <= DDS_PARSE_TRUNCATED);
+      if (result >= DDS_PARSE_OK && result <= DDS_PARSE_TRUNCATED)
+        results[result]++;
+      if (result == DDS_PARSE_OK && !LayoutIsConsistent(layout))
+        badLayouts++;
+    }
+    printf("fuzz: %u files, ok %u, small %u, magic %u, header %u, format %u, dimension %u, large %u, truncated %u\n",
+      ITERATIONS, results[DDS_PARSE_OK], results[DDS_PARSE_TOO_SMALL], results[DDS_PARSE_BAD_MAGIC], results[DDS_PARSE_BAD_HEADER],
+      results[DDS_PARSE_UNSUPPORTED_FORMAT], results[DDS_PARSE_UNSUPPORTED_DIMENSION], results[DDS_PARSE_TOO_LARGE], results[DDS_PARSE_TRUNCATED]);
+    CHECK(badLayouts == 0);
+    CHECK(results[DDS_PARSE_OK] > 0 && results[DDS_PARSE_TRUNCATED] > 0);
+  }
+
+  // Parse is on the loading path of every texture, layout is reused as loader does
+  void BenchParse() {
+    const DDSDesc descs[] = {
+      { 2048, 2048, 1, 12, DXGI_FORMAT_BC1_UNORM, true, DDS_DIMENSION_TEXTURE2D, 1, false },
+      { 256, 256, 1, 9, DXGI_FORMAT_R8G8B8A8_UNORM, true, DDS_DIMENSION_TEXTURE2D, 256, false },
+    };
+    const char* names[] = { "2048^2 BC1 full chain", "256^2 RGBA8 x256 array" };
+    DDSLayout layout;
+    for (uint32_t i = 0; i < 2; i++) {
+      std::vector<uint8_t> file = BuildDDS(descs[i]);
+      const uint32_t repeats = i == 0 ? 200000 : 2000;
+      size_t subresources = 0;
+      TestClock::time_point start = TestClock::now();
+      for (uint32_t r = 0; r < repeats; r++) {
+        CHECK(ParseDDS(file.data(), file.size(), layout) == DDS_PARSE_OK);
+        subresources += layout.subresources.size();
+      }
+      double ms = ElapsedMs(start);
+      printf("%s: %.3f us per parse, %.1f ns per subresource\n", names[i], ms * 1000.0 / repeats, ms * 1e6 / subresources);
+    }
+  }
+}
+
+int main() {
+  TestValid();
+  TestTruncated();
+  TestRejected();
+  TestFuzz();
+  BenchParse();
+  return TestResult();
+}
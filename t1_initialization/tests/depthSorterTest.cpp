@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "depthSorter.h"
+#include "threadPool.h"
+#include "testCommon.h"
+
+// Radix sort gives the same order as std::stable_sort for any key distribution, depth keys keep
+// float order reversed. Radix sort time is printed against std::sort for 10k..1M keys
+namespace {
+  std::vector<uint32_t> ReferenceOrder(const std::vector<uint32_t>& keys) {
+    std::vector<uint32_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    return order;
+  }
+
+  enum DISTRIBUTION {
+    DISTRIBUTION_UNIFORM,
+    DISTRIBUTION_FEW,         // 16 distinct keys, order among equal ones shows stability
+    DISTRIBUTION_EQUAL,       // every pass is skipped
+    DISTRIBUTION_LOW_BITS,    // high digits shared, as depth keys of close objects
+    DISTRIBUTION_SORTED,
+    DISTRIBUTION_REVERSED,
+    DISTRIBUTIONS_COUNT
+  };
+
+  std::vector<uint32_t> RandomKeys(TestRandom& random, size_t count, DISTRIBUTION distribution) {
+    std::vector<uint32_t> keys(count);
+    for (size_t i = 0; i < count; i++) {
+      switch (distribution) {
+      case DISTRIBUTION_UNIFORM: keys[i] = random.Next(); break;
+      case DISTRIBUTION_FEW: keys[i] = (random.Next() % 16) * 0x01010101u; break;
+      case DISTRIBUTION_EQUAL: keys[i] = 0xBF800000u; break;
+      case DISTRIBUTION_LOW_BITS: keys[i] = 0xC1200000u | (random.Next() & 0xFFFF); break;
+      case DISTRIBUTION_SORTED: keys[i] = (uint32_t)i * 3; break;
+      default: keys[i] = ~(uint32_t)i; break;
+      }
+    }
+    return keys;
+  }
+
+  void TestDepthToKey() {
+    const float values[] = { -FLT_MAX, -1e20f, -2.0f, -1.0f, -0.5f, -FLT_MIN, -1e-45f, -0.0f, 0.0f, 1e-45f, FLT_MIN, 0.5f, 1.0f,
+      1.0000001f, 2.0f, 1e20f, FLT_MAX };
+    uint32_t bad = 0;
+    for (size_t i = 1; i < sizeof(values) / sizeof(values[0]); i++)
+      bad += DepthSorter::DepthToKey(values[i]) >= DepthSorter::DepthToKey(values[i - 1]);
+
+    TestRandom random(37);
+    for (uint32_t i = 0; i < 100000; i++) {
+      float a = random.Range(-1000.0f, 1000.0f), b = random.Range(-1000.0f, 1000.0f);
+      if (a != b)
+        bad += (a < b) != (DepthSorter::DepthToKey(a) > DepthSorter::DepthToKey(b));
+    }
+    CHECK(bad == 0);
+  }
+
+  void TestSort() {
+    TestRandom random(370);
+    DepthSorter sorter;
+    const size_t counts[] = { 0, 1, 2, 3, 255, 256, 257, 4095, 16383, 16384, 50000, 300000 };
+    uint32_t mismatches = 0, cases = 0;
+    for (size_t count : counts) {
+      for (uint32_t distribution = 0; distribution < DISTRIBUTIONS_COUNT; distribution++) {
+        std::vector<uint32_t> keys = RandomKeys(random, count, (DISTRIBUTION)distribution);
+        std::vector<uint32_t> order;
+        // Sorter keeps scratch buffers, reuse must not leak previous keys
+        sorter.Sort(keys.data(), keys.size(), order);
+        mismatches += order != ReferenceOrder(keys);
+        cases++;
+      }
+    }
+    CHECK(mismatches == 0);
+    printf("sort: %u cases, %u differ from std::stable_sort (%u workers)\n", cases, mismatches, ThreadPool::GetInstance().GetWorkersCount());
+  }
+
+  // Instances go from far to near, SIMD keys and scalar tail agree with plain transform
+  void TestBackToFront() {
+    TestRandom random(3700);
+    DepthSorter sorter;
+    uint32_t unsorted = 0;
+    for (size_t count : { 1u, 3u, 4u, 7u, 1000u, 20001u }) {
+      std::vector<XMMATRIX> worlds(count);
+      for (auto& world : worlds)
+        world = XMMatrixTranslation(random.Range(-100.0f, 100.0f), random.Range(-100.0f, 100.0f), random.Range(-100.0f, 100.0f));
+      XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(random.Range(-50.0f, 50.0f), 10.0f, -150.0f, 1.0f), XMVectorZero(),
+        XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+      std::vector<uint32_t> order;
+      sorter.SortBackToFront(worlds.data(), count, view, order);
+      CHECK(order.size() == count);
+
+      std::vector<uint8_t> seen(count, 0);
+      float prevDepth = FLT_MAX;
+      for (uint32_t index : order) {
+        float depth = XMVectorGetZ(XMVector3TransformCoord(worlds[index].r[3], view));
+        unsorted += depth > prevDepth + 1e-5f * std::fabs(prevDepth) || seen[index]++ != 0;
+        prevDepth = depth;
+      }
+    }
+    CHECK(unsorted == 0);
+  }
+
+  void BenchSort() {
+    TestRandom random(37000);
+    DepthSorter sorter;
+    for (size_t count : { 10000u, 100000u, 1000000u }) {
+      std::vector<uint32_t> keys = RandomKeys(random, count, DISTRIBUTION_UNIFORM);
+      std::vector<uint32_t> order, reference(count);
+      const uint32_t repeats = (uint32_t)(2000000 / count);
+
+      TestClock::time_point start = TestClock::now();
+      for (uint32_t r = 0; r < repeats; r++)
+        sorter.Sort(keys.data(), count, order);
+      double radixMs = ElapsedMs(start) / repeats;
+
+      start = TestClock::now();
+      for (uint32_t r = 0; r < repeats; r++) {
+        std::iota(reference.begin(), reference.end(), 0u);
+        std::sort(reference.begin(), reference.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+      }
+      double stdMs = ElapsedMs(start) / repeats;
+
+      // Uniform random keys are unique enough for unstable sort to give the same order
+      bool same = true;
+      for (size_t i = 0; i < count && same; i++)
+        same = keys[order[i]] == keys[reference[i]];
+      CHECK(same);
+      printf("%7zu keys: radix %.3f ms, std::sort %.3f ms, x%.1f\n", count, radixMs, stdMs, stdMs / radixMs);
+    }
+  }
+}
+
+int main() {
+  TestDepthToKey();
+  TestSort();
+  TestBackToFront();
+  BenchSort();
+  return TestResult();
+}
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "ecs.h"
+#include "components.h"
+#include "threadPool.h"
+#include "testCommon.h"
+
+// World at millions of entities: component arrays are aligned and don't overlap, handles stay valid
+// through destroy / move / clear, serial and parallel chunk walks agree. Create / iterate / destroy times are printed
+namespace {
+  struct TagComponent {
+    uint8_t value;
+  };
+
+  struct alignas(16) Vector16Component {
+    float values[4];
+  };
+
+  struct alignas(64) LineComponent {
+    uint32_t values[3];
+  };
+
+  // Every component of entity gets its index, so any overlap or lost move shows up
+  void Stamp(World& world, Entity entity) {
+    if (TagComponent* tag = world.Get<TagComponent>(entity))
+      tag->value = (uint8_t)entity.index;
+    if (Vector16Component* vector = world.Get<Vector16Component>(entity))
+      vector->values[3] = (float)entity.index;
+    if (LineComponent* line = world.Get<LineComponent>(entity))
+      line->values[2] = entity.index;
+    if (PositionComponent* position = world.Get<PositionComponent>(entity))
+      position->position.w = (float)entity.index;
+  }
+
+  bool HasStamp(World& world, Entity entity) {
+    TagComponent* tag = world.Get<TagComponent>(entity);
+    Vector16Component* vector = world.Get<Vector16Component>(entity);
+    LineComponent* line = world.Get<LineComponent>(entity);
+    PositionComponent* position = world.Get<PositionComponent>(entity);
+    return (!tag || tag->value == (uint8_t)entity.index) && (!vector || vector->values[3] == (float)entity.index) &&
+      (!line || line->values[2] == entity.index) && (!position || position->position.w == (float)entity.index);
+  }
+
+  ComponentMask RandomMask(TestRandom& random) {
+    const ComponentMask masks[] = {
+      ComponentMaskOf<TagComponent>(),
+      ComponentMaskOf<TagComponent, Vector16Component>(),
+      ComponentMaskOf<TagComponent, LineComponent, PositionComponent>(),
+      ComponentMaskOf<Vector16Component, LineComponent>(),
+      ComponentMaskOf<PositionComponent, TransformComponent, BoundsComponent>(),
+    };
+    return masks[random.Next() % (sizeof(masks) / sizeof(masks[0]))];
+  }
+
+  void TestLayout() {
+    CHECK(ComponentRegistry::GetAlignment(ComponentId<TagComponent>()) == 1 && ComponentRegistry::GetSize(ComponentId<TagComponent>()) == 1);
+    CHECK(ComponentRegistry::GetAlignment(ComponentId<Vector16Component>()) == 16);
+    CHECK(ComponentRegistry::GetAlignment(ComponentId<LineComponent>()) == 64 && ComponentRegistry::GetSize(ComponentId<LineComponent>()) == 64);
+
+    World world;
+    TestRandom random(41);
+    for (uint32_t i = 0; i < 100000; i++)
+      world.Create(RandomMask(random));
+
+    // Arrays start at component alignment and end before the next one starts, chunk stays in its size
+    uint32_t misaligned = 0, overlapping = 0, chunks = 0, tagEntities = 0;
+    world.ForEachChunk<TagComponent>([&](uint32_t count, const Entity* entities, TagComponent* tags) {
+      misaligned += reinterpret_cast<uintptr_t>(entities) % ECS_CHUNK_ALIGNMENT != 0;
+      overlapping += reinterpret_cast<const uint8_t*>(entities + count) > reinterpret_cast<uint8_t*>(tags) &&
+        reinterpret_cast<const uint8_t*>(entities) < reinterpret_cast<uint8_t*>(tags + count);
+      tagEntities += count;
+      chunks++;
+    });
+    world.ForEachChunk<Vector16Component, LineComponent>([&](uint32_t count, const Entity* entities, Vector16Component* vectors, LineComponent* lines) {
+      misaligned += reinterpret_cast<uintptr_t>(vectors) % 16 != 0 || reinterpret_cast<uintptr_t>(lines) % 64 != 0;
+      overlapping += reinterpret_cast<uint8_t*>(vectors + count) > reinterpret_cast<uint8_t*>(lines) ||
+        reinterpret_cast<const uint8_t*>(entities + count) > reinterpret_cast<uint8_t*>(vectors);
+      overlapping += reinterpret_cast<uint8_t*>(lines + count) - reinterpret_cast<const uint8_t*>(entities) > ECS_CHUNK_SIZE;
+    });
+    CHECK(misaligned == 0 && overlapping == 0 && tagEntities == world.Count<TagComponent>());
+
+    // One byte components pack without cache line padding: tag only chunk holds more than 1800 entities
+    World tags;
+    for (uint32_t i = 0; i < 4000; i++)
+      tags.Create<TagComponent>();
+    uint32_t firstChunk = 0;
+    tags.ForEachChunk<TagComponent>([&](uint32_t count, const Entity*, TagComponent*) { firstChunk = (std::max)(firstChunk, count); });
+    CHECK(firstChunk == ECS_CHUNK_SIZE / (sizeof(Entity) + 1));
+    printf("layout: 100k entities of 5 archetypes, %u tag chunks, %u entities per tag only chunk\n", chunks, firstChunk);
+  }
+
+  // Random creates, destroys and mask changes against a plain list of live handles
+  void TestChurn() {
+    const uint32_t ENTITIES = 2000000;
+    World world;
+    TestRandom random(410);
+    std::vector<Entity> alive;
+    alive.reserve(ENTITIES);
+    for (uint32_t i = 0; i < ENTITIES; i++) {
+      Entity entity = world.Create(RandomMask(random));
+      Stamp(world, entity);
+      alive.push_back(entity);
+    }
+    CHECK(world.Count(0) == ENTITIES);
+
+    std::vector<Entity> dead;
+    uint32_t unzeroed = 0;
+    for (uint32_t i = 0; i < ENTITIES / 2; i++) {
+      uint32_t at = random.Next() % alive.size();
+      Entity entity = alive[at];
+      switch (random.Next() % 4) {
+      case 0:
+        world.Destroy(entity);
+        dead.push_back(entity);
+        alive[at] = alive.back();
+        alive.pop_back();
+        break;
+      case 1: {
+        // Common components are kept, new ones come zeroed
+        ComponentMask oldMask = world.GetMask(entity);
+        world.SetMask(entity, RandomMask(random));
+        ComponentMask added = world.GetMask(entity) & ~oldMask;
+        unzeroed += (added & ComponentMaskOf<LineComponent>()) && world.Get<LineComponent>(entity)->values[2] != 0;
+        Stamp(world, entity);
+        break;
+      }
+      case 2:
+        world.Add<Vector16Component>(entity);
+        Stamp(world, entity);
+        break;
+      default:
+        world.Remove<TagComponent>(entity);
+        break;
+      }
+    }
+
+    // Freed slots are reused with new generation, old handles don't reach new entities
+    for (uint32_t i = 0; i < 1000; i++) {
+      Entity entity = world.Create<TagComponent>();
+      Stamp(world, entity);
+      alive.push_back(entity);
+    }
+    uint32_t wrong = 0;
+    for (const Entity& entity : dead)
+      wrong += world.IsAlive(entity) || world.Get<TagComponent>(entity) != nullptr || world.GetMask(entity) != 0;
+    for (const Entity& entity : alive)
+      wrong += !world.IsAlive(entity) || !HasStamp(world, entity);
+    CHECK(wrong == 0 && unzeroed == 0 && world.Count(0) == alive.size());
+
+    // Serial and parallel walks see every entity once
+    uint64_t serialSum = 0;
+    uint32_t serialCount = 0;
+    world.ForEachChunk<>([&](uint32_t count, const Entity* entities) {
+      for (uint32_t i = 0; i < count; i++)
+        serialSum += entities[i].index;
+      serialCount += count;
+    });
+    std::vector<uint8_t> seen(ENTITIES + 1000, 0);
+    world.ParallelForEachChunk<>([&](uint32_t count, const Entity* entities) {
+      for (uint32_t i = 0; i < count; i++)
+        seen[entities[i].index]++;
+    });
+    uint64_t aliveSum = 0;
+    for (const Entity& entity : alive)
+      aliveSum += entity.index;
+    uint32_t seenWrong = 0;
+    for (const Entity& entity : alive)
+      seenWrong += seen[entity.index] != 1;
+    CHECK(serialCount == alive.size() && serialSum == aliveSum && seenWrong == 0);
+
+    world.Clear();
+    uint32_t afterClear = 0;
+    for (const Entity& entity : alive)
+      afterClear += world.IsAlive(entity);
+    Entity fresh = world.Create<TagComponent>();
+    CHECK(afterClear == 0 && world.Count(0) == 1 && world.IsAlive(fresh) && world.Get<TagComponent>(fresh)->value == 0);
+    printf("churn: %u entities, %zu destroyed, %zu alive, %u wrong (%u workers)\n", ENTITIES, dead.size(), alive.size(), wrong,
+      ThreadPool::GetInstance().GetWorkersCount());
+  }
+
+  void BenchWorld() {
+    for (uint32_t entities : { 100000u, 1000000u, 4000000u }) {
+      World world;
+      TestClock::time_point start = TestClock::now();
+      for (uint32_t i = 0; i < entities; i++) {
+        Entity entity = world.Create<PositionComponent, OscillationComponent, TransformComponent>();
+        world.Get<OscillationComponent>(entity)->frequency = 1.0f + (i & 7);
+      }
+      double createMs = ElapsedMs(start);
+
+      // Same walk as simulation: position + amplitude * sin into transform
+      start = TestClock::now();
+      world.ForEachChunk<PositionComponent, OscillationComponent, TransformComponent>(
+        [](uint32_t count, const Entity*, PositionComponent* positions, OscillationComponent* oscillations, TransformComponent* transforms) {
+        for (uint32_t i = 0; i < count; i++)
+          transforms[i].world._41 = positions[i].position.x + oscillations[i].amplitude.x * oscillations[i].frequency;
+      });
+      double iterateMs = ElapsedMs(start);
+
+      start = TestClock::now();
+      world.ParallelForEachChunk<PositionComponent, OscillationComponent, TransformComponent>(
+        [](uint32_t count, const Entity*, PositionComponent* positions, OscillationComponent* oscillations, TransformComponent* transforms) {
+        for (uint32_t i = 0; i < count; i++)
+          transforms[i].world._41 = positions[i].position.x + oscillations[i].amplitude.x * oscillations[i].frequency;
+      });
+      double parallelMs = ElapsedMs(start);
+
+      start = TestClock::now();
+      world.Clear();
+      double clearMs = ElapsedMs(start);
+      printf("%7u entities: create %.1f ms, iterate %.2f ms, parallel iterate %.2f ms, clear %.1f ms\n",
+        entities, createMs, iterateMs, parallelMs, clearMs);
+    }
+  }
+}
+
+int main() {
+  TestLayout();
+  TestChurn();
+  BenchWorld();
+  return TestResult();
+}
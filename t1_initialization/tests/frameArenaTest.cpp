@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "frameArena.h"
+#include "testCommon.h"
+
+// Frame arena: aligned, non overlapping allocations, overflow blocks merged on reset so steady frames
+// don't allocate, thread arenas are separate and reset together. Arena time is printed against malloc / free
+namespace {
+  struct Defaults {
+    uint32_t value = 7;
+    float scale = 0.5f;
+  };
+
+  struct alignas(64) Line {
+    uint8_t bytes[64];
+  };
+
+  struct Allocation {
+    uint8_t* data;
+    size_t size;
+    uint8_t stamp;
+  };
+
+  // Random sizes and alignments, every allocation filled with its own byte
+  std::vector<Allocation> AllocateRandom(FrameArena& arena, TestRandom& random, uint32_t count, size_t maxSize, uint32_t& misaligned) {
+    std::vector<Allocation> allocations;
+    for (uint32_t i = 0; i < count; i++) {
+      size_t size = random.Next() % maxSize;
+      size_t alignment = size_t(1) << (random.Next() % 8);
+      uint8_t* data = static_cast<uint8_t*>(arena.Allocate(size, alignment));
+      misaligned += reinterpret_cast<uintptr_t>(data) % alignment != 0;
+      uint8_t stamp = (uint8_t)(i * 31 + 1);
+      memset(data, stamp, size);
+      allocations.push_back({ data, size, stamp });
+    }
+    return allocations;
+  }
+
+  uint32_t CountOverwritten(const std::vector<Allocation>& allocations) {
+    uint32_t overwritten = 0;
+    for (const Allocation& allocation : allocations)
+      for (size_t i = 0; i < allocation.size; i++)
+        if (allocation.data[i] != allocation.stamp) {
+          overwritten++;
+          break;
+        }
+    return overwritten;
+  }
+
+  void TestAllocate() {
+    FrameArena arena(4096);
+    TestRandom random(42);
+    uint32_t misaligned = 0;
+    std::vector<Allocation> allocations = AllocateRandom(arena, random, 2000, 300, misaligned);
+    CHECK(misaligned == 0 && CountOverwritten(allocations) == 0);
+    const FrameArenaStats& stats = arena.GetStats();
+    CHECK(stats.used > 0 && stats.highWater == stats.used && stats.capacity >= stats.used && stats.blockAllocations > 1);
+
+    // Typed arrays are default initialized and get type alignment if it's above arena one
+    Defaults* defaults = arena.Allocate<Defaults>(100);
+    Line* lines = arena.Allocate<Line>(3);
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < 100; i++)
+      wrong += defaults[i].value != 7 || defaults[i].scale != 0.5f;
+    CHECK(wrong == 0 && reinterpret_cast<uintptr_t>(lines) % 64 == 0 &&
+      reinterpret_cast<uintptr_t>(defaults) % FRAME_ARENA_ALIGNMENT == 0);
+
+    // Allocation larger than block gets block of its own
+    uint8_t* large = static_cast<uint8_t*>(arena.Allocate(100000, 16));
+    memset(large, 0xAB, 100000);
+    CHECK(CountOverwritten(allocations) == 0);
+
+    // Zero sized allocations are valid pointers too
+    void* empty = arena.Allocate(0, 1);
+    CHECK(empty != nullptr);
+  }
+
+  // First frame grows the arena, reset merges its blocks, next frames of the same size don't allocate
+  void TestSteadyState() {
+    FrameArena arena(1024);
+    TestRandom random(420);
+    uint32_t misaligned = 0, overwritten = 0;
+    AllocateRandom(arena, random, 500, 200, misaligned);
+    size_t firstCapacity = arena.GetStats().capacity;
+    uint32_t firstBlocks = arena.GetStats().blockAllocations;
+    size_t firstHighWater = arena.GetStats().highWater;
+    arena.Reset();
+    CHECK(arena.GetStats().used == 0 && arena.GetStats().capacity == firstCapacity && arena.GetStats().blockAllocations == firstBlocks + 1);
+
+    uint8_t* first = static_cast<uint8_t*>(arena.Allocate(1, 1));
+    arena.Reset();
+    for (uint32_t frame = 0; frame < 100; frame++) {
+      // Same first pointer every frame: memory is reused, not reallocated
+      TestRandom frameRandom(420);
+      uint8_t* again = static_cast<uint8_t*>(arena.Allocate(1, 1));
+      misaligned += again != first;
+      overwritten += CountOverwritten(AllocateRandom(arena, frameRandom, 500, 200, misaligned));
+      arena.Reset();
+    }
+    CHECK(misaligned == 0 && overwritten == 0);
+    CHECK(arena.GetStats().blockAllocations == firstBlocks + 1 && arena.GetStats().highWater >= firstHighWater);
+    printf("steady state: first frame %u blocks, %zu bytes; 100 frames after it %u more blocks\n", firstBlocks, firstCapacity,
+      arena.GetStats().blockAllocations - firstBlocks - 1);
+
+#if FRAME_ARENA_POISON
+    // Memory kept past frame end reads as poison
+    uint8_t* kept = static_cast<uint8_t*>(arena.Allocate(64, 16));
+    memset(kept, 0, 64);
+    arena.Reset();
+    CHECK(kept[0] == FRAME_ARENA_POISON_BYTE && kept[63] == FRAME_ARENA_POISON_BYTE);
+#endif
+  }
+
+  // Frame vectors grow inside thread arena
+  void TestFrameVector() {
+    FrameArena::ResetAll();
+    FrameArena& arena = FrameArena::GetThreadArena();
+    uint32_t blocks = arena.GetStats().blockAllocations;
+    {
+      FrameVector<uint32_t> values;
+      for (uint32_t i = 0; i < 1000; i++)
+        values.push_back(i);
+      uint32_t wrong = 0;
+      for (uint32_t i = 0; i < 1000; i++)
+        wrong += values[i] != i;
+      CHECK(wrong == 0 && arena.GetStats().used >= sizeof(uint32_t) * 1000);
+    }
+    FrameArena::ResetAll();
+    CHECK(arena.GetStats().used == 0 && arena.GetStats().blockAllocations <= blocks + 1);
+  }
+
+  // Every thread allocates from its own arena, ResetAll reaches arenas of all live threads
+  void TestThreads() {
+    const uint32_t THREADS = 4;
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint32_t allocated = 0;
+    bool reset = false;
+    uint32_t wrong = 0;
+    std::vector<FrameArena*> arenas(THREADS);
+    FrameArena::ResetAll();
+    size_t mainUsed = FrameArena::GetThreadArena().GetStats().used;
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < THREADS; t++) {
+      threads.emplace_back([&, t]() {
+        FrameArena& arena = FrameArena::GetThreadArena();
+        TestRandom random(4200 + t);
+        uint32_t misaligned = 0;
+        std::vector<Allocation> allocations = AllocateRandom(arena, random, 1000, 500, misaligned);
+        std::unique_lock<std::mutex> lock(mutex);
+        arenas[t] = &arena;
+        wrong += misaligned + CountOverwritten(allocations);
+        allocated++;
+        changed.notify_all();
+        changed.wait(lock, [&]() { return reset; });
+        wrong += arena.GetStats().used != 0;
+      });
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&]() { return allocated == THREADS; });
+    }
+    std::sort(arenas.begin(), arenas.end());
+    CHECK(std::unique(arenas.begin(), arenas.end()) == arenas.end() &&
+      std::find(arenas.begin(), arenas.end(), &FrameArena::GetThreadArena()) == arenas.end());
+    CHECK(FrameArena::GetTotalStats().used >= mainUsed + THREADS * 1000);
+    size_t capacity = FrameArena::GetTotalStats().capacity;
+
+    FrameArena::ResetAll();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      reset = true;
+    }
+    changed.notify_all();
+    for (auto& thread : threads)
+      thread.join();
+
+    // Arenas of finished threads are gone from totals
+    CHECK(wrong == 0 && FrameArena::GetTotalStats().used == 0 && FrameArena::GetTotalStats().capacity < capacity);
+  }
+
+  void BenchAllocate() {
+    const uint32_t COUNT = 1000000;
+    TestRandom random(42000);
+    std::vector<uint32_t> sizes(COUNT);
+    for (auto& size : sizes)
+      size = 16 + random.Next() % 240;
+    std::vector<void*> pointers(COUNT);
+    FrameArena arena;
+    uintptr_t checksum = 0;
+
+    // Warm frame first, then arena is one block
+    for (uint32_t i = 0; i < COUNT; i++)
+      arena.Allocate(sizes[i]);
+    arena.Reset();
+
+    TestClock::time_point start = TestClock::now();
+    for (uint32_t i = 0; i < COUNT; i++)
+      pointers[i] = arena.Allocate(sizes[i]);
+    arena.Reset();
+    double arenaMs = ElapsedMs(start);
+    for (void* pointer : pointers)
+      checksum += reinterpret_cast<uintptr_t>(pointer) & 0xFF;
+
+    start = TestClock::now();
+    for (uint32_t i = 0; i < COUNT; i++)
+      pointers[i] = malloc(sizes[i]);
+    for (uint32_t i = 0; i < COUNT; i++)
+      free(pointers[i]);
+    double mallocMs = ElapsedMs(start);
+    printf("%u allocations of 16..256 bytes: arena %.2f ms, malloc / free %.2f ms, x%.1f (checksum %u)\n", COUNT, arenaMs, mallocMs,
+      mallocMs / arenaMs, (uint32_t)checksum);
+  }
+}
+
+int main() {
+  TestAllocate();
+  TestSteadyState();
+  TestFrameVector();
+  TestThreads();
+  BenchAllocate();
+  return TestResult();
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "frustumCulling.h"
+#include "cameraPath.h"
+#include "cameraState.h"
+#include "testCommon.h"
+
+namespace {
+  const uint32_t BOXES_COUNT = 20000;
+
+  // Orbit moves like benchmark camera paths: turns, zooms and target shifts
+  const char* ORBIT_PATH =
+    "key 0 0 0 0 5 0 10\n"
+    "key 3 2 0 1 12 90 20\n"
+    "key 6 -3 1 2 8 200 5\n"
+    "key 10 0 0 0 20 360 30\n";
+
+  // Box is outside if it is fully behind plane, p-vertex is the corner furthest along normal
+  bool IsOutsideExact(const XMFLOAT4& plane, const XMFLOAT4& bbMin, const XMFLOAT4& bbMax) {
+    float x = plane.x >= 0.0f ? bbMax.x : bbMin.x;
+    float y = plane.y >= 0.0f ? bbMax.y : bbMin.y;
+    float z = plane.z >= 0.0f ? bbMax.z : bbMin.z;
+    return plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f;
+  }
+
+  // Planes FrustumCulling::IsBoxInside tested: rejecting one is found lastPlane - firstPlane steps after the first,
+  // box inside took all six
+  uint32_t PlaneTests(bool inside, uint32_t firstPlane, uint32_t lastPlane) {
+    return inside ? 6 : (lastPlane + 6 - firstPlane) % 6 + 1;
+  }
+
+  // Every corner takes part in plane test
+  void TestIsOutside(TestRandom& random) {
+    uint32_t mismatches = 0;
+    for (uint32_t t = 0; t < 100000; t++) {
+      XMVECTOR normal = XMVector3Normalize(XMVectorSet(random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f), 0.0f));
+      XMFLOAT4 plane;
+      XMStoreFloat4(&plane, normal);
+      plane.w = random.Range(-2.0f, 2.0f);
+      XMFLOAT4 bbMin(random.Range(-2.0f, 1.0f), random.Range(-2.0f, 1.0f), random.Range(-2.0f, 1.0f), 1.0f);
+      XMFLOAT4 bbMax(bbMin.x + random.Range(0.0f, 1.0f), bbMin.y + random.Range(0.0f, 1.0f), bbMin.z + random.Range(0.0f, 1.0f), 1.0f);
+      mismatches += FrustumCulling::IsOutside(plane, bbMin, bbMax) != IsOutsideExact(plane, bbMin, bbMax);
+    }
+    printf("plane test: %u mismatches with p-vertex test\n", mismatches);
+    CHECK(mismatches == 0);
+  }
+
+  // Any start plane gives the same answer, rejecting plane is kept for next time, inside box keeps the old one
+  void TestBoxInside(TestRandom& random) {
+    CameraState camera;
+    XMFLOAT3 position(3.0f, 2.0f, -10.0f);
+    camera.SetView(XMMatrixLookAtLH(XMLoadFloat3(&position), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)), position);
+    camera.SetPerspective(XM_PIDIV2, 16.0f / 9.0f, 100.0f, 0.01f);
+    const XMFLOAT4* planes = camera.GetFrustumPlanes();
+
+    uint32_t wrong = 0, inside = 0;
+    for (uint32_t t = 0; t < 20000; t++) {
+      XMFLOAT4 bbMin(random.Range(-60.0f, 60.0f), random.Range(-60.0f, 60.0f), random.Range(-60.0f, 100.0f), 1.0f);
+      XMFLOAT4 bbMax(bbMin.x + random.Range(0.0f, 5.0f), bbMin.y + random.Range(0.0f, 5.0f), bbMin.z + random.Range(0.0f, 5.0f), 1.0f);
+      bool expected = true;
+      for (uint32_t i = 0; i < 6; i++)
+        expected = expected && !IsOutsideExact(planes[i], bbMin, bbMax);
+      inside += expected;
+      for (uint32_t first = 0; first < 6; first++) {
+        uint32_t lastPlane = first;
+        bool result = FrustumCulling::IsBoxInside(planes, bbMin, bbMax, lastPlane);
+        wrong += result != expected || lastPlane >= 6 || (result && lastPlane != first) ||
+          (!result && !FrustumCulling::IsOutside(planes[lastPlane], bbMin, bbMax));
+      }
+    }
+    printf("box test: 20000 boxes, %u inside, %u wrong answers or planes\n", inside, wrong);
+    CHECK(wrong == 0 && inside > 0 && inside < 20000);
+  }
+
+  // Plane tests per instance of fixed and coherent order along camera path, both give the same visibility
+  void BenchPlaneOrder(TestRandom& random) {
+    std::vector<XMFLOAT4> bbMin(BOXES_COUNT), bbMax(BOXES_COUNT);
+    for (uint32_t i = 0; i < BOXES_COUNT; i++) {
+      XMFLOAT3 center(random.Range(-30.0f, 30.0f), random.Range(-10.0f, 10.0f), random.Range(-30.0f, 30.0f));
+      bbMin[i] = XMFLOAT4(center.x - 0.3f, center.y - 0.3f, center.z - 0.3f, 1.0f);
+      bbMax[i] = XMFLOAT4(center.x + 0.3f, center.y + 0.3f, center.z + 0.3f, 1.0f);
+    }
+
+    CameraPath path;
+    CHECK(path.ParseText(ORBIT_PATH, strlen(ORBIT_PATH)));
+
+    // Faster camera means less coherence between frames
+    for (uint32_t speed = 1; speed <= 4; speed *= 2) {
+      std::vector<uint32_t> lastPlanes(BOXES_COUNT, 0), firstPlanes(BOXES_COUNT), fixedPlanes(BOXES_COUNT);
+      std::vector<uint8_t> fixedVisible(BOXES_COUNT), coherentVisible(BOXES_COUNT);
+      uint64_t fixedTests = 0, coherentTests = 0, visibleCount = 0;
+      uint32_t framesCount = 0, mismatches = 0;
+      double fixedMs = 0.0, coherentMs = 0.0;
+      for (float time = 0.0f; time <= path.GetDuration(); time += speed / 60.0f, framesCount++) {
+        CameraPathKey pose;
+        path.Evaluate(time, pose);
+        XMFLOAT3 position(cosf(pose.theta) * cosf(pose.phi) * pose.distance + pose.target.x, sinf(pose.theta) * pose.distance + pose.target.y,
+          cosf(pose.theta) * sinf(pose.phi) * pose.distance + pose.target.z);
+        CameraState camera;
+        camera.SetView(XMMatrixLookAtLH(XMLoadFloat3(&position), XMLoadFloat3(&pose.target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)), position);
+        camera.SetPerspective(XM_PIDIV2, 16.0f / 9.0f, 100.0f, 0.01f);
+        const XMFLOAT4* planes = camera.GetFrustumPlanes();
+
+        // Shader without coherent mode starts from the first plane every frame
+        TestClock::time_point start = TestClock::now();
+        for (uint32_t i = 0; i < BOXES_COUNT; i++) {
+          fixedPlanes[i] = 0;
+          fixedVisible[i] = FrustumCulling::IsBoxInside(planes, bbMin[i], bbMax[i], fixedPlanes[i]);
+        }
+        fixedMs += ElapsedMs(start);
+
+        firstPlanes = lastPlanes;
+        start = TestClock::now();
+        for (uint32_t i = 0; i < BOXES_COUNT; i++)
+          coherentVisible[i] = FrustumCulling::IsBoxInside(planes, bbMin[i], bbMax[i], lastPlanes[i]);
+        coherentMs += ElapsedMs(start);
+
+        for (uint32_t i = 0; i < BOXES_COUNT; i++) {
+          visibleCount += fixedVisible[i];
+          mismatches += fixedVisible[i] != coherentVisible[i];
+          fixedTests += PlaneTests(fixedVisible[i] != 0, 0, fixedPlanes[i]);
+          coherentTests += PlaneTests(coherentVisible[i] != 0, firstPlanes[i], lastPlanes[i]);
+        }
+      }
+
+      double fixedPerInstance = (double)fixedTests / framesCount / BOXES_COUNT;
+      double coherentPerInstance = (double)coherentTests / framesCount / BOXES_COUNT;
+      printf("speed x%u: %u frames, visible %.1f%%, plane tests per instance fixed %.3f, coherent %.3f (%.1f%% fewer)\n",
+        speed, framesCount, 100.0 * visibleCount / framesCount / BOXES_COUNT, fixedPerInstance, coherentPerInstance,
+        100.0 * (1.0 - coherentPerInstance / fixedPerInstance));
+      printf("speed x%u: fixed order %.3f ms per frame, coherent order %.3f ms per frame\n",
+        speed, fixedMs / framesCount, coherentMs / framesCount);
+      CHECK(mismatches == 0);
+      CHECK(coherentTests < fixedTests);
+    }
+  }
+}
+
+int main() {
+  TestRandom random(3);
+  TestIsOutside(random);
+  TestBoxInside(random);
+  BenchPlaneOrder(random);
+  return TestResult();
+}
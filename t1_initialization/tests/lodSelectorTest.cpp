@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "lodSelector.h"
+#include "testCommon.h"
+
+// Screen size LOD selection: hysteresis band, SIMD batch against scalar reference,
+// stable bucketing. Selection and bucketing time is printed for a million spheres
+namespace {
+  const std::vector<float> THRESHOLDS = { 100.0f, 50.0f, 25.0f, 12.0f };
+  const float HYSTERESIS = 0.1f;
+
+  // Within float rounding of some band edge, SIMD and scalar paths may disagree there
+  bool NearEdge(double screenRadius) {
+    for (float threshold : THRESHOLDS)
+      for (double edge : { threshold * (1.0 - HYSTERESIS), threshold * (1.0 + HYSTERESIS) })
+        if (std::fabs(screenRadius - edge) <= 1e-4 * edge)
+          return true;
+    return false;
+  }
+
+  void TestScalar() {
+    LODSelector selector;
+    selector.Init(THRESHOLDS, HYSTERESIS);
+    CHECK(selector.GetLevelsCount() == 5);
+
+    // Far from thresholds previous LOD doesn't matter
+    for (uint8_t prev = 0; prev < 5; prev++) {
+      CHECK(selector.Select(1000.0f, prev) == 0);
+      CHECK(selector.Select(75.0f, prev) == 1);
+      CHECK(selector.Select(5.0f, prev) == 4);
+    }
+    // Inside band around 100 px current LOD stays
+    CHECK(selector.Select(95.0f, 0) == 0);
+    CHECK(selector.Select(95.0f, 1) == 1);
+    CHECK(selector.Select(105.0f, 1) == 1);
+    CHECK(selector.Select(89.0f, 0) == 1);
+    CHECK(selector.Select(111.0f, 1) == 0);
+    // Jump over several levels at once
+    CHECK(selector.Select(95.0f, 4) == 1);
+
+    // Radius oscillating around threshold switches once
+    uint8_t lod = 0;
+    uint32_t switches = 0;
+    for (uint32_t frame = 0; frame < 100; frame++) {
+      float radius = 50.0f * (1.0f + 0.08f * sinf(frame * 0.7f));
+      uint8_t next = selector.Select(frame < 10 ? 40.0f : radius, lod);
+      switches += next != lod;
+      lod = next;
+    }
+    CHECK(switches == 1);
+
+    // Without hysteresis band is empty
+    LODSelector sharp;
+    sharp.Init(THRESHOLDS, 0.0f);
+    CHECK(sharp.Select(99.9f, 0) == 1 && sharp.Select(100.0f, 1) == 0);
+
+    LODSelector single;
+    single.Init({});
+    CHECK(single.GetLevelsCount() == 1 && single.Select(0.0f, 0) == 0);
+
+    XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 0.1f, 100.0f);
+    CHECK(std::fabs(LODSelector::ProjectionScale(projection, 1000.0f) - 500.0f) < 1e-3f);
+  }
+
+  // Batch path (4 spheres per step and scalar tail) gives the same LODs as per-sphere selection
+  void TestBatch() {
+    LODSelector selector;
+    selector.Init(THRESHOLDS, HYSTERESIS);
+    TestRandom random(32);
+    const XMFLOAT3 camera(3.0f, -2.0f, 5.0f);
+    const float scale = 600.0f;
+    uint32_t mismatches = 0, nearEdge = 0, checked = 0;
+    for (uint32_t set = 0; set < 200; set++) {
+      size_t count = random.Next() % 67;
+      std::vector<XMFLOAT4> spheres(count);
+      std::vector<uint8_t> lods(count), expected(count);
+      for (size_t i = 0; i < count; i++) {
+        spheres[i] = XMFLOAT4(random.Range(-200.0f, 200.0f), random.Range(-200.0f, 200.0f), random.Range(-200.0f, 200.0f), random.Range(0.1f, 10.0f));
+        lods[i] = (uint8_t)(random.Next() % 5);
+        double dx = spheres[i].x - camera.x, dy = spheres[i].y - camera.y, dz = spheres[i].z - camera.z;
+        double radius = spheres[i].w * scale / std::sqrt(dx * dx + dy * dy + dz * dz);
+        expected[i] = selector.Select((float)radius, lods[i]);
+        if (NearEdge(radius)) {
+          expected[i] = 0xFF;
+          nearEdge++;
+        }
+      }
+      selector.Select(spheres.data(), count, camera, scale, lods.data());
+      for (size_t i = 0; i < count; i++) {
+        if (expected[i] == 0xFF)
+          continue;
+        mismatches += lods[i] != expected[i];
+        checked++;
+      }
+    }
+    CHECK(mismatches == 0);
+    printf("batch: %u spheres match scalar selection (%u near band edges skipped)\n", checked, nearEdge);
+
+    // Camera inside sphere gives finest LOD, not NaN
+    XMFLOAT4 spheresAtCamera[5];
+    uint8_t lods[5] = { 4, 4, 4, 4, 4 };
+    for (auto& sphere : spheresAtCamera)
+      sphere = XMFLOAT4(camera.x, camera.y, camera.z, 1.0f);
+    selector.Select(spheresAtCamera, 5, camera, scale, lods);
+    for (uint8_t lod : lods)
+      CHECK(lod == 0);
+  }
+
+  void TestBucket() {
+    LODSelector selector;
+    selector.Init(THRESHOLDS, HYSTERESIS);
+    TestRandom random(320);
+    std::vector<uint8_t> lods(1000);
+    for (auto& lod : lods)
+      lod = (uint8_t)(random.Next() % 7); // 5 and 6 go to the last level
+    std::vector<uint32_t> order(lods.size());
+    std::vector<uint32_t> offsets;
+    selector.Bucket(lods.data(), lods.size(), order.data(), offsets);
+
+    CHECK(offsets.size() == 6 && offsets[0] == 0 && offsets[5] == lods.size());
+    bool ok = true;
+    for (uint32_t level = 0; level < 5; level++) {
+      for (uint32_t i = offsets[level]; i < offsets[level + 1]; i++) {
+        ok = ok && (std::min)(lods[order[i]], (uint8_t)4) == level;
+        // Stable: indices go up inside level
+        ok = ok && (i == offsets[level] || order[i] > order[i - 1]);
+      }
+    }
+    CHECK(ok);
+    std::vector<uint32_t> sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    for (uint32_t i = 0; i < sorted.size(); i++)
+      ok = ok && sorted[i] == i;
+    CHECK(ok);
+
+    selector.Bucket(lods.data(), 0, order.data(), offsets);
+    CHECK(offsets.size() == 6 && offsets[5] == 0);
+  }
+
+  void BenchSelect() {
+    const size_t COUNT = 1000000;
+    LODSelector selector;
+    selector.Init(THRESHOLDS, HYSTERESIS);
+    TestRandom random(3200);
+    std::vector<XMFLOAT4> spheres(COUNT);
+    for (auto& sphere : spheres)
+      sphere = XMFLOAT4(random.Range(-500.0f, 500.0f), random.Range(-20.0f, 20.0f), random.Range(-500.0f, 500.0f), random.Range(0.5f, 3.0f));
+    std::vector<uint8_t> lods(COUNT, 0);
+    std::vector<uint32_t> order(COUNT);
+    std::vector<uint32_t> offsets;
+
+    const uint32_t REPEATS = 10;
+    TestClock::time_point start = TestClock::now();
+    for (uint32_t r = 0; r < REPEATS; r++)
+      selector.Select(spheres.data(), COUNT, XMFLOAT3(0.0f, 2.0f, 0.0f), 800.0f, lods.data());
+    double selectMs = ElapsedMs(start) / REPEATS;
+
+    uint64_t scalarSum = 0;
+    start = TestClock::now();
+    for (size_t i = 0; i < COUNT; i++) {
+      float distance = sqrtf(spheres[i].x * spheres[i].x + (spheres[i].y - 2.0f) * (spheres[i].y - 2.0f) + spheres[i].z * spheres[i].z);
+      scalarSum += selector.Select(spheres[i].w * 800.0f / distance, lods[i]);
+    }
+    double scalarMs = ElapsedMs(start);
+
+    start = TestClock::now();
+    for (uint32_t r = 0; r < REPEATS; r++)
+      selector.Bucket(lods.data(), COUNT, order.data(), offsets);
+    double bucketMs = ElapsedMs(start) / REPEATS;
+
+    printf("1M spheres: batch select %.2f ms, scalar select %.2f ms (sum %llu), bucket %.2f ms, per level:",
+      selectMs, scalarMs, (unsigned long long)scalarSum, bucketMs);
+    for (uint32_t level = 0; level < selector.GetLevelsCount(); level++)
+      printf(" %u", offsets[level + 1] - offsets[level]);
+    printf("\n");
+  }
+}
+
+int main() {
+  TestScalar();
+  TestBatch();
+  TestBucket();
+  BenchSelect();
+  return TestResult();
+}
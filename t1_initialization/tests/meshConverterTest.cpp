@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "meshConverter.h"
+#include "vertexQuantizer.h"
+#include "testCommon.h"
+
+// OBJ parsing (handedness, winding, uv origin, index forms), converted mesh files round trip
+// through ParseMeshFile, damaged files are rejected. Parse / build time is printed for a large mesh
+namespace {
+  const char* OBJ_PATH = "meshTest.obj";
+  const char* MESH_PATH = "meshTest.mesh";
+
+  bool Near(float a, float b, float tolerance = 1e-5f) {
+    return std::fabs(a - b) <= tolerance * (std::max)(1.0f, std::fabs(b));
+  }
+
+  bool Near(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return Near(a.x, b.x) && Near(a.y, b.y) && Near(a.z, b.z);
+  }
+
+  bool Parse(const std::string& text, Mesh& mesh) {
+    return MeshConverter::ParseOBJ(text.data(), text.size(), mesh);
+  }
+
+  // Left handed mesh back to OBJ: z and v mirrored, winding reversed, one v / vt / vn per vertex
+  std::string WriteOBJ(const Mesh& mesh) {
+    std::string text = "# meshConverterTest\n";
+    char line[128];
+    for (const MeshVertex& vertex : mesh.vertices) {
+      snprintf(line, sizeof(line), "v %.9g %.9g %.9g\nvt %.9g %.9g\nvn %.9g %.9g %.9g\n", vertex.pos.x, vertex.pos.y, -vertex.pos.z,
+        vertex.uv.x, 1.0f - vertex.uv.y, vertex.normal.x, vertex.normal.y, -vertex.normal.z);
+      text += line;
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+      uint32_t a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+      snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, c, c, c, b, b, b);
+      text += line;
+    }
+    return text;
+  }
+
+  bool SaveText(const char* path, const std::string& text) {
+    FILE* out = fopen(path, "wb");
+    if (!out)
+      return false;
+    bool ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+    return fclose(out) == 0 && ok;
+  }
+
+  std::vector<uint8_t> LoadBytes(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* in = fopen(path, "rb");
+    if (!in)
+      return data;
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+      data.insert(data.end(), buffer, buffer + count);
+    fclose(in);
+    return data;
+  }
+
+  std::wstring Wide(const char* text) {
+    return std::wstring(text, text + strlen(text));
+  }
+
+  void TestParseOBJ() {
+    // Counter clockwise quad facing +z in right handed OBJ faces -z after conversion, clockwise
+    Mesh mesh;
+    CHECK(Parse("v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n", mesh));
+    CHECK(mesh.vertices.size() == 4 && (mesh.indices == std::vector<uint32_t>{ 0, 2, 1, 0, 3, 2 }));
+    for (const MeshVertex& vertex : mesh.vertices)
+      CHECK(Near(vertex.normal, XMFLOAT3(0.0f, 0.0f, -1.0f)) && vertex.uv.x == 0.0f && vertex.uv.y == 0.0f);
+
+    // All index forms, negative indices, comments, exponents; z and v are mirrored
+    const char* forms =
+      "# comment\n"
+      "o object\n"
+      "v 1.5e1 -2 3.25\r\n"
+      "v  0.5 0 -1E-1\n"
+      "v 0 +1 0 1.0\n"
+      "vt 0.25 0.75\n"
+      "vt 1 0\n"
+      "vn 0 0 2\n"
+      "f 1/1/1 2/2/1 3/1/1 # tail comment\n"
+      "f -3//-1 -2//-1 -1//-1\n"
+      "f 1/2 2/1 3/2\n"
+      "usemtl skipped\n";
+    CHECK(Parse(forms, mesh));
+    CHECK(mesh.indices.size() == 9);
+    CHECK(Near(mesh.vertices[0].pos, XMFLOAT3(15.0f, -2.0f, -3.25f)) && Near(mesh.vertices[1].pos, XMFLOAT3(0.5f, 0.0f, 0.1f)));
+    CHECK(Near(mesh.vertices[0].uv.y, 0.25f) && Near(mesh.vertices[1].uv.y, 1.0f));
+    CHECK(Near(mesh.vertices[0].normal, XMFLOAT3(0.0f, 0.0f, -1.0f)));
+    // 1/1/1 and 1//1 differ in uv, so they are separate vertices
+    CHECK(mesh.vertices.size() == 9);
+    CHECK(mesh.indices[0] == 0 && mesh.indices[1] == 2 && mesh.indices[2] == 1);
+
+    // Vertices without normals get smooth ones, shared by corners at the same position
+    const char* cube =
+      "v -1 -1 -1\nv 1 -1 -1\nv 1 1 -1\nv -1 1 -1\nv -1 -1 1\nv 1 -1 1\nv 1 1 1\nv -1 1 1\n"
+      "vt 0 0\nvt 1 1\n"
+      "f 1/1 4/1 3/1 2/1\nf 5/2 6/2 7/2 8/2\nf 1 2 6 5\nf 3 4 8 7\nf 2 3 7 6\nf 1 5 8 4\n";
+    CHECK(Parse(cube, mesh));
+    CHECK(mesh.indices.size() == 36);
+    uint32_t badNormals = 0;
+    for (const MeshVertex& vertex : mesh.vertices) {
+      // Corner normal of cube points out along its diagonal, fan triangulation weights faces 1 or 2 times
+      XMVECTOR diagonal = XMVector3Normalize(XMLoadFloat3(&vertex.pos));
+      badNormals += XMVectorGetX(XMVector3Dot(diagonal, XMLoadFloat3(&vertex.normal))) < 0.9f;
+    }
+    CHECK(badNormals == 0);
+
+    // Nothing to triangulate or broken statements
+    const char* broken[] = {
+      "",
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\n",
+      "v 0 0 0\nv 1 0 0\nf 1 2\n",
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 4\n",
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 0 1 2\n",
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nf -4 1 2\n",
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1/1 2 3\n",
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nvn 0 0 1\nf 1//2 2//1 3//1\n",
+      "v 0 x 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n",
+      "v 0 0\n",
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 99999999999\n",
+    };
+    uint32_t accepted = 0;
+    for (const char* text : broken)
+      accepted += Parse(text, mesh);
+    CHECK(accepted == 0);
+  }
+
+  // Generated mesh written as OBJ parses back to the same triangles in the same order
+  void TestOBJRoundTrip() {
+    Mesh source;
+    MeshGenerator::BuildUVSphere(16, 32, source);
+    Mesh mesh;
+    CHECK(Parse(WriteOBJ(source), mesh));
+    CHECK(mesh.indices.size() == source.indices.size() && mesh.vertices.size() == source.vertices.size());
+    uint32_t bad = 0;
+    for (size_t i = 0; i < source.indices.size() && i < mesh.indices.size(); i++) {
+      const MeshVertex& a = source.vertices[source.indices[i]];
+      const MeshVertex& b = mesh.vertices[mesh.indices[i]];
+      bad += !Near(a.pos, b.pos) || !Near(a.normal, b.normal) || !Near(a.uv.x, b.uv.x) || !Near(a.uv.y, b.uv.y);
+    }
+    CHECK(bad == 0);
+  }
+
+  // Parsed file matches built mesh: vertices within quantization bound, same indices, meshlets cover them in order
+  void CheckMeshFile(const Mesh& mesh, const MeshFileData& built, const std::vector<uint8_t>& data) {
+    MeshFileView view;
+    CHECK(ParseMeshFile(data.data(), data.size(), view) == MESH_PARSE_OK);
+    if (!view.header)
+      return;
+    const MeshFileHeader& header = *view.header;
+    CHECK(header.verticesCount == mesh.vertices.size() && header.indicesCount == mesh.indices.size());
+    CHECK(header.indexSize == (mesh.vertices.size() <= 0x10000 ? 2u : 4u));
+    CHECK(header.vertexOffset % MESH_FILE_ALIGNMENT == 0 && header.indexOffset % MESH_FILE_ALIGNMENT == 0 &&
+      header.meshletOffset % MESH_FILE_ALIGNMENT == 0);
+    CHECK(memcmp(&header.boundingSphere, &built.boundingSphere, sizeof(XMFLOAT4)) == 0);
+
+    std::vector<TexVertex> decoded(header.verticesCount);
+    VertexQuantizer::Decode(view.vertices, header.verticesCount, header.quantization, decoded.data());
+    XMFLOAT3 bound = VertexQuantizer::PositionErrorBound(header.quantization);
+    XMVECTOR center = XMLoadFloat4(&header.boundingSphere);
+    uint32_t bad = 0;
+    for (size_t v = 0; v < decoded.size(); v++) {
+      const XMFLOAT3& a = decoded[v].pos;
+      const XMFLOAT3& b = mesh.vertices[v].pos;
+      bad += std::fabs(a.x - b.x) > bound.x || std::fabs(a.y - b.y) > bound.y || std::fabs(a.z - b.z) > bound.z;
+      float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&b), center)));
+      bad += distance > header.boundingSphere.w * 1.0001f + 1e-5f;
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+      bad += view.GetIndex(i) != mesh.indices[i];
+
+    uint32_t nextIndex = 0;
+    for (uint32_t m = 0; m < header.meshletsCount; m++) {
+      bad += view.meshlets[m].indexStart != nextIndex;
+      nextIndex += view.meshlets[m].trianglesCount * 3;
+    }
+    bad += nextIndex != header.indicesCount || header.meshletsCount != built.meshlets.size();
+    CHECK(bad == 0);
+  }
+
+  void TestBuild() {
+    Mesh sources[2];
+    MeshGenerator::BuildIcosphere(3, sources[0]);
+    // Over 64k vertices needs 32 bit indices
+    MeshGenerator::BuildUVSphere(256, 300, sources[1]);
+    CHECK(sources[1].vertices.size() > 0x10000);
+    for (Mesh& source : sources) {
+      Mesh mesh;
+      CHECK(Parse(WriteOBJ(source), mesh));
+      MeshFileData built;
+      MeshConvertStats stats;
+      MeshConverter::Build(mesh, built, &stats);
+      CHECK(stats.verticesCount == mesh.vertices.size() && stats.trianglesCount * 3 == mesh.indices.size());
+      CHECK(stats.meshletsCount == built.meshlets.size() && stats.acmrAfter <= stats.acmrBefore);
+
+      std::vector<uint8_t> data;
+      SerializeMeshFile(built, data);
+      CheckMeshFile(mesh, built, data);
+      printf("build: %u vertices, %u tris, %u meshlets, %zu KB, ACMR %.3f -> %.3f\n", stats.verticesCount, stats.trianglesCount,
+        stats.meshletsCount, data.size() >> 10, stats.acmrBefore, stats.acmrAfter);
+    }
+  }
+
+  // Every damage maps to its own result, no view is left behind on failure
+  void TestDamagedFiles() {
+    Mesh mesh;
+    MeshGenerator::BuildIcosphere(2, mesh);
+    MeshFileData built;
+    MeshConverter::Build(mesh, built);
+    std::vector<uint8_t> valid;
+    SerializeMeshFile(built, valid);
+
+    struct Damage {
+      MESH_PARSE_RESULT expected;
+      void (*apply)(std::vector<uint8_t>& data);
+    };
+    auto header = [](std::vector<uint8_t>& data) { return reinterpret_cast<MeshFileHeader*>(data.data()); };
+    const Damage damages[] = {
+      { MESH_PARSE_TOO_SMALL, [](std::vector<uint8_t>& data) { data.resize(sizeof(MeshFileHeader) - 1); } },
+      { MESH_PARSE_BAD_MAGIC, [](std::vector<uint8_t>& data) { data[0] ^= 1; } },
+      { MESH_PARSE_UNSUPPORTED_VERSION, [](std::vector<uint8_t>& data) { reinterpret_cast<MeshFileHeader*>(data.data())->version = 1; } },
+      { MESH_PARSE_BAD_FORMAT, [](std::vector<uint8_t>& data) { reinterpret_cast<MeshFileHeader*>(data.data())->indexSize = 3; } },
+      { MESH_PARSE_BAD_FORMAT, [](std::vector<uint8_t>& data) { reinterpret_cast<MeshFileHeader*>(data.data())->vertexStride += 4; } },
+      { MESH_PARSE_BAD_FORMAT, [](std::vector<uint8_t>& data) { reinterpret_cast<MeshFileHeader*>(data.data())->indicesCount -= 1; } },
+      { MESH_PARSE_BAD_BLOCK, [](std::vector<uint8_t>& data) { data.pop_back(); } },
+      { MESH_PARSE_BAD_BLOCK, [](std::vector<uint8_t>& data) { reinterpret_cast<MeshFileHeader*>(data.data())->vertexOffset += 4; } },
+      { MESH_PARSE_BAD_BLOCK, [](std::vector<uint8_t>& data) { reinterpret_cast<MeshFileHeader*>(data.data())->vertexOffset = 0; } },
+      { MESH_PARSE_BAD_BLOCK, [](std::vector<uint8_t>& data) { reinterpret_cast<MeshFileHeader*>(data.data())->indexOffset = ~0ull << 6; } },
+      { MESH_PARSE_BAD_BLOCK, [](std::vector<uint8_t>& data) { reinterpret_cast<MeshFileHeader*>(data.data())->verticesCount = 0xFFFFFFFF; } },
+      { MESH_PARSE_BAD_BLOCK, [](std::vector<uint8_t>& data) { reinterpret_cast<MeshFileHeader*>(data.data())->meshletsCount += 1; } },
+      { MESH_PARSE_BAD_INDEX, [](std::vector<uint8_t>& data) {
+        MeshFileHeader* h = reinterpret_cast<MeshFileHeader*>(data.data());
+        reinterpret_cast<uint16_t*>(data.data() + h->indexOffset)[h->indicesCount - 1] = (uint16_t)h->verticesCount; } },
+      { MESH_PARSE_BAD_MESHLET, [](std::vector<uint8_t>& data) {
+        MeshFileHeader* h = reinterpret_cast<MeshFileHeader*>(data.data());
+        reinterpret_cast<Meshlet*>(data.data() + h->meshletOffset)->trianglesCount = MESHLET_MAX_TRIANGLES + 1; } },
+      { MESH_PARSE_BAD_MESHLET, [](std::vector<uint8_t>& data) {
+        MeshFileHeader* h = reinterpret_cast<MeshFileHeader*>(data.data());
+        reinterpret_cast<Meshlet*>(data.data() + h->meshletOffset)[h->meshletsCount - 1].indexStart += 3; } },
+      { MESH_PARSE_BAD_MESHLET, [](std::vector<uint8_t>& data) {
+        MeshFileHeader* h = reinterpret_cast<MeshFileHeader*>(data.data());
+        reinterpret_cast<Meshlet*>(data.data() + h->meshletOffset)->indexStart = 1; } },
+    };
+    CHECK(header(valid)->indexSize == 2 && header(valid)->meshletsCount > 1);
+
+    uint32_t wrong = 0;
+    for (const Damage& damage : damages) {
+      std::vector<uint8_t> data = valid;
+      damage.apply(data);
+      MeshFileView view;
+      MESH_PARSE_RESULT result = ParseMeshFile(data.data(), data.size(), view);
+      wrong += result != damage.expected || view.header != nullptr;
+    }
+    CHECK(wrong == 0);
+    MeshFileView view;
+    CHECK(ParseMeshFile(nullptr, 0, view) == MESH_PARSE_TOO_SMALL);
+
+    // Random byte damage: whatever is accepted stays inside data
+    TestRandom random(34);
+    uint32_t accepted = 0, outside = 0;
+    std::vector<uint8_t> data;
+    for (uint32_t iteration = 0; iteration < 20000; iteration++) {
+      data = valid;
+      uint32_t flips = 1 + random.Next() % 4;
+      for (uint32_t f = 0; f < flips; f++) {
+        // Mostly header, it has most of the checks
+        size_t offset = random.Next() % 2 ? random.Next() % sizeof(MeshFileHeader) : random.Next() % data.size();
+        data[offset] ^= (uint8_t)(1u << (random.Next() % 8));
+      }
+      if (random.Next() % 8 == 0)
+        data.resize(random.Next() % data.size());
+      if (ParseMeshFile(data.data(), data.size(), view) != MESH_PARSE_OK)
+        continue;
+      accepted++;
+      const MeshFileHeader& h = *view.header;
+      const uint8_t* end = data.data() + data.size();
+      outside += reinterpret_cast<const uint8_t*>(view.vertices + h.verticesCount) > end ||
+        static_cast<const uint8_t*>(view.indices) + (size_t)h.indicesCount * h.indexSize > end ||
+        reinterpret_cast<const uint8_t*>(view.meshlets + h.meshletsCount) > end;
+      for (uint32_t i = 0; i < h.indicesCount; i++)
+        outside += view.GetIndex(i) >= h.verticesCount;
+      for (uint32_t m = 0; m < h.meshletsCount; m++)
+        outside += view.meshlets[m].indexStart + view.meshlets[m].trianglesCount * 3ull > h.indicesCount;
+    }
+    CHECK(outside == 0);
+    printf("damaged files: %zu hand cases, 20000 random, %u accepted, %u out of bounds\n",
+      sizeof(damages) / sizeof(damages[0]), accepted, outside);
+  }
+
+  void TestConvertFile() {
+    Mesh source;
+    MeshGenerator::BuildIcosphere(2, source);
+    CHECK(SaveText(OBJ_PATH, WriteOBJ(source)));
+
+    MeshConvertStats stats;
+    CHECK(MeshConverter::ConvertFile(Wide(OBJ_PATH).c_str(), Wide(MESH_PATH).c_str(), &stats) == S_OK);
+    std::vector<uint8_t> data = LoadBytes(MESH_PATH);
+    MeshFileView view;
+    CHECK(ParseMeshFile(data.data(), data.size(), view) == MESH_PARSE_OK);
+    CHECK(view.header && view.header->verticesCount == stats.verticesCount && view.header->indicesCount == stats.trianglesCount * 3 &&
+      view.header->meshletsCount == stats.meshletsCount);
+    CHECK(stats.trianglesCount * 3 == source.indices.size());
+
+    // Same file converted twice gives the same bytes
+    CHECK(MeshConverter::ConvertFile(Wide(OBJ_PATH).c_str(), Wide(MESH_PATH).c_str()) == S_OK);
+    CHECK(LoadBytes(MESH_PATH) == data);
+
+    CHECK(SaveText(OBJ_PATH, "v 0 0 0\n"));
+    CHECK(MeshConverter::ConvertFile(Wide(OBJ_PATH).c_str(), Wide(MESH_PATH).c_str()) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+    remove(OBJ_PATH);
+    CHECK(MeshConverter::ConvertFile(Wide(OBJ_PATH).c_str(), Wide(MESH_PATH).c_str()) == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+    remove(MESH_PATH);
+    printf("convert file: %u vertices, %u tris, %zu bytes\n", stats.verticesCount, stats.trianglesCount, data.size());
+  }
+
+  void BenchConvert() {
+    Mesh source;
+    MeshGenerator::BuildUVSphere(384, 384, source);
+    std::string text = WriteOBJ(source);
+
+    Mesh mesh;
+    TestClock::time_point start = TestClock::now();
+    CHECK(Parse(text, mesh));
+    double parseMs = ElapsedMs(start);
+    MeshFileData built;
+    start = TestClock::now();
+    MeshConverter::Build(mesh, built);
+    double buildMs = ElapsedMs(start);
+    std::vector<uint8_t> data;
+    SerializeMeshFile(built, data);
+    MeshFileView view;
+    const uint32_t REPEATS = 10;
+    start = TestClock::now();
+    for (uint32_t r = 0; r < REPEATS; r++)
+      CHECK(ParseMeshFile(data.data(), data.size(), view) == MESH_PARSE_OK);
+    double loadMs = ElapsedMs(start) / REPEATS;
+    printf("%zu tris: OBJ %.1f MB parse %.1f ms (%.0f MB/s), build %.1f ms, mesh file %.1f MB parse %.2f ms\n", mesh.indices.size() / 3,
+      text.size() / 1048576.0, parseMs, text.size() / 1048576.0 / parseMs * 1000.0, buildMs, data.size() / 1048576.0, loadMs);
+  }
+}
+
+int main() {
+  TestParseOBJ();
+  TestOBJRoundTrip();
+  TestBuild();
+  TestDamagedFiles();
+  TestConvertFile();
+  BenchConvert();
+  return TestResult();
+}
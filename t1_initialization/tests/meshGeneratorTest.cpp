@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "meshGenerator.h"
+#include "testCommon.h"
+
+// ACMR of generated meshes before and after MeshOptimizer, optimizer keeps the same
+// triangles with the same winding. Optimizer time is printed for large meshes
+namespace {
+  typedef std::array<float, 9> TriangleKey;
+
+  // Triangle by positions, rotated to start at smallest corner so winding is kept
+  std::vector<TriangleKey> Triangles(const Mesh& mesh) {
+    std::vector<TriangleKey> triangles;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+      std::array<XMFLOAT3, 3> corners = { mesh.vertices[mesh.indices[i]].pos, mesh.vertices[mesh.indices[i + 1]].pos,
+        mesh.vertices[mesh.indices[i + 2]].pos };
+      auto less = [](const XMFLOAT3& a, const XMFLOAT3& b) {
+        return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+      };
+      size_t first = std::min_element(corners.begin(), corners.end(), less) - corners.begin();
+      TriangleKey key;
+      for (size_t c = 0; c < 3; c++) {
+        const XMFLOAT3& p = corners[(first + c) % 3];
+        key[c * 3] = p.x;
+        key[c * 3 + 1] = p.y;
+        key[c * 3 + 2] = p.z;
+      }
+      triangles.push_back(key);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+  }
+
+  // Grid of quads with triangles in random order, the worst case for cache
+  void BuildShuffledGrid(uint32_t side, Mesh& mesh) {
+    for (uint32_t y = 0; y <= side; y++)
+      for (uint32_t x = 0; x <= side; x++)
+        mesh.vertices.push_back({ XMFLOAT3((float)x, 0.0f, (float)y), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) });
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < side; y++) {
+      for (uint32_t x = 0; x < side; x++) {
+        uint32_t i = y * (side + 1) + x;
+        triangles.push_back({ i, i + side + 1, i + 1 });
+        triangles.push_back({ i + 1, i + side + 1, i + side + 2 });
+      }
+    }
+    TestRandom random(side);
+    for (size_t i = triangles.size() - 1; i > 0; i--)
+      std::swap(triangles[i], triangles[random.Next() % (i + 1)]);
+    for (auto& triangle : triangles)
+      mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+  }
+
+  // Vertices go in order of first use and every vertex is used
+  bool IsFetchOrdered(const Mesh& mesh) {
+    uint32_t next = 0;
+    for (uint32_t index : mesh.indices) {
+      if (index > next)
+        return false;
+      if (index == next)
+        next++;
+    }
+    return next == mesh.vertices.size();
+  }
+
+  // Closed unit shapes around origin: every face normal points away from center
+  bool FacesOutside(const Mesh& mesh) {
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+      XMVECTOR v0 = XMLoadFloat3(&mesh.vertices[mesh.indices[i]].pos);
+      XMVECTOR v1 = XMLoadFloat3(&mesh.vertices[mesh.indices[i + 1]].pos);
+      XMVECTOR v2 = XMLoadFloat3(&mesh.vertices[mesh.indices[i + 2]].pos);
+      XMVECTOR normal = XMVector3Cross(XMVectorSubtract(v1, v0), XMVectorSubtract(v2, v0));
+      if (XMVectorGetX(XMVector3Dot(normal, XMVectorAdd(XMVectorAdd(v0, v1), v2))) <= 0.0f)
+        return false;
+    }
+    return true;
+  }
+
+  void TestCalculateACMR() {
+    // No vertex shared: 3 misses per triangle
+    std::vector<uint32_t> separate = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+    CHECK(MeshOptimizer::CalculateACMR(separate, 9) == 3.0f);
+    // Fan around vertex 0: 3 misses, then 1 per triangle
+    std::vector<uint32_t> fan = { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 5 };
+    CHECK(MeshOptimizer::CalculateACMR(fan, 6) == 6.0f / 4.0f);
+    // FIFO cache of 3: vertex 0 falls out after three other loads
+    std::vector<uint32_t> evicted = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+    CHECK(MeshOptimizer::CalculateACMR(evicted, 6, 3) == 3.0f);
+    CHECK(MeshOptimizer::CalculateACMR(evicted, 6, 6) == 2.0f);
+    CHECK(MeshOptimizer::CalculateACMR({ 0, 1 }, 2) == 0.0f);
+  }
+
+  void CheckOptimized(const char* name, const Mesh& raw, bool closed) {
+    Mesh mesh = raw;
+    MeshOptimizer::Optimize(mesh);
+    float rawAcmr = MeshOptimizer::CalculateACMR(raw.indices, raw.vertices.size());
+    CHECK(mesh.acmrBefore == rawAcmr);
+    CHECK(mesh.acmrAfter <= mesh.acmrBefore);
+    CHECK(mesh.acmrAfter == MeshOptimizer::CalculateACMR(mesh.indices, mesh.vertices.size()));
+    CHECK(mesh.indices.size() == raw.indices.size() && mesh.vertices.size() == raw.vertices.size());
+    CHECK(Triangles(mesh) == Triangles(raw));
+    CHECK(IsFetchOrdered(mesh));
+    if (closed)
+      CHECK(FacesOutside(mesh));
+    printf("  %-18s %6zu tris  ACMR %.3f -> %.3f\n", name, mesh.indices.size() / 3, mesh.acmrBefore, mesh.acmrAfter);
+  }
+
+  void TestOptimize() {
+    printf("ACMR, FIFO cache of %u:\n", MESH_ACMR_CACHE_SIZE);
+    Mesh mesh;
+    MeshGenerator::BuildCube(mesh);
+    CheckOptimized("cube", mesh, true);
+    mesh = Mesh();
+    MeshGenerator::BuildQuad(mesh);
+    CheckOptimized("quad", mesh, false);
+
+    const uint32_t sphereLines[][2] = { { 8, 8 }, { 16, 32 }, { 64, 64 } };
+    for (auto& lines : sphereLines) {
+      char name[32];
+      snprintf(name, sizeof(name), "uv sphere %ux%u", lines[0], lines[1]);
+      mesh = Mesh();
+      MeshGenerator::BuildUVSphere(lines[0], lines[1], mesh);
+      CheckOptimized(name, mesh, true);
+    }
+    for (uint32_t subdivisions = 0; subdivisions <= 4; subdivisions++) {
+      char name[32];
+      snprintf(name, sizeof(name), "icosphere %u", subdivisions);
+      mesh = Mesh();
+      MeshGenerator::BuildIcosphere(subdivisions, mesh);
+      CheckOptimized(name, mesh, true);
+    }
+
+    mesh = Mesh();
+    BuildShuffledGrid(64, mesh);
+    CheckOptimized("shuffled grid 64", mesh, false);
+
+    // Large regular meshes have to get close to the grid optimum (0.5 for infinite cache)
+    Mesh optimized;
+    MeshGenerator::BuildIcosphere(4, optimized);
+    MeshOptimizer::Optimize(optimized);
+    CHECK(optimized.acmrAfter < 0.8f);
+    optimized = mesh;
+    MeshOptimizer::Optimize(optimized);
+    CHECK(optimized.acmrBefore > 2.0f && optimized.acmrAfter < 0.8f);
+
+    // Cached meshes are optimized once and shared
+    const Mesh& cached = MeshGenerator::GetInstance().GetIcosphere(2);
+    CHECK(&cached == &MeshGenerator::GetInstance().GetIcosphere(2));
+    CHECK(cached.acmrAfter > 0.0f && cached.acmrAfter <= cached.acmrBefore);
+  }
+
+  void BenchOptimize() {
+    Mesh icosphere;
+    MeshGenerator::BuildIcosphere(6, icosphere);
+    Mesh grid;
+    BuildShuffledGrid(256, grid);
+    const Mesh* meshes[] = { &icosphere, &grid };
+    const char* names[] = { "icosphere 6", "shuffled grid 256" };
+    for (uint32_t i = 0; i < 2; i++) {
+      std::vector<uint32_t> indices = meshes[i]->indices;
+      TestClock::time_point start = TestClock::now();
+      MeshOptimizer::OptimizeVertexCache(indices, meshes[i]->vertices.size());
+      double cacheMs = ElapsedMs(start);
+      Mesh mesh = *meshes[i];
+      mesh.indices = indices;
+      start = TestClock::now();
+      MeshOptimizer::OptimizeVertexFetch(mesh.vertices, mesh.indices);
+      double fetchMs = ElapsedMs(start);
+      printf("%s: %zu tris, vertex cache %.2f ms (%.1f Mtris/s), fetch %.2f ms, ACMR %.3f -> %.3f\n", names[i], indices.size() / 3,
+        cacheMs, indices.size() / 3 / cacheMs / 1000.0, fetchMs,
+        MeshOptimizer::CalculateACMR(meshes[i]->indices, meshes[i]->vertices.size()),
+        MeshOptimizer::CalculateACMR(mesh.indices, mesh.vertices.size()));
+    }
+  }
+}
+
+int main() {
+  TestCalculateACMR();
+  TestOptimize();
+  BenchOptimize();
+  return TestResult();
+}
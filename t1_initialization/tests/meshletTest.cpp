@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "meshlet.h"
+#include "meshGenerator.h"
+#include "cameraState.h"
+#include "frameArena.h"
+#include "testCommon.h"
+
+// Meshlets keep their limits and cover index buffer in order, bounds hold every triangle,
+// culling never drops a front facing triangle in frustum. Build and cull time is printed
+namespace {
+  const size_t STRIDE = sizeof(MeshVertex);
+
+  struct Instance {
+    XMMATRIX world;
+  };
+
+  Mesh BuildMesh(uint32_t subdivisions) {
+    Mesh mesh;
+    MeshGenerator::BuildIcosphere(subdivisions, mesh);
+    MeshOptimizer::Optimize(mesh);
+    return mesh;
+  }
+
+  std::vector<Meshlet> BuildMeshlets(const Mesh& mesh, uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES) {
+    std::vector<Meshlet> meshlets;
+    MeshletBuilder::Build(&mesh.vertices[0].pos, STRIDE, mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(), meshlets,
+      maxVertices, maxTriangles);
+    return meshlets;
+  }
+
+  uint32_t UniqueVertices(const std::vector<uint32_t>& indices, uint32_t start, uint32_t count) {
+    std::vector<uint32_t> unique(indices.begin() + start, indices.begin() + start + count);
+    std::sort(unique.begin(), unique.end());
+    return (uint32_t)(std::unique(unique.begin(), unique.end()) - unique.begin());
+  }
+
+  XMVECTOR Position(const Mesh& mesh, uint32_t index) {
+    return XMLoadFloat3(&mesh.vertices[index].pos);
+  }
+
+  // Limits, order and greedy filling for several limits, bounds hold all triangles of meshlet
+  void TestBuild() {
+    Mesh mesh = BuildMesh(4);
+    const uint32_t limits[][2] = { { MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES }, { 3, 1 }, { 16, 8 }, { 128, 256 }, { 32, 124 } };
+    for (auto& limit : limits) {
+      std::vector<Meshlet> meshlets = BuildMeshlets(mesh, limit[0], limit[1]);
+      uint32_t bad = 0, nextIndex = 0, totalVertices = 0;
+      for (size_t m = 0; m < meshlets.size(); m++) {
+        const Meshlet& meshlet = meshlets[m];
+        bad += meshlet.indexStart != nextIndex || meshlet.trianglesCount == 0;
+        bad += meshlet.verticesCount > limit[0] || meshlet.trianglesCount > limit[1];
+        bad += meshlet.verticesCount != UniqueVertices(mesh.indices, meshlet.indexStart, meshlet.trianglesCount * 3);
+        nextIndex += meshlet.trianglesCount * 3;
+        totalVertices += meshlet.verticesCount;
+
+        // Greedy: next triangle didn't fit
+        if (m + 1 < meshlets.size()) {
+          uint32_t grown = UniqueVertices(mesh.indices, meshlet.indexStart, meshlet.trianglesCount * 3 + 3);
+          bad += grown <= limit[0] && meshlet.trianglesCount < limit[1];
+        }
+      }
+      bad += nextIndex != mesh.indices.size();
+      CHECK(bad == 0);
+      printf("build %3ux%-3u: %5zu meshlets, %.1f tris and %.1f vertices per meshlet\n", limit[0], limit[1], meshlets.size(),
+        mesh.indices.size() / 3.0 / meshlets.size(), (double)totalVertices / meshlets.size());
+    }
+
+    // Sphere holds every vertex, apex is behind every triangle plane, axis is within cone of every normal
+    std::vector<Meshlet> meshlets = BuildMeshlets(mesh);
+    uint32_t bad = 0, coneCount = 0;
+    for (const Meshlet& meshlet : meshlets) {
+      XMVECTOR center = XMLoadFloat4(&meshlet.boundingSphere);
+      XMVECTOR apex = XMLoadFloat4(&meshlet.coneApex);
+      XMVECTOR axis = XMLoadFloat4(&meshlet.coneAxis);
+      float cutoff = meshlet.coneAxis.w;
+      coneCount += cutoff < 1.0f;
+      float minDot = sqrtf((std::max)(1.0f - cutoff * cutoff, 0.0f));
+      for (uint32_t i = meshlet.indexStart; i < meshlet.indexStart + meshlet.trianglesCount * 3; i += 3) {
+        XMVECTOR p0 = Position(mesh, mesh.indices[i]), p1 = Position(mesh, mesh.indices[i + 1]), p2 = Position(mesh, mesh.indices[i + 2]);
+        for (XMVECTOR p : { p0, p1, p2 })
+          bad += XMVectorGetX(XMVector3Length(XMVectorSubtract(p, center))) > meshlet.boundingSphere.w * 1.0001f + 1e-6f;
+        if (cutoff >= 1.0f)
+          continue;
+        XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0)));
+        bad += XMVectorGetX(XMVector3Dot(normal, axis)) < minDot - 1e-4f;
+        bad += XMVectorGetX(XMVector3Dot(XMVectorSubtract(apex, p0), normal)) > 1e-5f;
+      }
+    }
+    CHECK(bad == 0);
+    // Small convex patches of sphere get cones, only scattered leftovers may not
+    CHECK(coneCount * 10 >= meshlets.size() * 9);
+    printf("bounds: %zu meshlets, %u with cones\n", meshlets.size(), coneCount);
+
+    // Normals spread over sphere: no cone, meshlet is never cone culled
+    Mesh small;
+    MeshGenerator::BuildIcosphere(0, small);
+    meshlets = BuildMeshlets(small);
+    CHECK(meshlets.size() == 1 && meshlets[0].coneAxis.w == 1.0f);
+
+    std::vector<Meshlet> none;
+    MeshletBuilder::Build(&small.vertices[0].pos, STRIDE, small.vertices.size(), small.indices.data(), 2, none);
+    CHECK(none.empty());
+  }
+
+  bool InFrustum(const XMFLOAT4* planes, XMVECTOR point) {
+    for (int p = 0; p < 6; p++)
+      if (XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&planes[p]), point)) < 0.0f)
+        return false;
+    return true;
+  }
+
+  // Brute force over triangles: front facing with a corner in frustum for any instance means meshlet has to be kept
+  void CheckCull(const Mesh& mesh, const std::vector<Meshlet>& meshlets, const std::vector<Instance>& instances, const CameraState& camera,
+    uint32_t& missed, uint32_t& needed, uint32_t& kept) {
+    std::vector<XMMATRIX> worlds;
+    for (const Instance& instance : instances)
+      worlds.push_back(instance.world);
+    std::vector<uint32_t> visible;
+    MeshletCullStats stats;
+    MeshletCuller::Cull(meshlets.data(), meshlets.size(), worlds.data(), worlds.size(), camera.GetFrustumPlanes(), camera.GetPosition(), visible, &stats);
+    CHECK(stats.visible == visible.size() && stats.visible + stats.coneCulled + stats.frustumCulled == meshlets.size());
+    CHECK(std::is_sorted(visible.begin(), visible.end()));
+
+    std::vector<uint8_t> isVisible(meshlets.size(), 0);
+    for (uint32_t m : visible)
+      isVisible[m] = 1;
+    XMVECTOR cameraPos = XMLoadFloat3(&camera.GetPosition());
+    for (size_t m = 0; m < meshlets.size(); m++) {
+      const Meshlet& meshlet = meshlets[m];
+      bool need = false;
+      for (size_t i = 0; i < worlds.size() && !need; i++) {
+        for (uint32_t t = meshlet.indexStart; t < meshlet.indexStart + meshlet.trianglesCount * 3 && !need; t += 3) {
+          XMVECTOR p0 = XMVector3TransformCoord(Position(mesh, mesh.indices[t]), worlds[i]);
+          XMVECTOR p1 = XMVector3TransformCoord(Position(mesh, mesh.indices[t + 1]), worlds[i]);
+          XMVECTOR p2 = XMVector3TransformCoord(Position(mesh, mesh.indices[t + 2]), worlds[i]);
+          XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+          bool front = XMVectorGetX(XMVector3Dot(normal, XMVectorSubtract(cameraPos, p0))) > 0.0f;
+          const XMFLOAT4* planes = camera.GetFrustumPlanes();
+          need = front && (InFrustum(planes, p0) || InFrustum(planes, p1) || InFrustum(planes, p2));
+        }
+      }
+      needed += need;
+      kept += isVisible[m];
+      missed += need && !isVisible[m];
+    }
+  }
+
+  XMMATRIX RandomWorld(TestRandom& random) {
+    XMVECTOR axis = XMVector3Normalize(XMVectorSet(random.Range(-1.0f, 1.0f), random.Range(0.01f, 1.0f), random.Range(-1.0f, 1.0f), 0.0f));
+    float scale = random.Range(0.5f, 4.0f);
+    return XMMatrixScaling(scale, scale, scale) * XMMatrixRotationAxis(axis, random.Range(0.0f, XM_2PI)) *
+      XMMatrixTranslation(random.Range(-10.0f, 10.0f), random.Range(-3.0f, 3.0f), random.Range(-10.0f, 10.0f));
+  }
+
+  void SetRandomCamera(TestRandom& random, CameraState& camera) {
+    XMFLOAT3 position(random.Range(-25.0f, 25.0f), random.Range(-8.0f, 8.0f), random.Range(-25.0f, 25.0f));
+    XMFLOAT3 target(random.Range(-5.0f, 5.0f), random.Range(-2.0f, 2.0f), random.Range(-5.0f, 5.0f));
+    camera.SetView(XMMatrixLookAtLH(XMLoadFloat3(&position), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)), position);
+    camera.SetPerspective(random.Range(0.5f, 1.5f), 16.0f / 9.0f, 0.1f, 100.0f);
+  }
+
+  void TestCull() {
+    Mesh mesh = BuildMesh(3);
+    std::vector<Meshlet> meshlets = BuildMeshlets(mesh);
+    TestRandom random(35);
+    CameraState camera;
+    uint32_t missed = 0, needed = 0, kept = 0;
+    for (uint32_t set = 0; set < 300; set++) {
+      SetRandomCamera(random, camera);
+      std::vector<Instance> instances(1 + random.Next() % 3);
+      for (Instance& instance : instances)
+        instance.world = RandomWorld(random);
+      CheckCull(mesh, meshlets, instances, camera, missed, needed, kept);
+      FrameArena::ResetAll();
+    }
+    CHECK(missed == 0);
+    printf("cull: 300 views, %u meshlets needed, %u kept, %u missed\n", needed, kept, missed);
+
+    // Camera inside sphere sees insides only, narrow cones of small meshlets cull them
+    Mesh fine = BuildMesh(4);
+    std::vector<Meshlet> fineMeshlets = BuildMeshlets(fine);
+    camera.SetView(XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)), XMFLOAT3(0, 0, 0));
+    camera.SetPerspective(1.0f, 1.0f, 0.01f, 100.0f);
+    XMMATRIX world = XMMatrixScaling(5.0f, 5.0f, 5.0f);
+    std::vector<uint32_t> visible;
+    MeshletCullStats stats;
+    MeshletCuller::Cull(fineMeshlets.data(), fineMeshlets.size(), &world, 1, camera.GetFrustumPlanes(), camera.GetPosition(), visible, &stats);
+    CHECK(stats.coneCulled > 0 && stats.frustumCulled > 0 && stats.visible * 4 < stats.coneCulled);
+    printf("inside sphere: %u visible, %u cone culled, %u frustum culled\n", stats.visible, stats.coneCulled, stats.frustumCulled);
+
+    // Far outside and behind camera: frustum culled
+    world = XMMatrixTranslation(0.0f, 0.0f, -50.0f);
+    MeshletCuller::Cull(meshlets.data(), meshlets.size(), &world, 1, camera.GetFrustumPlanes(), camera.GetPosition(), visible, &stats);
+    CHECK(visible.empty() && stats.frustumCulled == meshlets.size());
+    MeshletCuller::Cull(meshlets.data(), meshlets.size(), &world, 0, camera.GetFrustumPlanes(), camera.GetPosition(), visible, &stats);
+    CHECK(visible.empty() && stats.frustumCulled == meshlets.size());
+    FrameArena::ResetAll();
+  }
+
+  // Draw list merges neighbours, compaction gives the same indices as the ranges for both index sizes
+  void TestDrawList() {
+    Mesh mesh = BuildMesh(4);
+    std::vector<Meshlet> meshlets = BuildMeshlets(mesh);
+    std::vector<uint16_t> indices16(mesh.indices.begin(), mesh.indices.end());
+    TestRandom random(350);
+    uint32_t bad = 0;
+    std::vector<uint32_t> result32(mesh.indices.size());
+    std::vector<uint16_t> result16(mesh.indices.size());
+    for (uint32_t set = 0; set < 200; set++) {
+      std::vector<uint32_t> visible;
+      uint32_t keep = random.Next() % 5;
+      for (uint32_t m = 0; m < meshlets.size(); m++)
+        if (random.Next() % 5 < keep)
+          visible.push_back(m);
+
+      std::vector<MeshletDrawRange> ranges;
+      MeshletCuller::BuildDrawList(meshlets.data(), visible, ranges);
+      std::vector<uint32_t> expected;
+      for (size_t r = 0; r < ranges.size(); r++) {
+        bad += r > 0 && ranges[r - 1].indexStart + ranges[r - 1].indicesCount == ranges[r].indexStart;
+        expected.insert(expected.end(), mesh.indices.begin() + ranges[r].indexStart,
+          mesh.indices.begin() + ranges[r].indexStart + ranges[r].indicesCount);
+      }
+      size_t visibleIndices = 0;
+      for (uint32_t m : visible)
+        visibleIndices += meshlets[m].trianglesCount * 3;
+      bad += expected.size() != visibleIndices;
+
+      uint32_t written32 = MeshletCuller::Compact(meshlets.data(), visible, mesh.indices.data(), 4, result32.data());
+      uint32_t written16 = MeshletCuller::Compact(meshlets.data(), visible, indices16.data(), 2, result16.data());
+      bad += written32 != expected.size() || written16 != expected.size();
+      for (size_t i = 0; i < expected.size() && i < written32; i++)
+        bad += result32[i] != expected[i] || result16[i] != expected[i];
+    }
+    CHECK(bad == 0);
+
+    std::vector<uint32_t> all(meshlets.size());
+    for (uint32_t m = 0; m < all.size(); m++)
+      all[m] = m;
+    std::vector<MeshletDrawRange> ranges;
+    MeshletCuller::BuildDrawList(meshlets.data(), all, ranges);
+    CHECK(ranges.size() == 1 && ranges[0].indexStart == 0 && ranges[0].indicesCount == mesh.indices.size());
+  }
+
+  void BenchCull() {
+    Mesh mesh = BuildMesh(6);
+    TestClock::time_point start = TestClock::now();
+    std::vector<Meshlet> meshlets = BuildMeshlets(mesh);
+    double buildMs = ElapsedMs(start);
+
+    TestRandom random(3500);
+    const uint32_t INSTANCES_COUNT = 16, VIEWS_COUNT = 50;
+    std::vector<XMMATRIX> worlds(INSTANCES_COUNT);
+    for (auto& world : worlds)
+      world = RandomWorld(random);
+    CameraState camera;
+    std::vector<uint32_t> visible;
+    std::vector<uint32_t> compacted(mesh.indices.size());
+    uint64_t visibleIndices = 0;
+    double cullMs = 0.0, compactMs = 0.0;
+    for (uint32_t v = 0; v < VIEWS_COUNT; v++) {
+      SetRandomCamera(random, camera);
+      for (size_t i = 0; i < worlds.size(); i++) {
+        start = TestClock::now();
+        MeshletCuller::Cull(meshlets.data(), meshlets.size(), &worlds[i], 1, camera.GetFrustumPlanes(), camera.GetPosition(), visible);
+        cullMs += ElapsedMs(start);
+        start = TestClock::now();
+        visibleIndices += MeshletCuller::Compact(meshlets.data(), visible, mesh.indices.data(), 4, compacted.data());
+        compactMs += ElapsedMs(start);
+      }
+      FrameArena::ResetAll();
+    }
+    uint32_t calls = INSTANCES_COUNT * VIEWS_COUNT;
+    printf("%zu tris, %zu meshlets: build %.1f ms, cull %.3f ms, compact %.3f ms per instance, %.1f%% of triangles drawn\n",
+      mesh.indices.size() / 3, meshlets.size(), buildMs, cullMs / calls, compactMs / calls,
+      100.0 * visibleIndices / ((double)mesh.indices.size() * calls));
+  }
+}
+
+int main() {
+  TestBuild();
+  TestCull();
+  TestDrawList();
+  BenchCull();
+  return TestResult();
+}
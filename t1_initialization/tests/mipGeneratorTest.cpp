@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "mipGenerator.h"
+#include "testCommon.h"
+
+// Generated levels against reference outputs: hand computed box averages,
+// straightforward double precision Kaiser filter and sRGB math
+namespace {
+  const double PI = 3.14159265358979323846;
+
+  struct Color {
+    double c[4];
+  };
+
+  typedef std::vector<Color> RefImage;
+
+  double ToLinear(double value) {
+    return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+  }
+
+  double ToSRGB(double value) {
+    return value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+  }
+
+  double BesselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; k++) {
+      term *= (x * 0.5 / k) * (x * 0.5 / k);
+      sum += term;
+    }
+    return sum;
+  }
+
+  // Kaiser windowed sinc, alpha 4, half width 1.5 destination pixels
+  double KaiserWeight(double d) {
+    double t = d / 1.5;
+    if (fabs(t) >= 1.0)
+      return 0.0;
+    double sinc = fabs(d) < 1e-9 ? 1.0 : sin(PI * d) / (PI * d);
+    return sinc * BesselI0(4.0 * sqrt(1.0 - t * t)) / BesselI0(4.0);
+  }
+
+  // Weights of every source texel for destination pixel x, taps outside image go to its border texel
+  std::vector<double> AxisWeights(uint32_t srcSize, uint32_t dstSize, uint32_t x) {
+    double scale = double(srcSize) / dstSize;
+    double center = (x + 0.5) * scale;
+    std::vector<double> weights(srcSize, 0.0);
+    double sum = 0.0;
+    for (int s = -16; s < int(srcSize) + 16; s++) {
+      double w = KaiserWeight((s + 0.5 - center) / scale);
+      weights[std::min(std::max(s, 0), int(srcSize) - 1)] += w;
+      sum += w;
+    }
+    for (auto& w : weights)
+      w /= sum;
+    return weights;
+  }
+
+  RefImage RefKaiser(const RefImage& src, uint32_t width, uint32_t height, uint32_t dstWidth, uint32_t dstHeight) {
+    RefImage dst(size_t(dstWidth) * dstHeight);
+    for (uint32_t y = 0; y < dstHeight; y++) {
+      std::vector<double> wy = AxisWeights(height, dstHeight, y);
+      for (uint32_t x = 0; x < dstWidth; x++) {
+        std::vector<double> wx = AxisWeights(width, dstWidth, x);
+        Color sum = {};
+        for (uint32_t sy = 0; sy < height; sy++)
+          for (uint32_t sx = 0; sx < width; sx++)
+            for (int c = 0; c < 4; c++)
+              sum.c[c] += wx[sx] * wy[sy] * src[size_t(sy) * width + sx].c[c];
+        dst[size_t(y) * dstWidth + x] = sum;
+      }
+    }
+    return dst;
+  }
+
+  std::vector<float> RandomFloats(uint32_t width, uint32_t height, uint32_t seed) {
+    TestRandom random(seed);
+    std::vector<float> data(size_t(width) * height * 4);
+    for (auto& value : data)
+      value = random.Range(0.0f, 1.0f);
+    return data;
+  }
+
+  RefImage ToRef(const float* data, uint32_t width, uint32_t height) {
+    RefImage image(size_t(width) * height);
+    for (size_t i = 0; i < image.size(); i++)
+      for (int c = 0; c < 4; c++)
+        image[i].c[c] = data[i * 4 + c];
+    return image;
+  }
+
+  // Every level of RGBA32F chain matches reference filter of level above it
+  void TestKaiserFloat(uint32_t width, uint32_t height) {
+    std::vector<float> src = RandomFloats(width, height, width * 131 + height);
+    std::vector<MipLevel> mips;
+    CHECK(MipGenerator::Generate(reinterpret_cast<const uint8_t*>(src.data()), width, height, width * 16,
+      DXGI_FORMAT_R32G32B32A32_FLOAT, MIP_FILTER_KAISER, false, 0, mips));
+    CHECK(mips.size() + 1 == MipGenerator::CountMips(width, height));
+
+    RefImage prev = ToRef(src.data(), width, height);
+    uint32_t prevWidth = width, prevHeight = height;
+    double error = 0.0;
+    for (const MipLevel& mip : mips) {
+      CHECK(mip.width == std::max(prevWidth / 2, 1u) && mip.height == std::max(prevHeight / 2, 1u));
+      RefImage expected = RefKaiser(prev, prevWidth, prevHeight, mip.width, mip.height);
+      const float* data = reinterpret_cast<const float*>(mip.data.data());
+      for (size_t i = 0; i < expected.size(); i++)
+        for (int c = 0; c < 4; c++)
+          error = std::max(error, fabs(data[i * 4 + c] - expected[i].c[c]));
+      prev = ToRef(data, mip.width, mip.height);
+      prevWidth = mip.width;
+      prevHeight = mip.height;
+    }
+    printf("kaiser %ux%u: %u levels, max error vs reference %g\n", width, height, (uint32_t)mips.size(), error);
+    CHECK(error < 1e-5);
+  }
+
+  // Odd sizes: kernel is stretched to the exact ratio, so mirrored image gives mirrored mip
+  void TestKaiserOddSymmetry() {
+    const uint32_t width = 7, height = 5;
+    std::vector<float> src = RandomFloats(width, height, 99);
+    std::vector<float> mirrored(src.size());
+    for (uint32_t y = 0; y < height; y++)
+      for (uint32_t x = 0; x < width; x++)
+        memcpy(&mirrored[(size_t(height - 1 - y) * width + (width - 1 - x)) * 4], &src[(size_t(y) * width + x) * 4], 16);
+
+    std::vector<MipLevel> mips, mirroredMips;
+    MipGenerator::Generate(reinterpret_cast<const uint8_t*>(src.data()), width, height, width * 16,
+      DXGI_FORMAT_R32G32B32A32_FLOAT, MIP_FILTER_KAISER, false, 2, mips);
+    MipGenerator::Generate(reinterpret_cast<const uint8_t*>(mirrored.data()), width, height, width * 16,
+      DXGI_FORMAT_R32G32B32A32_FLOAT, MIP_FILTER_KAISER, false, 2, mirroredMips);
+    CHECK(mips.size() == 1 && mirroredMips.size() == 1);
+
+    const MipLevel& mip = mips[0];
+    const float* a = reinterpret_cast<const float*>(mip.data.data());
+    const float* b = reinterpret_cast<const float*>(mirroredMips[0].data.data());
+    double error = 0.0;
+    for (uint32_t y = 0; y < mip.height; y++)
+      for (uint32_t x = 0; x < mip.width; x++)
+        for (int c = 0; c < 4; c++)
+          error = std::max(error, (double)fabsf(a[(size_t(y) * mip.width + x) * 4 + c] -
+            b[(size_t(mip.height - 1 - y) * mip.width + (mip.width - 1 - x)) * 4 + c]));
+    printf("kaiser odd symmetry: max difference %g\n", error);
+    CHECK(error < 1e-5);
+  }
+
+  // Box averages computed by hand, odd sizes give 3 texels wide last row / column
+  void TestBox() {
+    const uint32_t width = 5, height = 3;
+    std::vector<float> src(width * height * 4);
+    for (uint32_t y = 0; y < height; y++)
+      for (uint32_t x = 0; x < width; x++)
+        for (int c = 0; c < 4; c++)
+          src[(y * width + x) * 4 + c] = float(x + 10 * y + c);
+
+    std::vector<MipLevel> mips;
+    CHECK(MipGenerator::Generate(reinterpret_cast<const uint8_t*>(src.data()), width, height, width * 16,
+      DXGI_FORMAT_R32G32B32A32_FLOAT, MIP_FILTER_BOX, false, 0, mips));
+    CHECK(mips.size() == 2);
+    CHECK(mips[0].width == 2 && mips[0].height == 1 && mips[1].width == 1 && mips[1].height == 1);
+
+    // Columns 0-1 / 2-4, rows 0-2; then average of both
+    const float expected[3] = { 0.5f + 10.0f, 3.0f + 10.0f, 11.75f };
+    const float* level1 = reinterpret_cast<const float*>(mips[0].data.data());
+    const float* level2 = reinterpret_cast<const float*>(mips[1].data.data());
+    for (int c = 0; c < 4; c++) {
+      CHECK(fabsf(level1[c] - (expected[0] + c)) < 1e-5f);
+      CHECK(fabsf(level1[4 + c] - (expected[1] + c)) < 1e-5f);
+      CHECK(fabsf(level2[c] - (expected[2] + c)) < 1e-5f);
+    }
+
+    // 2x2 blocks of even image
+    std::vector<float> even(4 * 2 * 4);
+    for (uint32_t i = 0; i < 8; i++)
+      for (int c = 0; c < 4; c++)
+        even[i * 4 + c] = float(i);
+    MipGenerator::Generate(reinterpret_cast<const uint8_t*>(even.data()), 4, 2, 4 * 16,
+      DXGI_FORMAT_R32G32B32A32_FLOAT, MIP_FILTER_BOX, false, 2, mips);
+    const float* half = reinterpret_cast<const float*>(mips[0].data.data());
+    CHECK(mips.size() == 1 && half[0] == (0 + 1 + 4 + 5) / 4.0f && half[4] == (2 + 3 + 6 + 7) / 4.0f);
+    printf("box: hand computed averages match\n");
+  }
+
+  uint8_t Quantize(double value) {
+    return (uint8_t)std::min(std::max(floor(value * 255.0 + 0.5), 0.0), 255.0);
+  }
+
+  // RGBA8 with and without gamma correction, alpha is never converted
+  void TestGamma(MipFilter filter, DXGI_FORMAT format, bool gammaCorrect) {
+    const uint32_t width = 6, height = 5;
+    TestRandom random(5);
+    std::vector<uint8_t> src(width * height * 4);
+    for (auto& value : src)
+      value = (uint8_t)(random.Next() >> 24);
+
+    bool linear = gammaCorrect || format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    RefImage ref(width * height);
+    for (uint32_t i = 0; i < width * height; i++)
+      for (int c = 0; c < 4; c++)
+        ref[i].c[c] = (linear && c < 3) ? ToLinear(src[i * 4 + c] / 255.0) : src[i * 4 + c] / 255.0;
+
+    std::vector<MipLevel> mips;
+    CHECK(MipGenerator::Generate(src.data(), width, height, width * 4, format, filter, gammaCorrect, 2, mips));
+    CHECK(mips.size() == 1);
+    const MipLevel& mip = mips[0];
+
+    RefImage expected;
+    if (filter == MIP_FILTER_KAISER) {
+      expected = RefKaiser(ref, width, height, mip.width, mip.height);
+    }
+    else {
+      expected.resize(mip.width * mip.height);
+      for (uint32_t y = 0; y < mip.height; y++)
+        for (uint32_t x = 0; x < mip.width; x++)
+          for (int c = 0; c < 4; c++) {
+            // 6x5 -> 3x2: last row takes source rows 2-4
+            uint32_t rows = (y + 1 == mip.height) ? height - 2 * y : 2;
+            double sum = 0.0;
+            for (uint32_t r = 0; r < rows; r++)
+              sum += ref[(2 * y + r) * width + 2 * x].c[c] + ref[(2 * y + r) * width + 2 * x + 1].c[c];
+            expected[y * mip.width + x].c[c] = sum / (2 * rows);
+          }
+    }
+
+    int maxDifference = 0;
+    for (uint32_t i = 0; i < mip.width * mip.height; i++)
+      for (int c = 0; c < 4; c++) {
+        double value = std::min(std::max(expected[i].c[c], 0.0), 1.0);
+        uint8_t reference = Quantize((linear && c < 3) ? ToSRGB(value) : value);
+        maxDifference = std::max(maxDifference, abs(int(mip.data[i * 4 + c]) - int(reference)));
+      }
+    printf("%s %s gamma %s: max difference %d\n", filter == MIP_FILTER_KAISER ? "kaiser" : "box",
+      format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ? "srgb" : "unorm", gammaCorrect ? "on" : "off", maxDifference);
+    CHECK(maxDifference <= 1);
+  }
+
+  // Gamma correct average of black and white is not mid gray
+  void TestGammaMidpoint() {
+    const uint8_t src[8] = { 0, 0, 0, 255, 254, 254, 254, 1 };
+    std::vector<MipLevel> mips;
+    MipGenerator::Generate(src, 2, 1, 8, DXGI_FORMAT_R8G8B8A8_UNORM, MIP_FILTER_BOX, false, 2, mips);
+    CHECK(mips.size() == 1 && mips[0].data[0] == 127 && mips[0].data[3] == 128);
+    MipGenerator::Generate(src, 2, 1, 8, DXGI_FORMAT_R8G8B8A8_UNORM, MIP_FILTER_BOX, true, 2, mips);
+    uint8_t gray = Quantize(ToSRGB(ToLinear(254 / 255.0) * 0.5));
+    CHECK(mips.size() == 1 && mips[0].data[0] == gray && mips[0].data[3] == 128);
+    printf("gamma midpoint: %u off, %u on\n", 127, gray);
+  }
+
+  // Flat image stays flat through whole chain with every filter and format
+  void TestConstant(DXGI_FORMAT format, MipFilter filter) {
+    const uint32_t width = 13, height = 6;
+    size_t bpp = MipGenerator::BytesPerPixel(format);
+    std::vector<uint8_t> src(width * height * bpp);
+    for (size_t i = 0; i < src.size(); i += bpp) {
+      if (bpp == 4) {
+        const uint8_t pixel[4] = { 200, 100, 50, 255 };
+        memcpy(&src[i], pixel, 4);
+      }
+      else if (bpp == 8) {
+        const uint16_t pixel[4] = { 0x3C00, 0x3800, 0x3400, 0x3C00 };  // 1, 0.5, 0.25, 1
+        memcpy(&src[i], pixel, 8);
+      }
+      else {
+        const float pixel[4] = { 1.0f, 0.5f, 0.25f, 1.0f };
+        memcpy(&src[i], pixel, 16);
+      }
+    }
+
+    std::vector<MipLevel> mips;
+    CHECK(MipGenerator::Generate(src.data(), width, height, width * bpp, format, filter, true, 0, mips));
+    // Normalized weights sum to 1 up to float rounding, quantized formats must come back exact
+    bool flat = true;
+    for (const MipLevel& mip : mips) {
+      if (format == DXGI_FORMAT_R32G32B32A32_FLOAT) {
+        const float* data = reinterpret_cast<const float*>(mip.data.data());
+        const float* pixel = reinterpret_cast<const float*>(src.data());
+        for (size_t i = 0; i < mip.data.size() / 4; i++)
+          flat = flat && fabsf(data[i] - pixel[i % 4]) < 1e-6f;
+      }
+      else {
+        for (size_t i = 0; i < mip.data.size(); i++)
+          flat = flat && mip.data[i] == src[i % bpp];
+      }
+    }
+    CHECK(flat);
+  }
+
+  void BenchGenerate() {
+    const uint32_t size = 1024;
+    std::vector<uint8_t> src(size * size * 4);
+    TestRandom random(1);
+    for (auto& value : src)
+      value = (uint8_t)(random.Next() >> 24);
+
+    std::vector<MipLevel> mips;
+    for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER }) {
+      TestClock::time_point start = TestClock::now();
+      MipGenerator::Generate(src.data(), size, size, size * 4, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, filter, false, 0, mips);
+      printf("%ux%u srgb chain, %s: %.2f ms\n", size, size, filter == MIP_FILTER_KAISER ? "kaiser" : "box", ElapsedMs(start));
+    }
+  }
+}
+
+int main() {
+  TestBox();
+  for (uint32_t size : { 8u, 16u })
+    TestKaiserFloat(size, size);
+  TestKaiserFloat(7, 5);
+  TestKaiserFloat(5, 8);
+  TestKaiserFloat(9, 3);
+  TestKaiserFloat(1, 6);
+  TestKaiserOddSymmetry();
+  for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER }) {
+    TestGamma(filter, DXGI_FORMAT_R8G8B8A8_UNORM, false);
+    TestGamma(filter, DXGI_FORMAT_R8G8B8A8_UNORM, true);
+    TestGamma(filter, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, false);
+    for (DXGI_FORMAT format : { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT })
+      TestConstant(format, filter);
+  }
+  TestGammaMidpoint();
+  BenchGenerate();
+  return TestResult();
+}
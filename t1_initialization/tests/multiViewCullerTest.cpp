@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "multiViewCuller.h"
+#include "frustumCulling.h"
+#include "testCommon.h"
+
+namespace {
+  const uint32_t BOXES_COUNT = 20000;
+  const uint32_t BENCH_REPEATS = 20;
+
+  // Rotated and scaled unit boxes spread over scene
+  void MakeBoxes(TestRandom& random, std::vector<XMFLOAT4>& bbMin, std::vector<XMFLOAT4>& bbMax) {
+    const XMFLOAT4 localMin(-0.5f, -0.5f, -0.5f, 1.0f);
+    const XMFLOAT4 localMax(0.5f, 0.5f, 0.5f, 1.0f);
+    bbMin.resize(BOXES_COUNT);
+    bbMax.resize(BOXES_COUNT);
+    for (uint32_t i = 0; i < BOXES_COUNT; i++) {
+      float scale = random.Range(0.2f, 2.0f);
+      XMMATRIX world = XMMatrixScaling(scale, scale, scale) * XMMatrixRotationX(random.Range(0.0f, XM_2PI)) *
+        XMMatrixRotationY(random.Range(0.0f, XM_2PI)) * XMMatrixRotationZ(random.Range(0.0f, XM_2PI)) *
+        XMMatrixTranslation(random.Range(-30.0f, 30.0f), random.Range(-10.0f, 10.0f), random.Range(-30.0f, 30.0f));
+      MultiViewCuller::TransformBounds(localMin, localMax, world, bbMin[i], bbMax[i]);
+    }
+  }
+
+  // Main perspective view, 4 orthographic cascades along light direction, mirrored perspective view
+  void MakeViews(std::vector<CullView>& views) {
+    XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(3.0f, 2.0f, -8.0f, 0.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    FrustumCulling frustum;
+    frustum.Init(0.01f);
+    frustum.ConstructFrustum(view, XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 100.0f, 0.01f));
+    views.push_back(CullView::FromPlanes(frustum.GetPlanes()));
+
+    XMMATRIX lightView = XMMatrixLookAtLH(XMVectorSet(10.0f, 20.0f, 5.0f, 0.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    for (uint32_t c = 0; c < 4; c++) {
+      float size = 4.0f * (1 << c);
+      views.push_back(CullView::FromViewProjection(lightView * XMMatrixOrthographicLH(size, size, 0.1f, 60.0f)));
+    }
+
+    XMMATRIX mirrorView = XMMatrixLookAtLH(XMVectorSet(3.0f, -2.0f, -8.0f, 0.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    views.push_back(CullView::FromViewProjection(mirrorView * XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 0.01f, 100.0f)));
+  }
+
+  bool IsInside(const CullView& view, const XMFLOAT4& bbMin, const XMFLOAT4& bbMax) {
+    for (uint32_t p = 0; p < 6; p++)
+      if (FrustumCulling::IsOutside(view.planes[p], bbMin, bbMax))
+        return false;
+    return true;
+  }
+
+  void TestTransformBounds(TestRandom& random) {
+    const XMFLOAT4 localMin(-1.0f, -0.5f, -2.0f, 1.0f);
+    const XMFLOAT4 localMax(1.0f, 1.5f, 0.5f, 1.0f);
+    float maxError = 0.0f;
+    for (uint32_t t = 0; t < 10000; t++) {
+      XMMATRIX world = XMMatrixScaling(random.Range(0.1f, 3.0f), random.Range(0.1f, 3.0f), random.Range(0.1f, 3.0f)) *
+        XMMatrixRotationX(random.Range(0.0f, XM_2PI)) * XMMatrixRotationY(random.Range(0.0f, XM_2PI)) *
+        XMMatrixRotationZ(random.Range(0.0f, XM_2PI)) *
+        XMMatrixTranslation(random.Range(-50.0f, 50.0f), random.Range(-50.0f, 50.0f), random.Range(-50.0f, 50.0f));
+      XMFLOAT4 bbMin, bbMax;
+      MultiViewCuller::TransformBounds(localMin, localMax, world, bbMin, bbMax);
+
+      // Exact bounds of transformed corners
+      XMVECTOR cornersMin = XMVectorReplicate(FLT_MAX);
+      XMVECTOR cornersMax = XMVectorReplicate(-FLT_MAX);
+      for (uint32_t k = 0; k < 8; k++) {
+        XMVECTOR corner = XMVectorSet((k & 1) ? localMax.x : localMin.x, (k & 2) ? localMax.y : localMin.y,
+          (k & 4) ? localMax.z : localMin.z, 1.0f);
+        corner = XMVector3TransformCoord(corner, world);
+        cornersMin = XMVectorMin(cornersMin, corner);
+        cornersMax = XMVectorMax(cornersMax, corner);
+      }
+      XMFLOAT4 exactMin, exactMax;
+      XMStoreFloat4(&exactMin, cornersMin);
+      XMStoreFloat4(&exactMax, cornersMax);
+      maxError = std::max({ maxError, fabsf(bbMin.x - exactMin.x), fabsf(bbMin.y - exactMin.y), fabsf(bbMin.z - exactMin.z),
+        fabsf(bbMax.x - exactMax.x), fabsf(bbMax.y - exactMax.y), fabsf(bbMax.z - exactMax.z) });
+      CHECK(bbMin.w == 1.0f && bbMax.w == 1.0f);
+    }
+    printf("transform bounds: max error vs transformed corners %g\n", maxError);
+    CHECK(maxError < 1e-3f);
+  }
+}
+
+int main() {
+  TestRandom random(5);
+  TestTransformBounds(random);
+
+  std::vector<XMFLOAT4> bbMin, bbMax;
+  MakeBoxes(random, bbMin, bbMax);
+  std::vector<CullView> views;
+  MakeViews(views);
+  uint32_t viewsCount = (uint32_t)views.size();
+
+  // Reference: every view in its own pass with 8 corner plane tests
+  std::vector<uint32_t> reference(BOXES_COUNT);
+  TestClock::time_point start = TestClock::now();
+  for (uint32_t r = 0; r < BENCH_REPEATS; r++) {
+    std::fill(reference.begin(), reference.end(), 0u);
+    for (uint32_t v = 0; v < viewsCount; v++)
+      for (uint32_t i = 0; i < BOXES_COUNT; i++)
+        if (IsInside(views[v], bbMin[i], bbMax[i]))
+          reference[i] |= 1u << v;
+  }
+  double separateMs = ElapsedMs(start) / BENCH_REPEATS;
+
+  MultiViewCuller culler;
+  culler.SetViews(views.data(), viewsCount);
+  std::vector<uint32_t> masks(BOXES_COUNT);
+  start = TestClock::now();
+  for (uint32_t r = 0; r < BENCH_REPEATS; r++)
+    culler.Cull(bbMin.data(), bbMax.data(), BOXES_COUNT, masks.data());
+  double multiMs = ElapsedMs(start) / BENCH_REPEATS;
+
+  uint32_t mismatches = 0;
+  for (uint32_t i = 0; i < BOXES_COUNT; i++)
+    mismatches += masks[i] != reference[i];
+  CHECK(mismatches == 0);
+
+  // Lists hold exactly masked boxes, in growing order
+  std::vector<uint32_t> ids(size_t(BOXES_COUNT) * viewsCount);
+  std::vector<uint32_t> offsets(viewsCount + 1);
+  MultiViewCuller::BuildLists(masks.data(), BOXES_COUNT, viewsCount, ids.data(), offsets.data());
+  CHECK(offsets[0] == 0);
+  printf("views %u, boxes %u, visible per view:", viewsCount, BOXES_COUNT);
+  for (uint32_t v = 0; v < viewsCount; v++) {
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < BOXES_COUNT; i++)
+      expected += (masks[i] >> v) & 1;
+    CHECK(offsets[v + 1] - offsets[v] == expected);
+    for (uint32_t k = offsets[v]; k < offsets[v + 1]; k++) {
+      CHECK((masks[ids[k]] >> v) & 1);
+      CHECK(k == offsets[v] || ids[k] > ids[k - 1]);
+    }
+    printf(" %u", expected);
+  }
+  printf("\n");
+  printf("cull: %u separate view passes %.3f ms, one multi-view pass %.3f ms\n", viewsCount, separateMs, multiMs);
+
+  // All 32 view slots, groups of four views are filled completely
+  std::vector<CullView> manyViews(CULL_MAX_VIEWS);
+  for (uint32_t v = 0; v < CULL_MAX_VIEWS; v++)
+    manyViews[v] = views[v % viewsCount];
+  culler.SetViews(manyViews.data(), CULL_MAX_VIEWS);
+  CHECK(culler.GetViewsCount() == CULL_MAX_VIEWS);
+  culler.Cull(bbMin.data(), bbMax.data(), BOXES_COUNT, masks.data());
+  mismatches = 0;
+  for (uint32_t i = 0; i < BOXES_COUNT; i++) {
+    uint32_t expected = 0;
+    for (uint32_t v = 0; v < CULL_MAX_VIEWS; v++)
+      expected |= ((reference[i] >> (v % viewsCount)) & 1) << v;
+    mismatches += masks[i] != expected;
+  }
+  CHECK(mismatches == 0);
+
+  return TestResult();
+}
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "planeBatch.h"
+#include "frameArena.h"
+#include "testCommon.h"
+
+// Transparent plane instances: back to front order, matrix and color stay paired, OIT keeps entity order.
+// Submission is recorded instead of going to device, per plane and batched command streams are compared
+namespace {
+  // Stands for device context: every call is recorded with its data copied, as deferred context does
+  class RecordingContext {
+  public:
+    enum COMMAND {
+      COMMAND_UPDATE,   // UpdateSubresource
+      COMMAND_MAP,      // Map(WRITE_DISCARD) + Unmap
+      COMMAND_BIND_CB,  // VS / PSSetConstantBuffers
+      COMMAND_DRAW      // DrawIndexed(Instanced)
+    };
+
+    struct Command {
+      COMMAND type;
+      uint32_t bytes;
+      uint32_t instances;
+    };
+
+    void Reset() {
+      commands.clear();
+      data.clear();
+    }
+
+    void UpdateSubresource(const void* source, uint32_t bytes) {
+      commands.push_back({ COMMAND_UPDATE, bytes, 0 });
+      data.insert(data.end(), static_cast<const uint8_t*>(source), static_cast<const uint8_t*>(source) + bytes);
+    }
+
+    // Pointer stays valid until next recorded call
+    void* Map(uint32_t bytes) {
+      commands.push_back({ COMMAND_MAP, bytes, 0 });
+      data.resize(data.size() + bytes);
+      return data.data() + data.size() - bytes;
+    }
+
+    void BindConstantBuffer() {
+      commands.push_back({ COMMAND_BIND_CB, 0, 0 });
+    }
+
+    void Draw(uint32_t instances) {
+      commands.push_back({ COMMAND_DRAW, 0, instances });
+    }
+
+    uint32_t CountOf(COMMAND type) const {
+      return (uint32_t)std::count_if(commands.begin(), commands.end(), [type](const Command& command) { return command.type == type; });
+    }
+
+    std::vector<Command> commands;
+    std::vector<uint8_t> data;
+  };
+
+  // Plane i: translation row encodes i and a random depth, color.x is i too
+  void CreatePlanes(World& world, TestRandom& random, uint32_t count) {
+    uint32_t first = world.Count<TransformComponent, ColorComponent>();
+    for (uint32_t i = 0; i < count; i++) {
+      Entity entity = world.Create<TransformComponent, ColorComponent>();
+      XMMATRIX matrix = XMMatrixRotationY(random.Range(0.0f, XM_2PI)) *
+        XMMatrixTranslation(random.Range(-20.0f, 20.0f), (float)(first + i), random.Range(-20.0f, 20.0f));
+      XMStoreFloat4x4(&world.Get<TransformComponent>(entity)->world, matrix);
+      world.Get<ColorComponent>(entity)->color = XMFLOAT4((float)(first + i), random.Range(0.0f, 1.0f), random.Range(0.0f, 1.0f), 0.5f);
+    }
+  }
+
+  float ViewDepth(const PlaneInstance& instance, const XMMATRIX& view) {
+    XMVECTOR center = XMVectorSet(instance.worldMatrix._41, instance.worldMatrix._42, instance.worldMatrix._43, 1.0f);
+    return XMVectorGetZ(XMVector3TransformCoord(center, view));
+  }
+
+  // Submission before instancing: one constant buffer update per plane, two binds and a draw per plane
+  void SubmitPerPlane(RecordingContext& context, const std::vector<PlaneInstance>& instances) {
+    for (const PlaneInstance& instance : instances)
+      context.UpdateSubresource(&instance, sizeof(PlaneInstance));
+    context.BindConstantBuffer();
+    for (size_t i = 0; i < instances.size(); i++) {
+      context.BindConstantBuffer();
+      context.BindConstantBuffer();
+      context.Draw(1);
+    }
+  }
+
+  // Plane::Frame and Plane::Render: one upload in render order, scene buffer bind and one instanced draw
+  void SubmitBatched(RecordingContext& context, PlaneBatch& batch, World& world, const XMMATRIX& view, bool sorted, uint32_t capacity) {
+    uint32_t count = PlaneBatch::Count(world, capacity);
+    if (count == 0)
+      return;
+    auto instances = static_cast<PlaneInstance*>(context.Map(count * sizeof(PlaneInstance)));
+    uint32_t written = batch.Write(world, view, sorted, capacity, instances);
+    CHECK(written == count);
+    context.BindConstantBuffer();
+    context.Draw(written);
+  }
+
+  void TestOrder() {
+    TestRandom random(36);
+    World world;
+    CreatePlanes(world, random, 3000);
+    // Transform only entities are not planes
+    for (uint32_t i = 0; i < 100; i++)
+      world.Create<TransformComponent>();
+    CHECK(PlaneBatch::Count(world, 100000) == 3000 && PlaneBatch::Count(world, 10) == 10);
+
+    PlaneBatch batch;
+    std::vector<PlaneInstance> instances(3000);
+    uint32_t unsorted = 0, unpaired = 0;
+    for (uint32_t view = 0; view < 20; view++) {
+      XMFLOAT3 eye(random.Range(-40.0f, 40.0f), random.Range(-10.0f, 10.0f), random.Range(-40.0f, 40.0f));
+      XMMATRIX viewMatrix = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorSet(0.0f, 1500.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+      CHECK(batch.Write(world, viewMatrix, true, 3000, instances.data()) == 3000);
+      std::vector<uint8_t> seen(3000, 0);
+      float prevDepth = 0.0f;
+      for (uint32_t i = 0; i < 3000; i++) {
+        // Keys come from SIMD transform, allow its rounding
+        float depth = ViewDepth(instances[i], viewMatrix);
+        unsorted += i > 0 && depth > prevDepth + 1e-5f * std::fabs(prevDepth);
+        prevDepth = depth;
+        uint32_t id = (uint32_t)instances[i].worldMatrix._42;
+        unpaired += id >= 3000 || instances[i].color.x != (float)id || seen[id]++ != 0;
+        unpaired += batch.GetRenderOrder()[i] != id;
+      }
+      FrameArena::ResetAll();
+    }
+    CHECK(unsorted == 0 && unpaired == 0);
+
+    // OIT: entity order, capacity keeps the first planes
+    CHECK(batch.Write(world, XMMatrixIdentity(), false, 500, instances.data()) == 500);
+    uint32_t misplaced = 0;
+    for (uint32_t i = 0; i < 500; i++)
+      misplaced += instances[i].color.x != (float)i || instances[i].worldMatrix._42 != (float)i;
+    CHECK(misplaced == 0);
+
+    World empty;
+    CHECK(PlaneBatch::Count(empty, 10) == 0 && batch.Write(empty, XMMatrixIdentity(), true, 10, instances.data()) == 0);
+    FrameArena::ResetAll();
+    printf("order: 20 views of 3000 planes, %u out of order, %u unpaired\n", unsorted, unpaired);
+  }
+
+  // Batched stream uploads the same bytes in the same order as per plane one, with constant command count
+  void TestSubmission() {
+    TestRandom random(360);
+    World world;
+    RecordingContext perPlane, batched;
+    PlaneBatch batch;
+    XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(5.0f, 2.0f, -30.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    uint32_t planesCount = 0;
+    for (uint32_t added : { 1u, 9u, 90u, 900u }) {
+      CreatePlanes(world, random, added);
+      planesCount += added;
+
+      std::vector<PlaneInstance> instances(planesCount);
+      PlaneBatch reference;
+      reference.Write(world, view, true, planesCount, instances.data());
+      perPlane.Reset();
+      SubmitPerPlane(perPlane, instances);
+      batched.Reset();
+      SubmitBatched(batched, batch, world, view, true, 100000);
+      FrameArena::ResetAll();
+
+      CHECK(batched.commands.size() == 3 && batched.CountOf(RecordingContext::COMMAND_MAP) == 1);
+      CHECK(batched.commands.back().type == RecordingContext::COMMAND_DRAW && batched.commands.back().instances == planesCount);
+      CHECK(perPlane.CountOf(RecordingContext::COMMAND_DRAW) == planesCount);
+      CHECK(perPlane.data.size() == batched.data.size() && memcmp(perPlane.data.data(), batched.data.data(), batched.data.size()) == 0);
+    }
+
+    // Capacity limits upload and draw, nothing is recorded without planes
+    batched.Reset();
+    SubmitBatched(batched, batch, world, view, true, 64);
+    CHECK(batched.commands[0].bytes == 64 * sizeof(PlaneInstance) && batched.commands.back().instances == 64);
+    batched.Reset();
+    World empty;
+    SubmitBatched(batched, batch, empty, view, true, 64);
+    CHECK(batched.commands.empty());
+    FrameArena::ResetAll();
+  }
+
+  void BenchSubmission() {
+    for (uint32_t count : { 1000u, 10000u, 100000u }) {
+      TestRandom random(count);
+      World world;
+      CreatePlanes(world, random, count);
+      XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -50.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+      RecordingContext perPlane, batched;
+      PlaneBatch batch;
+      std::vector<PlaneInstance> instances(count);
+      const uint32_t FRAMES = 10;
+      double perPlaneMs = 0.0, batchedMs = 0.0;
+      for (uint32_t frame = 0; frame < FRAMES; frame++) {
+        TestClock::time_point start = TestClock::now();
+        perPlane.Reset();
+        batch.Write(world, view, true, count, instances.data());
+        SubmitPerPlane(perPlane, instances);
+        perPlaneMs += ElapsedMs(start);
+        FrameArena::ResetAll();
+
+        start = TestClock::now();
+        batched.Reset();
+        SubmitBatched(batched, batch, world, view, true, count);
+        batchedMs += ElapsedMs(start);
+        FrameArena::ResetAll();
+      }
+      printf("%6u planes: per plane %6zu commands %.2f ms, batched %zu commands %.2f ms per frame\n", count,
+        perPlane.commands.size(), perPlaneMs / FRAMES, batched.commands.size(), batchedMs / FRAMES);
+    }
+  }
+}
+
+int main() {
+  TestOrder();
+  TestSubmission();
+  BenchSubmission();
+  return TestResult();
+}
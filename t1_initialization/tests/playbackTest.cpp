@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "inputTrace.h"
+#include "cameraPath.h"
+#include "frameTimeLog.h"
+#include "testCommon.h"
+
+namespace {
+  // Frames benchmark path mode steps by, as Benchmark does
+  const float PATH_FRAME_TIME = 1.0f / 60.0f;
+
+  bool SameState(const InputState& a, const InputState& b) {
+    return a.mouseMove.x == b.mouseMove.x && a.mouseMove.y == b.mouseMove.y && a.mouseMove.z == b.mouseMove.z &&
+      memcmp(a.keys, b.keys, sizeof(a.keys)) == 0;
+  }
+
+  bool SameKey(const CameraPathKey& a, const CameraPathKey& b) {
+    return memcmp(&a, &b, sizeof(CameraPathKey)) == 0;
+  }
+
+  // Recorded input comes back frame by frame, broken traces are rejected
+  void TestInputTrace(TestRandom& random) {
+    const uint32_t framesCount = 600;
+    std::vector<InputState> live(framesCount);
+    InputRecorder recorder;
+    recorder.Begin();
+    for (uint32_t f = 0; f < framesCount; f++) {
+      InputState& state = live[f];
+      if (random.Next() % 3 == 0)
+        state.mouseMove = XMFLOAT3(random.Range(-10.0f, 10.0f), random.Range(-10.0f, 10.0f), random.Range(0.0f, 5.0f));
+      for (uint8_t k = 0; k < 4; k++)
+        state.SetKey(16 + k, (f / (10 + k * 7)) % 2 != 0);
+      recorder.Record(state, f * PATH_FRAME_TIME);
+    }
+    CHECK(recorder.GetFramesCount() == framesCount);
+
+    std::vector<uint8_t> data;
+    recorder.Serialize(data);
+    InputPlayer player;
+    CHECK(player.Parse(data.data(), data.size()));
+    CHECK(player.GetFramesCount() == framesCount);
+
+    uint32_t frame = 0, mismatches = 0;
+    InputState state;
+    while (player.Next(state)) {
+      mismatches += frame >= framesCount || !SameState(state, live[frame]);
+      frame++;
+    }
+    CHECK(frame == framesCount);
+    CHECK(mismatches == 0);
+
+    // Second pass after rewind is the same
+    player.Rewind();
+    frame = 0;
+    mismatches = 0;
+    while (player.Next(state))
+      mismatches += !SameState(state, live[frame++]);
+    CHECK(frame == framesCount && mismatches == 0);
+    printf("input trace: %u frames, %u events, %u bytes\n", framesCount, (uint32_t)recorder.GetEvents().size(), (uint32_t)data.size());
+
+    CHECK(!player.Parse(data.data(), data.size() - 3));
+    CHECK(!player.Parse(data.data(), sizeof(InputTraceHeader) - 1));
+    std::vector<uint8_t> broken(data);
+    broken[0] ^= 0xFF;
+    CHECK(!player.Parse(broken.data(), broken.size()));
+    // Event past trace end
+    broken = data;
+    InputEvent event;
+    memcpy(&event, broken.data() + sizeof(InputTraceHeader), sizeof(event));
+    event.frame = framesCount;
+    memcpy(broken.data() + sizeof(InputTraceHeader), &event, sizeof(event));
+    CHECK(!player.Parse(broken.data(), broken.size()));
+    CHECK(!player.Next(state));
+  }
+
+  // Path text round trip, bad text is reported by line, keys are hit exactly
+  void TestCameraPath() {
+    const char* text =
+      "# test path\n"
+      "key 0 0 0 0 2 120 15\n"
+      "key 2 0.5 0 0 3 200 30  # comment\n"
+      "\n"
+      "key 5 0 0.2 0 1.6 300 -10\n";
+    CameraPath path;
+    uint32_t errorLine = 0;
+    CHECK(path.ParseText(text, strlen(text), &errorLine));
+    CHECK(path.GetKeys().size() == 3);
+    CHECK(path.GetDuration() == 5.0f);
+
+    std::string written;
+    path.WriteText(written);
+    CameraPath parsed;
+    CHECK(parsed.ParseText(written.data(), written.size()));
+    CHECK(parsed.GetKeys().size() == path.GetKeys().size());
+    for (size_t k = 0; k < parsed.GetKeys().size() && k < path.GetKeys().size(); k++)
+      CHECK(SameKey(parsed.GetKeys()[k], path.GetKeys()[k]));
+
+    const char* sameTime = "key 0 0 0 0 2 120 15\nkey 0 1 1 1 1 1 1\n";
+    CHECK(!parsed.ParseText(sameTime, strlen(sameTime), &errorLine));
+    CHECK(errorLine == 2);
+    const char* shortKey = "key 0 0 0 0 2 120\n";
+    CHECK(!parsed.ParseText(shortKey, strlen(shortKey), &errorLine));
+    CHECK(errorLine == 1);
+
+    float keyError = 0.0f;
+    CameraPathKey pose;
+    for (const CameraPathKey& key : path.GetKeys()) {
+      CHECK(path.Evaluate(key.time, pose));
+      keyError = std::max({ keyError, fabsf(pose.phi - key.phi), fabsf(pose.theta - key.theta), fabsf(pose.distance - key.distance),
+        fabsf(pose.target.x - key.target.x), fabsf(pose.target.y - key.target.y), fabsf(pose.target.z - key.target.z) });
+    }
+    printf("camera path: error at keys %g\n", keyError);
+    CHECK(keyError < 1e-5f);
+
+    // Ends are clamped
+    CHECK(path.Evaluate(-1.0f, pose) && fabsf(pose.phi - path.GetKeys().front().phi) < 1e-5f);
+    CHECK(path.Evaluate(100.0f, pose) && fabsf(pose.phi - path.GetKeys().back().phi) < 1e-5f);
+
+    // Fixed frame steps give identical poses run to run, neighbour frames stay close
+    std::vector<CameraPathKey> first, second;
+    for (uint32_t run = 0; run < 2; run++) {
+      std::vector<CameraPathKey>& poses = run ? second : first;
+      for (uint32_t f = 0; f * PATH_FRAME_TIME <= path.GetDuration(); f++) {
+        path.Evaluate(f * PATH_FRAME_TIME, pose);
+        poses.push_back(pose);
+      }
+    }
+    CHECK(first.size() == second.size());
+    float maxStep = 0.0f;
+    for (size_t f = 0; f < first.size() && f < second.size(); f++) {
+      CHECK(SameKey(first[f], second[f]));
+      if (f > 0)
+        maxStep = std::max({ maxStep, fabsf(first[f].phi - first[f - 1].phi), fabsf(first[f].distance - first[f - 1].distance) });
+    }
+    printf("camera path: %u frames, max step per frame %g\n", (uint32_t)first.size(), maxStep);
+    CHECK(maxStep < 0.1f);
+
+    CameraPath empty;
+    CHECK(!empty.Evaluate(0.0f, pose));
+  }
+
+  void TestFrameTimeLog() {
+    FrameTimeLog log;
+    log.Init(100);
+    for (uint32_t i = 1; i <= 200; i++)
+      log.Add(i);
+    CHECK(log.GetCount() == 100);
+
+    FrameTimeStats stats = log.GetStats();
+    CHECK(stats.count == 100);
+    CHECK(stats.min == 1.0 && stats.max == 100.0);
+    CHECK(stats.mean == 50.5);
+    CHECK(stats.p50 == 50.0 && stats.p95 == 95.0 && stats.p99 == 99.0);
+
+    std::string csv;
+    log.WriteCSV(csv);
+    CHECK(csv.find("frame,ms\n0,1.0000\n") != std::string::npos);
+    CHECK(FrameTimeLog().GetStats().count == 0);
+  }
+}
+
+int main() {
+  TestRandom random(7);
+  TestInputTrace(random);
+  TestCameraPath();
+  TestFrameTimeLog();
+  return TestResult();
+}
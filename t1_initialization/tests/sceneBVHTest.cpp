@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "sceneBVH.h"
+#include "multiViewCuller.h"
+#include "testCommon.h"
+
+namespace {
+  const float NO_LIMIT = 1e30f;
+
+  struct Instances {
+    std::vector<XMFLOAT4> bbMin;
+    std::vector<XMFLOAT4> bbMax;
+  };
+
+  // Rotated boxes of different size, bounds are world AABBs as Box writes them
+  Instances MakeInstances(TestRandom& random, uint32_t count, float extent, float size) {
+    const XMFLOAT4 localMin(-0.5f, -0.5f, -0.5f, 1.0f);
+    const XMFLOAT4 localMax(0.5f, 0.5f, 0.5f, 1.0f);
+    Instances instances;
+    instances.bbMin.resize(count);
+    instances.bbMax.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+      float scale = random.Range(0.1f * size, size);
+      XMMATRIX world = XMMatrixScaling(scale, scale, scale) * XMMatrixRotationY(random.Range(0.0f, XM_2PI)) *
+        XMMatrixRotationZ(random.Range(0.0f, XM_2PI)) *
+        XMMatrixTranslation(random.Range(-extent, extent), random.Range(-extent, extent), random.Range(-extent, extent));
+      MultiViewCuller::TransformBounds(localMin, localMax, world, instances.bbMin[i], instances.bbMax[i]);
+    }
+    return instances;
+  }
+
+  QueryRay MakeRay(TestRandom& random, float extent) {
+    QueryRay ray;
+    ray.origin = XMFLOAT3(random.Range(-1.3f, 1.3f) * extent, random.Range(-1.3f, 1.3f) * extent, random.Range(-1.3f, 1.3f) * extent);
+    ray.direction = XMFLOAT3(random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f));
+    // Axis aligned directions and short rays take their own paths in slab tests
+    if (random.Next() % 10 == 0)
+      ray.direction.y = 0.0f;
+    ray.maxT = (random.Next() % 4 == 0) ? extent * 0.5f : NO_LIMIT;
+    return ray;
+  }
+
+  // Slab test in double precision, t is entry distance clamped to ray start
+  bool IntersectExact(const XMFLOAT4& bbMin, const XMFLOAT4& bbMax, const QueryRay& ray, float& t) {
+    const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+    const float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+    const float boxMin[3] = { bbMin.x, bbMin.y, bbMin.z };
+    const float boxMax[3] = { bbMax.x, bbMax.y, bbMax.z };
+    double tNear = 0.0, tFar = ray.maxT;
+    for (uint32_t a = 0; a < 3; a++) {
+      if (direction[a] == 0.0f) {
+        if (origin[a] < boxMin[a] || origin[a] > boxMax[a])
+          return false;
+        continue;
+      }
+      double t0 = (boxMin[a] - origin[a]) / (double)direction[a];
+      double t1 = (boxMax[a] - origin[a]) / (double)direction[a];
+      tNear = std::max(tNear, std::min(t0, t1));
+      tFar = std::min(tFar, std::max(t0, t1));
+    }
+    t = (float)tNear;
+    return tNear <= tFar;
+  }
+
+  bool SameHit(const QueryHit& hit, int32_t instance, float t) {
+    if ((hit.instance < 0) != (instance < 0))
+      return false;
+    // Ties between overlapping boxes may resolve to either, entry distance must match
+    return instance < 0 || fabsf(hit.t - t) <= 1e-4f * (1.0f + fabsf(t));
+  }
+
+  // Every query against brute force over all instances
+  void CheckQueries(const SceneBVH& bvh, const Instances& instances, TestRandom& random, float extent, uint32_t raysCount) {
+    uint32_t count = (uint32_t)instances.bbMin.size();
+    uint32_t mismatches = 0;
+    for (uint32_t q = 0; q < raysCount; q += 4) {
+      QueryRay rays[4];
+      QueryHit packetHits[4];
+      for (uint32_t l = 0; l < 4; l++)
+        rays[l] = MakeRay(random, extent);
+      bvh.Intersect4(rays, packetHits);
+      uint32_t occluded = bvh.Occluded4(rays);
+
+      for (uint32_t l = 0; l < 4; l++) {
+        int32_t nearest = -1;
+        float nearestT = rays[l].maxT, t;
+        for (uint32_t i = 0; i < count; i++)
+          if (IntersectExact(instances.bbMin[i], instances.bbMax[i], rays[l], t) && (nearest < 0 || t < nearestT)) {
+            nearest = (int32_t)i;
+            nearestT = t;
+          }
+
+        QueryHit hit;
+        bvh.Intersect(rays[l], hit);
+        mismatches += !SameHit(hit, nearest, nearestT);
+        mismatches += !SameHit(packetHits[l], nearest, nearestT);
+        mismatches += bvh.Occluded(rays[l]) != (nearest >= 0);
+        mismatches += (((occluded >> l) & 1) != 0) != (nearest >= 0);
+      }
+    }
+
+    std::vector<uint32_t> ids(count + 1);
+    std::vector<uint32_t> expected;
+    for (uint32_t q = 0; q < 200; q++) {
+      XMFLOAT3 center(random.Range(-extent, extent), random.Range(-extent, extent), random.Range(-extent, extent));
+      float radius = random.Range(0.0f, 0.3f * extent);
+
+      uint32_t found = bvh.OverlapSphere(center, radius, ids.data(), count);
+      std::sort(ids.begin(), ids.begin() + found);
+      expected.clear();
+      for (uint32_t i = 0; i < count; i++) {
+        float dx = std::max({ instances.bbMin[i].x - center.x, center.x - instances.bbMax[i].x, 0.0f });
+        float dy = std::max({ instances.bbMin[i].y - center.y, center.y - instances.bbMax[i].y, 0.0f });
+        float dz = std::max({ instances.bbMin[i].z - center.z, center.z - instances.bbMax[i].z, 0.0f });
+        if (dx * dx + dy * dy + dz * dz <= radius * radius)
+          expected.push_back(i);
+      }
+      mismatches += found != expected.size() || !std::equal(expected.begin(), expected.end(), ids.begin());
+
+      XMFLOAT3 boxMin(center.x - radius, center.y - 2.0f * radius, center.z - radius);
+      XMFLOAT3 boxMax(center.x + radius, center.y + radius, center.z + 3.0f * radius);
+      found = bvh.OverlapBox(boxMin, boxMax, ids.data(), count);
+      std::sort(ids.begin(), ids.begin() + found);
+      expected.clear();
+      for (uint32_t i = 0; i < count; i++)
+        if (instances.bbMin[i].x <= boxMax.x && boxMin.x <= instances.bbMax[i].x && instances.bbMin[i].y <= boxMax.y &&
+          boxMin.y <= instances.bbMax[i].y && instances.bbMin[i].z <= boxMax.z && boxMin.z <= instances.bbMax[i].z)
+          expected.push_back(i);
+      mismatches += found != expected.size() || !std::equal(expected.begin(), expected.end(), ids.begin());
+    }
+
+    // Ids beyond output size are dropped, count is what was written
+    if (count > 3) {
+      uint32_t few[2];
+      CHECK(bvh.OverlapSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), extent * 10.0f, few, 2) == 2);
+    }
+    CHECK(mismatches == 0);
+  }
+
+  void TestBuild(TestRandom& random) {
+    for (uint32_t count : { 0u, 1u, 2u, 3u, 15u, 100u, 10000u }) {
+      Instances instances = MakeInstances(random, count, 10.0f, count > 1000 ? 0.6f : 3.0f);
+      SceneBVH bvh;
+      bvh.Build(instances.bbMin.data(), instances.bbMax.data(), count);
+      CHECK(bvh.GetInstancesCount() == count);
+      CheckQueries(bvh, instances, random, 10.0f, count > 1000 ? 4000 : 20000);
+      printf("build: %u instances, %u nodes, cost %.2f\n", count, bvh.GetNodesCount(), bvh.GetBuildCost());
+    }
+
+    // All bounds the same, splits find no difference
+    Instances same;
+    same.bbMin.assign(500, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+    same.bbMax.assign(500, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+    SceneBVH bvh;
+    bvh.Build(same.bbMin.data(), same.bbMax.data(), 500);
+    CheckQueries(bvh, same, random, 2.0f, 2000);
+
+    // Ray through corner region of rotated box AABB, the box itself doesn't reach there
+    XMFLOAT4 bbMin, bbMax;
+    MultiViewCuller::TransformBounds(XMFLOAT4(-0.5f, -0.5f, -0.5f, 1.0f), XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f),
+      XMMatrixRotationY(XM_PIDIV4) * XMMatrixTranslation(0.0f, 0.0f, 5.0f), bbMin, bbMax);
+    bvh.Build(&bbMin, &bbMax, 1);
+    QueryRay ray = { XMFLOAT3(0.6f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), NO_LIMIT };
+    QueryHit hit;
+    CHECK(bvh.Intersect(ray, hit) && hit.instance == 0 && fabsf(hit.t - (5.0f - 0.5f * sqrtf(2.0f))) < 1e-4f);
+  }
+
+  // Moving instances: refitted tree answers like a fresh one, gets rebuilt when it degrades
+  void TestRefit(TestRandom& random) {
+    const uint32_t count = 2000;
+    Instances instances = MakeInstances(random, count, 10.0f, 1.0f);
+    SceneBVH bvh;
+    bvh.Build(instances.bbMin.data(), instances.bbMax.data(), count);
+    uint32_t rebuildsCount = 0;
+    for (uint32_t frame = 0; frame < 60; frame++) {
+      for (uint32_t i = 0; i < count; i++) {
+        XMFLOAT4 move(random.Range(-0.5f, 0.5f), random.Range(-0.5f, 0.5f), random.Range(-0.5f, 0.5f), 0.0f);
+        XMStoreFloat4(&instances.bbMin[i], XMVectorAdd(XMLoadFloat4(&instances.bbMin[i]), XMLoadFloat4(&move)));
+        XMStoreFloat4(&instances.bbMax[i], XMVectorAdd(XMLoadFloat4(&instances.bbMax[i]), XMLoadFloat4(&move)));
+      }
+      bvh.Refit(instances.bbMin.data(), instances.bbMax.data());
+      if (frame % 10 == 0)
+        CheckQueries(bvh, instances, random, 12.0f, 2000);
+      if (bvh.NeedsRebuild()) {
+        bvh.Build(instances.bbMin.data(), instances.bbMax.data(), count);
+        rebuildsCount++;
+      }
+    }
+    printf("refit: 60 frames of random motion, %u rebuilds\n", rebuildsCount);
+    CHECK(rebuildsCount > 0);
+
+    const uint32_t repeats = 100;
+    TestClock::time_point start = TestClock::now();
+    for (uint32_t r = 0; r < repeats; r++)
+      bvh.Refit(instances.bbMin.data(), instances.bbMax.data());
+    double refitMs = ElapsedMs(start) / repeats;
+    start = TestClock::now();
+    for (uint32_t r = 0; r < repeats; r++)
+      bvh.Build(instances.bbMin.data(), instances.bbMax.data(), count);
+    printf("%u instances: refit %.3f ms, build %.3f ms\n", count, refitMs, ElapsedMs(start) / repeats);
+  }
+
+  // Million rays per second, camera-like rays go in 2x2 pixel packets
+  void BenchRays(TestRandom& random, uint32_t count, float extent, float size, bool coherent) {
+    const uint32_t side = 512;
+    const uint32_t raysCount = side * side;
+    Instances instances = MakeInstances(random, count, extent, size);
+    SceneBVH bvh;
+    bvh.Build(instances.bbMin.data(), instances.bbMax.data(), count);
+
+    std::vector<QueryRay> rays(raysCount);
+    for (uint32_t i = 0; i < raysCount; i++) {
+      if (coherent) {
+        uint32_t tile = i / 4, lane = i % 4;
+        uint32_t x = (tile % (side / 2)) * 2 + (lane & 1);
+        uint32_t y = (tile / (side / 2)) * 2 + (lane >> 1);
+        rays[i].origin = XMFLOAT3(0.0f, 0.0f, -1.5f * extent);
+        rays[i].direction = XMFLOAT3((x - side * 0.5f) / (side * 0.5f) * 0.7f, (y - side * 0.5f) / (side * 0.5f) * 0.7f, 1.0f);
+      } else
+        rays[i] = MakeRay(random, extent);
+      rays[i].maxT = NO_LIMIT;
+    }
+
+    uint64_t hitsCount = 0;
+    auto megaRays = [&](TestClock::time_point start) { return raysCount / (ElapsedMs(start) * 1000.0); };
+
+    TestClock::time_point start = TestClock::now();
+    for (uint32_t i = 0; i < raysCount; i++) {
+      QueryHit hit;
+      hitsCount += bvh.Intersect(rays[i], hit);
+    }
+    double nearest = megaRays(start);
+
+    start = TestClock::now();
+    for (uint32_t i = 0; i < raysCount; i += 4) {
+      QueryHit hits[4];
+      bvh.Intersect4(&rays[i], hits);
+      hitsCount += hits[0].instance >= 0;
+    }
+    double nearestPacket = megaRays(start);
+
+    start = TestClock::now();
+    for (uint32_t i = 0; i < raysCount; i++)
+      hitsCount += bvh.Occluded(rays[i]);
+    double any = megaRays(start);
+
+    start = TestClock::now();
+    for (uint32_t i = 0; i < raysCount; i += 4)
+      hitsCount += bvh.Occluded4(&rays[i]) & 1;
+    double anyPacket = megaRays(start);
+
+    printf("%5u instances, %-9s rays: nearest %6.2f, packet %6.2f, any %6.2f, packet %6.2f Mrays/s (%llu hits)\n", count,
+      coherent ? "coherent" : "random", nearest, nearestPacket, any, anyPacket, (unsigned long long)hitsCount);
+  }
+}
+
+int main() {
+  TestRandom random(11);
+  TestBuild(random);
+  TestRefit(random);
+  BenchRays(random, 15, 4.0f, 1.0f, true);
+  BenchRays(random, 15, 4.0f, 1.0f, false);
+  BenchRays(random, 10000, 10.0f, 0.6f, true);
+  BenchRays(random, 10000, 10.0f, 0.6f, false);
+  return TestResult();
+}
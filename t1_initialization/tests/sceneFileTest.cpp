@@ -0,0 +1,375 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "sceneCompiler.h"
+#include "testCommon.h"
+
+// Scene description text compiles to binary file and back without changing a bit, bad lines are reported
+// by number and damaged binaries are rejected before anything reads out of them. Parse time is printed
+namespace {
+  const char* TEXT_PATH = "sceneTest.scene";
+  const char* BINARY_PATH = "sceneTest.scnb";
+
+  bool Parse(const std::string& text, SceneFileData& scene, uint32_t* errorLine = nullptr) {
+    return SceneCompiler::ParseText(text.data(), text.size(), scene, errorLine);
+  }
+
+  std::vector<uint8_t> Serialize(const SceneFileData& scene) {
+    std::vector<uint8_t> data;
+    SerializeSceneFile(scene, data);
+    return data;
+  }
+
+  bool SaveText(const char* path, const std::string& text) {
+    FILE* out = fopen(path, "wb");
+    if (!out)
+      return false;
+    bool ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+    return fclose(out) == 0 && ok;
+  }
+
+  std::vector<uint8_t> LoadBytes(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* in = fopen(path, "rb");
+    if (!in)
+      return data;
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+      data.insert(data.end(), buffer, buffer + count);
+    fclose(in);
+    return data;
+  }
+
+  std::wstring Wide(const char* text) {
+    return std::wstring(text, text + strlen(text));
+  }
+
+  // Any finite float, including denormals and negative zero, all 9 digits of them matter
+  float RandomFloat(TestRandom& random) {
+    switch (random.Next() % 8) {
+    case 0: return -0.0f;
+    case 1: return (random.Next() % 2 ? 1.0f : -1.0f) * std::ldexp(random.Range(1.0f, 2.0f), -140);
+    case 2: return (float)((int)(random.Next() % 2001) - 1000) / 100.0f;
+    default: {
+      uint32_t bits = random.Next();
+      float value;
+      if ((bits & 0x7F800000u) == 0x7F800000u)
+        bits &= ~0x00800000u;
+      memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+    }
+  }
+
+  XMFLOAT4 RandomFloat4(TestRandom& random, float w) {
+    return XMFLOAT4(RandomFloat(random), RandomFloat(random), RandomFloat(random), w);
+  }
+
+  std::string RandomName(TestRandom& random, const char* prefix, uint32_t index) {
+    std::string name = prefix + std::to_string(index);
+    for (uint32_t i = random.Next() % 12; i > 0; i--)
+      name.push_back("abz09_./\\-"[random.Next() % 10]);
+    return name;
+  }
+
+  // Strings are added in the order text parser adds them, so both give the same bytes
+  SceneFileData RandomScene(TestRandom& random, uint32_t boxesCount, uint32_t planesCount, uint32_t lightsCount, uint32_t camerasCount) {
+    SceneFileData scene;
+    uint32_t materialsCount = 1 + random.Next() % 4;
+    for (uint32_t i = 0; i < materialsCount; i++) {
+      SceneMaterial material = {};
+      material.name = scene.AddString(RandomName(random, "material", i));
+      material.shines = RandomFloat(random);
+      material.normalPath = scene.AddString(RandomName(random, "normal", i));
+      material.diffuseFirst = (uint32_t)scene.diffusePaths.size();
+      material.diffuseCount = 1 + random.Next() % 3;
+      for (uint32_t j = 0; j < material.diffuseCount; j++)
+        scene.diffusePaths.push_back(scene.AddString(RandomName(random, "diffuse", j)));
+      scene.materials.push_back(material);
+    }
+
+    for (uint32_t i = 0; i < boxesCount; i++) {
+      uint32_t material = random.Next() % materialsCount;
+      scene.boxPositions.push_back(RandomFloat4(random, 1.0f));
+      scene.boxMaterials.push_back(material);
+      scene.boxTextures.push_back(random.Next() % scene.materials[material].diffuseCount);
+      scene.boxSpins.push_back(RandomFloat(random));
+    }
+    for (uint32_t i = 0; i < planesCount; i++) {
+      scene.planeColors.push_back(RandomFloat4(random, random.Range(0.0f, 1.0f)));
+      scene.planePositions.push_back(RandomFloat4(random, 1.0f));
+      scene.planeMotions.push_back(RandomFloat4(random, random.Range(0.0f, 10.0f)));
+    }
+    for (uint32_t i = 0; i < lightsCount; i++) {
+      scene.lightPositions.push_back(RandomFloat4(random, 1.0f));
+      scene.lightColors.push_back(RandomFloat4(random, 1.0f));
+    }
+    // Angles go through degrees in text
+    for (uint32_t i = 0; i < camerasCount; i++) {
+      scene.cameraTargets.push_back(RandomFloat4(random, random.Range(0.1f, 500.0f)));
+      scene.cameraAngles.push_back(XMFLOAT4(random.Range(-XM_2PI, XM_2PI), random.Range(-XM_PIDIV2, XM_PIDIV2), 0.0f, 0.0f));
+    }
+    return scene;
+  }
+
+  // Reads everything view points to, strings to their terminators: out of bounds shows up in sanitizers
+  uint64_t TouchView(const SceneFileView& view) {
+    const SceneFileHeader& header = *view.header;
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < header.boxesCount; i++) {
+      const SceneMaterial& material = view.materials[view.boxMaterials[i]];
+      sum += view.diffusePaths[material.diffuseFirst + view.boxTextures[i]] + (uint64_t)view.boxPositions[i].x + (uint64_t)view.boxSpins[i];
+    }
+    for (uint32_t i = 0; i < header.planesCount; i++)
+      sum += (uint64_t)view.planeColors[i].w + (uint64_t)view.planePositions[i].x + (uint64_t)view.planeMotions[i].w;
+    for (uint32_t i = 0; i < header.lightsCount; i++)
+      sum += (uint64_t)view.lightPositions[i].x + (uint64_t)view.lightColors[i].x;
+    for (uint32_t i = 0; i < header.camerasCount; i++)
+      sum += (uint64_t)view.cameraTargets[i].w + (uint64_t)view.cameraAngles[i].x;
+    for (uint32_t i = 0; i < header.materialsCount; i++)
+      sum += strlen(view.GetString(view.materials[i].name)) + strlen(view.GetString(view.materials[i].normalPath));
+    for (uint32_t i = 0; i < header.diffuseCount; i++)
+      sum += strlen(view.GetString(view.diffusePaths[i]));
+    return sum;
+  }
+
+  void TestParseText() {
+    // Comments, blank lines, tabs and CRLF line ends
+    const std::string text =
+      "# test scene\r\n"
+      "material stone 32 n.dds d0.dds d1.dds   # two textures\r\n"
+      "\r\n"
+      "\tbox stone 1 -2.5 1 2 3\r\n"
+      "plane 1 0.5 0 0.25 4 5 6 0 0 -2 3\r\n"
+      "light 7 8 9 0.5 0.25 1\n"
+      "camera 0 1 0 5 90 -45";
+    SceneFileData scene;
+    CHECK(Parse(text, scene));
+    CHECK(scene.materials.size() == 1 && scene.diffusePaths.size() == 2 && scene.materials[0].shines == 32.0f);
+    CHECK(strcmp(scene.strings.c_str() + scene.materials[0].name, "stone") == 0 &&
+      strcmp(scene.strings.c_str() + scene.diffusePaths[1], "d1.dds") == 0);
+    CHECK(scene.boxPositions.size() == 1 && scene.boxTextures[0] == 1 && scene.boxSpins[0] == -2.5f &&
+      scene.boxPositions[0].z == 3.0f && scene.boxPositions[0].w == 1.0f);
+    CHECK(scene.planeColors.size() == 1 && scene.planeColors[0].w == 0.25f && scene.planePositions[0].y == 5.0f &&
+      scene.planePositions[0].w == 1.0f && scene.planeMotions[0].z == -2.0f && scene.planeMotions[0].w == 3.0f);
+    CHECK(scene.lightPositions.size() == 1 && scene.lightPositions[0].z == 9.0f && scene.lightColors[0].w == 1.0f);
+    CHECK(scene.cameraTargets.size() == 1 && scene.cameraTargets[0].w == 5.0f);
+    CHECK(std::fabs(scene.cameraAngles[0].x - XM_PIDIV2) < 1e-6f && std::fabs(scene.cameraAngles[0].y + XM_PIDIV4) < 1e-6f);
+
+    // Empty text is an empty scene, it still gives valid file
+    CHECK(Parse("", scene) && scene.materials.empty());
+    std::vector<uint8_t> data = Serialize(scene);
+    SceneFileView view;
+    CHECK(ParseSceneFile(data.data(), data.size(), view) == SCENE_PARSE_OK && view.header->boxesCount == 0);
+
+    // Bad line number is reported and nothing is kept
+    struct BadLine {
+      const char* line;
+    } badLines[] = {
+      { "unknown 1 2 3" },
+      { "box stone 0 0 1 2" },                    // too few values
+      { "box stone 0 0 1 2 3 4" },                // too many
+      { "box brick 0 0 1 2 3" },                  // undeclared material
+      { "box stone 2 0 1 2 3" },                  // texture out of material list
+      { "box stone -1 0 1 2 3" },
+      { "box stone 0 fast 1 2 3" },
+      { "box stone 0 0 1 2 3x" },
+      { "material stone 8 n.dds d.dds" },         // redeclared
+      { "material other 8 n.dds" },              // no diffuse texture
+      { "plane 1 1 1 0.5" },                      // colors only, format before plane motion
+      { "light 1 2 3 1 1" },
+      { "camera 0 0 0 5 90" },
+      { "camera 0 0 0 5 90 deg" },
+    };
+    uint32_t wrong = 0;
+    for (const BadLine& bad : badLines) {
+      uint32_t errorLine = 0;
+      std::string badText = "material stone 8 n.dds d0.dds d1.dds\n# comment\n\n" + std::string(bad.line) + "\nlight 1 2 3 1 1 1\n";
+      wrong += Parse(badText, scene, &errorLine) || errorLine != 4 || !scene.materials.empty() || !scene.strings.empty();
+    }
+    CHECK(wrong == 0);
+    printf("parse text: %zu bad lines reported at their numbers, %u wrong\n", sizeof(badLines) / sizeof(badLines[0]), wrong);
+  }
+
+  // Binary -> text -> binary gives the same bytes, text -> binary -> text the same text
+  void TestRoundTrip() {
+    TestRandom random(39);
+    uint32_t different = 0, textDifferent = 0, broken = 0;
+    for (uint32_t i = 0; i < 200; i++) {
+      SceneFileData scene = RandomScene(random, random.Next() % 40, random.Next() % 5, random.Next() % 8, random.Next() % 3);
+      std::vector<uint8_t> data = Serialize(scene);
+      SceneFileView view;
+      if (ParseSceneFile(data.data(), data.size(), view) != SCENE_PARSE_OK) {
+        broken++;
+        continue;
+      }
+
+      std::string text;
+      SceneCompiler::WriteText(view, text);
+      SceneFileData parsed;
+      uint32_t errorLine = 0;
+      if (!Parse(text, parsed, &errorLine)) {
+        printf("  text of scene %u doesn't parse at line %u\n", i, errorLine);
+        broken++;
+        continue;
+      }
+      std::vector<uint8_t> again = Serialize(parsed);
+      different += again != data;
+
+      SceneFileView againView;
+      std::string againText;
+      CHECK(ParseSceneFile(again.data(), again.size(), againView) == SCENE_PARSE_OK);
+      SceneCompiler::WriteText(againView, againText);
+      textDifferent += againText != text;
+    }
+    CHECK(broken == 0 && different == 0 && textDifferent == 0);
+
+    // Blocks start aligned, counts are in header
+    SceneFileData scene = RandomScene(random, 7, 3, 5, 2);
+    std::vector<uint8_t> data = Serialize(scene);
+    SceneFileView view;
+    CHECK(ParseSceneFile(data.data(), data.size(), view) == SCENE_PARSE_OK);
+    uint32_t misaligned = 0;
+    for (int i = 0; i < SCENE_BLOCKS_COUNT; i++)
+      misaligned += view.header->offsets[i] % SCENE_FILE_ALIGNMENT != 0;
+    CHECK(misaligned == 0 && view.header->boxesCount == 7 && view.header->planesCount == 3 && view.header->lightsCount == 5 &&
+      view.header->camerasCount == 2);
+    CHECK(memcmp(view.planeMotions, scene.planeMotions.data(), sizeof(XMFLOAT4) * 3) == 0 && view.boxTextures[6] == scene.boxTextures[6]);
+    printf("round trip: 200 random scenes, %u binaries differ, %u texts differ, %u broken\n", different, textDifferent, broken);
+  }
+
+  void TestDamagedFiles() {
+    TestRandom random(390);
+    SceneFileData scene = RandomScene(random, 10, 3, 4, 2);
+    const std::vector<uint8_t> data = Serialize(scene);
+    SceneFileView view;
+    CHECK(ParseSceneFile(data.data(), data.size(), view) == SCENE_PARSE_OK);
+    CHECK(ParseSceneFile(nullptr, 0, view) == SCENE_PARSE_TOO_SMALL && view.header == nullptr);
+
+    // Last block ends at file end, any cut loses some of it
+    uint32_t accepted = 0;
+    for (size_t size = 0; size < data.size(); size++)
+      accepted += ParseSceneFile(data.data(), size, view) == SCENE_PARSE_OK;
+    CHECK(accepted == 0);
+
+    struct Damage {
+      SCENE_PARSE_RESULT expected;
+      void (*apply)(std::vector<uint8_t>& data, SceneFileHeader& header);
+    } damages[] = {
+      { SCENE_PARSE_BAD_MAGIC, [](std::vector<uint8_t>&, SceneFileHeader& header) { header.magic ^= 1; } },
+      { SCENE_PARSE_UNSUPPORTED_VERSION, [](std::vector<uint8_t>&, SceneFileHeader& header) { header.version = 1; } },
+      { SCENE_PARSE_BAD_BLOCK, [](std::vector<uint8_t>&, SceneFileHeader& header) { header.offsets[SCENE_BLOCK_PLANE_MOTION] += 4; } },
+      { SCENE_PARSE_BAD_BLOCK, [](std::vector<uint8_t>&, SceneFileHeader& header) { header.offsets[SCENE_BLOCK_BOX_POSITION] = 0; } },
+      { SCENE_PARSE_BAD_BLOCK, [](std::vector<uint8_t>&, SceneFileHeader& header) { header.offsets[SCENE_BLOCK_MATERIAL] = 1ull << 40; } },
+      { SCENE_PARSE_BAD_BLOCK, [](std::vector<uint8_t>&, SceneFileHeader& header) { header.boxesCount = 0xFFFFFFFFu; } },
+      { SCENE_PARSE_BAD_BLOCK, [](std::vector<uint8_t>&, SceneFileHeader& header) { header.planesCount += 1000; } },
+      { SCENE_PARSE_BAD_BLOCK, [](std::vector<uint8_t>&, SceneFileHeader& header) { header.stringsSize += 1; } },
+      { SCENE_PARSE_BAD_STRING, [](std::vector<uint8_t>& data, SceneFileHeader& header) {
+        data[header.offsets[SCENE_BLOCK_STRINGS] + header.stringsSize - 1] = 'x'; } },
+      { SCENE_PARSE_BAD_STRING, [](std::vector<uint8_t>& data, SceneFileHeader& header) {
+        reinterpret_cast<uint32_t*>(data.data() + header.offsets[SCENE_BLOCK_DIFFUSE])[0] = header.stringsSize; } },
+      { SCENE_PARSE_BAD_STRING, [](std::vector<uint8_t>& data, SceneFileHeader& header) {
+        reinterpret_cast<SceneMaterial*>(data.data() + header.offsets[SCENE_BLOCK_MATERIAL])[0].normalPath = 0xFFFFFFFFu; } },
+      { SCENE_PARSE_BAD_REFERENCE, [](std::vector<uint8_t>& data, SceneFileHeader& header) {
+        reinterpret_cast<SceneMaterial*>(data.data() + header.offsets[SCENE_BLOCK_MATERIAL])[0].diffuseCount = 0; } },
+      { SCENE_PARSE_BAD_REFERENCE, [](std::vector<uint8_t>& data, SceneFileHeader& header) {
+        reinterpret_cast<SceneMaterial*>(data.data() + header.offsets[SCENE_BLOCK_MATERIAL])[0].diffuseFirst = 0xFFFFFFFFu; } },
+      { SCENE_PARSE_BAD_REFERENCE, [](std::vector<uint8_t>& data, SceneFileHeader& header) {
+        reinterpret_cast<uint32_t*>(data.data() + header.offsets[SCENE_BLOCK_BOX_MATERIAL])[9] = header.materialsCount; } },
+      { SCENE_PARSE_BAD_REFERENCE, [](std::vector<uint8_t>& data, SceneFileHeader& header) {
+        reinterpret_cast<uint32_t*>(data.data() + header.offsets[SCENE_BLOCK_BOX_TEXTURE])[0] = 3; } },
+    };
+    uint32_t wrong = 0;
+    for (const Damage& damage : damages) {
+      std::vector<uint8_t> damaged = data;
+      SceneFileHeader header;
+      memcpy(&header, damaged.data(), sizeof(header));
+      damage.apply(damaged, header);
+      memcpy(damaged.data(), &header, sizeof(header));
+      wrong += ParseSceneFile(damaged.data(), damaged.size(), view) != damage.expected || view.header != nullptr;
+    }
+    CHECK(wrong == 0);
+
+    // Random bytes changed: file is either rejected or everything it points to is inside it
+    uint32_t randomAccepted = 0;
+    uint64_t touched = 0;
+    for (uint32_t i = 0; i < 20000; i++) {
+      std::vector<uint8_t> damaged = data;
+      for (uint32_t j = 1 + random.Next() % 4; j > 0; j--) {
+        size_t at = i % 2 ? random.Next() % sizeof(SceneFileHeader) : random.Next() % damaged.size();
+        damaged[at] = (uint8_t)random.Next();
+      }
+      if (ParseSceneFile(damaged.data(), damaged.size(), view) == SCENE_PARSE_OK) {
+        randomAccepted++;
+        touched += TouchView(view);
+      }
+    }
+    printf("damaged files: %zu hand cases, 20000 random, %u accepted (checksum %llu)\n",
+      sizeof(damages) / sizeof(damages[0]), randomAccepted, (unsigned long long)touched);
+  }
+
+  void TestCompileFile() {
+    TestRandom random(3900);
+    SceneFileData scene = RandomScene(random, 15, 3, 30, 1);
+    std::vector<uint8_t> data = Serialize(scene);
+    SceneFileView view;
+    CHECK(ParseSceneFile(data.data(), data.size(), view) == SCENE_PARSE_OK);
+    std::string text;
+    SceneCompiler::WriteText(view, text);
+    CHECK(SaveText(TEXT_PATH, text));
+
+    CHECK(SceneCompiler::CompileFile(Wide(TEXT_PATH).c_str(), Wide(BINARY_PATH).c_str()) == S_OK);
+    CHECK(LoadBytes(BINARY_PATH) == data);
+
+    CHECK(SaveText(TEXT_PATH, text + "box nothing 0 0 0 0 0\n"));
+    CHECK(SceneCompiler::CompileFile(Wide(TEXT_PATH).c_str(), Wide(BINARY_PATH).c_str()) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+    remove(TEXT_PATH);
+    CHECK(SceneCompiler::CompileFile(Wide(TEXT_PATH).c_str(), Wide(BINARY_PATH).c_str()) == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+    remove(BINARY_PATH);
+  }
+
+  void BenchParse() {
+    TestRandom random(39000);
+    SceneFileData scene = RandomScene(random, 100000, 1000, 1000, 4);
+    std::vector<uint8_t> data = Serialize(scene);
+    SceneFileView view;
+    CHECK(ParseSceneFile(data.data(), data.size(), view) == SCENE_PARSE_OK);
+
+    TestClock::time_point start = TestClock::now();
+    std::string text;
+    SceneCompiler::WriteText(view, text);
+    double writeMs = ElapsedMs(start);
+
+    start = TestClock::now();
+    SceneFileData parsed;
+    CHECK(Parse(text, parsed));
+    double textMs = ElapsedMs(start);
+
+    start = TestClock::now();
+    std::vector<uint8_t> again;
+    SerializeSceneFile(parsed, again);
+    double serializeMs = ElapsedMs(start);
+    CHECK(again == data);
+
+    const uint32_t REPEATS = 20;
+    start = TestClock::now();
+    for (uint32_t i = 0; i < REPEATS; i++)
+      CHECK(ParseSceneFile(data.data(), data.size(), view) == SCENE_PARSE_OK);
+    double binaryMs = ElapsedMs(start) / REPEATS;
+    printf("100k boxes: text %.1f MB write %.1f ms, parse %.1f ms; binary %.1f MB serialize %.2f ms, validate %.3f ms\n",
+      text.size() / 1048576.0, writeMs, textMs, data.size() / 1048576.0, serializeMs, binaryMs);
+  }
+}
+
+int main() {
+  TestParseText();
+  TestRoundTrip();
+  TestDamagedFiles();
+  TestCompileFile();
+  BenchParse();
+  return TestResult();
+}
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "sceneGenerator.h"
+#include "threadPool.h"
+#include "testCommon.h"
+
+// Generated scenes depend on seed and preset only: PCG32 matches its reference, jumps match draws,
+// any range of boxes generates alone, file bytes are pinned by hash. Generation time of 1M boxes is printed
+namespace {
+  const char* GENERATED_PATH = "sceneGeneratorTest.scnb";
+
+  // FNV-1a, bytes of generated files are compared with values from another build
+  uint64_t Hash(const std::vector<uint8_t>& data) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (uint8_t byte : data)
+      hash = (hash ^ byte) * 0x100000001B3ull;
+    return hash;
+  }
+
+  std::vector<uint8_t> GenerateBytes(const SceneGenParams& params) {
+    SceneFileData scene;
+    SceneGenerator::Generate(params, scene);
+    std::vector<uint8_t> data;
+    SerializeSceneFile(scene, data);
+    return data;
+  }
+
+  std::vector<uint8_t> LoadBytes(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* in = fopen(path, "rb");
+    if (!in)
+      return data;
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+      data.insert(data.end(), buffer, buffer + count);
+    fclose(in);
+    return data;
+  }
+
+  std::wstring Wide(const char* text) {
+    return std::wstring(text, text + strlen(text));
+  }
+
+  void TestPcg() {
+    // Reference output of pcg32_srandom_r(42, 54) from pcg-c-basic
+    const uint32_t reference[] = { 0xA15C02B7u, 0x7B47F409u, 0xBA1D3330u, 0x83D2F293u, 0xBFA4784Bu, 0xCBED606Eu };
+    Pcg32 rng(42, 54);
+    uint32_t mismatches = 0;
+    for (uint32_t expected : reference)
+      mismatches += rng.Next() != expected;
+    CHECK(mismatches == 0);
+
+    // Jump over n draws lands where n draws do
+    uint32_t wrongJumps = 0;
+    for (uint64_t delta : { 0ull, 1ull, 2ull, 3ull, 7ull, 64ull, 1000ull, 12345ull }) {
+      Pcg32 stepped(7, 3), jumped(7, 3);
+      for (uint64_t i = 0; i < delta; i++)
+        stepped.Next();
+      jumped.Advance(delta);
+      for (uint32_t i = 0; i < 4; i++)
+        wrongJumps += stepped.Next() != jumped.Next();
+    }
+    // Period is 2^64: jumping around it comes back
+    Pcg32 start(9, 1), around(9, 1);
+    around.Advance(1ull << 63);
+    around.Advance(1ull << 63);
+    wrongJumps += start.Next() != around.Next();
+    CHECK(wrongJumps == 0);
+
+    // Bounded draws stay in range and cover it evenly
+    Pcg32 bounded(1, 2);
+    uint32_t histogram[10] = {}, outside = 0;
+    for (uint32_t i = 0; i < 100000; i++) {
+      uint32_t value = bounded.NextBounded(10);
+      if (value < 10)
+        histogram[value]++;
+      else
+        outside++;
+    }
+    uint32_t uneven = 0;
+    for (uint32_t count : histogram)
+      uneven += count < 9500 || count > 10500;
+    CHECK(outside == 0 && uneven == 0 && Pcg32(5, 5).NextBounded(1) == 0);
+  }
+
+  void TestPresets() {
+    uint32_t bad = 0;
+    for (uint32_t i = 0; i < SceneGenerator::GetPresetsCount(); i++) {
+      SceneGenParams params;
+      const char* name = SceneGenerator::GetPresetName(i);
+      bad += name == nullptr || !SceneGenerator::GetPreset(name, 17, params) || params.seed != 17 || params.boxesCount == 0 ||
+        params.texturesCount == 0 || params.size <= 0.0f;
+    }
+    SceneGenParams params;
+    CHECK(bad == 0 && SceneGenerator::GetPresetName(SceneGenerator::GetPresetsCount()) == nullptr);
+    CHECK(!SceneGenerator::GetPreset("uniform-2", 1, params));
+    CHECK(SceneGenerator::GetPreset("default", 1, params) && params.boxesCount == 15 && params.lightsCount == 30);
+  }
+
+  // Ranges of boxes and lights are the same as parts of whole scene, counts of other kinds don't move them
+  void TestIndependence() {
+    uint32_t differ = 0;
+    for (const char* preset : { "uniform-1k", "clustered-1k", "corridor-1k", "occluded-100k" }) {
+      SceneGenParams params;
+      CHECK(SceneGenerator::GetPreset(preset, 5, params));
+      params.boxesCount = (std::min)(params.boxesCount, 20000u);
+      SceneFileData scene;
+      SceneGenerator::Generate(params, scene);
+      CHECK(scene.boxPositions.size() == params.boxesCount && scene.lightPositions.size() == params.lightsCount);
+
+      std::vector<XMFLOAT4> positions(params.boxesCount);
+      std::vector<uint32_t> textures(params.boxesCount);
+      std::vector<float> spins(params.boxesCount);
+      const uint32_t first = params.boxesCount / 3, count = params.boxesCount / 5;
+      SceneGenerator::GenerateBoxes(params, first, count, positions.data(), textures.data(), spins.data());
+      differ += memcmp(&positions[first], &scene.boxPositions[first], sizeof(XMFLOAT4) * count) != 0;
+      differ += memcmp(&textures[first], &scene.boxTextures[first], sizeof(uint32_t) * count) != 0;
+      differ += memcmp(&spins[first], &scene.boxSpins[first], sizeof(float) * count) != 0;
+
+      std::vector<XMFLOAT4> lightPositions(params.lightsCount), lightColors(params.lightsCount);
+      SceneGenerator::GenerateLights(params, 7, 5, lightPositions.data(), lightColors.data());
+      differ += memcmp(&lightPositions[7], &scene.lightPositions[7], sizeof(XMFLOAT4) * 5) != 0;
+
+      SceneGenParams moreLights = params;
+      moreLights.lightsCount *= 2;
+      SceneFileData other;
+      SceneGenerator::Generate(moreLights, other);
+      differ += memcmp(other.boxPositions.data(), scene.boxPositions.data(), sizeof(XMFLOAT4) * params.boxesCount) != 0;
+      differ += memcmp(other.lightColors.data(), scene.lightColors.data(), sizeof(XMFLOAT4) * params.lightsCount) != 0;
+    }
+    CHECK(differ == 0);
+  }
+
+  // Boxes stay inside scene cube, textures index material list, lights are inside too
+  void TestLayouts() {
+    uint32_t outside = 0, badTexture = 0;
+    for (uint32_t i = 0; i < SceneGenerator::GetPresetsCount(); i++) {
+      SceneGenParams params;
+      CHECK(SceneGenerator::GetPreset(SceneGenerator::GetPresetName(i), 11, params));
+      params.boxesCount = (std::min)(params.boxesCount, 50000u);
+      SceneFileData scene;
+      SceneGenerator::Generate(params, scene);
+      float half = params.size * 0.5f;
+      for (uint32_t b = 0; b < params.boxesCount; b++) {
+        const XMFLOAT4& pos = scene.boxPositions[b];
+        outside += std::fabs(pos.x) > half || std::fabs(pos.y) > half || std::fabs(pos.z) > half || pos.w != 1.0f;
+        badTexture += scene.boxTextures[b] >= scene.materials[0].diffuseCount;
+      }
+      for (const XMFLOAT4& pos : scene.lightPositions)
+        outside += std::fabs(pos.x) > half || std::fabs(pos.y) > half || std::fabs(pos.z) > half;
+    }
+    CHECK(outside == 0 && badTexture == 0);
+
+    // Occluded preset puts first half of boxes into walls of equal z, 4 walls of 500 here
+    SceneGenParams params;
+    CHECK(SceneGenerator::GetPreset("occluded-100k", 11, params));
+    params.boxesCount = 4000;
+    SceneFileData scene;
+    SceneGenerator::Generate(params, scene);
+    uint32_t offWall = 0;
+    for (uint32_t b = 1; b < 500; b++)
+      offWall += scene.boxPositions[b].z != scene.boxPositions[0].z;
+    CHECK(offWall == 0 && scene.boxPositions[500].z > scene.boxPositions[0].z && scene.boxPositions[1999].z > scene.boxPositions[500].z);
+  }
+
+  // Same seed gives the same bytes with and without workers, whatever the platform: hashes are from another build
+  void TestDeterminism() {
+    struct Pinned {
+      const char* preset;
+      uint64_t seed;
+      uint64_t hash;
+    } pinned[] = {
+      { "default", 1, 0xA460536DBE074E33ull },
+      { "uniform-1k", 2, 0x90AD93D38C0F0012ull },
+      { "clustered-1k", 3, 0x08912D7364284622ull },
+      { "corridor-1k", 4, 0xEE70BB34145189DAull },
+    };
+    uint32_t wrongHashes = 0, notRepeated = 0;
+    for (const Pinned& entry : pinned) {
+      SceneGenParams params;
+      CHECK(SceneGenerator::GetPreset(entry.preset, entry.seed, params));
+      std::vector<uint8_t> data = GenerateBytes(params);
+      notRepeated += GenerateBytes(params) != data;
+      uint64_t hash = Hash(data);
+      if (hash != entry.hash) {
+        printf("  %s seed %llu: hash 0x%016llX\n", entry.preset, (unsigned long long)entry.seed, (unsigned long long)hash);
+        wrongHashes++;
+      }
+    }
+    CHECK(wrongHashes == 0 && notRepeated == 0);
+
+    // Many jobs: boxes are split between workers in BOXES_PER_JOB ranges
+    SceneGenParams params;
+    CHECK(SceneGenerator::GetPreset("clustered-100k", 8, params));
+    SceneFileData scene;
+    SceneGenerator::Generate(params, scene);
+    std::vector<XMFLOAT4> positions(params.boxesCount);
+    std::vector<uint32_t> textures(params.boxesCount);
+    std::vector<float> spins(params.boxesCount);
+    SceneGenerator::GenerateBoxes(params, 0, params.boxesCount, positions.data(), textures.data(), spins.data());
+    CHECK(memcmp(positions.data(), scene.boxPositions.data(), sizeof(XMFLOAT4) * params.boxesCount) == 0);
+
+    SceneGenParams otherSeed = params;
+    otherSeed.seed++;
+    SceneFileData other;
+    SceneGenerator::Generate(otherSeed, other);
+    CHECK(memcmp(other.boxPositions.data(), scene.boxPositions.data(), sizeof(XMFLOAT4) * params.boxesCount) != 0);
+
+    CHECK(SceneGenerator::GenerateFile(params, Wide(GENERATED_PATH).c_str()) == S_OK);
+    std::vector<uint8_t> data;
+    SerializeSceneFile(scene, data);
+    CHECK(LoadBytes(GENERATED_PATH) == data);
+    remove(GENERATED_PATH);
+  }
+
+  void BenchGenerate() {
+    for (const char* preset : { "uniform-1m", "clustered-1m", "corridor-1m" }) {
+      SceneGenParams params;
+      CHECK(SceneGenerator::GetPreset(preset, 1, params));
+      SceneFileData scene;
+      TestClock::time_point start = TestClock::now();
+      SceneGenerator::Generate(params, scene);
+      double generateMs = ElapsedMs(start);
+
+      start = TestClock::now();
+      std::vector<uint8_t> data;
+      SerializeSceneFile(scene, data);
+      double serializeMs = ElapsedMs(start);
+      printf("%s: generate %.1f ms, serialize %.1f ms, %.1f MB (%u workers)\n", preset, generateMs, serializeMs,
+        data.size() / 1048576.0, ThreadPool::GetInstance().GetWorkersCount());
+    }
+  }
+}
+
+int main() {
+  TestPcg();
+  TestPresets();
+  TestIndependence();
+  TestLayouts();
+  TestDeterminism();
+  BenchGenerate();
+  return TestResult();
+}
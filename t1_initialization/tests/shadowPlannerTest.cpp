@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "shadowPlanner.h"
+#include "testCommon.h"
+
+namespace {
+  const XMFLOAT3 SUN_DIRECTION(0.4f, -1.0f, 0.3f);
+
+  XMMATRIX ViewFor(const XMFLOAT3& position, float yaw, float pitch) {
+    XMVECTOR eye = XMLoadFloat3(&position);
+    XMVECTOR dir = XMVectorSet(cosf(pitch) * sinf(yaw), sinf(pitch), cosf(pitch) * cosf(yaw), 0.0f);
+    return XMMatrixLookAtLH(eye, XMVectorAdd(eye, dir), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+  }
+
+  // Every corner of view slice is inside cascade clip volume
+  void TestCoverage(TestRandom& random) {
+    float splits[SHADOW_CASCADES_COUNT + 1];
+    ShadowPlanner::ComputeSplits(0.01f, SHADOW_DISTANCE, SHADOW_SPLIT_LAMBDA, SHADOW_CASCADES_COUNT, splits);
+    const float tanHalfFov = tanf(XM_PIDIV4);
+    const float aspect = 16.0f / 9.0f;
+
+    float worst = 0.0f;
+    for (uint32_t t = 0; t < 200; t++) {
+      XMFLOAT3 position(random.Range(-5.0f, 5.0f), random.Range(-5.0f, 5.0f), random.Range(-5.0f, 5.0f));
+      XMMATRIX inverseView = XMMatrixInverse(nullptr, ViewFor(position, random.Range(-3.14f, 3.14f), random.Range(-1.5f, 1.5f)));
+      for (uint32_t c = 0; c < SHADOW_CASCADES_COUNT; c++) {
+        ShadowCascade cascade;
+        ShadowPlanner::FitCascade(inverseView, tanHalfFov, aspect, splits[c], splits[c + 1], SUN_DIRECTION, SHADOW_MAP_SIZE,
+          SHADOW_CASTER_DISTANCE, cascade);
+        for (uint32_t k = 0; k < 8; k++) {
+          float z = (k & 4) ? splits[c + 1] : splits[c];
+          XMVECTOR corner = XMVectorSet((k & 1 ? 1.0f : -1.0f) * z * tanHalfFov * aspect, (k & 2 ? 1.0f : -1.0f) * z * tanHalfFov, z, 1.0f);
+          XMFLOAT4 clip;
+          XMStoreFloat4(&clip, XMVector4Transform(XMVector4Transform(corner, inverseView), cascade.viewProjection));
+          worst = std::max({ worst, fabsf(clip.x), fabsf(clip.y), fabsf(clip.z - 0.5f) * 2.0f });
+        }
+      }
+    }
+    printf("coverage: worst slice corner |clip| %.4f\n", worst);
+    CHECK(worst <= 1.0f);
+  }
+
+  // Fixed world point keeps its sub-texel position while camera moves and turns
+  void TestStability() {
+    float splits[SHADOW_CASCADES_COUNT + 1];
+    ShadowPlanner::ComputeSplits(0.01f, SHADOW_DISTANCE, SHADOW_SPLIT_LAMBDA, SHADOW_CASCADES_COUNT, splits);
+    const XMVECTOR point = XMVectorSet(0.37f, 0.81f, -0.23f, 1.0f);
+
+    float firstFraction[SHADOW_CASCADES_COUNT][2] = {};
+    float firstRadius[SHADOW_CASCADES_COUNT] = {};
+    float maxDrift[SHADOW_CASCADES_COUNT] = {};
+    uint32_t radiusChanges[SHADOW_CASCADES_COUNT] = {};
+    for (uint32_t t = 0; t < 1000; t++) {
+      XMFLOAT3 position(0.0037f * t, 0.5f + 0.003f * t, -3.0f + 0.002f * t);
+      XMMATRIX inverseView = XMMatrixInverse(nullptr, ViewFor(position, 0.002f * t, 0.1f + 0.0005f * t));
+      for (uint32_t c = 0; c < SHADOW_CASCADES_COUNT; c++) {
+        ShadowCascade cascade;
+        ShadowPlanner::FitCascade(inverseView, 1.0f, 16.0f / 9.0f, splits[c], splits[c + 1], SUN_DIRECTION, SHADOW_MAP_SIZE,
+          SHADOW_CASTER_DISTANCE, cascade);
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector4Transform(point, cascade.viewProjection));
+        float texelX = (clip.x * 0.5f + 0.5f) * SHADOW_MAP_SIZE;
+        float texelY = (clip.y * 0.5f + 0.5f) * SHADOW_MAP_SIZE;
+        float fraction[2] = { texelX - floorf(texelX), texelY - floorf(texelY) };
+        if (t == 0) {
+          firstFraction[c][0] = fraction[0];
+          firstFraction[c][1] = fraction[1];
+          firstRadius[c] = cascade.radius;
+        }
+        for (uint32_t a = 0; a < 2; a++) {
+          float drift = fabsf(fraction[a] - firstFraction[c][a]);
+          maxDrift[c] = std::max(maxDrift[c], std::min(drift, 1.0f - drift));
+        }
+        radiusChanges[c] += cascade.radius != firstRadius[c];
+      }
+    }
+    for (uint32_t c = 0; c < SHADOW_CASCADES_COUNT; c++) {
+      printf("stability: cascade %u sub-texel drift %.4f texel, radius changes %u\n", c, maxDrift[c], radiusChanges[c]);
+      CHECK(maxDrift[c] < 0.02f);
+      CHECK(radiusChanges[c] == 0);
+    }
+  }
+
+  // Ranking matches brute force importance order, previous lights are kept within hysteresis
+  void TestRanking(TestRandom& random) {
+    const uint32_t lightsCount = 30;
+    XMFLOAT4 positions[lightsCount];
+    XMFLOAT4 colors[lightsCount];
+    for (uint32_t i = 0; i < lightsCount; i++) {
+      positions[i] = XMFLOAT4(random.Range(-4.0f, 4.0f), random.Range(-4.0f, 4.0f), random.Range(-4.0f, 4.0f), 1.0f);
+      colors[i] = XMFLOAT4(random.Range(0.5f, 1.0f), random.Range(0.5f, 1.0f), random.Range(0.5f, 1.0f), 1.0f);
+    }
+    XMFLOAT3 cameraPos(0.0f, 0.0f, -6.0f);
+    CullView view = CullView::FromViewProjection(ViewFor(cameraPos, 0.0f, 0.0f) * XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.5f, 100.0f, 0.01f));
+
+    std::vector<std::pair<float, int32_t>> expected;
+    for (uint32_t i = 0; i < lightsCount; i++) {
+      float range = ShadowPlanner::LightRange(colors[i]);
+      bool visible = true;
+      for (uint32_t p = 0; p < 6; p++) {
+        const XMFLOAT4& plane = view.planes[p];
+        visible &= plane.x * positions[i].x + plane.y * positions[i].y + plane.z * positions[i].z + plane.w >= -range;
+      }
+      if (!visible)
+        continue;
+      float dx = positions[i].x - cameraPos.x, dy = positions[i].y - cameraPos.y, dz = positions[i].z - cameraPos.z;
+      expected.push_back({ range * range * SHADOW_LIGHT_THRESHOLD / std::max(dx * dx + dy * dy + dz * dz, 1.0f), (int32_t)i });
+    }
+    std::sort(expected.rbegin(), expected.rend());
+
+    int32_t selected[SHADOW_MAX_POINT_LIGHTS];
+    float importance[SHADOW_MAX_POINT_LIGHTS];
+    uint32_t count = ShadowPlanner::RankLights(positions, colors, lightsCount, cameraPos, view, nullptr, 0,
+      SHADOW_MAX_POINT_LIGHTS, selected, importance);
+    CHECK(count == std::min<size_t>(SHADOW_MAX_POINT_LIGHTS, expected.size()));
+    for (uint32_t j = 0; j < count && j < expected.size(); j++)
+      CHECK(selected[j] == expected[j].second);
+    printf("ranking: %u of %u lights selected\n", count, lightsCount);
+
+    if (expected.size() > SHADOW_MAX_POINT_LIGHTS) {
+      const std::pair<float, int32_t>& next = expected[SHADOW_MAX_POINT_LIGHTS];
+      const std::pair<float, int32_t>& last = expected[SHADOW_MAX_POINT_LIGHTS - 1];
+      int32_t previous[1] = { next.second };
+      count = ShadowPlanner::RankLights(positions, colors, lightsCount, cameraPos, view, previous, 1,
+        SHADOW_MAX_POINT_LIGHTS, selected, importance);
+      bool kept = std::find(selected, selected + count, next.second) != selected + count;
+      CHECK(kept == (next.first * SHADOW_RANK_HYSTERESIS > last.first));
+    }
+  }
+
+  // Planner over camera path: culling views match brute force, refreshed maps stay in budget
+  void TestPlanner(TestRandom& random) {
+    const uint32_t lightsCount = 30;
+    const uint32_t boxesCount = 15;
+    const uint32_t framesCount = 600;
+    XMFLOAT4 positions[lightsCount];
+    XMFLOAT4 colors[lightsCount];
+    for (uint32_t i = 0; i < lightsCount; i++) {
+      positions[i] = XMFLOAT4(random.Range(-4.0f, 4.0f), random.Range(-4.0f, 4.0f), random.Range(-4.0f, 4.0f), 1.0f);
+      colors[i] = XMFLOAT4(random.Range(0.5f, 1.0f), 0.6f, 0.7f, 1.0f);
+    }
+
+    ShadowPlanner planner;
+    MultiViewCuller culler;
+    CameraState camera;
+    XMFLOAT4 bbMin[boxesCount];
+    XMFLOAT4 bbMax[boxesCount];
+    uint32_t masks[boxesCount];
+    uint32_t ids[boxesCount * SHADOW_VIEWS_COUNT];
+    uint32_t offsets[SHADOW_VIEWS_COUNT + 1];
+    uint32_t casterCounts[SHADOW_VIEWS_COUNT];
+
+    uint32_t cullMismatches = 0, maxRendered = 0, totalRendered = 0;
+    double planMs = 0.0;
+    for (uint32_t t = 0; t < framesCount; t++) {
+      for (uint32_t b = 0; b < boxesCount; b++) {
+        float a = 0.01f * t + b;
+        XMFLOAT3 center(3.0f * cosf(a + b), 0.5f * sinf(0.7f * b), 3.0f * sinf(a * 0.5f + b));
+        bbMin[b] = XMFLOAT4(center.x - 0.5f, center.y - 0.5f, center.z - 0.5f, 1.0f);
+        bbMax[b] = XMFLOAT4(center.x + 0.5f, center.y + 0.5f, center.z + 0.5f, 1.0f);
+      }
+      float angle = 0.01f * t;
+      XMFLOAT3 cameraPos(8.0f * sinf(angle), 1.5f, -8.0f * cosf(angle));
+      camera.SetView(ViewFor(cameraPos, -angle, -0.15f), cameraPos);
+      camera.SetPerspective(XM_PIDIV2, 16.0f / 9.0f, 100.0f, 0.01f);
+
+      TestClock::time_point start = TestClock::now();
+      planner.Plan(camera, SUN_DIRECTION, positions, colors, lightsCount);
+      planMs += ElapsedMs(start);
+
+      culler.SetViews(planner.GetViews(), SHADOW_VIEWS_COUNT);
+      culler.Cull(bbMin, bbMax, boxesCount, masks);
+      MultiViewCuller::BuildLists(masks, boxesCount, SHADOW_VIEWS_COUNT, ids, offsets);
+      for (uint32_t v = 0; v < SHADOW_VIEWS_COUNT; v++)
+        casterCounts[v] = offsets[v + 1] - offsets[v];
+
+      start = TestClock::now();
+      planner.Schedule(casterCounts);
+      planMs += ElapsedMs(start);
+
+      // Brute force p-vertex test per view
+      for (uint32_t v = 0; v < SHADOW_VIEWS_COUNT; v++) {
+        for (uint32_t b = 0; b < boxesCount; b++) {
+          bool inside = true;
+          for (uint32_t p = 0; p < 6; p++) {
+            const XMFLOAT4& plane = planner.GetViews()[v].planes[p];
+            inside &= plane.x * (plane.x >= 0.0f ? bbMax[b].x : bbMin[b].x) + plane.y * (plane.y >= 0.0f ? bbMax[b].y : bbMin[b].y) +
+              plane.z * (plane.z >= 0.0f ? bbMax[b].z : bbMin[b].z) + plane.w >= 0.0f;
+          }
+          cullMismatches += inside != (((masks[b] >> v) & 1) != 0);
+        }
+      }
+
+      uint32_t rendered = planner.GetRenderedCount();
+      if (t > 0)
+        maxRendered = std::max(maxRendered, rendered);
+      totalRendered += rendered;
+    }
+    printf("planner: %u frames, max maps per frame after first %u (budget %u faces + %u cascades), mean %.2f\n",
+      framesCount, maxRendered, SHADOW_FACE_BUDGET, SHADOW_CASCADES_COUNT, (double)totalRendered / framesCount);
+    printf("planner: plan + schedule %.4f ms per frame\n", planMs / framesCount);
+    CHECK(cullMismatches == 0);
+    CHECK(maxRendered <= SHADOW_FACE_BUDGET + SHADOW_CASCADES_COUNT + 6 * SHADOW_MAX_POINT_LIGHTS);
+  }
+
+  void BenchRanking(TestRandom& random) {
+    const uint32_t lightsCount = 10000;
+    const uint32_t repeats = 100;
+    std::vector<XMFLOAT4> positions(lightsCount), colors(lightsCount);
+    for (uint32_t i = 0; i < lightsCount; i++) {
+      positions[i] = XMFLOAT4(random.Range(-50.0f, 50.0f), random.Range(-50.0f, 50.0f), random.Range(-50.0f, 50.0f), 1.0f);
+      colors[i] = XMFLOAT4(random.Range(0.0f, 1.0f), random.Range(0.0f, 1.0f), random.Range(0.0f, 1.0f), 1.0f);
+    }
+    XMFLOAT3 cameraPos(0.0f, 0.0f, 0.0f);
+    CullView view = CullView::FromViewProjection(ViewFor(cameraPos, 0.0f, 0.0f) * XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.5f, 100.0f, 0.01f));
+    int32_t selected[SHADOW_MAX_POINT_LIGHTS];
+    float importance[SHADOW_MAX_POINT_LIGHTS];
+
+    TestClock::time_point start = TestClock::now();
+    uint32_t count = 0;
+    for (uint32_t r = 0; r < repeats; r++)
+      count += ShadowPlanner::RankLights(positions.data(), colors.data(), lightsCount, cameraPos, view, nullptr, 0,
+        SHADOW_MAX_POINT_LIGHTS, selected, importance);
+    printf("rank %u lights: %.4f ms\n", lightsCount, ElapsedMs(start) / repeats);
+    CHECK(count == repeats * SHADOW_MAX_POINT_LIGHTS);
+  }
+}
+
+int main() {
+  TestRandom random(7);
+  TestCoverage(random);
+  TestStability();
+  TestRanking(random);
+  TestPlanner(random);
+  BenchRanking(random);
+  return TestResult();
+}
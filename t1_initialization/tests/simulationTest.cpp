@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "simulation.h"
+#include "testCommon.h"
+
+namespace {
+  const uint32_t BOXES_COUNT = 15;
+  const uint32_t PLANES_COUNT = 3;
+
+  void FillWorld(World& world, uint32_t boxesCount, uint32_t planesCount) {
+    for (uint32_t i = 0; i < boxesCount; i++) {
+      Entity entity = world.Create<PositionComponent, SpinComponent, MaterialComponent, TransformComponent, BoundsComponent>();
+      world.Get<PositionComponent>(entity)->position = XMFLOAT4((float)i, 0.5f * i, -1.0f * i, 1.0f);
+      world.Get<SpinComponent>(entity)->speed = 0.3f + 0.1f * i;
+    }
+    for (uint32_t i = 0; i < planesCount; i++) {
+      Entity entity = world.Create<PositionComponent, OscillationComponent, TransformComponent, ColorComponent>();
+      world.Get<PositionComponent>(entity)->position = XMFLOAT4((float)i, 1.0f, 2.0f, 1.0f);
+      *world.Get<OscillationComponent>(entity) = { XMFLOAT4(0.0f, 0.5f, 0.25f, 0.0f), 2.0f };
+    }
+    for (uint32_t i = 0; i < 30; i++)
+      world.Create<PositionComponent, LightComponent>();
+  }
+
+  // Closed form motion boxes had before simulation got its own steps
+  XMMATRIX BoxMotion(const XMFLOAT4& position, float speed, double time) {
+    float wobble = (float)(sin(time * speed * 0.30) * 0.25f);
+    return XMMatrixRotationY((float)time * speed * 0.5f) * XMMatrixRotationZ(wobble) *
+      XMMatrixTranslation(0.0f, wobble, 0.0f) * XMMatrixTranslation(position.x, position.y, position.z);
+  }
+
+  float MaxDifference(const XMFLOAT4X4& a, const XMMATRIX& b) {
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, b);
+    float difference = 0.0f;
+    for (uint32_t i = 0; i < 4; i++)
+      for (uint32_t j = 0; j < 4; j++)
+        difference = std::max(difference, fabsf(a.m[i][j] - m.m[i][j]));
+    return difference;
+  }
+
+  // Step poses match closed form motion at step time
+  void TestPoses() {
+    World world;
+    FillWorld(world, BOXES_COUNT, PLANES_COUNT);
+    Simulation simulation;
+    simulation.SetReplay(true);
+    simulation.Init(world);
+    simulation.Step(123);
+    simulation.Interpolate(world, simulation.TakeSnapshot(1.0f));
+
+    double time = 123.0 / SIM_STEP_RATE;
+    float error = 0.0f;
+    world.ForEachChunk<PositionComponent, SpinComponent, TransformComponent>(
+      [&](uint32_t count, const Entity*, PositionComponent* positions, SpinComponent* spins, TransformComponent* transforms) {
+        for (uint32_t i = 0; i < count; i++)
+          error = std::max(error, MaxDifference(transforms[i].world, BoxMotion(positions[i].position, spins[i].speed, time)));
+      });
+    world.ForEachChunk<PositionComponent, OscillationComponent, TransformComponent>(
+      [&](uint32_t count, const Entity*, PositionComponent* positions, OscillationComponent* oscillations, TransformComponent* transforms) {
+        for (uint32_t i = 0; i < count; i++) {
+          XMVECTOR position = XMVectorMultiplyAdd(XMLoadFloat4(&oscillations[i].amplitude),
+            XMVectorReplicate((float)sin(time * oscillations[i].frequency)), XMLoadFloat4(&positions[i].position));
+          error = std::max(error, MaxDifference(transforms[i].world, XMMatrixTranslationFromVector(position)));
+        }
+      });
+    printf("poses: max error vs closed form motion %g\n", error);
+    CHECK(error < 1e-4f);
+  }
+
+  // Replay runs give the same state every frame
+  void TestReplay() {
+    const uint32_t framesCount = 600;
+    std::vector<uint64_t> hashes(framesCount);
+    for (uint32_t run = 0; run < 2; run++) {
+      World world;
+      FillWorld(world, BOXES_COUNT, PLANES_COUNT);
+      Simulation simulation;
+      simulation.SetReplay(true);
+      simulation.Init(world);
+      for (uint32_t f = 0; f < framesCount; f++) {
+        simulation.Frame(world);
+        CHECK(simulation.GetStep() == f + 1);
+        if (run == 0)
+          hashes[f] = simulation.GetStateHash();
+        else
+          CHECK(hashes[f] == simulation.GetStateHash());
+      }
+    }
+    printf("replay: %u frames, runs are equal\n", framesCount);
+  }
+
+  // Render loop runs uncapped, simulation keeps its rate, interpolated motion stays smooth
+  void TestThreaded() {
+    World world;
+    FillWorld(world, BOXES_COUNT, PLANES_COUNT);
+    Simulation simulation;
+    simulation.Init(world);
+    simulation.Start();
+
+    std::vector<float> lastHeights;
+    float maxJump = 0.0f;
+    uint64_t framesCount = 0, lastStep = 0;
+    uint32_t badSnapshots = 0;
+    TestClock::time_point start = TestClock::now();
+    while (ElapsedMs(start) < 1500.0) {
+      // Odd frames take snapshot themselves: states and alpha come together, steps never go back
+      if (framesCount % 2) {
+        SimSnapshot snapshot = simulation.TakeSnapshot();
+        badSnapshots += snapshot.step < lastStep || snapshot.alpha < 0.0f || snapshot.alpha > 1.0f ||
+          (snapshot.step > 0 && snapshot.previous == snapshot.latest);
+        lastStep = snapshot.step;
+        simulation.Interpolate(world, snapshot);
+      } else
+        simulation.Frame(world);
+      uint32_t k = 0;
+      world.ForEachChunk<PositionComponent, OscillationComponent, TransformComponent>(
+        [&](uint32_t count, const Entity*, PositionComponent*, OscillationComponent*, TransformComponent* transforms) {
+          for (uint32_t i = 0; i < count; i++, k++) {
+            if (k < lastHeights.size())
+              maxJump = std::max(maxJump, fabsf(transforms[i].world._42 - lastHeights[k]));
+            else
+              lastHeights.push_back(0.0f);
+            lastHeights[k] = transforms[i].world._42;
+          }
+        });
+      framesCount++;
+
+      // Render thread work
+      volatile double work = 0.0;
+      for (uint32_t i = 0; i < 20000; i++)
+        work = work + i * 0.5;
+    }
+    double seconds = ElapsedMs(start) / 1000.0;
+    uint64_t steps = simulation.GetStep();
+    simulation.Stop();
+
+    printf("threaded: %.2f s, %llu render frames, %llu steps (%.1f per second), max plane move per frame %.4f\n", seconds,
+      (unsigned long long)framesCount, (unsigned long long)steps, steps / seconds, maxJump);
+    CHECK(steps / seconds > SIM_STEP_RATE * 0.8 && steps / seconds < SIM_STEP_RATE * 1.2);
+    CHECK(framesCount > steps && badSnapshots == 0);
+    // One step moves plane at most amplitude * frequency / rate
+    CHECK(maxJump < 0.5f * 2.0f / SIM_STEP_RATE * 1.2f);
+
+    // Threaded state is the one replay gets at the same step
+    World replayWorld;
+    FillWorld(replayWorld, BOXES_COUNT, PLANES_COUNT);
+    Simulation replay;
+    replay.SetReplay(true);
+    replay.Init(replayWorld);
+    replay.Step((uint32_t)steps);
+    CHECK(replay.GetStateHash() == simulation.GetStateHash());
+  }
+
+  // Stopped simulation drops time it was stopped for instead of catching up
+  void TestRestart() {
+    World world;
+    FillWorld(world, BOXES_COUNT, PLANES_COUNT);
+    Simulation simulation;
+    simulation.Init(world);
+    simulation.Start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    simulation.Stop();
+    uint64_t stepBefore = simulation.GetStep();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    simulation.Start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    simulation.Stop();
+    uint64_t stepAfter = simulation.GetStep();
+    printf("restart: steps %llu -> %llu\n", (unsigned long long)stepBefore, (unsigned long long)stepAfter);
+    CHECK(stepAfter - stepBefore < 12);
+  }
+
+  void BenchStep() {
+    const uint32_t entitiesCount = 100000;
+    const uint32_t repeats = 10;
+    World world;
+    FillWorld(world, entitiesCount, entitiesCount);
+    std::vector<SimPose> poses(2 * entitiesCount);
+
+    TestClock::time_point start = TestClock::now();
+    for (uint32_t i = 0; i < repeats; i++)
+      Simulation::ComputeStep(world, i, poses.data());
+    double stepMs = ElapsedMs(start) / repeats;
+
+    Simulation simulation;
+    simulation.SetReplay(true);
+    simulation.Init(world);
+    start = TestClock::now();
+    for (uint32_t i = 0; i < repeats; i++)
+      simulation.Interpolate(world, simulation.TakeSnapshot(0.5f));
+    double interpolateMs = ElapsedMs(start) / repeats;
+    printf("%u moving entities: step %.2f ms, interpolate %.2f ms\n", 2 * entitiesCount, stepMs, interpolateMs);
+  }
+}
+
+int main() {
+  TestPoses();
+  TestReplay();
+  TestThreaded();
+  TestRestart();
+  BenchStep();
+  return TestResult();
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mipGenerator.h"
+#include "sliceLoader.h"
+#include "threadPool.h"
+#include "testCommon.h"
+
+// Texture array slices: per-slice status, archive and loose files, parallel loading gives
+// the same slices as serial one. Files are written to working directory with sliceTest prefix
+namespace {
+  const wchar_t* ARCHIVE_PATH = L"sliceTest.pak";
+
+  struct SliceFile {
+    std::wstring name;
+    std::vector<uint8_t> data;
+  };
+
+  std::wstring SliceName(const char* kind, uint32_t index) {
+    char name[64];
+    snprintf(name, sizeof(name), "sliceTest_%s_%u.dds", kind, index);
+    return std::wstring(name, name + strlen(name));
+  }
+
+  std::string Narrow(const std::wstring& text) {
+    return std::string(text.begin(), text.end());
+  }
+
+  // 2D texture with DX10 header, payload holds mipCount levels of random texels
+  std::vector<uint8_t> BuildDDS(uint32_t width, uint32_t height, uint32_t mipCount, DXGI_FORMAT format, TestRandom& random) {
+    DDS_HEADER header = {};
+    header.size = sizeof(DDS_HEADER);
+    header.flags = DDS_WIDTH | DDS_HEIGHT;
+    header.width = width;
+    header.height = height;
+    header.mipMapCount = mipCount;
+    header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+    header.ddspf.flags = DDS_FOURCC;
+    header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+    DDS_HEADER_DXT10 header10 = {};
+    header10.dxgiFormat = format;
+    header10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+    header10.arraySize = 1;
+
+    size_t payload = 0;
+    for (uint32_t mip = 0; mip < mipCount; mip++) {
+      size_t numBytes = 0;
+      DDSGetSurfaceInfo((std::max)(width >> mip, 1u), (std::max)(height >> mip, 1u), format, &numBytes, nullptr, nullptr);
+      payload += numBytes;
+    }
+
+    size_t headersSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+    std::vector<uint8_t> data(headersSize + payload);
+    memcpy(data.data(), &DDS_MAGIC, sizeof(uint32_t));
+    memcpy(data.data() + sizeof(uint32_t), &header, sizeof(header));
+    memcpy(data.data() + sizeof(uint32_t) + sizeof(header), &header10, sizeof(header10));
+    for (size_t i = headersSize; i < data.size(); i++)
+      data[i] = (uint8_t)(random.Next() >> 24);
+    return data;
+  }
+
+  bool SaveFile(const SliceFile& file) {
+    FILE* out = fopen(Narrow(file.name).c_str(), "wb");
+    if (!out)
+      return false;
+    bool ok = fwrite(file.data.data(), 1, file.data.size(), out) == file.data.size();
+    return fclose(out) == 0 && ok;
+  }
+
+  std::vector<const wchar_t*> Names(const std::vector<SliceFile>& files) {
+    std::vector<const wchar_t*> names;
+    for (auto& file : files)
+      names.push_back(file.name.c_str());
+    return names;
+  }
+
+  void RemoveFiles(const std::vector<SliceFile>& files) {
+    for (auto& file : files)
+      remove(Narrow(file.name).c_str());
+  }
+
+  bool SameSlices(const TextureSlice& a, const TextureSlice& b) {
+    if (a.mips.size() != b.mips.size())
+      return false;
+    for (size_t mip = 0; mip < a.mips.size(); mip++) {
+      const SliceMip& x = a.mips[mip];
+      const SliceMip& y = b.mips[mip];
+      if (x.rowPitch != y.rowPitch || x.slicePitch != y.slicePitch || memcmp(x.data, y.data, x.slicePitch) != 0)
+        return false;
+    }
+    return true;
+  }
+
+  // Each file gets its own status, broken ones don't stop the rest
+  void TestSliceResults() {
+    TestRandom random(30);
+    std::vector<SliceFile> files = {
+      { SliceName("plain", 0), BuildDDS(64, 64, 1, DXGI_FORMAT_R8G8B8A8_UNORM, random) },
+      { SliceName("mips", 0), BuildDDS(64, 32, 7, DXGI_FORMAT_R8G8B8A8_UNORM, random) },
+      { SliceName("bc", 0), BuildDDS(128, 128, 1, DXGI_FORMAT_BC1_UNORM, random) },
+      { SliceName("broken", 0), BuildDDS(64, 64, 1, DXGI_FORMAT_R8G8B8A8_UNORM, random) },
+      { SliceName("line", 0), BuildDDS(16, 1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, random) },
+    };
+    files[3].data.resize(files[3].data.size() - 1);
+    reinterpret_cast<DDS_HEADER_DXT10*>(files[4].data.data() + sizeof(uint32_t) + sizeof(DDS_HEADER))->resourceDimension = DDS_DIMENSION_TEXTURE1D;
+    for (auto& file : files)
+      CHECK(SaveFile(file));
+    std::vector<const wchar_t*> names = Names(files);
+    std::wstring missing = SliceName("missing", 0);
+    names.push_back(missing.c_str());
+
+    std::vector<TextureSlice> slices;
+    std::vector<HRESULT> results;
+    SliceLoader::LoadAll(names, slices, results);
+    CHECK(slices.size() == names.size() && results.size() == names.size());
+    CHECK(results[0] == S_OK && results[1] == S_OK && results[2] == S_OK);
+    CHECK(results[3] == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+    CHECK(results[4] == HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+    CHECK(results[5] == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+
+    // Uncompressed slice without mips gets full chain on CPU, others keep what file has
+    CHECK(slices[0].mips.size() == MipGenerator::CountMips(64, 64) && !slices[0].mipChain.empty());
+    CHECK(slices[1].mips.size() == 7 && slices[1].mipChain.empty());
+    CHECK(slices[2].mips.size() == 1);
+    uint32_t width = 64;
+    for (const SliceMip& mip : slices[0].mips) {
+      CHECK(mip.rowPitch == width * 4 && mip.slicePitch == mip.rowPitch * width);
+      width = (std::max)(width >> 1, 1u);
+    }
+    // Top level points into file data, mips of file come right after it
+    CHECK(slices[1].mips[0].data == slices[1].layout.bitData);
+    CHECK(slices[1].mips[1].data == slices[1].layout.bitData + 64 * 32 * 4);
+
+    printf("slice results: %zu files, status per slice ok\n", names.size());
+    RemoveFiles(files);
+  }
+
+  // Packed slices come straight from mapped archive, loose file of the same name is not read
+  void TestArchiveSlices() {
+    TestRandom random(31);
+    std::vector<SliceFile> files;
+    for (uint32_t i = 0; i < 4; i++)
+      files.push_back({ SliceName("packed", i), BuildDDS(32, 32, 6, DXGI_FORMAT_R8G8B8A8_UNORM, random) });
+    std::vector<std::wstring> paths;
+    for (auto& file : files) {
+      CHECK(SaveFile(file));
+      paths.push_back(file.name);
+    }
+    CHECK(SUCCEEDED(AssetArchive::Pack(ARCHIVE_PATH, paths, false)));
+    RemoveFiles(files);
+
+    AssetArchive& archive = AssetArchive::GetInstance();
+    CHECK(SUCCEEDED(archive.Open(ARCHIVE_PATH)));
+    std::vector<TextureSlice> slices;
+    std::vector<HRESULT> results;
+    SliceLoader::LoadAll(Names(files), slices, results);
+    for (uint32_t i = 0; i < files.size(); i++) {
+      CHECK(results[i] == S_OK);
+      CHECK(slices[i].asset.storage.empty() && archive.IsMapped(slices[i].mips[0].data));
+      CHECK(memcmp(slices[i].layout.bitData, files[i].data.data() + files[i].data.size() - slices[i].layout.bitSize,
+        slices[i].layout.bitSize) == 0);
+    }
+    slices.clear();
+    archive.Close();
+    remove(Narrow(ARCHIVE_PATH).c_str());
+    printf("archive slices: %zu mapped\n", files.size());
+  }
+
+  // Slices without mips spend most of the time in Kaiser mip generation, which scales with workers
+  void BenchParallelLoad() {
+    const uint32_t SLICES_COUNT = 32;
+    TestRandom random(32);
+    std::vector<SliceFile> files;
+    for (uint32_t i = 0; i < SLICES_COUNT; i++)
+      files.push_back({ SliceName("bench", i), BuildDDS(512, 512, 1, DXGI_FORMAT_R8G8B8A8_UNORM, random) });
+    for (auto& file : files)
+      CHECK(SaveFile(file));
+    std::vector<const wchar_t*> names = Names(files);
+
+    std::vector<TextureSlice> serialSlices, parallelSlices;
+    std::vector<HRESULT> serialResults, parallelResults;
+    TestClock::time_point start = TestClock::now();
+    SliceLoader::LoadAll(names, serialSlices, serialResults, false);
+    double serialMs = ElapsedMs(start);
+    start = TestClock::now();
+    SliceLoader::LoadAll(names, parallelSlices, parallelResults, true);
+    double parallelMs = ElapsedMs(start);
+
+    uint32_t sameCount = 0;
+    for (uint32_t i = 0; i < SLICES_COUNT; i++)
+      sameCount += serialResults[i] == S_OK && parallelResults[i] == S_OK && SameSlices(serialSlices[i], parallelSlices[i]);
+    CHECK(sameCount == SLICES_COUNT);
+
+    printf("%u slices 512^2 without mips: serial %.1f ms, parallel %.1f ms (%u workers), x%.2f\n",
+      SLICES_COUNT, serialMs, parallelMs, ThreadPool::GetInstance().GetWorkersCount(), serialMs / parallelMs);
+    RemoveFiles(files);
+  }
+}
+
+int main() {
+  TestSliceResults();
+  TestArchiveSlices();
+  BenchParallelLoad();
+  return TestResult();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Failed checks are reported and counted, test returns their count
+static int testFails = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+      testFails++; \
+    } \
+  } while (0)
+
+typedef std::chrono::steady_clock TestClock;
+
+inline double ElapsedMs(TestClock::time_point start) {
+  return std::chrono::duration<double, std::milli>(TestClock::now() - start).count();
+}
+
+// Deterministic random numbers, tests give the same cases on every platform
+class TestRandom {
+public:
+  explicit TestRandom(uint32_t seed) : state(seed ? seed : 1) {};
+
+  uint32_t Next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  // In [min, max)
+  float Range(float min, float max) { return min + (max - min) * (Next() >> 8) * (1.0f / 16777216.0f); };
+private:
+  uint32_t state;
+};
+
+inline int TestResult() {
+  if (testFails)
+    printf("FAILED %d checks\n", testFails);
+  else
+    printf("OK\n");
+  return testFails;
+}
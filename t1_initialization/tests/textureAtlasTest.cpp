@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "textureAtlas.h"
+#include "testCommon.h"
+
+// Skyline packing: rects never overlap and stay on their pages, layouts keep mips on block
+// boundaries and uv rects inside their items. Occupancy and pack time are printed
+namespace {
+  bool Overlap(const AtlasRect& a, const AtlasRect& b, uint32_t alignment) {
+    auto alignUp = [&](uint32_t value) { return (value + alignment - 1) / alignment * alignment; };
+    return a.page == b.page &&
+      a.x < b.x + alignUp(b.width) && b.x < a.x + alignUp(a.width) &&
+      a.y < b.y + alignUp(b.height) && b.y < a.y + alignUp(a.height);
+  }
+
+  // Number of broken rects, brute force over pairs
+  uint32_t CountBadRects(const std::vector<AtlasRect>& rects, uint32_t pagesCount, uint32_t pageWidth, uint32_t pageHeight, uint32_t alignment) {
+    uint32_t bad = 0;
+    for (size_t i = 0; i < rects.size(); i++) {
+      const AtlasRect& rect = rects[i];
+      bool ok = rect.page < pagesCount && rect.x % alignment == 0 && rect.y % alignment == 0 &&
+        rect.x + rect.width <= pageWidth && rect.y + rect.height <= pageHeight;
+      for (size_t j = i + 1; j < rects.size() && ok; j++)
+        ok = !Overlap(rect, rects[j], alignment);
+      bad += !ok;
+    }
+    return bad;
+  }
+
+  std::vector<AtlasRect> RandomRects(TestRandom& random, uint32_t count, uint32_t minSide, uint32_t maxSide) {
+    std::vector<AtlasRect> rects(count);
+    for (auto& rect : rects) {
+      rect.width = minSide + random.Next() % (maxSide - minSide + 1);
+      rect.height = minSide + random.Next() % (maxSide - minSide + 1);
+    }
+    return rects;
+  }
+
+  void TestPack() {
+    TestRandom random(29);
+    uint32_t badCount = 0;
+    uint64_t usedArea = 0, pagesArea = 0;
+    const uint32_t alignments[] = { 1, 4, 16, 64 };
+    for (uint32_t set = 0; set < 200; set++) {
+      uint32_t alignment = alignments[set % 4];
+      uint32_t pageWidth = 256 << (random.Next() % 3);
+      uint32_t pageHeight = 256 << (random.Next() % 3);
+      std::vector<AtlasRect> rects = RandomRects(random, 1 + random.Next() % 120, 1, 200);
+      uint32_t pagesCount = AtlasPacker::Pack(pageWidth, pageHeight, alignment, rects);
+      CHECK(pagesCount > 0);
+      badCount += CountBadRects(rects, pagesCount, pageWidth, pageHeight, alignment);
+      for (auto& rect : rects)
+        usedArea += uint64_t(rect.width) * rect.height;
+      pagesArea += uint64_t(pageWidth) * pageHeight * pagesCount;
+    }
+    CHECK(badCount == 0);
+    printf("pack: 200 random sets, %u bad rects, occupancy %.1f%%\n", badCount, 100.0 * usedArea / pagesArea);
+
+    // Equal squares tile page exactly
+    std::vector<AtlasRect> squares(64);
+    for (auto& rect : squares)
+      rect.width = rect.height = 256;
+    CHECK(AtlasPacker::Pack(2048, 2048, 4, squares) == 1);
+    squares.push_back(squares[0]);
+    CHECK(AtlasPacker::Pack(2048, 2048, 4, squares) == 2);
+
+    // Rects that can't fit, zero sizes and bad params
+    std::vector<AtlasRect> rects = RandomRects(random, 4, 10, 20);
+    rects[2].width = 2049;
+    CHECK(AtlasPacker::Pack(2048, 2048, 1, rects) == 0);
+    // Aligned size has to fit
+    rects[2].width = 2045;
+    CHECK(AtlasPacker::Pack(2046, 2048, 4, rects) == 0);
+    CHECK(AtlasPacker::Pack(2046, 2048, 1, rects) == 1);
+    rects[2].width = 0;
+    CHECK(AtlasPacker::Pack(2048, 2048, 1, rects) == 0);
+    rects[2].width = 10;
+    CHECK(AtlasPacker::Pack(2048, 2048, 0, rects) == 0);
+    CHECK(AtlasPacker::Pack(0, 2048, 1, rects) == 0);
+  }
+
+  // Every kept mip of every rect starts on block boundary, bilinear taps stay inside rect
+  void TestBuild() {
+    TestRandom random(290);
+    uint32_t badCount = 0;
+    for (uint32_t set = 0; set < 100; set++) {
+      bool compressed = set % 2 == 0;
+      DXGI_FORMAT format = compressed ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+      uint32_t blockSize = compressed ? 4 : 1;
+      std::vector<AtlasItem> items(1 + random.Next() % 40);
+      for (auto& item : items) {
+        item.width = 4u << (random.Next() % 7);
+        item.height = 4u << (random.Next() % 7);
+        uint32_t maxMips = 1 + (uint32_t)std::log2((double)(std::max)(item.width, item.height));
+        item.mipCount = 1 + random.Next() % maxMips;
+        item.format = format;
+      }
+
+      AtlasLayout layout;
+      CHECK(AtlasPacker::Build(items, 1024, layout));
+      CHECK(layout.format == format && layout.rects.size() == items.size());
+      CHECK(layout.alignment == blockSize << (layout.mipCount - 1));
+      CHECK(CountBadRects(layout.rects, layout.pagesCount, layout.pageWidth, layout.pageHeight, layout.alignment) == 0);
+      // Single page is trimmed to used area, which is still aligned
+      CHECK(layout.pagesCount > 1 || (layout.pageWidth <= 1024 && layout.pageWidth % layout.alignment == 0));
+
+      for (size_t i = 0; i < items.size(); i++) {
+        const AtlasRect& rect = layout.rects[i];
+        bool ok = layout.mipCount <= items[i].mipCount && rect.width == items[i].width && rect.height == items[i].height;
+        for (uint32_t mip = 0; mip < layout.mipCount; mip++)
+          ok = ok && (rect.x >> mip) % blockSize == 0 && (rect.y >> mip) % blockSize == 0 &&
+            ((rect.x >> mip) << mip) == rect.x && ((rect.y >> mip) << mip) == rect.y;
+
+        // uv [0, 1] of item maps to rect inset by half texel of last kept mip
+        const XMFLOAT4& uv = rect.uvScaleOffset;
+        double lastTexel = double(1u << (layout.mipCount - 1));
+        double left = uv.z * layout.pageWidth, right = (uv.z + uv.x) * layout.pageWidth;
+        double top = uv.w * layout.pageHeight, bottom = (uv.w + uv.y) * layout.pageHeight;
+        ok = ok && std::fabs(left - (rect.x + 0.5 * lastTexel)) < 1e-3 && std::fabs(right - (rect.x + rect.width - 0.5 * lastTexel)) < 1e-3 &&
+          std::fabs(top - (rect.y + 0.5 * lastTexel)) < 1e-3 && std::fabs(bottom - (rect.y + rect.height - 0.5 * lastTexel)) < 1e-3;
+        badCount += !ok;
+      }
+    }
+    CHECK(badCount == 0);
+    printf("build: 100 layouts, %u bad rects\n", badCount);
+
+    // Mips are cut so alignment doesn't outgrow smallest item
+    std::vector<AtlasItem> items = { { 256, 256, 9, DXGI_FORMAT_BC1_UNORM }, { 16, 64, 7, DXGI_FORMAT_BC1_UNORM } };
+    AtlasLayout layout;
+    CHECK(AtlasPacker::Build(items, 2048, layout));
+    CHECK(layout.mipCount == 3 && layout.alignment == 16);
+    CHECK(layout.pagesCount == 1 && layout.pageWidth == 272 && layout.pageHeight == 256);
+
+    items[1].format = DXGI_FORMAT_BC3_UNORM;
+    CHECK(!AtlasPacker::Build(items, 2048, layout) && layout.rects.empty());
+    items[1] = { 4096, 16, 1, DXGI_FORMAT_BC1_UNORM };
+    CHECK(!AtlasPacker::Build(items, 2048, layout) && layout.rects.empty());
+    items[1] = { 16, 16, 0, DXGI_FORMAT_BC1_UNORM };
+    CHECK(!AtlasPacker::Build(items, 2048, layout));
+    CHECK(!AtlasPacker::Build({}, 2048, layout));
+  }
+
+  void BenchPack() {
+    TestRandom random(2900);
+    const uint32_t counts[] = { 100, 1000, 4000 };
+    for (uint32_t count : counts) {
+      std::vector<AtlasRect> rects = RandomRects(random, count, 8, 256);
+      const uint32_t repeats = 20000 / count;
+      uint32_t pagesCount = 0;
+      TestClock::time_point start = TestClock::now();
+      for (uint32_t r = 0; r < repeats; r++)
+        pagesCount = AtlasPacker::Pack(2048, 2048, 4, rects);
+      double ms = ElapsedMs(start) / repeats;
+      uint64_t usedArea = 0;
+      for (auto& rect : rects)
+        usedArea += uint64_t(rect.width) * rect.height;
+      printf("%u rects: %.3f ms per pack, %u pages, occupancy %.1f%%\n", count, ms, pagesCount,
+        100.0 * usedArea / (2048.0 * 2048.0 * pagesCount));
+    }
+  }
+}
+
+int main() {
+  TestPack();
+  TestBuild();
+  BenchPack();
+  return TestResult();
+}
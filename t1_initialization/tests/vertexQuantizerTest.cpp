@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "vertexQuantizer.h"
+#include "testCommon.h"
+
+// Quantized vertices decode within their error bounds: positions against PositionErrorBound,
+// octahedral normals by angle, uv by half float precision. Encode / decode time is printed
+namespace {
+  // Worst angle between unit vector and its octahedral round trip, measured on a dense set
+  const float OCT_MAX_ANGLE = 1e-4f;
+
+  XMFLOAT3 RandomUnit(TestRandom& random) {
+    for (;;) {
+      XMFLOAT3 v(random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f), random.Range(-1.0f, 1.0f));
+      float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+      if (length > 0.1f && length <= 1.0f)
+        return XMFLOAT3(v.x / length, v.y / length, v.z / length);
+    }
+  }
+
+  // atan2 form, acos of dot near 1 turns float rounding of unit length into 1e-4 rad noise
+  float Angle(const XMFLOAT3& a, const XMFLOAT3& b) {
+    double cx = (double)a.y * b.z - (double)a.z * b.y;
+    double cy = (double)a.z * b.x - (double)a.x * b.z;
+    double cz = (double)a.x * b.y - (double)a.y * b.x;
+    double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+    return (float)std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot);
+  }
+
+  std::vector<TexVertex> RandomVertices(TestRandom& random, size_t count, const XMFLOAT3& center, const XMFLOAT3& extent) {
+    std::vector<TexVertex> vertices(count);
+    for (auto& vertex : vertices) {
+      vertex.pos = XMFLOAT3(center.x + random.Range(-extent.x, extent.x), center.y + random.Range(-extent.y, extent.y),
+        center.z + random.Range(-extent.z, extent.z));
+      vertex.uv = XMFLOAT2(random.Range(-2.0f, 2.0f), random.Range(0.0f, 1.0f));
+      vertex.normal = RandomUnit(random);
+      vertex.tangent = RandomUnit(random);
+    }
+    return vertices;
+  }
+
+  void TestPositions() {
+    TestRandom random(33);
+    const XMFLOAT3 centers[] = { { 0.0f, 0.0f, 0.0f }, { 1000.0f, -50.0f, 3.0f }, { -20000.0f, 0.5f, 20000.0f } };
+    const XMFLOAT3 extents[] = { { 1.0f, 1.0f, 1.0f }, { 100.0f, 0.01f, 5.0f }, { 0.5f, 0.0f, 300.0f } };
+    uint32_t outside = 0;
+    double worstRatio = 0.0;
+    for (const XMFLOAT3& center : centers) {
+      for (const XMFLOAT3& extent : extents) {
+        std::vector<TexVertex> vertices = RandomVertices(random, 5000, center, extent);
+        std::vector<QuantizedTexVertex> quantized(vertices.size());
+        std::vector<TexVertex> decoded(vertices.size());
+        VertexQuantization quantization = VertexQuantizer::Encode(vertices.data(), vertices.size(), quantized.data());
+        VertexQuantizer::Decode(quantized.data(), quantized.size(), quantization, decoded.data());
+        XMFLOAT3 bound = VertexQuantizer::PositionErrorBound(quantization);
+        XMMATRIX decodeMatrix = VertexQuantizer::DecodeMatrix(quantization);
+
+        for (size_t i = 0; i < vertices.size(); i++) {
+          const float original[3] = { vertices[i].pos.x, vertices[i].pos.y, vertices[i].pos.z };
+          const float result[3] = { decoded[i].pos.x, decoded[i].pos.y, decoded[i].pos.z };
+          const float bounds[3] = { bound.x, bound.y, bound.z };
+          for (uint32_t a = 0; a < 3; a++) {
+            double error = std::fabs((double)result[a] - original[a]);
+            outside += error > bounds[a];
+            if (bounds[a] > 0.0f)
+              worstRatio = (std::max)(worstRatio, error / bounds[a]);
+          }
+          CHECK(quantized[i].pos[3] == 65535);
+
+          // Folding decode into world matrix gives the same point as shader decode
+          XMVECTOR unorm = XMVectorSet(quantized[i].pos[0] / 65535.0f, quantized[i].pos[1] / 65535.0f, quantized[i].pos[2] / 65535.0f, 1.0f);
+          XMFLOAT3 transformed;
+          XMStoreFloat3(&transformed, XMVector3TransformCoord(unorm, decodeMatrix));
+          outside += std::fabs(transformed.x - original[0]) > 2.0f * bound.x || std::fabs(transformed.y - original[1]) > 2.0f * bound.y ||
+            std::fabs(transformed.z - original[2]) > 2.0f * bound.z;
+        }
+      }
+    }
+    CHECK(outside == 0);
+    printf("positions: 45000 vertices, %u outside of bound, worst error %.2f of bound\n", outside, worstRatio);
+
+    // Flat axis decodes exactly, bounds corners are exact
+    std::vector<SimpleVertex> flat = { { -3.0f, 7.0f, 1.0f }, { 5.0f, 7.0f, 2.0f }, { 1.0f, 7.0f, 1.5f } };
+    std::vector<QuantizedSimpleVertex> quantizedFlat(flat.size());
+    std::vector<SimpleVertex> decodedFlat(flat.size());
+    VertexQuantization quantization = VertexQuantizer::Encode(flat.data(), flat.size(), quantizedFlat.data());
+    VertexQuantizer::Decode(quantizedFlat.data(), flat.size(), quantization, decodedFlat.data());
+    CHECK(quantization.posScale.y == 0.0f && quantization.posOffset.y == 7.0f);
+    for (auto& vertex : decodedFlat)
+      CHECK(vertex.y == 7.0f);
+    CHECK(decodedFlat[0].x == -3.0f && decodedFlat[1].x == 5.0f);
+    CHECK(quantizedFlat[0].pos[0] == 0 && quantizedFlat[1].pos[0] == 65535);
+
+    quantization = VertexQuantizer::Encode(static_cast<const SimpleVertex*>(nullptr), 0, nullptr);
+    CHECK(quantization.posScale.x == 0.0f && quantization.posOffset.w == 0.0f);
+  }
+
+  void TestOctahedral() {
+    TestRandom random(330);
+    std::vector<XMFLOAT3> vectors;
+    for (uint32_t i = 0; i < 200000; i++)
+      vectors.push_back(RandomUnit(random));
+    // Axes, octant diagonals and fold edges are special cases of the mapping
+    const float d = 1.0f / sqrtf(3.0f), e = 1.0f / sqrtf(2.0f);
+    const XMFLOAT3 special[] = {
+      { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+      { d, d, d }, { -d, d, -d }, { d, -d, -d }, { -d, -d, -d },
+      { e, e, 0 }, { -e, 0, -e }, { 0, e, -e }, { 0, -e, -e }, { e, 0, -e },
+      { 1e-7f, 0, -1 }, { 0, -1e-7f, -1 }
+    };
+    vectors.insert(vectors.end(), std::begin(special), std::end(special));
+
+    float worstAngle = 0.0f;
+    uint32_t badLength = 0;
+    for (const XMFLOAT3& vector : vectors) {
+      int16_t encoded[2];
+      VertexQuantizer::OctEncode(vector, encoded);
+      XMFLOAT3 decoded = VertexQuantizer::OctDecode(encoded);
+      worstAngle = (std::max)(worstAngle, Angle(vector, decoded));
+      badLength += std::fabs(sqrtf(decoded.x * decoded.x + decoded.y * decoded.y + decoded.z * decoded.z) - 1.0f) > 1e-5f;
+    }
+    CHECK(worstAngle <= OCT_MAX_ANGLE);
+    CHECK(badLength == 0);
+    printf("octahedral: %zu vectors, worst angle %.2e rad\n", vectors.size(), worstAngle);
+
+    // Zero vector doesn't make NaNs, snorm -32768 decodes as -1
+    int16_t encoded[2] = { 1, 1 };
+    VertexQuantizer::OctEncode(XMFLOAT3(0.0f, 0.0f, 0.0f), encoded);
+    CHECK(encoded[0] == 0 && encoded[1] == 0);
+    const int16_t minimum[2] = { -32768, 0 };
+    const int16_t clamped[2] = { -32767, 0 };
+    XMFLOAT3 a = VertexQuantizer::OctDecode(minimum), b = VertexQuantizer::OctDecode(clamped);
+    CHECK(a.x == b.x && a.y == b.y && a.z == b.z);
+  }
+
+  void TestUV() {
+    TestRandom random(3300);
+    std::vector<TexVertex> vertices = RandomVertices(random, 10000, XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1));
+    std::vector<QuantizedTexVertex> quantized(vertices.size());
+    std::vector<TexVertex> decoded(vertices.size());
+    VertexQuantization quantization = VertexQuantizer::Encode(vertices.data(), vertices.size(), quantized.data());
+    VertexQuantizer::Decode(quantized.data(), quantized.size(), quantization, decoded.data());
+    uint32_t outside = 0;
+    for (size_t i = 0; i < vertices.size(); i++) {
+      // Half float: 11 significant bits, round to nearest
+      outside += std::fabs(decoded[i].uv.x - vertices[i].uv.x) > std::fabs(vertices[i].uv.x) * (1.0f / 2048.0f) + 1e-7f;
+      outside += std::fabs(decoded[i].uv.y - vertices[i].uv.y) > std::fabs(vertices[i].uv.y) * (1.0f / 2048.0f) + 1e-7f;
+      outside += Angle(decoded[i].tangent, vertices[i].tangent) > OCT_MAX_ANGLE;
+    }
+    CHECK(outside == 0);
+    CHECK(sizeof(QuantizedTexVertex) == 20 && sizeof(QuantizedSimpleVertex) == 8);
+  }
+
+  void BenchEncode() {
+    const size_t COUNT = 1000000;
+    TestRandom random(33000);
+    std::vector<TexVertex> vertices = RandomVertices(random, COUNT, XMFLOAT3(10, 0, -5), XMFLOAT3(50, 50, 50));
+    std::vector<QuantizedTexVertex> quantized(COUNT);
+    std::vector<TexVertex> decoded(COUNT);
+    TestClock::time_point start = TestClock::now();
+    VertexQuantization quantization = VertexQuantizer::Encode(vertices.data(), COUNT, quantized.data());
+    double encodeMs = ElapsedMs(start);
+    start = TestClock::now();
+    VertexQuantizer::Decode(quantized.data(), COUNT, quantization, decoded.data());
+    double decodeMs = ElapsedMs(start);
+    printf("1M tex vertices: encode %.1f ms, decode %.1f ms, %zu -> %zu MB\n", encodeMs, decodeMs,
+      COUNT * sizeof(TexVertex) >> 20, COUNT * sizeof(QuantizedTexVertex) >> 20);
+  }
+}
+
+int main() {
+  TestPositions();
+  TestOctahedral();
+  TestUV();
+  BenchEncode();
+  return TestResult();
+}
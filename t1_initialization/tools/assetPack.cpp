@@ -0,0 +1,31 @@
+#include <cstdio>
+
+#include "assetArchive.h"
+#include "toolArgs.h"
+
+// Packs loose files into asset archive, same as -pack of the application:
+//   assetPack <archive> [-lz4] <files...>
+int main(int argc, char* argv[]) {
+  std::vector<std::wstring> args = WideArgs(argc, argv);
+  if (args.size() < 3) {
+    printf("usage: assetPack <archive> [-lz4] <files...>\n");
+    return 2;
+  }
+
+  bool compress = false;
+  std::vector<std::wstring> files;
+  for (size_t i = 2; i < args.size(); i++) {
+    if (args[i] == L"-lz4")
+      compress = true;
+    else
+      files.push_back(args[i]);
+  }
+
+  HRESULT hr = AssetArchive::Pack(args[1].c_str(), files, compress);
+  if (FAILED(hr)) {
+    printf("assetPack: failed to pack %s (0x%08X)\n", argv[1], (unsigned)hr);
+    return 1;
+  }
+  printf("assetPack: %zu files into %s\n", files.size(), argv[1]);
+  return 0;
+}
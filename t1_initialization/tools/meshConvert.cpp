@@ -0,0 +1,24 @@
+#include <cstdio>
+
+#include "meshConverter.h"
+#include "toolArgs.h"
+
+// Converts OBJ mesh to mesh file, same as -mesh of the application:
+//   meshConvert <source.obj> <result.mesh>
+int main(int argc, char* argv[]) {
+  std::vector<std::wstring> args = WideArgs(argc, argv);
+  if (args.size() != 3) {
+    printf("usage: meshConvert <source.obj> <result.mesh>\n");
+    return 2;
+  }
+
+  MeshConvertStats stats;
+  HRESULT hr = MeshConverter::ConvertFile(args[1].c_str(), args[2].c_str(), &stats);
+  if (FAILED(hr)) {
+    printf("meshConvert: failed to convert %s (0x%08X)\n", argv[1], (unsigned)hr);
+    return 1;
+  }
+  printf("meshConvert: %u vertices, %u triangles, %u meshlets, ACMR %.3f -> %.3f\n", stats.verticesCount, stats.trianglesCount,
+    stats.meshletsCount, stats.acmrBefore, stats.acmrAfter);
+  return 0;
+}
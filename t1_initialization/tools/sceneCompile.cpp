@@ -0,0 +1,22 @@
+#include <cstdio>
+
+#include "sceneCompiler.h"
+#include "toolArgs.h"
+
+// Compiles text scene description to binary scene file, same as -scene of the application:
+//   sceneCompile <source.scene> <result.scnb>
+int main(int argc, char* argv[]) {
+  std::vector<std::wstring> args = WideArgs(argc, argv);
+  if (args.size() != 3) {
+    printf("usage: sceneCompile <source.scene> <result.scnb>\n");
+    return 2;
+  }
+
+  HRESULT hr = SceneCompiler::CompileFile(args[1].c_str(), args[2].c_str());
+  if (FAILED(hr)) {
+    printf("sceneCompile: failed to compile %s (0x%08X)\n", argv[1], (unsigned)hr);
+    return 1;
+  }
+  printf("sceneCompile: %s -> %s\n", argv[1], argv[2]);
+  return 0;
+}
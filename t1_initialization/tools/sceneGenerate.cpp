@@ -0,0 +1,29 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "sceneGenerator.h"
+#include "toolArgs.h"
+
+// Generates benchmark scene file from preset and seed, same as -generate of the application:
+//   sceneGenerate <preset> <seed> <result.scnb>
+int main(int argc, char* argv[]) {
+  std::vector<std::wstring> args = WideArgs(argc, argv);
+  char* seedEnd = nullptr;
+  unsigned long long seed = args.size() == 4 ? strtoull(argv[2], &seedEnd, 10) : 0;
+  SceneGenParams params;
+  if (args.size() != 4 || seedEnd == argv[2] || *seedEnd != '\0' || !SceneGenerator::GetPreset(argv[1], seed, params)) {
+    printf("usage: sceneGenerate <preset> <seed> <result.scnb>, presets:");
+    for (uint32_t i = 0; i < SceneGenerator::GetPresetsCount(); i++)
+      printf(" %s", SceneGenerator::GetPresetName(i));
+    printf("\n");
+    return 2;
+  }
+
+  HRESULT hr = SceneGenerator::GenerateFile(params, args[3].c_str());
+  if (FAILED(hr)) {
+    printf("sceneGenerate: failed to write %s (0x%08X)\n", argv[3], (unsigned)hr);
+    return 1;
+  }
+  printf("sceneGenerate: %s seed %llu, %u boxes, %u lights -> %s\n", argv[1], seed, params.boxesCount, params.lightsCount, argv[3]);
+  return 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+
+// Command line of offline tools as wide strings, asset code takes wchar_t paths.
+// Arguments are expected in UTF-8
+inline std::vector<std::wstring> WideArgs(int argc, char* argv[]) {
+  std::vector<std::wstring> args;
+  for (int i = 0; i < argc; i++) {
+    int length = MultiByteToWideChar(CP_UTF8, 0, argv[i], -1, nullptr, 0);
+    std::wstring arg(length > 0 ? length : 1, L'\0');
+    if (length > 0)
+      MultiByteToWideChar(CP_UTF8, 0, argv[i], -1, &arg[0], length);
+    arg.resize(arg.size() - 1);
+    args.push_back(arg);
+  }
+  return args;
+}